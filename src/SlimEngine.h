@@ -2,6 +2,7 @@
 
 #define SLIM_ENGINE_SHF
 
+
 #ifdef __cplusplus
 #include <cmath>
 #else
@@ -23,9 +24,33 @@
 #elif defined(COMPILER_MSVC)
 #define INLINE inline __forceinline
 #elif defined(COMPILER_CLANG_OR_GCC)
-#define INLINE inline __attribute__((always_inline))
+    #define INLINE inline __attribute__((always_inline))
+#else
+    #define INLINE inline
+#endif
+
+#if defined(COMPILER_MSVC)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(__cplusplus)
+#define THREAD_LOCAL thread_local
 #else
-#define INLINE inline
+#define THREAD_LOCAL __thread
+#endif
+
+// Atomic operations on 32-bit values shared between threads (acquiring on loads and releasing on stores):
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#define ATOMIC_ADD(value, amount) (_InterlockedExchangeAdd((volatile long*)(value), (long)(amount)) + (long)(amount))
+#define ATOMIC_LOAD(value) _InterlockedOr((volatile long*)(value), 0)
+#define ATOMIC_STORE(value, new_value) _InterlockedExchange((volatile long*)(value), (long)(new_value))
+#define ATOMIC_TRY_LOCK(lock) (_InterlockedExchange((volatile long*)(lock), 1) == 0)
+#define ATOMIC_UNLOCK(lock) _InterlockedExchange((volatile long*)(lock), 0)
+#else
+#define ATOMIC_ADD(value, amount) __atomic_add_fetch((value), (amount), __ATOMIC_ACQ_REL)
+#define ATOMIC_LOAD(value) __atomic_load_n((value), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(value, new_value) __atomic_store_n((value), (new_value), __ATOMIC_RELEASE)
+#define ATOMIC_TRY_LOCK(lock) (__atomic_exchange_n((lock), 1, __ATOMIC_ACQUIRE) == 0)
+#define ATOMIC_UNLOCK(lock) __atomic_store_n((lock), 0, __ATOMIC_RELEASE)
 #endif
 
 #ifdef COMPILER_CLANG
@@ -46,21 +71,21 @@ ENABLE_FP_CONTRACT
 #endif
 
 #ifdef __cplusplus
-#define null nullptr
+    #define null nullptr
     #ifndef signbit
         #define signbit std::signbit
     #endif
 #else
-#define null 0
-typedef unsigned char      bool;
-#endif
+    #define null 0
+    typedef unsigned char      bool;
+ #endif
 
 typedef unsigned char      u8;
 typedef unsigned short     u16;
-typedef unsigned long int  u32;
+typedef unsigned int       u32;
 typedef unsigned long long u64;
 typedef signed   short     i16;
-typedef signed   long int  i32;
+typedef signed   int       i32;
 
 typedef float  f32;
 typedef double f64;
@@ -74,15 +99,19 @@ typedef double f64;
 #endif
 
 typedef void* (*CallbackWithInt)(u64 size);
+typedef bool (*CallbackForMemoryCommit)(void *address, u64 size);
 typedef void (*CallbackWithBool)(bool on);
 typedef void (*CallbackWithCharPtr)(char* str);
 
 #define TAU 6.28f
 #define SQRT2_OVER_2 0.70710678118f
+#define SQRT2 1.41421356237f
 #define SQRT3 1.73205080757f
 #define COLOR_COMPONENT_TO_FLOAT 0.00392156862f
 #define FLOAT_TO_COLOR_COMPONENT 255.0f
 
+#define DEG_TO_RAD 0.0174533f
+
 #define MAX_COLOR_VALUE 0xFF
 
 #define MAX_WIDTH 3840
@@ -92,13 +121,22 @@ typedef void (*CallbackWithCharPtr)(char* str);
 #define BOX__VERTEX_COUNT 8
 #define BOX__EDGE_COUNT 12
 #define GRID__MAX_SEGMENTS 101
+#define GRID__FADE_BANDS 8
+#define GRID__MAX_CLIPPED_VERTICES 10
+#define GRID__MAX_LINE_POSITION 16777216.0f
+#define CURVE_STEPS 3600
+#define CURVE__MIN_STEPS 16
+#define CURVE__STEPS_GRANULARITY 16
 
 #define IS_VISIBLE ((u8)1)
 #define IS_TRANSLATED ((u8)2)
 #define IS_ROTATED ((u8)4)
 #define IS_SCALED ((u8)8)
 #define IS_SCALED_NON_UNIFORMLY ((u8)16)
-#define ALL_FLAGS (IS_VISIBLE | IS_TRANSLATED | IS_ROTATED | IS_SCALED | IS_SCALED_NON_UNIFORMLY)
+#define IS_DIRTY ((u8)32)
+#define ALL_FLAGS (IS_VISIBLE | IS_TRANSLATED | IS_ROTATED | IS_SCALED | IS_SCALED_NON_UNIFORMLY | IS_DIRTY)
+
+#define XFORM3__DIRTY_ROTATION ((u8)1)
 
 #define CAMERA_DEFAULT__FOCAL_LENGTH 2.0f
 #define CAMERA_DEFAULT__TARGET_DISTANCE 10
@@ -114,26 +152,58 @@ typedef void (*CallbackWithCharPtr)(char* str);
 
 #define VIEWPORT_DEFAULT__NEAR_CLIPPING_PLANE_DISTANCE 0.001f
 #define VIEWPORT_DEFAULT__FAR_CLIPPING_PLANE_DISTANCE 1000.0f
+#define VIEWPORT_DEFAULT__CURVE_TOLERANCE 0.5f
+#define VIEWPORT_DEFAULT__MIN_RESOLUTION_SCALE 0.25f
+
+#define VIEWPORT_SCALING__STEP 0.0625f
+#define VIEWPORT_SCALING__SMOOTHING 0.25f
+#define VIEWPORT_SCALING__SETTLE_FRAMES 8
+#define VIEWPORT_SCALING__TOLERANCE 0.1f
+#define VIEWPORT_SCALING__ANTIALIAS_HEADROOM 2.5f
+
+#define PROFILER__MAX_SCOPES 32
+#define PROFILER__MAX_DEPTH 16
+#define PROFILER__MAX_EVENTS 4096
+#define PROFILER__FRAME_HISTORY 64
+#define PROFILER__TEXT_LENGTH 64
+#define PROFILER__TRACE_EVENT_ROOM 128
+#define PROFILER__NO_SCOPE 0xFFFFFFFF
+
+#define HUD__MAX_LINE_RUNS 1024
+
+#define TIMER__MAX_DELTA_TIME 0.1f
+
+#define PARALLEL__MAX_THREADS 32
+#define PARALLEL__MIN_BAND_HEIGHT 32
 
-// Culling flags:
-// ======================
-#define IS_NEAR  0b00000001
-#define IS_FAR   0b00000010
-#define IS_BELOW 0b00000100
-#define IS_ABOVE 0b00001000
-#define IS_RIGHT 0b00010000
-#define IS_LEFT  0b00100000
-#define IS_OUT   0b00111111
-#define IS_NDC   0b01000000
-
-// Clipping flags:
-// ===============
-#define CULL    0b00000000
-#define INSIDE  0b00000010
-
-#define LAMBERT 1
-#define PHONG 2
-#define BLINN 4
+#define JOBS__DEQUE_CAPACITY 256
+
+#define COMPOSITOR__MAX_VIEWPORTS 8
+
+#define SIMULATION__DEFAULT_STEPS_PER_SECOND 60
+#define SIMULATION__MAX_STEPS_PER_UPDATE 8
+
+#define INPUT_RECORDING__MAGIC 0x52494C53 // "SLIR"
+#define INPUT_RECORDING__VERSION 1
+
+#define SCENE_FILE__MAGIC 0x43534C53 // "SLSC"
+#define SCENE_FILE__VERSION 2
+#define SCENE_FILE__ALIGNMENT 16
+#define SCENE_FILE__MAX_SECTIONS 16
+#define SCENE_FILE__SECTION_TYPES 7 // See SceneFileSectionType
+#define SCENE_FILE__JOURNAL_MAGIC 0x4A4C534C // "SLJL"
+#define SCENE_FILE__MAX_JOURNAL_ENTRIES 32
+
+#define POOL__INVALID_INDEX 0xFFFFFFFF
+
+// Rasterizer statistics are compiled in only when SLIM_ENGINE_RASTERIZER_STATS is defined (before including SlimEngine).
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+#define COUNT_RASTERIZER_STAT(viewport, stat) ((viewport)->stats.stat++)
+#define ADD_RASTERIZER_STAT(viewport, stat, amount) ((viewport)->stats.stat += (amount))
+#else
+#define COUNT_RASTERIZER_STAT(viewport, stat)
+#define ADD_RASTERIZER_STAT(viewport, stat, amount)
+#endif
 
 typedef struct u8_3 { u8 x, y, z; } u8_3;
 typedef struct vec2i { i32 x, y; } vec2i;
@@ -144,11 +214,13 @@ typedef union vec4 { struct {f32 x, y, z, w;  }; struct {f32 r, g, b, a; }; stru
 typedef union mat2 { struct {vec2 X, Y;       }; vec2 axis[2]; } mat2;
 typedef union mat3 { struct {vec3 X, Y, Z;    }; vec3 axis[3]; } mat3;
 typedef union mat4 { struct {vec4 X, Y, Z, W; }; vec4 axis[4]; } mat4;
+typedef union mat3x4 { struct {vec3 X, Y, Z, W; }; vec3 axis[4]; } mat3x4;
 typedef struct AABB { vec3 min, max;   } AABB;
 typedef struct quat { vec3 axis; f32 amount; } quat;
 typedef struct Edge { vec3 from, to;  } Edge;
 typedef struct Rect { vec2i min, max; } Rect;
 typedef struct RGBA { u8 B, G, R, A; } RGBA;
+typedef union RGBA2u32 { RGBA rgba; u32 value; } RGBA2u32;
 typedef struct Pixel { vec3 color; f32 opacity; f64 depth; } Pixel;
 typedef union PixelQuad { Pixel quad[2][2]; struct { Pixel TL, TR, BL, BR; }; } PixelQuad;
 
@@ -215,29 +287,78 @@ f32 smoothstep(f32 from, f32 to, f32 t) {
 
 #define MEMORY_SIZE Gigabytes(1)
 #define MEMORY_BASE Terabytes(2)
-
-
+#define MEMORY__RESERVE_SIZE Gigabytes(16)
+#define MEMORY__COMMIT_GRANULARITY Megabytes(1)
+#define MEMORY__PAGE_SIZE Kilobytes(4)
+#define MEMORY__LARGE_PAGE_SIZE Megabytes(2)
+#define FRAME_MEMORY__RESERVE_SIZE Megabytes(256)
+
+// A memory arena: Allocations bump the address forward, and are freed in bulk by popping back to a marker.
+// When initialized with a commit callback, the capacity is only reserved (as virtual address space) up front,
+// and gets committed on demand in MEMORY__COMMIT_GRANULARITY increments as allocations grow past the committed size.
 typedef struct Memory {
     u8* address;
-    u64 occupied, capacity;
+    u64 occupied, committed, capacity;
+    CallbackForMemoryCommit commit;
 } Memory;
 
+typedef u64 MemoryMarker;
+
 void initMemory(Memory *memory, u8* address, u64 capacity) {
     memory->address = (u8*)address;
     memory->capacity = capacity;
+    memory->committed = capacity;
     memory->occupied = 0;
+    memory->commit = null;
+}
+
+void initGrowableMemory(Memory *memory, u8* reserved_address, u64 reserved_capacity, CallbackForMemoryCommit commit) {
+    initMemory(memory, reserved_address, reserved_capacity);
+    memory->committed = 0;
+    memory->commit = commit;
+}
+
+bool commitMemory(Memory *memory, u64 size) {
+    if (size <= memory->committed) return true;
+    if (!memory->commit) return false;
+
+    size += MEMORY__COMMIT_GRANULARITY - 1;
+    size -= size % MEMORY__COMMIT_GRANULARITY;
+    if (size > memory->capacity) size = memory->capacity;
+
+    u8 *base_address = memory->address - memory->occupied;
+    if (!memory->commit(base_address + memory->committed, size - memory->committed)) return false;
+
+    memory->committed = size;
+    return true;
 }
 
 void* allocateMemory(Memory *memory, u64 size) {
     if (!memory->address) return null;
-    memory->occupied += size;
-    if (memory->occupied > memory->capacity) return null;
+    if (size > memory->capacity - memory->occupied) return null;
+    if (!commitMemory(memory, memory->occupied + size)) return null;
 
+    memory->occupied += size;
     void* address = memory->address;
     memory->address += size;
     return address;
 }
 
+INLINE MemoryMarker pushMemoryMarker(Memory *memory) {
+    return memory->occupied;
+}
+
+INLINE void popMemoryMarker(Memory *memory, MemoryMarker marker) {
+    if (!memory->address || marker > memory->occupied) return;
+
+    memory->address -= memory->occupied - marker;
+    memory->occupied = marker;
+}
+
+INLINE void resetMemory(Memory *memory) {
+    popMemoryMarker(memory, 0);
+}
+
 typedef struct MouseButton {
     vec2i down_pos, up_pos, double_click_pos;
     bool is_pressed, is_handled;
@@ -248,12 +369,12 @@ typedef struct Mouse {
     vec2i pos, pos_raw_diff, movement;
     f32 wheel_scroll_amount;
     bool moved, is_captured,
-            move_handled,
-            double_clicked,
-            double_clicked_handled,
-            wheel_scrolled,
-            wheel_scroll_handled,
-            raw_movement_handled;
+         move_handled,
+         double_clicked,
+         double_clicked_handled,
+         wheel_scrolled,
+         wheel_scroll_handled,
+         raw_movement_handled;
 } Mouse;
 
 void resetMouseChanges(Mouse *mouse) {
@@ -281,9 +402,9 @@ typedef struct Dimensions {
     u16 width, height, stride;
     u32 width_times_height;
     f32 height_over_width,
-            width_over_height,
-            f_height, f_width,
-            h_height, h_width;
+        width_over_height,
+        f_height, f_width,
+        h_height, h_width;
 } Dimensions;
 
 void updateDimensions(Dimensions *dimensions, u16 width, u16 height, u16 stride) {
@@ -515,7 +636,7 @@ INLINE vec3 getColorInBetween(vec3 from, vec3 to, f32 t) {
             clampValueToBetween(fast_mul_add(to.r - from.r, t, from.r), 0, (f32)MAX_COLOR_VALUE),
             clampValueToBetween(fast_mul_add(to.g - from.g, t, from.g), 0, (f32)MAX_COLOR_VALUE),
             clampValueToBetween(fast_mul_add(to.b - from.b, t, from.b), 0, (f32)MAX_COLOR_VALUE)
-    );
+   );
 }
 
 typedef struct String {
@@ -528,11 +649,22 @@ typedef struct NumberString {
     String string;
 } NumberString;
 
+// A horizontal run of opaque pixels of the HUD, already resolved to the window content's format:
+typedef struct HUDRun {
+    u16 x, y, length;
+    u32 value;
+} HUDRun;
+
 typedef struct HUDLine {
     String title, alternate_value;
     NumberString value;
     enum ColorID title_color, value_color, alternate_value_color;
     bool invert_alternate_use, *use_alternate;
+
+    // The line as it was last rendered into the HUD's retained overlay (see viewport/hud.h):
+    HUDRun *runs;
+    u32 run_count;
+    u64 rendered_key;
 } HUDLine;
 
 typedef struct HUD {
@@ -543,372 +675,160 @@ typedef struct HUD {
 } HUD;
 
 
-void setString(String *string, char *char_ptr) {
-    string->char_ptr = char_ptr;
-    string->length = 0;
-    if (char_ptr)
-        while (char_ptr[string->length])
-            string->length++;
-}
+typedef struct KeyMap      { u8 ctrl, alt, shift, space, tab; } KeyMap;
+typedef struct IsPressed { bool ctrl, alt, shift, space, tab; } IsPressed;
+typedef struct Controls {
+    IsPressed is_pressed;
+    KeyMap key_map;
+    Mouse mouse;
+} Controls;
 
-u32 getStringLength(char *string) {
-    char *char_ptr = string;
-    u32 length = 0;
-    if (char_ptr) while (char_ptr[length]) length++;
-    return length;
-}
+typedef u64 (*GetTicks)();
 
-u32 getDirectoryLength(char *path) {
-    u32 path_len = getStringLength(path);
-    u32 dir_len = path_len;
-    while (path[dir_len] != '/' && path[dir_len] != '\\') dir_len--;
-    return dir_len + 1;
-}
+typedef struct PerTick {
+    f64 seconds, milliseconds, microseconds, nanoseconds;
+} PerTick;
 
-void copyToString(String *string, char* char_ptr, u32 offset) {
-    string->length = offset;
-    char *source_char = char_ptr;
-    char *string_char = string->char_ptr + offset;
-    while (source_char[0]) {
-        *string_char = *source_char;
-        string_char++;
-        source_char++;
-        string->length++;
-    }
-    *string_char = 0;
-}
+typedef struct Ticks {
+    PerTick per_tick;
+    u64 per_second;
+} Ticks;
 
-void initNumberString(NumberString *number_string) {
-    number_string->string.char_ptr = number_string->_buffer;
-    number_string->string.length = 1;
-    number_string->_buffer[12] = 0;
-    for (u8 i = 0; i < 12; i++)
-        number_string->_buffer[i] = ' ';
-}
+typedef struct Timer {
+    GetTicks getTicks;
+    Ticks *ticks;
+    f32 delta_time;
+    u64 ticks_before,
+        ticks_after,
+        ticks_diff,
+        accumulated_ticks,
+        accumulated_frame_count,
+        ticks_of_last_report,
+        seconds,
+        milliseconds,
+        microseconds,
+        nanoseconds;
+    f64 average_frames_per_tick,
+        average_ticks_per_frame;
+    u16 average_frames_per_second,
+        average_milliseconds_per_frame,
+        average_microseconds_per_frame,
+        average_nanoseconds_per_frame;
+} Timer;
 
-void mergeString(String *string, char* first, char* second, u32 offset) {
-    copyToString(string, first, 0);
-    copyToString(string, second, offset);
-}
+typedef struct Timers {
+    Timer update, render, aux;
+} Timers;
 
-void printNumberIntoString(i32 number, NumberString *number_string) {
-    initNumberString(number_string);
-    char *buffer = number_string->_buffer;
-    buffer[12] = 0;
+typedef struct Time {
+    Timers timers;
+    Ticks ticks;
+    GetTicks getTicks;
+} Time;
 
-    bool is_negative = number < 0;
-    if (is_negative) number = -number;
+typedef struct ProfileScope {
+    char *name, text[PROFILER__TEXT_LENGTH];
+    u64 ticks, history[PROFILER__FRAME_HISTORY];
+    f32 min_microseconds,
+        max_microseconds,
+        average_microseconds;
+    u32 parent, depth, calls, history_count, history_index;
+} ProfileScope;
+
+typedef struct ProfileEvent {
+    u64 ticks_before, ticks_after;
+    u32 scope;
+} ProfileEvent;
+
+typedef struct Profiler {
+    ProfileScope scopes[PROFILER__MAX_SCOPES];
+    ProfileEvent events[PROFILER__MAX_EVENTS];
+    ProfileEvent stack[PROFILER__MAX_DEPTH];
+    GetTicks getTicks;
+    Ticks *ticks;
+    u64 frame_count, event_count;
+    u32 scope_count, depth;
+    bool paused;
+} Profiler;
 
-    if (number) {
-        u32 temp;
-        buffer += 11;
-        number_string->string.char_ptr = buffer;
-        number_string->string.length = 0;
+typedef struct Curve {
+    f32 thickness;
+    u32 revolution_count;
 
-        for (u8 i = 0; i < 11; i++) {
-            temp = number;
-            number /= 10;
-            number_string->string.length++;
-            *buffer-- = (char)('0' + temp - number * 10);
-            if (!number) {
-                if (is_negative) {
-                    *buffer = '-';
-                    number_string->string.char_ptr--;
-                    number_string->string.length++;
-                }
+    // The object-space polyline of the curve, cached by drawCurve for the parameters it was generated with,
+    // along with the viewport that it was last sized for (see drawCurve):
+    vec3 *points;
+    u32 point_count, points_capacity, points_revolution_count;
+    f32 points_thickness;
+    u8 points_primitive_type;
+    struct Viewport *points_viewport;
+} Curve;
 
-                break;
-            }
-            number_string->string.char_ptr--;
-        }
-    } else {
-        buffer[11] = '0';
-        number_string->string.length = 1;
-        number_string->string.char_ptr = buffer + 11;
-    }
-}
+typedef enum BoxSide {
+    NoSide = 0,
+    Top    = 1,
+    Bottom = 2,
+    Left   = 4,
+    Right  = 8,
+    Front  = 16,
+    Back   = 32
+} BoxSide;
 
-void printFloatIntoString(f32 number, NumberString *number_string, u8 float_digits_count) {
-    f32 factor = 1;
-    for (u8 i = 0; i < float_digits_count; i++) factor *= 10;
-    i32 int_num = (i32)(number * factor);
-    if (int_num == 0) {
-        printNumberIntoString((i32)factor, number_string);
-        number_string->string.length++;
-        number_string->string.char_ptr[0] = '.';
-        number_string->string.char_ptr--;
-        number_string->string.char_ptr[0] = '0';
-        return;
-    }
+typedef struct BoxCorners {
+    vec3 front_top_left,
+         front_top_right,
+         front_bottom_left,
+         front_bottom_right,
+         back_top_left,
+         back_top_right,
+         back_bottom_left,
+         back_bottom_right;
+} BoxCorners;
 
-    bool is_negative = number < 0;
-    bool is_fraction = is_negative ? number > -1 : number < 1;
+typedef union BoxVertices {
+    BoxCorners corners;
+    vec3 buffer[BOX__VERTEX_COUNT];
+} BoxVertices;
 
-    printNumberIntoString(int_num, number_string);
+typedef struct BoxEdgeSides {
+    Edge front_top,
+         front_bottom,
+         front_left,
+         front_right,
+         back_top,
+         back_bottom,
+         back_left,
+         back_right,
+         left_bottom,
+         left_top,
+         right_bottom,
+         right_top;
+} BoxEdgeSides;
 
-    if (is_fraction) {
-        u32 len = number_string->string.length;
-        number_string->string.length++;
-        number_string->string.char_ptr--;
-        if (is_negative) {
-            number_string->string.char_ptr[0] = '-';
-            number_string->string.char_ptr[1] = '0';
-        } else {
-            number_string->string.char_ptr[0] = '0';
-        }
-        if (len < float_digits_count) {
-            for (u32 i = 0; i < (float_digits_count - len); i++) {
-                number_string->string.length++;
-                number_string->string.char_ptr--;
-                number_string->string.char_ptr[0] = '0';
-            }
-        }
-    }
+typedef union BoxEdges {
+    BoxEdgeSides sides;
+    Edge buffer[BOX__EDGE_COUNT];
+} BoxEdges;
 
-    static char tmp[13];
-    tmp[number_string->string.length + 1] = 0;
-    for (u8 i = 0; i < (u8)number_string->string.length; i++) {
-        u8 char_count_from_right_to_left = (u8)number_string->string.length - i - 1;
-        if (char_count_from_right_to_left >= float_digits_count) tmp[i] = number_string->string.char_ptr[i];
-        else                                                     tmp[i + 1] = number_string->string.char_ptr[i];
-    }
-    tmp[number_string->string.length - float_digits_count] = '.';
-    copyToString(&number_string->string, tmp, 0);
-    if (is_negative) number_string->string.length++;
-}
+typedef struct Box {
+    BoxVertices vertices;
+    BoxEdges edges;
+} Box;
 
+typedef struct GridUVEdges {
+    Edge u[GRID__MAX_SEGMENTS];
+    Edge v[GRID__MAX_SEGMENTS];
+} GridUVEdges;
 
+typedef union GridEdges {
+    GridUVEdges uv;
+    Edge buffer[2][GRID__MAX_SEGMENTS];
+} GridEdges;
 
-#define FONT_WIDTH 18
-#define FONT_HEIGHT 24
-#define LINE_HEIGHT 30
-#define FIRST_CHARACTER_CODE 32
-#define LAST_CHARACTER_CODE 126
-
-// Header File for SSD1306 characters
-// Generated with TTF2BMH
-// Font JetBrains Mono Regular
-// Font Size: 24
-u8 bitmap_32[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_33[] = {0,0,0,0,0,0,62,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0};
-u8 bitmap_34[] = {0,0,0,0,254,254,0,0,0,254,254,254,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_35[] = {0,0,192,192,192,252,254,192,192,192,192,252,254,192,192,0,0,0,0,96,96,240,255,111,96,96,96,240,255,111,96,96,0,0,0,0,0,0,12,15,1,0,0,0,12,15,1,0,0,0,0,0,0,0};
-u8 bitmap_36[] = {0,0,112,248,252,14,6,255,255,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,6,255,255,12,28,248,240,192,0,0,0,0,0,0,3,7,14,12,12,255,255,12,12,15,7,1,0,0,0,0};
-u8 bitmap_37[] = {0,252,206,2,2,6,252,120,0,0,0,128,192,64,96,0,0,0,0,192,97,49,17,25,13,4,246,59,9,9,24,240,224,0,0,0,0,0,0,0,0,0,0,0,7,14,8,8,12,7,3,0,0,0};
-u8 bitmap_38[] = {0,0,0,252,252,142,6,6,6,14,28,24,0,0,0,0,0,0,0,248,252,254,3,3,15,28,120,240,224,248,60,12,4,0,0,0,0,1,7,7,14,12,12,14,6,7,1,7,14,12,8,0,0,0};
-u8 bitmap_39[] = {0,0,0,0,0,0,126,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_40[] = {0,0,0,0,0,240,252,62,7,3,1,1,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,7,15,28,56,112,96,96,0,0,0,0,0};
-u8 bitmap_41[] = {0,0,0,0,1,1,3,15,254,248,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,96,112,48,56,30,15,3,0,0,0,0,0,0,0,0};
-u8 bitmap_42[] = {0,0,0,0,0,0,0,240,240,0,0,0,0,0,0,0,0,0,0,3,3,131,198,246,124,15,61,118,230,199,131,3,2,0,0,0,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,0,0,0};
-u8 bitmap_43[] = {0,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,0,0,0,0,24,24,24,24,24,255,255,24,24,24,24,24,0,0,0,0,0,0,0,0,0,0,0,3,3,0,0,0,0,0,0,0,0,0};
-u8 bitmap_44[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,15,1,0,0,0,0,0,0,0,0};
-u8 bitmap_45[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,6,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_46[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,7,0,0,0,0,0,0,0,0};
-u8 bitmap_47[] = {0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,96,120,127,15,1,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_48[] = {0,0,240,248,60,14,6,134,134,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,31,63,63,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_49[] = {0,0,0,56,24,28,14,254,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,15,12,12,12,12,0,0,0,0};
-u8 bitmap_50[] = {0,0,56,60,28,14,6,6,6,14,28,252,248,0,0,0,0,0,0,0,0,0,128,192,224,112,48,28,15,7,3,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_51[] = {0,0,6,6,6,6,134,198,102,54,62,30,14,0,0,0,0,0,0,0,128,128,0,3,3,3,3,7,14,254,252,96,0,0,0,0,0,0,1,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_52[] = {0,0,0,0,0,128,192,240,120,30,14,2,0,0,0,0,0,0,0,0,240,252,254,199,195,192,192,192,192,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_53[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,7,7,7,6,3,3,3,3,7,254,252,240,0,0,0,0,0,0,1,7,7,14,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_54[] = {0,0,0,0,128,224,240,60,30,6,2,0,0,0,0,0,0,0,0,0,248,254,15,5,2,3,3,3,7,254,252,240,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_55[] = {0,0,62,62,6,6,6,6,6,6,230,254,126,14,0,0,0,0,0,0,0,0,0,0,128,224,252,63,15,1,0,0,0,0,0,0,0,0,0,0,8,14,15,7,1,0,0,0,0,0,0,0,0,0};
-u8 bitmap_56[] = {0,0,112,248,252,14,6,6,6,14,12,252,248,0,0,0,0,0,0,0,240,249,29,15,6,6,6,7,15,253,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_57[] = {0,0,240,248,28,14,6,6,6,6,12,252,248,224,0,0,0,0,0,0,3,7,15,14,12,140,204,244,126,31,7,1,0,0,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,0,0,0,0};
-u8 bitmap_58[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,6,0,0,0,0,0,0,0,0};
-u8 bitmap_59[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,7,1,0,0,0,0,0,0,0,0};
-u8 bitmap_60[] = {0,0,0,0,0,128,128,192,192,224,96,112,48,0,0,0,0,0,0,0,14,15,27,27,49,49,96,96,192,192,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0};
-u8 bitmap_61[] = {0,0,192,192,192,192,192,192,192,192,192,192,192,192,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_62[] = {0,0,48,112,96,96,192,192,128,128,0,0,0,0,0,0,0,0,0,0,128,192,192,224,96,112,49,57,27,27,14,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_63[] = {0,0,0,0,6,6,6,6,6,12,252,248,224,0,0,0,0,0,0,0,0,0,0,124,124,124,12,14,7,3,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0,0};
-u8 bitmap_64[] = {0,192,240,120,28,14,6,6,134,134,142,12,252,248,192,0,0,0,0,255,255,0,0,0,252,255,7,1,1,3,253,255,255,0,0,0,0,15,63,120,224,192,193,131,135,134,6,2,1,7,7,0,0,0};
-u8 bitmap_65[] = {0,0,0,0,128,240,254,14,62,254,224,0,0,0,0,0,0,0,0,0,128,248,255,127,97,96,96,99,127,254,224,0,0,0,0,0,0,8,15,15,1,0,0,0,0,0,0,3,15,15,0,0,0,0};
-u8 bitmap_66[] = {0,0,254,254,254,6,6,6,6,14,14,252,248,32,0,0,0,0,0,0,255,255,255,6,6,6,6,6,15,253,249,240,0,0,0,0,0,0,15,15,15,12,12,12,12,12,14,7,3,1,0,0,0,0};
-u8 bitmap_67[] = {0,0,224,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_68[] = {0,0,254,254,254,6,6,6,6,14,28,252,248,192,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,15,15,15,12,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_69[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_70[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_71[] = {0,0,240,248,60,14,6,6,6,14,14,60,56,32,0,0,0,0,0,0,255,255,128,0,0,12,12,12,12,252,252,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_72[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_73[] = {0,0,6,6,6,6,6,254,254,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0,0};
-u8 bitmap_74[] = {0,0,0,6,6,6,6,6,6,6,6,254,254,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,1,0,0,0,0,0};
-u8 bitmap_75[] = {0,0,254,254,254,0,0,0,128,224,240,124,30,6,2,0,0,0,0,0,255,255,255,6,6,6,31,127,248,224,128,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,1,7,15,14,8,0,0,0};
-u8 bitmap_76[] = {0,0,0,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_77[] = {0,0,254,254,14,248,192,0,0,224,124,230,254,254,0,0,0,0,0,0,255,255,0,0,7,14,15,3,0,255,255,255,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,15,15,15,0,0,0,0};
-u8 bitmap_78[] = {0,0,254,254,14,124,240,128,0,0,0,254,254,0,0,0,0,0,0,0,255,255,0,0,3,15,126,240,128,255,255,0,0,0,0,0,0,0,15,15,0,0,0,0,0,3,15,15,15,0,0,0,0,0};
-u8 bitmap_79[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_80[] = {0,0,254,254,254,6,6,6,6,6,14,28,252,248,0,0,0,0,0,0,255,255,255,12,12,12,12,12,14,7,7,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_81[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,62,254,231,131,0,0,0,0,0};
-u8 bitmap_82[] = {0,0,254,254,254,6,6,6,6,6,14,188,248,240,0,0,0,0,0,0,255,255,255,12,12,12,28,252,254,199,3,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,3,15,15,12,0,0,0,0};
-u8 bitmap_83[] = {0,0,96,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,7,6,14,12,28,248,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,12,14,7,3,1,0,0,0,0};
-u8 bitmap_84[] = {0,6,6,6,6,6,6,254,254,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
-u8 bitmap_85[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_86[] = {0,2,62,254,224,0,0,0,0,0,128,248,254,30,0,0,0,0,0,0,0,3,63,254,224,0,128,248,255,15,0,0,0,0,0,0,0,0,0,0,0,3,15,14,15,15,0,0,0,0,0,0,0,0};
-u8 bitmap_87[] = {0,254,254,0,0,0,252,62,254,224,0,0,240,254,62,0,0,0,0,3,255,255,0,252,63,0,1,255,224,0,255,255,0,0,0,0,0,0,15,15,8,15,0,0,0,3,15,15,15,0,0,0,0,0};
-u8 bitmap_88[] = {0,2,6,30,124,240,192,0,128,224,248,62,14,2,0,0,0,0,0,0,0,0,192,241,127,31,63,249,224,192,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,1,7,15,12,8,0,0,0};
-u8 bitmap_89[] = {0,6,30,124,240,192,0,0,0,128,224,248,62,14,2,0,0,0,0,0,0,0,1,7,31,252,252,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
-u8 bitmap_90[] = {0,0,6,6,6,6,6,6,134,230,246,62,14,0,0,0,0,0,0,0,0,0,192,240,124,30,7,1,0,0,0,0,0,0,0,0,0,0,14,15,15,12,12,12,12,12,12,12,12,0,0,0,0,0};
-u8 bitmap_91[] = {0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,63,48,48,48,48,0,0,0,0,0,0};
-u8 bitmap_92[] = {0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,126,112,64,0,0,0,0};
-u8 bitmap_93[] = {0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,48,48,48,48,63,63,0,0,0,0,0,0,0,0};
-u8 bitmap_94[] = {0,0,0,0,224,248,62,7,15,60,240,192,0,0,0,0,0,0,0,0,4,7,3,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_95[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0};
-u8 bitmap_96[] = {0,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_97[] = {0,0,0,192,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,225,241,57,24,24,24,24,24,24,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,6,3,15,15,0,0,0,0,0};
-u8 bitmap_98[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,15,15,15,6,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_99[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,131,131,130,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_100[] = {0,0,0,192,192,224,96,96,96,192,128,254,254,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,1,7,7,14,12,12,12,6,3,15,15,0,0,0,0,0};
-u8 bitmap_101[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,255,255,155,24,24,24,24,24,24,31,31,28,0,0,0,0,0,0,1,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_102[] = {0,0,128,128,128,128,252,254,142,134,134,134,134,134,0,0,0,0,0,0,1,1,1,1,255,255,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_103[] = {0,0,0,192,192,224,96,96,96,192,128,224,224,0,0,0,0,0,0,0,255,255,129,0,0,0,0,0,129,255,255,0,0,0,0,0,0,0,0,3,135,135,134,134,134,194,225,255,127,0,0,0,0,0};
-u8 bitmap_104[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_105[] = {0,0,0,96,96,96,98,103,231,231,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0};
-u8 bitmap_106[] = {0,0,0,96,96,96,96,96,103,231,231,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,128,128,128,128,128,192,224,127,63,0,0,0,0,0,0,0};
-u8 bitmap_107[] = {0,0,254,254,254,0,0,0,0,0,128,192,224,96,32,0,0,0,0,0,255,255,255,48,48,48,124,254,199,3,0,0,0,0,0,0,0,0,15,15,15,0,0,0,0,1,3,7,14,12,8,0,0,0};
-u8 bitmap_108[] = {0,6,6,6,6,6,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,7,14,12,12,12,12,12,0,0,0,0};
-u8 bitmap_109[] = {0,0,224,224,64,96,224,192,0,192,96,224,224,192,0,0,0,0,0,0,255,255,0,0,0,255,255,0,0,0,255,255,0,0,0,0,0,0,15,15,0,0,0,15,15,0,0,0,15,15,0,0,0,0};
-u8 bitmap_110[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
-u8 bitmap_111[] = {0,0,0,128,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
-u8 bitmap_112[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,255,255,255,6,12,12,12,14,14,7,3,0,0,0,0,0};
-u8 bitmap_113[] = {0,0,0,128,192,224,96,96,96,192,128,224,224,224,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,6,2,255,255,255,0,0,0,0};
-u8 bitmap_114[] = {0,0,0,224,224,128,192,96,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,1,0,0,0,0,0,1,7,7,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_115[] = {0,0,0,192,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,3,15,31,24,24,24,56,48,48,241,225,0,0,0,0,0,0,0,3,7,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
-u8 bitmap_116[] = {0,0,96,96,96,96,254,254,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,7,14,12,12,12,12,0,0,0,0,0};
-u8 bitmap_117[] = {0,0,224,224,224,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
-u8 bitmap_118[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,63,252,224,0,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,1,15,15,15,7,0,0,0,0,0,0,0,0};
-u8 bitmap_119[] = {0,224,224,0,0,0,192,224,224,0,0,0,128,224,96,0,0,0,0,3,255,252,0,224,255,1,15,254,0,128,255,127,0,0,0,0,0,0,3,15,8,15,0,0,0,7,15,15,15,0,0,0,0,0};
-u8 bitmap_120[] = {0,0,32,224,224,128,0,0,0,0,192,224,96,32,0,0,0,0,0,0,0,0,129,199,255,124,126,239,195,1,0,0,0,0,0,0,0,8,12,14,7,3,0,0,0,1,3,15,14,8,0,0,0,0};
-u8 bitmap_121[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,31,254,240,128,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,128,243,255,63,7,0,0,0,0,0,0,0,0};
-u8 bitmap_122[] = {0,0,96,96,96,96,96,96,96,96,96,224,224,0,0,0,0,0,0,0,0,0,192,224,112,56,28,14,7,3,1,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
-u8 bitmap_123[] = {0,0,0,0,0,0,0,135,255,255,0,0,0,0,0,0,0,0,0,0,3,3,3,3,3,7,253,248,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,31,31,56,48,48,0,0,0,0,0};
-u8 bitmap_124[] = {0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,127,127,0,0,0,0,0,0,0,0,0};
-u8 bitmap_125[] = {0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,252,255,7,3,3,3,3,0,0,0,0,0,0,0,48,48,48,56,31,15,0,0,0,0,0,0,0,0,0,0};
-u8 bitmap_126[] = {0,0,0,128,128,128,128,0,0,0,0,0,128,128,0,0,0,0,0,0,15,15,1,1,3,7,14,12,12,14,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,bitmap_38,bitmap_39,bitmap_40,bitmap_41,bitmap_42,bitmap_43,bitmap_44,bitmap_45,bitmap_46,bitmap_47,bitmap_48,bitmap_49,bitmap_50,bitmap_51,bitmap_52,bitmap_53,bitmap_54,bitmap_55,bitmap_56,bitmap_57,bitmap_58,bitmap_59,bitmap_60,bitmap_61,bitmap_62,bitmap_63,bitmap_64,bitmap_65,bitmap_66,bitmap_67,bitmap_68,bitmap_69,bitmap_70,bitmap_71,bitmap_72,bitmap_73,bitmap_74,bitmap_75,bitmap_76,bitmap_77,bitmap_78,bitmap_79,bitmap_80,bitmap_81,bitmap_82,bitmap_83,bitmap_84,bitmap_85,bitmap_86,bitmap_87,bitmap_88,bitmap_89,bitmap_90,bitmap_91,bitmap_92,bitmap_93,bitmap_94,bitmap_95,bitmap_96,bitmap_97,bitmap_98,bitmap_99,bitmap_100,bitmap_101,bitmap_102,bitmap_103,bitmap_104,bitmap_105,bitmap_106,bitmap_107,bitmap_108,bitmap_109,bitmap_110,bitmap_111,bitmap_112,bitmap_113,bitmap_114,bitmap_115,bitmap_116,bitmap_117,bitmap_118,bitmap_119,bitmap_120,bitmap_121,bitmap_122,bitmap_123,bitmap_124,bitmap_125,bitmap_126};
-
-
-
-typedef struct KeyMap      { u8 ctrl, alt, shift, space, tab; } KeyMap;
-typedef struct IsPressed { bool ctrl, alt, shift, space, tab; } IsPressed;
-typedef struct Controls {
-    IsPressed is_pressed;
-    KeyMap key_map;
-    Mouse mouse;
-} Controls;
-
-typedef u64 (*GetTicks)();
-
-typedef struct PerTick {
-    f64 seconds, milliseconds, microseconds, nanoseconds;
-} PerTick;
-
-typedef struct Ticks {
-    PerTick per_tick;
-    u64 per_second;
-} Ticks;
-
-typedef struct Timer {
-    GetTicks getTicks;
-    Ticks *ticks;
-    f32 delta_time;
-    u64 ticks_before,
-            ticks_after,
-            ticks_diff,
-            accumulated_ticks,
-            accumulated_frame_count,
-            ticks_of_last_report,
-            seconds,
-            milliseconds,
-            microseconds,
-            nanoseconds;
-    f64 average_frames_per_tick,
-            average_ticks_per_frame;
-    u16 average_frames_per_second,
-            average_milliseconds_per_frame,
-            average_microseconds_per_frame,
-            average_nanoseconds_per_frame;
-} Timer;
-
-typedef struct Timers {
-    Timer update, render, aux;
-} Timers;
-
-typedef struct Time {
-    Timers timers;
-    Ticks ticks;
-    GetTicks getTicks;
-} Time;
-
-typedef struct Curve {
-    f32 thickness;
-    u32 revolution_count;
-} Curve;
-
-typedef enum BoxSide {
-    NoSide = 0,
-    Top    = 1,
-    Bottom = 2,
-    Left   = 4,
-    Right  = 8,
-    Front  = 16,
-    Back   = 32
-} BoxSide;
-
-typedef struct BoxCorners {
-    vec3 front_top_left,
-            front_top_right,
-            front_bottom_left,
-            front_bottom_right,
-            back_top_left,
-            back_top_right,
-            back_bottom_left,
-            back_bottom_right;
-} BoxCorners;
-
-typedef union BoxVertices {
-    BoxCorners corners;
-    vec3 buffer[BOX__VERTEX_COUNT];
-} BoxVertices;
-
-typedef struct BoxEdgeSides {
-    Edge front_top,
-            front_bottom,
-            front_left,
-            front_right,
-            back_top,
-            back_bottom,
-            back_left,
-            back_right,
-            left_bottom,
-            left_top,
-            right_bottom,
-            right_top;
-} BoxEdgeSides;
-
-typedef union BoxEdges {
-    BoxEdgeSides sides;
-    Edge buffer[BOX__EDGE_COUNT];
-} BoxEdges;
-
-typedef struct Box {
-    BoxVertices vertices;
-    BoxEdges edges;
-} Box;
-
-typedef struct GridUVEdges {
-    Edge u[GRID__MAX_SEGMENTS];
-    Edge v[GRID__MAX_SEGMENTS];
-} GridUVEdges;
-
-typedef union GridEdges {
-    GridUVEdges uv;
-    Edge buffer[2][GRID__MAX_SEGMENTS];
-} GridEdges;
-
-typedef struct GridSideVertices {
-    vec3 from[GRID__MAX_SEGMENTS];
-    vec3 to[  GRID__MAX_SEGMENTS];
-} GridSideVertices;
+typedef struct GridSideVertices {
+    vec3 from[GRID__MAX_SEGMENTS];
+    vec3 to[  GRID__MAX_SEGMENTS];
+} GridSideVertices;
 
 typedef struct GridUVVertices {
     GridSideVertices u, v;
@@ -923,7 +843,7 @@ typedef struct Grid {
     GridEdges edges;
     GridVertices vertices;
     u8 u_segments,
-            v_segments;
+       v_segments;
 } Grid;
 
 enum PrimitiveType {
@@ -936,7 +856,10 @@ enum PrimitiveType {
     PrimitiveType_Tetrahedron
 };
 
+// The world matrix (and it's inverse) are cached, and are recomputed only when the primitive is flagged as IS_DIRTY
+// Whatever changes the position, rotation or scale of a primitive should flag it as such (see updatePrimitiveMatrices).
 typedef struct Primitive {
+    mat3x4 world_matrix, world_matrix_inverted;
     quat rotation;
     vec3 position, scale;
     u32 id;
@@ -945,19 +868,20 @@ typedef struct Primitive {
     u8 flags, material_id;
 } Primitive;
 
+// The rotation quaternions are derived from the rotation matrix lazily, only once they are asked for after a rotation
+// (see getXform3Rotation and getXform3InvertedRotation in scene/xform.h), as tracked by the dirty bits.
 typedef struct xform3 {
-    mat3 matrix,
-            yaw_matrix,
-            pitch_matrix,
-            roll_matrix,
-            rotation_matrix,
-            rotation_matrix_inverted;
+    mat3 yaw_matrix,
+         pitch_matrix,
+         roll_matrix,
+         rotation_matrix;
     quat rotation,
-            rotation_inverted;
+         rotation_inverted;
     vec3 position, scale,
-            *up_direction,
-            *right_direction,
-            *forward_direction;
+         *up_direction,
+         *right_direction,
+         *forward_direction;
+    u8 dirty;
 } xform3;
 
 typedef struct Camera {
@@ -994,17 +918,42 @@ typedef struct ProjectionPlane {
     vec3 start, right, down;
 } ProjectionPlane;
 
-
 typedef struct ViewportSettings {
     Pixel background;
     f32 near_clipping_plane_distance,
-            far_clipping_plane_distance;
+        far_clipping_plane_distance,
+        curve_tolerance;
     u32 hud_line_count;
     HUDLine *hud_lines;
+    HUDRun *hud_runs;
     enum ColorID hud_default_color;
-    bool show_hud, use_cube_NDC, flip_z, antialias;
+    u32 target_microseconds_per_frame; // When set, the internal resolution is scaled down to hold this frame time
+    f32 min_resolution_scale;
+    bool show_hud, use_cube_NDC, flip_z, antialias,
+         dynamic_antialias; // Whether antialiasing can be switched off (and back on) as part of the frame time budget
 } ViewportSettings;
 
+typedef struct RasterizerStats {
+    u64 edges,
+        culled_edges,
+        clipped_edges,
+        lines,
+        pixels,
+        blended_pixels,
+        overwritten_pixels,
+        curve_segments,
+        saved_curve_segments;
+} RasterizerStats;
+
+// The viewport can render at a lower internal resolution than its size in the window (see viewport/viewport.h),
+// with its dimensions being the internal ones and its size in the window kept here.
+typedef struct ViewportScaling {
+    u16 width, height;
+    f32 scale, frame_time;
+    u8 settle_frames;
+    bool dropped_antialias;
+} ViewportScaling;
+
 typedef struct Viewport {
     ViewportSettings settings;
     Dimensions dimensions;
@@ -1016,6 +965,17 @@ typedef struct Viewport {
     mat4 projection_matrix;
     Camera *camera;
     PixelQuad *pixels;
+    RasterizerStats stats;
+
+    // Pixels are only drawn into the rows [band_top, band_bottom) of the viewport (all of them when both are 0).
+    // This lets horizontal bands of the same viewport be drawn from separate threads (see scene/parallel.h).
+    i32 band_top, band_bottom;
+
+    // Set while curves have already been tessellated for this frame (see prepareSceneForDrawing in scene/parallel.h),
+    // so that drawing from multiple threads does not regenerate the points of curves that are shared between them.
+    bool has_prepared_curves;
+
+    ViewportScaling scaling;
 } Viewport;
 
 typedef struct Ray {
@@ -1035,124 +995,83 @@ typedef struct EdgeVertexIndices { u32 from, to; } EdgeVertexIndices;
 typedef union TriangleVertexIndices { u32 ids[3]; struct { u32 v1, v2, v3; }; } TriangleVertexIndices;
 typedef struct Mesh {
     AABB aabb;
-    u32 triangle_count, vertex_count, edge_count, normals_count, uvs_count;
     vec3 *vertex_positions, *vertex_normals;
     vec2 *vertex_uvs;
     TriangleVertexIndices *vertex_position_indices;
     TriangleVertexIndices *vertex_normal_indices;
     TriangleVertexIndices *vertex_uvs_indices;
     EdgeVertexIndices     *edge_vertex_indices;
-} Mesh;
+    u32 triangle_count, vertex_count, edge_count, normals_count, uvs_count;
 
-#define CUBE__UV_COUNT 4
-#define CUBE__NORMAL_COUNT 6
-#define CUBE__VERTEX_COUNT 8
-#define CUBE__TRIANGLE_COUNT 12
+    // The counts that the mesh's arrays have room for (0 for arrays that are not the mesh's own to write into), which
+    // loading a scene file into the mesh is checked against (as its counts may shrink to those of a smaller record):
+    u32 triangle_capacity, vertex_capacity, edge_capacity, normals_capacity, uvs_capacity;
 
-static const vec3 CUBE__VERTEX_POSITIONS[CUBE__VERTEX_COUNT] = {
-        {-1, -1, -1},
-        {1, -1, -1},
-        {1, 1, -1},
-        {-1, 1, -1},
-        {-1, -1, 1},
-        {1, -1, 1},
-        {1, 1, 1},
-        {-1, 1, 1}
-};
+    // Set while the mesh is being loaded in the background, when only its bounds are valid (see isMeshLoaded):
+    volatile u32 is_loading;
+} Mesh;
 
-static const TriangleVertexIndices CUBE__VERTEX_POSITION_INDICES[CUBE__TRIANGLE_COUNT] = {
-        {0, 1, 2},
-        {1, 5, 6},
-        {5, 4, 7},
-        {4, 0, 3},
-        {3, 2, 6},
-        {1, 0, 4},
-        {0, 2, 3},
-        {1, 6, 2},
-        {5, 7, 6},
-        {4, 3, 7},
-        {3, 6, 7},
-        {1, 4, 5}
-};
+// A mesh that is read from its file in the background, into arrays that were allocated for it up front
+// (or that is mapped from its file up front, having its mapped arrays paged in in the background):
+typedef struct MeshLoad {
+    Mesh *mesh;
+    Mesh loaded;
+    char *file_path;
+    bool is_mapped;
+} MeshLoad;
+
+// Loads meshes on a background thread, counting the meshes that were loaded (see scene/io.h):
+typedef struct MeshLoader {
+    MeshLoad *loads;
+    struct Platform *platform;
+    u32 count, drawn_count;
+    volatile u32 loaded_count;
+} MeshLoader;
+
+// The records of a scene's objects as they were last saved to (or loaded from) its file, along with their counts,
+// so that only the records that changed since are appended to the file's journal (see saveSceneChangesToFile).
+// The entry is where the next journal entry is composed.
+typedef struct SceneJournal {
+    char *file_path;
+    u8 *records, *entry;
+    u64 entry_capacity;
+    u32 counts[SCENE_FILE__SECTION_TYPES];
+    u32 entry_count;
+} SceneJournal;
+
+// Handles stay valid across removals of other objects, and go stale once their own object is removed
+// (its slot's generation is odd while it is in use, and is bumped whenever it is allocated or freed).
+typedef struct ObjectHandle {
+    u32 index, generation;
+} ObjectHandle;
+
+typedef struct ObjectPool {
+    u32 *generations, *next_free;
+    u32 capacity, count, first_free;
+} ObjectPool;
 
-static const vec3 CUBE__VERTEX_NORMALS[CUBE__NORMAL_COUNT] = {
-        {0, 0, -1},
-        {1, 0, 0},
-        {0, 0, 1},
-        {-1, 0, 0},
-        {0, 1, 0},
-        {0, -1, 0}
-};
-static const TriangleVertexIndices CUBE__VERTEX_NORMAL_INDICES[CUBE__TRIANGLE_COUNT] = {
-        {0, 0, 0},
-        {1, 1, 1},
-        {2, 2, 2},
-        {3, 3, 3},
-        {4, 4, 4},
-        {5, 5, 5},
-        {0, 0, 0},
-        {1, 1, 1},
-        {2, 2, 2},
-        {3, 3, 3},
-        {4, 4, 4},
-        {5, 5, 5}
-};
-
-static const vec2 CUBE__VERTEX_UVS[CUBE__UV_COUNT] = {
-        {0, 0},
-        {0, 1},
-        {1, 1},
-        {1, 0},
-};
-static const TriangleVertexIndices CUBE__VERTEX_UV_INDICES[CUBE__TRIANGLE_COUNT] = {
-        {0, 1, 2},
-        {0, 1, 2},
-        {0, 1, 2},
-        {0, 1, 2},
-        {0, 1, 2},
-        {0, 1, 2},
-        {0, 2, 3},
-        {0, 2, 3},
-        {0, 2, 3},
-        {0, 2, 3},
-        {0, 2, 3},
-        {0, 2, 3}
-};
-
-void setMeshToCube(Mesh *mesh) {
-    mesh->triangle_count = CUBE__TRIANGLE_COUNT;
-    mesh->vertex_count   = CUBE__VERTEX_COUNT;
-    mesh->normals_count  = CUBE__NORMAL_COUNT;
-    mesh->uvs_count      = CUBE__UV_COUNT;
-
-    mesh->vertex_uvs       = (vec2*)CUBE__VERTEX_UVS;
-    mesh->vertex_normals   = (vec3*)CUBE__VERTEX_NORMALS;
-    mesh->vertex_positions = (vec3*)CUBE__VERTEX_POSITIONS;
-
-    mesh->vertex_uvs_indices      = (TriangleVertexIndices*)CUBE__VERTEX_UV_INDICES;
-    mesh->vertex_normal_indices   = (TriangleVertexIndices*)CUBE__VERTEX_NORMAL_INDICES;
-    mesh->vertex_position_indices = (TriangleVertexIndices*)CUBE__VERTEX_POSITION_INDICES;
-}
-typedef struct Selection {
-    quat object_rotation;
-    vec3 transformation_plane_origin,
-            transformation_plane_normal,
-            transformation_plane_center,
-            object_scale,
-            world_offset,
-            *world_position;
-    Box box;
-    Ray ray, local_ray;
-    RayHit hit, local_hit;
-    Primitive *primitive;
-    enum BoxSide box_side;
-    f32 object_distance;
-    u32 object_type, object_id;
-    bool changed;
-} Selection;
+typedef struct Selection {
+    quat object_rotation;
+    vec3 transformation_plane_origin,
+         transformation_plane_normal,
+         transformation_plane_center,
+         object_scale,
+         world_offset,
+         *world_position;
+    Box box;
+    Ray ray, local_ray;
+    RayHit hit, local_hit;
+    Primitive *primitive;
+    ObjectHandle primitive_handle;
+    enum BoxSide box_side;
+    f32 object_distance;
+    u32 object_type, object_id;
+    bool changed;
+} Selection;
 
 typedef struct SceneSettings {
     u32 cameras, primitives, meshes, curves, boxes, grids;
+    u32 max_primitives, max_meshes, max_curves, max_boxes, max_grids;
     String file, *mesh_files;
 } SceneSettings;
 
@@ -1165,10 +1084,40 @@ typedef struct Scene {
     Curve *curves;
     Grid *grids;
     Box *boxes;
+    ObjectPool primitive_pool, mesh_pool, curve_pool, box_pool, grid_pool;
+    MeshLoader mesh_loader;
+    SceneJournal journal;
     u64 last_io_ticks;
     bool last_io_is_save;
 } Scene;
 
+// A copy of the state that the app's update changes (the primitives, the cameras, the selection, the viewport and the
+// controls) to be rendered while the next state is being updated. The rest of the scene is shared (see core/simulation.h),
+// as are the lines of the viewport's HUD.
+typedef struct SceneSnapshot {
+    Scene scene;
+    Viewport viewport;
+    Controls controls;
+    Selection selection;
+    Primitive *primitives;
+    Camera *cameras;
+    u64 step, number; // The update step that the snapshot is of, and the number of snapshots published (including it)
+    bool is_being_rendered;
+} SceneSnapshot;
+
+// Updating the app at a fixed time step, with rendering consuming double-buffered snapshots of the scene:
+typedef struct Simulation {
+    SceneSnapshot snapshots[2];
+    u64 step,
+        published_count,
+        rendered_count,
+        ticks_per_step,
+        accumulated_ticks,
+        last_ticks;
+    u32 latest;
+    u16 steps_per_second;
+} Simulation;
+
 typedef struct AppCallbacks {
     void (*sceneReady)(Scene *scene);
     void (*viewportReady)(Viewport *viewport);
@@ -1182,26 +1131,165 @@ typedef struct AppCallbacks {
     void (*mousePositionSet)(i32 x, i32 y);
     void (*mouseMovementSet)(i32 x, i32 y);
     void (*mouseRawMovementSet)(i32 x, i32 y);
+
+    // Setting both has the app update at a fixed time step and render separately (instead of on windowRedraw).
+    // They run on separate threads, sharing the parts of the scene and viewport that are not copied into snapshots:
+    // Notably, the HUD is only to be set from render (see core/simulation.h).
+    void (*update)(f32 delta_time);
+    void (*render)(SceneSnapshot *snapshot);
 } AppCallbacks;
 
 typedef void* (*CallbackForFileOpen)(const char* file_path);
 typedef bool  (*CallbackForFileRW)(void *out, unsigned long, void *handle);
 typedef void  (*CallbackForFileClose)(void *handle);
+typedef void* (*CallbackForFileMap)(const char* file_path, u64 *size);
+typedef void  (*CallbackForFileUnmap)(void *data, u64 size);
+typedef void  (*CallbackForParallelWork)(void *data, u32 index);
+typedef void  (*CallbackForParallelRun)(CallbackForParallelWork work, void *data, u32 count);
+typedef void  (*CallbackForSceneDrawing)(Scene *scene, Viewport *viewport);
+typedef void  (*CallbackForThread)(void *data);
+typedef bool  (*CallbackForThreadStart)(CallbackForThread thread, void *data);
+typedef void  (*CallbackForThreadsJoin)();
+typedef void* (*CallbackForSemaphoreCreate)();
+typedef void  (*CallbackForSemaphoreSignal)(void *semaphore, u32 count);
+typedef void  (*CallbackForSemaphoreWait)(void *semaphore);
+typedef void  (*CallbackForThreadYield)();
+
+// Counts the jobs that were added against it and are yet to finish (see core/jobs.h).
+typedef struct JobCounter {
+    volatile i32 pending;
+} JobCounter;
+
+// Calls work(data, index) for every index in [first, end), then counts itself as finished on its counter.
+typedef struct Job {
+    CallbackForParallelWork work;
+    void *data;
+    JobCounter *counter;
+    u32 first, end;
+} Job;
+
+// A worker's jobs: The worker pushes and pops at the bottom, while other threads steal from the top.
+typedef struct JobDeque {
+    Job jobs[JOBS__DEQUE_CAPACITY];
+    volatile u32 top, bottom;
+    volatile i32 lock;
+} JobDeque;
+
+typedef struct JobSystem {
+    JobDeque deques[PARALLEL__MAX_THREADS];
+    void *semaphore;
+    CallbackForSemaphoreSignal signalSemaphore;
+    CallbackForSemaphoreWait waitForSemaphore;
+    CallbackForThreadYield yieldThread;
+    u32 thread_count;
+    volatile u32 is_stopping;
+} JobSystem;
+
+// Viewports that each draw the scene through their own camera into their own region of the frame buffer,
+// drawn concurrently and then resolved together into the window's content (see viewport/compositor.h).
+typedef struct Compositor {
+    Viewport *viewports[COMPOSITOR__MAX_VIEWPORTS];
+    u32 viewport_count;
+    Scene *scene;
+    CallbackForSceneDrawing drawScene;
+} Compositor;
 
 typedef struct Platform {
-    GetTicks             getTicks;
-    CallbackWithInt      getMemory;
-    CallbackWithCharPtr  setWindowTitle;
-    CallbackWithBool     setWindowCapture;
-    CallbackWithBool     setCursorVisibility;
-    CallbackForFileClose closeFile;
-    CallbackForFileOpen  openFileForReading;
-    CallbackForFileOpen  openFileForWriting;
-    CallbackForFileRW    readFromFile;
-    CallbackForFileRW    writeToFile;
+    GetTicks                getTicks;
+    CallbackWithInt         getMemory;
+    CallbackWithInt         reserveMemory;
+    CallbackForMemoryCommit commitMemory;
+    CallbackWithInt         getLargePageMemory;
+    CallbackWithCharPtr     setWindowTitle;
+    CallbackWithBool        setWindowCapture;
+    CallbackWithBool        setCursorVisibility;
+    CallbackForFileClose    closeFile;
+    CallbackForFileOpen     openFileForReading;
+    CallbackForFileOpen     openFileForWriting;
+    CallbackForFileOpen     openFileForAppending;
+    CallbackForFileRW       readFromFile;
+    CallbackForFileRW       writeToFile;
+
+    // Maps a whole file into memory as a private (copy-on-write) view of it, returning null when it could not.
+    // The view stays valid until it is unmapped, even once the file is closed.
+    CallbackForFileMap      mapFileForReading;
+    CallbackForFileUnmap    unmapFile;
+
+    // Threads for the job system (see core/jobs.h), that run until it is shut down, and a counting semaphore
+    // that the threads sleep on while there are no jobs (signalling it wakes up to the given number of them).
+    // Joining waits for all of the threads that were started to return (see shutDownJobSystem).
+    CallbackForThreadStart     startThread;
+    CallbackForThreadsJoin     joinThreads;
+    CallbackForThreadYield     yieldThread;
+    CallbackForSemaphoreCreate createSemaphore;
+    CallbackForSemaphoreSignal signalSemaphore;
+    CallbackForSemaphoreWait   waitForSemaphore;
+
+    // Calls work(data, index) for every index in [0, count) in parallel, returning once all calls have returned.
+    // The calls are run as jobs on the app's threads (see core/jobs.h), including the calling thread.
+    // thread_count is the number of hardware threads worth splitting work for (set by the platform).
+    CallbackForParallelRun  runInParallel;
+    u32 thread_count;
     u64 ticks_per_second;
 } Platform;
 
+// Scene files (see scene/io.h):
+enum SceneFileSectionType {
+    SceneFileSection_None = 0,
+    SceneFileSection_Cameras,
+    SceneFileSection_Primitives,
+    SceneFileSection_Meshes,
+    SceneFileSection_Curves,
+    SceneFileSection_Boxes,
+    SceneFileSection_Grids
+};
+
+// Followed by the table of contents (a SceneFileSection for each section of the file):
+typedef struct SceneFileHeader {
+    u32 magic, version, section_count, reserved;
+} SceneFileHeader;
+
+// A section of records, at the given offset from the start of the file:
+typedef struct SceneFileSection {
+    u32 type, count, record_size, reserved;
+    u64 offset, size;
+} SceneFileSection;
+
+// An embedded mesh, followed by its arrays (each at the given offset from the start of the file, or 0 if absent).
+// The size covers the record along with its arrays, so the next mesh's record starts right after them.
+typedef struct SceneFileMesh {
+    AABB aabb;
+    u32 vertex_count, triangle_count, edge_count, uvs_count, normals_count, reserved;
+    u64 size,
+        vertex_positions,
+        vertex_position_indices,
+        edge_vertex_indices,
+        vertex_uvs,
+        vertex_uvs_indices,
+        vertex_normals,
+        vertex_normal_indices;
+} SceneFileMesh;
+
+// An entry of a scene file's journal (appended after its sections), followed by the records that changed as of the entry.
+// Each record is preceded by a SceneFileJournalRecord, and the counts of objects are by section type (as of the entry).
+typedef struct SceneFileJournalEntry {
+    u32 magic, record_count;
+    u64 size;
+    u32 counts[SCENE_FILE__SECTION_TYPES], reserved;
+} SceneFileJournalEntry;
+
+typedef struct SceneFileJournalRecord {
+    u32 type, index;
+} SceneFileJournalRecord;
+
+// A scene file that is either in memory (accessed at any offset) or read/written through the platform's file (only forward):
+typedef struct SceneFile {
+    Platform *platform;
+    void *file;
+    u8 *data;
+    u64 size, offset;
+} SceneFile;
+
 typedef struct Settings {
     SceneSettings scene;
     ViewportSettings viewport;
@@ -1215,8 +1303,39 @@ typedef struct Defaults {
     Settings settings;
 } Defaults;
 
+enum InputEventType {
+    InputEvent_KeyDown,
+    InputEvent_KeyUp,
+    InputEvent_MouseButtonDown,
+    InputEvent_MouseButtonUp,
+    InputEvent_MouseButtonDoubleClicked,
+    InputEvent_MouseWheelScrolled,
+    InputEvent_MousePositionSet,
+    InputEvent_MouseMovementSet,
+    InputEvent_MouseRawMovementSet,
+    InputEvent_WindowResize,
+    InputEvent_EndOfRecording
+};
+
+typedef struct InputEvent {
+    u64 ticks;
+    u32 frame;
+    union {
+        struct { i32 x, y; };
+        struct { f32 amount, _; };
+    };
+    u8 type, code;
+} InputEvent;
+
+typedef struct InputRecording {
+    InputEvent next_event;
+    void *file;
+    u32 frame;
+    bool is_recording, is_replaying;
+} InputRecording;
+
 typedef struct App {
-    Memory memory;
+    Memory memory, frame_memory;
     Platform platform;
     Controls controls;
     u32 *window_content;
@@ -1224,11 +1343,17 @@ typedef struct App {
     Time time;
     Scene scene;
     Viewport viewport;
+    InputRecording input_recording;
+    Simulation simulation;
+
+    // Redrawing only when needed (see _isRedrawNeeded), and at most at the given frame rate (0 for no cap):
+    u16 max_frames_per_second;
+    bool render_on_demand, needs_redraw;
+
     bool is_running;
     void *user_data;
 } App;
 
-
 void setBoxEdgesFromVertices(BoxEdges *edges, BoxVertices *vertices) {
     edges->sides.front_top.from    = vertices->corners.front_top_left;
     edges->sides.front_top.to      = vertices->corners.front_top_right;
@@ -1265,7 +1390,31 @@ void setGridEdgesFromVertices(Edge *edges, u8 edge_count, vec3 *from, vec3 *to)
     }
 }
 
+INLINE bool isMeshLoaded(Mesh *mesh) {
+    return !ATOMIC_LOAD(&mesh->is_loading);
+}
+
+INLINE bool isViewportScaled(Viewport *viewport) {
+    return viewport->scaling.scale != 1;
+}
+
+// The size of the viewport in the window (its dimensions are those of its internal resolution when that is scaled):
+INLINE u16 getViewportWindowWidth( Viewport *viewport) { return isViewportScaled(viewport) ? viewport->scaling.width  : viewport->dimensions.width;  }
+INLINE u16 getViewportWindowHeight(Viewport *viewport) { return isViewportScaled(viewport) ? viewport->scaling.height : viewport->dimensions.height; }
+
+// Whether a row of the frame buffer (of sub-pixels when antialiasing) is in the viewport's band (see band_top):
+INLINE bool isRowInViewportBand(i32 y, Viewport *viewport) {
+    if (!viewport->band_bottom) return true;
+
+    i32 top    = viewport->position.y + viewport->band_top;
+    i32 bottom = viewport->position.y + viewport->band_bottom;
+    if (viewport->settings.antialias) { top <<= 1; bottom <<= 1; }
+    return y >= top && y < bottom;
+}
+
 INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport *viewport) {
+    if (!isRowInViewportBand(y, viewport)) return;
+
     Pixel *pixel;
     PixelQuad *pixel_quad;
     if (viewport->settings.antialias) {
@@ -1276,6 +1425,8 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
         pixel = &pixel_quad->TL;
     }
 
+    COUNT_RASTERIZER_STAT(viewport, pixels);
+
     Pixel new_pixel;
     new_pixel.opacity = opacity;
     new_pixel.color = color;
@@ -1292,6 +1443,7 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
             foreground = new_pixel;
         }
         if (foreground.opacity != 1) {
+            COUNT_RASTERIZER_STAT(viewport, blended_pixels);
             f32 one_minus_foreground_opacity = 1.0f - foreground.opacity;
             opacity = foreground.opacity + background.opacity * one_minus_foreground_opacity;
             f32 one_over_opacity = opacity ? 1.0f / opacity : 1;
@@ -1303,214 +1455,489 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
             pixel->color.b = fast_mul_add(foreground.color.b, foreground_factor, background.color.b * background_factor);
             pixel->opacity = opacity;
             pixel->depth   = foreground.depth;
-        } else *pixel = foreground;
-    } else *pixel = new_pixel;
+        } else {
+            COUNT_RASTERIZER_STAT(viewport, overwritten_pixels);
+            *pixel = foreground;
+        }
+    } else {
+        COUNT_RASTERIZER_STAT(viewport, overwritten_pixels);
+        *pixel = new_pixel;
+    }
 
     if (!viewport->settings.antialias) pixel_quad->BR = pixel_quad->BL = pixel_quad->TR = pixel_quad->TL;
 }
 
 
+// Scoped instrumentation is compiled in only when SLIM_ENGINE_PROFILER is defined (before including SlimEngine).
+// Scopes nest, so a scope opened while another one is open is recorded as it's child:
+//
+//    PROFILE_BEGIN("drawScene");
+//        ...
+//    PROFILE_END();
+//
+// Or for a block:
+//
+//    PROFILE_SCOPE("drawScene") {
+//        ...
+//    }
+//
+// Note: Returning out of an open scope (in either form) leaves it unbalanced.
+//
+// The profiler is not thread-safe: Scopes are ignored while it is paused, as it is while work runs on multiple threads.
+// Scopes are also ignored on a thread that sets profiler_ignores_this_thread, like the update thread of an app that
+// renders on another thread (see core/simulation.h), so that only the rendering thread is profiled.
+#ifdef SLIM_ENGINE_PROFILER
+#define PROFILE_BEGIN(name) beginProfileScope((char*)(name))
+#define PROFILE_END() endProfileScope()
+#define PROFILE_SCOPE(name) for (bool _profile_scope_open_ = beginProfileScope((char*)(name)); _profile_scope_open_; _profile_scope_open_ = endProfileScope())
+#else
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#define PROFILE_SCOPE(name)
+#endif
 
-void drawText(char *str, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
-    if (x < 0 || x > viewport->dimensions.width  - FONT_WIDTH ||
-        y < 0 || y > viewport->dimensions.height - FONT_HEIGHT)
-        return;
-
-    color.r *= color.r;
-    color.g *= color.g;
-    color.b *= color.b;
-    bool AA = viewport->settings.antialias;
-    u16 current_x = (u16)x;
-    u16 current_y = (u16)y;
-    u16 pixel_x, sub_pixel_x;
-    u16 pixel_y, sub_pixel_y;
-    u16 t_offset;
-    u8* byte;
-    char character = *str;
-    while (character) {
-        if (character == '\n') {
-            if (current_y + FONT_HEIGHT > viewport->dimensions.height)
-                break;
-
-            current_x = (u16)x;
-            current_y += LINE_HEIGHT;
-        } else if (character == '\t') {
-            t_offset = FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
-            current_x += t_offset;
-        } else if (character >= FIRST_CHARACTER_CODE &&
-                   character <= LAST_CHARACTER_CODE) {
-            byte = char_addr[character - FIRST_CHARACTER_CODE];
-            for (int i = 1; i < 4; i++) {
-                pixel_x = current_x;
-                pixel_y = current_y + i * FONT_HEIGHT / 3;
-                for (int w = 0; w < FONT_WIDTH ; w++) {
-                    for (int h = 0; h < FONT_HEIGHT/3; h++) {
-                        /* skip background bits */
-                        if (*byte & (0x80  >> h)) {
-                            if (AA) {
-                                sub_pixel_x = pixel_x << 1;
-                                sub_pixel_y = pixel_y << 1;
-                                setPixel(sub_pixel_x + 0, sub_pixel_y + 0, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 1, sub_pixel_y + 0, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 0, sub_pixel_y + 1, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 1, sub_pixel_y + 1, 0, color, opacity, viewport);
-                            } else
-                                setPixel(pixel_x, pixel_y, 0, color, opacity, viewport);
-                        }
+Profiler profiler;
+THREAD_LOCAL bool profiler_ignores_this_thread = false;
 
-                        pixel_y--;
-                    }
-                    byte++;
-                    pixel_y += FONT_HEIGHT / 3;
-                    pixel_x++;
-                }
-            }
-            current_x += FONT_WIDTH;
-            if (current_x + FONT_WIDTH > viewport->dimensions.width)
-                return;
-        }
-        character = *++str;
-    }
+void initProfiler(GetTicks getTicks, Ticks *ticks) {
+    profiler.getTicks = getTicks;
+    profiler.ticks = ticks;
+    profiler.frame_count = 0;
+    profiler.event_count = 0;
+    profiler.scope_count = 0;
+    profiler.depth = 0;
+    profiler.paused = false;
 }
 
-void drawNumber(i32 number, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
-    static NumberString number_string;
-    printNumberIntoString(number, &number_string);
-    drawText(number_string.string.char_ptr, x - number_string.string.length * FONT_WIDTH, y, color, opacity, viewport);
+INLINE bool isSameProfileScopeName(char *a, char *b) {
+    if (a == b) return true;
+    while (*a && *a == *b) { a++; b++; }
+    return *a == *b;
 }
 
+u32 getProfileScope(char *name, u32 parent) {
+    ProfileScope *scope = profiler.scopes;
+    for (u32 i = 0; i < profiler.scope_count; i++, scope++)
+        if (scope->parent == parent && isSameProfileScopeName(scope->name, name))
+            return i;
 
+    if (profiler.scope_count == PROFILER__MAX_SCOPES)
+        return PROFILER__NO_SCOPE;
 
-void accumulateTimer(Timer* timer) {
-    timer->ticks_diff = timer->ticks_after - timer->ticks_before;
-    timer->accumulated_ticks += timer->ticks_diff;
-    timer->accumulated_frame_count++;
-
-    timer->seconds      = (u64)(timer->ticks->per_tick.seconds      * (f64)(timer->ticks_diff));
-    timer->milliseconds = (u64)(timer->ticks->per_tick.milliseconds * (f64)(timer->ticks_diff));
-    timer->microseconds = (u64)(timer->ticks->per_tick.microseconds * (f64)(timer->ticks_diff));
-    timer->nanoseconds  = (u64)(timer->ticks->per_tick.nanoseconds  * (f64)(timer->ticks_diff));
-}
+    scope->name = name;
+    scope->parent = parent;
+    scope->depth = parent == PROFILER__NO_SCOPE ? 0 : profiler.scopes[parent].depth + 1;
+    scope->text[0] = 0;
+    scope->ticks = 0;
+    scope->calls = 0;
+    scope->history_count = 0;
+    scope->history_index = 0;
+    scope->min_microseconds = 0;
+    scope->max_microseconds = 0;
+    scope->average_microseconds = 0;
 
-void averageTimer(Timer *timer) {
-    timer->average_frames_per_tick = (f64)timer->accumulated_frame_count / (f64)timer->accumulated_ticks;
-    timer->average_ticks_per_frame = (f64)timer->accumulated_ticks / (f64)timer->accumulated_frame_count;
-    timer->average_frames_per_second = (u16)(timer->average_frames_per_tick      * (f64)timer->ticks->per_second);
-    timer->average_milliseconds_per_frame = (u16)(timer->average_ticks_per_frame * timer->ticks->per_tick.milliseconds);
-    timer->average_microseconds_per_frame = (u16)(timer->average_ticks_per_frame * timer->ticks->per_tick.microseconds);
-    timer->average_nanoseconds_per_frame = (u16)(timer->average_ticks_per_frame  * timer->ticks->per_tick.nanoseconds);
-    timer->accumulated_ticks = timer->accumulated_frame_count = 0;
+    return profiler.scope_count++;
 }
 
-INLINE void beginFrameTimer(Timer *timer) {
-    timer->ticks_after = timer->ticks_before;
-    timer->ticks_before = timer->getTicks();
-    timer->ticks_diff = timer->ticks_before - timer->ticks_after;
-    timer->delta_time = (f32)((f64)timer->ticks_diff * timer->ticks->per_tick.seconds);
-}
+bool beginProfileScope(char *name) {
+    if (profiler.paused || profiler_ignores_this_thread) return true;
 
-INLINE void endFrameTimer(Timer *timer) {
-    timer->ticks_after = timer->getTicks();
-    accumulateTimer(timer);
-    if (timer->accumulated_ticks >= timer->ticks->per_second / 4)
-        averageTimer(timer);
-}
+    if (profiler.getTicks && profiler.depth < PROFILER__MAX_DEPTH) {
+        ProfileEvent *open_scope = profiler.stack + profiler.depth;
+        open_scope->scope = getProfileScope(name, profiler.depth ? profiler.stack[profiler.depth - 1].scope : PROFILER__NO_SCOPE);
+        open_scope->ticks_before = profiler.getTicks();
+    }
+    profiler.depth++;
 
-void beginFrame(Timer *timer) {
-    beginFrameTimer(timer);
+    return true;
 }
 
-void endFrame(Timer *timer, Mouse *mouse) {
-    resetMouseChanges(mouse);
-    endFrameTimer(timer);
-}
+bool endProfileScope() {
+    if (profiler.paused || profiler_ignores_this_thread || !profiler.depth) return false;
+    profiler.depth--;
+    if (!profiler.getTicks || profiler.depth >= PROFILER__MAX_DEPTH) return false;
 
+    ProfileEvent *event = profiler.events + (profiler.event_count++ % PROFILER__MAX_EVENTS);
+    *event = profiler.stack[profiler.depth];
+    event->ticks_after = profiler.getTicks();
+    if (event->scope != PROFILER__NO_SCOPE) {
+        ProfileScope *scope = profiler.scopes + event->scope;
+        scope->ticks += event->ticks_after - event->ticks_before;
+        scope->calls++;
+    }
 
+    return false;
+}
 
-void initMouse(Mouse *mouse) {
-    mouse->is_captured = false;
+void endProfileFrame() {
+    if (!profiler.ticks) return;
 
-    mouse->moved = false;
-    mouse->move_handled = false;
+    f64 microseconds_per_tick = profiler.ticks->per_tick.microseconds;
+    ProfileScope *scope = profiler.scopes;
+    for (u32 i = 0; i < profiler.scope_count; i++, scope++) {
+        if (!scope->calls) continue;
 
-    mouse->double_clicked = false;
-    mouse->double_clicked_handled = false;
+        scope->history[scope->history_index++] = scope->ticks;
+        if (scope->history_index == PROFILER__FRAME_HISTORY) scope->history_index = 0;
+        if (scope->history_count < PROFILER__FRAME_HISTORY) scope->history_count++;
+        scope->ticks = 0;
+        scope->calls = 0;
 
-    mouse->wheel_scrolled = false;
-    mouse->wheel_scroll_amount = 0;
-    mouse->wheel_scroll_handled = false;
+        u64 min_ticks = scope->history[0];
+        u64 max_ticks = scope->history[0];
+        u64 total_ticks = 0;
+        for (u32 h = 0; h < scope->history_count; h++) {
+            if (scope->history[h] < min_ticks) min_ticks = scope->history[h];
+            if (scope->history[h] > max_ticks) max_ticks = scope->history[h];
+            total_ticks += scope->history[h];
+        }
+        scope->min_microseconds     = (f32)(microseconds_per_tick * (f64)min_ticks);
+        scope->max_microseconds     = (f32)(microseconds_per_tick * (f64)max_ticks);
+        scope->average_microseconds = (f32)(microseconds_per_tick * (f64)total_ticks / (f64)scope->history_count);
+    }
 
-    mouse->pos.x = 0;
-    mouse->pos.y = 0;
-    mouse->pos_raw_diff.x = 0;
-    mouse->pos_raw_diff.y = 0;
-    mouse->raw_movement_handled = false;
+    profiler.frame_count++;
+}
 
-    mouse->middle_button.is_pressed = false;
-    mouse->middle_button.is_handled = false;
-    mouse->middle_button.up_pos.x = 0;
-    mouse->middle_button.down_pos.x = 0;
+u32 writeTextToBuffer(char *text, char *buffer) {
+    u32 length = 0;
+    while (text[length]) {
+        buffer[length] = text[length];
+        length++;
+    }
+    return length;
+}
 
-    mouse->right_button.is_pressed = false;
-    mouse->right_button.is_handled = false;
-    mouse->right_button.up_pos.x = 0;
-    mouse->right_button.down_pos.x = 0;
+u32 writeNumberToBuffer(u64 number, char *buffer) {
+    char digits[20];
+    u32 digit_count = 0;
+    do {
+        digits[digit_count++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    for (u32 i = 0; i < digit_count; i++)
+        buffer[i] = digits[digit_count - 1 - i];
+
+    return digit_count;
+}
+
+void setProfileScopeText(ProfileScope *scope) {
+    char *text = scope->text;
+    u32 name_length = 0;
+    while (scope->name[name_length]) name_length++;
+
+    // The indentation and name share what the timings leave of the text (deep scopes are indented no further):
+    u32 max_length = PROFILER__TEXT_LENGTH - 36;
+    u32 indentation = scope->depth * 2;
+    if (indentation > max_length) indentation = max_length;
+    if (name_length + indentation > max_length)
+        name_length = max_length - indentation;
+
+    for (u32 i = 0; i < indentation; i++) *text++ = ' ';
+    for (u32 i = 0; i < name_length; i++) *text++ = scope->name[i];
+    *text++ = ':';
+    *text++ = ' ';
+    text += writeNumberToBuffer((u64)scope->min_microseconds, text);
+    *text++ = '/';
+    text += writeNumberToBuffer((u64)scope->average_microseconds, text);
+    *text++ = '/';
+    text += writeNumberToBuffer((u64)scope->max_microseconds, text);
+    text += writeTextToBuffer((char*)"us", text);
+    *text = 0;
+}
+
+void setProfilerInHUD(HUD *hud, u32 first_line) {
+    HUDLine *line = hud->lines + first_line;
+    for (u32 i = first_line; i < hud->line_count; i++, line++) {
+        line->value.string.char_ptr = (char*)"";
+        line->value.string.length = 0;
+        if (i - first_line < profiler.scope_count) {
+            ProfileScope *scope = profiler.scopes + (i - first_line);
+            setProfileScopeText(scope);
+            line->title.char_ptr = scope->text;
+            line->title.length = 0;
+            while (scope->text[line->title.length]) line->title.length++;
+        } else {
+            line->title.char_ptr = (char*)"";
+            line->title.length = 0;
+        }
+    }
+}
 
-    mouse->left_button.is_pressed = false;
-    mouse->left_button.is_handled = false;
-    mouse->left_button.up_pos.x = 0;
-    mouse->left_button.down_pos.x = 0;
+void writeProfileTicksAsMicroseconds(u64 ticks, char *buffer, u32 *length) {
+    u64 nanoseconds = (u64)((f64)ticks * profiler.ticks->per_tick.nanoseconds);
+    u64 fraction = nanoseconds % 1000;
+    *length += writeNumberToBuffer(nanoseconds / 1000, buffer + *length);
+    buffer[(*length)++] = '.';
+    buffer[(*length)++] = (char)('0' + fraction / 100);
+    buffer[(*length)++] = (char)('0' + (fraction / 10) % 10);
+    buffer[(*length)++] = (char)('0' + fraction % 10);
 }
 
-void initTimer(Timer *timer, GetTicks getTicks, Ticks *ticks) {
-    timer->getTicks = getTicks;
-    timer->ticks    = ticks;
+// Makes room for the given number of characters in the trace's buffer, by writing the buffer to the file if it has to:
+bool _makeRoomInProfilerTrace(char *buffer, u32 *length, u32 capacity, u32 room, void *file, Platform *platform) {
+    if (*length + room <= capacity) return true;
 
-    timer->delta_time = 0;
-    timer->ticks_before = 0;
-    timer->ticks_after = 0;
-    timer->ticks_diff = 0;
+    bool written = platform->writeToFile(buffer, *length, file);
+    *length = 0;
+    return written;
+}
 
-    timer->accumulated_ticks = 0;
-    timer->accumulated_frame_count = 0;
+// Writes the recorded events (up to the last PROFILER__MAX_EVENTS of them) in the Chrome trace-event format.
+// The file can be opened in chrome://tracing or https://ui.perfetto.dev for offline analysis.
+bool saveProfilerTraceToFile(char *file_path, Platform *platform) {
+    if (!profiler.ticks) return false;
 
-    timer->ticks_of_last_report = 0;
+    void *file = platform->openFileForWriting(file_path);
+    if (!file) return false;
+
+    char buffer[1024];
+    u32 length = writeTextToBuffer((char*)"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", buffer);
+    bool written = true;
+
+    u64 event_count = profiler.event_count < PROFILER__MAX_EVENTS ? profiler.event_count : PROFILER__MAX_EVENTS;
+    u64 first_event = profiler.event_count - event_count;
+    u64 first_ticks = event_count ? profiler.events[first_event % PROFILER__MAX_EVENTS].ticks_before : 0;
+    for (u64 i = first_event; i < profiler.event_count; i++) {
+        ProfileEvent *event = profiler.events + (i % PROFILER__MAX_EVENTS);
+        if (event->scope != PROFILER__NO_SCOPE) {
+            if (event->ticks_before < first_ticks) first_ticks = event->ticks_before;
+        }
+    }
 
-    timer->seconds = 0;
-    timer->milliseconds = 0;
-    timer->microseconds = 0;
-    timer->nanoseconds = 0;
+    bool has_events = false;
+    for (u64 i = first_event; i < profiler.event_count && written; i++) {
+        ProfileEvent *event = profiler.events + (i % PROFILER__MAX_EVENTS);
+        if (event->scope == PROFILER__NO_SCOPE) continue;
+
+        // Separate events from the ones before them (skipped events leave no separators behind):
+        written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), PROFILER__TRACE_EVENT_ROOM, file, platform);
+        if (!written) break;
+        if (has_events) buffer[length++] = ',';
+        has_events = true;
+        length += writeTextToBuffer((char*)"{\"name\":\"", buffer + length);
+
+        // The name is escaped as a JSON string, making room for each of its characters (so it can be of any length):
+        for (char *character = profiler.scopes[event->scope].name; *character && written; character++) {
+            written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), 6, file, platform);
+            u8 code = (u8)*character;
+            if (code < 0x20) {
+                length += writeTextToBuffer((char*)"\\u00", buffer + length);
+                buffer[length++] = "0123456789abcdef"[code >> 4];
+                buffer[length++] = "0123456789abcdef"[code & 15];
+            } else {
+                if (code == '"' || code == '\\') buffer[length++] = '\\';
+                buffer[length++] = *character;
+            }
+        }
+        if (written) written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), PROFILER__TRACE_EVENT_ROOM, file, platform);
+        if (!written) break;
+
+        length += writeTextToBuffer((char*)"\",\"cat\":\"SlimEngine\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":", buffer + length);
+        writeProfileTicksAsMicroseconds(event->ticks_before - first_ticks, buffer, &length);
+        length += writeTextToBuffer((char*)",\"dur\":", buffer + length);
+        writeProfileTicksAsMicroseconds(event->ticks_after - event->ticks_before, buffer, &length);
+        buffer[length++] = '}';
+    }
+    if (written) written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), 4, file, platform);
+    length += writeTextToBuffer((char*)"]}\n", buffer + length);
+    if (written) written = platform->writeToFile(buffer, length, file);
 
-    timer->average_frames_per_tick = 0;
-    timer->average_ticks_per_frame = 0;
-    timer->average_frames_per_second = 0;
-    timer->average_milliseconds_per_frame = 0;
-    timer->average_microseconds_per_frame = 0;
-    timer->average_nanoseconds_per_frame = 0;
+    platform->closeFile(file);
+    return written;
 }
 
-void initTime(Time *time, GetTicks getTicks, u64 ticks_per_second) {
-    time->getTicks = getTicks;
-    time->ticks.per_second = ticks_per_second;
 
-    time->ticks.per_tick.seconds      = 1          / (f64)(time->ticks.per_second);
-    time->ticks.per_tick.milliseconds = 1000       / (f64)(time->ticks.per_second);
-    time->ticks.per_tick.microseconds = 1000000    / (f64)(time->ticks.per_second);
-    time->ticks.per_tick.nanoseconds  = 1000000000 / (f64)(time->ticks.per_second);
+#define CUBE__UV_COUNT 4
+#define CUBE__NORMAL_COUNT 6
+#define CUBE__VERTEX_COUNT 8
+#define CUBE__TRIANGLE_COUNT 12
 
-    initTimer(&time->timers.update, getTicks, &time->ticks);
-    initTimer(&time->timers.render, getTicks, &time->ticks);
-    initTimer(&time->timers.aux,    getTicks, &time->ticks);
+static const vec3 CUBE__VERTEX_POSITIONS[CUBE__VERTEX_COUNT] = {
+    {-1, -1, -1},
+    {1, -1, -1},
+    {1, 1, -1},
+    {-1, 1, -1},
+    {-1, -1, 1},
+    {1, -1, 1},
+    {1, 1, 1},
+    {-1, 1, 1}
+};
 
-    time->timers.update.ticks_before = time->timers.update.ticks_of_last_report = getTicks();
-}
+static const TriangleVertexIndices CUBE__VERTEX_POSITION_INDICES[CUBE__TRIANGLE_COUNT] = {
+        {0, 1, 2},
+        {1, 5, 6},
+        {5, 4, 7},
+        {4, 0, 3},
+        {3, 2, 6},
+        {1, 0, 4},
+        {0, 2, 3},
+        {1, 6, 2},
+        {5, 7, 6},
+        {4, 3, 7},
+        {3, 6, 7},
+        {1, 4, 5}
+};
 
-void initXform3(xform3 *xform) {
-    mat3 I;
-    I.X.x = 1; I.Y.x = 0; I.Z.x = 0;
-    I.X.y = 0; I.Y.y = 1; I.Z.y = 0;
+static const vec3 CUBE__VERTEX_NORMALS[CUBE__NORMAL_COUNT] = {
+        {0, 0, -1},
+        {1, 0, 0},
+        {0, 0, 1},
+        {-1, 0, 0},
+        {0, 1, 0},
+        {0, -1, 0}
+};
+static const TriangleVertexIndices CUBE__VERTEX_NORMAL_INDICES[CUBE__TRIANGLE_COUNT] = {
+        {0, 0, 0},
+        {1, 1, 1},
+        {2, 2, 2},
+        {3, 3, 3},
+        {4, 4, 4},
+        {5, 5, 5},
+        {0, 0, 0},
+        {1, 1, 1},
+        {2, 2, 2},
+        {3, 3, 3},
+        {4, 4, 4},
+        {5, 5, 5}
+};
+
+static const vec2 CUBE__VERTEX_UVS[CUBE__UV_COUNT] = {
+        {0, 0},
+        {0, 1},
+        {1, 1},
+        {1, 0},
+};
+static const TriangleVertexIndices CUBE__VERTEX_UV_INDICES[CUBE__TRIANGLE_COUNT] = {
+        {0, 1, 2},
+        {0, 1, 2},
+        {0, 1, 2},
+        {0, 1, 2},
+        {0, 1, 2},
+        {0, 1, 2},
+        {0, 2, 3},
+        {0, 2, 3},
+        {0, 2, 3},
+        {0, 2, 3},
+        {0, 2, 3},
+        {0, 2, 3}
+};
+
+void setMeshToCube(Mesh *mesh) {
+    mesh->triangle_count = CUBE__TRIANGLE_COUNT;
+    mesh->vertex_count   = CUBE__VERTEX_COUNT;
+    mesh->normals_count  = CUBE__NORMAL_COUNT;
+    mesh->uvs_count      = CUBE__UV_COUNT;
+
+    // The cube's arrays are constant, so nothing is to be loaded into them:
+    mesh->triangle_capacity = mesh->vertex_capacity = mesh->edge_capacity = mesh->normals_capacity = mesh->uvs_capacity = 0;
+
+    mesh->vertex_uvs       = (vec2*)CUBE__VERTEX_UVS;
+    mesh->vertex_normals   = (vec3*)CUBE__VERTEX_NORMALS;
+    mesh->vertex_positions = (vec3*)CUBE__VERTEX_POSITIONS;
+
+    mesh->vertex_uvs_indices      = (TriangleVertexIndices*)CUBE__VERTEX_UV_INDICES;
+    mesh->vertex_normal_indices   = (TriangleVertexIndices*)CUBE__VERTEX_NORMAL_INDICES;
+    mesh->vertex_position_indices = (TriangleVertexIndices*)CUBE__VERTEX_POSITION_INDICES;
+    mesh->is_loading = false;
+}
+
+
+void initNumberString(NumberString *number_string) {
+    number_string->string.char_ptr = number_string->_buffer;
+    number_string->string.length = 1;
+    number_string->_buffer[12] = 0;
+    for (u8 i = 0; i < 12; i++)
+        number_string->_buffer[i] = ' ';
+}
+
+void initMouse(Mouse *mouse) {
+    mouse->is_captured = false;
+
+    mouse->moved = false;
+    mouse->move_handled = false;
+
+    mouse->double_clicked = false;
+    mouse->double_clicked_handled = false;
+
+    mouse->wheel_scrolled = false;
+    mouse->wheel_scroll_amount = 0;
+    mouse->wheel_scroll_handled = false;
+
+    mouse->pos.x = 0;
+    mouse->pos.y = 0;
+    mouse->pos_raw_diff.x = 0;
+    mouse->pos_raw_diff.y = 0;
+    mouse->raw_movement_handled = false;
+
+    mouse->middle_button.is_pressed = false;
+    mouse->middle_button.is_handled = false;
+    mouse->middle_button.up_pos.x = 0;
+    mouse->middle_button.down_pos.x = 0;
+
+    mouse->right_button.is_pressed = false;
+    mouse->right_button.is_handled = false;
+    mouse->right_button.up_pos.x = 0;
+    mouse->right_button.down_pos.x = 0;
+
+    mouse->left_button.is_pressed = false;
+    mouse->left_button.is_handled = false;
+    mouse->left_button.up_pos.x = 0;
+    mouse->left_button.down_pos.x = 0;
+}
+
+void initTimer(Timer *timer, GetTicks getTicks, Ticks *ticks) {
+    timer->getTicks = getTicks;
+    timer->ticks    = ticks;
+
+    timer->delta_time = 0;
+    timer->ticks_before = 0;
+    timer->ticks_after = 0;
+    timer->ticks_diff = 0;
+
+    timer->accumulated_ticks = 0;
+    timer->accumulated_frame_count = 0;
+
+    timer->ticks_of_last_report = 0;
+
+    timer->seconds = 0;
+    timer->milliseconds = 0;
+    timer->microseconds = 0;
+    timer->nanoseconds = 0;
+
+    timer->average_frames_per_tick = 0;
+    timer->average_ticks_per_frame = 0;
+    timer->average_frames_per_second = 0;
+    timer->average_milliseconds_per_frame = 0;
+    timer->average_microseconds_per_frame = 0;
+    timer->average_nanoseconds_per_frame = 0;
+}
+
+void initTime(Time *time, GetTicks getTicks, u64 ticks_per_second) {
+    time->getTicks = getTicks;
+    time->ticks.per_second = ticks_per_second;
+
+    time->ticks.per_tick.seconds      = 1          / (f64)(time->ticks.per_second);
+    time->ticks.per_tick.milliseconds = 1000       / (f64)(time->ticks.per_second);
+    time->ticks.per_tick.microseconds = 1000000    / (f64)(time->ticks.per_second);
+    time->ticks.per_tick.nanoseconds  = 1000000000 / (f64)(time->ticks.per_second);
+
+    initTimer(&time->timers.update, getTicks, &time->ticks);
+    initTimer(&time->timers.render, getTicks, &time->ticks);
+    initTimer(&time->timers.aux,    getTicks, &time->ticks);
+
+    time->timers.update.ticks_before = time->timers.update.ticks_of_last_report = getTicks();
+
+    initProfiler(getTicks, &time->ticks);
+}
+
+void initXform3(xform3 *xform) {
+    mat3 I;
+    I.X.x = 1; I.Y.x = 0; I.Z.x = 0;
+    I.X.y = 0; I.Y.y = 1; I.Z.y = 0;
     I.X.z = 0; I.Y.z = 0; I.Z.z = 1;
-    xform->matrix = xform->yaw_matrix = xform->pitch_matrix = xform->roll_matrix = xform->rotation_matrix = xform->rotation_matrix_inverted = I;
+    xform->yaw_matrix = xform->pitch_matrix = xform->roll_matrix = xform->rotation_matrix = I;
     xform->right_direction   = &xform->rotation_matrix.X;
     xform->up_direction      = &xform->rotation_matrix.Y;
     xform->forward_direction = &xform->rotation_matrix.Z;
@@ -1525,6 +1952,7 @@ void initXform3(xform3 *xform) {
     xform->rotation.axis.z = 0;
     xform->rotation.amount = 1;
     xform->rotation_inverted = xform->rotation;
+    xform->dirty = 0;
 }
 
 void initCamera(Camera* camera) {
@@ -1573,7 +2001,7 @@ void initBox(Box *box) {
     setBoxEdgesFromVertices(&box->edges, &box->vertices);
 }
 
-void initHUD(HUD *hud, HUDLine *lines, u32 line_count, f32 line_height, enum ColorID default_color, i32 position_x, i32 position_y) {
+void initHUD(HUD *hud, HUDLine *lines, HUDRun *runs, u32 line_count, f32 line_height, enum ColorID default_color, i32 position_x, i32 position_y) {
     hud->lines = lines;
     hud->line_count = line_count;
     hud->line_height = line_height;
@@ -1589,6 +2017,9 @@ void initHUD(HUD *hud, HUDLine *lines, u32 line_count, f32 line_height, enum Col
             initNumberString(&line->value);
             line->title.char_ptr = line->alternate_value.char_ptr = (char*)("");
             line->title.length = line->alternate_value.length = 0;
+            line->runs = runs ? runs + i * HUD__MAX_LINE_RUNS : null;
+            line->run_count = 0;
+            line->rendered_key = 0;
         }
     }
 }
@@ -1621,17 +2052,21 @@ void initNavigation(Navigation *navigation, NavigationSettings *navigation_setti
     navigation->turn.right = false;
     navigation->turn.left = false;
 }
-
 void setDefaultViewportSettings(ViewportSettings *settings) {
     settings->near_clipping_plane_distance = VIEWPORT_DEFAULT__NEAR_CLIPPING_PLANE_DISTANCE;
     settings->far_clipping_plane_distance  = VIEWPORT_DEFAULT__FAR_CLIPPING_PLANE_DISTANCE;
+    settings->curve_tolerance = VIEWPORT_DEFAULT__CURVE_TOLERANCE;
     settings->hud_default_color = White;
     settings->hud_line_count = 0;
     settings->hud_lines = null;
+    settings->hud_runs = null;
     settings->show_hud = false;
     settings->use_cube_NDC = false;
     settings->flip_z = false;
     settings->antialias = false;
+    settings->dynamic_antialias = false;
+    settings->target_microseconds_per_frame = 0;
+    settings->min_resolution_scale = VIEWPORT_DEFAULT__MIN_RESOLUTION_SCALE;
     settings->background.color = Color(Black);
     settings->background.opacity = 0;
     settings->background.depth = INFINITY;
@@ -1662,13 +2097,48 @@ void initViewport(Viewport *viewport, ViewportSettings *viewport_settings, Navig
     viewport->settings = *viewport_settings;
     viewport->position.x = 0;
     viewport->position.y = 0;
+    viewport->band_top = 0;
+    viewport->band_bottom = 0;
+    viewport->has_prepared_curves = false;
+    viewport->scaling.width  = MAX_WIDTH;
+    viewport->scaling.height = MAX_HEIGHT;
+    viewport->scaling.scale = 1;
+    viewport->scaling.frame_time = 0;
+    viewport->scaling.settle_frames = 0;
+    viewport->scaling.dropped_antialias = false;
     initBox(&viewport->default_box);
-    initHUD(&viewport->hud, viewport_settings->hud_lines, viewport_settings->hud_line_count, 1, viewport_settings->hud_default_color, 0, 0);
+    initHUD(&viewport->hud, viewport_settings->hud_lines, viewport_settings->hud_runs, viewport_settings->hud_line_count, 1, viewport_settings->hud_default_color, 0, 0);
     initNavigation(&viewport->navigation, navigation_settings);
     setProjectionMatrix(viewport);
     updateDimensions(&viewport->dimensions, MAX_WIDTH, MAX_HEIGHT, MAX_WIDTH);
 }
 
+// Sets the internal resolution of the viewport, relative to its size in the window:
+void setViewportResolutionScale(Viewport *viewport, f32 scale) {
+    if (scale > 1) scale = 1;
+    if (scale < VIEWPORT_SCALING__STEP) scale = VIEWPORT_SCALING__STEP;
+    viewport->scaling.scale = scale;
+
+    u16 width  = viewport->scaling.width;
+    u16 height = viewport->scaling.height;
+    if (scale != 1) {
+        width  = (u16)((f32)width  * scale + 0.5f);
+        height = (u16)((f32)height * scale + 0.5f);
+        if (!width)  width  = 1;
+        if (!height) height = 1;
+    }
+    updateDimensions(&viewport->dimensions, width, height, viewport->dimensions.stride);
+    setProjectionMatrix(viewport);
+}
+
+// Sets the size of the viewport in the window (with the stride of the frame buffer), keeping its resolution scale:
+void resizeViewport(Viewport *viewport, u16 width, u16 height, u16 stride) {
+    viewport->scaling.width  = width;
+    viewport->scaling.height = height;
+    viewport->dimensions.stride = stride;
+    setViewportResolutionScale(viewport, viewport->scaling.scale);
+}
+
 void setDefaultSceneSettings(SceneSettings *settings) {
     settings->cameras = 1;
     settings->primitives = 0;
@@ -1676,14 +2146,41 @@ void setDefaultSceneSettings(SceneSettings *settings) {
     settings->boxes = 0;
     settings->grids = 0;
     settings->meshes = 0;
+    settings->max_primitives = 0;
+    settings->max_meshes = 0;
+    settings->max_curves = 0;
+    settings->max_boxes = 0;
+    settings->max_grids = 0;
     settings->mesh_files = null;
     settings->file.char_ptr = null;
     settings->file.length = 0;
 }
 
+// Scene object pools can hold at least as many objects as the scene starts with:
+void setScenePoolCapacities(SceneSettings *settings) {
+    if (settings->max_primitives < settings->primitives) settings->max_primitives = settings->primitives;
+    if (settings->max_meshes     < settings->meshes)     settings->max_meshes     = settings->meshes;
+    if (settings->max_curves     < settings->curves)     settings->max_curves     = settings->curves;
+    if (settings->max_boxes      < settings->boxes)      settings->max_boxes      = settings->boxes;
+    if (settings->max_grids      < settings->grids)      settings->max_grids      = settings->grids;
+}
+
+void initMesh(Mesh *mesh) {
+    mesh->aabb.min.x = mesh->aabb.min.y = mesh->aabb.min.z = 0;
+    mesh->aabb.max.x = mesh->aabb.max.y = mesh->aabb.max.z = 0;
+    mesh->vertex_positions = mesh->vertex_normals = null;
+    mesh->vertex_uvs = null;
+    mesh->vertex_position_indices = mesh->vertex_normal_indices = mesh->vertex_uvs_indices = null;
+    mesh->edge_vertex_indices = null;
+    mesh->triangle_count = mesh->vertex_count = mesh->edge_count = mesh->normals_count = mesh->uvs_count = 0;
+    mesh->triangle_capacity = mesh->vertex_capacity = mesh->edge_capacity = mesh->normals_capacity = mesh->uvs_capacity = 0;
+    mesh->is_loading = false;
+}
 void initCurve(Curve *curve) {
     curve->thickness = 0.1f;
     curve->revolution_count = 1;
+    curve->point_count = 0;
+    curve->points_viewport = null;
 }
 
 void initPrimitive(Primitive *primitive) {
@@ -1733,338 +2230,210 @@ bool initGrid(Grid *grid, u8 u_segments, u8 v_segments) {
     return true;
 }
 
-INLINE bool isEqualVec2(vec2 a, vec2 b) {
-    return a.x == b.x && a.y == b.y;
+
+// Fixed-capacity pools of slots with a free list, for objects that are added and removed at runtime.
+// The pool only tracks which slots are in use - the objects themselves live in a separate array of the same
+// capacity that is allocated once up front, so adding and removing objects never reallocates or fragments memory.
+// Freed slots are reused (most recently freed first) before any slot that was never used.
+
+void initObjectPool(ObjectPool *pool, u32 capacity, u32 initial_count, Memory *memory) {
+    pool->capacity = pool->count = 0;
+    pool->first_free = POOL__INVALID_INDEX;
+    pool->generations = pool->next_free = null;
+    if (!capacity) return;
+
+    pool->generations = (u32*)allocateMemory(memory, sizeof(u32) * capacity);
+    pool->next_free   = (u32*)allocateMemory(memory, sizeof(u32) * capacity);
+    if (!pool->generations || !pool->next_free) return;
+
+    if (initial_count > capacity) initial_count = capacity;
+    pool->capacity = capacity;
+    pool->count = initial_count;
+    pool->first_free = initial_count == capacity ? POOL__INVALID_INDEX : initial_count;
+    for (u32 i = 0; i < capacity; i++) {
+        pool->generations[i] = i < initial_count ? 1 : 0;
+        pool->next_free[i] = i + 1 < capacity ? i + 1 : POOL__INVALID_INDEX;
+    }
 }
 
-INLINE vec2 clampVec2ToZero(vec2 v) {
+INLINE bool isPoolSlotActive(ObjectPool *pool, u32 index) {
+    return index < pool->capacity && pool->generations[index] & 1;
+}
+
+INLINE bool isValidObjectHandle(ObjectPool *pool, ObjectHandle handle) {
+    return isPoolSlotActive(pool, handle.index) && pool->generations[handle.index] == handle.generation;
+}
+
+INLINE ObjectHandle getObjectHandle(ObjectPool *pool, u32 index) {
+    ObjectHandle handle;
+    handle.index = isPoolSlotActive(pool, index) ? index : POOL__INVALID_INDEX;
+    handle.generation = handle.index == POOL__INVALID_INDEX ? 0 : pool->generations[index];
+    return handle;
+}
+
+// Returns a handle with an index of POOL__INVALID_INDEX when the pool is full.
+ObjectHandle allocatePoolSlot(ObjectPool *pool) {
+    ObjectHandle handle;
+    handle.index = pool->first_free;
+    handle.generation = 0;
+    if (handle.index == POOL__INVALID_INDEX) return handle;
+
+    pool->first_free = pool->next_free[handle.index];
+    pool->next_free[handle.index] = POOL__INVALID_INDEX;
+    handle.generation = ++pool->generations[handle.index];
+    pool->count++;
+
+    return handle;
+}
+
+bool freePoolSlot(ObjectPool *pool, ObjectHandle handle) {
+    if (!isValidObjectHandle(pool, handle)) return false;
+
+    pool->generations[handle.index]++;
+    pool->next_free[handle.index] = pool->first_free;
+    pool->first_free = handle.index;
+    pool->count--;
+
+    return true;
+}
+
+// Resets the pool to having its first slots in use (as when the objects in them were replaced, by loading a scene).
+// Every slot's generation is bumped, so handles from before the reset go stale even for slots that are still in use.
+void resetObjectPool(ObjectPool *pool, u32 count) {
+    if (!pool->capacity) return;
+    if (count > pool->capacity) count = pool->capacity;
+
+    pool->count = count;
+    pool->first_free = count == pool->capacity ? POOL__INVALID_INDEX : count;
+    for (u32 i = 0; i < pool->capacity; i++) {
+        pool->generations[i] = i < count ? (pool->generations[i] + 2) | 1 : (pool->generations[i] + 1) & ~1u;
+        pool->next_free[i] = i < count || i + 1 == pool->capacity ? POOL__INVALID_INDEX : i + 1;
+    }
+}
+
+
+INLINE bool isEqualVec3(vec3 a, vec3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+INLINE vec3 clampVec3ToZero(vec3 v) {
     v.x = v.x > 0.0f ? v.x : 0.0f;
     v.y = v.y > 0.0f ? v.y : 0.0f;
+    v.z = v.z > 0.0f ? v.z : 0.0f;
     return v;
 }
 
-INLINE vec2 clampVec2ToUpper(vec2 v, vec2 upper) {
+INLINE vec3 clampVec3ToUpper(vec3 v, vec3 upper) {
     v.x = v.x < upper.x ? v.x : upper.x;
     v.y = v.y < upper.y ? v.y : upper.y;
+    v.z = v.z < upper.z ? v.z : upper.z;
     return v;
 }
 
-INLINE vec2 clampVec2(vec2 v) {
+INLINE vec3 clampVec3(vec3 v) {
     v.x = v.x > 0.0f ? v.x : 0.0f;
     v.y = v.y > 0.0f ? v.y : 0.0f;
+    v.z = v.z > 0.0f ? v.z : 0.0f;
 
     v.x = v.x < 1.0f ? v.x : 1.0f;
     v.y = v.y < 1.0f ? v.y : 1.0f;
+    v.z = v.z < 1.0f ? v.z : 1.0f;
 
     return v;
 }
 
-INLINE vec2 clampVec2To(vec2 v, const f32 min_value, const f32 max_value) {
+INLINE vec3 clampVec3To(vec3 v, const f32 min_value, const f32 max_value) {
     v.x = v.x > min_value ? v.x : min_value;
     v.y = v.y > min_value ? v.y : min_value;
+    v.z = v.z > min_value ? v.z : min_value;
 
     v.x = v.x < max_value ? v.x : max_value;
     v.y = v.y < max_value ? v.y : max_value;
+    v.z = v.z < max_value ? v.z : max_value;
 
     return v;
 }
 
-INLINE vec2 getVec2Of(f32 value) {
-    vec2 out;
+INLINE vec3 getVec3Of(f32 value) {
+    vec3 out;
 
-    out.x = out.y = value;
+    out.x = out.y = out.z = value;
 
     return out;
 }
 
-INLINE vec2 invertedVec2(vec2 in) {
-    vec2 out;
+INLINE vec3 invertedVec3(vec3 in) {
+    vec3 out;
 
     out.x = -in.x;
     out.y = -in.y;
+    out.z = -in.z;
 
     return out;
 }
 
-INLINE vec2 oneOverVec2(vec2 v) {
-    vec2 out;
+INLINE vec3 oneOverVec3(vec3 v) {
+    vec3 out;
 
     out.x = 1.0f / v.x;
     out.y = 1.0f / v.y;
+    out.z = 1.0f / v.z;
 
     return out;
 }
 
-INLINE vec2 approachVec2(vec2 src, vec2 trg, f32 diff) {
-    vec2 out;
+INLINE vec3 approachVec3(vec3 src, vec3 trg, f32 diff) {
+    vec3 out;
 
     out.x = approach(src.x, trg.x, diff);
     out.y = approach(src.y, trg.y, diff);
+    out.z = approach(src.z, trg.z, diff);
 
     return out;
 }
 
-INLINE bool nonZeroVec2(vec2 v) {
+INLINE bool nonZeroVec3(vec3 v) {
     return v.x != 0 ||
-           v.y != 0;
+           v.y != 0 ||
+           v.z != 0;
 }
 
-INLINE vec2 minVec2(vec2 a, vec2 b) {
-    vec2 out;
+INLINE vec3 minVec3(vec3 a, vec3 b) {
+    vec3 out;
 
     out.x = a.x < b.x ? a.x : b.x;
     out.y = a.y < b.y ? a.y : b.y;
+    out.z = a.z < b.z ? a.z : b.z;
 
     return out;
 }
 
-INLINE vec2 maxVec2(vec2 a, vec2 b) {
-    vec2 out;
+INLINE vec3 maxVec3(vec3 a, vec3 b) {
+    vec3 out;
 
     out.x = a.x > b.x ? a.x : b.x;
     out.y = a.y > b.y ? a.y : b.y;
+    out.z = a.z > b.z ? a.z : b.z;
 
     return out;
 }
 
-INLINE f32 minCoordVec2(vec2 v) {
+INLINE f32 minCoordVec3(vec3 v) {
     f32 out = v.x;
     if (v.y < out) out = v.y;
+    if (v.z < out) out = v.z;
     return out;
 }
 
-INLINE f32 maxCoordVec2(vec2 v) {
+INLINE f32 maxCoordVec3(vec3 v) {
     f32 out = v.x;
     if (v.y > out) out = v.y;
+    if (v.z > out) out = v.z;
     return out;
 }
 
-INLINE vec2 subVec2(vec2 a, vec2 b) {
-    vec2 out;
-
-    out.x = a.x - b.x;
-    out.y = a.y - b.y;
-
-    return out;
-}
-
-INLINE vec2 addVec2(vec2 a, vec2 b) {
-    vec2 out;
-
-    out.x = a.x + b.x;
-    out.y = a.y + b.y;
-
-    return out;
-}
-
-INLINE vec2 mulVec2(vec2 a, vec2 b) {
-    vec2 out;
-
-    out.x = a.x * b.x;
-    out.y = a.y * b.y;
-
-    return out;
-}
-
-INLINE vec2 mulAddVec2(vec2 v, vec2 factors, vec2 to_be_added) {
-    vec2 out;
-
-    out.x = fast_mul_add(v.x, factors.x, to_be_added.x);
-    out.y = fast_mul_add(v.y, factors.y, to_be_added.y);
-
-    return out;
-}
-
-INLINE vec2 scaleAddVec2(vec2 v, f32 factor, vec2 to_be_added) {
-    vec2 out;
-
-    out.x = fast_mul_add(v.x, factor, to_be_added.x);
-    out.y = fast_mul_add(v.y, factor, to_be_added.y);
-
-    return out;
-}
-
-INLINE vec2 scaleVec2(vec2 a, f32 factor) {
-    vec2 out;
-
-    out.x = a.x * factor;
-    out.y = a.y * factor;
-
-    return out;
-}
-
-INLINE vec2 mulVec2Mat2(vec2 in, mat2 m) {
-    vec2 out;
-
-    out.x = in.x * m.X.x + in.y * m.Y.x;
-    out.y = in.x * m.X.y + in.y * m.Y.y;
-
-    return out;
-}
-
-INLINE f32 dotVec2(vec2 a, vec2 b) {
-    return (
-            (a.x * b.x) +
-            (a.y * b.y)
-    );
-}
-
-INLINE f32 squaredLengthVec2(vec2 v) {
-    return (
-            (v.x * v.x) +
-            (v.y * v.y)
-    );
-}
-
-INLINE f32 lengthVec2(vec2 v) {
-    return sqrtf(squaredLengthVec2(v));
-}
-
-INLINE vec2 normVec2(vec2 v) {
-    return scaleVec2(v, 1.0f / lengthVec2(v));
-}
-
-INLINE f32 DotVec2(vec2 a, vec2 b) { return clampValue(dotVec2(a, b)); }
-
-INLINE mat2 outerVec2(vec2 a, vec2 b) {
-    mat2 out;
-
-    out.X = scaleVec2(a, b.x);
-    out.Y = scaleVec2(a, b.y);
-
-    return out;
-}
-
-INLINE vec2 reflectVec2(vec2 V, vec2 N) {
-    vec2 out = scaleVec2(N, -2 * dotVec2(N, V));
-    out = addVec2(out, V);
-    return out;
-}
-
-
-
-INLINE vec3 clampVec3ToZero(vec3 v) {
-    v.x = v.x > 0.0f ? v.x : 0.0f;
-    v.y = v.y > 0.0f ? v.y : 0.0f;
-    v.z = v.z > 0.0f ? v.z : 0.0f;
-    return v;
-}
-
-INLINE vec3 clampVec3ToUpper(vec3 v, vec3 upper) {
-    v.x = v.x < upper.x ? v.x : upper.x;
-    v.y = v.y < upper.y ? v.y : upper.y;
-    v.z = v.z < upper.z ? v.z : upper.z;
-    return v;
-}
-
-INLINE vec3 clampVec3(vec3 v) {
-    v.x = v.x > 0.0f ? v.x : 0.0f;
-    v.y = v.y > 0.0f ? v.y : 0.0f;
-    v.z = v.z > 0.0f ? v.z : 0.0f;
-
-    v.x = v.x < 1.0f ? v.x : 1.0f;
-    v.y = v.y < 1.0f ? v.y : 1.0f;
-    v.z = v.z < 1.0f ? v.z : 1.0f;
-
-    return v;
-}
-
-INLINE vec3 clampVec3To(vec3 v, const f32 min_value, const f32 max_value) {
-    v.x = v.x > min_value ? v.x : min_value;
-    v.y = v.y > min_value ? v.y : min_value;
-    v.z = v.z > min_value ? v.z : min_value;
-
-    v.x = v.x < max_value ? v.x : max_value;
-    v.y = v.y < max_value ? v.y : max_value;
-    v.z = v.z < max_value ? v.z : max_value;
-
-    return v;
-}
-
-INLINE bool isEqualVec3(vec3 a, vec3 b) {
-    return a.x == b.x && a.y == b.y && a.z == b.z;
-}
-
-INLINE vec3 getVec3Of(f32 value) {
-    vec3 out;
-
-    out.x = out.y = out.z = value;
-
-    return out;
-}
-
-INLINE vec3 invertedVec3(vec3 in) {
-    vec3 out;
-
-    out.x = -in.x;
-    out.y = -in.y;
-    out.z = -in.z;
-
-    return out;
-}
-
-INLINE vec3 oneOverVec3(vec3 v) {
-    vec3 out;
-
-    out.x = 1.0f / v.x;
-    out.y = 1.0f / v.y;
-    out.z = 1.0f / v.z;
-
-    return out;
-}
-
-INLINE vec3 approachVec3(vec3 src, vec3 trg, f32 diff) {
-    vec3 out;
-
-    out.x = approach(src.x, trg.x, diff);
-    out.y = approach(src.y, trg.y, diff);
-    out.z = approach(src.z, trg.z, diff);
-
-    return out;
-}
-
-INLINE bool nonZeroVec3(vec3 v) {
-    return v.x != 0 ||
-           v.y != 0 ||
-           v.z != 0;
-}
-
-INLINE vec3 minVec3(vec3 a, vec3 b) {
-    vec3 out;
-
-    out.x = a.x < b.x ? a.x : b.x;
-    out.y = a.y < b.y ? a.y : b.y;
-    out.z = a.z < b.z ? a.z : b.z;
-
-    return out;
-}
-
-INLINE vec3 maxVec3(vec3 a, vec3 b) {
-    vec3 out;
-
-    out.x = a.x > b.x ? a.x : b.x;
-    out.y = a.y > b.y ? a.y : b.y;
-    out.z = a.z > b.z ? a.z : b.z;
-
-    return out;
-}
-
-INLINE f32 minCoordVec3(vec3 v) {
-    f32 out = v.x;
-    if (v.y < out) out = v.y;
-    if (v.z < out) out = v.z;
-    return out;
-}
-
-INLINE f32 maxCoordVec3(vec3 v) {
-    f32 out = v.x;
-    if (v.y > out) out = v.y;
-    if (v.z > out) out = v.z;
-    return out;
-}
-
-INLINE vec3 setPointOnUnitSphere(f32 s, f32 t) {
-    vec3 out;
+INLINE vec3 setPointOnUnitSphere(f32 s, f32 t) {
+    vec3 out;
 
     f32 t_squared = t * t;
     f32 s_squared = s * s;
@@ -2147,6 +2516,17 @@ INLINE vec3 mulVec3Mat3(vec3 in, mat3 m) {
     return out;
 }
 
+// Transforms a position by an affine matrix (with the translation in W):
+INLINE vec3 mulVec3Mat3x4(vec3 in, mat3x4 m) {
+    vec3 out;
+
+    out.x = in.x * m.X.x + in.y * m.Y.x + in.z * m.Z.x + m.W.x;
+    out.y = in.x * m.X.y + in.y * m.Y.y + in.z * m.Z.y + m.W.y;
+    out.z = in.x * m.X.z + in.y * m.Y.z + in.z * m.Z.z + m.W.z;
+
+    return out;
+}
+
 INLINE f32 dotVec3(vec3 a, vec3 b) {
     return (
             (a.x * b.x) +
@@ -2195,7 +2575,7 @@ INLINE mat3 outerVec3(vec3 a, vec3 b) {
 
 INLINE vec3 reflectVec3(vec3 V, vec3 N) {
     vec3 out = scaleVec3(N, -2 * dotVec3(N, V));
-    out = addVec3(out, V);
+         out = addVec3(out, V);
     return out;
 }
 
@@ -2204,145 +2584,317 @@ INLINE vec3 lerpVec3(vec3 from, vec3 to, f32 by) {
 }
 
 
+INLINE mat3 getMat3Identity() {
+    mat3 out;
 
-INLINE vec4 getVec4Of(f32 value) {
-    vec4 out;
-
-    out.x = out.y = out.z = out.w = value;
+    out.X.x = 1; out.X.y = 0; out.X.z = 0;
+    out.Y.x = 0; out.Y.y = 1; out.Y.z = 0;
+    out.Z.x = 0; out.Z.y = 0; out.Z.z = 1;
 
     return out;
 }
 
-INLINE vec4 invertedVec4(vec4 in) {
-    vec4 out;
+INLINE mat3 addMat3(mat3 a, mat3 b) {
+    mat3 out;
 
-    out.x = -in.x;
-    out.y = -in.y;
-    out.z = -in.z;
-    out.w = -in.w;
+    out.X.x = a.X.x + b.X.x;
+    out.X.y = a.X.y + b.X.y;
+    out.X.z = a.X.z + b.X.z;
 
-    return out;
-}
+    out.Y.x = a.Y.x + b.Y.x;
+    out.Y.y = a.Y.y + b.Y.y;
+    out.Y.z = a.Y.z + b.Y.z;
 
-INLINE vec4 approachVec4(vec4 src, vec4 trg, f32 diff) {
-    vec4 out;
-
-    out.x = approach(src.x, trg.x, diff);
-    out.y = approach(src.y, trg.y, diff);
-    out.z = approach(src.z, trg.z, diff);
-    out.w = approach(src.w, trg.w, diff);
+    out.Z.x = a.Z.x + b.Z.x;
+    out.Z.y = a.Z.y + b.Z.y;
+    out.Z.z = a.Z.x + b.Z.x;
 
     return out;
 }
 
-INLINE bool nonZeroVec4(vec4 v) {
-    return v.x != 0 ||
-           v.y != 0 ||
-           v.z != 0 ||
-           v.w != 0;
-}
+INLINE mat3 subMat3(mat3 a, mat3 b) {
+    mat3 out;
 
-INLINE vec4 subVec4(vec4 a, vec4 b) {
-    vec4 out;
+    out.X.x = a.X.x - b.X.x;
+    out.X.y = a.X.y - b.X.y;
+    out.X.z = a.X.z - b.X.z;
 
-    out.x = a.x - b.x;
-    out.y = a.y - b.y;
-    out.z = a.z - b.z;
-    out.w = a.w - b.w;
+    out.Y.x = a.Y.x - b.Y.x;
+    out.Y.y = a.Y.y - b.Y.y;
+    out.Y.z = a.Y.z - b.Y.z;
+
+    out.Z.x = a.Z.x - b.Z.x;
+    out.Z.y = a.Z.y - b.Z.y;
+    out.Z.z = a.Z.x - b.Z.x;
 
     return out;
 }
 
-INLINE vec4 addVec4(vec4 a, vec4 b) {
-    vec4 out;
+INLINE mat3 scaleMat3(mat3 m, f32 factor) {
+    mat3 out;
 
-    out.x = a.x + b.x;
-    out.y = a.y + b.y;
-    out.z = a.z + b.z;
-    out.w = a.w + b.w;
+    out.X.x = m.X.x * factor;
+    out.X.y = m.X.y * factor;
+    out.X.z = m.X.z * factor;
+
+    out.Y.x = m.Y.x * factor;
+    out.Y.y = m.Y.y * factor;
+    out.Y.z = m.Y.z * factor;
+
+    out.Z.x = m.Z.x * factor;
+    out.Z.y = m.Z.y * factor;
+    out.Z.z = m.Z.z * factor;
 
     return out;
 }
 
-INLINE vec4 mulVec4(vec4 a, vec4 b) {
-    vec4 out;
+INLINE mat3 transposedMat3(mat3 m) {
+    mat3 out;
 
-    out.x = a.x * b.x;
-    out.y = a.y * b.y;
-    out.z = a.z * b.z;
-    out.w = a.w * b.w;
+    out.X.x = m.X.x;  out.X.y = m.Y.x;  out.X.z = m.Z.x;
+    out.Y.x = m.X.y;  out.Y.y = m.Y.y;  out.Y.z = m.Z.y;
+    out.Z.x = m.X.z;  out.Z.y = m.Y.z;  out.Z.z = m.Z.z;
 
     return out;
 }
 
-INLINE vec4 scaleVec4(vec4 a, f32 factor) {
-    vec4 out;
+INLINE mat3 mulMat3(mat3 a, mat3 b) {
+    mat3 out;
 
-    out.x = a.x * factor;
-    out.y = a.y * factor;
-    out.z = a.z * factor;
-    out.w = a.w * factor;
+    out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x + a.X.z*b.Z.x; // Row 1 | Column 1
+    out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y + a.X.z*b.Z.y; // Row 1 | Column 2
+    out.X.z = a.X.x*b.X.z + a.X.y*b.Y.z + a.X.z*b.Z.z; // Row 1 | Column 3
+
+    out.Y.x = a.Y.x*b.X.x + a.Y.y*b.Y.x + a.Y.z*b.Z.x; // Row 2 | Column 1
+    out.Y.y = a.Y.x*b.X.y + a.Y.y*b.Y.y + a.Y.z*b.Z.y; // Row 2 | Column 2
+    out.Y.z = a.Y.x*b.X.z + a.Y.y*b.Y.z + a.Y.z*b.Z.z; // Row 2 | Column 3
+
+    out.Z.x = a.Z.x*b.X.x + a.Z.y*b.Y.x + a.Z.z*b.Z.x; // Row 3 | Column 1
+    out.Z.y = a.Z.x*b.X.y + a.Z.y*b.Y.y + a.Z.z*b.Z.y; // Row 3 | Column 2
+    out.Z.z = a.Z.x*b.X.z + a.Z.y*b.Y.z + a.Z.z*b.Z.z; // Row 3 | Column 3
 
     return out;
 }
-INLINE vec4 scaleAddVec4(vec4 v, f32 factor, vec4 to_be_added) {
-    vec4 out;
 
-    out.x = fast_mul_add(v.x, factor, to_be_added.x);
-    out.y = fast_mul_add(v.y, factor, to_be_added.y);
-    out.z = fast_mul_add(v.z, factor, to_be_added.z);
-    out.w = fast_mul_add(v.w, factor, to_be_added.w);
+INLINE mat3 invMat3(mat3 m) {
+    mat3 out;
+
+    f32 one_over_determinant = 1.0f / (
+        + m.X.x * (m.Y.y * m.Z.z - m.Z.y * m.Y.z)
+        - m.Y.x * (m.X.y * m.Z.z - m.Z.y * m.X.z)
+        + m.Z.x * (m.X.y * m.Y.z - m.Y.y * m.X.z)
+    );
+
+    out.X.x = + (m.Y.y * m.Z.z - m.Z.y * m.Y.z) * one_over_determinant;
+    out.Y.x = - (m.Y.x * m.Z.z - m.Z.x * m.Y.z) * one_over_determinant;
+    out.Z.x = + (m.Y.x * m.Z.y - m.Z.x * m.Y.y) * one_over_determinant;
+    out.X.y = - (m.X.y * m.Z.z - m.Z.y * m.X.z) * one_over_determinant;
+    out.Y.y = + (m.X.x * m.Z.z - m.Z.x * m.X.z) * one_over_determinant;
+    out.Z.y = - (m.X.x * m.Z.y - m.Z.x * m.X.y) * one_over_determinant;
+    out.X.z = + (m.X.y * m.Y.z - m.Y.y * m.X.z) * one_over_determinant;
+    out.Y.z = - (m.X.x * m.Y.z - m.Y.x * m.X.z) * one_over_determinant;
+    out.Z.z = + (m.X.x * m.Y.y - m.Y.x * m.X.y) * one_over_determinant;
 
     return out;
 }
 
-INLINE vec4 mulVec4Mat4(vec4 in, mat4 m) {
-    vec4 out;
+INLINE bool safeInvertMat3(mat3 *m) {
+    f32 m11 = m->X.x,  m12 = m->X.y,  m13 = m->X.z,
+        m21 = m->Y.x,  m22 = m->Y.y,  m23 = m->Y.z,
+        m31 = m->Z.x,  m32 = m->Z.y,  m33 = m->Z.z,
 
-    out.x = in.x * m.X.x + in.y * m.Y.x + in.z * m.Z.x + in.w * m.W.x;
-    out.y = in.x * m.X.y + in.y * m.Y.y + in.z * m.Z.y + in.w * m.W.y;
-    out.z = in.x * m.X.z + in.y * m.Y.z + in.z * m.Z.z + in.w * m.W.z;
-    out.w = in.x * m.X.w + in.y * m.Y.w + in.z * m.Z.w + in.w * m.W.w;
+        c11 = m22*m33 -
+              m23*m32,
 
-    return out;
+        c12 = m13*m32 -
+              m12*m33,
+
+        c13 = m12*m23 -
+              m13*m22,
+
+
+        c21 = m23*m31 -
+              m21*m33,
+
+        c22 = m11*m33 -
+              m13*m31,
+
+        c23 = m13*m21 -
+              m11*m23,
+
+
+        c31 = m21*m32 -
+              m22*m31,
+
+        c32 = m12*m31 -
+              m11*m32,
+
+        c33 = m11*m22 -
+              m12*m21,
+
+        d = c11 + c12 + c13 +
+            c21 + c22 + c23 +
+            c31 + c32 + c33;
+
+    if (!d) return false;
+
+    d = 1 / d;
+
+    m->X.x = d * c11;  m->X.y = d * c12;  m->X.z = d * c13;
+    m->Y.x = d * c21;  m->Y.y = d * c22;  m->Y.z = d * c23;
+    m->Z.x = d * c31;  m->Z.y = d * c32;  m->Z.z = d * c33;
+
+    return true;
 }
 
-INLINE f32 dotVec4(vec4 a, vec4 b) {
-    return (
-            (a.x * b.x) +
-            (a.y * b.y) +
-            (a.z * b.z) +
-            (a.w * b.w)
-    );
+INLINE void yawMat3(f32 amount, mat3* out) {
+    vec2 xy = getPointOnUnitCircle(amount);
+
+    vec3 X = out->X;
+    vec3 Y = out->Y;
+    vec3 Z = out->Z;
+
+    out->X.x = xy.x * X.x - xy.y * X.z;
+    out->Y.x = xy.x * Y.x - xy.y * Y.z;
+    out->Z.x = xy.x * Z.x - xy.y * Z.z;
+
+    out->X.z = xy.x * X.z + xy.y * X.x;
+    out->Y.z = xy.x * Y.z + xy.y * Y.x;
+    out->Z.z = xy.x * Z.z + xy.y * Z.x;
 }
 
-INLINE f32 squaredLengthVec4(vec4 v) {
-    return (
-            (v.x * v.x) +
-            (v.y * v.y) +
-            (v.z * v.z) +
-            (v.w * v.w)
-    );
+INLINE void pitchMat3(f32 amount, mat3* out) {
+    vec2 xy = getPointOnUnitCircle(amount);
+
+    vec3 X = out->X;
+    vec3 Y = out->Y;
+    vec3 Z = out->Z;
+
+    out->X.y = xy.x * X.y + xy.y * X.z;
+    out->Y.y = xy.x * Y.y + xy.y * Y.z;
+    out->Z.y = xy.x * Z.y + xy.y * Z.z;
+
+    out->X.z = xy.x * X.z - xy.y * X.y;
+    out->Y.z = xy.x * Y.z - xy.y * Y.y;
+    out->Z.z = xy.x * Z.z - xy.y * Z.y;
 }
 
-INLINE f32 lengthVec4(vec4 v) {
-    return sqrtf(squaredLengthVec4(v));
+INLINE void rollMat3(f32 amount, mat3* out) {
+    vec2 xy = getPointOnUnitCircle(amount);
+
+    vec3 X = out->X;
+    vec3 Y = out->Y;
+    vec3 Z = out->Z;
+
+    out->X.x = xy.x * X.x + xy.y * X.y;
+    out->Y.x = xy.x * Y.x + xy.y * Y.y;
+    out->Z.x = xy.x * Z.x + xy.y * Z.y;
+
+    out->X.y = xy.x * X.y - xy.y * X.x;
+    out->Y.y = xy.x * Y.y - xy.y * Y.x;
+    out->Z.y = xy.x * Z.y - xy.y * Z.x;
 }
 
-INLINE vec4 norm4(vec4 v) {
-    return scaleVec4(v, 1.0f / lengthVec4(v));
+INLINE void setYawMat3(f32 yaw, mat3* yaw_matrix) {
+    vec2 xy = getPointOnUnitCircle(yaw);
+
+    yaw_matrix->X.x = yaw_matrix->Z.z = xy.x;
+    yaw_matrix->X.z = +xy.y;
+    yaw_matrix->Z.x = -xy.y;
 }
 
-INLINE f32 mulVec3Mat4(vec3 in, f32 w, mat4 M, vec3 *out) {
-    vec4 v4 = mulVec4Mat4(Vec4fromVec3(in, w), M);
-    *out = Vec3fromVec4(v4);
-    return v4.w;
+INLINE void setPitchMat3(f32 pitch, mat3* pitch_matrix) {
+    vec2 xy = getPointOnUnitCircle(pitch);
+
+    pitch_matrix->Z.z = pitch_matrix->Y.y = xy.x;
+    pitch_matrix->Y.z = -xy.y;
+    pitch_matrix->Z.y = +xy.y;
 }
 
-INLINE vec4 lerpVec4(vec4 from, vec4 to, f32 by) {
-    return scaleAddVec4(subVec4(to, from), by, from);
+INLINE void setRollMat3(f32 roll, mat3* roll_matrix) {
+    vec2 xy = getPointOnUnitCircle(roll);
+
+    roll_matrix->X.x = roll_matrix->Y.y = xy.x;
+    roll_matrix->X.y = -xy.y;
+    roll_matrix->Y.x = +xy.y;
+}
+
+
+// The SIMD backend of the math library is chosen at compile time from the target's instruction set:
+// SSE on x86/x64 (SSE2 is the baseline, so builds targeting SSE4.1 or AVX2 use it as well) and NEON on ARM.
+// It can be disabled by defining SLIM_ENGINE_NO_SIMD (before including SlimEngine), which leaves the scalar code.
+//
+// The math API itself is unchanged: Functions still take and return their vectors and matrices by value,
+// and only their bodies load them into packed registers (using the thin wrappers below, shared by both backends).
+// The packed vec4/mat4/quat functions and the batch functions that transform arrays of points use them.
+#ifndef SLIM_ENGINE_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLIM_ENGINE_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SLIM_ENGINE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(SLIM_ENGINE_SIMD_SSE) || defined(SLIM_ENGINE_SIMD_NEON)
+#define SLIM_ENGINE_SIMD
+
+#ifdef SLIM_ENGINE_SIMD_SSE
+typedef __m128 simd4;
+
+INLINE simd4 loadSIMD(const f32 *from) { return _mm_loadu_ps(from); }
+INLINE void storeSIMD(f32 *to, simd4 v) { _mm_storeu_ps(to, v); }
+INLINE simd4 setSIMD(f32 x, f32 y, f32 z, f32 w) { return _mm_set_ps(w, z, y, x); }
+INLINE simd4 splatSIMD(f32 value) { return _mm_set1_ps(value); }
+INLINE simd4 addSIMD(simd4 a, simd4 b) { return _mm_add_ps(a, b); }
+INLINE simd4 subSIMD(simd4 a, simd4 b) { return _mm_sub_ps(a, b); }
+INLINE simd4 mulSIMD(simd4 a, simd4 b) { return _mm_mul_ps(a, b); }
+INLINE simd4 swapPairsSIMD(simd4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); } // (y, x, w, z)
+INLINE simd4 swapHalvesSIMD(simd4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)); } // (z, w, x, y)
+INLINE f32 sumOfSIMD(simd4 v) {
+    v = _mm_add_ps(v, swapHalvesSIMD(v));
+    return _mm_cvtss_f32(_mm_add_ss(v, swapPairsSIMD(v)));
+}
+INLINE void transposeSIMD(simd4 *X, simd4 *Y, simd4 *Z, simd4 *W) { _MM_TRANSPOSE4_PS(*X, *Y, *Z, *W); }
+#else
+typedef float32x4_t simd4;
+
+INLINE simd4 loadSIMD(const f32 *from) { return vld1q_f32(from); }
+INLINE void storeSIMD(f32 *to, simd4 v) { vst1q_f32(to, v); }
+INLINE simd4 setSIMD(f32 x, f32 y, f32 z, f32 w) {
+    f32 values[4] = {x, y, z, w};
+    return vld1q_f32(values);
+}
+INLINE simd4 splatSIMD(f32 value) { return vdupq_n_f32(value); }
+INLINE simd4 addSIMD(simd4 a, simd4 b) { return vaddq_f32(a, b); }
+INLINE simd4 subSIMD(simd4 a, simd4 b) { return vsubq_f32(a, b); }
+INLINE simd4 mulSIMD(simd4 a, simd4 b) { return vmulq_f32(a, b); }
+INLINE simd4 swapPairsSIMD(simd4 v) { return vrev64q_f32(v); } // (y, x, w, z)
+INLINE simd4 swapHalvesSIMD(simd4 v) { return vextq_f32(v, v, 2); } // (z, w, x, y)
+INLINE f32 sumOfSIMD(simd4 v) {
+    float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+INLINE void transposeSIMD(simd4 *X, simd4 *Y, simd4 *Z, simd4 *W) {
+    float32x4x2_t XY = vtrnq_f32(*X, *Y);
+    float32x4x2_t ZW = vtrnq_f32(*Z, *W);
+    *X = vcombine_f32(vget_low_f32( XY.val[0]), vget_low_f32( ZW.val[0]));
+    *Y = vcombine_f32(vget_low_f32( XY.val[1]), vget_low_f32( ZW.val[1]));
+    *Z = vcombine_f32(vget_high_f32(XY.val[0]), vget_high_f32(ZW.val[0]));
+    *W = vcombine_f32(vget_high_f32(XY.val[1]), vget_high_f32(ZW.val[1]));
 }
+#endif
 
+// out = in.x * X + in.y * Y + in.z * Z + in.w * W (the rows of the matrix, already loaded)
+INLINE simd4 mulSIMDByRows(f32 x, f32 y, f32 z, f32 w, simd4 X, simd4 Y, simd4 Z, simd4 W) {
+    return addSIMD(addSIMD(addSIMD(
+            mulSIMD(splatSIMD(x), X),
+            mulSIMD(splatSIMD(y), Y)),
+            mulSIMD(splatSIMD(z), Z)),
+            mulSIMD(splatSIMD(w), W));
+}
+#endif
 
 
 INLINE quat getIdentityQuaternion() {
@@ -2357,9 +2909,14 @@ INLINE quat getIdentityQuaternion() {
 INLINE quat normQuat(quat q) {
     quat out;
 
+#ifdef SLIM_ENGINE_SIMD
+    simd4 v = loadSIMD(&q.axis.x);
+    storeSIMD(&out.axis.x, mulSIMD(v, splatSIMD(1.0f / sqrtf(sumOfSIMD(mulSIMD(v, v))))));
+#else
     f32 factor = 1.0f / sqrtf(q.axis.x * q.axis.x + q.axis.y * q.axis.y + q.axis.z * q.axis.z + q.amount * q.amount);
     out.axis = scaleVec3(q.axis, factor);
     out.amount = q.amount * factor;
+#endif
 
     return out;
 }
@@ -2372,6 +2929,43 @@ INLINE vec3 mulVec3Quat(const vec3 v, quat q) {
     return out;
 }
 
+// Rotates an array of vectors (in place when in == out).
+// With SIMD, 4 vectors are rotated at a time with their x, y and z coordinates transposed into separate registers.
+INLINE void mulVec3ArrayQuat(const vec3 *in, u32 count, quat q, vec3 *out) {
+    u32 i = 0;
+#ifdef SLIM_ENGINE_SIMD
+    simd4 qx = splatSIMD(q.axis.x);
+    simd4 qy = splatSIMD(q.axis.y);
+    simd4 qz = splatSIMD(q.axis.z);
+    simd4 qw = splatSIMD(q.amount);
+    simd4 two = splatSIMD(2);
+    simd4 x, y, z, tx, ty, tz, ux, uy, uz;
+    f32 X[4], Y[4], Z[4];
+    for (; i + 4 <= count; i += 4, in += 4, out += 4) {
+        x = setSIMD(in[0].x, in[1].x, in[2].x, in[3].x);
+        y = setSIMD(in[0].y, in[1].y, in[2].y, in[3].y);
+        z = setSIMD(in[0].z, in[1].z, in[2].z, in[3].z);
+
+        // t = cross(q.axis, v), u = cross(q.axis, t), out = (t * q.amount + u) * 2 + v
+        tx = subSIMD(mulSIMD(qy, z), mulSIMD(qz, y));
+        ty = subSIMD(mulSIMD(qz, x), mulSIMD(qx, z));
+        tz = subSIMD(mulSIMD(qx, y), mulSIMD(qy, x));
+        ux = subSIMD(mulSIMD(qy, tz), mulSIMD(qz, ty));
+        uy = subSIMD(mulSIMD(qz, tx), mulSIMD(qx, tz));
+        uz = subSIMD(mulSIMD(qx, ty), mulSIMD(qy, tx));
+        storeSIMD(X, addSIMD(mulSIMD(addSIMD(mulSIMD(tx, qw), ux), two), x));
+        storeSIMD(Y, addSIMD(mulSIMD(addSIMD(mulSIMD(ty, qw), uy), two), y));
+        storeSIMD(Z, addSIMD(mulSIMD(addSIMD(mulSIMD(tz, qw), uz), two), z));
+        for (u8 j = 0; j < 4; j++) {
+            out[j].x = X[j];
+            out[j].y = Y[j];
+            out[j].z = Z[j];
+        }
+    }
+#endif
+    for (; i < count; i++, in++, out++) *out = mulVec3Quat(*in, q);
+}
+
 INLINE quat mulQuat(quat a, quat b) {
     quat out;
 
@@ -2499,366 +3093,1235 @@ INLINE quat rotateAroundAxis(quat q, vec3 axis, f32 amount) {
 }
 
 
+INLINE void rotateXform3(xform3 *xform, f32 yaw, f32 pitch, f32 roll) {
+    if (!(yaw || pitch || roll)) return;
 
-INLINE mat2 getMat2Identity() {
-    mat2 out;
-
-    out.X.x = 1; out.X.y = 0;
-    out.Y.x = 0; out.Y.y = 1;
+    if (yaw)   yawMat3(  yaw,   &xform->yaw_matrix);
+    if (pitch) pitchMat3(pitch, &xform->pitch_matrix);
+    if (roll)  rollMat3( roll,  &xform->roll_matrix);
 
-    return out;
+    xform->rotation_matrix = mulMat3(mulMat3(xform->pitch_matrix, xform->yaw_matrix), xform->roll_matrix);
+    xform->dirty |= XFORM3__DIRTY_ROTATION;
 }
 
-INLINE mat2 addMat2(mat2 a, mat2 b) {
-    mat2 out;
+INLINE void updateXform3Rotation(xform3 *xform) {
+    if (!(xform->dirty & XFORM3__DIRTY_ROTATION)) return;
 
-    out.X.x = a.X.x + b.X.x;
-    out.X.y = a.X.y + b.X.y;
+    xform->rotation          = convertRotationMatrixToQuaternion(xform->rotation_matrix);
+    xform->rotation_inverted = conjugate(xform->rotation);
+    xform->dirty &= (u8)~XFORM3__DIRTY_ROTATION;
+}
 
-    out.Y.x = a.Y.x + b.Y.x;
-    out.Y.y = a.Y.y + b.Y.y;
+INLINE quat getXform3Rotation(xform3 *xform) {
+    updateXform3Rotation(xform);
+    return xform->rotation;
+}
 
-    return out;
+INLINE quat getXform3InvertedRotation(xform3 *xform) {
+    updateXform3Rotation(xform);
+    return xform->rotation_inverted;
 }
 
-INLINE mat2 subMat2(mat2 a, mat2 b) {
-    mat2 out;
+INLINE mat3 getXform3InvertedRotationMatrix(xform3 *xform) {
+    return transposedMat3(xform->rotation_matrix);
+}
 
-    out.X.x = a.X.x - b.X.x;
-    out.X.y = a.X.y - b.X.y;
 
-    out.Y.x = a.Y.x - b.Y.x;
-    out.Y.y = a.Y.y - b.Y.y;
+u32 getMeshMemorySize(Mesh *mesh, char *file_path, Platform *platform) {
+    void *file = platform->openFileForReading(file_path);
+    if (!file) {
+        mesh->vertex_count = mesh->triangle_count = mesh->edge_count = mesh->uvs_count = mesh->normals_count = 0;
+        return 0;
+    }
 
-    return out;
-}
+    platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
+    platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
+    platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
+    platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
+    platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
+    platform->closeFile(file);
 
-INLINE mat2 scaleMat2(mat2 m, f32 factor) {
-    mat2 out;
+    u32 memory_size = sizeof(vec3) * mesh->vertex_count;
+    memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    memory_size += sizeof(EdgeVertexIndices) * mesh->edge_count;
 
-    out.X.x = m.X.x * factor;
-    out.X.y = m.X.y * factor;
+    if (mesh->uvs_count) {
+        memory_size += sizeof(vec2) * mesh->uvs_count;
+        memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    }
+    if (mesh->normals_count) {
+        memory_size += sizeof(vec3) * mesh->normals_count;
+        memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    }
 
-    out.Y.x = m.Y.x * factor;
-    out.Y.y = m.Y.y * factor;
+    return memory_size;
+}
 
-    return out;
+// The size of a mesh's arrays in its file (where they follow each other in the order that they are read in):
+u64 getMeshArraysSize(Mesh *mesh) {
+    u64 size = sizeof(vec3) * (u64)mesh->vertex_count;
+    size += sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    size += sizeof(EdgeVertexIndices) * (u64)mesh->edge_count;
+    if (mesh->uvs_count)     size += sizeof(vec2) * (u64)mesh->uvs_count     + sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    if (mesh->normals_count) size += sizeof(vec3) * (u64)mesh->normals_count + sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    return size;
 }
 
-INLINE mat2 transposedMat2(mat2 m) {
-    mat2 out;
+bool _readMeshHeaderFromFile(Mesh *mesh, void *file, Platform *platform) {
+    return (
+        platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->aabb.min,       sizeof(vec3), file) &&
+        platform->readFromFile(&mesh->aabb.max,       sizeof(vec3), file)
+    );
+}
 
-    out.X.x = m.X.x;  out.X.y = m.Y.x;
-    out.Y.x = m.X.y;  out.Y.y = m.Y.y;
+INLINE void _setMeshCapacities(Mesh *mesh) {
+    mesh->triangle_capacity = mesh->triangle_count;
+    mesh->vertex_capacity   = mesh->vertex_count;
+    mesh->edge_capacity     = mesh->edge_count;
+    mesh->normals_capacity  = mesh->normals_count;
+    mesh->uvs_capacity      = mesh->uvs_count;
+}
 
-    return out;
+void _allocateMeshArrays(Mesh *mesh, Memory *memory) {
+    _setMeshCapacities(mesh);
+    mesh->vertex_positions        = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->vertex_count);
+    mesh->vertex_position_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
+    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )allocateMemory(memory, sizeof(EdgeVertexIndices)     * mesh->edge_count);
+    if (mesh->uvs_count) {
+        mesh->vertex_uvs         = (vec2*                 )allocateMemory(memory, sizeof(vec2)                  * mesh->uvs_count);
+        mesh->vertex_uvs_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
+    }
+    if (mesh->normals_count) {
+        mesh->vertex_normals        = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->normals_count);
+        mesh->vertex_normal_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
+    }
 }
 
-INLINE mat2 mulMat2(mat2 a, mat2 b) {
-    mat2 out;
+void _readMeshArraysFromFile(Mesh *mesh, void *file, Platform *platform) {
+    platform->readFromFile(mesh->vertex_positions,             sizeof(vec3)                  * mesh->vertex_count,   file);
+    platform->readFromFile(mesh->vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    platform->readFromFile(mesh->edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
+    if (mesh->uvs_count) {
+        platform->readFromFile(mesh->vertex_uvs,               sizeof(vec2)                  * mesh->uvs_count,      file);
+        platform->readFromFile(mesh->vertex_uvs_indices,       sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    }
+    if (mesh->normals_count) {
+        platform->readFromFile(mesh->vertex_normals,                sizeof(vec3)                  * mesh->normals_count,  file);
+        platform->readFromFile(mesh->vertex_normal_indices,         sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    }
+}
 
-    out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x; // Row 1 | Column 1
-    out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y; // Row 1 | Column 2
+void loadMeshFromFile(Mesh *mesh, char *file_path, Platform *platform, Memory *memory) {
+    void *file = platform->openFileForReading(file_path);
 
-    out.Y.x = a.Y.x*b.X.x + a.Y.y*b.Y.x; // Row 2 | Column 1
-    out.Y.y = a.Y.x*b.X.y + a.Y.y*b.Y.y; // Row 2 | Column 2
+    mesh->vertex_normals          = null;
+    mesh->vertex_normal_indices   = null;
+    mesh->vertex_uvs              = null;
+    mesh->vertex_uvs_indices      = null;
+    mesh->edge_vertex_indices     = null;
+    mesh->is_loading = false;
+
+    if (!file) { // Missing mesh files are loaded as empty meshes:
+        mesh->vertex_positions = null;
+        mesh->vertex_position_indices = null;
+        mesh->vertex_count = mesh->triangle_count = mesh->edge_count = mesh->uvs_count = mesh->normals_count = 0;
+        mesh->aabb.min = mesh->aabb.max = getVec3Of(0);
+        _setMeshCapacities(mesh);
+        return;
+    }
 
-    return out;
+    _readMeshHeaderFromFile(mesh, file, platform);
+    _allocateMeshArrays(mesh, memory);
+    _readMeshArraysFromFile(mesh, file, platform);
+
+    platform->closeFile(file);
 }
 
-INLINE mat2 invMat2(mat2 m) {
-    mat2 out;
+void saveMeshToFile(Mesh *mesh, char* file_path, Platform *platform) {
+    void *file = platform->openFileForWriting(file_path);
 
-    f32 a = m.X.x,  b = m.X.y,
-            c = m.Y.x,  d = m.Y.y;
+    platform->writeToFile(&mesh->vertex_count,   sizeof(u32),  file);
+    platform->writeToFile(&mesh->triangle_count, sizeof(u32),  file);
+    platform->writeToFile(&mesh->edge_count,     sizeof(u32),  file);
+    platform->writeToFile(&mesh->uvs_count,      sizeof(u32),  file);
+    platform->writeToFile(&mesh->normals_count,  sizeof(u32),  file);
+    platform->writeToFile(&mesh->aabb.min,       sizeof(vec3), file);
+    platform->writeToFile(&mesh->aabb.max,       sizeof(vec3), file);
+    platform->writeToFile(mesh->vertex_positions,        sizeof(vec3)                  * mesh->vertex_count,   file);
+    platform->writeToFile(mesh->vertex_position_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    platform->writeToFile(mesh->edge_vertex_indices,     sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
+    if (mesh->uvs_count) {
+        platform->writeToFile(mesh->vertex_uvs,          sizeof(vec2)                  * mesh->uvs_count,      file);
+        platform->writeToFile(mesh->vertex_uvs_indices,  sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    }
+    if (mesh->normals_count) {
+        platform->writeToFile(mesh->vertex_normals,        sizeof(vec3)                  * mesh->normals_count,  file);
+        platform->writeToFile(mesh->vertex_normal_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+    }
 
-    f32 det = a*d - b*c;
-    f32 one_over_det = 1.0f / det;
+    platform->closeFile(file);
+}
 
-    out.X.x = +d * one_over_det;
-    out.X.y = -b * one_over_det;
-    out.Y.x = -c * one_over_det;
-    out.Y.y = +a * one_over_det;
+// Mesh files keep their arrays as they are in memory, so they can be mapped and used in place (instead of being read).
+// The mesh's arrays then point into a private view of the file, which is left mapped for as long as the app runs.
+bool mapMeshFromFile(Mesh *mesh, char *file_path, Platform *platform) {
+    u64 size;
+    u8 *data = platform->mapFileForReading ? (u8*)platform->mapFileForReading(file_path, &size) : null;
+    if (!data) return false;
+
+    u64 header_size = 5 * sizeof(u32) + 2 * sizeof(vec3);
+    u32 *counts = (u32*)data;
+    u64 array_size = 0;
+    if (size >= header_size) {
+        array_size += sizeof(vec3)                  * (u64)counts[0];
+        array_size += sizeof(TriangleVertexIndices) * (u64)counts[1];
+        array_size += sizeof(EdgeVertexIndices)     * (u64)counts[2];
+        if (counts[3]) array_size += sizeof(vec2) * (u64)counts[3] + sizeof(TriangleVertexIndices) * (u64)counts[1];
+        if (counts[4]) array_size += sizeof(vec3) * (u64)counts[4] + sizeof(TriangleVertexIndices) * (u64)counts[1];
+    }
+    if (size < header_size || size - header_size < array_size) {
+        platform->unmapFile(data, size);
+        return false;
+    }
 
-    return out;
-}
+    mesh->is_loading = false;
+    mesh->vertex_count   = counts[0];
+    mesh->triangle_count = counts[1];
+    mesh->edge_count     = counts[2];
+    mesh->uvs_count      = counts[3];
+    mesh->normals_count  = counts[4];
+    mesh->aabb.min = ((vec3*)(counts + 5))[0];
+    mesh->aabb.max = ((vec3*)(counts + 5))[1];
+    _setMeshCapacities(mesh);
+
+    u8 *array = data + header_size;
+    mesh->vertex_positions        = (vec3*                 )array; array += sizeof(vec3)                  * mesh->vertex_count;
+    mesh->vertex_position_indices = (TriangleVertexIndices*)array; array += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )array; array += sizeof(EdgeVertexIndices)     * mesh->edge_count;
+    mesh->vertex_uvs = null;
+    mesh->vertex_uvs_indices = null;
+    mesh->vertex_normals = null;
+    mesh->vertex_normal_indices = null;
+    if (mesh->uvs_count) {
+        mesh->vertex_uvs         = (vec2*                 )array; array += sizeof(vec2)                  * mesh->uvs_count;
+        mesh->vertex_uvs_indices = (TriangleVertexIndices*)array; array += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    }
+    if (mesh->normals_count) {
+        mesh->vertex_normals        = (vec3*                 )array; array += sizeof(vec3)                  * mesh->normals_count;
+        mesh->vertex_normal_indices = (TriangleVertexIndices*)array;
+    }
 
-INLINE bool safeInvertMat2(mat2 *m) {
-    f32 a = m->X.x,  b = m->X.y,
-            c = m->Y.x,  d = m->Y.y;
+    return true;
+}
 
-    f32 det = a*d - b*c;
-    if (!det) return false;
-    f32 one_over_det = 1.0f / det;
+// Meshes can be loaded on a background thread, so that the app can start drawing before they are read:
+// Each mesh is mapped from its file up front when the platform can (see mapMeshFromFile), leaving only the paging in of
+// its arrays to the background. Otherwise its counts and bounds are read up front, along with allocating its arrays
+// (so that memory is only ever allocated on the calling thread, and only for meshes that are read into it).
+// Either way the mesh is left empty and marked as loading (see isMeshLoaded) until its arrays are ready, when they are
+// handed over to the mesh, which is published by clearing its flag last (atomically) - so a thread that draws the mesh
+// sees either only its bounds or all of it.
+// All of the meshes are queued before the loading starts, and are then loaded in order on a single thread.
+void initMeshLoader(MeshLoader *loader, u32 capacity, Platform *platform, Memory *memory) {
+    loader->count = loader->drawn_count = loader->loaded_count = 0;
+    loader->platform = platform;
+    loader->loads = capacity ? (MeshLoad*)allocateMemory(memory, sizeof(MeshLoad) * capacity) : null;
+}
+
+// Returns false when the mesh's file is missing (in which case the mesh is left empty, as when loading it directly):
+bool queueMeshLoading(MeshLoader *loader, Mesh *mesh, char *file_path, Memory *memory) {
+    initMesh(mesh);
+    Platform *platform = loader->platform;
+    void *file = platform->openFileForReading(file_path);
+    if (!file) return false;
+
+    MeshLoad *load = loader->loads + loader->count++;
+    load->mesh = mesh;
+    load->file_path = file_path;
+    load->loaded = *mesh;
+    load->is_mapped = mapMeshFromFile(&load->loaded, file_path, platform);
+    if (!load->is_mapped) {
+        _readMeshHeaderFromFile(&load->loaded, file, platform);
+        _allocateMeshArrays(&load->loaded, memory);
+    }
+    platform->closeFile(file);
 
-    m->X.x = +d * one_over_det;
-    m->X.y = -b * one_over_det;
-    m->Y.x = -c * one_over_det;
-    m->Y.y = +a * one_over_det;
+    mesh->aabb = load->loaded.aabb;
+    mesh->is_loading = true;
 
     return true;
 }
 
-INLINE void rotateMat2(f32 amount, mat2* out) {
-    vec2 xy = getPointOnUnitCircle(amount);
+void _loadQueuedMeshes(void *data) {
+    MeshLoader *loader = (MeshLoader*)data;
+    Platform *platform = loader->platform;
+    MeshLoad *load = loader->loads;
+    for (u32 i = 0; i < loader->count; i++, load++) {
+        Mesh *loaded = &load->loaded;
+        if (load->is_mapped) {
+            // Touch a byte of each page of the mapped arrays, so they are paged in here rather than when first drawn:
+            volatile u8 touched = 0;
+            u8 *arrays = (u8*)loaded->vertex_positions;
+            u64 size = getMeshArraysSize(loaded);
+            for (u64 offset = 0; offset < size; offset += MEMORY__PAGE_SIZE) touched = (u8)(touched + arrays[offset]);
+        } else {
+            void *file = platform->openFileForReading(load->file_path);
+            if (file) {
+                Mesh header;
+                _readMeshHeaderFromFile(&header, file, platform);
+                _readMeshArraysFromFile(loaded, file, platform);
+                platform->closeFile(file);
+            }
+        }
 
-    vec2 X = out->X;
-    vec2 Y = out->Y;
+        Mesh *mesh = load->mesh;
+        mesh->vertex_positions        = loaded->vertex_positions;
+        mesh->vertex_normals          = loaded->vertex_normals;
+        mesh->vertex_uvs              = loaded->vertex_uvs;
+        mesh->vertex_position_indices = loaded->vertex_position_indices;
+        mesh->vertex_normal_indices   = loaded->vertex_normal_indices;
+        mesh->vertex_uvs_indices      = loaded->vertex_uvs_indices;
+        mesh->edge_vertex_indices     = loaded->edge_vertex_indices;
+        mesh->triangle_count = loaded->triangle_count;
+        mesh->vertex_count   = loaded->vertex_count;
+        mesh->edge_count     = loaded->edge_count;
+        mesh->normals_count  = loaded->normals_count;
+        mesh->uvs_count      = loaded->uvs_count;
+        _setMeshCapacities(mesh);
+        ATOMIC_STORE(&mesh->is_loading, false);
+        ATOMIC_ADD(&loader->loaded_count, 1);
+    }
+}
 
-    out->X.x = xy.x * X.x + xy.y * X.y;
-    out->Y.x = xy.x * Y.x + xy.y * Y.y;
+// Starts loading the queued meshes on a thread of their own (or loads them right away if no thread could be started):
+void startLoadingMeshes(MeshLoader *loader) {
+    if (!loader->count) return;
 
-    out->X.y = xy.x * X.y - xy.y * X.x;
-    out->Y.y = xy.x * Y.y - xy.y * Y.x;
+    Platform *platform = loader->platform;
+    if (!(platform->startThread && platform->startThread(_loadQueuedMeshes, loader)))
+        _loadQueuedMeshes(loader);
 }
 
-INLINE void setRotationMat2(f32 roll, mat2* roll_matrix) {
-    vec2 xy = getPointOnUnitCircle(roll);
+INLINE bool isLoadingMeshes(MeshLoader *loader) {
+    return ATOMIC_LOAD(&loader->loaded_count) < loader->count;
+}
 
-    roll_matrix->X.x = roll_matrix->Y.y = xy.x;
-    roll_matrix->X.y = -xy.y;
-    roll_matrix->Y.x = +xy.y;
+void finishLoadingMeshes(MeshLoader *loader) {
+    while (isLoadingMeshes(loader))
+        if (loader->platform->yieldThread)
+            loader->platform->yieldThread();
 }
 
+// The original scene files (still read when they have no header, see loadSceneFromFile):
+// Counts of objects, followed by the objects stored as they were in memory.
+// Primitives are stored without their cached matrices (which precede the rest of their fields):
+#define PRIMITIVE__FILE_SIZE (sizeof(Primitive) - 2 * sizeof(mat3x4))
 
+// Curves are stored without their cached polyline (which follows their thickness and revolution count):
+#define CURVE__FILE_SIZE (sizeof(f32) + sizeof(u32))
 
-INLINE mat3 getMat3Identity() {
-    mat3 out;
+void readSceneSettingsFromFile(SceneSettings *settings, void *file, Platform *platform) {
+    platform->readFromFile(&settings->boxes, sizeof(u32), file);
+    platform->readFromFile(&settings->cameras, sizeof(u32), file);
+    platform->readFromFile(&settings->curves, sizeof(u32), file);
+    platform->readFromFile(&settings->grids, sizeof(u32), file);
+    platform->readFromFile(&settings->meshes, sizeof(u32), file);
+    platform->readFromFile(&settings->primitives, sizeof(u32), file);
+}
 
-    out.X.x = 1; out.X.y = 0; out.X.z = 0;
-    out.Y.x = 0; out.Y.y = 1; out.Y.z = 0;
-    out.Z.x = 0; out.Z.y = 0; out.Z.z = 1;
+void readTransformFromFile(xform3 *xform, void *file, Platform *platform) {
+    mat3 skipped_matrix;
+    quat skipped_quaternion;
+    platform->readFromFile(&skipped_matrix, sizeof(mat3), file);
+    platform->readFromFile(&xform->yaw_matrix, sizeof(mat3), file);
+    platform->readFromFile(&xform->pitch_matrix, sizeof(mat3), file);
+    platform->readFromFile(&xform->roll_matrix, sizeof(mat3), file);
+    platform->readFromFile(&xform->rotation_matrix, sizeof(mat3), file);
+    platform->readFromFile(&skipped_matrix, sizeof(mat3), file);
 
-    return out;
+    platform->readFromFile(&skipped_quaternion, sizeof(quat), file);
+    platform->readFromFile(&skipped_quaternion, sizeof(quat), file);
+    xform->dirty = XFORM3__DIRTY_ROTATION;
+
+    platform->readFromFile(&xform->position, sizeof(vec3), file);
+    platform->readFromFile(&xform->scale, sizeof(vec3), file);
+
+    xform->right_direction   = &xform->rotation_matrix.X;
+    xform->up_direction      = &xform->rotation_matrix.Y;
+    xform->forward_direction = &xform->rotation_matrix.Z;
 }
 
-INLINE mat3 addMat3(mat3 a, mat3 b) {
-    mat3 out;
+void _skipMeshArraysInFile(Mesh *header, void *file, Platform *platform) {
+    u64 size = getMeshArraysSize(header);
+    u8 skipped[256];
+    while (size) {
+        u64 skipped_size = size < sizeof(skipped) ? size : sizeof(skipped);
+        if (!platform->readFromFile(skipped, skipped_size, file)) return;
+        size -= skipped_size;
+    }
+}
 
-    out.X.x = a.X.x + b.X.x;
-    out.X.y = a.X.y + b.X.y;
-    out.X.z = a.X.z + b.X.z;
+void _loadSceneFromFileV1(Scene *scene, char* file_path, Platform *platform) {
+    void *file = platform->openFileForReading(file_path);
+    if (!file) return;
 
-    out.Y.x = a.Y.x + b.Y.x;
-    out.Y.y = a.Y.y + b.Y.y;
-    out.Y.z = a.Y.z + b.Y.z;
+    readSceneSettingsFromFile(&scene->settings, file, platform);
 
-    out.Z.x = a.Z.x + b.Z.x;
-    out.Z.y = a.Z.y + b.Z.y;
-    out.Z.z = a.Z.x + b.Z.x;
+    if (scene->cameras) {
+        Camera *camera = scene->cameras;
+        for (u32 i = 0; i < scene->settings.cameras; i++, camera++) {
+            platform->readFromFile(&camera->focal_length, sizeof(f32), file);
+            platform->readFromFile(&camera->zoom, sizeof(f32), file);
+            platform->readFromFile(&camera->dolly, sizeof(f32), file);
+            platform->readFromFile(&camera->target_distance, sizeof(f32), file);
+            platform->readFromFile(&camera->current_velocity, sizeof(vec3), file);
+            readTransformFromFile(&camera->transform, file, platform);
+        }
+    }
 
-    return out;
-}
+    if (scene->primitives)
+        for (u32 i = 0; i < scene->settings.primitives; i++) {
+            platform->readFromFile(&scene->primitives[i].rotation, PRIMITIVE__FILE_SIZE, file);
+            scene->primitives[i].flags |= IS_DIRTY;
+        }
 
-INLINE mat3 subMat3(mat3 a, mat3 b) {
-    mat3 out;
+    if (scene->grids)
+        for (u32 i = 0; i < scene->settings.grids; i++)
+            platform->readFromFile(scene->grids + i, sizeof(Grid), file);
 
-    out.X.x = a.X.x - b.X.x;
-    out.X.y = a.X.y - b.X.y;
-    out.X.z = a.X.z - b.X.z;
+    if (scene->boxes)
+        for (u32 i = 0; i < scene->settings.boxes; i++)
+            platform->readFromFile(scene->boxes + i, sizeof(Box), file);
 
-    out.Y.x = a.Y.x - b.Y.x;
-    out.Y.y = a.Y.y - b.Y.y;
-    out.Y.z = a.Y.z - b.Y.z;
+    if (scene->curves)
+        for (u32 i = 0; i < scene->settings.curves; i++) {
+            platform->readFromFile(scene->curves + i, CURVE__FILE_SIZE, file);
+            scene->curves[i].point_count = 0;
+        }
 
-    out.Z.x = a.Z.x - b.Z.x;
-    out.Z.y = a.Z.y - b.Z.y;
-    out.Z.z = a.Z.x - b.Z.x;
+    // Meshes are only read into arrays that they fit in, others are left as they are (with their arrays skipped over,
+    // as the arrays of a mesh that is cut down to fit would have indices past the end of its vertices):
+    if (scene->meshes) {
+        Mesh *mesh = scene->meshes;
+        for (u32 i = 0; i < scene->settings.meshes; i++, mesh++) {
+            Mesh header;
+            if (!_readMeshHeaderFromFile(&header, file, platform)) break;
+
+            if (header.vertex_count   <= mesh->vertex_capacity   && (!header.vertex_count   || mesh->vertex_positions) &&
+                header.triangle_count <= mesh->triangle_capacity && (!header.triangle_count || mesh->vertex_position_indices) &&
+                header.edge_count     <= mesh->edge_capacity     && (!header.edge_count     || mesh->edge_vertex_indices) &&
+                (!header.uvs_count     || (header.uvs_count     <= mesh->uvs_capacity     && mesh->vertex_uvs     && mesh->vertex_uvs_indices)) &&
+                (!header.normals_count || (header.normals_count <= mesh->normals_capacity && mesh->vertex_normals && mesh->vertex_normal_indices))) {
+                mesh->aabb = header.aabb;
+                mesh->vertex_count   = header.vertex_count;
+                mesh->triangle_count = header.triangle_count;
+                mesh->edge_count     = header.edge_count;
+                mesh->uvs_count      = header.uvs_count;
+                mesh->normals_count  = header.normals_count;
+                _readMeshArraysFromFile(mesh, file, platform);
+            } else
+                _skipMeshArraysInFile(&header, file, platform);
+        }
+    }
 
-    return out;
+    platform->closeFile(file);
 }
 
-INLINE mat3 scaleMat3(mat3 m, f32 factor) {
-    mat3 out;
+// Scene files start with a header and a table of contents, followed by a section for each type of object.
+// A section holds a record for each object, with only the parameters that it was made from: Whatever is derived from
+// them is rebuilt on load (the vertices and edges of grids, the edges of boxes and the matrices of the transforms).
+//
+// Sections are found through the table of contents, so their order is free and sections of unknown types are skipped.
+// Records are read up to the fields that are known, so a later version can append fields to them (and stay readable).
+// Records are stored field by field, in the byte order of the machine that wrote the file.
+//
+// Embedded meshes keep their arrays as they are in memory, aligned at offsets from the start of the file,
+// so a mapped scene file can have its meshes used in place (see getMeshFromSceneFile), as can mesh files.
+#define SCENE_FILE__CAMERA_RECORD_SIZE    (4 * sizeof(f32) + sizeof(vec3) + 3 * sizeof(mat3) + 2 * sizeof(vec3))
+#define SCENE_FILE__PRIMITIVE_RECORD_SIZE (sizeof(quat) + 2 * sizeof(vec3) + sizeof(u32) + 4 * sizeof(u8))
+#define SCENE_FILE__CURVE_RECORD_SIZE     (sizeof(f32) + sizeof(u32))
+#define SCENE_FILE__BOX_RECORD_SIZE       (BOX__VERTEX_COUNT * sizeof(vec3))
+#define SCENE_FILE__GRID_RECORD_SIZE      (2 * sizeof(u8))
+
+INLINE u64 alignSceneFileOffset(u64 offset) {
+    return (offset + (SCENE_FILE__ALIGNMENT - 1)) & ~(u64)(SCENE_FILE__ALIGNMENT - 1);
+}
+
+bool writeToSceneFile(SceneFile *file, void *data, u64 size) {
+    if (file->data) {
+        if (file->offset > file->size || size > file->size - file->offset) return false;
+
+        u8 *from = (u8*)data;
+        u8 *to = file->data + file->offset;
+        for (u64 i = 0; i < size; i++) to[i] = from[i];
+    } else if (!file->platform->writeToFile(data, (unsigned long)size, file->file))
+        return false;
 
-    out.X.x = m.X.x * factor;
-    out.X.y = m.X.y * factor;
-    out.X.z = m.X.z * factor;
+    file->offset += size;
+    return true;
+}
 
-    out.Y.x = m.Y.x * factor;
-    out.Y.y = m.Y.y * factor;
-    out.Y.z = m.Y.z * factor;
+bool readFromSceneFile(SceneFile *file, void *out, u64 size) {
+    if (file->data) {
+        if (file->offset > file->size || size > file->size - file->offset) return false;
 
-    out.Z.x = m.Z.x * factor;
-    out.Z.y = m.Z.y * factor;
-    out.Z.z = m.Z.z * factor;
+        u8 *from = file->data + file->offset;
+        u8 *to = (u8*)out;
+        for (u64 i = 0; i < size; i++) to[i] = from[i];
+    } else if (!file->platform->readFromFile(out, (unsigned long)size, file->file))
+        return false;
 
-    return out;
+    file->offset += size;
+    return true;
 }
 
-INLINE mat3 transposedMat3(mat3 m) {
-    mat3 out;
+// Moves to the given offset, by writing zeros up to it or reading up to it (a file that is not mapped is only read forward):
+bool seekInSceneFile(SceneFile *file, u64 offset, bool is_writing) {
+    if (file->data) {
+        file->offset = offset;
+        return offset <= file->size;
+    }
+    if (offset < file->offset) return false;
+
+    u8 bytes[SCENE_FILE__ALIGNMENT];
+    for (u32 i = 0; i < SCENE_FILE__ALIGNMENT; i++) bytes[i] = 0;
+    while (file->offset < offset) {
+        u64 size = offset - file->offset;
+        if (size > SCENE_FILE__ALIGNMENT) size = SCENE_FILE__ALIGNMENT;
+        if (!(is_writing ? writeToSceneFile(file, bytes, size) : readFromSceneFile(file, bytes, size))) return false;
+    }
 
-    out.X.x = m.X.x;  out.X.y = m.Y.x;  out.X.z = m.Z.x;
-    out.Y.x = m.X.y;  out.Y.y = m.Y.y;  out.Y.z = m.Z.y;
-    out.Z.x = m.X.z;  out.Z.y = m.Y.z;  out.Z.z = m.Z.z;
+    return true;
+}
 
-    return out;
+// Lays out a mesh's record and arrays from the given (aligned) offset, returning the offset that follows them:
+// The mesh has to be loaded (see finishLoadingMeshes).
+u64 getSceneFileMesh(Mesh *mesh, u64 offset, SceneFileMesh *record) {
+    record->aabb = mesh->aabb;
+    record->vertex_count   = mesh->vertex_positions        ? mesh->vertex_count   : 0;
+    record->triangle_count = mesh->vertex_position_indices ? mesh->triangle_count : 0;
+    record->edge_count     = mesh->edge_vertex_indices     ? mesh->edge_count     : 0;
+    record->uvs_count      = mesh->vertex_uvs     && mesh->vertex_uvs_indices    ? mesh->uvs_count     : 0;
+    record->normals_count  = mesh->vertex_normals && mesh->vertex_normal_indices ? mesh->normals_count : 0;
+    record->reserved = 0;
+
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    u64 next = alignSceneFileOffset(offset + sizeof(SceneFileMesh));
+    record->vertex_positions        = next; next = alignSceneFileOffset(next + sizeof(vec3) * (u64)record->vertex_count);
+    record->vertex_position_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    record->edge_vertex_indices     = next; next = alignSceneFileOffset(next + sizeof(EdgeVertexIndices) * (u64)record->edge_count);
+    record->vertex_uvs = record->vertex_uvs_indices = record->vertex_normals = record->vertex_normal_indices = 0;
+    if (record->uvs_count) {
+        record->vertex_uvs         = next; next = alignSceneFileOffset(next + sizeof(vec2) * (u64)record->uvs_count);
+        record->vertex_uvs_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    }
+    if (record->normals_count) {
+        record->vertex_normals        = next; next = alignSceneFileOffset(next + sizeof(vec3) * (u64)record->normals_count);
+        record->vertex_normal_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    }
+    record->size = next - offset;
+
+    return next;
+}
+
+bool writeMeshToSceneFile(SceneFile *file, Mesh *mesh) {
+    SceneFileMesh record;
+    getSceneFileMesh(mesh, file->offset, &record);
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record.triangle_count;
+    bool written = (
+        writeToSceneFile(file, &record, sizeof(SceneFileMesh)) &&
+        seekInSceneFile(file, record.vertex_positions, true) &&
+        writeToSceneFile(file, mesh->vertex_positions, sizeof(vec3) * (u64)record.vertex_count) &&
+        seekInSceneFile(file, record.vertex_position_indices, true) &&
+        writeToSceneFile(file, mesh->vertex_position_indices, triangles_size) &&
+        seekInSceneFile(file, record.edge_vertex_indices, true) &&
+        writeToSceneFile(file, mesh->edge_vertex_indices, sizeof(EdgeVertexIndices) * (u64)record.edge_count)
+    );
+    if (written && record.uvs_count)
+        written = (
+            seekInSceneFile(file, record.vertex_uvs, true) &&
+            writeToSceneFile(file, mesh->vertex_uvs, sizeof(vec2) * (u64)record.uvs_count) &&
+            seekInSceneFile(file, record.vertex_uvs_indices, true) &&
+            writeToSceneFile(file, mesh->vertex_uvs_indices, triangles_size)
+        );
+    if (written && record.normals_count)
+        written = (
+            seekInSceneFile(file, record.vertex_normals, true) &&
+            writeToSceneFile(file, mesh->vertex_normals, sizeof(vec3) * (u64)record.normals_count) &&
+            seekInSceneFile(file, record.vertex_normal_indices, true) &&
+            writeToSceneFile(file, mesh->vertex_normal_indices, triangles_size)
+        );
+
+    return written && seekInSceneFile(file, alignSceneFileOffset(file->offset), true);
+}
+
+bool writeCameraToSceneFile(SceneFile *file, Camera *camera) {
+    xform3 *xform = &camera->transform;
+    return (
+        writeToSceneFile(file, &camera->focal_length,     sizeof(f32)) &&
+        writeToSceneFile(file, &camera->zoom,             sizeof(f32)) &&
+        writeToSceneFile(file, &camera->dolly,            sizeof(f32)) &&
+        writeToSceneFile(file, &camera->target_distance,  sizeof(f32)) &&
+        writeToSceneFile(file, &camera->current_velocity, sizeof(vec3)) &&
+        writeToSceneFile(file, &xform->yaw_matrix,        sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->pitch_matrix,      sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->roll_matrix,       sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->position,          sizeof(vec3)) &&
+        writeToSceneFile(file, &xform->scale,             sizeof(vec3))
+    );
 }
 
-INLINE mat3 mulMat3(mat3 a, mat3 b) {
-    mat3 out;
+bool readCameraFromSceneFile(SceneFile *file, Camera *camera) {
+    xform3 *xform = &camera->transform;
+    bool read = (
+        readFromSceneFile(file, &camera->focal_length,     sizeof(f32)) &&
+        readFromSceneFile(file, &camera->zoom,             sizeof(f32)) &&
+        readFromSceneFile(file, &camera->dolly,            sizeof(f32)) &&
+        readFromSceneFile(file, &camera->target_distance,  sizeof(f32)) &&
+        readFromSceneFile(file, &camera->current_velocity, sizeof(vec3)) &&
+        readFromSceneFile(file, &xform->yaw_matrix,        sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->pitch_matrix,      sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->roll_matrix,       sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->position,          sizeof(vec3)) &&
+        readFromSceneFile(file, &xform->scale,             sizeof(vec3))
+    );
+    xform->rotation_matrix = mulMat3(mulMat3(xform->pitch_matrix, xform->yaw_matrix), xform->roll_matrix);
+    xform->dirty |= XFORM3__DIRTY_ROTATION;
 
-    out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x + a.X.z*b.Z.x; // Row 1 | Column 1
-    out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y + a.X.z*b.Z.y; // Row 1 | Column 2
-    out.X.z = a.X.x*b.X.z + a.X.y*b.Y.z + a.X.z*b.Z.z; // Row 1 | Column 3
+    return read;
+}
 
-    out.Y.x = a.Y.x*b.X.x + a.Y.y*b.Y.x + a.Y.z*b.Z.x; // Row 2 | Column 1
-    out.Y.y = a.Y.x*b.X.y + a.Y.y*b.Y.y + a.Y.z*b.Z.y; // Row 2 | Column 2
-    out.Y.z = a.Y.x*b.X.z + a.Y.y*b.Y.z + a.Y.z*b.Z.z; // Row 2 | Column 3
+// The primitive's dirty flag is left out (it is set on loading anyway), so that drawing it does not change its record:
+bool writePrimitiveToSceneFile(SceneFile *file, Primitive *primitive) {
+    u8 type  = (u8)primitive->type;
+    u8 color = (u8)primitive->color;
+    u8 flags = primitive->flags & (u8)~IS_DIRTY;
+    return (
+        writeToSceneFile(file, &primitive->rotation,    sizeof(quat)) &&
+        writeToSceneFile(file, &primitive->position,    sizeof(vec3)) &&
+        writeToSceneFile(file, &primitive->scale,       sizeof(vec3)) &&
+        writeToSceneFile(file, &primitive->id,          sizeof(u32)) &&
+        writeToSceneFile(file, &type,                   sizeof(u8)) &&
+        writeToSceneFile(file, &color,                  sizeof(u8)) &&
+        writeToSceneFile(file, &flags,                  sizeof(u8)) &&
+        writeToSceneFile(file, &primitive->material_id, sizeof(u8))
+    );
+}
 
-    out.Z.x = a.Z.x*b.X.x + a.Z.y*b.Y.x + a.Z.z*b.Z.x; // Row 3 | Column 1
-    out.Z.y = a.Z.x*b.X.y + a.Z.y*b.Y.y + a.Z.z*b.Z.y; // Row 3 | Column 2
-    out.Z.z = a.Z.x*b.X.z + a.Z.y*b.Y.z + a.Z.z*b.Z.z; // Row 3 | Column 3
+bool readPrimitiveFromSceneFile(SceneFile *file, Primitive *primitive) {
+    u8 type, color;
+    bool read = (
+        readFromSceneFile(file, &primitive->rotation,    sizeof(quat)) &&
+        readFromSceneFile(file, &primitive->position,    sizeof(vec3)) &&
+        readFromSceneFile(file, &primitive->scale,       sizeof(vec3)) &&
+        readFromSceneFile(file, &primitive->id,          sizeof(u32)) &&
+        readFromSceneFile(file, &type,                   sizeof(u8)) &&
+        readFromSceneFile(file, &color,                  sizeof(u8)) &&
+        readFromSceneFile(file, &primitive->flags,       sizeof(u8)) &&
+        readFromSceneFile(file, &primitive->material_id, sizeof(u8))
+    );
+    if (read) {
+        primitive->type  = (enum PrimitiveType)type;
+        primitive->color = (enum ColorID)color;
+    }
+    primitive->flags |= IS_DIRTY;
 
-    return out;
+    return read;
 }
 
-INLINE mat3 invMat3(mat3 m) {
-    mat3 out;
+// Reads the arrays of a mesh's record into the mesh's own arrays, as long as they fit in them (leaving it as is if not).
+// Records are checked against the capacities of the arrays rather than the mesh's counts (which follow the last record).
+// A mesh that is still loading is left as is as well.
+bool readMeshFromSceneFile(SceneFile *file, SceneFileMesh *record, Mesh *mesh) {
+    if (!isMeshLoaded(mesh) ||
+        record->vertex_count   > mesh->vertex_capacity   || (record->vertex_count   && !mesh->vertex_positions) ||
+        record->triangle_count > mesh->triangle_capacity || (record->triangle_count && !mesh->vertex_position_indices) ||
+        record->edge_count     > mesh->edge_capacity     || (record->edge_count     && !mesh->edge_vertex_indices) ||
+        (record->uvs_count     && (record->uvs_count     > mesh->uvs_capacity     || !mesh->vertex_uvs     || !mesh->vertex_uvs_indices)) ||
+        (record->normals_count && (record->normals_count > mesh->normals_capacity || !mesh->vertex_normals || !mesh->vertex_normal_indices)))
+        return false;
 
-    f32 one_over_determinant = 1.0f / (
-            + m.X.x * (m.Y.y * m.Z.z - m.Z.y * m.Y.z)
-            - m.Y.x * (m.X.y * m.Z.z - m.Z.y * m.X.z)
-            + m.Z.x * (m.X.y * m.Y.z - m.Y.y * m.X.z)
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    bool read = (
+        seekInSceneFile(file, record->vertex_positions, false) &&
+        readFromSceneFile(file, mesh->vertex_positions, sizeof(vec3) * (u64)record->vertex_count) &&
+        seekInSceneFile(file, record->vertex_position_indices, false) &&
+        readFromSceneFile(file, mesh->vertex_position_indices, triangles_size) &&
+        seekInSceneFile(file, record->edge_vertex_indices, false) &&
+        readFromSceneFile(file, mesh->edge_vertex_indices, sizeof(EdgeVertexIndices) * (u64)record->edge_count)
     );
+    if (read && record->uvs_count)
+        read = (
+            seekInSceneFile(file, record->vertex_uvs, false) &&
+            readFromSceneFile(file, mesh->vertex_uvs, sizeof(vec2) * (u64)record->uvs_count) &&
+            seekInSceneFile(file, record->vertex_uvs_indices, false) &&
+            readFromSceneFile(file, mesh->vertex_uvs_indices, triangles_size)
+        );
+    if (read && record->normals_count)
+        read = (
+            seekInSceneFile(file, record->vertex_normals, false) &&
+            readFromSceneFile(file, mesh->vertex_normals, sizeof(vec3) * (u64)record->normals_count) &&
+            seekInSceneFile(file, record->vertex_normal_indices, false) &&
+            readFromSceneFile(file, mesh->vertex_normal_indices, triangles_size)
+        );
+    if (!read) return false;
+
+    mesh->aabb = record->aabb;
+    mesh->vertex_count   = record->vertex_count;
+    mesh->triangle_count = record->triangle_count;
+    mesh->edge_count     = record->edge_count;
+    mesh->uvs_count      = record->uvs_count;
+    mesh->normals_count  = record->normals_count;
 
-    out.X.x = + (m.Y.y * m.Z.z - m.Z.y * m.Y.z) * one_over_determinant;
-    out.Y.x = - (m.Y.x * m.Z.z - m.Z.x * m.Y.z) * one_over_determinant;
-    out.Z.x = + (m.Y.x * m.Z.y - m.Z.x * m.Y.y) * one_over_determinant;
-    out.X.y = - (m.X.y * m.Z.z - m.Z.y * m.X.z) * one_over_determinant;
-    out.Y.y = + (m.X.x * m.Z.z - m.Z.x * m.X.z) * one_over_determinant;
-    out.Z.y = - (m.X.x * m.Z.y - m.Z.x * m.X.y) * one_over_determinant;
-    out.X.z = + (m.X.y * m.Y.z - m.Y.y * m.X.z) * one_over_determinant;
-    out.Y.z = - (m.X.x * m.Y.z - m.Y.x * m.X.z) * one_over_determinant;
-    out.Z.z = + (m.X.x * m.Y.y - m.Y.x * m.X.y) * one_over_determinant;
+    return true;
+}
 
-    return out;
+INLINE bool _isSceneFileArrayInRange(u64 offset, u64 size, u64 file_size) {
+    return !(offset & 3) && offset <= file_size && size <= file_size - offset;
 }
 
-INLINE bool safeInvertMat3(mat3 *m) {
-    f32 m11 = m->X.x,  m12 = m->X.y,  m13 = m->X.z,
-            m21 = m->Y.x,  m22 = m->Y.y,  m23 = m->Y.z,
-            m31 = m->Z.x,  m32 = m->Z.y,  m33 = m->Z.z,
+// Points a mesh at the arrays of the embedded mesh of the given index, in a mapped scene file (returning false if none).
+// The mesh is then valid for as long as the file stays mapped.
+bool getMeshFromSceneFile(u8 *data, u64 size, u32 index, Mesh *mesh) {
+    SceneFileHeader *header = (SceneFileHeader*)data;
+    if (size < sizeof(SceneFileHeader) || header->magic != SCENE_FILE__MAGIC) return false;
+
+    SceneFileSection *section = (SceneFileSection*)(header + 1);
+    u32 section_count = header->section_count;
+    if (section_count > (size - sizeof(SceneFileHeader)) / sizeof(SceneFileSection)) return false;
+    for (; section_count && section->type != SceneFileSection_Meshes; section_count--) section++;
+    if (!section_count || index >= section->count || section->record_size < sizeof(SceneFileMesh)) return false;
 
-            c11 = m22*m33 -
-                  m23*m32,
+    u64 offset = section->offset;
+    SceneFileMesh *record = null;
+    for (u32 i = 0; i <= index; i++) {
+        if ((offset & 7) || !_isSceneFileArrayInRange(offset, sizeof(SceneFileMesh), size)) return false;
+        record = (SceneFileMesh*)(data + offset);
+        offset += record->size;
+    }
 
-            c12 = m13*m32 -
-                  m12*m33,
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    if (!(_isSceneFileArrayInRange(record->vertex_positions,        sizeof(vec3) * (u64)record->vertex_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_position_indices, triangles_size, size) &&
+          _isSceneFileArrayInRange(record->edge_vertex_indices,     sizeof(EdgeVertexIndices) * (u64)record->edge_count, size) &&
+          (!record->uvs_count || (
+          _isSceneFileArrayInRange(record->vertex_uvs,              sizeof(vec2) * (u64)record->uvs_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_uvs_indices,      triangles_size, size))) &&
+          (!record->normals_count || (
+          _isSceneFileArrayInRange(record->vertex_normals,          sizeof(vec3) * (u64)record->normals_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_normal_indices,   triangles_size, size)))))
+        return false;
 
-            c13 = m12*m23 -
-                  m13*m22,
+    mesh->is_loading = false;
+    mesh->aabb = record->aabb;
+    mesh->vertex_count   = record->vertex_count;
+    mesh->triangle_count = record->triangle_count;
+    mesh->edge_count     = record->edge_count;
+    mesh->uvs_count      = record->uvs_count;
+    mesh->normals_count  = record->normals_count;
+    mesh->vertex_positions        = (vec3*                 )(data + record->vertex_positions);
+    mesh->vertex_position_indices = (TriangleVertexIndices*)(data + record->vertex_position_indices);
+    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )(data + record->edge_vertex_indices);
+    mesh->vertex_uvs              = record->uvs_count     ? (vec2*                 )(data + record->vertex_uvs)            : null;
+    mesh->vertex_uvs_indices      = record->uvs_count     ? (TriangleVertexIndices*)(data + record->vertex_uvs_indices)    : null;
+    mesh->vertex_normals          = record->normals_count ? (vec3*                 )(data + record->vertex_normals)        : null;
+    mesh->vertex_normal_indices   = record->normals_count ? (TriangleVertexIndices*)(data + record->vertex_normal_indices) : null;
+    _setMeshCapacities(mesh);
 
+    return true;
+}
 
-            c21 = m23*m31 -
-                  m21*m33,
+bool _writeSceneFileRecord(SceneFile *file, Scene *scene, u32 type, u32 index) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return writeCameraToSceneFile(   file, scene->cameras    + index);
+        case SceneFileSection_Primitives: return writePrimitiveToSceneFile(file, scene->primitives + index);
+        case SceneFileSection_Meshes:     return writeMeshToSceneFile(     file, scene->meshes     + index);
+        case SceneFileSection_Curves:
+            return (
+                writeToSceneFile(file, &scene->curves[index].thickness,        sizeof(f32)) &&
+                writeToSceneFile(file, &scene->curves[index].revolution_count, sizeof(u32))
+            );
+        case SceneFileSection_Boxes:
+            return writeToSceneFile(file, scene->boxes[index].vertices.buffer, SCENE_FILE__BOX_RECORD_SIZE);
+        case SceneFileSection_Grids:
+            return (
+                writeToSceneFile(file, &scene->grids[index].u_segments, sizeof(u8)) &&
+                writeToSceneFile(file, &scene->grids[index].v_segments, sizeof(u8))
+            );
+        default:
+            return true;
+    }
+}
 
-            c22 = m11*m33 -
-                  m13*m31,
+// Reads a record of any type other than a mesh (see readMeshFromSceneFile):
+bool _readSceneFileRecord(SceneFile *file, Scene *scene, u32 type, u32 index) {
+    bool read = true;
+    switch (type) {
+        case SceneFileSection_Cameras:    read = readCameraFromSceneFile(   file, scene->cameras    + index); break;
+        case SceneFileSection_Primitives: read = readPrimitiveFromSceneFile(file, scene->primitives + index); break;
+        case SceneFileSection_Curves: {
+            Curve *curve = scene->curves + index;
+            read = (
+                readFromSceneFile(file, &curve->thickness,        sizeof(f32)) &&
+                readFromSceneFile(file, &curve->revolution_count, sizeof(u32))
+            );
+            curve->point_count = 0;
+        } break;
+        case SceneFileSection_Boxes: {
+            Box *box = scene->boxes + index;
+            read = readFromSceneFile(file, box->vertices.buffer, SCENE_FILE__BOX_RECORD_SIZE);
+            setBoxEdgesFromVertices(&box->edges, &box->vertices);
+        } break;
+        case SceneFileSection_Grids: {
+            u8 u_segments, v_segments;
+            read = (
+                readFromSceneFile(file, &u_segments, sizeof(u8)) &&
+                readFromSceneFile(file, &v_segments, sizeof(u8))
+            );
+            if (read) initGrid(scene->grids + index, u_segments, v_segments);
+        } break;
+        default:
+            break;
+    }
 
-            c23 = m13*m21 -
-                  m11*m23,
+    return read;
+}
 
+void _setSceneObjectCount(SceneSettings *settings, u32 type, u32 count) {
+    switch (type) {
+        case SceneFileSection_Primitives: settings->primitives = count; break;
+        case SceneFileSection_Meshes:     settings->meshes     = count; break;
+        case SceneFileSection_Curves:     settings->curves     = count; break;
+        case SceneFileSection_Boxes:      settings->boxes      = count; break;
+        case SceneFileSection_Grids:      settings->grids      = count; break;
+        default: break;
+    }
+}
 
-            c31 = m21*m32 -
-                  m22*m31,
+// Loading a scene replaces its objects, so the pools are rebuilt from the loaded counts (see resetObjectPool).
+// Primitives that were removed before the scene was saved have no type, and their slots are free again.
+void _resetSceneObjectPools(Scene *scene) {
+    SceneSettings *settings = &scene->settings;
+    resetObjectPool(&scene->primitive_pool, settings->primitives);
+    resetObjectPool(&scene->mesh_pool,      settings->meshes);
+    resetObjectPool(&scene->curve_pool,     settings->curves);
+    resetObjectPool(&scene->box_pool,       settings->boxes);
+    resetObjectPool(&scene->grid_pool,      settings->grids);
 
-            c32 = m12*m31 -
-                  m11*m32,
+    ObjectPool *pool = &scene->primitive_pool;
+    if (scene->primitives)
+        for (u32 i = settings->primitives; i > 0; i--)
+            if (scene->primitives[i - 1].type == PrimitiveType_None)
+                freePoolSlot(pool, getObjectHandle(pool, i - 1));
+}
+
+// Scenes can also be saved incrementally (see saveSceneChangesToFile): Instead of rewriting the whole file (meshes and all),
+// only the records that changed since the file was last saved or loaded are appended to it, as an entry of its journal.
+// The journal follows the file's sections, and loading the file replays its entries in order over the loaded objects.
+// Entries hold the counts of objects as well, so objects that were added or removed since are covered too.
+// Meshes are not journaled, so a change in the count of meshes has the file rewritten, as does a full journal
+// (once it has SCENE_FILE__MAX_JOURNAL_ENTRIES entries, compacting it into the sections).
+INLINE u64 _getSceneJournalRecordSize(u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return SCENE_FILE__CAMERA_RECORD_SIZE;
+        case SceneFileSection_Primitives: return SCENE_FILE__PRIMITIVE_RECORD_SIZE;
+        case SceneFileSection_Curves:     return SCENE_FILE__CURVE_RECORD_SIZE;
+        case SceneFileSection_Boxes:      return SCENE_FILE__BOX_RECORD_SIZE;
+        case SceneFileSection_Grids:      return SCENE_FILE__GRID_RECORD_SIZE;
+        default: return 0;
+    }
+}
 
-            c33 = m11*m22 -
-                  m12*m21,
+INLINE u32 _getSceneJournalCapacity(SceneSettings *settings, u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return settings->cameras;
+        case SceneFileSection_Primitives: return settings->max_primitives;
+        case SceneFileSection_Curves:     return settings->max_curves;
+        case SceneFileSection_Boxes:      return settings->max_boxes;
+        case SceneFileSection_Grids:      return settings->max_grids;
+        default: return 0;
+    }
+}
 
-            d = c11 + c12 + c13 +
-                c21 + c22 + c23 +
-                c31 + c32 + c33;
+INLINE u32 _getSceneObjectCount(SceneSettings *settings, u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return settings->cameras;
+        case SceneFileSection_Primitives: return settings->primitives;
+        case SceneFileSection_Meshes:     return settings->meshes;
+        case SceneFileSection_Curves:     return settings->curves;
+        case SceneFileSection_Boxes:      return settings->boxes;
+        case SceneFileSection_Grids:      return settings->grids;
+        default: return 0;
+    }
+}
 
-    if (!d) return false;
+// The journal's copy of a record, with the records of each type following those of the previous type (up to capacity):
+u8* _getSceneJournalRecord(Scene *scene, u32 type, u32 index) {
+    u8 *record = scene->journal.records;
+    for (u32 t = SceneFileSection_Cameras; t < type; t++)
+        record += _getSceneJournalRecordSize(t) * _getSceneJournalCapacity(&scene->settings, t);
 
-    d = 1 / d;
+    return record + _getSceneJournalRecordSize(type) * index;
+}
 
-    m->X.x = d * c11;  m->X.y = d * c12;  m->X.z = d * c13;
-    m->Y.x = d * c21;  m->Y.y = d * c22;  m->Y.z = d * c23;
-    m->Z.x = d * c31;  m->Z.y = d * c32;  m->Z.z = d * c33;
+u64 getSceneJournalMemorySize(SceneSettings *settings) {
+    u64 memory_size = sizeof(SceneFileJournalEntry);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++)
+        memory_size += _getSceneJournalCapacity(settings, type) * (
+            2 * _getSceneJournalRecordSize(type) + sizeof(SceneFileJournalRecord)
+        );
 
-    return true;
+    return memory_size;
 }
 
-INLINE void yawMat3(f32 amount, mat3* out) {
-    vec2 xy = getPointOnUnitCircle(amount);
+void initSceneJournal(SceneJournal *journal, SceneSettings *settings, Memory *memory) {
+    u64 records_size = 0;
+    u64 entry_capacity = sizeof(SceneFileJournalEntry);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++) {
+        u32 capacity = _getSceneJournalCapacity(settings, type);
+        records_size   += capacity * _getSceneJournalRecordSize(type);
+        entry_capacity += capacity * (_getSceneJournalRecordSize(type) + sizeof(SceneFileJournalRecord));
+    }
+    journal->records = records_size ? (u8*)allocateMemory(memory, records_size) : null;
+    journal->entry = (u8*)allocateMemory(memory, entry_capacity);
+    journal->entry_capacity = journal->entry ? entry_capacity : 0;
+    journal->file_path = null;
+    journal->entry_count = 0;
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) journal->counts[type] = 0;
+}
+
+// Has the journal hold the scene's records as they are in the given file (or none, so that the next save rewrites it):
+void _resetSceneJournal(Scene *scene, char *file_path, u32 entry_count) {
+    SceneJournal *journal = &scene->journal;
+    journal->file_path = journal->entry ? file_path : null;
+    journal->entry_count = entry_count;
+    if (!journal->file_path) return;
+
+    SceneFile records;
+    records.platform = null;
+    records.file = null;
+    records.data = journal->records;
+    records.size = (u64)(_getSceneJournalRecord(scene, SCENE_FILE__SECTION_TYPES, 0) - journal->records);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++) {
+        journal->counts[type] = _getSceneObjectCount(&scene->settings, type);
+        if (!_getSceneJournalRecordSize(type)) continue;
+
+        records.offset = (u64)(_getSceneJournalRecord(scene, type, 0) - journal->records);
+        for (u32 i = 0; i < journal->counts[type]; i++)
+            _writeSceneFileRecord(&records, scene, type, i);
+    }
+}
 
-    vec3 X = out->X;
-    vec3 Y = out->Y;
-    vec3 Z = out->Z;
+INLINE bool _isSameFilePath(char *path, char *other_path) {
+    while (*path && *path == *other_path) { path++; other_path++; }
+    return *path == *other_path;
+}
+
+void _addSceneFileSection(SceneFileSection *sections, u32 *section_count, enum SceneFileSectionType type, u32 count, u64 record_size) {
+    SceneFileSection *section = sections + (*section_count)++;
+    section->type = (u32)type;
+    section->count = count;
+    section->record_size = (u32)record_size;
+    section->reserved = 0;
+    section->offset = 0;
+    section->size = record_size * count;
+}
+
+// Meshes that are still loading are waited for, so that the file holds all of their arrays.
+bool saveSceneToFile(Scene *scene, char* file_path, Platform *platform) {
+    finishLoadingMeshes(&scene->mesh_loader);
+
+    SceneSettings *settings = &scene->settings;
+    SceneFileSection sections[6];
+    u32 section_count = 0;
+    if (scene->cameras)    _addSceneFileSection(sections, &section_count, SceneFileSection_Cameras,    settings->cameras,    SCENE_FILE__CAMERA_RECORD_SIZE);
+    if (scene->primitives) _addSceneFileSection(sections, &section_count, SceneFileSection_Primitives, settings->primitives, SCENE_FILE__PRIMITIVE_RECORD_SIZE);
+    if (scene->meshes)     _addSceneFileSection(sections, &section_count, SceneFileSection_Meshes,     settings->meshes,     sizeof(SceneFileMesh));
+    if (scene->curves)     _addSceneFileSection(sections, &section_count, SceneFileSection_Curves,     settings->curves,     SCENE_FILE__CURVE_RECORD_SIZE);
+    if (scene->boxes)      _addSceneFileSection(sections, &section_count, SceneFileSection_Boxes,      settings->boxes,      SCENE_FILE__BOX_RECORD_SIZE);
+    if (scene->grids)      _addSceneFileSection(sections, &section_count, SceneFileSection_Grids,      settings->grids,      SCENE_FILE__GRID_RECORD_SIZE);
+
+    u64 offset = sizeof(SceneFileHeader) + sizeof(SceneFileSection) * section_count;
+    for (u32 i = 0; i < section_count; i++) {
+        SceneFileSection *section = sections + i;
+        section->offset = offset = alignSceneFileOffset(offset);
+        if (section->type == SceneFileSection_Meshes) {
+            SceneFileMesh record;
+            for (u32 m = 0; m < section->count; m++) offset = getSceneFileMesh(scene->meshes + m, offset, &record);
+            section->size = offset - section->offset;
+        } else
+            offset += section->size;
+    }
 
-    out->X.x = xy.x * X.x - xy.y * X.z;
-    out->Y.x = xy.x * Y.x - xy.y * Y.z;
-    out->Z.x = xy.x * Z.x - xy.y * Z.z;
+    SceneFile file;
+    file.platform = platform;
+    file.data = null;
+    file.size = file.offset = 0;
+    file.file = platform->openFileForWriting(file_path);
+    if (!file.file) return false;
+
+    SceneFileHeader header;
+    header.magic = SCENE_FILE__MAGIC;
+    header.version = SCENE_FILE__VERSION;
+    header.section_count = section_count;
+    header.reserved = 0;
+    bool written = writeToSceneFile(&file, &header, sizeof(SceneFileHeader));
+    for (u32 i = 0; written && i < section_count; i++)
+        written = writeToSceneFile(&file, sections + i, sizeof(SceneFileSection));
+
+    for (u32 i = 0; written && i < section_count; i++) {
+        SceneFileSection *section = sections + i;
+        written = seekInSceneFile(&file, section->offset, true);
+        for (u32 r = 0; written && r < section->count; r++)
+            written = _writeSceneFileRecord(&file, scene, section->type, r);
+    }
 
-    out->X.z = xy.x * X.z + xy.y * X.x;
-    out->Y.z = xy.x * Y.z + xy.y * Y.x;
-    out->Z.z = xy.x * Z.z + xy.y * Z.x;
-}
+    platform->closeFile(file.file);
+    _resetSceneJournal(scene, written ? file_path : null, 0);
+    return written;
+}
+
+// Appends the records that changed since the scene was last saved to (or loaded from) the given file, to its journal.
+// The whole file is saved instead when the journal does not hold the file's records (or is full, or meshes were added).
+// Nothing is written when nothing changed.
+bool saveSceneChangesToFile(Scene *scene, char* file_path, Platform *platform) {
+    SceneJournal *journal = &scene->journal;
+    SceneSettings *settings = &scene->settings;
+    if (!(journal->file_path && _isSameFilePath(journal->file_path, file_path) &&
+          journal->entry_count < SCENE_FILE__MAX_JOURNAL_ENTRIES &&
+          journal->counts[SceneFileSection_Meshes] == settings->meshes &&
+          platform->openFileForAppending))
+        return saveSceneToFile(scene, file_path, platform);
+
+    // Each record is composed into the entry right after its type and index, and is dropped if it did not change:
+    SceneFile entry;
+    entry.platform = platform;
+    entry.file = null;
+    entry.data = journal->entry;
+    entry.size = journal->entry_capacity;
+    entry.offset = sizeof(SceneFileJournalEntry);
+
+    SceneFileJournalEntry header;
+    header.magic = SCENE_FILE__JOURNAL_MAGIC;
+    header.record_count = 0;
+    header.reserved = 0;
+    bool changed = false;
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) {
+        header.counts[type] = _getSceneObjectCount(settings, type);
+        if (header.counts[type] != journal->counts[type]) changed = true;
+
+        u64 record_size = _getSceneJournalRecordSize(type);
+        if (!record_size) continue;
+
+        SceneFileJournalRecord record;
+        record.type = type;
+        for (record.index = 0; record.index < header.counts[type]; record.index++) {
+            u64 offset = entry.offset;
+            if (!(writeToSceneFile(&entry, &record, sizeof(SceneFileJournalRecord)) &&
+                  _writeSceneFileRecord(&entry, scene, type, record.index)))
+                return false;
+
+            u8 *saved = _getSceneJournalRecord(scene, type, record.index);
+            u8 *written = journal->entry + offset + sizeof(SceneFileJournalRecord);
+            bool is_same = record.index < journal->counts[type];
+            for (u64 i = 0; is_same && i < record_size; i++) is_same = saved[i] == written[i];
+            if (is_same)
+                entry.offset = offset;
+            else
+                header.record_count++;
+        }
+    }
+    if (!(changed || header.record_count)) return true;
 
-INLINE void pitchMat3(f32 amount, mat3* out) {
-    vec2 xy = getPointOnUnitCircle(amount);
+    header.size = entry.offset;
+    entry.offset = 0;
+    writeToSceneFile(&entry, &header, sizeof(SceneFileJournalEntry));
 
-    vec3 X = out->X;
-    vec3 Y = out->Y;
-    vec3 Z = out->Z;
+    void *file = platform->openFileForAppending(file_path);
+    bool written = file && platform->writeToFile(journal->entry, (unsigned long)header.size, file);
+    if (file) platform->closeFile(file);
+    if (!written) { // The file may now end with a partial entry, so it is to be rewritten on the next save
+        journal->file_path = null;
+        return false;
+    }
 
-    out->X.y = xy.x * X.y + xy.y * X.z;
-    out->Y.y = xy.x * Y.y + xy.y * Y.z;
-    out->Z.y = xy.x * Z.y + xy.y * Z.z;
+    // The journal now holds the records as they are in the file:
+    u8 *record = journal->entry + sizeof(SceneFileJournalEntry);
+    for (u32 r = 0; r < header.record_count; r++) {
+        SceneFileJournalRecord *written_record = (SceneFileJournalRecord*)record;
+        u64 record_size = _getSceneJournalRecordSize(written_record->type);
+        u8 *saved = _getSceneJournalRecord(scene, written_record->type, written_record->index);
+        record += sizeof(SceneFileJournalRecord);
+        for (u64 i = 0; i < record_size; i++) saved[i] = record[i];
+        record += record_size;
+    }
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) journal->counts[type] = header.counts[type];
+    journal->entry_count++;
 
-    out->X.z = xy.x * X.z - xy.y * X.y;
-    out->Y.z = xy.x * Y.z - xy.y * Y.y;
-    out->Z.z = xy.x * Z.z - xy.y * Z.y;
+    return true;
 }
 
-INLINE void rollMat3(f32 amount, mat3* out) {
-    vec2 xy = getPointOnUnitCircle(amount);
+INLINE u32 _getSceneFileSectionCount(SceneFileSection *section, u32 capacity) {
+    return section->count < capacity ? section->count : capacity;
+}
+
+// Loads the objects of each section into the scene's own (already allocated) objects, up to their capacities.
+// Objects of types that the file has no section for are left as they are.
+// Embedded meshes are only loaded into meshes that their arrays fit in, other meshes are left as they are.
+bool _loadSceneSection(Scene *scene, SceneFile *file, SceneFileSection *section) {
+    SceneSettings *settings = &scene->settings;
+    u32 count = 0;
+    u64 record_size = 0;
+    switch (section->type) {
+        case SceneFileSection_Cameras:    if (scene->cameras)    { count = _getSceneFileSectionCount(section, settings->cameras);        record_size = SCENE_FILE__CAMERA_RECORD_SIZE;    } break;
+        case SceneFileSection_Primitives: if (scene->primitives) { count = _getSceneFileSectionCount(section, settings->max_primitives); record_size = SCENE_FILE__PRIMITIVE_RECORD_SIZE; } break;
+        case SceneFileSection_Meshes:     if (scene->meshes)     { count = _getSceneFileSectionCount(section, settings->max_meshes);     record_size = sizeof(SceneFileMesh);             } break;
+        case SceneFileSection_Curves:     if (scene->curves)     { count = _getSceneFileSectionCount(section, settings->max_curves);     record_size = SCENE_FILE__CURVE_RECORD_SIZE;     } break;
+        case SceneFileSection_Boxes:      if (scene->boxes)      { count = _getSceneFileSectionCount(section, settings->max_boxes);      record_size = SCENE_FILE__BOX_RECORD_SIZE;       } break;
+        case SceneFileSection_Grids:      if (scene->grids)      { count = _getSceneFileSectionCount(section, settings->max_grids);      record_size = SCENE_FILE__GRID_RECORD_SIZE;      } break;
+        default: break;
+    }
+    if (!record_size || section->record_size < record_size) return true; // Skipped
+
+    bool read = true;
+    u64 offset = section->offset;
+    for (u32 i = 0; read && i < count; i++) {
+        read = seekInSceneFile(file, offset, false);
+        offset += section->record_size;
+        if (!read) break;
+
+        if (section->type == SceneFileSection_Meshes) {
+            SceneFileMesh record;
+            read = readFromSceneFile(file, &record, sizeof(SceneFileMesh));
+            if (read) {
+                offset += record.size - section->record_size;
+                readMeshFromSceneFile(file, &record, scene->meshes + i);
+            }
+        } else
+            read = _readSceneFileRecord(file, scene, section->type, i);
+    }
+    _setSceneObjectCount(settings, section->type, count);
+
+    return read;
+}
+
+// Replays the journal's entries from the given offset (the end of the file's sections), returning how many there were.
+// Each entry is read whole (into the journal's entry) before any of it is replayed, and replaying stops at the first
+// entry that is not whole. is_whole is set when the journal runs up to the end of the file (an entry's first byte is
+// read on its own, so that the end of a file that is not mapped can be told apart from a partial entry).
+u32 _replaySceneFileJournal(Scene *scene, SceneFile *file, u64 offset, bool *is_whole) {
+    SceneJournal *journal = &scene->journal;
+    SceneSettings *settings = &scene->settings;
+    SceneFileJournalEntry entry;
+    u8 *entry_bytes = (u8*)&entry;
+    u32 entry_count = 0;
+    *is_whole = false;
+    while (journal->entry && seekInSceneFile(file, offset, false)) {
+        if (!readFromSceneFile(file, entry_bytes, 1)) {
+            *is_whole = true;
+            break;
+        }
+        if (!(readFromSceneFile(file, entry_bytes + 1, sizeof(SceneFileJournalEntry) - 1) &&
+              entry.magic == SCENE_FILE__JOURNAL_MAGIC &&
+              entry.size >= sizeof(SceneFileJournalEntry) && entry.size <= journal->entry_capacity &&
+              readFromSceneFile(file, journal->entry + sizeof(SceneFileJournalEntry), entry.size - sizeof(SceneFileJournalEntry))))
+            break;
 
-    vec3 X = out->X;
-    vec3 Y = out->Y;
-    vec3 Z = out->Z;
+        // The records are all checked before any of them is read into the scene:
+        SceneFile records;
+        records.platform = file->platform;
+        records.file = null;
+        records.data = journal->entry;
+        records.size = entry.size;
+        SceneFileJournalRecord record;
+        bool read = true;
+        for (u32 pass = 0; read && pass < 2; pass++) {
+            records.offset = sizeof(SceneFileJournalEntry);
+            for (u32 r = 0; read && r < entry.record_count; r++) {
+                read = readFromSceneFile(&records, &record, sizeof(SceneFileJournalRecord));
+                u64 record_size = read ? _getSceneJournalRecordSize(record.type) : 0;
+                read = (
+                    record_size && record.index < _getSceneJournalCapacity(settings, record.type) &&
+                    records.offset + record_size <= records.size
+                );
+                if (!read) break;
 
-    out->X.x = xy.x * X.x + xy.y * X.y;
-    out->Y.x = xy.x * Y.x + xy.y * Y.y;
-    out->Z.x = xy.x * Z.x + xy.y * Z.y;
+                if (pass)
+                    read = _readSceneFileRecord(&records, scene, record.type, record.index);
+                else
+                    records.offset += record_size;
+            }
+        }
+        if (!read) break;
 
-    out->X.y = xy.x * X.y - xy.y * X.x;
-    out->Y.y = xy.x * Y.y - xy.y * Y.x;
-    out->Z.y = xy.x * Z.y - xy.y * Z.x;
-}
+        for (u32 type = SceneFileSection_Primitives; type < SCENE_FILE__SECTION_TYPES; type++)
+            if (type != SceneFileSection_Meshes) {
+                u32 capacity = _getSceneJournalCapacity(settings, type);
+                _setSceneObjectCount(settings, type, entry.counts[type] < capacity ? entry.counts[type] : capacity);
+            }
 
-INLINE void setYawMat3(f32 yaw, mat3* yaw_matrix) {
-    vec2 xy = getPointOnUnitCircle(yaw);
+        offset += entry.size;
+        entry_count++;
+    }
 
-    yaw_matrix->X.x = yaw_matrix->Z.z = xy.x;
-    yaw_matrix->X.z = +xy.y;
-    yaw_matrix->Z.x = -xy.y;
-}
+    return entry_count;
+}
+
+// Loads a scene file in-place (mapping it when the platform can, so its sections can be read in any order).
+// Files without a header are read as the original (unversioned) scene files.
+// Meshes that are still loading are waited for, so that the file's meshes are read into their arrays (not raced for them).
+bool loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
+    finishLoadingMeshes(&scene->mesh_loader);
+
+    SceneFile file;
+    file.platform = platform;
+    file.offset = file.size = 0;
+    file.data = platform->mapFileForReading ? (u8*)platform->mapFileForReading(file_path, &file.size) : null;
+    file.file = file.data ? null : platform->openFileForReading(file_path);
+    if (!file.data && !file.file) return false;
+
+    SceneFileHeader header;
+    bool read = readFromSceneFile(&file, &header, sizeof(SceneFileHeader));
+    bool is_versioned = read && header.magic == SCENE_FILE__MAGIC && header.version >= SCENE_FILE__VERSION;
+    if (is_versioned) {
+        SceneFileSection sections[SCENE_FILE__MAX_SECTIONS];
+        u32 section_count = header.section_count < SCENE_FILE__MAX_SECTIONS ? header.section_count : SCENE_FILE__MAX_SECTIONS;
+        for (u32 i = 0; read && i < section_count; i++)
+            read = readFromSceneFile(&file, sections + i, sizeof(SceneFileSection));
+
+        u64 sections_end = file.offset;
+        for (u32 i = 0; read && i < section_count; i++) {
+            read = _loadSceneSection(scene, &file, sections + i);
+            if (sections[i].offset + sections[i].size > sections_end)
+                sections_end = sections[i].offset + sections[i].size;
+        }
 
-INLINE void setPitchMat3(f32 pitch, mat3* pitch_matrix) {
-    vec2 xy = getPointOnUnitCircle(pitch);
+        // A file whose journal ends with a partial entry (from an interrupted save) is to be rewritten on the next save,
+        // rather than have entries appended after the partial one:
+        bool is_whole = false;
+        u32 entry_count = read ? _replaySceneFileJournal(scene, &file, sections_end, &is_whole) : 0;
+        _resetSceneJournal(scene, read && is_whole ? file_path : null, entry_count);
+        _resetSceneObjectPools(scene);
+    }
 
-    pitch_matrix->Z.z = pitch_matrix->Y.y = xy.x;
-    pitch_matrix->Y.z = -xy.y;
-    pitch_matrix->Z.y = +xy.y;
-}
+    if (file.data) platform->unmapFile(file.data, file.size);
+    if (file.file) platform->closeFile(file.file);
+    if (is_versioned) return read;
 
-INLINE void setRollMat3(f32 roll, mat3* roll_matrix) {
-    vec2 xy = getPointOnUnitCircle(roll);
+    scene->journal.file_path = null; // Saving changes rewrites the file in the versioned format first
+    if (!read || header.magic == SCENE_FILE__MAGIC) return false;
 
-    roll_matrix->X.x = roll_matrix->Y.y = xy.x;
-    roll_matrix->X.y = -xy.y;
-    roll_matrix->Y.x = +xy.y;
+    _loadSceneFromFileV1(scene, file_path, platform);
+    _resetSceneObjectPools(scene);
+    return true;
 }
 
 
-
 INLINE mat4 getMat4Identity() {
     mat4 out;
 
@@ -2962,6 +4425,16 @@ INLINE mat4 scaleMat4(mat4 m, f32 factor) {
 INLINE mat4 mulMat4(mat4 a, mat4 b) {
     mat4 out;
 
+#ifdef SLIM_ENGINE_SIMD
+    simd4 X = loadSIMD(b.X.components);
+    simd4 Y = loadSIMD(b.Y.components);
+    simd4 Z = loadSIMD(b.Z.components);
+    simd4 W = loadSIMD(b.W.components);
+    storeSIMD(out.X.components, mulSIMDByRows(a.X.x, a.X.y, a.X.z, a.X.w, X, Y, Z, W));
+    storeSIMD(out.Y.components, mulSIMDByRows(a.Y.x, a.Y.y, a.Y.z, a.Y.w, X, Y, Z, W));
+    storeSIMD(out.Z.components, mulSIMDByRows(a.Z.x, a.Z.y, a.Z.z, a.Z.w, X, Y, Z, W));
+    storeSIMD(out.W.components, mulSIMDByRows(a.W.x, a.W.y, a.W.z, a.W.w, X, Y, Z, W));
+#else
     out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x + a.X.z*b.Z.x + a.X.w*b.W.x; // Row 1 | Column 1
     out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y + a.X.z*b.Z.y + a.X.w*b.W.y; // Row 1 | Column 2
     out.X.z = a.X.x*b.X.z + a.X.y*b.Y.z + a.X.z*b.Z.z + a.X.w*b.W.z; // Row 1 | Column 3
@@ -2981,6 +4454,7 @@ INLINE mat4 mulMat4(mat4 a, mat4 b) {
     out.W.y = a.W.x*b.X.y + a.W.y*b.Y.y + a.W.z*b.Z.y + a.W.w*b.W.y; // Row 4 | Column 2
     out.W.z = a.W.x*b.X.z + a.W.y*b.Y.z + a.W.z*b.Z.z + a.W.w*b.W.z; // Row 4 | Column 3
     out.W.w = a.W.x*b.X.w + a.W.y*b.Y.w + a.W.z*b.Z.w + a.W.w*b.W.w; // Row 4 | Column 4
+#endif
 
     return out;
 }
@@ -2988,10 +4462,79 @@ INLINE mat4 mulMat4(mat4 a, mat4 b) {
 INLINE mat4 invMat4(mat4 m) {
     mat4 out;
 
+#ifdef SLIM_ENGINE_SIMD
+    // Cramer's rule over the transposed matrix, with the cofactors accumulated from products of pairs of its rows
+    // (as in Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix" application note):
+    simd4 row0 = loadSIMD(m.X.components);
+    simd4 row1 = loadSIMD(m.Y.components);
+    simd4 row2 = loadSIMD(m.Z.components);
+    simd4 row3 = loadSIMD(m.W.components);
+    transposeSIMD(&row0, &row1, &row2, &row3);
+    row1 = swapHalvesSIMD(row1);
+    row3 = swapHalvesSIMD(row3);
+
+    simd4 minor0, minor1, minor2, minor3;
+    simd4 tmp = swapPairsSIMD(mulSIMD(row2, row3));
+    minor0 = mulSIMD(row1, tmp);
+    minor1 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(mulSIMD(row1, tmp), minor0);
+    minor1 = subSIMD(mulSIMD(row0, tmp), minor1);
+    minor1 = swapHalvesSIMD(minor1);
+
+    tmp = swapPairsSIMD(mulSIMD(row1, row2));
+    minor0 = addSIMD(mulSIMD(row3, tmp), minor0);
+    minor3 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(minor0, mulSIMD(row3, tmp));
+    minor3 = subSIMD(mulSIMD(row0, tmp), minor3);
+    minor3 = swapHalvesSIMD(minor3);
+
+    tmp = swapPairsSIMD(mulSIMD(swapHalvesSIMD(row1), row3));
+    row2 = swapHalvesSIMD(row2);
+    minor0 = addSIMD(mulSIMD(row2, tmp), minor0);
+    minor2 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(minor0, mulSIMD(row2, tmp));
+    minor2 = subSIMD(mulSIMD(row0, tmp), minor2);
+    minor2 = swapHalvesSIMD(minor2);
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row1));
+    minor2 = addSIMD(mulSIMD(row3, tmp), minor2);
+    minor3 = subSIMD(mulSIMD(row2, tmp), minor3);
+    tmp = swapHalvesSIMD(tmp);
+    minor2 = subSIMD(mulSIMD(row3, tmp), minor2);
+    minor3 = subSIMD(minor3, mulSIMD(row2, tmp));
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row3));
+    minor1 = subSIMD(minor1, mulSIMD(row2, tmp));
+    minor2 = addSIMD(mulSIMD(row1, tmp), minor2);
+    tmp = swapHalvesSIMD(tmp);
+    minor1 = addSIMD(mulSIMD(row2, tmp), minor1);
+    minor2 = subSIMD(minor2, mulSIMD(row1, tmp));
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row2));
+    minor1 = addSIMD(mulSIMD(row3, tmp), minor1);
+    minor3 = subSIMD(minor3, mulSIMD(row1, tmp));
+    tmp = swapHalvesSIMD(tmp);
+    minor1 = subSIMD(minor1, mulSIMD(row3, tmp));
+    minor3 = addSIMD(mulSIMD(row1, tmp), minor3);
+
+    f32 det = sumOfSIMD(mulSIMD(row0, minor0));
+    if (!det) return m;
+
+    simd4 factor = splatSIMD(1.0f / det);
+    storeSIMD(out.X.components, mulSIMD(minor0, factor));
+    storeSIMD(out.Y.components, mulSIMD(minor1, factor));
+    storeSIMD(out.Z.components, mulSIMD(minor2, factor));
+    storeSIMD(out.W.components, mulSIMD(minor3, factor));
+
+    return out;
+#else
     f32 m11 = m.X.x,  m12 = m.X.y,  m13 = m.X.z, m14 = m.X.w,
-            m21 = m.Y.x,  m22 = m.Y.y,  m23 = m.Y.z, m24 = m.Y.w,
-            m31 = m.Z.x,  m32 = m.Z.y,  m33 = m.Z.z, m34 = m.Z.w,
-            m41 = m.W.x,  m42 = m.W.y,  m43 = m.W.z, m44 = m.W.w;
+        m21 = m.Y.x,  m22 = m.Y.y,  m23 = m.Y.z, m24 = m.Y.w,
+        m31 = m.Z.x,  m32 = m.Z.y,  m33 = m.Z.z, m34 = m.Z.w,
+        m41 = m.W.x,  m42 = m.W.y,  m43 = m.W.z, m44 = m.W.w;
 
     out.X.x = +m22*m33*m44 - m22*m34*m43 - m32*m23*m44 + m32*m24*m43 + m42*m23*m34 - m42*m24*m33;
     out.X.y = -m12*m33*m44 + m12*m34*m43 + m32*m13*m44 - m32*m14*m43 - m42*m13*m34 + m42*m14*m33;
@@ -3019,6 +4562,7 @@ INLINE mat4 invMat4(mat4 m) {
     out = scaleMat4(out, 1.0f / det);
 
     return out;
+#endif
 }
 
 INLINE void yawMat4(f32 amount, mat4 *out) {
@@ -3103,790 +4647,3222 @@ INLINE mat4 mat4fromMat3(mat3 m3) {
 }
 
 
-void drawHLine(i32 x_start, i32 x_end, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
-    x_start += viewport->position.x;
-    x_end   += viewport->position.x;
-    y       += viewport->position.y;
-
-    if (!inRange(y, viewport->dimensions.height + viewport->position.y, viewport->position.y)) return;
-
-    i32 first, last, step = 1;
-    subRange(x_start, x_end, viewport->dimensions.width + viewport->position.x, viewport->position.x, &first, &last);
+INLINE void convertPositionAndDirectionToObjectSpace(
+    vec3 position, 
+    vec3 dir, 
+    Primitive *primitive,
+    vec3 *out_position,
+    vec3 *out_direction
+) {
+    *out_position = primitive->flags & IS_TRANSLATED ?
+                    subVec3(position, primitive->position) :
+                    position;
 
-    color = mulVec3(color, color);
-    if (viewport->settings.antialias) {
-        y <<= 1;
-        first <<= 1;
-        last  <<= 1;
-        step = 2;
-        for (i32 x = first; x <= last; x += step) {
-            setPixel(x+0, y+0, 0, color, opacity, viewport);
-            setPixel(x+1, y+0, 0, color, opacity, viewport);
-            setPixel(x+0, y+1, 0, color, opacity, viewport);
-            setPixel(x+1, y+1, 0, color, opacity, viewport);
-        }
+    if (primitive->flags & IS_ROTATED) {
+        quat inv_rotation = conjugate(primitive->rotation);
+        *out_position = mulVec3Quat(*out_position, inv_rotation);
+        *out_direction = mulVec3Quat(dir, inv_rotation);
     } else
-        for (i32 x = first; x <= last; x += step)
-            setPixel(x, y, 0, color, opacity, viewport);
+        *out_direction = dir;
+
+    if (primitive->flags & IS_SCALED) {
+        vec3 inv_scale = oneOverVec3(primitive->scale);
+        *out_position = mulVec3(*out_position, inv_scale);
+        if (primitive->flags & IS_SCALED_NON_UNIFORMLY)
+            *out_direction = normVec3(mulVec3(*out_direction, inv_scale));
+    }
 }
 
-void drawVLine(i32 y_start, i32 y_end, i32 x, vec3 color, f32 opacity, Viewport *viewport) {
-    y_start += viewport->position.y;
-    y_end   += viewport->position.y;
-    x       += viewport->position.x;
+void updatePrimitiveMatrices(Primitive *primitive) {
+    if (!(primitive->flags & IS_DIRTY)) return;
 
-    if (!inRange(x, viewport->dimensions.width + viewport->position.x, viewport->position.x)) return;
-    i32 first, last, step = 1;
+    vec3 scale = primitive->flags & IS_SCALED ? primitive->scale : getVec3Of(1);
+    mat3 rotation;
+    rotation.X = Vec3(1, 0, 0);
+    rotation.Y = Vec3(0, 1, 0);
+    rotation.Z = Vec3(0, 0, 1);
+    if (primitive->flags & IS_ROTATED) {
+        rotation.X = mulVec3Quat(rotation.X, primitive->rotation);
+        rotation.Y = mulVec3Quat(rotation.Y, primitive->rotation);
+        rotation.Z = mulVec3Quat(rotation.Z, primitive->rotation);
+    }
 
-    subRange(y_start, y_end, viewport->dimensions.height + viewport->position.y, viewport->position.y, &first, &last);
-    color = mulVec3(color, color);
-    if (viewport->settings.antialias) {
-        x <<= 1;
-        first <<= 1;
-        last  <<= 1;
-        step = 2;
-        for (i32 y = first; y <= last; y += step) {
-            setPixel(x+0, y+0, 0, color, opacity, viewport);
-            setPixel(x+1, y+0, 0, color, opacity, viewport);
-            setPixel(x+0, y+1, 0, color, opacity, viewport);
-            setPixel(x+1, y+1, 0, color, opacity, viewport);
-        }
-    } else
-        for (i32 y = first; y <= last; y += step)
-            setPixel(x, y, 0, color, opacity, viewport);
-}
+    mat3x4 *M = &primitive->world_matrix;
+    M->X = scaleVec3(rotation.X, scale.x);
+    M->Y = scaleVec3(rotation.Y, scale.y);
+    M->Z = scaleVec3(rotation.Z, scale.z);
+    M->W = primitive->flags & IS_TRANSLATED ? primitive->position : getVec3Of(0);
 
-INLINE f32 fractionOf(f32 x) {
-    return x - floorf(x);
-}
+    // The inverse un-translates, un-rotates (by the transposed rotation) and then un-scales:
+    vec3 inv_scale = oneOverVec3(scale);
+    mat3 inverse;
+    inverse.X = mulVec3(Vec3(rotation.X.x, rotation.Y.x, rotation.Z.x), inv_scale);
+    inverse.Y = mulVec3(Vec3(rotation.X.y, rotation.Y.y, rotation.Z.y), inv_scale);
+    inverse.Z = mulVec3(Vec3(rotation.X.z, rotation.Y.z, rotation.Z.z), inv_scale);
 
-INLINE f32 oneMinusFractionOf(f32 x) {
-    return 1 - fractionOf(x);
+    mat3x4 *I = &primitive->world_matrix_inverted;
+    I->X = inverse.X;
+    I->Y = inverse.Y;
+    I->Z = inverse.Z;
+    I->W = invertedVec3(mulVec3Mat3(M->W, inverse));
+
+    primitive->flags &= (u8)~IS_DIRTY;
 }
 
-INLINE void drawLine(f32 x1, f32 y1, f64 z1,
-                     f32 x2, f32 y2, f64 z2,
-                     vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    if (x1 < 0 &&
-        y1 < 0 &&
-        x2 < 0 &&
-        y2 < 0)
-        return;
+// Returns a matrix that transforms positions from the primitive's object space directly into the view space of the
+// given camera transform. It is computed once per draw call, so that each vertex is transformed with a single multiply.
+INLINE mat3x4 getPrimitiveViewMatrix(Primitive *primitive, xform3 *camera_transform) {
+    updatePrimitiveMatrices(primitive);
 
-    i32 x_left = viewport->position.x;
-    i32 y_top  = viewport->position.y;
-    x1 += (f32)x_left;
-    x2 += (f32)x_left;
-    y1 += (f32)y_top;
-    y2 += (f32)y_top;
+    mat3x4 view_matrix = primitive->world_matrix;
+    view_matrix.W = subVec3(view_matrix.W, camera_transform->position);
+    mulVec3ArrayQuat(view_matrix.axis, 4, getXform3InvertedRotation(camera_transform), view_matrix.axis);
 
-    i32 w = viewport->dimensions.width + x_left;
-    i32 h = viewport->dimensions.height + y_top;
+    return view_matrix;
+}
 
-    color = mulVec3(color, color);
-    i32 x, y;
+INLINE vec3 convertPositionToWorldSpace(vec3 position, Primitive *primitive) {
+    if (primitive->flags & IS_SCALED)     position = mulVec3(    position, primitive->scale);
+    if (primitive->flags & IS_ROTATED)    position = mulVec3Quat(position, primitive->rotation);
+    if (primitive->flags & IS_TRANSLATED) position = addVec3(    position, primitive->position);
+    return position;
+}
+INLINE vec3 convertPositionToObjectSpace(vec3 position, Primitive *primitive) {
+    if (primitive->flags & IS_TRANSLATED) position = subVec3(    position, primitive->position);
+    if (primitive->flags & IS_ROTATED)    position = mulVec3Quat(position, conjugate(primitive->rotation));
+    if (primitive->flags & IS_SCALED)     position = mulVec3(position, oneOverVec3(primitive->scale));
+    return position;
+}
+
+INLINE vec3 convertDirectionToWorldSpace(vec3 direction, Primitive *primitive) {
+    if (primitive->flags & IS_SCALED_NON_UNIFORMLY) direction = mulVec3(direction, oneOverVec3(primitive->scale));
+    if (primitive->flags & IS_ROTATED)              direction = mulVec3Quat(direction,         primitive->rotation);
+    return direction;
+}
+
+void rotatePrimitive(Primitive *primitive, f32 yaw, f32 pitch, f32 roll) {
+    quat rotation;
+    if (roll) {
+        rotation.amount = roll;
+        rotation.axis.x = 0;
+        rotation.axis.y = 0;
+        rotation.axis.z = 1;
+    } else
+        rotation = getIdentityQuaternion();
+
+    if (pitch) {
+        quat pitch_rotation;
+        pitch_rotation.amount = pitch;
+        pitch_rotation.axis.x = 1;
+        pitch_rotation.axis.y = 0;
+        pitch_rotation.axis.z = 0;
+        pitch_rotation = normQuat(pitch_rotation);
+        rotation = mulQuat(rotation, pitch_rotation);
+        rotation = normQuat(rotation);
+    }
+
+    if (yaw) {
+        quat yaw_rotation;
+        yaw_rotation.amount = yaw;
+        yaw_rotation.axis.x = 0;
+        yaw_rotation.axis.y = 1;
+        yaw_rotation.axis.z = 0;
+        yaw_rotation = normQuat(yaw_rotation);
+        rotation = mulQuat(rotation, yaw_rotation);
+        rotation = normQuat(rotation);
+    }
+
+    primitive->rotation = mulQuat(primitive->rotation, rotation);
+    primitive->rotation = normQuat(primitive->rotation);
+    primitive->flags |= IS_DIRTY;
+}
+
+
+INLINE vec4 getVec4Of(f32 value) {
+    vec4 out;
+
+    out.x = out.y = out.z = out.w = value;
+
+    return out;
+}
+
+INLINE vec4 invertedVec4(vec4 in) {
+    vec4 out;
+
+    out.x = -in.x;
+    out.y = -in.y;
+    out.z = -in.z;
+    out.w = -in.w;
+
+    return out;
+}
+
+INLINE vec4 approachVec4(vec4 src, vec4 trg, f32 diff) {
+    vec4 out;
+
+    out.x = approach(src.x, trg.x, diff);
+    out.y = approach(src.y, trg.y, diff);
+    out.z = approach(src.z, trg.z, diff);
+    out.w = approach(src.w, trg.w, diff);
+
+    return out;
+}
+
+INLINE bool nonZeroVec4(vec4 v) {
+    return v.x != 0 ||
+           v.y != 0 ||
+           v.z != 0 ||
+           v.w != 0;
+}
+
+INLINE vec4 subVec4(vec4 a, vec4 b) {
+    vec4 out;
+
+    out.x = a.x - b.x;
+    out.y = a.y - b.y;
+    out.z = a.z - b.z;
+    out.w = a.w - b.w;
+
+    return out;
+}
+
+INLINE vec4 addVec4(vec4 a, vec4 b) {
+    vec4 out;
+
+    out.x = a.x + b.x;
+    out.y = a.y + b.y;
+    out.z = a.z + b.z;
+    out.w = a.w + b.w;
+
+    return out;
+}
+
+INLINE vec4 mulVec4(vec4 a, vec4 b) {
+    vec4 out;
+
+    out.x = a.x * b.x;
+    out.y = a.y * b.y;
+    out.z = a.z * b.z;
+    out.w = a.w * b.w;
+
+    return out;
+}
+
+INLINE vec4 scaleVec4(vec4 a, f32 factor) {
+    vec4 out;
+
+    out.x = a.x * factor;
+    out.y = a.y * factor;
+    out.z = a.z * factor;
+    out.w = a.w * factor;
+
+    return out;
+}
+INLINE vec4 scaleAddVec4(vec4 v, f32 factor, vec4 to_be_added) {
+    vec4 out;
+
+    out.x = fast_mul_add(v.x, factor, to_be_added.x);
+    out.y = fast_mul_add(v.y, factor, to_be_added.y);
+    out.z = fast_mul_add(v.z, factor, to_be_added.z);
+    out.w = fast_mul_add(v.w, factor, to_be_added.w);
+
+    return out;
+}
+
+INLINE vec4 mulVec4Mat4(vec4 in, mat4 m) {
+    vec4 out;
+
+#ifdef SLIM_ENGINE_SIMD
+    storeSIMD(out.components, mulSIMDByRows(in.x, in.y, in.z, in.w,
+                                            loadSIMD(m.X.components),
+                                            loadSIMD(m.Y.components),
+                                            loadSIMD(m.Z.components),
+                                            loadSIMD(m.W.components)));
+#else
+    out.x = in.x * m.X.x + in.y * m.Y.x + in.z * m.Z.x + in.w * m.W.x;
+    out.y = in.x * m.X.y + in.y * m.Y.y + in.z * m.Z.y + in.w * m.W.y;
+    out.z = in.x * m.X.z + in.y * m.Y.z + in.z * m.Z.z + in.w * m.W.z;
+    out.w = in.x * m.X.w + in.y * m.Y.w + in.z * m.Z.w + in.w * m.W.w;
+#endif
+
+    return out;
+}
+
+// Transforms an array of vectors (in place when in == out), loading the matrix only once.
+INLINE void mulVec4ArrayMat4(const vec4 *in, u32 count, mat4 m, vec4 *out) {
+#ifdef SLIM_ENGINE_SIMD
+    simd4 X = loadSIMD(m.X.components);
+    simd4 Y = loadSIMD(m.Y.components);
+    simd4 Z = loadSIMD(m.Z.components);
+    simd4 W = loadSIMD(m.W.components);
+    for (u32 i = 0; i < count; i++, in++, out++)
+        storeSIMD(out->components, mulSIMDByRows(in->x, in->y, in->z, in->w, X, Y, Z, W));
+#else
+    for (u32 i = 0; i < count; i++, in++, out++) *out = mulVec4Mat4(*in, m);
+#endif
+}
+
+INLINE f32 dotVec4(vec4 a, vec4 b) {
+    return (
+            (a.x * b.x) +
+            (a.y * b.y) +
+            (a.z * b.z) +
+            (a.w * b.w)
+    );
+}
+
+INLINE f32 squaredLengthVec4(vec4 v) {
+    return (
+            (v.x * v.x) +
+            (v.y * v.y) +
+            (v.z * v.z) +
+            (v.w * v.w)
+    );
+}
+
+INLINE f32 lengthVec4(vec4 v) {
+    return sqrtf(squaredLengthVec4(v));
+}
+
+INLINE vec4 norm4(vec4 v) {
+    return scaleVec4(v, 1.0f / lengthVec4(v));
+}
+
+INLINE f32 mulVec3Mat4(vec3 in, f32 w, mat4 M, vec3 *out) {
+    vec4 v4 = mulVec4Mat4(Vec4fromVec3(in, w), M);
+    *out = Vec3fromVec4(v4);
+    return v4.w;
+}
+
+INLINE vec4 lerpVec4(vec4 from, vec4 to, f32 by) {
+    return scaleAddVec4(subVec4(to, from), by, from);
+}
+
+
+void drawHLine(i32 x_start, i32 x_end, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
+    x_start += viewport->position.x;
+    x_end   += viewport->position.x;
+    y       += viewport->position.y;
+
+    if (!inRange(y, viewport->dimensions.height + viewport->position.y, viewport->position.y)) return;
+    if (!isRowInViewportBand(viewport->settings.antialias ? y << 1 : y, viewport)) return;
+
+    i32 first, last, step = 1;
+    subRange(x_start, x_end, viewport->dimensions.width + viewport->position.x, viewport->position.x, &first, &last);
+
+    color = mulVec3(color, color);
     if (viewport->settings.antialias) {
-        x1 += x1;
-        x2 += x2;
-        y1 += y1;
-        y2 += y2;
-        w <<= 1;
-        h <<= 1;
-        line_width <<= 1;
-        line_width++;
+        y <<= 1;
+        first <<= 1;
+        last  <<= 1;
+        step = 2;
+        for (i32 x = first; x <= last; x += step) {
+            setPixel(x+0, y+0, 0, color, opacity, viewport);
+            setPixel(x+1, y+0, 0, color, opacity, viewport);
+            setPixel(x+0, y+1, 0, color, opacity, viewport);
+            setPixel(x+1, y+1, 0, color, opacity, viewport);
+        }
+    } else
+        for (i32 x = first; x <= last; x += step)
+            setPixel(x, y, 0, color, opacity, viewport);
+}
+
+void drawVLine(i32 y_start, i32 y_end, i32 x, vec3 color, f32 opacity, Viewport *viewport) {
+    y_start += viewport->position.y;
+    y_end   += viewport->position.y;
+    x       += viewport->position.x;
+
+    if (!inRange(x, viewport->dimensions.width + viewport->position.x, viewport->position.x)) return;
+    i32 first, last, step = 1;
+
+    subRange(y_start, y_end, viewport->dimensions.height + viewport->position.y, viewport->position.y, &first, &last);
+    color = mulVec3(color, color);
+    if (viewport->settings.antialias) {
+        x <<= 1;
+        first <<= 1;
+        last  <<= 1;
+        step = 2;
+        for (i32 y = first; y <= last; y += step) {
+            setPixel(x+0, y+0, 0, color, opacity, viewport);
+            setPixel(x+1, y+0, 0, color, opacity, viewport);
+            setPixel(x+0, y+1, 0, color, opacity, viewport);
+            setPixel(x+1, y+1, 0, color, opacity, viewport);
+        }
+    } else
+        for (i32 y = first; y <= last; y += step)
+            setPixel(x, y, 0, color, opacity, viewport);
+}
+
+INLINE f32 fractionOf(f32 x) {
+    return x - floorf(x);
+}
+
+INLINE f32 oneMinusFractionOf(f32 x) {
+    return 1 - fractionOf(x);
+}
+
+INLINE void drawLine(f32 x1, f32 y1, f64 z1,
+                     f32 x2, f32 y2, f64 z2,
+                     vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    if (x1 < 0 &&
+        y1 < 0 &&
+        x2 < 0 &&
+        y2 < 0)
+        return;
+
+    COUNT_RASTERIZER_STAT(viewport, lines);
+
+    i32 x_left = viewport->position.x;
+    i32 y_top  = viewport->position.y;
+    x1 += (f32)x_left;
+    x2 += (f32)x_left;
+    y1 += (f32)y_top;
+    y2 += (f32)y_top;
+
+    i32 w = viewport->dimensions.width + x_left;
+    i32 h = viewport->dimensions.height + y_top;
+
+    color = mulVec3(color, color);
+    i32 x, y;
+    if (viewport->settings.antialias) {
+        x1 += x1;
+        x2 += x2;
+        y1 += y1;
+        y2 += y2;
+        w <<= 1;
+        h <<= 1;
+        x_left <<= 1;
+        y_top  <<= 1;
+        line_width <<= 1;
+        line_width++;
+    }
+
+    // Only the rows of the viewport's band are drawn into (when drawing it from one of multiple threads):
+    i32 y_first = y_top;
+    if (viewport->band_bottom) {
+        y_first = viewport->position.y + viewport->band_top;
+        h       = viewport->position.y + viewport->band_bottom;
+        if (viewport->settings.antialias) {
+            y_first <<= 1;
+            h       <<= 1;
+        }
+        if ((y1 < y2 ? y2 : y1) + (f32)line_width + 2 < (f32)y_first ||
+            (y1 < y2 ? y1 : y2) - 1 >= (f32)h)
+            return;
+    }
+
+    f64 tmp, z_range, range_remap;
+    f32 dx = x2 - x1;
+    f32 dy = y2 - y1;
+    f32 gap, grad, first_offset, last_offset;
+    f64 z, z_curr = 0, z_step = 0;
+    vec3 first, last;
+    vec2i start, end;
+    bool has_depth = z1 || z2;
+    if (fabsf(dx) > fabsf(dy)) { // Shallow:
+        if (x2 < x1) { // Left to right:
+            tmp = x2; x2 = x1; x1 = (f32)tmp;
+            tmp = y2; y2 = y1; y1 = (f32)tmp;
+            tmp = z2; z2 = z1; z1 = tmp;
+        }
+
+        grad = dy / dx;
+
+        first.x = roundf(x1);
+        last.x  = roundf(x2);
+        first_offset = first.x - x1;
+        last_offset  = last.x  - x2;
+
+        first.y = y1 + grad * first_offset;
+        last.y  = y2 + grad * last_offset;
+
+        start.x = (i32)first.x;
+        start.y = (i32)first.y;
+        end.x   = (i32)last.x;
+        end.y   = (i32)last.y;
+
+        x = start.x;
+        y = start.y;
+        gap = oneMinusFractionOf(x1 + 0.5f);
+
+        if (inRange(x, w, x_left)) {
+            if (inRange(y, h, y_first)) setPixel(x, y, z1, color, oneMinusFractionOf(first.y) * gap * opacity, viewport);
+
+            for (u8 i = 0; i < line_width; i++) {
+                y++;
+                if (inRange(y, h, y_first)) setPixel(x, y, z1, color, opacity, viewport);
+            }
+
+            y++;
+            if (inRange(y, h, y_first)) setPixel(x, y, z1, color, fractionOf(first.y) * gap * opacity, viewport);
+        }
+
+        x = end.x;
+        y = end.y;
+        gap = fractionOf(x2 + 0.5f);
+
+        if (inRange(x, w, x_left)) {
+            if (inRange(y, h, y_first)) setPixel(x, y, z2, color, oneMinusFractionOf(last.y) * gap * opacity, viewport);
+
+            for (u8 i = 0; i < line_width; i++) {
+                y++;
+                if (inRange(y, h, y_first)) setPixel(x, y, z2, color, opacity, viewport);
+            }
+
+            y++;
+            if (inRange(y, h, y_first)) setPixel(x, y, z2, color, fractionOf(last.y) * gap * opacity, viewport);
+        }
+
+        if (has_depth) { // Compute one-over-z start and step
+            z1 = 1.0 / z1;
+            z2 = 1.0 / z2;
+            z_range = z2 - z1;
+            range_remap = z_range / (f64)(x2 - x1);
+            z1 += range_remap * (f64)(first_offset + 1);
+            z2 += range_remap * (f64)(last_offset  - 1);
+            z_range = z2 - z1;
+            z_step = z_range / (f64)(last.x - first.x - 1);
+            z_curr = z1;
+        } else z = 0;
+
+        gap = first.y + grad;
+        for (x = start.x + 1; x < end.x; x++) {
+            if (inRange(x, w, x_left)) {
+                if (has_depth) z = 1.0 / z_curr;
+                y = (i32) gap;
+                if (inRange(y, h, y_first)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
+
+                for (u8 i = 0; i < line_width; i++) {
+                    y++;
+                    if (inRange(y, h, y_first)) setPixel(x, y, z, color, opacity, viewport);
+                }
+
+                y++;
+                if (inRange(y, h, y_first)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
+            }
+
+            gap += grad;
+            if (has_depth) z_curr += z_step;
+        }
+    } else { // Steep:
+        if (y2 < y1) { // Bottom up:
+            tmp = x2; x2 = x1; x1 = (f32)tmp;
+            tmp = y2; y2 = y1; y1 = (f32)tmp;
+            tmp = z2; z2 = z1; z1 = tmp;
+        }
+
+        grad = dx / dy;
+
+        first.y = roundf(y1);
+        last.y  = roundf(y2);
+
+        first_offset = y1 - first.y;
+        last_offset  = last.y  - y2;
+
+        first.x = x1 + grad * first_offset;
+        last.x  = x2 + grad * last_offset;
+
+        start.y = (i32)first.y;
+        start.x = (i32)first.x;
+
+        end.y = (i32)last.y;
+        end.x = (i32)last.x;
+
+        x = start.x;
+        y = start.y;
+        gap = oneMinusFractionOf(y1 + 0.5f);
+
+        if (inRange(y, h, y_first)) {
+            if (inRange(x, w, x_left)) setPixel(x, y, z1, color, oneMinusFractionOf(first.x) * gap * opacity, viewport);
+
+            for (u8 i = 0; i < line_width; i++) {
+                x++;
+                if (inRange(x, w, x_left)) setPixel(x, y, z1, color, opacity, viewport);
+            }
+
+            x++;
+            if (inRange(x, w, x_left)) setPixel(x, y, z1, color, fractionOf(first.x) * gap * opacity, viewport);
+        }
+
+        x = end.x;
+        y = end.y;
+        gap = fractionOf(y2 + 0.5f);
+
+        if (inRange(y, h, y_first)) {
+            if (inRange(x, w, x_left)) setPixel(x, y, z2, color, oneMinusFractionOf(last.x) * gap * opacity, viewport);
+
+            for (u8 i = 0; i < line_width; i++) {
+                x++;
+                if (inRange(x, w, x_left)) setPixel(x, y, z2, color, opacity, viewport);
+            }
+
+            x++;
+            if (inRange(x, w, x_left)) setPixel(x, y, z2, color, fractionOf(last.x) * gap * opacity, viewport);
+        }
+
+        if (has_depth) { // Compute one-over-z start and step
+            z1 = 1.0 / z1;
+            z2 = 1.0 / z2;
+            z_range = z2 - z1;
+            range_remap = z_range / (f64)(y2 - y1);
+            z1 += range_remap * (f64)(first_offset + 1);
+            z2 += range_remap * (f64)(last_offset  - 1);
+            z_range = z2 - z1;
+            z_step = z_range / (f64)(last.y - first.y - 1);
+            z_curr = z1;
+        } else z = 0;
+
+        gap = first.x + grad;
+        for (y = start.y + 1; y < end.y; y++) {
+            if (inRange(y, h, y_first)) {
+                if (has_depth) z = 1.0 / z_curr;
+                x = (i32)gap;
+
+                if (inRange(x, w, x_left)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
+
+                for (u8 i = 0; i < line_width; i++) {
+                    x++;
+                    if (inRange(x, w, x_left)) setPixel(x, y, z, color, opacity, viewport);
+                }
+
+                x++;
+                if (inRange(x, w, x_left)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
+            }
+
+            gap += grad;
+            if (has_depth) z_curr += z_step;
+        }
+    }
+}
+
+//INLINE void swapf(f32 *a, f32 *b) {
+//    f32 t = *a;
+//    *a = *b;
+//    *b = t;
+//}
+//
+//f32 fpart(f32 x) {
+//    return x - floorf(x);
+//}
+//
+//f32 rfpart(f32 x) {
+//    return 1.0f - fpart(x);
+//}
+//
+//#define getPixel(x, y, canvas) ((canvas)->pixels + (canvas)->dimensions.width * (y) + (x))
+//#define plot(x, y, opacity, color, canvas) (setPixel(getPixel(x, y, canvas), (color), opacity, 0, (canvas)->settings.gamma_corrected_blending))
+//
+//
+//INLINE void drawLinehh(PixelGrid *canvas, vec3 color, f32 opacity,
+//                     f32 x1, f32 y1, f64 z1,
+//                     f32 x2, f32 y2, f64 z2,
+//                     u8 line_width) {
+//    bool steep = fabsf(y2 - y1) > fabsf(x2 - x1);
+//
+//    if (steep) {
+//        swapf(&x1, &y1);
+//        swapf(&x2, &y2);
+//    }
+//
+//    if (x1 > x2) {
+//        swapf(&x1, &x2);
+//        swapf(&y1, &y2);
+//    }
+//
+//    f32 dx = x2 - x1;
+//    f32 dy = y2 - y1;
+//    f32 gradient = dx ? (dy / dx) : 1.0f;
+//
+//    // handle first endpoint
+//    f32 xend = roundf(x1);
+//    f32 yend = y1 + gradient * (xend - x1);
+//    f32 xgap = rfpart(x1 + 0.5f);
+//    i32 xpxl1 = (i32)xend; // this will be used in the main loop
+//    i32 ypxl1 = (i32)yend;
+//    if (steep) {
+//        plot(   ypxl1    , xpxl1, rfpart(yend) * xgap, color, canvas);
+//        plot(ypxl1 + 1, xpxl1,  fpart(yend) * xgap, color, canvas);
+//    } else {
+//        plot(xpxl1,    ypxl1    , rfpart(yend) * xgap, color, canvas);
+//        plot(xpxl1, ypxl1 + 1,  fpart(yend) * xgap, color, canvas);
+//    }
+//
+//    f32 intery = yend + gradient; // first y-intersection for the main loop
+//
+//    // handle second endpoint
+//    xend = roundf(x2);
+//    yend = y2 + gradient * (xend - x2);
+//    xgap = fpart(x2 + 0.5f);
+//    i32 xpxl2 = (i32)xend; //this will be used in the main loop
+//    i32 ypxl2 = (i32)yend;
+//    if (steep) {
+//        plot(   ypxl2    , xpxl2, rfpart(yend) * xgap, color, canvas);
+//        plot(ypxl2 + 1, xpxl2,  fpart(yend) * xgap, color, canvas);
+//    } else {
+//        plot(xpxl2,    ypxl2    , rfpart(yend) * xgap, color, canvas);
+//        plot(xpxl2, ypxl2 + 1,  fpart(yend) * xgap, color, canvas);
+//    }
+//
+//    // main loop
+//    if (steep) {
+//        for (i32 x = xpxl1 + 1; x < xpxl2 - 1; x++, intery += gradient) {
+//            plot((i32)intery    , x, rfpart(intery), color, canvas);
+//            plot((i32)intery + 1, x,  fpart(intery), color, canvas);
+//        }
+//    } else {
+//        for (i32 x = xpxl1 + 1; x < xpxl2 - 1; x++, intery += gradient) {
+//            plot(x, (i32)intery   ,  rfpart(intery), color, canvas);
+//            plot(x, (i32)intery + 1,  fpart(intery), color, canvas);
+//        }
+//    }
+//}
+
+
+bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
+    f32 distance = viewport->settings.near_clipping_plane_distance;
+    vec3 A = edge->from;
+    vec3 B = edge->to;
+
+    u8 out = (A.z < distance) | ((B.z < distance) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, (distance - A.z) / (B.z - A.z));
+        else         B = lerpVec3(B, A, (distance - B.z) / (A.z - B.z));
+    }
+
+    distance = viewport->settings.far_clipping_plane_distance;
+    out = (A.z > distance) | ((B.z > distance) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, (A.z - distance) / (A.z - B.z));
+        else         B = lerpVec3(B, A, (B.z - distance) / (B.z - A.z));
+    }
+
+    // Left plane (facing to the right):
+    vec3 N = Vec3(viewport->camera->focal_length, 0, viewport->dimensions.width_over_height);
+    f32 NdotA = dotVec3(N, A);
+    f32 NdotB = dotVec3(N, B);
+
+    out = (NdotA < 0) | ((NdotB < 0) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
+        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
+    }
+
+    // Right plane (facing to the left):
+    N.x = -N.x;
+    NdotA = dotVec3(N, A);
+    NdotB = dotVec3(N, B);
+
+    out = (NdotA < 0) | ((NdotB < 0) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
+        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
+    }
+
+    // Bottom plane (facing up):
+    N = Vec3(0, viewport->camera->focal_length, 1);
+    NdotA = dotVec3(N, A);
+    NdotB = dotVec3(N, B);
+
+    out = (NdotA < 0) | ((NdotB < 0) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
+        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
+    }
+
+    // Top plane (facing down):
+    N.y = -N.y;
+    NdotA = dotVec3(N, A);
+    NdotB = dotVec3(N, B);
+
+    out = (NdotA < 0) | ((NdotB < 0) << 1);
+    if (out) {
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
+        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
+        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
+    }
+
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    if (!(isEqualVec3(A, edge->from) && isEqualVec3(B, edge->to)))
+        COUNT_RASTERIZER_STAT(viewport, clipped_edges);
+#endif
+
+    edge->from = A;
+    edge->to   = B;
+
+    return true;
+}
+
+INLINE bool projectEdge(Edge *edge, Viewport *viewport) {
+    if (!cullAndClipEdge(edge, viewport))
+        return false;
+
+    vec4 A = mulVec4Mat4(Vec4fromVec3(edge->from, 1.0f), viewport->projection_matrix);
+    vec4 B = mulVec4Mat4(Vec4fromVec3(edge->to,   1.0f), viewport->projection_matrix);
+
+    // Project:
+    edge->from = scaleVec3(Vec3fromVec4(A), 1.0f / A.w);
+    edge->to   = scaleVec3(Vec3fromVec4(B), 1.0f / B.w);
+
+    // NDC->screen:
+    edge->from.x += 1; edge->from.x *= viewport->dimensions.h_width;
+    edge->to.x   += 1; edge->to.x   *= viewport->dimensions.h_width;
+    edge->from.y += 1; edge->from.y *= viewport->dimensions.h_height;
+    edge->to.y   += 1; edge->to.y   *= viewport->dimensions.h_height;
+
+    // Flip Y:
+    edge->from.y = viewport->dimensions.f_height - edge->from.y;
+    edge->to.y   = viewport->dimensions.f_height - edge->to.y;
+
+    return true;
+}
+
+INLINE void drawEdge(Edge *edge, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    COUNT_RASTERIZER_STAT(viewport, edges);
+
+    if (projectEdge(edge, viewport))
+        drawLine(edge->from.x, edge->from.y, edge->from.z,
+                 edge->to.x,   edge->to.y,   edge->to.z,
+                 color, opacity, line_width, viewport);
+}
+
+//
+//INLINE f32 clipFactor(f32 Aw, f32 Bw, f32 a, f32 b, bool negative_w) {
+//    if (negative_w)
+//        b = -b;
+//    else
+//        a = -a;
+//
+//    f32 numerator = Aw + a;
+//    return numerator / (numerator - Bw + b);
+//}
+//
+//INLINE bool cullAndClipEdgeInClipSpace(vec4 *A, vec4 *B) {
+//    u8 A_flags = (A->x > A->w) | ((A->x < -A->w) * 2) | ((A->y > A->w) * 4) | ((A->y < -A->w) * 8) | ((A->z > A->w) * 16) | ((A->z < -A->w) * 32);
+//    u8 B_flags = (B->x > B->w) | ((B->x < -B->w) * 2) | ((B->y > B->w) * 4) | ((B->y < -B->w) * 8) | ((B->z > B->w) * 16) | ((B->z < -B->w) * 32);
+//
+//    // Cull:
+//    if (A_flags & B_flags)
+//        return false;
+//
+//    // Clip:
+//    if (A_flags | B_flags) {
+//        if (     A_flags & 3) *A = lerpVec4(*B, *A, clipFactor(B->w, A->w, B->x, A->x, A_flags & 2));
+//        else if (B_flags & 3) *B = lerpVec4(*A, *B, clipFactor(A->w, B->w, A->x, B->x, B_flags & 2));
+//
+//        if (     A_flags & 12) *A = lerpVec4(*B, *A, clipFactor(B->w, A->w, B->y, A->y, A_flags & 8));
+//        else if (B_flags & 12) *B = lerpVec4(*A, *B, clipFactor(A->w, B->w, A->y, B->y, B_flags & 8));
+//
+//        if (     A_flags & 48) *A = lerpVec4(*B, *A, clipFactor(B->w, A->w, B->z, A->z, A_flags & 32));
+//        else if (B_flags & 48) *B = lerpVec4(*A, *B, clipFactor(A->w, B->w, A->z, B->z, B_flags & 32));
+//    }
+//
+//    return true;
+//}
+//
+//INLINE bool cullAndClipEdge2(Edge *edge, Viewport *viewport) {
+//    vec4 A = mulVec4Mat4(Vec4fromVec3(edge->from, 1.0f), viewport->projection_matrix);
+//    vec4 B = mulVec4Mat4(Vec4fromVec3(edge->to,   1.0f), viewport->projection_matrix);
+//
+//    if (cullAndClipEdgeInClipSpace(&A, &B)) {
+//        edge->from = Vec3fromVec4(mulVec4Mat4(A, viewport->pre_projection_matrix_inverted));
+//        edge->to   = Vec3fromVec4(mulVec4Mat4(B, viewport->pre_projection_matrix_inverted));
+//        return true;
+//    } else
+//        return false;
+//}
+
+
+INLINE bool areCurvePointsCurrent(Curve *curve, enum PrimitiveType type) {
+    return curve->points_primitive_type == (u8)type &&
+           curve->points_thickness == curve->thickness &&
+           curve->points_revolution_count == curve->revolution_count;
+}
+
+// Generates the object-space polyline of a helix or a coil into the curve's cache (accumulating rotations step by step).
+// Step counts above the capacity of the cache (CURVE_STEPS) are clamped to it.
+void updateCurvePoints(Curve *curve, u32 step_count, enum PrimitiveType type) {
+    if (step_count > curve->points_capacity) step_count = curve->points_capacity;
+    if (curve->point_count == step_count && areCurvePointsCurrent(curve, type))
+        return;
+
+    curve->point_count = step_count;
+    curve->points_primitive_type = (u8)type;
+    curve->points_thickness = curve->thickness;
+    curve->points_revolution_count = curve->revolution_count;
+
+    f32 one_over_step_count = 1.0f / (f32)step_count;
+    f32 rotation_step = one_over_step_count * TAU;
+    f32 rotation_step_times_rev_count = rotation_step * (f32)curve->revolution_count;
+
+    if (type == PrimitiveType_Helix)
+        rotation_step = rotation_step_times_rev_count;
+
+    vec3 center_to_orbit;
+    center_to_orbit.x = 1;
+    center_to_orbit.y = center_to_orbit.z = 0;
+
+    vec3 orbit_to_curve;
+    orbit_to_curve.x = curve->thickness;
+    orbit_to_curve.y = orbit_to_curve.z = 0;
+
+    mat3 rotation;
+    rotation.X.x = rotation.Z.z = cosf(rotation_step);
+    rotation.X.z = sinf(rotation_step);
+    rotation.Z.x = -rotation.X.z;
+    rotation.X.y = rotation.Z.y = rotation.Y.x = rotation.Y.z =  0;
+    rotation.Y.y = 1;
+
+    mat3 orbit_to_curve_rotation;
+    if (type == PrimitiveType_Coil) {
+        orbit_to_curve_rotation.X.x = orbit_to_curve_rotation.Y.y = cosf(rotation_step_times_rev_count);
+        orbit_to_curve_rotation.X.y = sinf(rotation_step_times_rev_count);
+        orbit_to_curve_rotation.Y.x = -orbit_to_curve_rotation.X.y;
+        orbit_to_curve_rotation.X.z = orbit_to_curve_rotation.Y.z = orbit_to_curve_rotation.Z.x = orbit_to_curve_rotation.Z.y =  0;
+        orbit_to_curve_rotation.Z.z = 1;
+    }
+
+    mat3 accumulated_orbit_rotation = rotation;
+    vec3 *current_position = curve->points;
+
+    for (u32 i = 0; i < step_count; i++, current_position++) {
+        center_to_orbit = mulVec3Mat3(center_to_orbit, rotation);
+
+        switch (type) {
+            case PrimitiveType_Helix:
+                *current_position = center_to_orbit;
+                current_position->y -= 1;
+                center_to_orbit.y += 2 * one_over_step_count;
+                break;
+            case PrimitiveType_Coil:
+                orbit_to_curve  = mulVec3Mat3(orbit_to_curve, orbit_to_curve_rotation);
+                *current_position = mulVec3Mat3(orbit_to_curve, accumulated_orbit_rotation);
+                *current_position = addVec3(center_to_orbit, *current_position);
+                accumulated_orbit_rotation = mulMat3(accumulated_orbit_rotation, rotation);
+                break;
+            default:
+                *current_position = getVec3Of(0);
+                break;
+        }
+    }
+}
+
+// Returns the number of steps needed for a circle of the given on-screen radius (in pixels) to be drawn with
+// segments that deviate from it by no more than the given tolerance (in pixels) - for the given number of revolutions.
+INLINE f32 getCircleStepCount(f32 radius, f32 tolerance, f32 revolution_count) {
+    if (radius <= tolerance) return 4 * revolution_count;
+
+    return revolution_count * TAU / (2 * acosf(1 - tolerance / radius));
+}
+
+// Chooses how many steps to draw a curve with, from its projected size on screen and its curvature:
+// Helices wind around a single circle, while coils also wind around their (smaller and tighter) orbit.
+// The projected size is conservatively estimated from the nearest point of the curve's bounding sphere.
+// A curve tolerance of 0 (in the viewport's settings) disables this, using the given maximum step count always.
+u32 getCurveStepCount(Curve *curve, u32 max_step_count, Primitive *primitive, mat3x4 *object_to_view, Viewport *viewport) {
+    f32 tolerance = viewport->settings.curve_tolerance;
+    if (tolerance <= 0) return max_step_count;
+
+    f32 squared_scale = squaredLengthVec3(object_to_view->X);
+    f32 squared_axis_scale = squaredLengthVec3(object_to_view->Y);
+    if (squared_axis_scale > squared_scale) squared_scale = squared_axis_scale;
+    squared_axis_scale = squaredLengthVec3(object_to_view->Z);
+    if (squared_axis_scale > squared_scale) squared_scale = squared_axis_scale;
+    f32 scale = sqrtf(squared_scale);
+
+    f32 thickness = primitive->type == PrimitiveType_Coil ? curve->thickness : 0;
+    f32 bounding_radius = scale * (primitive->type == PrimitiveType_Coil ? 1 + thickness : SQRT2);
+    f32 nearest_depth = object_to_view->W.z - bounding_radius;
+    if (nearest_depth <= viewport->settings.near_clipping_plane_distance) return max_step_count;
+
+    f32 pixels_per_unit = viewport->camera->focal_length * viewport->dimensions.h_height / nearest_depth;
+    f32 revolution_count = (f32)curve->revolution_count;
+    f32 step_count;
+    if (primitive->type == PrimitiveType_Coil) {
+        step_count = getCircleStepCount(scale * pixels_per_unit, tolerance, 1);
+        f32 orbit_step_count = getCircleStepCount(scale * thickness * pixels_per_unit, tolerance, revolution_count);
+        if (orbit_step_count > step_count) step_count = orbit_step_count;
+    } else
+        step_count = getCircleStepCount(scale * pixels_per_unit, tolerance, revolution_count);
+
+    // Round up to a granularity, so that the cached polyline isn't regenerated on every small change of the view:
+    u32 steps = (u32)step_count + CURVE__STEPS_GRANULARITY;
+    steps -= steps % CURVE__STEPS_GRANULARITY;
+    if (steps < CURVE__MIN_STEPS) steps = CURVE__MIN_STEPS;
+
+    return steps < max_step_count ? steps : max_step_count;
+}
+
+// The polyline is only regenerated when the curve's parameters change, so each frame just transforms its points.
+// The given step count is the maximum, with fewer steps used for curves that are small on screen (see above).
+// When a curve is drawn into several viewports in turn, it keeps the steps of the one that needs the most of them:
+// A viewport that needs fewer steps draws the cached polyline as is, and only the viewport it was last sized for can
+// shrink it (otherwise each viewport would regenerate the polyline for itself on every frame).
+void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawCurve");
+
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    if (!viewport->has_prepared_curves) {
+        u32 needed_step_count = getCurveStepCount(curve, step_count, primitive, &object_to_view, viewport);
+        if (needed_step_count > curve->point_count ||
+            curve->points_viewport == viewport ||
+            !areCurvePointsCurrent(curve, primitive->type)) {
+            updateCurvePoints(curve, needed_step_count, primitive->type);
+            curve->points_viewport = viewport;
+        }
+    }
+
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    // Counted in segments: A polyline of N points has N - 1 of them.
+    u32 max_point_count = step_count < curve->points_capacity ? step_count : curve->points_capacity;
+    u32 segment_count = curve->point_count ? curve->point_count - 1 : 0;
+    u32 max_segment_count = max_point_count ? max_point_count - 1 : 0;
+    ADD_RASTERIZER_STAT(viewport, curve_segments, segment_count);
+    ADD_RASTERIZER_STAT(viewport, saved_curve_segments, max_segment_count > segment_count ? max_segment_count - segment_count : 0);
+#endif
+
+    // Transform vertices positions of edges from view-space to screen-space (w/ culling and clipping):
+    vec3 *position = curve->points;
+    vec3 current_position, previous_position;
+    Edge edge;
+    for (u32 i = 0; i < curve->point_count; i++, position++) {
+        current_position = mulVec3Mat3x4(*position, object_to_view);
+        if (i) {
+            edge.from = previous_position;
+            edge.to   = current_position;
+            drawEdge(&edge, color, opacity, line_width, viewport);
+        }
+        previous_position = current_position;
+    }
+
+    PROFILE_END();
+}
+
+
+// Draws a scene from multiple threads, each drawing a horizontal band of the viewport (see Viewport.band_top).
+//
+// Splitting the primitives across threads instead would have them race on the pixels that their primitives share,
+// as blending is order-dependent and the depth of a pixel is read, compared and then written. With bands, every pixel
+// is written by a single thread, in the same order as when drawing serially, so the result is identical.
+// Each thread still transforms and clips all of the edges (only to skip the lines that are outside of its band),
+// which is the price paid for splitting the rasterization (most of the work) without any locking.
+//
+// The draw functions keep no scratch memory of their own, but some of them lazily update cached state that is shared:
+// The matrices of primitives, the inverted rotation of the camera and the polylines of curves.
+// These are brought up to date serially before the threads start (with curves prepared for drawing with CURVE_STEPS).
+// When drawing for multiple viewports at once, each curve is tessellated for the viewport that needs the most steps.
+typedef struct SceneDrawingBands {
+    Viewport *viewports;
+    Scene *scene;
+    CallbackForSceneDrawing drawScene;
+} SceneDrawingBands;
+
+void prepareSceneForDrawing(Scene *scene, Viewport **viewports, u32 viewport_count) {
+    for (u32 v = 0; v < viewport_count; v++)
+        updateXform3Rotation(&viewports[v]->camera->transform);
+
+    Primitive *primitive = scene->primitives;
+    for (u32 i = 0; i < scene->settings.primitives; i++, primitive++) {
+        updatePrimitiveMatrices(primitive);
+        if (primitive->type == PrimitiveType_Coil ||
+            primitive->type == PrimitiveType_Helix) {
+            Curve *curve = scene->curves + primitive->id;
+            u32 step_count = 0;
+            for (u32 v = 0; v < viewport_count; v++) {
+                mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewports[v]->camera->transform);
+                u32 viewport_step_count = getCurveStepCount(curve, CURVE_STEPS, primitive, &object_to_view, viewports[v]);
+                if (step_count < viewport_step_count) step_count = viewport_step_count;
+            }
+            updateCurvePoints(curve, step_count, primitive->type);
+            curve->points_viewport = viewport_count == 1 ? viewports[0] : null;
+        }
+    }
+}
+
+void drawSceneBand(void *data, u32 index) {
+    SceneDrawingBands *bands = (SceneDrawingBands*)data;
+    bands->drawScene(bands->scene, bands->viewports + index);
+}
+
+// The viewports of the bands only last for the call, so they are allocated from the given memory (meant to be
+// the app's frame memory) and popped off of it before returning. Without room for them the scene is drawn as a whole.
+void drawSceneInParallel(Scene *scene, Viewport *viewport, CallbackForSceneDrawing drawScene, Memory *memory, Platform *platform) {
+    u32 band_count = platform->runInParallel ? platform->thread_count : 1;
+    u32 max_band_count = viewport->dimensions.height / PARALLEL__MIN_BAND_HEIGHT;
+    if (band_count > max_band_count) band_count = max_band_count;
+    if (band_count > PARALLEL__MAX_THREADS) band_count = PARALLEL__MAX_THREADS;
+    MemoryMarker marker = pushMemoryMarker(memory);
+    SceneDrawingBands bands;
+    bands.viewports = band_count > 1 && !viewport->band_bottom ?
+                      (Viewport*)allocateMemory(memory, sizeof(Viewport) * band_count) : null;
+    if (!bands.viewports) {
+        drawScene(scene, viewport);
+        return;
+    }
+
+    PROFILE_BEGIN("drawSceneInParallel");
+
+    prepareSceneForDrawing(scene, &viewport, 1);
+
+    bands.scene = scene;
+    bands.drawScene = drawScene;
+    i32 height = viewport->dimensions.height;
+    RasterizerStats empty_stats = {0};
+    for (u32 i = 0; i < band_count; i++) {
+        Viewport *band = bands.viewports + i;
+        *band = *viewport;
+        band->band_top    = (i32)((u32)height * i       / band_count);
+        band->band_bottom = (i32)((u32)height * (i + 1) / band_count);
+        band->stats = empty_stats;
+        band->has_prepared_curves = true;
+    }
+
+    profiler.paused = true;
+    platform->runInParallel(drawSceneBand, &bands, band_count);
+    profiler.paused = false;
+
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    // Every band goes through all of the geometry, while the pixels are split between them:
+    RasterizerStats *stats = &viewport->stats;
+    RasterizerStats *geometry_stats = &bands.viewports[0].stats;
+    stats->edges                += geometry_stats->edges;
+    stats->culled_edges         += geometry_stats->culled_edges;
+    stats->clipped_edges        += geometry_stats->clipped_edges;
+    stats->lines                += geometry_stats->lines;
+    stats->curve_segments       += geometry_stats->curve_segments;
+    stats->saved_curve_segments += geometry_stats->saved_curve_segments;
+    for (u32 i = 0; i < band_count; i++) {
+        RasterizerStats *band_stats = &bands.viewports[i].stats;
+        stats->pixels             += band_stats->pixels;
+        stats->blended_pixels     += band_stats->blended_pixels;
+        stats->overwritten_pixels += band_stats->overwritten_pixels;
+    }
+#endif
+    popMemoryMarker(memory, marker);
+
+    PROFILE_END();
+}
+
+
+// Objects are added into the pooled slots that were allocated up front (see SceneSettings.max_*), which are reused
+// once their objects are removed. The scene's settings keep counting the slots that were ever used, so existing
+// loops over them keep working - removed primitives are left with a type of PrimitiveType_None (so are skipped).
+// A null is returned when the pool is full, and the handle (if given) can later be checked for staleness.
+u32 _addSceneObject(ObjectPool *pool, u32 *used_slot_count, ObjectHandle *handle) {
+    ObjectHandle new_handle = allocatePoolSlot(pool);
+    if (handle) *handle = new_handle;
+    if (new_handle.index != POOL__INVALID_INDEX &&
+        new_handle.index >= *used_slot_count)
+        *used_slot_count = new_handle.index + 1;
+
+    return new_handle.index;
+}
+
+Primitive* addPrimitive(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->primitive_pool, &scene->settings.primitives, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initPrimitive(scene->primitives + index);
+    return scene->primitives + index;
+}
+
+Curve* addCurve(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->curve_pool, &scene->settings.curves, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initCurve(scene->curves + index);
+    return scene->curves + index;
+}
+
+Box* addBox(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->box_pool, &scene->settings.boxes, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initBox(scene->boxes + index);
+    return scene->boxes + index;
+}
+
+Grid* addGrid(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->grid_pool, &scene->settings.grids, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initGrid(scene->grids + index, 3, 3);
+    return scene->grids + index;
+}
+
+// Note: The mesh's data is loaded into the given memory, which is not reclaimed when the mesh is removed.
+Mesh* addMesh(Scene *scene, char *file_path, ObjectHandle *handle, Platform *platform, Memory *memory) {
+    u32 index = _addSceneObject(&scene->mesh_pool, &scene->settings.meshes, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    loadMeshFromFile(scene->meshes + index, file_path, platform, memory);
+    return scene->meshes + index;
+}
+
+bool removePrimitive(Scene *scene, ObjectHandle handle) {
+    if (!freePoolSlot(&scene->primitive_pool, handle)) return false;
+
+    scene->primitives[handle.index].type = PrimitiveType_None;
+    return true;
+}
+
+// Whether any primitive draws the object of the given id (curves are drawn by both helix and coil primitives):
+bool isSceneObjectReferenced(Scene *scene, enum PrimitiveType type, u32 id) {
+    Primitive *primitive = scene->primitives;
+    for (u32 i = 0; i < scene->settings.primitives; i++, primitive++)
+        if (primitive->id == id && (primitive->type == type || (type == PrimitiveType_Helix &&
+                                                                primitive->type == PrimitiveType_Coil)))
+            return true;
+
+    return false;
+}
+
+// Objects that are still drawn by any primitive are not removed (false is returned), as their slots would otherwise
+// be drawn by those primitives while free (or once reused, as another object) - their primitives are removed first.
+bool _removeSceneObject(Scene *scene, ObjectPool *pool, enum PrimitiveType type, ObjectHandle handle) {
+    return isValidObjectHandle(pool, handle) && !isSceneObjectReferenced(scene, type, handle.index) &&
+           freePoolSlot(pool, handle);
+}
+
+INLINE bool removeCurve(Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->curve_pool, PrimitiveType_Helix, handle); }
+INLINE bool removeBox(  Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->box_pool,   PrimitiveType_Box,   handle); }
+INLINE bool removeGrid( Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->grid_pool,  PrimitiveType_Grid,  handle); }
+INLINE bool removeMesh( Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->mesh_pool,  PrimitiveType_Mesh,  handle); }
+
+
+// Input recordings are a small header (magic and version) followed by a stream of events, each stored as:
+// ticks (8 bytes), frame (4), x or amount (4), y (4), type (1) and code (1) - where the code is either the key
+// or the mouse button (0: left, 1: middle, 2: right). Events are tagged with the frame they occurred before,
+// so that a replay can feed them back at the same frame boundaries regardless of the original frame timings.
+
+bool writeInputEvent(InputEvent *event, void *file, Platform *platform) {
+    return (
+        platform->writeToFile(&event->ticks, sizeof(u64), file) &&
+        platform->writeToFile(&event->frame, sizeof(u32), file) &&
+        platform->writeToFile(&event->x,     sizeof(i32), file) &&
+        platform->writeToFile(&event->y,     sizeof(i32), file) &&
+        platform->writeToFile(&event->type,  sizeof(u8),  file) &&
+        platform->writeToFile(&event->code,  sizeof(u8),  file)
+    );
+}
+
+bool readInputEvent(InputEvent *event, void *file, Platform *platform) {
+    return (
+        platform->readFromFile(&event->ticks, sizeof(u64), file) &&
+        platform->readFromFile(&event->frame, sizeof(u32), file) &&
+        platform->readFromFile(&event->x,     sizeof(i32), file) &&
+        platform->readFromFile(&event->y,     sizeof(i32), file) &&
+        platform->readFromFile(&event->type,  sizeof(u8),  file) &&
+        platform->readFromFile(&event->code,  sizeof(u8),  file)
+    );
+}
+
+bool startInputRecording(InputRecording *recording, char *file_path, Platform *platform) {
+    if (recording->is_recording || recording->is_replaying) return false;
+
+    recording->file = platform->openFileForWriting(file_path);
+    if (!recording->file) return false;
+
+    u32 magic = INPUT_RECORDING__MAGIC;
+    u32 version = INPUT_RECORDING__VERSION;
+    if (!(platform->writeToFile(&magic,   sizeof(u32), recording->file) &&
+          platform->writeToFile(&version, sizeof(u32), recording->file))) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        return false;
+    }
+
+    recording->frame = 0;
+    recording->is_recording = true;
+
+    return true;
+}
+
+void recordInputEvent(InputRecording *recording, enum InputEventType type, u8 code, i32 x, i32 y, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    InputEvent event;
+    event.ticks = platform->getTicks();
+    event.frame = recording->frame;
+    event.type = (u8)type;
+    event.code = code;
+    event.x = x;
+    event.y = y;
+    if (!writeInputEvent(&event, recording->file, platform)) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        recording->is_recording = false;
+    }
+}
+
+void recordMouseWheelScrolled(InputRecording *recording, f32 amount, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    InputEvent event;
+    event.amount = amount;
+    event._ = 0;
+    recordInputEvent(recording, InputEvent_MouseWheelScrolled, 0, event.x, event.y, platform);
+}
+
+void stopInputRecording(InputRecording *recording, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    recordInputEvent(recording, InputEvent_EndOfRecording, 0, 0, 0, platform);
+    if (recording->file) platform->closeFile(recording->file);
+    recording->file = null;
+    recording->is_recording = false;
+}
+
+bool startInputReplay(InputRecording *recording, char *file_path, Platform *platform) {
+    if (recording->is_recording || recording->is_replaying) return false;
+
+    recording->file = platform->openFileForReading(file_path);
+    if (!recording->file) return false;
+
+    u32 magic, version;
+    if (!(platform->readFromFile(&magic,   sizeof(u32), recording->file) &&
+          platform->readFromFile(&version, sizeof(u32), recording->file) &&
+          magic   == INPUT_RECORDING__MAGIC &&
+          version == INPUT_RECORDING__VERSION &&
+          readInputEvent(&recording->next_event, recording->file, platform))) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        return false;
+    }
+
+    recording->frame = 0;
+    recording->is_replaying = true;
+
+    return true;
+}
+
+void stopInputReplay(InputRecording *recording, Platform *platform) {
+    if (!recording->is_replaying) return;
+
+    platform->closeFile(recording->file);
+    recording->file = null;
+    recording->is_replaying = false;
+}
+
+// Returns the next event due at the current frame (if any) and advances the replay past it.
+bool getNextInputEventOfFrame(InputRecording *recording, InputEvent *event, Platform *platform) {
+    if (!recording->is_replaying ||
+        recording->next_event.frame != recording->frame ||
+        recording->next_event.type == InputEvent_EndOfRecording)
+        return false;
+
+    *event = recording->next_event;
+    if (!readInputEvent(&recording->next_event, recording->file, platform)) {
+        recording->next_event.type = InputEvent_EndOfRecording;
+        recording->next_event.frame = recording->frame + 1;
+    }
+
+    return true;
+}
+
+// Returns the number of frames that were drawn while recording.
+u32 getInputRecordingFrameCount(char *file_path, Platform *platform) {
+    InputRecording recording;
+    recording.is_recording = recording.is_replaying = false;
+    if (!startInputReplay(&recording, file_path, platform)) return 0;
+
+    InputEvent event = recording.next_event;
+    u32 frame_count = 0;
+    do {
+        if (event.type == InputEvent_EndOfRecording) frame_count = event.frame;
+        else if (event.frame >= frame_count) frame_count = event.frame + 1;
+    } while (readInputEvent(&event, recording.file, platform));
+    stopInputReplay(&recording, platform);
+
+    return frame_count;
+}
+
+INLINE u8 getMouseButtonCode(Mouse *mouse, MouseButton *mouse_button) {
+    return mouse_button == &mouse->left_button ? 0 : (mouse_button == &mouse->middle_button ? 1 : 2);
+}
+
+INLINE MouseButton* getMouseButtonOfCode(Mouse *mouse, u8 code) {
+    return code == 0 ? &mouse->left_button : (code == 1 ? &mouse->middle_button : &mouse->right_button);
+}
+
+
+void setString(String *string, char *char_ptr) {
+    string->char_ptr = char_ptr;
+    string->length = 0;
+    if (char_ptr)
+        while (char_ptr[string->length])
+            string->length++;
+}
+
+u32 getStringLength(char *string) {
+    char *char_ptr = string;
+    u32 length = 0;
+    if (char_ptr) while (char_ptr[length]) length++;
+    return length;
+}
+
+u32 getDirectoryLength(char *path) {
+    u32 path_len = getStringLength(path);
+    u32 dir_len = path_len;
+    while (path[dir_len] != '/' && path[dir_len] != '\\') dir_len--;
+    return dir_len + 1;
+}
+
+void copyToString(String *string, char* char_ptr, u32 offset) {
+    string->length = offset;
+    char *source_char = char_ptr;
+    char *string_char = string->char_ptr + offset;
+    while (source_char[0]) {
+        *string_char = *source_char;
+        string_char++;
+        source_char++;
+        string->length++;
+    }
+    *string_char = 0;
+}
+
+void mergeString(String *string, char* first, char* second, u32 offset) {
+    copyToString(string, first, 0);
+    copyToString(string, second, offset);
+}
+
+void printNumberIntoString(i32 number, NumberString *number_string) {
+    initNumberString(number_string);
+    char *buffer = number_string->_buffer;
+    buffer[12] = 0;
+
+    bool is_negative = number < 0;
+    if (is_negative) number = -number;
+
+    if (number) {
+        u32 temp;
+        buffer += 11;
+        number_string->string.char_ptr = buffer;
+        number_string->string.length = 0;
+
+        for (u8 i = 0; i < 11; i++) {
+            temp = number;
+            number /= 10;
+            number_string->string.length++;
+            *buffer-- = (char)('0' + temp - number * 10);
+            if (!number) {
+                if (is_negative) {
+                    *buffer = '-';
+                    number_string->string.char_ptr--;
+                    number_string->string.length++;
+                }
+
+                break;
+            }
+            number_string->string.char_ptr--;
+        }
+    } else {
+        buffer[11] = '0';
+        number_string->string.length = 1;
+        number_string->string.char_ptr = buffer + 11;
+    }
+}
+
+// Counts (like those of the rasterizer's stats) are 64-bit, so they may not fit in the 12 characters of a number string:
+// Those that don't are scaled down by thousands, and printed with a suffix of K, M, G, T, P or E for the scale.
+void printCountIntoString(u64 count, NumberString *number_string) {
+    initNumberString(number_string);
+    char *buffer = number_string->_buffer;
+    buffer[12] = 0;
+    buffer += 12;
+
+    const char *suffixes = " KMGTPE";
+    u8 scale = 0;
+    while (count > (scale ? 99999999999ULL : 999999999999ULL)) {
+        count /= 1000;
+        scale++;
+    }
+    number_string->string.length = 0;
+    if (scale) {
+        *--buffer = suffixes[scale];
+        number_string->string.length++;
+    }
+    do {
+        *--buffer = (char)('0' + count % 10);
+        number_string->string.length++;
+        count /= 10;
+    } while (count);
+    number_string->string.char_ptr = buffer;
+}
+
+void printFloatIntoString(f32 number, NumberString *number_string, u8 float_digits_count) {
+    f32 factor = 1;
+    for (u8 i = 0; i < float_digits_count; i++) factor *= 10;
+    i32 int_num = (i32)(number * factor);
+    if (int_num == 0) {
+        printNumberIntoString((i32)factor, number_string);
+        number_string->string.length++;
+        number_string->string.char_ptr[0] = '.';
+        number_string->string.char_ptr--;
+        number_string->string.char_ptr[0] = '0';
+        return;
+    }
+
+    bool is_negative = number < 0;
+    bool is_fraction = is_negative ? number > -1 : number < 1;
+
+    printNumberIntoString(int_num, number_string);
+
+    if (is_fraction) {
+        u32 len = number_string->string.length;
+        number_string->string.length++;
+        number_string->string.char_ptr--;
+        if (is_negative) {
+            number_string->string.char_ptr[0] = '-';
+            number_string->string.char_ptr[1] = '0';
+        } else {
+            number_string->string.char_ptr[0] = '0';
+        }
+        if (len < float_digits_count) {
+            for (u32 i = 0; i < (float_digits_count - len); i++) {
+                number_string->string.length++;
+                number_string->string.char_ptr--;
+                number_string->string.char_ptr[0] = '0';
+            }
+        }
+    }
+
+    char tmp[13];
+    tmp[number_string->string.length + 1] = 0;
+    for (u8 i = 0; i < (u8)number_string->string.length; i++) {
+        u8 char_count_from_right_to_left = (u8)number_string->string.length - i - 1;
+        if (char_count_from_right_to_left >= float_digits_count) tmp[i] = number_string->string.char_ptr[i];
+        else                                                     tmp[i + 1] = number_string->string.char_ptr[i];
+    }
+    tmp[number_string->string.length - float_digits_count] = '.';
+    copyToString(&number_string->string, tmp, 0);
+    if (is_negative) number_string->string.length++;
+}
+
+
+#define FONT_WIDTH 18
+#define FONT_HEIGHT 24
+#define LINE_HEIGHT 30
+#define FIRST_CHARACTER_CODE 32
+#define LAST_CHARACTER_CODE 126
+#define GLYPH_COUNT (LAST_CHARACTER_CODE - FIRST_CHARACTER_CODE + 1)
+#define GLYPH_ATLAS__MAX_SPANS 4096
+
+// Header File for SSD1306 characters
+// Generated with TTF2BMH
+// Font JetBrains Mono Regular
+// Font Size: 24
+u8 bitmap_32[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_33[] = {0,0,0,0,0,0,62,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0};
+u8 bitmap_34[] = {0,0,0,0,254,254,0,0,0,254,254,254,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_35[] = {0,0,192,192,192,252,254,192,192,192,192,252,254,192,192,0,0,0,0,96,96,240,255,111,96,96,96,240,255,111,96,96,0,0,0,0,0,0,12,15,1,0,0,0,12,15,1,0,0,0,0,0,0,0};
+u8 bitmap_36[] = {0,0,112,248,252,14,6,255,255,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,6,255,255,12,28,248,240,192,0,0,0,0,0,0,3,7,14,12,12,255,255,12,12,15,7,1,0,0,0,0};
+u8 bitmap_37[] = {0,252,206,2,2,6,252,120,0,0,0,128,192,64,96,0,0,0,0,192,97,49,17,25,13,4,246,59,9,9,24,240,224,0,0,0,0,0,0,0,0,0,0,0,7,14,8,8,12,7,3,0,0,0};
+u8 bitmap_38[] = {0,0,0,252,252,142,6,6,6,14,28,24,0,0,0,0,0,0,0,248,252,254,3,3,15,28,120,240,224,248,60,12,4,0,0,0,0,1,7,7,14,12,12,14,6,7,1,7,14,12,8,0,0,0};
+u8 bitmap_39[] = {0,0,0,0,0,0,126,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_40[] = {0,0,0,0,0,240,252,62,7,3,1,1,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,7,15,28,56,112,96,96,0,0,0,0,0};
+u8 bitmap_41[] = {0,0,0,0,1,1,3,15,254,248,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,96,112,48,56,30,15,3,0,0,0,0,0,0,0,0};
+u8 bitmap_42[] = {0,0,0,0,0,0,0,240,240,0,0,0,0,0,0,0,0,0,0,3,3,131,198,246,124,15,61,118,230,199,131,3,2,0,0,0,0,0,0,1,1,0,0,0,0,0,1,1,0,0,0,0,0,0};
+u8 bitmap_43[] = {0,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,0,0,0,0,24,24,24,24,24,255,255,24,24,24,24,24,0,0,0,0,0,0,0,0,0,0,0,3,3,0,0,0,0,0,0,0,0,0};
+u8 bitmap_44[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,15,1,0,0,0,0,0,0,0,0};
+u8 bitmap_45[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,6,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_46[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,7,0,0,0,0,0,0,0,0};
+u8 bitmap_47[] = {0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,224,248,127,15,1,0,0,0,0,0,0,0,0,0,0,96,120,127,15,1,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_48[] = {0,0,240,248,60,14,6,134,134,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,31,63,63,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_49[] = {0,0,0,56,24,28,14,254,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,15,12,12,12,12,0,0,0,0};
+u8 bitmap_50[] = {0,0,56,60,28,14,6,6,6,14,28,252,248,0,0,0,0,0,0,0,0,0,128,192,224,112,48,28,15,7,3,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_51[] = {0,0,6,6,6,6,134,198,102,54,62,30,14,0,0,0,0,0,0,0,128,128,0,3,3,3,3,7,14,254,252,96,0,0,0,0,0,0,1,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_52[] = {0,0,0,0,0,128,192,240,120,30,14,2,0,0,0,0,0,0,0,0,240,252,254,199,195,192,192,192,192,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_53[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,7,7,7,6,3,3,3,3,7,254,252,240,0,0,0,0,0,0,1,7,7,14,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_54[] = {0,0,0,0,128,224,240,60,30,6,2,0,0,0,0,0,0,0,0,0,248,254,15,5,2,3,3,3,7,254,252,240,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_55[] = {0,0,62,62,6,6,6,6,6,6,230,254,126,14,0,0,0,0,0,0,0,0,0,0,128,224,252,63,15,1,0,0,0,0,0,0,0,0,0,0,8,14,15,7,1,0,0,0,0,0,0,0,0,0};
+u8 bitmap_56[] = {0,0,112,248,252,14,6,6,6,14,12,252,248,0,0,0,0,0,0,0,240,249,29,15,6,6,6,7,15,253,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_57[] = {0,0,240,248,28,14,6,6,6,6,12,252,248,224,0,0,0,0,0,0,3,7,15,14,12,140,204,244,126,31,7,1,0,0,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,0,0,0,0};
+u8 bitmap_58[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,15,6,0,0,0,0,0,0,0,0};
+u8 bitmap_59[] = {0,0,0,0,0,0,224,224,224,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,240,255,63,7,1,0,0,0,0,0,0,0,0};
+u8 bitmap_60[] = {0,0,0,0,0,128,128,192,192,224,96,112,48,0,0,0,0,0,0,0,14,15,27,27,49,49,96,96,192,192,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,0,0};
+u8 bitmap_61[] = {0,0,192,192,192,192,192,192,192,192,192,192,192,192,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_62[] = {0,0,48,112,96,96,192,192,128,128,0,0,0,0,0,0,0,0,0,0,128,192,192,224,96,112,49,57,27,27,14,0,0,0,0,0,0,0,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_63[] = {0,0,0,0,6,6,6,6,6,12,252,248,224,0,0,0,0,0,0,0,0,0,0,124,124,124,12,14,7,3,0,0,0,0,0,0,0,0,0,0,0,14,14,14,4,0,0,0,0,0,0,0,0,0};
+u8 bitmap_64[] = {0,192,240,120,28,14,6,6,134,134,142,12,252,248,192,0,0,0,0,255,255,0,0,0,252,255,7,1,1,3,253,255,255,0,0,0,0,15,63,120,224,192,193,131,135,134,6,2,1,7,7,0,0,0};
+u8 bitmap_65[] = {0,0,0,0,128,240,254,14,62,254,224,0,0,0,0,0,0,0,0,0,128,248,255,127,97,96,96,99,127,254,224,0,0,0,0,0,0,8,15,15,1,0,0,0,0,0,0,3,15,15,0,0,0,0};
+u8 bitmap_66[] = {0,0,254,254,254,6,6,6,6,14,14,252,248,32,0,0,0,0,0,0,255,255,255,6,6,6,6,6,15,253,249,240,0,0,0,0,0,0,15,15,15,12,12,12,12,12,14,7,3,1,0,0,0,0};
+u8 bitmap_67[] = {0,0,224,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_68[] = {0,0,254,254,254,6,6,6,6,14,28,252,248,192,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,15,15,15,12,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_69[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_70[] = {0,0,254,254,254,6,6,6,6,6,6,6,6,6,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,6,6,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_71[] = {0,0,240,248,60,14,6,6,6,14,14,60,56,32,0,0,0,0,0,0,255,255,128,0,0,12,12,12,12,252,252,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_72[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,6,6,6,6,6,6,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_73[] = {0,0,6,6,6,6,6,254,254,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0,0};
+u8 bitmap_74[] = {0,0,0,6,6,6,6,6,6,6,6,254,254,0,0,0,0,0,0,128,128,128,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,1,0,0,0,0,0};
+u8 bitmap_75[] = {0,0,254,254,254,0,0,0,128,224,240,124,30,6,2,0,0,0,0,0,255,255,255,6,6,6,31,127,248,224,128,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,1,7,15,14,8,0,0,0};
+u8 bitmap_76[] = {0,0,0,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,12,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_77[] = {0,0,254,254,14,248,192,0,0,224,124,230,254,254,0,0,0,0,0,0,255,255,0,0,7,14,15,3,0,255,255,255,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,15,15,15,0,0,0,0};
+u8 bitmap_78[] = {0,0,254,254,14,124,240,128,0,0,0,254,254,0,0,0,0,0,0,0,255,255,0,0,3,15,126,240,128,255,255,0,0,0,0,0,0,0,15,15,0,0,0,0,0,3,15,15,15,0,0,0,0,0};
+u8 bitmap_79[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_80[] = {0,0,254,254,254,6,6,6,6,6,14,28,252,248,0,0,0,0,0,0,255,255,255,12,12,12,12,12,14,7,7,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_81[] = {0,0,240,248,60,14,6,6,6,14,12,252,248,192,0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,255,255,127,0,0,0,0,0,0,1,3,7,14,12,12,12,62,254,231,131,0,0,0,0,0};
+u8 bitmap_82[] = {0,0,254,254,254,6,6,6,6,6,14,188,248,240,0,0,0,0,0,0,255,255,255,12,12,12,28,252,254,199,3,1,0,0,0,0,0,0,15,15,15,0,0,0,0,0,3,15,15,12,0,0,0,0};
+u8 bitmap_83[] = {0,0,96,248,252,14,6,6,6,6,14,60,56,32,0,0,0,0,0,0,128,129,3,7,7,6,14,12,28,248,248,224,0,0,0,0,0,0,1,7,7,14,12,12,12,12,14,7,3,1,0,0,0,0};
+u8 bitmap_84[] = {0,6,6,6,6,6,6,254,254,6,6,6,6,6,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
+u8 bitmap_85[] = {0,0,254,254,254,0,0,0,0,0,0,254,254,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_86[] = {0,2,62,254,224,0,0,0,0,0,128,248,254,30,0,0,0,0,0,0,0,3,63,254,224,0,128,248,255,15,0,0,0,0,0,0,0,0,0,0,0,3,15,14,15,15,0,0,0,0,0,0,0,0};
+u8 bitmap_87[] = {0,254,254,0,0,0,252,62,254,224,0,0,240,254,62,0,0,0,0,3,255,255,0,252,63,0,1,255,224,0,255,255,0,0,0,0,0,0,15,15,8,15,0,0,0,3,15,15,15,0,0,0,0,0};
+u8 bitmap_88[] = {0,2,6,30,124,240,192,0,128,224,248,62,14,2,0,0,0,0,0,0,0,0,192,241,127,31,63,249,224,192,0,0,0,0,0,0,0,8,14,15,3,1,0,0,0,0,1,7,15,12,8,0,0,0};
+u8 bitmap_89[] = {0,6,30,124,240,192,0,0,0,128,224,248,62,14,2,0,0,0,0,0,0,0,1,7,31,252,252,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0};
+u8 bitmap_90[] = {0,0,6,6,6,6,6,6,134,230,246,62,14,0,0,0,0,0,0,0,0,0,192,240,124,30,7,1,0,0,0,0,0,0,0,0,0,0,14,15,15,12,12,12,12,12,12,12,12,0,0,0,0,0};
+u8 bitmap_91[] = {0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,63,63,63,48,48,48,48,0,0,0,0,0,0};
+u8 bitmap_92[] = {0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,254,240,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,31,126,112,64,0,0,0,0};
+u8 bitmap_93[] = {0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,48,48,48,48,63,63,0,0,0,0,0,0,0,0};
+u8 bitmap_94[] = {0,0,0,0,224,248,62,7,15,60,240,192,0,0,0,0,0,0,0,0,4,7,3,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_95[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,96,96,96,96,96,96,96,96,96,96,96,96,0,0,0,0};
+u8 bitmap_96[] = {0,0,0,0,0,0,1,7,6,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_97[] = {0,0,0,192,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,225,241,57,24,24,24,24,24,24,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,12,6,3,15,15,0,0,0,0,0};
+u8 bitmap_98[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,15,15,15,6,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_99[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,131,131,130,0,0,0,0,0,0,0,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_100[] = {0,0,0,192,192,224,96,96,96,192,128,254,254,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,1,7,7,14,12,12,12,6,3,15,15,0,0,0,0,0};
+u8 bitmap_101[] = {0,0,0,128,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,255,255,155,24,24,24,24,24,24,31,31,28,0,0,0,0,0,0,1,3,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_102[] = {0,0,128,128,128,128,252,254,142,134,134,134,134,134,0,0,0,0,0,0,1,1,1,1,255,255,1,1,1,1,1,1,0,0,0,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_103[] = {0,0,0,192,192,224,96,96,96,192,128,224,224,0,0,0,0,0,0,0,255,255,129,0,0,0,0,0,129,255,255,0,0,0,0,0,0,0,0,3,135,135,134,134,134,194,225,255,127,0,0,0,0,0};
+u8 bitmap_104[] = {0,0,254,254,254,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_105[] = {0,0,0,96,96,96,98,103,231,231,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,12,12,12,12,12,12,15,15,12,12,12,12,0,0,0,0};
+u8 bitmap_106[] = {0,0,0,96,96,96,96,96,103,231,231,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,128,128,128,128,128,192,224,127,63,0,0,0,0,0,0,0};
+u8 bitmap_107[] = {0,0,254,254,254,0,0,0,0,0,128,192,224,96,32,0,0,0,0,0,255,255,255,48,48,48,124,254,199,3,0,0,0,0,0,0,0,0,15,15,15,0,0,0,0,1,3,7,14,12,8,0,0,0};
+u8 bitmap_108[] = {0,6,6,6,6,6,254,254,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,3,7,14,12,12,12,12,12,0,0,0,0};
+u8 bitmap_109[] = {0,0,224,224,64,96,224,192,0,192,96,224,224,192,0,0,0,0,0,0,255,255,0,0,0,255,255,0,0,0,255,255,0,0,0,0,0,0,15,15,0,0,0,15,15,0,0,0,15,15,0,0,0,0};
+u8 bitmap_110[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,1,255,255,0,0,0,0,0,0,0,15,15,15,0,0,0,0,0,0,15,15,0,0,0,0,0};
+u8 bitmap_111[] = {0,0,0,128,192,224,96,96,96,224,192,192,128,0,0,0,0,0,0,0,255,255,131,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,1,3,7,14,12,12,12,14,6,7,3,0,0,0,0,0};
+u8 bitmap_112[] = {0,0,224,224,224,192,64,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,124,0,0,0,0,0,0,255,255,255,6,12,12,12,14,14,7,3,0,0,0,0,0};
+u8 bitmap_113[] = {0,0,0,128,192,224,96,96,96,192,128,224,224,224,0,0,0,0,0,0,254,255,255,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,0,3,7,14,12,12,12,6,2,255,255,255,0,0,0,0};
+u8 bitmap_114[] = {0,0,0,224,224,128,192,96,96,96,224,224,192,128,0,0,0,0,0,0,0,255,255,1,0,0,0,0,0,1,7,7,0,0,0,0,0,0,0,15,15,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_115[] = {0,0,0,192,192,224,96,96,96,96,224,192,128,0,0,0,0,0,0,0,3,15,31,24,24,24,56,48,48,241,225,0,0,0,0,0,0,0,3,7,7,14,12,12,12,12,14,7,3,0,0,0,0,0};
+u8 bitmap_116[] = {0,0,96,96,96,96,254,254,96,96,96,96,96,96,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,7,14,12,12,12,12,0,0,0,0,0};
+u8 bitmap_117[] = {0,0,224,224,224,0,0,0,0,0,0,224,224,0,0,0,0,0,0,0,255,255,255,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,3,7,14,12,12,12,14,7,7,3,0,0,0,0,0};
+u8 bitmap_118[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,63,252,224,0,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,1,15,15,15,7,0,0,0,0,0,0,0,0};
+u8 bitmap_119[] = {0,224,224,0,0,0,192,224,224,0,0,0,128,224,96,0,0,0,0,3,255,252,0,224,255,1,15,254,0,128,255,127,0,0,0,0,0,0,3,15,8,15,0,0,0,7,15,15,15,0,0,0,0,0};
+u8 bitmap_120[] = {0,0,32,224,224,128,0,0,0,0,192,224,96,32,0,0,0,0,0,0,0,0,129,199,255,124,126,239,195,1,0,0,0,0,0,0,0,8,12,14,7,3,0,0,0,1,3,15,14,8,0,0,0,0};
+u8 bitmap_121[] = {0,32,224,224,128,0,0,0,0,0,0,192,224,96,0,0,0,0,0,0,0,7,31,254,240,128,128,240,254,31,3,0,0,0,0,0,0,0,0,0,0,128,243,255,63,7,0,0,0,0,0,0,0,0};
+u8 bitmap_122[] = {0,0,96,96,96,96,96,96,96,96,96,224,224,0,0,0,0,0,0,0,0,0,192,224,112,56,28,14,7,3,1,0,0,0,0,0,0,0,14,15,15,13,12,12,12,12,12,12,12,12,0,0,0,0};
+u8 bitmap_123[] = {0,0,0,0,0,0,0,135,255,255,0,0,0,0,0,0,0,0,0,0,3,3,3,3,3,7,253,248,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,7,31,31,56,48,48,0,0,0,0,0};
+u8 bitmap_124[] = {0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,255,255,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,127,127,0,0,0,0,0,0,0,0,0};
+u8 bitmap_125[] = {0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,252,255,7,3,3,3,3,0,0,0,0,0,0,0,48,48,48,56,31,15,0,0,0,0,0,0,0,0,0,0};
+u8 bitmap_126[] = {0,0,0,128,128,128,128,0,0,0,0,0,128,128,0,0,0,0,0,0,15,15,1,1,3,7,14,12,12,14,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,bitmap_38,bitmap_39,bitmap_40,bitmap_41,bitmap_42,bitmap_43,bitmap_44,bitmap_45,bitmap_46,bitmap_47,bitmap_48,bitmap_49,bitmap_50,bitmap_51,bitmap_52,bitmap_53,bitmap_54,bitmap_55,bitmap_56,bitmap_57,bitmap_58,bitmap_59,bitmap_60,bitmap_61,bitmap_62,bitmap_63,bitmap_64,bitmap_65,bitmap_66,bitmap_67,bitmap_68,bitmap_69,bitmap_70,bitmap_71,bitmap_72,bitmap_73,bitmap_74,bitmap_75,bitmap_76,bitmap_77,bitmap_78,bitmap_79,bitmap_80,bitmap_81,bitmap_82,bitmap_83,bitmap_84,bitmap_85,bitmap_86,bitmap_87,bitmap_88,bitmap_89,bitmap_90,bitmap_91,bitmap_92,bitmap_93,bitmap_94,bitmap_95,bitmap_96,bitmap_97,bitmap_98,bitmap_99,bitmap_100,bitmap_101,bitmap_102,bitmap_103,bitmap_104,bitmap_105,bitmap_106,bitmap_107,bitmap_108,bitmap_109,bitmap_110,bitmap_111,bitmap_112,bitmap_113,bitmap_114,bitmap_115,bitmap_116,bitmap_117,bitmap_118,bitmap_119,bitmap_120,bitmap_121,bitmap_122,bitmap_123,bitmap_124,bitmap_125,bitmap_126};
+
+// The glyphs are rasterized once (see initGlyphAtlas) from their column bitmaps into horizontal spans of lit pixels,
+// so that text is drawn a row at a time without testing any bits, or visiting any of the pixels in between spans.
+// With antialiasing a pixel of a glyph covers all 4 sub-pixels of a pixel quad, so the same spans serve both modes.
+typedef struct GlyphSpan {
+    u8 row, first, length;
+} GlyphSpan;
+
+typedef struct Glyph {
+    u16 first_span, span_count;
+} Glyph;
+
+typedef struct GlyphAtlas {
+    Glyph glyphs[GLYPH_COUNT];
+    GlyphSpan spans[GLYPH_ATLAS__MAX_SPANS];
+    u16 span_count;
+    bool is_initialized;
+} GlyphAtlas;
+
+GlyphAtlas glyph_atlas;
+
+void initGlyphAtlas() {
+    // Each bitmap is 3 bands of 8 rows, a byte per column (the top bit being the band's bottom row):
+    bool mask[FONT_HEIGHT + 1][FONT_WIDTH];
+    glyph_atlas.span_count = 0;
+    for (u8 g = 0; g < GLYPH_COUNT; g++) {
+        u8 *byte = char_addr[g];
+        for (u8 row = 0; row <= FONT_HEIGHT; row++)
+            for (u8 column = 0; column < FONT_WIDTH; column++)
+                mask[row][column] = false;
+
+        for (u8 band = 1; band < 4; band++)
+            for (u8 column = 0; column < FONT_WIDTH; column++, byte++)
+                for (u8 bit = 0; bit < FONT_HEIGHT / 3; bit++)
+                    if (*byte & (0x80 >> bit))
+                        mask[band * FONT_HEIGHT / 3 - bit][column] = true;
+
+        Glyph *glyph = glyph_atlas.glyphs + g;
+        glyph->first_span = glyph_atlas.span_count;
+        for (u8 row = 0; row <= FONT_HEIGHT; row++) {
+            for (u8 column = 0; column < FONT_WIDTH; column++) {
+                if (!mask[row][column] || glyph_atlas.span_count == GLYPH_ATLAS__MAX_SPANS) continue;
+
+                GlyphSpan *span = glyph_atlas.spans + glyph_atlas.span_count++;
+                span->row = row;
+                span->first = column;
+                while (column < FONT_WIDTH && mask[row][column]) column++;
+                span->length = column - span->first;
+            }
+        }
+        glyph->span_count = glyph_atlas.span_count - glyph->first_span;
+    }
+
+    glyph_atlas.is_initialized = true;
+}
+
+INLINE void drawGlyph(Glyph *glyph, u16 x, u16 y, vec3 color, f32 opacity, Viewport *viewport) {
+    bool AA = viewport->settings.antialias;
+    Pixel opaque_pixel;
+    opaque_pixel.color = color;
+    opaque_pixel.opacity = 1;
+    opaque_pixel.depth = 0;
+
+    GlyphSpan *span = glyph_atlas.spans + glyph->first_span;
+    for (u16 s = 0; s < glyph->span_count; s++, span++) {
+        u16 pixel_y = y + span->row;
+        if (pixel_y >= viewport->dimensions.height) break;
+
+        u16 pixel_x = x + span->first;
+        pixel_y += (u16)viewport->position.y;
+        pixel_x += (u16)viewport->position.x;
+        if (!isRowInViewportBand(AA ? pixel_y << 1 : pixel_y, viewport)) continue;
+        if (opacity == 1) {
+            // Opaque pixels at depth 0 replace whatever was there (as setPixel would, a sub-pixel at a time):
+            PixelQuad *pixel_quad = viewport->pixels + viewport->dimensions.stride * pixel_y + pixel_x;
+            for (u8 i = 0; i < span->length; i++, pixel_quad++)
+                pixel_quad->TL = pixel_quad->TR = pixel_quad->BL = pixel_quad->BR = opaque_pixel;
+
+            ADD_RASTERIZER_STAT(viewport, pixels,             AA ? span->length * 4 : span->length);
+            ADD_RASTERIZER_STAT(viewport, overwritten_pixels, AA ? span->length * 4 : span->length);
+        } else if (AA) {
+            u16 sub_pixel_y = pixel_y << 1;
+            u16 sub_pixel_x = pixel_x << 1;
+            for (u8 i = 0; i < span->length; i++, sub_pixel_x += 2) {
+                setPixel(sub_pixel_x + 0, sub_pixel_y + 0, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 1, sub_pixel_y + 0, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 0, sub_pixel_y + 1, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 1, sub_pixel_y + 1, 0, color, opacity, viewport);
+            }
+        } else
+            for (u8 i = 0; i < span->length; i++)
+                setPixel(pixel_x + i, pixel_y, 0, color, opacity, viewport);
+    }
+}
+
+void drawText(char *str, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
+    if (x < 0 || x > viewport->dimensions.width  - FONT_WIDTH ||
+        y < 0 || y > viewport->dimensions.height - FONT_HEIGHT)
+        return;
+
+    if (!glyph_atlas.is_initialized) initGlyphAtlas(); // Done up front by the app, before any drawing threads start
+
+    color.r *= color.r;
+    color.g *= color.g;
+    color.b *= color.b;
+    u16 current_x = (u16)x;
+    u16 current_y = (u16)y;
+    u16 t_offset;
+    char character = *str;
+    while (character) {
+        if (character == '\n') {
+            if (current_y + FONT_HEIGHT > viewport->dimensions.height)
+                break;
+
+            current_x = (u16)x;
+            current_y += LINE_HEIGHT;
+        } else if (character == '\t') {
+            t_offset = FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
+            current_x += t_offset;
+        } else if (character >= FIRST_CHARACTER_CODE &&
+                   character <= LAST_CHARACTER_CODE) {
+            drawGlyph(glyph_atlas.glyphs + (character - FIRST_CHARACTER_CODE), current_x, current_y, color, opacity, viewport);
+            current_x += FONT_WIDTH;
+            if (current_x + FONT_WIDTH > viewport->dimensions.width)
+                return;
+        }
+        character = *++str;
     }
-    f64 tmp, z_range, range_remap;
-    f32 dx = x2 - x1;
-    f32 dy = y2 - y1;
-    f32 gap, grad, first_offset, last_offset;
-    f64 z, z_curr, z_step;
-    vec3 first, last;
-    vec2i start, end;
-    bool has_depth = z1 || z2;
-    if (fabsf(dx) > fabsf(dy)) { // Shallow:
-        if (x2 < x1) { // Left to right:
-            tmp = x2; x2 = x1; x1 = (f32)tmp;
-            tmp = y2; y2 = y1; y1 = (f32)tmp;
-            tmp = z2; z2 = z1; z1 = tmp;
+}
+
+void drawNumber(i32 number, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
+    NumberString number_string;
+    printNumberIntoString(number, &number_string);
+    drawText(number_string.string.char_ptr, x - number_string.string.length * FONT_WIDTH, y, color, opacity, viewport);
+}
+
+
+void accumulateTimer(Timer* timer) {
+    timer->ticks_diff = timer->ticks_after - timer->ticks_before;
+    timer->accumulated_ticks += timer->ticks_diff;
+    timer->accumulated_frame_count++;
+
+    timer->seconds      = (u64)(timer->ticks->per_tick.seconds      * (f64)(timer->ticks_diff));
+    timer->milliseconds = (u64)(timer->ticks->per_tick.milliseconds * (f64)(timer->ticks_diff));
+    timer->microseconds = (u64)(timer->ticks->per_tick.microseconds * (f64)(timer->ticks_diff));
+    timer->nanoseconds  = (u64)(timer->ticks->per_tick.nanoseconds  * (f64)(timer->ticks_diff));
+}
+
+void averageTimer(Timer *timer) {
+    timer->average_frames_per_tick = (f64)timer->accumulated_frame_count / (f64)timer->accumulated_ticks;
+    timer->average_ticks_per_frame = (f64)timer->accumulated_ticks / (f64)timer->accumulated_frame_count;
+    timer->average_frames_per_second = (u16)(timer->average_frames_per_tick      * (f64)timer->ticks->per_second);
+    timer->average_milliseconds_per_frame = (u16)(timer->average_ticks_per_frame * timer->ticks->per_tick.milliseconds);
+    timer->average_microseconds_per_frame = (u16)(timer->average_ticks_per_frame * timer->ticks->per_tick.microseconds);
+    timer->average_nanoseconds_per_frame = (u16)(timer->average_ticks_per_frame  * timer->ticks->per_tick.nanoseconds);
+    timer->accumulated_ticks = timer->accumulated_frame_count = 0;
+}
+
+INLINE void beginFrameTimer(Timer *timer) {
+    timer->ticks_after = timer->ticks_before;
+    timer->ticks_before = timer->getTicks();
+    timer->ticks_diff = timer->ticks_before - timer->ticks_after;
+    timer->delta_time = (f32)((f64)timer->ticks_diff * timer->ticks->per_tick.seconds);
+
+    // After a pause (the window idling while rendering on demand, or being dragged) continue as if from a short frame,
+    // so that whatever moves by delta_time does not jump by the whole length of the pause:
+    if (timer->delta_time > TIMER__MAX_DELTA_TIME) timer->delta_time = TIMER__MAX_DELTA_TIME;
+}
+
+INLINE void endFrameTimer(Timer *timer) {
+    timer->ticks_after = timer->getTicks();
+    accumulateTimer(timer);
+    if (timer->accumulated_ticks >= timer->ticks->per_second / 4)
+        averageTimer(timer);
+}
+
+void beginFrame(Timer *timer) {
+    beginFrameTimer(timer);
+    PROFILE_BEGIN("frame");
+}
+
+void endFrame(Timer *timer, Mouse *mouse) {
+    resetMouseChanges(mouse);
+    endFrameTimer(timer);
+#ifdef SLIM_ENGINE_PROFILER
+    PROFILE_END();
+    endProfileFrame();
+#endif
+}
+
+
+// The app can update at a fixed time step, separately from rendering (by setting both app->on.update and on.render).
+//
+// After each round of update steps the state that updating changes is copied into a snapshot, that rendering then reads
+// instead of the live scene: The primitives, the cameras, the selection, the app's viewport and the controls.
+// There are 2 snapshots: Once one is published it becomes the latest, and the next one is copied into the other one.
+// Rendering always takes the latest snapshot, so a snapshot is only skipped (not published) when rendering is still
+// holding the other one, as it was the latest when rendering took it. The live state then goes into the next snapshot.
+// This way a slow frame never holds back the update (and the input that it handles), it only skips snapshots.
+//
+// Everything else in the scene (meshes, curves, boxes, grids and the object pools) is shared with rendering as is,
+// so must not be changed while updating. Curves are tessellated when they are drawn, so only by rendering.
+// Meshes that are still loading are filled in by the mesh loader's thread, and published to both (see MeshLoader).
+// The app's frame memory belongs to rendering (it is reset before each snapshot is rendered), so updating does not use it.
+// The viewport's HUD belongs to rendering: The snapshot's viewport is a shallow copy, so its HUD has the same lines
+// as the app's viewport, which rendering lays out into runs (see updateHUD) and reads the use_alternate flags of.
+// So on.update must not change the HUD's lines (or the flags they point at) - on.render sets them instead.
+// Taking and releasing snapshots is not synchronized here: A platform rendering on another thread has to lock around
+// publishSceneSnapshot, acquireSceneSnapshot and releaseSceneSnapshot (each only copies memory or flips flags).
+void initSimulation(Simulation *simulation, SceneSettings *settings, Memory *memory) {
+    simulation->step = 0;
+    simulation->published_count = 0;
+    simulation->rendered_count = 0;
+    simulation->ticks_per_step = 0;
+    simulation->accumulated_ticks = 0;
+    simulation->last_ticks = 0;
+    simulation->latest = 0;
+
+    for (u32 i = 0; i < 2; i++) {
+        SceneSnapshot *snapshot = simulation->snapshots + i;
+        snapshot->step = 0;
+        snapshot->number = 0;
+        snapshot->is_being_rendered = false;
+        snapshot->primitives = settings->max_primitives ? (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->max_primitives) : null;
+        snapshot->cameras    = settings->cameras        ? (Camera*   )allocateMemory(memory, sizeof(Camera)    * settings->cameras)        : null;
+    }
+}
+
+u64 getSimulationMemorySize(SceneSettings *settings) {
+    return 2 * (settings->max_primitives * sizeof(Primitive) + settings->cameras * sizeof(Camera));
+}
+
+INLINE bool isSimulating(AppCallbacks *callbacks) {
+    return callbacks->update && callbacks->render;
+}
+
+// Copies the given state into a snapshot that rendering is not holding, returning false when there is none:
+bool publishSceneSnapshot(Simulation *simulation, Scene *scene, Viewport *viewport, Controls *controls) {
+    u32 index = simulation->published_count ? simulation->latest ^ 1 : simulation->latest;
+    SceneSnapshot *snapshot = simulation->snapshots + index;
+    if (snapshot->is_being_rendered) return false;
+
+    snapshot->scene = *scene;
+    snapshot->scene.primitives = snapshot->primitives;
+    snapshot->scene.cameras    = snapshot->cameras;
+    snapshot->scene.selection  = &snapshot->selection;
+    if (snapshot->primitives)
+        for (u32 i = 0; i < scene->settings.primitives; i++)
+            snapshot->primitives[i] = scene->primitives[i];
+    if (snapshot->cameras)
+        for (u32 i = 0; i < scene->settings.cameras; i++)
+            snapshot->cameras[i] = scene->cameras[i];
+
+    snapshot->selection = *scene->selection;
+    if (snapshot->selection.primitive)
+        snapshot->selection.primitive = snapshot->primitives + (snapshot->selection.primitive - scene->primitives);
+    snapshot->selection.world_position = null;
+
+    snapshot->viewport = *viewport;
+    if (snapshot->cameras &&
+        viewport->camera >= scene->cameras &&
+        viewport->camera <  scene->cameras + scene->settings.cameras)
+        snapshot->viewport.camera = snapshot->cameras + (viewport->camera - scene->cameras);
+
+    snapshot->controls = *controls;
+    snapshot->step = simulation->step;
+    snapshot->number = ++simulation->published_count;
+    simulation->latest = index;
+
+    return true;
+}
+
+// Returns the latest snapshot if it was not rendered yet (or null), to be released once it was rendered:
+SceneSnapshot* acquireSceneSnapshot(Simulation *simulation) {
+    SceneSnapshot *snapshot = simulation->snapshots + simulation->latest;
+    if (!snapshot->number || snapshot->number == simulation->rendered_count) return null;
+
+    snapshot->is_being_rendered = true;
+    return snapshot;
+}
+
+void releaseSceneSnapshot(Simulation *simulation, SceneSnapshot *snapshot) {
+    snapshot->is_being_rendered = false;
+    simulation->rendered_count = snapshot->number;
+}
+
+
+// A pool of threads that run jobs, shared by all of the work that the app splits across threads (see Platform):
+//
+// Each thread has a deque of jobs. Jobs are added to the deque of the adding thread, from which that thread takes
+// the most recently added job first, while idle threads steal the oldest jobs of other threads' deques.
+// A thread that waits for jobs runs jobs itself until they are done (so jobs can add jobs and wait for them in turn).
+// Threads that are not in the pool (like the main thread) share the first deque.
+//
+// A job calls a function for a range of indices (see CallbackForParallelWork), and counts itself as finished on a
+// counter that was given when adding it. Waiting on a counter waits for all of the jobs that were added against it,
+// so dependencies are expressed by waiting on the counter of the jobs that other jobs depend on before adding them.
+//
+// The threads are started by the platform (see Platform.startThread) and sleep on a semaphore while there are no jobs,
+// until the job system is shut down (see shutDownJobSystem).
+// Without them (or when asked for a single thread) all jobs run on the thread that waits for them.
+JobSystem job_system;
+THREAD_LOCAL u32 job_thread_index = 0;
+
+INLINE void lockJobDeque(JobDeque *deque) {
+    while (!ATOMIC_TRY_LOCK(&deque->lock))
+        while (ATOMIC_LOAD(&deque->lock));
+}
+
+bool pushJob(JobDeque *deque, Job *job) {
+    lockJobDeque(deque);
+    u32 bottom = deque->bottom;
+    bool pushed = bottom - deque->top < JOBS__DEQUE_CAPACITY;
+    if (pushed) {
+        deque->jobs[bottom % JOBS__DEQUE_CAPACITY] = *job;
+        ATOMIC_STORE(&deque->bottom, bottom + 1);
+    }
+    ATOMIC_UNLOCK(&deque->lock);
+
+    return pushed;
+}
+
+// Takes the newest job of the deque (as its own thread does) or its oldest one (when stealing):
+bool popJob(JobDeque *deque, Job *job, bool steal) {
+    if (ATOMIC_LOAD(&deque->top) == ATOMIC_LOAD(&deque->bottom)) return false;
+
+    lockJobDeque(deque);
+    u32 top = deque->top;
+    u32 bottom = deque->bottom;
+    bool popped = top != bottom;
+    if (popped) {
+        if (steal) {
+            *job = deque->jobs[top % JOBS__DEQUE_CAPACITY];
+            ATOMIC_STORE(&deque->top, top + 1);
+        } else {
+            *job = deque->jobs[--bottom % JOBS__DEQUE_CAPACITY];
+            ATOMIC_STORE(&deque->bottom, bottom);
+        }
+    }
+    ATOMIC_UNLOCK(&deque->lock);
+
+    return popped;
+}
+
+INLINE void runJob(Job *job) {
+    for (u32 index = job->first; index < job->end; index++) job->work(job->data, index);
+    ATOMIC_ADD(&job->counter->pending, -1);
+}
+
+// Runs a job from the calling thread's own deque, or one that is stolen from another thread (returning false if none):
+bool runNextJob() {
+    Job job;
+    u32 thread_count = ATOMIC_LOAD(&job_system.thread_count);
+    bool found = popJob(job_system.deques + job_thread_index, &job, false);
+    for (u32 i = 1; !found && i < thread_count; i++)
+        found = popJob(job_system.deques + (job_thread_index + i) % thread_count, &job, true);
+    if (found) runJob(&job);
+
+    return found;
+}
+
+void _runJobThread(void *data) {
+    job_thread_index = (u32)((JobDeque*)data - job_system.deques);
+    while (!ATOMIC_LOAD(&job_system.is_stopping))
+        if (!runNextJob())
+            job_system.waitForSemaphore(job_system.semaphore);
+}
+
+// Adds jobs calling work(data, index) for every index in [0, count), each for a range of the given number of indices:
+void addJobs(CallbackForParallelWork work, void *data, u32 count, u32 indices_per_job, JobCounter *counter) {
+    if (!count) return;
+    if (!indices_per_job) indices_per_job = 1;
+
+    u32 job_count = (count + indices_per_job - 1) / indices_per_job;
+    ATOMIC_ADD(&counter->pending, (i32)job_count);
+
+    Job job;
+    job.work = work;
+    job.data = data;
+    job.counter = counter;
+    JobDeque *deque = job_system.deques + job_thread_index;
+    for (u32 first = 0; first < count; first += indices_per_job) {
+        job.first = first;
+        job.end = count - first > indices_per_job ? first + indices_per_job : count;
+        if (!pushJob(deque, &job)) runJob(&job); // A job that does not fit in the deque is run right away instead
+    }
+
+    if (job_system.thread_count > 1)
+        job_system.signalSemaphore(job_system.semaphore, job_count < job_system.thread_count - 1 ? job_count : job_system.thread_count - 1);
+}
+
+void waitForJobs(JobCounter *counter) {
+    while (ATOMIC_LOAD(&counter->pending) > 0)
+        if (!runNextJob() && job_system.yieldThread)
+            job_system.yieldThread();
+}
+
+void parallelFor(CallbackForParallelWork work, void *data, u32 count, u32 indices_per_job) {
+    JobCounter counter;
+    counter.pending = 0;
+    addJobs(work, data, count, indices_per_job, &counter);
+    waitForJobs(&counter);
+}
+
+void runJobsInParallel(CallbackForParallelWork work, void *data, u32 count) {
+    parallelFor(work, data, count, 1);
+}
+
+// Starts the platform's threads (up to its thread count, including the calling thread), and has the platform's
+// runInParallel run its work as jobs on them. The thread count is then that of the threads that were started.
+void initJobSystem(Platform *platform) {
+    for (u32 i = 0; i < PARALLEL__MAX_THREADS; i++) {
+        JobDeque *deque = job_system.deques + i;
+        deque->top = deque->bottom = 0;
+        deque->lock = 0;
+    }
+    job_system.thread_count = 1;
+    job_system.is_stopping = false;
+    job_system.signalSemaphore  = platform->signalSemaphore;
+    job_system.waitForSemaphore = platform->waitForSemaphore;
+    job_system.yieldThread      = platform->yieldThread;
+    job_system.semaphore = (
+        platform->startThread &&
+        platform->createSemaphore &&
+        platform->signalSemaphore &&
+        platform->waitForSemaphore
+    ) ? platform->createSemaphore() : null;
+
+    if (job_system.semaphore)
+        for (u32 i = 1; i < platform->thread_count && i < PARALLEL__MAX_THREADS; i++) {
+            ATOMIC_STORE(&job_system.thread_count, i + 1);
+            if (!platform->startThread(_runJobThread, job_system.deques + i)) {
+                ATOMIC_STORE(&job_system.thread_count, i);
+                break;
+            }
+        }
+
+    platform->runInParallel = runJobsInParallel;
+    platform->thread_count = job_system.thread_count;
+}
+
+// Stops the threads (each once it is done with its current job), and waits for them and any other threads of the
+// platform (like the one loading meshes) to return. Jobs that are added afterwards run on the thread that waits for them.
+void shutDownJobSystem(Platform *platform) {
+    u32 thread_count = ATOMIC_LOAD(&job_system.thread_count);
+    if (thread_count > 1) {
+        ATOMIC_STORE(&job_system.is_stopping, true);
+        job_system.signalSemaphore(job_system.semaphore, thread_count - 1);
+    }
+    if (platform->joinThreads) platform->joinThreads();
+
+    ATOMIC_STORE(&job_system.thread_count, 1);
+    platform->thread_count = 1;
+}
+
+
+// The threads and semaphore of the job system (see core/jobs.h), on Windows or POSIX, shared by the platforms:
+// Threads are started into a fixed table, so that they can all be joined when the job system is shut down,
+// and the job system's threads sleep on a single counting semaphore while there are no jobs.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <errno.h>
+#endif
+
+
+typedef struct Threads_Thread {
+    CallbackForThread thread;
+    void *data;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+} Threads_Thread;
+Threads_Thread Threads_threads[PARALLEL__MAX_THREADS];
+u32 Threads_thread_count;
+
+#ifdef _WIN32
+DWORD WINAPI Threads_runThread(LPVOID parameter) {
+    Threads_Thread *thread = (Threads_Thread*)parameter;
+    thread->thread(thread->data);
+    return 0;
+}
+bool Threads_startThread(CallbackForThread thread, void *data) {
+    if (Threads_thread_count == PARALLEL__MAX_THREADS) return false;
+
+    Threads_Thread *new_thread = Threads_threads + Threads_thread_count;
+    new_thread->thread = thread;
+    new_thread->data = data;
+    new_thread->handle = CreateThread(null, 0, Threads_runThread, new_thread, 0, null);
+    if (!new_thread->handle) return false;
+
+    Threads_thread_count++;
+    return true;
+}
+void Threads_joinThreads() {
+    for (u32 i = 0; i < Threads_thread_count; i++) {
+        WaitForSingleObject(Threads_threads[i].handle, INFINITE);
+        CloseHandle(Threads_threads[i].handle);
+    }
+    Threads_thread_count = 0;
+}
+void  Threads_yieldThread() { SwitchToThread(); }
+void* Threads_createSemaphore() { return CreateSemaphoreA(null, 0, 0x7FFFFFFF, null); }
+void  Threads_signalSemaphore(void *semaphore, u32 count) { ReleaseSemaphore((HANDLE)semaphore, (LONG)count, null); }
+void  Threads_waitForSemaphore(void *semaphore) { WaitForSingleObject((HANDLE)semaphore, INFINITE); }
+#else
+void* Threads_runThread(void *parameter) {
+    Threads_Thread *thread = (Threads_Thread*)parameter;
+    thread->thread(thread->data);
+    return null;
+}
+bool Threads_startThread(CallbackForThread thread, void *data) {
+    if (Threads_thread_count == PARALLEL__MAX_THREADS) return false;
+
+    Threads_Thread *new_thread = Threads_threads + Threads_thread_count;
+    new_thread->thread = thread;
+    new_thread->data = data;
+    if (pthread_create(&new_thread->handle, null, Threads_runThread, new_thread)) return false;
+
+    Threads_thread_count++;
+    return true;
+}
+void Threads_joinThreads() {
+    for (u32 i = 0; i < Threads_thread_count; i++) pthread_join(Threads_threads[i].handle, null);
+    Threads_thread_count = 0;
+}
+sem_t Threads_semaphore;
+void  Threads_yieldThread() { sched_yield(); }
+void* Threads_createSemaphore() {
+    // Unnamed semaphores are not supported everywhere (sem_init fails on macOS), and the job system then has no threads:
+    if (!sem_init(&Threads_semaphore, 0, 0)) return &Threads_semaphore;
+
+    printf("Could not create a semaphore (%s), so jobs will only run on the main thread\n", strerror(errno));
+    return null;
+}
+void  Threads_signalSemaphore(void *semaphore, u32 count) { while (count--) sem_post((sem_t*)semaphore); }
+void  Threads_waitForSemaphore(void *semaphore) { while (sem_wait((sem_t*)semaphore) && errno == EINTR); }
+#endif
+
+void setPlatformThreads(Platform *platform) {
+    platform->startThread      = Threads_startThread;
+    platform->joinThreads      = Threads_joinThreads;
+    platform->yieldThread      = Threads_yieldThread;
+    platform->createSemaphore  = Threads_createSemaphore;
+    platform->signalSemaphore  = Threads_signalSemaphore;
+    platform->waitForSemaphore = Threads_waitForSemaphore;
+}
+
+
+App *app;
+
+void initApp(Defaults *defaults);
+
+// When rendering on demand, the platform only redraws the window when something may have changed since the last frame:
+// Input arrived (or the window was resized), a mesh finished loading (see MeshLoader), or needs_redraw was set
+// for anything that changes by itself: The camera of any viewport that is still navigating (it glides to a stop after
+// the keys are released, see navigateViewport) or an animation of the app.
+// The app can set needs_redraw at any time, including while drawing a frame (to have the next one drawn as well).
+bool _isRedrawNeeded() {
+    if (!app->render_on_demand || app->needs_redraw) return true;
+
+    MeshLoader *mesh_loader = &app->scene.mesh_loader;
+    u32 loaded_count = ATOMIC_LOAD(&mesh_loader->loaded_count);
+    if (loaded_count != mesh_loader->drawn_count) {
+        mesh_loader->drawn_count = loaded_count;
+        return true;
+    }
+
+    return false;
+}
+
+// Runs as many fixed steps of the app's update as the time that passed since the last call covers (returning how many).
+// Input is handled per step: The mouse changes are reset after each one and a recording advances a frame per step.
+// Having fallen behind by more than SIMULATION__MAX_STEPS_PER_UPDATE steps, the rest of the time is dropped.
+u32 _simulate() {
+    Simulation *simulation = &app->simulation;
+    u64 ticks = app->time.getTicks();
+    if (!simulation->ticks_per_step) {
+        simulation->ticks_per_step = app->time.ticks.per_second / simulation->steps_per_second;
+        simulation->last_ticks = ticks - simulation->ticks_per_step; // The first call runs a step right away
+    }
+    simulation->accumulated_ticks += ticks - simulation->last_ticks;
+    simulation->last_ticks = ticks;
+
+    u64 step_count = simulation->accumulated_ticks / simulation->ticks_per_step;
+    if (step_count > SIMULATION__MAX_STEPS_PER_UPDATE) {
+        step_count = SIMULATION__MAX_STEPS_PER_UPDATE;
+        simulation->accumulated_ticks = 0;
+    } else
+        simulation->accumulated_ticks -= step_count * simulation->ticks_per_step;
+    if (!step_count) return 0;
+
+    Navigation *navigation = &app->viewport.navigation;
+    navigation->moved = navigation->turned = navigation->zoomed = false;
+
+    f32 time_step = 1.0f / (f32)simulation->steps_per_second;
+    Timer *timer = &app->time.timers.update;
+    for (u64 step = 0; step < step_count; step++) {
+        beginFrameTimer(timer);
+        app->on.update(time_step);
+        resetMouseChanges(&app->controls.mouse);
+        endFrameTimer(timer);
+        simulation->step++;
+        if (app->input_recording.is_recording ||
+            app->input_recording.is_replaying)
+            app->input_recording.frame++;
+    }
+
+    return (u32)step_count;
+}
+
+// Publishes the current state for rendering when there is anything new to render (see _isRedrawNeeded)
+bool _publishSceneSnapshot(bool has_stepped) {
+    if (!(has_stepped || app->needs_redraw) || !_isRedrawNeeded()) return false;
+
+    bool published = publishSceneSnapshot(&app->simulation, &app->scene, &app->viewport, &app->controls);
+    app->needs_redraw = !published;
+    return published;
+}
+
+void _renderSceneSnapshot(SceneSnapshot *snapshot) {
+    Timer *timer = &app->time.timers.render;
+    resetMemory(&app->frame_memory);
+    beginFrame(timer);
+    app->on.render(snapshot);
+    endFrameTimer(timer);
+#ifdef SLIM_ENGINE_PROFILER
+    PROFILE_END();
+    endProfileFrame();
+#endif
+}
+
+void _windowRedraw() {
+    if (!app->is_running) return;
+
+    // Updating and rendering in turn (a platform may instead render on a separate thread, see core/simulation.h):
+    if (isSimulating(&app->on)) {
+        _publishSceneSnapshot(_simulate() != 0);
+        SceneSnapshot *snapshot = acquireSceneSnapshot(&app->simulation);
+        if (snapshot) {
+            _renderSceneSnapshot(snapshot);
+            releaseSceneSnapshot(&app->simulation, snapshot);
         }
+        return;
+    }
+
+    app->needs_redraw = false;
+    app->viewport.navigation.moved = app->viewport.navigation.turned = app->viewport.navigation.zoomed = false;
+    resetMemory(&app->frame_memory);
+    if (app->on.windowRedraw) app->on.windowRedraw();
+    if (app->input_recording.is_recording ||
+        app->input_recording.is_replaying)
+        app->input_recording.frame++;
+}
+
+void _windowResize(u16 width, u16 height) {
+    if (!app->is_running) return;
+    recordInputEvent(&app->input_recording, InputEvent_WindowResize, 0, width, height, &app->platform);
+    app->needs_redraw = true;
+    resizeViewport(&app->viewport, width, height, width);
+
+    if (app->on.windowResize) app->on.windowResize(width, height);
+    if (app->on.windowRedraw) app->on.windowRedraw();
+}
+
+void _keyChanged(u8 key, bool pressed) {
+    recordInputEvent(&app->input_recording, pressed ? InputEvent_KeyDown : InputEvent_KeyUp, key, 0, 0, &app->platform);
+    app->needs_redraw = true;
+
+         if (key == app->controls.key_map.ctrl)  app->controls.is_pressed.ctrl  = pressed;
+    else if (key == app->controls.key_map.alt)   app->controls.is_pressed.alt   = pressed;
+    else if (key == app->controls.key_map.shift) app->controls.is_pressed.shift = pressed;
+    else if (key == app->controls.key_map.space) app->controls.is_pressed.space = pressed;
+    else if (key == app->controls.key_map.tab)   app->controls.is_pressed.tab   = pressed;
+
+    if (app->on.keyChanged) app->on.keyChanged(key, pressed);
+}
+
+void _mouseButtonDown(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonDown, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
+
+    mouse_button->is_pressed = true;
+    mouse_button->is_handled = false;
+
+    mouse_button->down_pos.x = x;
+    mouse_button->down_pos.y = y;
+
+    if (app->on.mouseButtonDown) app->on.mouseButtonDown(mouse_button);
+}
+
+void _mouseButtonUp(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonUp, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
+
+    mouse_button->is_pressed = false;
+    mouse_button->is_handled = false;
+
+    mouse_button->up_pos.x = x;
+    mouse_button->up_pos.y = y;
+
+    if (app->on.mouseButtonUp) app->on.mouseButtonUp(mouse_button);
+}
 
-        grad = dy / dx;
+void _mouseButtonDoubleClicked(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonDoubleClicked, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
 
-        first.x = roundf(x1);
-        last.x  = roundf(x2);
-        first_offset = first.x - x1;
-        last_offset  = last.x  - x2;
+    app->controls.mouse.double_clicked = true;
+    mouse_button->double_click_pos.x = x;
+    mouse_button->double_click_pos.y = y;
+    if (app->on.mouseButtonDoubleClicked) app->on.mouseButtonDoubleClicked(mouse_button);
+}
 
-        first.y = y1 + grad * first_offset;
-        last.y  = y2 + grad * last_offset;
+void _mouseWheelScrolled(f32 amount) {
+    recordMouseWheelScrolled(&app->input_recording, amount, &app->platform);
+    app->needs_redraw = true;
 
-        start.x = (i32)first.x;
-        start.y = (i32)first.y;
-        end.x   = (i32)last.x;
-        end.y   = (i32)last.y;
+    app->controls.mouse.wheel_scroll_amount += amount * 100;
+    app->controls.mouse.wheel_scrolled = true;
 
-        x = start.x;
-        y = start.y;
-        gap = oneMinusFractionOf(x1 + 0.5f);
+    if (app->on.mouseWheelScrolled) app->on.mouseWheelScrolled(amount);
+}
 
-        if (inRange(x, w, x_left)) {
-            if (inRange(y, h, y_top)) setPixel(x, y, z1, color, oneMinusFractionOf(first.y) * gap * opacity, viewport);
+void _mousePositionSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MousePositionSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
 
-            for (u8 i = 0; i < line_width; i++) {
-                y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z1, color, opacity, viewport);
-            }
+    app->controls.mouse.pos.x = x;
+    app->controls.mouse.pos.y = y;
 
-            y++;
-            if (inRange(y, h, y_top)) setPixel(x, y, z1, color, fractionOf(first.y) * gap * opacity, viewport);
+    if (app->on.mousePositionSet) app->on.mousePositionSet(x, y);
+}
+
+void _mouseMovementSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseMovementSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
+
+    app->controls.mouse.movement.x = x - app->controls.mouse.pos.x;
+    app->controls.mouse.movement.y = y - app->controls.mouse.pos.y;
+    app->controls.mouse.moved = true;
+
+    if (app->on.mouseMovementSet) app->on.mouseMovementSet(x, y);
+}
+
+void _mouseRawMovementSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseRawMovementSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
+
+    app->controls.mouse.pos_raw_diff.x += x;
+    app->controls.mouse.pos_raw_diff.y += y;
+    app->controls.mouse.moved = true;
+
+    if (app->on.mouseRawMovementSet) app->on.mouseRawMovementSet(x, y);
+}
+
+// Feeds back the recorded events of the current frame (to be called by the platform before each redraw while replaying)
+void _replayInputEvents() {
+    InputEvent event;
+    Mouse *mouse = &app->controls.mouse;
+    while (getNextInputEventOfFrame(&app->input_recording, &event, &app->platform)) {
+        switch (event.type) {
+            case InputEvent_KeyDown                 : _keyChanged(event.code, true);  break;
+            case InputEvent_KeyUp                   : _keyChanged(event.code, false); break;
+            case InputEvent_MouseButtonDown         : _mouseButtonDown(         getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseButtonUp           : _mouseButtonUp(           getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseButtonDoubleClicked: _mouseButtonDoubleClicked(getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseWheelScrolled      : _mouseWheelScrolled(event.amount); break;
+            case InputEvent_MousePositionSet        : _mousePositionSet(   event.x, event.y); break;
+            case InputEvent_MouseMovementSet        : _mouseMovementSet(   event.x, event.y); break;
+            case InputEvent_MouseRawMovementSet     : _mouseRawMovementSet(event.x, event.y); break;
+            case InputEvent_WindowResize:
+                if (event.x > 0 && event.x <= MAX_WIDTH &&
+                    event.y > 0 && event.y <= MAX_HEIGHT)
+                    _windowResize((u16)event.x, (u16)event.y);
+                break;
+            default:
+                break;
         }
+    }
+}
 
-        x = end.x;
-        y = end.y;
-        gap = fractionOf(x2 + 0.5f);
+bool initGrowableAppMemory(Memory *memory, u64 reserved_size, u64 initial_size) {
+    void* memory_address = app->platform.reserveMemory(reserved_size);
+    if (!memory_address) return false;
 
-        if (inRange(x, w, x_left)) {
-            if (inRange(y, h, y_top)) setPixel(x, y, z2, color, oneMinusFractionOf(last.y) * gap * opacity, viewport);
+    initGrowableMemory(memory, (u8*)memory_address, reserved_size, app->platform.commitMemory);
+    return commitMemory(memory, initial_size);
+}
 
-            for (u8 i = 0; i < line_width; i++) {
-                y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z2, color, opacity, viewport);
-            }
+// The app's memory is reserved up-front and committed as it grows (when the platform supports it)
+// with the given size committed initially. Otherwise, the given size is allocated as a fixed capacity.
+// When the platform was asked to use large pages (and can get them), the app's memory is allocated with them instead,
+// also as a fixed capacity. It holds the frame buffer and the meshes, which are then covered by far fewer TLB entries.
+// Large pages can not be committed on demand, so that memory never grows: The size given here is then all there is,
+// and allocating past it fails (allocateAppMemory then stops the app). The meshes of the scene's settings are counted
+// in it, but memory for meshes added at runtime has to be asked for up-front (as the defaults' additional_memory_size).
+// Large pages are also not placed per NUMA node: They are all committed here (on the node of the main thread, if any),
+// while the job system's threads are not pinned to nodes, so the rows that a thread draws may be on a remote node.
+// The frame memory is a separate arena for transient allocations of drawing (like the viewports of the bands that
+// drawSceneInParallel draws), that is reset at the start of each frame (before on.render, when updating separately).
+bool initAppMemory(u64 size) {
+    if (app->memory.address) return false;
 
-            y++;
-            if (inRange(y, h, y_top)) setPixel(x, y, z2, color, fractionOf(last.y) * gap * opacity, viewport);
+    bool initialized;
+    void* large_page_memory_address = app->platform.getLargePageMemory ? app->platform.getLargePageMemory(size) : null;
+    if (large_page_memory_address)
+        initMemory(&app->memory, (u8*)large_page_memory_address, size);
+
+    if (app->platform.reserveMemory && app->platform.commitMemory) {
+        initialized = (
+            (large_page_memory_address ||
+             initGrowableAppMemory(&app->memory, size > MEMORY__RESERVE_SIZE ? size : MEMORY__RESERVE_SIZE, size)) &&
+            initGrowableAppMemory(&app->frame_memory, FRAME_MEMORY__RESERVE_SIZE, 0)
+        );
+    } else {
+        u64 memory_size = large_page_memory_address ? 0 : size;
+        u8* memory_address = (u8*)app->platform.getMemory(memory_size + FRAME_MEMORY__RESERVE_SIZE);
+        initialized = memory_address != null;
+        if (initialized) {
+            if (!large_page_memory_address) initMemory(&app->memory, memory_address, size);
+            initMemory(&app->frame_memory, memory_address + memory_size, FRAME_MEMORY__RESERVE_SIZE);
         }
+    }
+    if (!initialized) {
+        app->is_running = false;
+        return false;
+    }
 
-        if (has_depth) { // Compute one-over-z start and step
-            z1 = 1.0 / z1;
-            z2 = 1.0 / z2;
-            z_range = z2 - z1;
-            range_remap = z_range / (f64)(x2 - x1);
-            z1 += range_remap * (f64)(first_offset + 1);
-            z2 += range_remap * (f64)(last_offset  - 1);
-            z_range = z2 - z1;
-            z_step = z_range / (f64)(last.x - first.x - 1);
-            z_curr = z1;
-        } else z = 0;
+    return true;
+}
 
-        gap = first.y + grad;
-        for (x = start.x + 1; x < end.x; x++) {
-            if (inRange(x, w, x_left)) {
-                if (has_depth) z = 1.0 / z_curr;
-                y = (i32) gap;
-                if (inRange(y, h, y_top)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
+void* allocateAppMemory(u64 size) {
+    void *new_memory = allocateMemory(&app->memory, size);
+    if (new_memory) return new_memory;
 
-                for (u8 i = 0; i < line_width; i++) {
-                    y++;
-                    if (inRange(y, h, y_top)) setPixel(x, y, z, color, opacity, viewport);
+    app->is_running = false;
+    return null;
+}
+
+void initScene(Scene *scene, SceneSettings *settings, Memory *memory, Platform *platform) {
+    setScenePoolCapacities(settings);
+    scene->settings   = *settings;
+    scene->primitives = null;
+    scene->cameras    = null;
+    scene->curves     = null;
+    scene->boxes      = null;
+    scene->grids      = null;
+    scene->meshes     = null;
+
+    scene->selection = (Selection*)allocateMemory(memory, sizeof(Selection));
+    scene->selection->object_type = scene->selection->object_id = 0;
+    scene->selection->primitive = null;
+    scene->selection->changed = false;
+
+    if (!settings->mesh_files) scene->settings.meshes = 0;
+    initObjectPool(&scene->primitive_pool, settings->max_primitives, settings->primitives, memory);
+    initObjectPool(&scene->mesh_pool,      settings->max_meshes,     scene->settings.meshes, memory);
+    initObjectPool(&scene->curve_pool,     settings->max_curves,     settings->curves,     memory);
+    initObjectPool(&scene->box_pool,       settings->max_boxes,      settings->boxes,      memory);
+    initObjectPool(&scene->grid_pool,      settings->max_grids,      settings->grids,      memory);
+
+    // The meshes' files are loaded on a background thread, each mesh being drawn by its bounds until it is loaded:
+    initMeshLoader(&scene->mesh_loader, scene->settings.meshes, platform, memory);
+    if (settings->max_meshes) {
+        scene->meshes = (Mesh*)allocateMemory(memory, sizeof(Mesh) * settings->max_meshes);
+        if (scene->meshes) {
+            for (u32 i = 0; i < settings->max_meshes; i++) {
+                if (i < scene->settings.meshes) {
+                    queueMeshLoading(&scene->mesh_loader, &scene->meshes[i], settings->mesh_files[i].char_ptr, memory);
+                } else {
+                    initMesh(&scene->meshes[i]);
                 }
+            }
+        }
+    }
 
-                y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
+    if (settings->cameras) {
+        scene->cameras = (Camera*)allocateMemory(memory, sizeof(Camera) * settings->cameras);
+        if (scene->cameras)
+            for (u32 i = 0; i < settings->cameras; i++)
+                initCamera(scene->cameras + i);
+    }
+
+    if (settings->max_primitives) {
+        scene->primitives = (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->max_primitives);
+        if (scene->primitives)
+            for (u32 i = 0; i < settings->max_primitives; i++) {
+                initPrimitive(scene->primitives + i);
+                if (i < settings->primitives) scene->primitives[i].id = i;
             }
+    }
 
-            gap += grad;
-            if (has_depth) z_curr += z_step;
-        }
-    } else { // Steep:
-        if (y2 < y1) { // Bottom up:
-            tmp = x2; x2 = x1; x1 = (f32)tmp;
-            tmp = y2; y2 = y1; y1 = (f32)tmp;
-            tmp = z2; z2 = z1; z1 = tmp;
-        }
+    if (settings->max_curves) {
+        scene->curves = (Curve*)allocateMemory(memory, sizeof(Curve) * settings->max_curves);
+        vec3 *curve_points = (vec3*)allocateMemory(memory, sizeof(vec3) * CURVE_STEPS * settings->max_curves);
+        if (scene->curves)
+            for (u32 i = 0; i < settings->max_curves; i++) {
+                initCurve(scene->curves + i);
+                scene->curves[i].points = curve_points ? curve_points + CURVE_STEPS * i : null;
+                scene->curves[i].points_capacity = curve_points ? CURVE_STEPS : 0;
+            }
+    }
 
-        grad = dx / dy;
+    if (settings->max_boxes) {
+        scene->boxes = (Box*)allocateMemory(memory, sizeof(Box) * settings->max_boxes);
+        if (scene->boxes)
+            for (u32 i = 0; i < settings->max_boxes; i++)
+                initBox(scene->boxes + i);
+    }
 
-        first.y = roundf(y1);
-        last.y  = roundf(y2);
+    if (settings->max_grids) {
+        scene->grids = (Grid*)allocateMemory(memory, sizeof(Grid) * settings->max_grids);
+        if (scene->grids)
+            for (u32 i = 0; i < settings->max_grids; i++)
+                initGrid(scene->grids + i, 3, 3);
+    }
 
-        first_offset = y1 - first.y;
-        last_offset  = last.y  - y2;
+    initSceneJournal(&scene->journal, settings, memory);
+    scene->last_io_ticks = 0;
+    scene->last_io_is_save = false;
 
-        first.x = x1 + grad * first_offset;
-        last.x  = x2 + grad * last_offset;
+    startLoadingMeshes(&scene->mesh_loader);
+}
 
-        start.y = (i32)first.y;
-        start.x = (i32)first.x;
+u64 getSceneMemorySize(SceneSettings *settings) {
+    setScenePoolCapacities(settings);
+    u64 pool_slot_count = settings->max_primitives + settings->max_meshes + settings->max_curves + settings->max_boxes + settings->max_grids;
 
-        end.y = (i32)last.y;
-        end.x = (i32)last.x;
+    u64 memory_size = sizeof(Selection) + pool_slot_count * sizeof(u32) * 2;
+    memory_size += settings->max_primitives * sizeof(Primitive);
+    memory_size += settings->max_meshes     * (sizeof(Mesh) + sizeof(MeshLoad));
+    memory_size += settings->max_curves     * (sizeof(Curve) + sizeof(vec3) * CURVE_STEPS);
+    memory_size += settings->max_boxes      * sizeof(Box);
+    memory_size += settings->max_grids      * sizeof(Grid);
+    memory_size += settings->cameras        * sizeof(Camera);
+    memory_size += getSceneJournalMemorySize(settings);
 
-        x = start.x;
-        y = start.y;
-        gap = oneMinusFractionOf(y1 + 0.5f);
+    return memory_size;
+}
 
-        if (inRange(y, h, y_top)) {
-            if (inRange(x, w, x_left)) setPixel(x, y, z1, color, oneMinusFractionOf(first.x) * gap * opacity, viewport);
+void _initApp(Defaults *defaults, u32* window_content) {
+    app->window_content = window_content;
 
-            for (u8 i = 0; i < line_width; i++) {
-                x++;
-                if (inRange(x, w, x_left)) setPixel(x, y, z1, color, opacity, viewport);
-            }
+    initJobSystem(&app->platform);
 
-            x++;
-            if (inRange(x, w, x_left)) setPixel(x, y, z1, color, fractionOf(first.x) * gap * opacity, viewport);
-        }
+    app->is_running = true;
+    app->user_data = null;
+    app->memory.address = null;
+    app->frame_memory.address = null;
+    app->input_recording.file = null;
+    app->input_recording.frame = 0;
+    app->input_recording.is_recording = false;
+    app->input_recording.is_replaying = false;
+    app->render_on_demand = false;
+    app->needs_redraw = true;
+    app->max_frames_per_second = 0;
+    app->simulation.steps_per_second = SIMULATION__DEFAULT_STEPS_PER_SECOND;
+    initGlyphAtlas();
 
-        x = end.x;
-        y = end.y;
-        gap = fractionOf(y2 + 0.5f);
+    app->on.sceneReady = null;
+    app->on.viewportReady = null;
+    app->on.windowRedraw = null;
+    app->on.keyChanged = null;
+    app->on.mouseButtonUp = null;
+    app->on.mouseButtonDown = null;
+    app->on.mouseButtonDoubleClicked = null;
+    app->on.mouseWheelScrolled = null;
+    app->on.mousePositionSet = null;
+    app->on.mouseMovementSet = null;
+    app->on.mouseRawMovementSet = null;
+    app->on.update = null;
+    app->on.render = null;
 
-        if (inRange(y, h, y_top)) {
-            if (inRange(x, w, x_left)) setPixel(x, y, z2, color, oneMinusFractionOf(last.x) * gap * opacity, viewport);
+    defaults->title = (char*)"";
+    defaults->width = 480;
+    defaults->height = 360;
+    defaults->additional_memory_size = 0;
 
-            for (u8 i = 0; i < line_width; i++) {
-                x++;
-                if (inRange(x, w, x_left)) setPixel(x, y, z2, color, opacity, viewport);
-            }
+    SceneSettings *scene_settings = &defaults->settings.scene;
+    ViewportSettings *viewport_settings = &defaults->settings.viewport;
+    NavigationSettings *navigation_settings = &defaults->settings.navigation;
 
-            x++;
-            if (inRange(x, w, x_left)) setPixel(x, y, z2, color, fractionOf(last.x) * gap * opacity, viewport);
+    setDefaultSceneSettings(scene_settings);
+    setDefaultViewportSettings(viewport_settings);
+    setDefaultNavigationSettings(navigation_settings);
+
+    initTime(&app->time, app->platform.getTicks, app->platform.ticks_per_second);
+    initMouse(&app->controls.mouse);
+    initApp(defaults);
+
+    u64 memory_size = getSceneMemorySize(scene_settings) + defaults->additional_memory_size;
+    memory_size += viewport_settings->hud_line_count * (sizeof(HUDLine) + sizeof(HUDRun) * HUD__MAX_LINE_RUNS);
+
+    u32 max_triangle_count = CUBE__TRIANGLE_COUNT;
+    u32 max_vertex_count = CUBE__VERTEX_COUNT;
+    u32 max_normal_count = CUBE__NORMAL_COUNT;
+    if (scene_settings->meshes && scene_settings->mesh_files) {
+        Mesh mesh;
+        for (u32 i = 0; i < scene_settings->meshes; i++) {
+            memory_size += getMeshMemorySize(&mesh, scene_settings->mesh_files[i].char_ptr, &app->platform);
+            if (mesh.triangle_count > max_triangle_count) max_triangle_count = mesh.triangle_count;
+            if (mesh.vertex_count > max_vertex_count) max_vertex_count = mesh.vertex_count;
+            if (mesh.normals_count > max_normal_count) max_normal_count = mesh.normals_count;
         }
+    }
 
-        if (has_depth) { // Compute one-over-z start and step
-            z1 = 1.0 / z1;
-            z2 = 1.0 / z2;
-            z_range = z2 - z1;
-            range_remap = z_range / (f64)(y2 - y1);
-            z1 += range_remap * (f64)(first_offset + 1);
-            z2 += range_remap * (f64)(last_offset  - 1);
-            z_range = z2 - z1;
-            z_step = z_range / (f64)(last.y - first.y - 1);
-            z_curr = z1;
-        } else z = 0;
+    memory_size += FRAME_BUFFER_MEMORY_SIZE;
+    if (isSimulating(&app->on)) memory_size += getSimulationMemorySize(scene_settings);
 
-        gap = first.x + grad;
-        for (y = start.y + 1; y < end.y; y++) {
-            if (inRange(y, h, y_top)) {
-                if (has_depth) z = 1.0 / z_curr;
-                x = (i32)gap;
+    initAppMemory(memory_size);
+
+    PixelQuad *pixels = (PixelQuad*)allocateAppMemory(FRAME_BUFFER_MEMORY_SIZE);
+    initScene(&app->scene, scene_settings, &app->memory, &app->platform);
+    if (app->on.sceneReady) app->on.sceneReady(&app->scene);
+    if (isSimulating(&app->on)) initSimulation(&app->simulation, &app->scene.settings, &app->memory);
+
+    if (viewport_settings->hud_line_count) {
+        viewport_settings->hud_lines = (HUDLine*)allocateAppMemory(viewport_settings->hud_line_count * sizeof(HUDLine));
+        viewport_settings->hud_runs  = (HUDRun* )allocateAppMemory(viewport_settings->hud_line_count * sizeof(HUDRun) * HUD__MAX_LINE_RUNS);
+    }
+
+    initViewport(&app->viewport, viewport_settings, navigation_settings, app->scene.cameras, pixels);
+    if (app->on.viewportReady) app->on.viewportReady(&app->viewport);
+}
 
-                if (inRange(x, w, x_left)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
 
-                for (u8 i = 0; i < line_width; i++) {
-                    x++;
-                    if (inRange(x, w, x_left)) setPixel(x, y, z, color, opacity, viewport);
-                }
+INLINE mat2 getMat2Identity() {
+    mat2 out;
 
-                x++;
-                if (inRange(x, w, x_left)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
-            }
+    out.X.x = 1; out.X.y = 0;
+    out.Y.x = 0; out.Y.y = 1;
 
-            gap += grad;
-            if (has_depth) z_curr += z_step;
-        }
-    }
+    return out;
 }
 
-INLINE void drawRect(Rect rect, vec3 color, f32 opacity, Viewport *viewport) {
-    if (rect.max.x < 0 || rect.min.x >= viewport->dimensions.width ||
-        rect.max.y < 0 || rect.min.y >= viewport->dimensions.height)
-        return;
+INLINE mat2 addMat2(mat2 a, mat2 b) {
+    mat2 out;
 
-    drawHLine(rect.min.x, rect.max.x, rect.min.y, color, opacity, viewport);
-    drawHLine(rect.min.x, rect.max.x, rect.max.y, color, opacity, viewport);
-    drawVLine(rect.min.y, rect.max.y, rect.min.x, color, opacity, viewport);
-    drawVLine(rect.min.y, rect.max.y, rect.max.x, color, opacity, viewport);
-}
+    out.X.x = a.X.x + b.X.x;
+    out.X.y = a.X.y + b.X.y;
 
-INLINE void fillRect(Rect rect, vec3 color, f32 opacity, Viewport *viewport) {
-    if (rect.max.x < 0 || rect.min.x >= viewport->dimensions.width ||
-        rect.max.y < 0 || rect.min.y >= viewport->dimensions.height)
-        return;
+    out.Y.x = a.Y.x + b.Y.x;
+    out.Y.y = a.Y.y + b.Y.y;
 
-    i32 min_x, min_y, max_x, max_y;
-    subRange(rect.min.x, rect.max.x, viewport->dimensions.width,  0, &min_x, &max_x);
-    subRange(rect.min.y, rect.max.y, viewport->dimensions.height, 0, &min_y, &max_y);
-    for (i32 y = min_y; y <= max_y; y++)
-        drawHLine(min_x, max_x, y, color, opacity, viewport);
+    return out;
 }
 
+INLINE mat2 subMat2(mat2 a, mat2 b) {
+    mat2 out;
 
+    out.X.x = a.X.x - b.X.x;
+    out.X.y = a.X.y - b.X.y;
 
-bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
-    f32 distance = viewport->settings.near_clipping_plane_distance;
-    vec3 A = edge->from;
-    vec3 B = edge->to;
+    out.Y.x = a.Y.x - b.Y.x;
+    out.Y.y = a.Y.y - b.Y.y;
 
-    u8 out = (A.z < distance) | ((B.z < distance) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, (distance - A.z) / (B.z - A.z));
-        else         B = lerpVec3(B, A, (distance - B.z) / (A.z - B.z));
-    }
+    return out;
+}
 
-    distance = viewport->settings.far_clipping_plane_distance;
-    out = (A.z > distance) | ((B.z > distance) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, (A.z - distance) / (A.z - B.z));
-        else         B = lerpVec3(B, A, (B.z - distance) / (B.z - A.z));
-    }
+INLINE mat2 scaleMat2(mat2 m, f32 factor) {
+    mat2 out;
 
-    // Left plane (facing to the right):
-    vec3 N = Vec3(viewport->camera->focal_length, 0, viewport->dimensions.width_over_height);
-    f32 NdotA = dotVec3(N, A);
-    f32 NdotB = dotVec3(N, B);
+    out.X.x = m.X.x * factor;
+    out.X.y = m.X.y * factor;
 
-    out = (NdotA < 0) | ((NdotB < 0) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
-        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
-    }
+    out.Y.x = m.Y.x * factor;
+    out.Y.y = m.Y.y * factor;
 
-    // Right plane (facing to the left):
-    N.x = -N.x;
-    NdotA = dotVec3(N, A);
-    NdotB = dotVec3(N, B);
+    return out;
+}
 
-    out = (NdotA < 0) | ((NdotB < 0) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
-        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
-    }
+INLINE mat2 transposedMat2(mat2 m) {
+    mat2 out;
 
-    // Bottom plane (facing up):
-    N = Vec3(0, viewport->camera->focal_length, 1);
-    NdotA = dotVec3(N, A);
-    NdotB = dotVec3(N, B);
+    out.X.x = m.X.x;  out.X.y = m.Y.x;
+    out.Y.x = m.X.y;  out.Y.y = m.Y.y;
 
-    out = (NdotA < 0) | ((NdotB < 0) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
-        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
-    }
+    return out;
+}
 
-    // Top plane (facing down):
-    N.y = -N.y;
-    NdotA = dotVec3(N, A);
-    NdotB = dotVec3(N, B);
+INLINE mat2 mulMat2(mat2 a, mat2 b) {
+    mat2 out;
 
-    out = (NdotA < 0) | ((NdotB < 0) << 1);
-    if (out) {
-        if (out == 3) return false;
-        if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
-        else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
-    }
+    out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x; // Row 1 | Column 1
+    out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y; // Row 1 | Column 2
 
-    edge->from = A;
-    edge->to   = B;
+    out.Y.x = a.Y.x*b.X.x + a.Y.y*b.Y.x; // Row 2 | Column 1
+    out.Y.y = a.Y.x*b.X.y + a.Y.y*b.Y.y; // Row 2 | Column 2
 
-    return true;
+    return out;
 }
 
-INLINE bool projectEdge(Edge *edge, Viewport *viewport) {
-    if (!cullAndClipEdge(edge, viewport))
-        return false;
+INLINE mat2 invMat2(mat2 m) {
+    mat2 out;
 
-    vec4 A = mulVec4Mat4(Vec4fromVec3(edge->from, 1.0f), viewport->projection_matrix);
-    vec4 B = mulVec4Mat4(Vec4fromVec3(edge->to,   1.0f), viewport->projection_matrix);
+    f32 a = m.X.x,  b = m.X.y,
+        c = m.Y.x,  d = m.Y.y;
 
-    // Project:
-    edge->from = scaleVec3(Vec3fromVec4(A), 1.0f / A.w);
-    edge->to   = scaleVec3(Vec3fromVec4(B), 1.0f / B.w);
+    f32 det = a*d - b*c;
+    f32 one_over_det = 1.0f / det;
 
-    // NDC->screen:
-    edge->from.x += 1; edge->from.x *= viewport->dimensions.h_width;
-    edge->to.x   += 1; edge->to.x   *= viewport->dimensions.h_width;
-    edge->from.y += 1; edge->from.y *= viewport->dimensions.h_height;
-    edge->to.y   += 1; edge->to.y   *= viewport->dimensions.h_height;
+    out.X.x = +d * one_over_det;
+    out.X.y = -b * one_over_det;
+    out.Y.x = -c * one_over_det;
+    out.Y.y = +a * one_over_det;
 
-    // Flip Y:
-    edge->from.y = viewport->dimensions.f_height - edge->from.y;
-    edge->to.y   = viewport->dimensions.f_height - edge->to.y;
+    return out;
+}
+
+INLINE bool safeInvertMat2(mat2 *m) {
+    f32 a = m->X.x,  b = m->X.y,
+        c = m->Y.x,  d = m->Y.y;
+
+    f32 det = a*d - b*c;
+    if (!det) return false;
+    f32 one_over_det = 1.0f / det;
+
+    m->X.x = +d * one_over_det;
+    m->X.y = -b * one_over_det;
+    m->Y.x = -c * one_over_det;
+    m->Y.y = +a * one_over_det;
 
     return true;
 }
 
-INLINE void drawEdge(Edge *edge, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    if (projectEdge(edge, viewport))
-        drawLine(edge->from.x, edge->from.y, edge->from.z,
-                 edge->to.x,   edge->to.y,   edge->to.z,
-                 color, opacity, line_width, viewport);
-}
+INLINE void rotateMat2(f32 amount, mat2* out) {
+    vec2 xy = getPointOnUnitCircle(amount);
 
-INLINE void convertPositionAndDirectionToObjectSpace(
-        vec3 position,
-        vec3 dir,
-        Primitive *primitive,
-        vec3 *out_position,
-        vec3 *out_direction
-) {
-    *out_position = primitive->flags & IS_TRANSLATED ?
-                    subVec3(position, primitive->position) :
-                    position;
+    vec2 X = out->X;
+    vec2 Y = out->Y;
 
-    if (primitive->flags & IS_ROTATED) {
-        quat inv_rotation = conjugate(primitive->rotation);
-        *out_position = mulVec3Quat(*out_position, inv_rotation);
-        *out_direction = mulVec3Quat(dir, inv_rotation);
-    } else
-        *out_direction = dir;
+    out->X.x = xy.x * X.x + xy.y * X.y;
+    out->Y.x = xy.x * Y.x + xy.y * Y.y;
 
-    if (primitive->flags & IS_SCALED) {
-        vec3 inv_scale = oneOverVec3(primitive->scale);
-        *out_position = mulVec3(*out_position, inv_scale);
-        if (primitive->flags & IS_SCALED_NON_UNIFORMLY)
-            *out_direction = normVec3(mulVec3(*out_direction, inv_scale));
-    }
+    out->X.y = xy.x * X.y - xy.y * X.x;
+    out->Y.y = xy.x * Y.y - xy.y * Y.x;
 }
 
-INLINE vec3 convertPositionToWorldSpace(vec3 position, Primitive *primitive) {
-    if (primitive->flags & IS_SCALED)     position = mulVec3(    position, primitive->scale);
-    if (primitive->flags & IS_ROTATED)    position = mulVec3Quat(position, primitive->rotation);
-    if (primitive->flags & IS_TRANSLATED) position = addVec3(    position, primitive->position);
-    return position;
+INLINE void setRotationMat2(f32 roll, mat2* roll_matrix) {
+    vec2 xy = getPointOnUnitCircle(roll);
+
+    roll_matrix->X.x = roll_matrix->Y.y = xy.x;
+    roll_matrix->X.y = -xy.y;
+    roll_matrix->Y.x = +xy.y;
 }
-INLINE vec3 convertPositionToObjectSpace(vec3 position, Primitive *primitive) {
-    if (primitive->flags & IS_TRANSLATED) position = subVec3(    position, primitive->position);
-    if (primitive->flags & IS_ROTATED)    position = mulVec3Quat(position, conjugate(primitive->rotation));
-    if (primitive->flags & IS_SCALED)     position = mulVec3(position, oneOverVec3(primitive->scale));
-    return position;
+
+
+INLINE vec2 getVec2Of(f32 value) {
+    vec2 out;
+
+    out.x = out.y = value;
+
+    return out;
+}
+INLINE bool isEqualVec2(vec2 a, vec2 b) {
+    return a.x == b.x && a.y == b.y;
 }
 
-INLINE vec3 convertDirectionToWorldSpace(vec3 direction, Primitive *primitive) {
-    if (primitive->flags & IS_SCALED_NON_UNIFORMLY) direction = mulVec3(direction, oneOverVec3(primitive->scale));
-    if (primitive->flags & IS_ROTATED)              direction = mulVec3Quat(direction,         primitive->rotation);
-    return direction;
+INLINE vec2 clampVec2ToZero(vec2 v) {
+    v.x = v.x > 0.0f ? v.x : 0.0f;
+    v.y = v.y > 0.0f ? v.y : 0.0f;
+    return v;
 }
 
-void rotatePrimitive(Primitive *primitive, f32 yaw, f32 pitch, f32 roll) {
-    quat rotation;
-    if (roll) {
-        rotation.amount = roll;
-        rotation.axis.x = 0;
-        rotation.axis.y = 0;
-        rotation.axis.z = 1;
-    } else
-        rotation = getIdentityQuaternion();
+INLINE vec2 clampVec2ToUpper(vec2 v, vec2 upper) {
+    v.x = v.x < upper.x ? v.x : upper.x;
+    v.y = v.y < upper.y ? v.y : upper.y;
+    return v;
+}
 
-    if (pitch) {
-        quat pitch_rotation;
-        pitch_rotation.amount = pitch;
-        pitch_rotation.axis.x = 1;
-        pitch_rotation.axis.y = 0;
-        pitch_rotation.axis.z = 0;
-        pitch_rotation = normQuat(pitch_rotation);
-        rotation = mulQuat(rotation, pitch_rotation);
-        rotation = normQuat(rotation);
-    }
+INLINE vec2 clampVec2(vec2 v) {
+    v.x = v.x > 0.0f ? v.x : 0.0f;
+    v.y = v.y > 0.0f ? v.y : 0.0f;
 
-    if (yaw) {
-        quat yaw_rotation;
-        yaw_rotation.amount = yaw;
-        yaw_rotation.axis.x = 0;
-        yaw_rotation.axis.y = 1;
-        yaw_rotation.axis.z = 0;
-        yaw_rotation = normQuat(yaw_rotation);
-        rotation = mulQuat(rotation, yaw_rotation);
-        rotation = normQuat(rotation);
-    }
+    v.x = v.x < 1.0f ? v.x : 1.0f;
+    v.y = v.y < 1.0f ? v.y : 1.0f;
 
-    primitive->rotation = mulQuat(primitive->rotation, rotation);
-    primitive->rotation = normQuat(primitive->rotation);
+    return v;
 }
 
+INLINE vec2 clampVec2To(vec2 v, const f32 min_value, const f32 max_value) {
+    v.x = v.x > min_value ? v.x : min_value;
+    v.y = v.y > min_value ? v.y : min_value;
 
-INLINE void rotateXform3(xform3 *xform, f32 yaw, f32 pitch, f32 roll) {
-    if (yaw)   yawMat3(  yaw,   &xform->yaw_matrix);
-    if (pitch) pitchMat3(pitch, &xform->pitch_matrix);
-    if (roll)  rollMat3( roll,  &xform->roll_matrix);
+    v.x = v.x < max_value ? v.x : max_value;
+    v.y = v.y < max_value ? v.y : max_value;
 
-    xform->rotation_matrix = mulMat3(mulMat3(xform->pitch_matrix, xform->yaw_matrix), xform->roll_matrix);
-    xform->rotation_matrix_inverted = transposedMat3(xform->rotation_matrix);
+    return v;
+}
 
-    xform->rotation          = convertRotationMatrixToQuaternion(xform->rotation_matrix);
-    xform->rotation_inverted = convertRotationMatrixToQuaternion(xform->rotation_matrix_inverted);
+INLINE vec2 invertedVec2(vec2 in) {
+    vec2 out;
+
+    out.x = -in.x;
+    out.y = -in.y;
 
-    xform->matrix = mulMat3(xform->matrix, xform->rotation_matrix);
+    return out;
 }
 
-u32 getMeshMemorySize(Mesh *mesh, char *file_path, Platform *platform) {
-    void *file = platform->openFileForReading(file_path);
+INLINE vec2 oneOverVec2(vec2 v) {
+    vec2 out;
 
-    platform->readFromFile(&mesh->aabb,           sizeof(AABB), file);
-    platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
-    platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
-    platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
-    platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
-    platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
+    out.x = 1.0f / v.x;
+    out.y = 1.0f / v.y;
 
-    u32 memory_size = sizeof(vec3) * mesh->vertex_count;
-    memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
-    memory_size += sizeof(EdgeVertexIndices) * mesh->edge_count;
+    return out;
+}
 
-    if (mesh->uvs_count) {
-        memory_size += sizeof(vec2) * mesh->uvs_count;
-        memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
-    }
-    if (mesh->normals_count) {
-        memory_size += sizeof(vec3) * mesh->normals_count;
-        memory_size += sizeof(TriangleVertexIndices) * mesh->triangle_count;
-    }
+INLINE vec2 approachVec2(vec2 src, vec2 trg, f32 diff) {
+    vec2 out;
 
-    platform->closeFile(file);
+    out.x = approach(src.x, trg.x, diff);
+    out.y = approach(src.y, trg.y, diff);
 
-    return memory_size;
+    return out;
 }
 
-void loadMeshFromFile(Mesh *mesh, char *file_path, Platform *platform, Memory *memory) {
-    void *file = platform->openFileForReading(file_path);
+INLINE bool nonZeroVec2(vec2 v) {
+    return v.x != 0 ||
+           v.y != 0;
+}
 
-    mesh->vertex_normals          = null;
-    mesh->vertex_normal_indices   = null;
-    mesh->vertex_uvs              = null;
-    mesh->vertex_uvs_indices      = null;
+INLINE vec2 minVec2(vec2 a, vec2 b) {
+    vec2 out;
 
-    platform->readFromFile(&mesh->aabb,           sizeof(AABB), file);
-    platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
-    platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
-    platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
-    platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
-    platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
+    out.x = a.x < b.x ? a.x : b.x;
+    out.y = a.y < b.y ? a.y : b.y;
 
-    mesh->vertex_positions        = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->vertex_count);
-    mesh->vertex_position_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
-    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )allocateMemory(memory, sizeof(EdgeVertexIndices)     * mesh->edge_count);
+    return out;
+}
 
-    platform->readFromFile(mesh->vertex_positions,             sizeof(vec3)                  * mesh->vertex_count,   file);
-    platform->readFromFile(mesh->vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    platform->readFromFile(mesh->edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-    if (mesh->uvs_count) {
-        mesh->vertex_uvs         = (vec2*                 )allocateMemory(memory, sizeof(vec2)                  * mesh->uvs_count);
-        mesh->vertex_uvs_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
-        platform->readFromFile(mesh->vertex_uvs,               sizeof(vec2)                  * mesh->uvs_count,      file);
-        platform->readFromFile(mesh->vertex_uvs_indices,       sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    }
-    if (mesh->normals_count) {
-        mesh->vertex_normals          = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->normals_count);
-        mesh->vertex_normal_indices   = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
-        platform->readFromFile(mesh->vertex_normals,                sizeof(vec3)                  * mesh->normals_count,  file);
-        platform->readFromFile(mesh->vertex_normal_indices,         sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    }
+INLINE vec2 maxVec2(vec2 a, vec2 b) {
+    vec2 out;
 
-    platform->closeFile(file);
+    out.x = a.x > b.x ? a.x : b.x;
+    out.y = a.y > b.y ? a.y : b.y;
+
+    return out;
 }
 
-void saveMeshToFile(Mesh *mesh, char* file_path, Platform *platform) {
-    void *file = platform->openFileForWriting(file_path);
+INLINE f32 minCoordVec2(vec2 v) {
+    f32 out = v.x;
+    if (v.y < out) out = v.y;
+    return out;
+}
 
-    platform->writeToFile(&mesh->aabb,           sizeof(AABB), file);
-    platform->writeToFile(&mesh->vertex_count,   sizeof(u32),  file);
-    platform->writeToFile(&mesh->triangle_count, sizeof(u32),  file);
-    platform->writeToFile(&mesh->edge_count,     sizeof(u32),  file);
-    platform->writeToFile(&mesh->uvs_count,      sizeof(u32),  file);
-    platform->writeToFile(&mesh->normals_count,  sizeof(u32),  file);
-    platform->writeToFile(mesh->vertex_positions,        sizeof(vec3)                  * mesh->vertex_count,   file);
-    platform->writeToFile(mesh->vertex_position_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    platform->writeToFile(mesh->edge_vertex_indices,     sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-    if (mesh->uvs_count) {
-        platform->writeToFile(mesh->vertex_uvs,          sizeof(vec2)                  * mesh->uvs_count,      file);
-        platform->writeToFile(mesh->vertex_uvs_indices,  sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    }
-    if (mesh->normals_count) {
-        platform->writeToFile(mesh->vertex_normals,        sizeof(vec3)                  * mesh->normals_count,  file);
-        platform->writeToFile(mesh->vertex_normal_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-    }
+INLINE f32 maxCoordVec2(vec2 v) {
+    f32 out = v.x;
+    if (v.y > out) out = v.y;
+    return out;
+}
 
-    platform->closeFile(file);
+INLINE vec2 subVec2(vec2 a, vec2 b) {
+    vec2 out;
+
+    out.x = a.x - b.x;
+    out.y = a.y - b.y;
+
+    return out;
 }
 
-void writeSceneSettingsToFile(SceneSettings *settings, void *file, Platform *platform) {
-    platform->writeToFile(&settings->boxes, sizeof(u32), file);
-    platform->writeToFile(&settings->cameras, sizeof(u32), file);
-    platform->writeToFile(&settings->curves, sizeof(u32), file);
-    platform->writeToFile(&settings->grids, sizeof(u32), file);
-    platform->writeToFile(&settings->meshes, sizeof(u32), file);
-    platform->writeToFile(&settings->primitives, sizeof(u32), file);
+INLINE vec2 addVec2(vec2 a, vec2 b) {
+    vec2 out;
+
+    out.x = a.x + b.x;
+    out.y = a.y + b.y;
+
+    return out;
 }
 
-void readSceneSettingsFromFile(SceneSettings *settings, void *file, Platform *platform) {
-    platform->readFromFile(&settings->boxes, sizeof(u32), file);
-    platform->readFromFile(&settings->cameras, sizeof(u32), file);
-    platform->readFromFile(&settings->curves, sizeof(u32), file);
-    platform->readFromFile(&settings->grids, sizeof(u32), file);
-    platform->readFromFile(&settings->meshes, sizeof(u32), file);
-    platform->readFromFile(&settings->primitives, sizeof(u32), file);
+INLINE vec2 mulVec2(vec2 a, vec2 b) {
+    vec2 out;
+
+    out.x = a.x * b.x;
+    out.y = a.y * b.y;
+
+    return out;
 }
 
-void writeTransformToFile(xform3 *xform, void *file, Platform *platform) {
-    platform->writeToFile(&xform->matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->yaw_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->pitch_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->roll_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->rotation_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->rotation_matrix_inverted, sizeof(mat3), file);
+INLINE vec2 mulAddVec2(vec2 v, vec2 factors, vec2 to_be_added) {
+    vec2 out;
 
-    platform->writeToFile(&xform->rotation, sizeof(quat), file);
-    platform->writeToFile(&xform->rotation_inverted, sizeof(quat), file);
+    out.x = fast_mul_add(v.x, factors.x, to_be_added.x);
+    out.y = fast_mul_add(v.y, factors.y, to_be_added.y);
 
-    platform->writeToFile(&xform->position, sizeof(vec3), file);
-    platform->writeToFile(&xform->scale, sizeof(vec3), file);
+    return out;
 }
 
-void readTransformFromFile(xform3 *xform, void *file, Platform *platform) {
-    platform->readFromFile(&xform->matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->yaw_matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->pitch_matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->roll_matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->rotation_matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->rotation_matrix_inverted, sizeof(mat3), file);
+INLINE vec2 scaleAddVec2(vec2 v, f32 factor, vec2 to_be_added) {
+    vec2 out;
 
-    platform->readFromFile(&xform->rotation, sizeof(quat), file);
-    platform->readFromFile(&xform->rotation_inverted, sizeof(quat), file);
+    out.x = fast_mul_add(v.x, factor, to_be_added.x);
+    out.y = fast_mul_add(v.y, factor, to_be_added.y);
 
-    platform->readFromFile(&xform->position, sizeof(vec3), file);
-    platform->readFromFile(&xform->scale, sizeof(vec3), file);
+    return out;
+}
 
-    xform->right_direction   = &xform->rotation_matrix.X;
-    xform->up_direction      = &xform->rotation_matrix.Y;
-    xform->forward_direction = &xform->rotation_matrix.Z;
+INLINE vec2 scaleVec2(vec2 a, f32 factor) {
+    vec2 out;
+
+    out.x = a.x * factor;
+    out.y = a.y * factor;
+
+    return out;
 }
 
-void loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
-    void *file = platform->openFileForReading(file_path);
+INLINE vec2 mulVec2Mat2(vec2 in, mat2 m) {
+    vec2 out;
 
-    readSceneSettingsFromFile(&scene->settings, file, platform);
+    out.x = in.x * m.X.x + in.y * m.Y.x;
+    out.y = in.x * m.X.y + in.y * m.Y.y;
 
-    if (scene->cameras) {
-        Camera *camera = scene->cameras;
-        for (u32 i = 0; i < scene->settings.cameras; i++, camera++) {
-            platform->readFromFile(&camera->focal_length, sizeof(f32), file);
-            platform->readFromFile(&camera->zoom, sizeof(f32), file);
-            platform->readFromFile(&camera->dolly, sizeof(f32), file);
-            platform->readFromFile(&camera->target_distance, sizeof(f32), file);
-            platform->readFromFile(&camera->current_velocity, sizeof(vec3), file);
-            readTransformFromFile(&camera->transform, file, platform);
-        }
-    }
+    return out;
+}
 
-    if (scene->primitives)
-        for (u32 i = 0; i < scene->settings.primitives; i++)
-            platform->readFromFile(scene->primitives + i, sizeof(Primitive), file);
+INLINE f32 dotVec2(vec2 a, vec2 b) {
+    return (
+            (a.x * b.x) +
+            (a.y * b.y)
+    );
+}
 
-    if (scene->grids)
-        for (u32 i = 0; i < scene->settings.grids; i++)
-            platform->readFromFile(scene->grids + i, sizeof(Grid), file);
+INLINE f32 squaredLengthVec2(vec2 v) {
+    return (
+            (v.x * v.x) +
+            (v.y * v.y)
+    );
+}
 
-    if (scene->boxes)
-        for (u32 i = 0; i < scene->settings.boxes; i++)
-            platform->readFromFile(scene->boxes + i, sizeof(Box), file);
+INLINE f32 lengthVec2(vec2 v) {
+    return sqrtf(squaredLengthVec2(v));
+}
 
-    if (scene->curves)
-        for (u32 i = 0; i < scene->settings.curves; i++)
-            platform->readFromFile(scene->curves + i, sizeof(Curve), file);
+INLINE vec2 normVec2(vec2 v) {
+    return scaleVec2(v, 1.0f / lengthVec2(v));
+}
 
-    if (scene->meshes) {
-        Mesh *mesh = scene->meshes;
-        for (u32 i = 0; i < scene->settings.meshes; i++, mesh++) {
-            platform->readFromFile(&mesh->aabb,           sizeof(AABB), file);
-            platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
-            platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
-            platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
-            platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
-            platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
-
-            platform->readFromFile(mesh->vertex_positions,             sizeof(vec3)                  * mesh->vertex_count,   file);
-            platform->readFromFile(mesh->vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            platform->readFromFile(mesh->edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-            if (mesh->uvs_count) {
-                platform->readFromFile(mesh->vertex_uvs,               sizeof(vec2)                  * mesh->uvs_count,      file);
-                platform->readFromFile(mesh->vertex_uvs_indices,       sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-            if (mesh->normals_count) {
-                platform->readFromFile(mesh->vertex_normals,                sizeof(vec3)                  * mesh->normals_count,  file);
-                platform->readFromFile(mesh->vertex_normal_indices,         sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-        };
-    }
+INLINE f32 DotVec2(vec2 a, vec2 b) { return clampValue(dotVec2(a, b)); }
 
-    platform->closeFile(file);
+INLINE mat2 outerVec2(vec2 a, vec2 b) {
+    mat2 out;
+
+    out.X = scaleVec2(a, b.x);
+    out.Y = scaleVec2(a, b.y);
+
+    return out;
 }
 
-void saveSceneToFile(Scene *scene, char* file_path, Platform *platform) {
-    void *file = platform->openFileForWriting(file_path);
-
-    writeSceneSettingsToFile(&scene->settings, file, platform);
+INLINE vec2 reflectVec2(vec2 V, vec2 N) {
+    vec2 out = scaleVec2(N, -2 * dotVec2(N, V));
+         out = addVec2(out, V);
+    return out;
+}
 
-    if (scene->cameras) {
-        Camera *camera = scene->cameras;
-        for (u32 i = 0; i < scene->settings.cameras; i++, camera++) {
-            platform->writeToFile(&camera->focal_length, sizeof(f32), file);
-            platform->writeToFile(&camera->zoom, sizeof(f32), file);
-            platform->writeToFile(&camera->dolly, sizeof(f32), file);
-            platform->writeToFile(&camera->target_distance, sizeof(f32), file);
-            platform->writeToFile(&camera->current_velocity, sizeof(vec3), file);
-            writeTransformToFile(&camera->transform, file, platform);
-        }
-    }
 
-    if (scene->primitives)
-        for (u32 i = 0; i < scene->settings.primitives; i++)
-            platform->writeToFile(scene->primitives + i, sizeof(Primitive), file);
+//
+//void drawCircle(Viewport *viewport, vec3 color, f32 opacity, i32 center_x, i32 center_y, i32 radius) {
+//    if (radius <= 1) {
+//        if (inRange(0, center_x, viewport->dimensions.width - 1) &&
+//            inRange(0, center_y, viewport->dimensions.height - 1))
+//            setPixel(viewport, center_y, center_x, color, opacity, 0);
+//
+//        return;
+//    }
+//
+//    i32 width = viewport->dimensions.width;
+//    i32 size  = viewport->dimensions.width_times_height;
+//
+//    i32 x = radius, y = 0, y2 = 0;
+//    i32 r2 = radius * radius;
+//    i32 x2 = r2;
+//
+//    i32 Sx1 = center_x - radius;
+//    i32 Ex1 = center_x + radius;
+//    i32 Sy1 = center_y * width;
+//    i32 Ey1 = Sy1;
+//
+//    i32 Sx2 = center_x;
+//    i32 Ex2 = center_x;
+//    i32 Sy2 = (center_y - radius) * width;
+//    i32 Ey2 = (center_y + radius) * width;
+//
+//    while (y <= x) {
+//        if (Sy1 >= 0 && Sy1 < size) {
+//            if (Sx1 >= 0 && Sx1 < width) setPixel(canvas->float_pixels + (Sy1 + Sx1), color, opacity, 0);
+//            if (Ex1 >= 0 && Ex1 < width) setPixel(canvas->float_pixels + (Sy1 + Ex1), color, opacity, 0);
+//        }
+//        if (Ey1 >= 0 && Ey1 < size) {
+//            if (Sx1 >= 0 && Sx1 < width) setPixel(canvas->float_pixels + (Ey1 + Sx1), color, opacity, 0);
+//            if (Ex1 >= 0 && Ex1 < width) setPixel(canvas->float_pixels + (Ey1 + Ex1), color, opacity, 0);
+//        }
+//
+//        if (Sy2 >= 0 && Sy2 < size) {
+//            if (Sx2 >= 0 && Sx2 < width) setPixel(canvas->float_pixels + (Sy2 + Sx2), color, opacity, 0);
+//            if (Ex2 >= 0 && Ex2 < width) setPixel(canvas->float_pixels + (Sy2 + Ex2), color, opacity, 0);
+//        }
+//        if (Ey2 >= 0 && Ey2 < size) {
+//            if (Sx2 >= 0 && Sx2 < width) setPixel(canvas->float_pixels + (Ey2 + Sx2), color, opacity, 0);
+//            if (Ex2 >= 0 && Ex2 < width) setPixel(canvas->float_pixels + (Ey2 + Ex2), color, opacity, 0);
+//        }
+//
+//        if ((x2 + y2) > r2) {
+//            x -= 1;
+//            x2 = x * x;
+//
+//            Sx1 += 1;
+//            Ex1 -= 1;
+//
+//            Sy2 += width;
+//            Ey2 -= width;
+//        }
+//
+//        y += 1;
+//        y2 = y * y;
+//
+//        Sy1 -= width;
+//        Ey1 += width;
+//
+//        Sx2 -= 1;
+//        Ex2 += 1;
+//    }
+//}
+//
+//void fillCircle2D(PixelGrid *canvas, RGBA color, i32 center_x, i32 center_y, i32 radius) {
+//    if (radius <= 1) {
+//        if (inRange(0, center_x, canvas->dimensions.width - 1) &&
+//            inRange(0, center_y, canvas->dimensions.height - 1))
+//            setPixel(canvas->float_pixels + (canvas->dimensions.width * center_y + center_x), color, opacity, 0);
+//
+//        return;
+//    }
+//
+//    i32 width = canvas->dimensions.width;
+//    i32 size  = canvas->dimensions.width_times_height;
+//
+//    i32 x = radius, y = 0, y2 = 0;
+//    i32 r2 = radius * radius;
+//    i32 x2 = r2;
+//
+//    i32 Sx1 = center_x - radius;
+//    i32 Ex1 = center_x + radius;
+//    i32 Sy1 = center_y * width;
+//    i32 Ey1 = Sy1;
+//
+//    i32 Sx2 = center_x;
+//    i32 Ex2 = center_x;
+//    i32 Sy2 = (center_y - radius) * width;
+//    i32 Ey2 = (center_y + radius) * width;
+//
+//    i32 i, start, end;
+//
+//    while (y <= x) {
+//        start = Sx1 > 0 ? Sx1 : 0;
+//        end   = Ex1 < (width - 1) ? Ex1 : (width - 1);
+//        if (Sy1 >= 0 && Sy1 < size) for (i = start; i <= end; i++) setPixel(canvas->float_pixels + (Sy1 + i), color, opacity, 0);
+//        if (Ey1 >= 0 && Ey1 < size) for (i = start; i <= end; i++) setPixel(canvas->float_pixels + (Ey1 + i), color, opacity, 0);
+//
+//        start = Sx2 > 0 ? Sx2 : 0;
+//        end   = Ex2 < (width - 1) ? Ex2 : (width - 1);
+//        if (Sy2 >= 0 && Sy2 < size) for (i = start; i <= end; i++) setPixel(canvas->float_pixels + (Sy2 + i), color, opacity, 0);
+//        if (Ey2 >= 0 && Ey2 < size) for (i = start; i <= end; i++) setPixel(canvas->float_pixels + (Ey2 + i), color, opacity, 0);
+//
+//        if ((x2 + y2) > r2) {
+//            x -= 1;
+//            x2 = x * x;
+//
+//            Sx1 += 1;
+//            Ex1 -= 1;
+//
+//            Sy2 += width;
+//            Ey2 -= width;
+//        }
+//
+//        y += 1;
+//        y2 = y * y;
+//
+//        Sy1 -= width;
+//        Ey1 += width;
+//
+//        Sx2 -= 1;
+//        Ex2 += 1;
+//    }
+//}
 
-    if (scene->grids)
-        for (u32 i = 0; i < scene->settings.grids; i++)
-            platform->writeToFile(scene->grids + i, sizeof(Grid), file);
 
-    if (scene->boxes)
-        for (u32 i = 0; i < scene->settings.boxes; i++)
-            platform->writeToFile(scene->boxes + i, sizeof(Box), file);
+INLINE void drawRect(Rect rect, vec3 color, f32 opacity, Viewport *viewport) {
+    if (rect.max.x < 0 || rect.min.x >= viewport->dimensions.width ||
+        rect.max.y < 0 || rect.min.y >= viewport->dimensions.height)
+        return;
 
-    if (scene->curves)
-        for (u32 i = 0; i < scene->settings.curves; i++)
-            platform->writeToFile(scene->curves + i, sizeof(Curve), file);
+    drawHLine(rect.min.x, rect.max.x, rect.min.y, color, opacity, viewport);
+    drawHLine(rect.min.x, rect.max.x, rect.max.y, color, opacity, viewport);
+    drawVLine(rect.min.y, rect.max.y, rect.min.x, color, opacity, viewport);
+    drawVLine(rect.min.y, rect.max.y, rect.max.x, color, opacity, viewport);
+}
 
-    if (scene->meshes) {
-        Mesh *mesh = scene->meshes;
-        for (u32 i = 0; i < scene->settings.meshes; i++, mesh++) {
-            platform->writeToFile(&mesh->aabb,           sizeof(AABB), file);
-            platform->writeToFile(&mesh->vertex_count,   sizeof(u32),  file);
-            platform->writeToFile(&mesh->triangle_count, sizeof(u32),  file);
-            platform->writeToFile(&mesh->edge_count,     sizeof(u32),  file);
-            platform->writeToFile(&mesh->uvs_count,      sizeof(u32),  file);
-            platform->writeToFile(&mesh->normals_count,  sizeof(u32),  file);
-
-            platform->writeToFile(mesh->vertex_positions,        sizeof(vec3)                  * mesh->vertex_count,   file);
-            platform->writeToFile(mesh->vertex_position_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            platform->writeToFile(mesh->edge_vertex_indices,     sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-            if (mesh->uvs_count) {
-                platform->writeToFile(mesh->vertex_uvs,          sizeof(vec2)                  * mesh->uvs_count,      file);
-                platform->writeToFile(mesh->vertex_uvs_indices,  sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-            if (mesh->normals_count) {
-                platform->writeToFile(mesh->vertex_normals,        sizeof(vec3)                  * mesh->normals_count,  file);
-                platform->writeToFile(mesh->vertex_normal_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-        }
-    }
+INLINE void fillRect(Rect rect, vec3 color, f32 opacity, Viewport *viewport) {
+    if (rect.max.x < 0 || rect.min.x >= viewport->dimensions.width ||
+        rect.max.y < 0 || rect.min.y >= viewport->dimensions.height)
+        return;
 
-    platform->closeFile(file);
+    i32 min_x, min_y, max_x, max_y;
+    subRange(rect.min.x, rect.max.x, viewport->dimensions.width,  0, &min_x, &max_x);
+    subRange(rect.min.y, rect.max.y, viewport->dimensions.height, 0, &min_y, &max_y);
+    for (i32 y = min_y; y <= max_y; y++)
+        drawHLine(min_x, max_x, y, color, opacity, viewport);
 }
 
 
+//
+//void fillTriangle(PixelGrid *canvas, vec3 color, f32 opacity, f32 *X, f32 *Y) {
+//    u16 W = canvas->dimensions.width;
+//    u16 H = canvas->dimensions.height;
+//    f32 dx1, x1, y1, xs,
+//            dx2, x2, y2, xe,
+//            dx3, x3, y3, dy;
+//    i32 offset,
+//            x, x1i, y1i, x2i, xsi, ysi = 0,
+//            y, y2i, x3i, y3i, xei, yei = 0;
+//    for (u8 i = 1; i <= 2; i++) {
+//        if (Y[i] < Y[ysi]) ysi = i;
+//        if (Y[i] > Y[yei]) yei = i;
+//    }
+//    u8 id[3];
+//    if (ysi) {
+//        if (ysi == 1) {
+//            id[0] = 1;
+//            id[1] = 2;
+//            id[2] = 0;
+//        } else {
+//            id[0] = 2;
+//            id[1] = 0;
+//            id[2] = 1;
+//        }
+//    } else {
+//        id[0] = 0;
+//        id[1] = 1;
+//        id[2] = 2;
+//    }
+//    x1 = X[id[0]]; y1 = Y[id[0]]; x1i = (i32)x1; y1i = (i32)y1;
+//    x2 = X[id[1]]; y2 = Y[id[1]]; x2i = (i32)x2; y2i = (i32)y2;
+//    x3 = X[id[2]]; y3 = Y[id[2]]; x3i = (i32)x3; y3i = (i32)y3;
+//    dx1 = x1i == x2i || y1i == y2i ? 0 : (x2 - x1) / (y2 - y1);
+//    dx2 = x2i == x3i || y2i == y3i ? 0 : (x3 - x2) / (y3 - y2);
+//    dx3 = x1i == x3i || y1i == y3i ? 0 : (x3 - x1) / (y3 - y1);
+//    dy = 1 - (y1 - (f32)y1);
+//    xs = dx3 ? x1 + dx3 * dy : x1; ysi = (i32)Y[ysi];
+//    xe = dx1 ? x1 + dx1 * dy : x1; yei = (i32)Y[yei];
+//    offset = W * y1i;
+//    for (y = ysi; y < yei; y++) {
+//        if (y == y3i) xs = dx2 ? (x3 + dx2 * (1 - (y3 - (f32)y3i))) : x3;
+//        if (y == y2i) xe = dx2 ? (x2 + dx2 * (1 - (y2 - (f32)y2i))) : x2;
+//        xsi = (i32)xs;
+//        xei = (i32)xe;
+//        for (x = xsi; x < xei; x++) {
+//            if (x > 0 && x < W && y > 0 && y < H)
+//                setPixel(canvas->float_pixels + (offset + x), color, opacity, 0);
+//        }
+//        offset += W;
+//        xs += y < y3i ? dx3 : dx2;
+//        xe += y < y2i ? dx1 : dx2;
+//    }
+//}
+
 
 void transformBoxVerticesFromObjectToViewSpace(BoxVertices *vertices, BoxVertices *transformed_vertices, Primitive *primitive, Viewport *viewport) {
-    vec3 position;
-    for (u8 i = 0; i < BOX__VERTEX_COUNT; i++) {
-        position = vertices->buffer[i];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(    position, viewport->camera->transform.position);
-        position = mulVec3Quat(position, viewport->camera->transform.rotation_inverted);
-        transformed_vertices->buffer[i] = position;
-    }
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    for (u8 i = 0; i < BOX__VERTEX_COUNT; i++)
+        transformed_vertices->buffer[i] = mulVec3Mat3x4(vertices->buffer[i], object_to_view);
 }
 
 void drawBox(Box *box, u8 sides, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawBox");
+
     // Transform vertices positions from local-space to world-space and then to view-space:
-    static BoxVertices vertices;
+    BoxVertices vertices;
     transformBoxVerticesFromObjectToViewSpace(&box->vertices, &vertices, primitive, viewport);
 
     // Distribute transformed vertices positions to edges:
-    static BoxEdges edges;
+    BoxEdges edges;
     setBoxEdgesFromVertices(&edges, &vertices);
 
     if (sides == BOX__ALL_SIDES) {
@@ -3906,14 +7882,18 @@ void drawBox(Box *box, u8 sides, Primitive *primitive, vec3 color, f32 opacity,
         if (sides & Right | sides & Top   ) drawEdge(&edges.sides.right_top,    color, opacity, line_width, viewport);
         if (sides & Right | sides & Bottom) drawEdge(&edges.sides.right_bottom, color, opacity, line_width, viewport);
     }
+
+    PROFILE_END();
 }
 
 void drawCamera(Camera *camera, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    static Box box;
-    static Primitive primitive;
+    PROFILE_BEGIN("drawCamera");
+
+    Box box;
+    Primitive primitive;
     initBox(&box);
     primitive.flags = ALL_FLAGS;
-    primitive.rotation = camera->transform.rotation;
+    primitive.rotation = getXform3Rotation(&camera->transform);
     primitive.position = camera->transform.position;
     primitive.scale.x  = primitive.scale.y = primitive.scale.z = 1;
     drawBox(&box, BOX__ALL_SIDES, &primitive, color, opacity, line_width, viewport);
@@ -3928,145 +7908,214 @@ void drawCamera(Camera *camera, vec3 color, f32 opacity, u8 line_width, Viewport
     for (u8 i = 0; i < BOX__VERTEX_COUNT; i++)
         box.vertices.buffer[i].z += 1.5f;
     drawBox(&box, BOX__ALL_SIDES, &primitive, color, opacity, line_width, viewport);
-}
-
-
-
-#define CURVE_STEPS 3600
-
-void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    f32 one_over_step_count = 1.0f / (f32)step_count;
-    f32 rotation_step = one_over_step_count * TAU;
-    f32 rotation_step_times_rev_count = rotation_step * (f32)curve->revolution_count;
-
-    if (primitive->type == PrimitiveType_Helix)
-        rotation_step = rotation_step_times_rev_count;
-
-    vec3 center_to_orbit;
-    center_to_orbit.x = 1;
-    center_to_orbit.y = center_to_orbit.z = 0;
-
-    vec3 orbit_to_curve;
-    orbit_to_curve.x = curve->thickness;
-    orbit_to_curve.y = orbit_to_curve.z = 0;
-
-    mat3 rotation;
-    rotation.X.x = rotation.Z.z = cosf(rotation_step);
-    rotation.X.z = sinf(rotation_step);
-    rotation.Z.x = -rotation.X.z;
-    rotation.X.y = rotation.Z.y = rotation.Y.x = rotation.Y.z =  0;
-    rotation.Y.y = 1;
-
-    mat3 orbit_to_curve_rotation;
-    if (primitive->type == PrimitiveType_Coil) {
-        orbit_to_curve_rotation.X.x = orbit_to_curve_rotation.Y.y = cosf(rotation_step_times_rev_count);
-        orbit_to_curve_rotation.X.y = sinf(rotation_step_times_rev_count);
-        orbit_to_curve_rotation.Y.x = -orbit_to_curve_rotation.X.y;
-        orbit_to_curve_rotation.X.z = orbit_to_curve_rotation.Y.z = orbit_to_curve_rotation.Z.x = orbit_to_curve_rotation.Z.y =  0;
-        orbit_to_curve_rotation.Z.z = 1;
-    }
-
-    // Transform vertices positions of edges from view-space to screen-space (w/ culling and clipping):
-    mat3 accumulated_orbit_rotation = rotation;
-    vec3 current_position, previous_position;
-    Edge edge;
 
-    for (u32 i = 0; i < step_count; i++) {
-        center_to_orbit = mulVec3Mat3(center_to_orbit, rotation);
-
-        switch (primitive->type) {
-            case PrimitiveType_Helix:
-                current_position = center_to_orbit;
-                current_position.y -= 1;
-                break;
-            case PrimitiveType_Coil:
-                orbit_to_curve  = mulVec3Mat3(orbit_to_curve, orbit_to_curve_rotation);
-                current_position = mulVec3Mat3(orbit_to_curve, accumulated_orbit_rotation);
-                current_position = addVec3(center_to_orbit, current_position);
-                break;
-            default:
-                break;
-        }
-
-        current_position = convertPositionToWorldSpace(current_position, primitive);
-        current_position = subVec3(    current_position, viewport->camera->transform.position);
-        current_position = mulVec3Quat(current_position, viewport->camera->transform.rotation_inverted);
-
-        if (i) {
-            edge.from = previous_position;
-            edge.to   = current_position;
-            drawEdge(&edge, color, opacity, line_width, viewport);
-        }
-
-        switch (primitive->type) {
-            case PrimitiveType_Helix:
-                center_to_orbit.y += 2 * one_over_step_count;
-                break;
-            case PrimitiveType_Coil:
-                accumulated_orbit_rotation = mulMat3(accumulated_orbit_rotation, rotation);
-                break;
-            default:
-                break;
-        }
-
-        previous_position = current_position;
-    }
+    PROFILE_END();
 }
 
 
-
 void transformGridVerticesFromObjectToViewSpace(Grid *grid, GridVertices *transformed_vertices, Primitive *primitive, Viewport *viewport) {
-    vec3 position;
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
     for (u8 side = 0; side < 2; side++) {
         for (u8 axis = 0; axis < 2; axis++) {
             u8 segment_count = axis ? grid->v_segments : grid->u_segments;
             for (u8 segment = 0; segment < segment_count; segment++) {
-                position = grid->vertices.buffer[axis][side][segment];
-                position = convertPositionToWorldSpace(position, primitive);
-                position = subVec3(    position, viewport->camera->transform.position);
-                position = mulVec3Quat(position, viewport->camera->transform.rotation_inverted);
-                transformed_vertices->buffer[axis][side][segment] = position;
+                transformed_vertices->buffer[axis][side][segment] = mulVec3Mat3x4(
+                        grid->vertices.buffer[axis][side][segment], object_to_view);
             }
         }
     }
 }
 
 void drawGrid(Grid *grid, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    // Transform vertices positions from local-space to world-space and then to view-space:
-    static GridVertices vertices;
+    PROFILE_BEGIN("drawGrid");
+
+    // Transform the end points of each line from local-space to world-space and then to view-space, one line at a
+    // time (no scratch buffers are kept, so that grids can be drawn from multiple threads at once):
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    Edge edge;
+    for (u8 u = 0; u < grid->u_segments; u++) {
+        edge.from = mulVec3Mat3x4(grid->vertices.uv.u.from[u], object_to_view);
+        edge.to   = mulVec3Mat3x4(grid->vertices.uv.u.to[u],   object_to_view);
+        drawEdge(&edge, color, opacity, line_width, viewport);
+    }
+    for (u8 v = 0; v < grid->v_segments; v++) {
+        edge.from = mulVec3Mat3x4(grid->vertices.uv.v.from[v], object_to_view);
+        edge.to   = mulVec3Mat3x4(grid->vertices.uv.v.to[v],   object_to_view);
+        drawEdge(&edge, color, opacity, line_width, viewport);
+    }
 
-    transformGridVerticesFromObjectToViewSpace(grid, &vertices, primitive, viewport);
+    PROFILE_END();
+}
+
+// Clips a convex polygon on the XZ plane by the half-plane a*x + c*z + d >= 0 (into the given output polygon):
+u8 clipGridPolygon(vec2 *in, u8 in_count, f32 a, f32 c, f32 d, vec2 *out) {
+    u8 out_count = 0;
+    vec2 *previous = in + in_count - 1;
+    f32 previous_distance = a * previous->x + c * previous->y + d;
+    for (u8 i = 0; i < in_count; i++) {
+        vec2 *current = in + i;
+        f32 current_distance = a * current->x + c * current->y + d;
+        if ((current_distance >= 0) != (previous_distance >= 0)) {
+            f32 t = previous_distance / (previous_distance - current_distance);
+            out[out_count++] = Vec2(previous->x + t * (current->x - previous->x),
+                                    previous->y + t * (current->y - previous->y));
+        }
+        if (current_distance >= 0) out[out_count++] = *current;
+        previous = current;
+        previous_distance = current_distance;
+    }
 
-    // Distribute transformed vertices positions to edges:
-    static GridEdges edges;
-    setGridEdgesFromVertices(edges.uv.u, grid->u_segments, vertices.uv.u.from, vertices.uv.u.to);
-    setGridEdgesFromVertices(edges.uv.v, grid->v_segments, vertices.uv.v.from, vertices.uv.v.to);
+    return out_count;
+}
+
+// Clips the view-space plane n.v + d >= 0 by the grid's plane, in the grid's object space (where y = 0):
+INLINE u8 clipGridPolygonByViewPlane(vec2 *in, u8 in_count, vec3 n, f32 d, mat3x4 *object_to_view, vec2 *out) {
+    return clipGridPolygon(in, in_count,
+                           dotVec3(n, object_to_view->X),
+                           dotVec3(n, object_to_view->Z),
+                           dotVec3(n, object_to_view->W) + d, out);
+}
+
+void drawInfiniteGridSegment(u8 axis, f32 line_position, f32 from, f32 to, f32 min, f32 max,
+                             mat3x4 *object_to_view, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    if (from < min) from = min;
+    if (to   > max) to   = max;
+    if (from >= to) return;
 
-    for (u8 u = 0; u < grid->u_segments; u++) drawEdge(edges.uv.u + u, color, opacity, line_width, viewport);
-    for (u8 v = 0; v < grid->v_segments; v++) drawEdge(edges.uv.v + v, color, opacity, line_width, viewport);
+    Edge edge;
+    if (axis) {
+        edge.from = Vec3(from, 0, line_position);
+        edge.to   = Vec3(to,   0, line_position);
+    } else {
+        edge.from = Vec3(line_position, 0, from);
+        edge.to   = Vec3(line_position, 0, to);
+    }
+    edge.from = mulVec3Mat3x4(edge.from, *object_to_view);
+    edge.to   = mulVec3Mat3x4(edge.to,   *object_to_view);
+    drawEdge(&edge, color, opacity, line_width, viewport);
+}
+
+// Draws a line of the grid (along Z for axis 0, or along X for axis 1) within the given range along it.
+// It is split into bands of distance from the camera, with the opacity of each band falling off quadratically:
+void drawInfiniteGridLine(u8 axis, f32 line_position, f32 min, f32 max, vec3 camera_position, f32 fade_distance,
+                          mat3x4 *object_to_view, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    f32 center = axis ? camera_position.x : camera_position.z;
+    f32 offset = line_position - (axis ? camera_position.z : camera_position.x);
+    f32 squared_distance_to_line = offset * offset + camera_position.y * camera_position.y;
+    f32 band_width = fade_distance / GRID__FADE_BANDS;
+    f32 inner_radius, outer_radius, inner = 0, outer, factor;
+
+    for (u8 band = 0; band < GRID__FADE_BANDS; band++) {
+        outer_radius = band_width * (f32)(band + 1);
+        outer_radius *= outer_radius;
+        if (outer_radius <= squared_distance_to_line) continue;
+        outer = sqrtf(outer_radius - squared_distance_to_line);
+
+        inner_radius = band_width * (f32)band;
+        inner_radius *= inner_radius;
+        inner = inner_radius > squared_distance_to_line ? sqrtf(inner_radius - squared_distance_to_line) : 0;
+
+        factor = ((f32)band + 0.5f) / GRID__FADE_BANDS;
+        factor = opacity * (1 - factor * factor);
+        if (inner == 0)
+            drawInfiniteGridSegment(axis, line_position, center - outer, center + outer, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+        else {
+            drawInfiniteGridSegment(axis, line_position, center - outer, center - inner, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+            drawInfiniteGridSegment(axis, line_position, center + inner, center + outer, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+        }
+    }
 }
 
+// Draws an unbounded grid on the XZ plane of the primitive's object space, with lines a unit apart (so the primitive's
+// scale sets their spacing) that fade out with distance from the camera until they vanish at the fade distance.
+// The fade distance is in the same object space units (of line spacing), so it is also scaled by the primitive's scale:
+// A fade distance of 30 on a primitive with a scale of 2 has the lines vanish 60 world units away from the camera.
+// Only lines that can be visible are touched: The square around the camera that the fade distance spans on the plane
+// is clipped by the view frustum, and lines are only drawn across the bounds of what remains of it.
+// So the cost depends only on the fade distance relative to the spacing, never on the (logical) size of the grid.
+void drawInfiniteGrid(f32 fade_distance, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawInfiniteGrid");
+
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    vec3 camera_position = mulVec3Mat3x4(viewport->camera->transform.position, primitive->world_matrix_inverted);
+    f32 squared_radius = fade_distance * fade_distance - camera_position.y * camera_position.y;
+    f32 radius = squared_radius > 0 ? sqrtf(squared_radius) : 0;
+
+    vec2 polygon[GRID__MAX_CLIPPED_VERTICES];
+    vec2 clipped[GRID__MAX_CLIPPED_VERTICES];
+    polygon[0] = Vec2(camera_position.x - radius, camera_position.z - radius);
+    polygon[1] = Vec2(camera_position.x + radius, camera_position.z - radius);
+    polygon[2] = Vec2(camera_position.x + radius, camera_position.z + radius);
+    polygon[3] = Vec2(camera_position.x - radius, camera_position.z + radius);
+
+    // Clip by the near, far, left, right, bottom and top planes of the frustum (as in cullAndClipEdge):
+    f32 fl = viewport->camera->focal_length;
+    f32 ar = viewport->dimensions.width_over_height;
+    u8 count = radius ? 4 : 0;
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(0, 0, +1), -viewport->settings.near_clipping_plane_distance, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(0, 0, -1), +viewport->settings.far_clipping_plane_distance, &object_to_view, polygon);
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(+fl, 0, ar), 0, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(-fl, 0, ar), 0, &object_to_view, polygon);
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(0, +fl, 1), 0, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(0, -fl, 1), 0, &object_to_view, polygon);
+    if (count) {
+        vec2 min = polygon[0];
+        vec2 max = polygon[0];
+        for (u8 i = 1; i < count; i++) {
+            if (polygon[i].x < min.x) min.x = polygon[i].x;
+            if (polygon[i].y < min.y) min.y = polygon[i].y;
+            if (polygon[i].x > max.x) max.x = polygon[i].x;
+            if (polygon[i].y > max.y) max.y = polygon[i].y;
+        }
+
+        // Keep the bounds to where consecutive lines are still apart in f32, which also keeps the line positions of
+        // a far away camera within the range of i32 (lines past the limit are then too far away to be drawn anyway):
+        min.x = clampValueToBetween(min.x, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        min.y = clampValueToBetween(min.y, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        max.x = clampValueToBetween(max.x, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        max.y = clampValueToBetween(max.y, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        for (i32 x = (i32)ceilf(min.x); x <= (i32)floorf(max.x); x++)
+            drawInfiniteGridLine(0, (f32)x, min.y, max.y, camera_position, fade_distance,
+                                 &object_to_view, color, opacity, line_width, viewport);
+        for (i32 z = (i32)ceilf(min.y); z <= (i32)floorf(max.y); z++)
+            drawInfiniteGridLine(1, (f32)z, min.x, max.x, camera_position, fade_distance,
+                                 &object_to_view, color, opacity, line_width, viewport);
+    }
+
+    PROFILE_END();
+}
 
 
 void drawMesh(Mesh *mesh, bool draw_normals, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawMesh");
+
+    // A mesh that is still loading is drawn as its bounding box (faded out) in the meantime:
+    if (!isMeshLoaded(mesh)) {
+        Box box;
+        initBox(&box);
+        vec3 *corner = box.vertices.buffer;
+        for (u8 i = 0; i < BOX__VERTEX_COUNT; i++, corner++) {
+            corner->x = corner->x < 0 ? mesh->aabb.min.x : mesh->aabb.max.x;
+            corner->y = corner->y < 0 ? mesh->aabb.min.y : mesh->aabb.max.y;
+            corner->z = corner->z < 0 ? mesh->aabb.min.z : mesh->aabb.max.z;
+        }
+        drawBox(&box, BOX__ALL_SIDES, primitive, color, opacity * 0.5f, line_width, viewport);
+
+        PROFILE_END();
+        return;
+    }
+
     EdgeVertexIndices *edge_vertex_indices = mesh->edge_vertex_indices;
-    quat cam_rot = viewport->camera->transform.rotation_inverted;
-    vec3 cam_pos = viewport->camera->transform.position;
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
     vec3 *positions = mesh->vertex_positions;
     vec3 position;
     Edge edge;
     for (u32 i = 0; i < mesh->edge_count; i++, edge_vertex_indices++) {
-        position = positions[edge_vertex_indices->from];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(position,     cam_pos);
-        position = mulVec3Quat(position, cam_rot);
-        edge.from = position;
-
-        position = positions[edge_vertex_indices->to];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(position,     cam_pos);
-        position = mulVec3Quat(position, cam_rot);
-        edge.to  = position;
+        edge.from = mulVec3Mat3x4(positions[edge_vertex_indices->from], object_to_view);
+        edge.to   = mulVec3Mat3x4(positions[edge_vertex_indices->to],   object_to_view);
 
         drawEdge(&edge, color, opacity, line_width, viewport);
     }
@@ -4078,23 +8127,21 @@ void drawMesh(Mesh *mesh, bool draw_normals, Primitive *primitive, vec3 color, f
         for (u32 t = 0; t < mesh->triangle_count; t++, vertex_normal_indices++, vertex_position_indices++) {
             for (u8 i = 0; i < 3; i++) {
                 position = positions[vertex_position_indices->ids[i]];
-                edge.from = convertPositionToWorldSpace(position, primitive);
-                edge.from = subVec3(edge.from,     cam_pos);
-                edge.from = mulVec3Quat(edge.from, cam_rot);
-
-                edge.to = addVec3(position, scaleVec3(normals[vertex_normal_indices->ids[i]], 0.1f));
-                edge.to = convertPositionToWorldSpace(edge.to, primitive);
-                edge.to = subVec3(edge.to,     cam_pos);
-                edge.to = mulVec3Quat(edge.to, cam_rot);
+                edge.from = mulVec3Mat3x4(position, object_to_view);
+                edge.to   = mulVec3Mat3x4(addVec3(position, scaleVec3(normals[vertex_normal_indices->ids[i]], 0.1f)), object_to_view);
 
                 drawEdge(&edge, Color(Red), opacity * 0.5f, line_width, viewport);
             }
         }
     }
+
+    PROFILE_END();
 }
 
 
 void drawHUD(Viewport *viewport, HUD *hud) {
+    PROFILE_BEGIN("drawHUD");
+
     u16 x = (u16)hud->position.x;
     u16 y = (u16)hud->position.y;
 
@@ -4114,56 +8161,306 @@ void drawHUD(Viewport *viewport, HUD *hud) {
                  Color(alt ? line->alternate_value_color : line->value_color), 1, viewport);
         y += (u16)(hud->line_height * (f32)FONT_HEIGHT);
     }
+
+    PROFILE_END();
 }
 
-App *app;
+// The HUD is retained: Each line is rendered into runs of resolved pixels only when what it shows has changed
+// (its text, colors or position, or the viewport's dimensions), and the runs of all lines are then composited
+// over the window content as it is being resolved (see drawViewportToWindowContent).
+// Unchanged lines cost nothing to re-render, and compositing only touches the pixels of the text itself.
+// When the HUD's lines were not given storage for runs (see ViewportSettings.hud_runs) it is drawn with drawHUD.
+INLINE u64 hashIntoHUDKey(u64 key, u64 value) {
+    return (key ^ value) * 1099511628211ULL; // FNV-1a
+}
 
-typedef union RGBA2u32 {
-    RGBA rgba;
-    u32 value;
-} RGBA2u32;
+INLINE u64 hashTextIntoHUDKey(u64 key, char *text) {
+    while (*text) key = hashIntoHUDKey(key, (u64)(u8)*text++);
+    return hashIntoHUDKey(key, 0);
+}
 
-void drawViewportToWindowContent(Viewport *viewport) {
-    PixelQuad *src_pixel = viewport->pixels;
-    u32 *trg_value = app->window_content;
-    vec3 color;
-    RGBA2u32 background, trg_pixel;
+// Appends the runs of pixels of the given text, laid out and clipped exactly as drawText does:
+u32 addTextRuns(char *str, i32 x, i32 y, vec3 color, Dimensions *dimensions, HUDRun *runs, u32 run_count) {
+    if (x < 0 || x > dimensions->width  - FONT_WIDTH ||
+        y < 0 || y > dimensions->height - FONT_HEIGHT)
+        return run_count;
+
+    if (!glyph_atlas.is_initialized) initGlyphAtlas();
+
+    // Resolve the color as drawViewportToWindowContent does for an opaque pixel:
+    color = mulVec3(color, color);
+    RGBA2u32 pixel;
+    pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+    pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+    pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+    pixel.rgba.A = (u8)FLOAT_TO_COLOR_COMPONENT;
+
+    u16 current_x = (u16)x;
+    u16 current_y = (u16)y;
+    char character = *str;
+    while (character) {
+        if (character == '\n') {
+            if (current_y + FONT_HEIGHT > dimensions->height)
+                break;
+
+            current_x = (u16)x;
+            current_y += LINE_HEIGHT;
+        } else if (character == '\t') {
+            current_x += FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
+        } else if (character >= FIRST_CHARACTER_CODE &&
+                   character <= LAST_CHARACTER_CODE) {
+            Glyph *glyph = glyph_atlas.glyphs + (character - FIRST_CHARACTER_CODE);
+            GlyphSpan *span = glyph_atlas.spans + glyph->first_span;
+            for (u16 s = 0; s < glyph->span_count && run_count < HUD__MAX_LINE_RUNS; s++, span++) {
+                if (current_y + span->row >= dimensions->height) break;
+
+                HUDRun *run = runs + run_count++;
+                run->x = current_x + span->first;
+                run->y = current_y + span->row;
+                run->length = span->length;
+                run->value = pixel.value;
+            }
+            current_x += FONT_WIDTH;
+            if (current_x + FONT_WIDTH > dimensions->width)
+                break;
+        }
+        character = *++str;
+    }
+
+    return run_count;
+}
+
+void updateHUD(Viewport *viewport, HUD *hud) {
+    PROFILE_BEGIN("updateHUD");
+
+    u16 x = (u16)hud->position.x;
+    u16 y = (u16)hud->position.y;
+
+    // The runs are composited at the window's resolution, so they are laid out for the viewport's size in the window:
+    Dimensions dimensions = viewport->dimensions;
+    if (isViewportScaled(viewport)) {
+        dimensions.width  = viewport->scaling.width;
+        dimensions.height = viewport->scaling.height;
+    }
+
+    HUDLine *line = hud->lines;
+    bool alt;
+    for (u32 i = 0; i < hud->line_count; i++, line++) {
+        if (line->use_alternate) {
+            alt = *line->use_alternate;
+            if (line->invert_alternate_use)
+                alt = !alt;
+        } else
+            alt = false;
+
+        char *value = alt ? line->alternate_value.char_ptr : line->value.string.char_ptr;
+        enum ColorID value_color = alt ? line->alternate_value_color : line->value_color;
+        u16 value_x = x + (u16)line->title.length * FONT_WIDTH;
+
+        u64 key = 14695981039346656037ULL;
+        key = hashTextIntoHUDKey(key, line->title.char_ptr);
+        key = hashTextIntoHUDKey(key, value);
+        key = hashIntoHUDKey(key, (u64)line->title_color | ((u64)value_color << 16) | ((u64)value_x << 32));
+        key = hashIntoHUDKey(key, (u64)x | ((u64)y << 16) | ((u64)dimensions.width << 32) | ((u64)dimensions.height << 48));
+        if (key != line->rendered_key) {
+            line->run_count = addTextRuns(line->title.char_ptr, x, y, Color(line->title_color), &dimensions, line->runs, 0);
+            line->run_count = addTextRuns(value, value_x, y, Color(value_color), &dimensions, line->runs, line->run_count);
+            line->rendered_key = key;
+        }
+
+        y += (u16)(hud->line_height * (f32)FONT_HEIGHT);
+    }
+
+    PROFILE_END();
+}
+
+void drawHUDToWindowContent(Viewport *viewport, u32 *window_content, u16 window_width) {
+    HUD *hud = &viewport->hud;
+    window_content += (u32)window_width * (u32)viewport->position.y + (u32)viewport->position.x;
+    HUDLine *line = hud->lines;
+    for (u32 i = 0; i < hud->line_count; i++, line++) {
+        HUDRun *run = line->runs;
+        for (u32 r = 0; r < line->run_count; r++, run++) {
+            u32 *pixel = window_content + (u32)window_width * run->y + run->x;
+            for (u16 p = 0; p < run->length; p++) pixel[p] = run->value;
+        }
+    }
+}
+
+INLINE bool isHUDRetained(HUD *hud) {
+    return hud->line_count && hud->lines->runs;
+}
+
+void setRasterizerStatsInHUD(HUD *hud, u32 first_line, RasterizerStats *stats) {
+    HUDLine *line = hud->lines + first_line;
+    setString(&line[0].title, (char*)"Edges  : ");
+    setString(&line[1].title, (char*)"Culled : ");
+    setString(&line[2].title, (char*)"Clipped: ");
+    setString(&line[3].title, (char*)"Lines  : ");
+    setString(&line[4].title, (char*)"Pixels : ");
+    setString(&line[5].title, (char*)"Blended: ");
+    setString(&line[6].title, (char*)"Overwrt: ");
+    setString(&line[7].title, (char*)"Curves : ");
+    setString(&line[8].title, (char*)"Saved  : ");
+    printCountIntoString(stats->edges,              &line[0].value);
+    printCountIntoString(stats->culled_edges,       &line[1].value);
+    printCountIntoString(stats->clipped_edges,      &line[2].value);
+    printCountIntoString(stats->lines,              &line[3].value);
+    printCountIntoString(stats->pixels,             &line[4].value);
+    printCountIntoString(stats->blended_pixels,     &line[5].value);
+    printCountIntoString(stats->overwritten_pixels, &line[6].value);
+    printCountIntoString(stats->curve_segments,       &line[7].value);
+    printCountIntoString(stats->saved_curve_segments, &line[8].value);
+}
+
+
+INLINE u32 getViewportBackgroundValue(Viewport *viewport) {
+    RGBA2u32 background;
     background.rgba.R = (u8)(viewport->settings.background.color.r * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.G = (u8)(viewport->settings.background.color.g * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.B = (u8)(viewport->settings.background.color.b * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.A = (u8)(viewport->settings.background.opacity * FLOAT_TO_COLOR_COMPONENT);
+    return background.value;
+}
+
+// Resolves a row of the viewport's pixels (from the given column, of the given width) into the given window pixels:
+INLINE void resolveViewportRow(Viewport *viewport, u16 y, u16 x, u16 width, u32 background, u32 *trg_value) {
+    PixelQuad *src_pixel = viewport->pixels +
+            (u32)viewport->dimensions.stride * (u32)(viewport->position.y + y) + (u32)(viewport->position.x + x);
+    vec3 color;
+    RGBA2u32 trg_pixel;
     if (viewport->settings.antialias) {
-        for (u16 y = 0; y < viewport->dimensions.height; y++) {
-            for (u16 x = 0; x < viewport->dimensions.width; x++, src_pixel++, trg_value++) {
-                if (src_pixel->TL.opacity || src_pixel->TR.opacity || src_pixel->BL.opacity || src_pixel->BR.opacity) {
-                    color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity * 0.25f);
-                    color = scaleAddVec3(src_pixel->TR.color, src_pixel->TR.opacity * 0.25f, color);
-                    color = scaleAddVec3(src_pixel->BL.color, src_pixel->BL.opacity * 0.25f, color);
-                    color = scaleAddVec3(src_pixel->BR.color, src_pixel->BR.opacity * 0.25f, color);
-                    trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
-                    trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
-                    trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
-                    trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
-                } else trg_pixel = background;
-                *trg_value = trg_pixel.value;
+        for (u16 i = 0; i < width; i++, src_pixel++, trg_value++) {
+            if (src_pixel->TL.opacity || src_pixel->TR.opacity || src_pixel->BL.opacity || src_pixel->BR.opacity) {
+                color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity * 0.25f);
+                color = scaleAddVec3(src_pixel->TR.color, src_pixel->TR.opacity * 0.25f, color);
+                color = scaleAddVec3(src_pixel->BL.color, src_pixel->BL.opacity * 0.25f, color);
+                color = scaleAddVec3(src_pixel->BR.color, src_pixel->BR.opacity * 0.25f, color);
+                trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+                trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+                trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+                trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
+            } else trg_pixel.value = background;
+            *trg_value = trg_pixel.value;
+        }
+    } else {
+        for (u16 i = 0; i < width; i++, src_pixel++, trg_value++) {
+            if (src_pixel->TL.depth == INFINITY)
+                trg_pixel.value = background;
+            else {
+                color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity);
+                trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+                trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+                trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+                trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
             }
+            *trg_value = trg_pixel.value;
+        }
+    }
+}
+
+// The row of the viewport's pixels that a row of the viewport in the window is scaled up from (sampling pixel centers):
+INLINE u16 getViewportSourceRow(Viewport *viewport, u16 y) {
+    return (u16)(((u32)y * 2 + 1) * viewport->dimensions.height / ((u32)viewport->scaling.height * 2));
+}
+
+// Resolves a row of the viewport in the window, scaling it up from the internal resolution (nearest pixel) if lower:
+void resolveViewportWindowRow(Viewport *viewport, u16 y, u32 background, u32 *trg_value) {
+    if (!isViewportScaled(viewport)) {
+        resolveViewportRow(viewport, y, 0, viewport->dimensions.width, background, trg_value);
+        return;
+    }
+
+    u32 row[MAX_WIDTH];
+    resolveViewportRow(viewport, getViewportSourceRow(viewport, y), 0, viewport->dimensions.width, background, row);
+
+    // Step through the source row in 16.16 fixed point:
+    u32 step = ((u32)viewport->dimensions.width << 16) / viewport->scaling.width;
+    u32 src_x = step >> 1;
+    for (u16 x = 0; x < viewport->scaling.width; x++, src_x += step)
+        trg_value[x] = row[src_x >> 16];
+}
+
+void drawViewportToWindowContent(Viewport *viewport) {
+    PROFILE_BEGIN("drawViewportToWindowContent");
+
+    u16 width  = getViewportWindowWidth(viewport);
+    u16 height = getViewportWindowHeight(viewport);
+    bool is_scaled = isViewportScaled(viewport);
+    u32 *trg_value = app->window_content;
+    u32 background = getViewportBackgroundValue(viewport);
+    for (u16 y = 0; y < height; y++, trg_value += width) {
+        // When scaled up, consecutive rows that come from the same source row are copied rather than resolved again:
+        if (is_scaled && y && getViewportSourceRow(viewport, y) == getViewportSourceRow(viewport, y - 1))
+            for (u16 x = 0; x < width; x++) trg_value[x] = trg_value[x - width];
+        else
+            resolveViewportWindowRow(viewport, y, background, trg_value);
+    }
+
+    if (viewport->settings.show_hud && isHUDRetained(&viewport->hud))
+        drawHUDToWindowContent(viewport, app->window_content, width);
+
+    PROFILE_END();
+}
+
+// Dynamic resolution: A feedback loop that scales the internal resolution so that frames take the target time.
+//
+// The frame time is that of the work done for the last frame (from beginFrame to endFrame) smoothed over frames.
+// The cost of drawing mostly scales with the pixel count, so the scale of each side is changed by the square root of
+// the ratio between the target and the frame time (half way there each time, in steps of VIEWPORT_SCALING__STEP).
+// Frame times within VIEWPORT_SCALING__TOLERANCE of the target are left alone, and after every change the new frame
+// time is given some frames to settle - so that the resolution does not oscillate around the target.
+//
+// With dynamic_antialias, antialiasing (4 sub-pixels to each pixel) is switched off before the resolution is lowered,
+// and is only switched back on once at full resolution with frames taking well under the target time.
+void updateDynamicResolution(Viewport *viewport, Timer *timer) {
+    u32 target = viewport->settings.target_microseconds_per_frame;
+    ViewportScaling *scaling = &viewport->scaling;
+    if (!target) {
+        if (isViewportScaled(viewport)) setViewportResolutionScale(viewport, 1);
+        return;
+    }
+
+    f32 frame_time = (f32)timer->microseconds;
+    if (!frame_time) return;
+    scaling->frame_time = scaling->frame_time ?
+            scaling->frame_time + (frame_time - scaling->frame_time) * VIEWPORT_SCALING__SMOOTHING : frame_time;
+    if (scaling->settle_frames) {
+        scaling->settle_frames--;
+        return;
+    }
+
+    f32 ratio = (f32)target / scaling->frame_time;
+    ViewportSettings *settings = &viewport->settings;
+    if (ratio < 1 - VIEWPORT_SCALING__TOLERANCE) {
+        if (settings->dynamic_antialias && settings->antialias) {
+            settings->antialias = false;
+            scaling->dropped_antialias = true;
+            scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
+            return;
         }
-    } else {
-        for (u16 y = 0; y < viewport->dimensions.height; y++) {
-            for (u16 x = 0; x < viewport->dimensions.width; x++, src_pixel++, trg_value++) {
-                if (src_pixel->TL.depth == INFINITY)
-                    trg_pixel = background;
-                else {
-                    color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity);
-                    trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
-                    trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
-                    trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
-                    trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
-                }
-                *trg_value = trg_pixel.value;
+    } else if (ratio > 1 + VIEWPORT_SCALING__TOLERANCE) {
+        if (scaling->scale == 1) {
+            if (scaling->dropped_antialias && ratio > VIEWPORT_SCALING__ANTIALIAS_HEADROOM) {
+                settings->antialias = true;
+                scaling->dropped_antialias = false;
+                scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
             }
+            return;
         }
-    }
+    } else
+        return;
+
+    f32 scale = scaling->scale * (1 + (sqrtf(ratio) - 1) * 0.5f);
+    scale = (f32)(i32)(scale / VIEWPORT_SCALING__STEP + 0.5f) * VIEWPORT_SCALING__STEP;
+    if (scale < settings->min_resolution_scale) scale = settings->min_resolution_scale;
+    if (scale == scaling->scale) scale += ratio > 1 ? VIEWPORT_SCALING__STEP : -VIEWPORT_SCALING__STEP;
+    if (scale < settings->min_resolution_scale) scale = settings->min_resolution_scale;
+    if (scale > 1) scale = 1;
+    if (scale == scaling->scale) return;
+
+    setViewportResolutionScale(viewport, scale);
+    scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
 }
 
 void fillViewport(Viewport *viewport, vec3 color, f32 opacity, f64 depth) {
@@ -4173,7 +8470,13 @@ void fillViewport(Viewport *viewport, vec3 color, f32 opacity, f64 depth) {
     fill_sub_pixel.opacity = opacity;
     fill_sub_pixel.depth = depth;
     fill_pixel.TL = fill_pixel.TR = fill_pixel.BL = fill_pixel.BR = fill_sub_pixel;
-    for (i32 y = viewport->position.y; y < (viewport->position.y + viewport->dimensions.height); y++)
+    i32 first_y = viewport->position.y;
+    i32 end_y   = viewport->position.y + viewport->dimensions.height;
+    if (viewport->band_bottom) {
+        end_y    = first_y + viewport->band_bottom;
+        first_y += viewport->band_top;
+    }
+    for (i32 y = first_y; y < end_y; y++)
         for (i32 x = viewport->position.x; x < (viewport->position.x + viewport->dimensions.width); x++)
             viewport->pixels[viewport->dimensions.stride * y + x] = fill_pixel;
 }
@@ -4186,137 +8489,121 @@ void clearViewportToBackground(Viewport *viewport) {
 }
 
 void beginDrawing(Viewport *viewport) {
+    PROFILE_BEGIN("beginDrawing");
+
     clearViewportToBackground(viewport);
     setProjectionMatrix(viewport);
-}
-
-void endDrawing(Viewport *viewport) {
-    if (viewport->settings.show_hud)
-        drawHUD(viewport, &viewport->hud);
-    drawViewportToWindowContent(viewport);
-}
-
-
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    RasterizerStats new_stats = {0};
+    viewport->stats = new_stats;
+#endif
 
-void zoomCamera(Camera *camera, f32 zoom) {
-    f32 new_zoom = camera->zoom + zoom;
-    camera->focal_length = new_zoom > 1 ? new_zoom : (new_zoom < -1 ? (-1 / new_zoom) : 1);
-    camera->zoom = new_zoom;
+    PROFILE_END();
 }
 
-void dollyCamera(Camera *camera, f32 dolly) {
-    vec3 target_position = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
-    target_position = addVec3(camera->transform.position, target_position);
+void endDrawing(Viewport *viewport) {
+    PROFILE_BEGIN("endDrawing");
 
-    // Compute new target distance:
-    camera->dolly += dolly;
-    camera->target_distance = powf(2, camera->dolly / -200) * CAMERA_DEFAULT__TARGET_DISTANCE;
+    if (viewport->settings.show_hud) {
+        if (isHUDRetained(&viewport->hud))
+            updateHUD(viewport, &viewport->hud);
+        else
+            drawHUD(viewport, &viewport->hud);
+    }
+    drawViewportToWindowContent(viewport);
 
-    // Back-track from target position to new current position:
-    camera->transform.position = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
-    camera->transform.position = subVec3(target_position,camera->transform.position);
+    PROFILE_END();
 }
 
-void orbitCamera(Camera *camera, f32 azimuth, f32 altitude) {
-    // Move the camera forward to the position of it's target:
-    vec3 movement = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
-    camera->transform.position = addVec3(camera->transform.position, movement);
-
-    // Reorient the camera while it is at the position of it's target:
-    rotateXform3(&camera->transform, azimuth, altitude, 0);
-
-    // Back the camera away from it's target position using the updated forward direction:
-    movement = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
-    camera->transform.position = subVec3(camera->transform.position, movement);
-}
 
-void panCamera(Camera *camera, f32 right, f32 up) {
-    vec3 up_movement    = scaleVec3(*camera->transform.up_direction, up);
-    vec3 right_movement = scaleVec3(*camera->transform.right_direction, right);
-    camera->transform.position = addVec3(camera->transform.position, up_movement);
-    camera->transform.position = addVec3(camera->transform.position, right_movement);
+// Draws the scene for multiple viewports at once, each through its own camera, one viewport per thread.
+//
+// The viewports share the app's frame buffer, each owning a rectangular region of it (see setViewportRegion):
+// Their pixels are addressed by their position with a stride of the window's width, so the regions must not overlap.
+// A viewport therefore never writes pixels that another one reads or writes, and needs no copy of the frame buffer.
+// Once all of the viewports are drawn, composeViewports resolves them into the window's content in a single pass over
+// its rows, followed by the retained HUD of each viewport (so a viewport's HUD is not drawn into its pixels at all).
+void initCompositor(Compositor *compositor, Scene *scene, CallbackForSceneDrawing drawScene) {
+    compositor->viewport_count = 0;
+    compositor->scene = scene;
+    compositor->drawScene = drawScene;
 }
 
-void panViewport(Viewport *viewport, Mouse *mouse) {
-    f32 x = viewport->navigation.settings.speeds.pan * -(f32)mouse->pos_raw_diff.x;
-    f32 y = viewport->navigation.settings.speeds.pan * +(f32)mouse->pos_raw_diff.y;
-    panCamera(viewport->camera, x, y);
+bool addViewportToCompositor(Compositor *compositor, Viewport *viewport) {
+    if (compositor->viewport_count == COMPOSITOR__MAX_VIEWPORTS) return false;
 
-    viewport->navigation.moved = true;
-    mouse->raw_movement_handled = true;
-    mouse->moved = false;
+    compositor->viewports[compositor->viewport_count++] = viewport;
+    return true;
 }
 
-void zoomViewport(Viewport *viewport, Mouse *mouse) {
-    f32 z = viewport->navigation.settings.speeds.zoom * mouse->wheel_scroll_amount;
-    zoomCamera(viewport->camera, z);
-
-    viewport->navigation.zoomed = true;
-    mouse->wheel_scroll_handled = true;
+// Places the viewport at the given region of a window of the given width (shrunk to fit the window's frame buffer).
+// A viewport with a lower resolution scale draws into the top-left part of its region, and is scaled up to all of it:
+void setViewportRegion(Viewport *viewport, u16 x, u16 y, u16 width, u16 height, u16 window_width) {
+    if (x > window_width) x = window_width;
+    if (width > window_width - x) width = window_width - x;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    viewport->position.x = x;
+    viewport->position.y = y;
+    resizeViewport(viewport, width, height, window_width);
+}
+
+void drawComposedViewport(void *data, u32 index) {
+    Compositor *compositor = (Compositor*)data;
+    Viewport *viewport = compositor->viewports[index];
+
+    beginDrawing(viewport);
+    compositor->drawScene(compositor->scene, viewport);
+    if (viewport->settings.show_hud) {
+        if (isHUDRetained(&viewport->hud))
+            updateHUD(viewport, &viewport->hud);
+        else
+            drawHUD(viewport, &viewport->hud);
+    }
 }
 
-void dollyViewport(Viewport *viewport, Mouse *mouse) {
-    f32 z = viewport->navigation.settings.speeds.dolly * mouse->wheel_scroll_amount;
-    dollyCamera(viewport->camera, z);
-    viewport->navigation.moved = true;
-    mouse->wheel_scroll_handled = true;
-}
+void composeViewports(Compositor *compositor, u32 *window_content, u16 width, u16 height, Platform *platform) {
+    PROFILE_BEGIN("composeViewports");
 
-void orientViewport(Viewport *viewport, Mouse *mouse) {
-    f32 x = viewport->navigation.settings.speeds.orient * -(f32)mouse->pos_raw_diff.x;
-    f32 y = viewport->navigation.settings.speeds.orient * -(f32)mouse->pos_raw_diff.y;
-    rotateXform3(&viewport->camera->transform, x, y, 0);
+    u32 viewport_count = compositor->viewport_count;
+    Viewport **viewports = compositor->viewports;
+    prepareSceneForDrawing(compositor->scene, viewports, viewport_count);
+    for (u32 i = 0; i < viewport_count; i++) viewports[i]->has_prepared_curves = true;
 
-    mouse->moved = false;
-    mouse->raw_movement_handled = true;
-    viewport->navigation.turned = true;
-}
+    if (viewport_count > 1 && platform->runInParallel && platform->thread_count > 1) {
+        profiler.paused = true;
+        platform->runInParallel(drawComposedViewport, compositor, viewport_count);
+        profiler.paused = false;
+    } else
+        for (u32 i = 0; i < viewport_count; i++)
+            drawComposedViewport(compositor, i);
 
-void orbitViewport(Viewport *viewport, Mouse *mouse) {
-    f32 x = viewport->navigation.settings.speeds.orbit * -(f32)mouse->pos_raw_diff.x;
-    f32 y = viewport->navigation.settings.speeds.orbit * -(f32)mouse->pos_raw_diff.y;
-    orbitCamera(viewport->camera, x, y);
+    for (u32 i = 0; i < viewport_count; i++) viewports[i]->has_prepared_curves = false;
 
-    viewport->navigation.turned = true;
-    viewport->navigation.moved = true;
-    mouse->raw_movement_handled = true;
-    mouse->moved = false;
-}
+    u32 backgrounds[COMPOSITOR__MAX_VIEWPORTS];
+    for (u32 i = 0; i < viewport_count; i++) backgrounds[i] = getViewportBackgroundValue(viewports[i]);
 
-void navigateViewport(Viewport *viewport, f32 delta_time) {
-    vec3 target_velocity = getVec3Of(0);
-    Navigation *navigation = &viewport->navigation;
-    Camera *camera = viewport->camera;
+    // Each row is cleared and then resolved from every viewport that covers it, left to right:
+    u32 *trg_value = window_content;
+    for (u16 y = 0; y < height; y++, trg_value += width) {
+        for (u16 x = 0; x < width; x++) trg_value[x] = 0;
+        for (u32 i = 0; i < viewport_count; i++) {
+            Viewport *viewport = viewports[i];
+            i32 row = (i32)y - viewport->position.y;
+            if (row < 0 || row >= getViewportWindowHeight(viewport)) continue;
 
-    if (navigation->move.right)    target_velocity.x += navigation->settings.max_velocity;
-    if (navigation->move.left)     target_velocity.x -= navigation->settings.max_velocity;
-    if (navigation->move.up)       target_velocity.y += navigation->settings.max_velocity;
-    if (navigation->move.down)     target_velocity.y -= navigation->settings.max_velocity;
-    if (navigation->move.forward)  target_velocity.z += navigation->settings.max_velocity;
-    if (navigation->move.backward) target_velocity.z -= navigation->settings.max_velocity;
-    if (navigation->turn.left) {
-        rotateXform3(&camera->transform, delta_time * +navigation->settings.speeds.turn, 0, 0);
-        navigation->turned = true;
-    }
-    if (navigation->turn.right) {
-        rotateXform3(&camera->transform, delta_time * -navigation->settings.speeds.turn, 0, 0);
-        navigation->turned = true;
+            resolveViewportWindowRow(viewport, (u16)row, backgrounds[i], trg_value + viewport->position.x);
+        }
     }
 
-    // Update the current velocity:
-    f32 velocity_difference = navigation->settings.acceleration * delta_time;
-    camera->current_velocity = approachVec3(camera->current_velocity, target_velocity, velocity_difference);
+    for (u32 i = 0; i < viewport_count; i++)
+        if (viewports[i]->settings.show_hud && isHUDRetained(&viewports[i]->hud))
+            drawHUDToWindowContent(viewports[i], window_content, width);
 
-    navigation->moved = nonZeroVec3(camera->current_velocity);
-    if (navigation->moved) { // Update the current position:
-        vec3 movement = scaleVec3(camera->current_velocity, delta_time);
-        movement = mulVec3Mat3(movement, camera->transform.rotation_matrix);
-        camera->transform.position = addVec3(camera->transform.position, movement);
-    }
+    PROFILE_END();
 }
 
 
-
 void setViewportProjectionPlane(Viewport *viewport) {
     Camera *camera = viewport->camera;
     ProjectionPlane *projection_plane = &viewport->projection_plane;
@@ -4419,31 +8706,43 @@ INLINE BoxSide hitCube(RayHit *hit, vec3 *Ro, vec3 *Rd) {
 
 INLINE bool rayHitScene(Ray *ray, RayHit *local_hit, RayHit *hit, Scene *scene) {
     bool current_found, found = false;
-    vec3 Ro, Rd;
-    Primitive hit_primitive, primitive;
+    vec3 Ro, Rd, mesh_scale = getVec3Of(1);
+    Primitive *primitive;
     for (u32 i = 0; i < scene->settings.primitives; i++) {
-        primitive = scene->primitives[i];
-        if (primitive.type == PrimitiveType_Mesh)
-            primitive.scale = mulVec3(primitive.scale, scene->meshes[primitive.id].aabb.max);
-
-        convertPositionAndDirectionToObjectSpace(ray->origin, ray->direction, &primitive, &Ro, &Rd);
+        if (!isPoolSlotActive(&scene->primitive_pool, i)) continue;
+
+        // Bring the ray into the primitive's object space using it's cached inverted world matrix:
+        primitive = scene->primitives + i;
+        updatePrimitiveMatrices(primitive);
+        Ro = mulVec3Mat3x4(ray->origin, primitive->world_matrix_inverted);
+        Rd = subVec3(mulVec3Mat3x4(addVec3(ray->origin, ray->direction), primitive->world_matrix_inverted), Ro);
+        if (primitive->type == PrimitiveType_Mesh) {
+            mesh_scale = scene->meshes[primitive->id].aabb.max;
+            Ro = mulVec3(Ro, oneOverVec3(mesh_scale));
+            Rd = mulVec3(Rd, oneOverVec3(mesh_scale));
+        }
+        Rd = normVec3(Rd);
 
         current_found = hitCube(local_hit, &Ro, &Rd);
         if (current_found) {
-            local_hit->position       = convertPositionToWorldSpace(local_hit->position, &primitive);
+            if (primitive->type == PrimitiveType_Mesh)
+                local_hit->position = mulVec3(local_hit->position, mesh_scale);
+            local_hit->position       = mulVec3Mat3x4(local_hit->position, primitive->world_matrix);
             local_hit->distance_squared = squaredLengthVec3(subVec3(local_hit->position, ray->origin));
             if (local_hit->distance_squared < hit->distance_squared) {
                 *hit = *local_hit;
-                hit->object_type = primitive.type;
+                hit->object_type = primitive->type;
                 hit->object_id = i;
-
-                hit_primitive = primitive;
                 found = true;
             }
         }
     }
 
     if (found) {
+        // The normal is brought to world space by the hit primitive (scaled by the bounds of its mesh, as was the ray):
+        Primitive hit_primitive = scene->primitives[hit->object_id];
+        if (hit_primitive.type == PrimitiveType_Mesh)
+            hit_primitive.scale = mulVec3(hit_primitive.scale, scene->meshes[hit_primitive.id].aabb.max);
         hit->distance = sqrtf(hit->distance_squared);
         hit->normal = normVec3(convertDirectionToWorldSpace(hit->normal, &hit_primitive));
     }
@@ -4452,6 +8751,8 @@ INLINE bool rayHitScene(Ray *ray, RayHit *local_hit, RayHit *hit, Scene *scene)
 }
 
 void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
+    PROFILE_BEGIN("manipulateSelection");
+
     Mouse *mouse = &controls->mouse;
     Camera *camera = viewport->camera;
     Dimensions *dimensions = &viewport->dimensions;
@@ -4463,12 +8764,23 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
     vec3 position;
     vec3 *cam_pos = &camera->transform.position;
     mat3 *rot     = &camera->transform.rotation_matrix;
-    mat3 *inv_rot = &camera->transform.rotation_matrix_inverted;
+    mat3 inv_rot  = getXform3InvertedRotationMatrix(&camera->transform);
     RayHit *hit = &selection->hit;
     Ray ray, *local_ray = &selection->local_ray;
     Primitive primitive;
     vec2i mouse_pos = Vec2i(mouse->pos.x - viewport->position.x,
                             mouse->pos.y - viewport->position.y);
+    if (isViewportScaled(viewport)) {
+        mouse_pos.x = mouse_pos.x * viewport->dimensions.width  / viewport->scaling.width;
+        mouse_pos.y = mouse_pos.y * viewport->dimensions.height / viewport->scaling.height;
+    }
+
+    // Drop the selection if the selected primitive was removed (even if it's slot was since reused by another one):
+    if (selection->primitive && !isValidObjectHandle(&scene->primitive_pool, selection->primitive_handle)) {
+        selection->primitive = null;
+        selection->object_type = 0;
+        selection->changed = true;
+    }
 
     if (mouse->left_button.is_pressed) {
         if (!mouse->left_button.is_handled) { // This is the first frame after the left mouse button went down:
@@ -4492,13 +8804,14 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
 
                 // Capture a pointer to the selected object's position for later use in transformations:
                 selection->primitive = scene->primitives + selection->object_id;
+                selection->primitive_handle = getObjectHandle(&scene->primitive_pool, selection->object_id);
                 selection->world_position = &selection->primitive->position;
                 selection->transformation_plane_origin = hit->position;
 
                 selection->world_offset = subVec3(hit->position, *selection->world_position);
 
                 // Track how far away the hit position is from the camera along the z axis:
-                position = mulVec3Mat3(subVec3(hit->position, ray.origin), *inv_rot);
+                position = mulVec3Mat3(subVec3(hit->position, ray.origin), inv_rot);
                 selection->object_distance = position.z;
             } else {
                 if (selection->object_type)
@@ -4552,15 +8865,15 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                                 position = subVec3(hit->position, selection->world_offset);
                                 *selection->world_position = position;
                                 if (selection->primitive)
-                                    selection->primitive->flags |= IS_TRANSLATED;
+                                    selection->primitive->flags |= IS_TRANSLATED | IS_DIRTY;
                             } else if (mouse->middle_button.is_pressed) {
                                 position      = selection->transformation_plane_origin;
                                 position      = convertPositionToObjectSpace(     position, &primitive);
                                 hit->position = convertPositionToObjectSpace(hit->position, &primitive);
 
                                 selection->primitive->scale = mulVec3(selection->object_scale,
-                                                                      mulVec3(hit->position, oneOverVec3(position)));
-                                selection->primitive->flags |= IS_SCALED | IS_SCALED_NON_UNIFORMLY;
+                                                                             mulVec3(hit->position, oneOverVec3(position)));
+                                selection->primitive->flags |= IS_SCALED | IS_SCALED_NON_UNIFORMLY | IS_DIRTY;
                             } else if (mouse->right_button.is_pressed) {
                                 vec3 v1 = subVec3(hit->position,
                                                   selection->transformation_plane_center);
@@ -4572,7 +8885,7 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                                 q = normQuat(q);
                                 selection->primitive->rotation = mulQuat(q, selection->object_rotation);
                                 selection->primitive->rotation = normQuat(selection->primitive->rotation);
-                                selection->primitive->flags |= IS_ROTATED;
+                                selection->primitive->flags |= IS_ROTATED | IS_DIRTY;
                             }
                         }
                     }
@@ -4600,13 +8913,17 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                 position = subVec3(position, selection->world_offset);
                 *selection->world_position = position;
                 if (selection->primitive)
-                    selection->primitive->flags |= IS_TRANSLATED;
+                    selection->primitive->flags |= IS_TRANSLATED | IS_DIRTY;
             }
         }
     }
+
+    PROFILE_END();
 }
 
 void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
+    PROFILE_BEGIN("drawSelection");
+
     Mouse *mouse = &controls->mouse;
     Selection *selection = scene->selection;
     Box *box = &selection->box;
@@ -4614,10 +8931,13 @@ void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
     if (controls->is_pressed.alt &&
         !mouse->is_captured &&
         selection->object_type &&
-        selection->primitive) {
+        selection->primitive &&
+        isValidObjectHandle(&scene->primitive_pool, selection->primitive_handle)) {
         Primitive primitive = *selection->primitive;
-        if (primitive.type == PrimitiveType_Mesh)
+        if (primitive.type == PrimitiveType_Mesh) {
             primitive.scale = mulVec3(primitive.scale, scene->meshes[primitive.id].aabb.max);
+            primitive.flags |= IS_DIRTY;
+        }
 
         initBox(box);
         drawBox(box, BOX__ALL_SIDES, &primitive, Color(Yellow), 0.5f, 0, viewport);
@@ -4632,252 +8952,749 @@ void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
             drawBox(box, selection->box_side, &primitive, color, 0.5f, 1, viewport);
         }
     }
+
+    PROFILE_END();
+}
+
+
+void zoomCamera(Camera *camera, f32 zoom) {
+    f32 new_zoom = camera->zoom + zoom;
+    camera->focal_length = new_zoom > 1 ? new_zoom : (new_zoom < -1 ? (-1 / new_zoom) : 1);
+    camera->zoom = new_zoom;
+}
+
+void dollyCamera(Camera *camera, f32 dolly) {
+    vec3 target_position = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
+    target_position = addVec3(camera->transform.position, target_position);
+
+    // Compute new target distance:
+    camera->dolly += dolly;
+    camera->target_distance = powf(2, camera->dolly / -200) * CAMERA_DEFAULT__TARGET_DISTANCE;
+
+    // Back-track from target position to new current position:
+    camera->transform.position = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
+    camera->transform.position = subVec3(target_position,camera->transform.position);
+}
+
+void orbitCamera(Camera *camera, f32 azimuth, f32 altitude) {
+    // Move the camera forward to the position of it's target:
+    vec3 movement = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
+    camera->transform.position = addVec3(camera->transform.position, movement);
+
+    // Reorient the camera while it is at the position of it's target:
+    rotateXform3(&camera->transform, azimuth, altitude, 0);
+
+    // Back the camera away from it's target position using the updated forward direction:
+    movement = scaleVec3(*camera->transform.forward_direction, camera->target_distance);
+    camera->transform.position = subVec3(camera->transform.position, movement);
+}
+
+void panCamera(Camera *camera, f32 right, f32 up) {
+    vec3 up_movement    = scaleVec3(*camera->transform.up_direction, up);
+    vec3 right_movement = scaleVec3(*camera->transform.right_direction, right);
+    camera->transform.position = addVec3(camera->transform.position, up_movement);
+    camera->transform.position = addVec3(camera->transform.position, right_movement);
+}
+
+void panViewport(Viewport *viewport, Mouse *mouse) {
+    f32 x = viewport->navigation.settings.speeds.pan * -(f32)mouse->pos_raw_diff.x;
+    f32 y = viewport->navigation.settings.speeds.pan * +(f32)mouse->pos_raw_diff.y;
+    panCamera(viewport->camera, x, y);
+
+    viewport->navigation.moved = true;
+    mouse->raw_movement_handled = true;
+    mouse->moved = false;
+}
+
+void zoomViewport(Viewport *viewport, Mouse *mouse) {
+    f32 z = viewport->navigation.settings.speeds.zoom * mouse->wheel_scroll_amount;
+    zoomCamera(viewport->camera, z);
+
+    viewport->navigation.zoomed = true;
+    mouse->wheel_scroll_handled = true;
+}
+
+void dollyViewport(Viewport *viewport, Mouse *mouse) {
+    f32 z = viewport->navigation.settings.speeds.dolly * mouse->wheel_scroll_amount;
+    dollyCamera(viewport->camera, z);
+    viewport->navigation.moved = true;
+    mouse->wheel_scroll_handled = true;
+}
+
+void orientViewport(Viewport *viewport, Mouse *mouse) {
+    f32 x = viewport->navigation.settings.speeds.orient * -(f32)mouse->pos_raw_diff.x;
+    f32 y = viewport->navigation.settings.speeds.orient * -(f32)mouse->pos_raw_diff.y;
+    rotateXform3(&viewport->camera->transform, x, y, 0);
+
+    mouse->moved = false;
+    mouse->raw_movement_handled = true;
+    viewport->navigation.turned = true;
+}
+
+void orbitViewport(Viewport *viewport, Mouse *mouse) {
+    f32 x = viewport->navigation.settings.speeds.orbit * -(f32)mouse->pos_raw_diff.x;
+    f32 y = viewport->navigation.settings.speeds.orbit * -(f32)mouse->pos_raw_diff.y;
+    orbitCamera(viewport->camera, x, y);
+
+    viewport->navigation.turned = true;
+    viewport->navigation.moved = true;
+    mouse->raw_movement_handled = true;
+    mouse->moved = false;
 }
 
+void navigateViewport(Viewport *viewport, f32 delta_time) {
+    vec3 target_velocity = getVec3Of(0);
+    Navigation *navigation = &viewport->navigation;
+    Camera *camera = viewport->camera;
+
+    if (navigation->move.right)    target_velocity.x += navigation->settings.max_velocity;
+    if (navigation->move.left)     target_velocity.x -= navigation->settings.max_velocity;
+    if (navigation->move.up)       target_velocity.y += navigation->settings.max_velocity;
+    if (navigation->move.down)     target_velocity.y -= navigation->settings.max_velocity;
+    if (navigation->move.forward)  target_velocity.z += navigation->settings.max_velocity;
+    if (navigation->move.backward) target_velocity.z -= navigation->settings.max_velocity;
+    if (navigation->turn.left) {
+        rotateXform3(&camera->transform, delta_time * +navigation->settings.speeds.turn, 0, 0);
+        navigation->turned = true;
+    }
+    if (navigation->turn.right) {
+        rotateXform3(&camera->transform, delta_time * -navigation->settings.speeds.turn, 0, 0);
+        navigation->turned = true;
+    }
+
+    // Update the current velocity:
+    f32 velocity_difference = navigation->settings.acceleration * delta_time;
+    camera->current_velocity = approachVec3(camera->current_velocity, target_velocity, velocity_difference);
+
+    navigation->moved = nonZeroVec3(camera->current_velocity);
+    if (navigation->moved) { // Update the current position:
+        vec3 movement = scaleVec3(camera->current_velocity, delta_time);
+        movement = mulVec3Mat3(movement, camera->transform.rotation_matrix);
+        camera->transform.position = addVec3(camera->transform.position, movement);
+    }
+
+    // Gliding to a stop (or turning while a key is held) goes on without any input arriving, so when rendering on
+    // demand the next frame is requested here (for whichever viewport is navigated):
+    if (navigation->moved || navigation->turned) app->needs_redraw = true;
+}
+
+#ifdef SLIM_ENGINE_HEADLESS
+
+// A window-less platform layer for benchmarking.
+// The app is initialized exactly as it is for a window, and then a scripted camera path is replayed
+// for a fixed number of frames at each requested resolution, printing per-frame timing percentiles
+// along with a checksum of the final window content (to catch correctness regressions).
+//
+// Time as seen by the app is virtual and advances by a fixed step every frame, so that everything that
+// depends on delta_time (navigation, animation) is deterministic and the checksums are reproducible.
+// Frame timings are measured separately using the real (monotonic) clock.
+//
+// It also serves golden-image regression testing: The final frame can be written out as a (binary) PPM image,
+// and/or compared against a stored golden image with a per-channel tolerance - writing a diff image showing
+// the offending pixels in red. The process exits with a non-zero code if any pixel is out of tolerance.
+//
+// Instead of the scripted camera path, an input recording (see core/recording.h) can be replayed.
+// Recorded events are fed back at the frames they were recorded at, while time still advances by the fixed step.
+// The frame count is then that of the recording, and there are no warmup frames.
+//
+// The app's memory (holding the frame buffer and meshes) can be backed by 2MB huge pages using --large-pages.
+// Explicit huge pages (MAP_HUGETLB) are used when the system has them reserved, falling back to transparent huge pages.
+// Either way the app's memory then has a fixed capacity that can not grow (see initAppMemory).
+//
+// Work that the app splits across threads (see core/jobs.h) runs on as many threads as there are processors,
+// or as given by --threads (--threads 1 runs everything on the main thread).
+// An app that updates at a fixed time step (see core/simulation.h) updates and renders in turn, on the main thread,
+// running as many update steps per frame as the virtual time covers (one per frame at the default --fps of 60).
+//
+// Meshes load in the background (see MeshLoader), so they are waited for before the first frame (to draw all of them).
+//
+// The scene can be saved to a scene file (see scene/io.h) and loaded back into reset objects with --reload-scene,
+// before the first frame (so the frames only match those drawn without it when loading restores all of the scene).
+// With --reload-scene-changes the scene is saved with its primitives mirrored through the origin, followed by their
+// actual positions as changes (see saveSceneChangesToFile), so the frames only match when the journal is replayed.
+// With --reload-torn-scene the entry of the changes is then cut short (as by an interrupted save) and the file is loaded,
+// after which saving the actual positions again has to rewrite the file (instead of appending after the partial entry).
+//
+// As the app sees no time passing during a frame, dynamic resolution (see updateDynamicResolution) never kicks in.
+// The viewport can instead be given a fixed internal resolution with --resolution-scale (a fraction of the window's).
+//
+// Usage: <example> [--frames N] [--warmup N] [--fps N] [--resolution WIDTHxHEIGHT]... [--show-hud] [--antialias]
+//                  [--large-pages] [--threads N] [--resolution-scale S] [--replay INPUT_RECORDING]
+//                  [--reload-scene SCENE_FILE] [--reload-scene-changes SCENE_FILE] [--reload-torn-scene SCENE_FILE]
+//                  [--output IMAGE.ppm] [--golden IMAGE.ppm [--tolerance N] [--diff IMAGE.ppm]]
+//
+// (Replaying, image output and comparison use a single resolution: 640x480 unless one is given)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
 
+#define HEADLESS__TICKS_PER_SECOND 1000000
+#define HEADLESS__MAX_RESOLUTIONS 8
+#define HEADLESS_DEFAULT__FRAMES 300
+#define HEADLESS_DEFAULT__WARMUP_FRAMES 10
+#define HEADLESS_DEFAULT__FPS 60
+#define HEADLESS_DEFAULT__TOLERANCE 2
+
+typedef struct HeadlessSettings {
+    Dimensions resolutions[HEADLESS__MAX_RESOLUTIONS];
+    char *output_file, *golden_file, *diff_file, *replay_file, *scene_file;
+    u32 resolution_count, frames, warmup_frames, fps, tolerance, threads;
+    f32 resolution_scale;
+    bool show_hud, antialias, large_pages, scene_changes, torn_scene;
+} HeadlessSettings;
+
+u64 Headless_ticks;
+
+void Headless_setWindowTitle(char* str) {}
+void Headless_setCursorVisibility(bool on) {}
+void Headless_setWindowCapture(bool on) {}
+u64 Headless_getTicks() { return Headless_ticks; }
+void* Headless_getMemory(u64 size) { return calloc(1, (size_t)size); }
+void* Headless_reserveMemory(u64 size) {
+#ifdef _WIN32
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *address = mmap(null, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? null : address;
+#endif
+}
+bool Headless_commitMemory(void *address, u64 size) {
+#ifdef _WIN32
+    return VirtualAlloc((LPVOID)address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != null;
+#else
+    return mprotect(address, (size_t)size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+void* Headless_getLargePageMemory(u64 size) {
+#ifdef _WIN32
+    return null;
+#else
+    size = (size + MEMORY__LARGE_PAGE_SIZE - 1) / MEMORY__LARGE_PAGE_SIZE * MEMORY__LARGE_PAGE_SIZE;
+    void *address = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    address = mmap(null, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (address != MAP_FAILED) return address;
 
-void initApp(Defaults *defaults);
+    // Without reserved huge pages, ask for transparent huge pages over a 2MB-aligned range instead:
+    u8 *unaligned = (u8*)mmap(null, (size_t)(size + MEMORY__LARGE_PAGE_SIZE), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((void*)unaligned == MAP_FAILED) return null;
 
-void _windowRedraw() {
-    if (!app->is_running) return;
-    if (app->on.windowRedraw) app->on.windowRedraw();
+    u8 *aligned = (u8*)(((u64)unaligned + MEMORY__LARGE_PAGE_SIZE - 1) / MEMORY__LARGE_PAGE_SIZE * MEMORY__LARGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, (size_t)size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+#endif
 }
 
-void _windowResize(u16 width, u16 height) {
-    if (!app->is_running) return;
-    updateDimensions(&app->viewport.dimensions, width, height, width);
+u32 Headless_getProcessorCount() {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return (u32)system_info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+#endif
+}
 
-    if (app->on.windowResize) app->on.windowResize(width, height);
-    if (app->on.windowRedraw) app->on.windowRedraw();
+u64 Headless_getRealNanoseconds() {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (u64)((f64)counter.QuadPart * (1000000000.0 / (f64)frequency.QuadPart));
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ULL + (u64)now.tv_nsec;
+#endif
 }
 
-void _keyChanged(u8 key, bool pressed) {
-    if (key == app->controls.key_map.ctrl)  app->controls.is_pressed.ctrl  = pressed;
-    else if (key == app->controls.key_map.alt)   app->controls.is_pressed.alt   = pressed;
-    else if (key == app->controls.key_map.shift) app->controls.is_pressed.shift = pressed;
-    else if (key == app->controls.key_map.space) app->controls.is_pressed.space = pressed;
-    else if (key == app->controls.key_map.tab)   app->controls.is_pressed.tab   = pressed;
+void Headless_closeFile(void *handle) { if (handle) fclose((FILE*)handle); }
+void* Headless_openFileForReading(const char* path) { return fopen(path, "rb"); }
+void* Headless_openFileForWriting(const char* path) { return fopen(path, "wb"); }
+void* Headless_openFileForAppending(const char* path) {
+    FILE *file = fopen(path, "r+b"); // Only an existing file
+    if (file && fseek(file, 0, SEEK_END)) {
+        fclose(file);
+        file = null;
+    }
+    return file;
+}
+bool Headless_readFromFile(void *out, unsigned long size, void *handle) {
+    return handle && fread(out, 1, (size_t)size, (FILE*)handle) == (size_t)size;
+}
+bool Headless_writeToFile(void *out, unsigned long size, void *handle) {
+    return handle && fwrite(out, 1, (size_t)size, (FILE*)handle) == (size_t)size;
+}
+#ifdef _WIN32
+void* Headless_mapFileForReading(const char* path, u64 *size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+    if (file == INVALID_HANDLE_VALUE) return null;
 
-    if (app->on.keyChanged) app->on.keyChanged(key, pressed);
+    LARGE_INTEGER file_size;
+    HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart ?
+                     CreateFileMappingA(file, null, PAGE_WRITECOPY, 0, 0, null) : null;
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : null;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (data) *size = (u64)file_size.QuadPart;
+
+    return data;
 }
+void Headless_unmapFile(void *data, u64 size) { if (data) UnmapViewOfFile(data); }
+#else
+void* Headless_mapFileForReading(const char* path, u64 *size) {
+    int file = open(path, O_RDONLY);
+    if (file == -1) return null;
 
-void _mouseButtonDown(MouseButton *mouse_button, i32 x, i32 y) {
-    mouse_button->is_pressed = true;
-    mouse_button->is_handled = false;
+    struct stat file_stat;
+    void *data = fstat(file, &file_stat) || !file_stat.st_size ? MAP_FAILED :
+                 mmap(null, (size_t)file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) return null;
 
-    mouse_button->down_pos.x = x;
-    mouse_button->down_pos.y = y;
+    *size = (u64)file_stat.st_size;
+    return data;
+}
+void Headless_unmapFile(void *data, u64 size) { if (data) munmap(data, (size_t)size); }
+#endif
 
-    if (app->on.mouseButtonDown) app->on.mouseButtonDown(mouse_button);
+void Headless_mirrorPrimitives(Scene *scene) {
+    for (u32 i = 0; i < scene->settings.primitives; i++) {
+        scene->primitives[i].position = invertedVec3(scene->primitives[i].position);
+        scene->primitives[i].flags |= IS_DIRTY;
+    }
 }
 
-void _mouseButtonUp(MouseButton *mouse_button, i32 x, i32 y) {
-    mouse_button->is_pressed = false;
-    mouse_button->is_handled = false;
+// Cuts the given number of bytes off the end of the file:
+bool Headless_truncateFile(char *file_path, long byte_count) {
+    FILE *file = fopen(file_path, "rb");
+    if (!file) return false;
 
-    mouse_button->up_pos.x = x;
-    mouse_button->up_pos.y = y;
+    long size = fseek(file, 0, SEEK_END) ? 0 : ftell(file) - byte_count;
+    void *content = size > 0 ? malloc((size_t)size) : null;
+    bool read = content && !fseek(file, 0, SEEK_SET) && fread(content, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
 
-    if (app->on.mouseButtonUp) app->on.mouseButtonUp(mouse_button);
-}
+    file = read ? fopen(file_path, "wb") : null;
+    bool written = file && fwrite(content, 1, (size_t)size, file) == (size_t)size;
+    if (file) fclose(file);
+    free(content);
 
-void _mouseButtonDoubleClicked(MouseButton *mouse_button, i32 x, i32 y) {
-    app->controls.mouse.double_clicked = true;
-    mouse_button->double_click_pos.x = x;
-    mouse_button->double_click_pos.y = y;
-    if (app->on.mouseButtonDoubleClicked) app->on.mouseButtonDoubleClicked(mouse_button);
+    return written;
 }
 
-void _mouseWheelScrolled(f32 amount) {
-    app->controls.mouse.wheel_scroll_amount += amount * 100;
-    app->controls.mouse.wheel_scrolled = true;
+bool Headless_reloadScene(char *file_path, bool scene_changes, bool torn_scene) {
+    Scene *scene = &app->scene;
+    if (scene_changes) {
+        Headless_mirrorPrimitives(scene);
+        if (!saveSceneToFile(scene, file_path, &app->platform)) return false;
 
-    if (app->on.mouseWheelScrolled) app->on.mouseWheelScrolled(amount);
-}
+        Headless_mirrorPrimitives(scene);
+        if (!saveSceneChangesToFile(scene, file_path, &app->platform) || scene->journal.entry_count != 1) return false;
 
-void _mousePositionSet(i32 x, i32 y) {
-    app->controls.mouse.pos.x = x;
-    app->controls.mouse.pos.y = y;
+        if (torn_scene) {
+            if (!(Headless_truncateFile(file_path, 4) && loadSceneFromFile(scene, file_path, &app->platform)))
+                return false;
 
-    if (app->on.mousePositionSet) app->on.mousePositionSet(x, y);
-}
+            Headless_mirrorPrimitives(scene); // Loaded mirrored, as the entry of the actual positions was dropped
+            if (!saveSceneChangesToFile(scene, file_path, &app->platform) || scene->journal.entry_count != 0) return false;
+        }
+    } else if (!saveSceneToFile(scene, file_path, &app->platform))
+        return false;
 
-void _mouseMovementSet(i32 x, i32 y) {
-    app->controls.mouse.movement.x = x - app->controls.mouse.pos.x;
-    app->controls.mouse.movement.y = y - app->controls.mouse.pos.y;
-    app->controls.mouse.moved = true;
+    for (u32 i = 0; i < scene->settings.cameras;    i++) initCamera(   scene->cameras    + i);
+    for (u32 i = 0; i < scene->settings.primitives; i++) initPrimitive(scene->primitives + i);
+    for (u32 i = 0; i < scene->settings.curves;     i++) initCurve(    scene->curves     + i);
+    for (u32 i = 0; i < scene->settings.boxes;      i++) initBox(      scene->boxes      + i);
+    for (u32 i = 0; i < scene->settings.grids;      i++) initGrid(     scene->grids      + i, 3, 3);
+    for (u32 i = 0; i < scene->settings.meshes;     i++) {
+        Mesh *mesh = scene->meshes + i;
+        for (u32 v = 0; v < mesh->vertex_count; v++) mesh->vertex_positions[v] = getVec3Of(0);
+    }
 
-    if (app->on.mouseMovementSet) app->on.mouseMovementSet(x, y);
+    // Loading rebuilds the scene's pools from the loaded counts, so handles from before loading go stale:
+    ObjectHandle handle = getObjectHandle(&scene->primitive_pool, 0);
+    return loadSceneFromFile(scene, file_path, &app->platform) &&
+           !isValidObjectHandle(&scene->primitive_pool, handle) &&
+           scene->primitive_pool.count == scene->settings.primitives;
 }
 
-void _mouseRawMovementSet(i32 x, i32 y) {
-    app->controls.mouse.pos_raw_diff.x += x;
-    app->controls.mouse.pos_raw_diff.y += y;
-    app->controls.mouse.moved = true;
+int Headless_compareFrameTimes(const void *a, const void *b) {
+    u64 A = *(const u64*)a;
+    u64 B = *(const u64*)b;
+    return A < B ? -1 : (A > B);
+}
 
-    if (app->on.mouseRawMovementSet) app->on.mouseRawMovementSet(x, y);
+u64 Headless_getPercentile(u64 *sorted_frame_times, u32 frame_count, u32 percentile) {
+    u32 index = (u32)(((u64)(frame_count - 1) * percentile + 50) / 100);
+    return sorted_frame_times[index];
 }
 
-bool initAppMemory(u64 size) {
-    if (app->memory.address) return false;
+u64 Headless_getWindowContentChecksum(u32 *window_content, u32 pixel_count) {
+    // FNV-1a (64-bit) over the bytes of the final frame:
+    u64 checksum = 14695981039346656037ULL;
+    u8 *byte = (u8*)window_content;
+    for (u64 i = 0; i < (u64)pixel_count * 4; i++, byte++) {
+        checksum ^= *byte;
+        checksum *= 1099511628211ULL;
+    }
+    return checksum;
+}
+
+// The scripted camera path is split into 4 equal phases:
+// moving forward, turning right while strafing, orbiting around the target and then backing up while rising.
+void Headless_stepCameraScript(Viewport *viewport, u32 frame, u32 frame_count, f32 delta_time) {
+    NavigationMove *move = &viewport->navigation.move;
+    NavigationTurn *turn = &viewport->navigation.turn;
+    u32 phase = frame * 4 / frame_count;
+    move->forward  = phase == 0;
+    move->right    = phase == 1;
+    turn->right    = phase == 1;
+    move->backward = phase == 3;
+    move->up       = phase == 3;
+    if (phase == 2) orbitCamera(viewport->camera, delta_time * 0.5f, delta_time * 0.05f);
+    navigateViewport(viewport, delta_time);
+}
+
+void Headless_setDefaultSettings(HeadlessSettings *settings) {
+    settings->frames = HEADLESS_DEFAULT__FRAMES;
+    settings->warmup_frames = HEADLESS_DEFAULT__WARMUP_FRAMES;
+    settings->fps = HEADLESS_DEFAULT__FPS;
+    settings->tolerance = HEADLESS_DEFAULT__TOLERANCE;
+    settings->resolution_count = 0;
+    settings->threads = 0;
+    settings->resolution_scale = 1;
+    settings->output_file = settings->golden_file = settings->diff_file = settings->replay_file = settings->scene_file = null;
+    settings->show_hud = settings->antialias = settings->large_pages = settings->scene_changes = settings->torn_scene = false;
+}
+
+bool Headless_parseArguments(HeadlessSettings *settings, int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        char *argument = argv[i];
+        if (     !strcmp(argument, "--show-hud"))  { settings->show_hud  = true; continue; }
+        else if (!strcmp(argument, "--antialias")) { settings->antialias = true; continue; }
+        else if (!strcmp(argument, "--large-pages")) { settings->large_pages = true; continue; }
+
+        char *value = i + 1 < argc ? argv[i + 1] : null;
+        if (!value) return false;
+        i++;
+
+        if (     !strcmp(argument, "--output")) settings->output_file = value;
+        else if (!strcmp(argument, "--golden")) settings->golden_file = value;
+        else if (!strcmp(argument, "--diff"))   settings->diff_file   = value;
+        else if (!strcmp(argument, "--replay")) settings->replay_file = value;
+        else if (!strcmp(argument, "--reload-scene")) settings->scene_file = value;
+        else if (!strcmp(argument, "--reload-scene-changes")) {
+            settings->scene_file = value;
+            settings->scene_changes = true;
+        }
+        else if (!strcmp(argument, "--reload-torn-scene")) {
+            settings->scene_file = value;
+            settings->scene_changes = settings->torn_scene = true;
+        }
+        else if (!strcmp(argument, "--tolerance")) settings->tolerance = (u32)atoi(value);
+        else if (!strcmp(argument, "--threads")) {
+            settings->threads = (u32)atoi(value);
+            if (!settings->threads) return false;
+        }
+        else if (!strcmp(argument, "--resolution-scale")) {
+            settings->resolution_scale = (f32)atof(value);
+            if (settings->resolution_scale <= 0 || settings->resolution_scale > 1) return false;
+        }
+        else if (!strcmp(argument, "--frames")) {
+            settings->frames = (u32)atoi(value);
+            if (!settings->frames) return false;
+        } else if (!strcmp(argument, "--warmup")) settings->warmup_frames = (u32)atoi(value);
+        else if (!strcmp(argument, "--fps")) {
+            settings->fps = (u32)atoi(value);
+            if (!settings->fps) return false;
+        } else if (!strcmp(argument, "--resolution")) {
+            int width, height;
+            if (settings->resolution_count == HEADLESS__MAX_RESOLUTIONS ||
+                sscanf(value, "%dx%d", &width, &height) != 2 ||
+                width  <= 0 || width  > MAX_WIDTH ||
+                height <= 0 || height > MAX_HEIGHT)
+                return false;
+
+            Dimensions *resolution = &settings->resolutions[settings->resolution_count++];
+            resolution->width  = (u16)width;
+            resolution->height = (u16)height;
+        } else
+            return false;
+    }
 
-    void* memory_address = app->platform.getMemory(size);
-    if (!memory_address) {
-        app->is_running = false;
-        return false;
+    if (settings->output_file || settings->golden_file || settings->replay_file) {
+        if (settings->resolution_count > 1) return false;
+        if (settings->resolution_count == 0) {
+            settings->resolutions[0].width = 640;
+            settings->resolutions[0].height = 480;
+            settings->resolution_count = 1;
+        }
+    } else if (!settings->resolution_count) {
+        settings->resolutions[0].width = 640;  settings->resolutions[0].height = 480;
+        settings->resolutions[1].width = 1280; settings->resolutions[1].height = 720;
+        settings->resolutions[2].width = 1920; settings->resolutions[2].height = 1080;
+        settings->resolution_count = 3;
     }
 
-    initMemory(&app->memory, (u8*)memory_address, size);
     return true;
 }
 
-void* allocateAppMemory(u64 size) {
-    void *new_memory = allocateMemory(&app->memory, size);
-    if (new_memory) return new_memory;
+bool Headless_writeImage(char *file_path, u32 *window_content, u16 width, u16 height) {
+    FILE *file = fopen(file_path, "wb");
+    if (!file) return false;
+
+    fprintf(file, "P6\n%u %u\n255\n", (unsigned int)width, (unsigned int)height);
+    RGBA2u32 pixel;
+    u8 rgb[3];
+    bool written = true;
+    for (u32 i = 0; i < (u32)width * (u32)height && written; i++) {
+        pixel.value = window_content[i];
+        rgb[0] = pixel.rgba.R;
+        rgb[1] = pixel.rgba.G;
+        rgb[2] = pixel.rgba.B;
+        written = fwrite(rgb, 1, 3, file) == 3;
+    }
+    fclose(file);
 
-    app->is_running = false;
-    return null;
+    return written;
 }
 
-void initScene(Scene *scene, SceneSettings *settings, Memory *memory, Platform *platform) {
-    scene->settings   = *settings;
-    scene->primitives = null;
-    scene->cameras    = null;
-    scene->curves     = null;
-    scene->boxes      = null;
-    scene->grids      = null;
-    scene->meshes     = null;
-
-    scene->selection = (Selection*)allocateMemory(memory, sizeof(Selection));
-    scene->selection->object_type = scene->selection->object_id = 0;
-    scene->selection->changed = false;
+u8* Headless_readImage(char *file_path, u16 *width, u16 *height) {
+    FILE *file = fopen(file_path, "rb");
+    if (!file) return null;
 
-    if (settings->meshes && settings->mesh_files) {
-        scene->meshes = (Mesh*)allocateMemory(memory, sizeof(Mesh) * settings->meshes);
-        for (u32 i = 0; i < settings->meshes; i++)
-            loadMeshFromFile(&scene->meshes[i], settings->mesh_files[i].char_ptr, platform, memory);
+    unsigned int w, h, max_value;
+    u8 *rgb = null;
+    if (fscanf(file, "P6 %u %u %u", &w, &h, &max_value) == 3 && max_value == 255 && fgetc(file) != EOF &&
+        w && w <= MAX_WIDTH &&
+        h && h <= MAX_HEIGHT) {
+        rgb = (u8*)malloc(w * h * 3);
+        if (rgb && fread(rgb, 1, w * h * 3, file) != w * h * 3) {
+            free(rgb);
+            rgb = null;
+        }
+        *width  = (u16)w;
+        *height = (u16)h;
     }
+    fclose(file);
 
-    if (settings->cameras) {
-        scene->cameras = (Camera*)allocateMemory(memory, sizeof(Camera) * settings->cameras);
-        if (scene->cameras)
-            for (u32 i = 0; i < settings->cameras; i++)
-                initCamera(scene->cameras + i);
-    }
+    return rgb;
+}
 
-    if (settings->primitives) {
-        scene->primitives = (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->primitives);
-        if (scene->primitives)
-            for (u32 i = 0; i < settings->primitives; i++) {
-                initPrimitive(scene->primitives + i);
-                scene->primitives[i].id = i;
-            }
-    }
+INLINE u8 Headless_getChannelDifference(u8 a, u8 b) {
+    return a > b ? a - b : b - a;
+}
 
-    if (settings->curves) {
-        scene->curves = (Curve*)allocateMemory(memory, sizeof(Curve) * settings->curves);
-        if (scene->curves)
-            for (u32 i = 0; i < settings->curves; i++)
-                initCurve(scene->curves + i);
+// Returns the number of pixels that have any channel differing from the golden image by more than the tolerance.
+// The diff image shows these pixels in red over a dimmed version of the golden image.
+u32 Headless_compareWithGolden(HeadlessSettings *settings, u32 *window_content, u16 width, u16 height) {
+    u16 golden_width, golden_height;
+    u8 *golden = Headless_readImage(settings->golden_file, &golden_width, &golden_height);
+    if (!golden) {
+        printf("Could not read the golden image: %s\n", settings->golden_file);
+        return (u32)width * (u32)height;
+    }
+    if (golden_width != width || golden_height != height) {
+        printf("Golden image is %ux%u but the frame is %ux%u\n",
+               (unsigned int)golden_width, (unsigned int)golden_height, (unsigned int)width, (unsigned int)height);
+        free(golden);
+        return (u32)width * (u32)height;
     }
 
-    if (settings->boxes) {
-        scene->boxes = (Box*)allocateMemory(memory, sizeof(Box) * settings->boxes);
-        if (scene->boxes)
-            for (u32 i = 0; i < settings->boxes; i++)
-                initBox(scene->boxes + i);
+    u32 *diff = settings->diff_file ? (u32*)malloc(sizeof(u32) * width * height) : null;
+    u32 mismatches = 0;
+    u8 max_difference = 0;
+    RGBA2u32 pixel, diff_pixel;
+    u8 *golden_pixel = golden;
+    for (u32 i = 0; i < (u32)width * (u32)height; i++, golden_pixel += 3) {
+        pixel.value = window_content[i];
+        u8 difference = Headless_getChannelDifference(pixel.rgba.R, golden_pixel[0]);
+        u8 G_difference = Headless_getChannelDifference(pixel.rgba.G, golden_pixel[1]);
+        u8 B_difference = Headless_getChannelDifference(pixel.rgba.B, golden_pixel[2]);
+        if (G_difference > difference) difference = G_difference;
+        if (B_difference > difference) difference = B_difference;
+        if (difference > max_difference) max_difference = difference;
+
+        bool is_mismatch = difference > settings->tolerance;
+        if (is_mismatch) mismatches++;
+        if (diff) {
+            diff_pixel.rgba.R = is_mismatch ? MAX_COLOR_VALUE : golden_pixel[0] / 4;
+            diff_pixel.rgba.G = is_mismatch ? 0 : golden_pixel[1] / 4;
+            diff_pixel.rgba.B = is_mismatch ? 0 : golden_pixel[2] / 4;
+            diff_pixel.rgba.A = MAX_COLOR_VALUE;
+            diff[i] = diff_pixel.value;
+        }
     }
+    printf("Compared against %s: %u pixels out of tolerance (%u), max channel difference %u\n",
+           settings->golden_file, (unsigned int)mismatches, (unsigned int)settings->tolerance, (unsigned int)max_difference);
 
-    if (settings->grids) {
-        scene->grids = (Grid*)allocateMemory(memory, sizeof(Grid) * settings->grids);
-        if (scene->grids)
-            for (u32 i = 0; i < settings->grids; i++)
-                initGrid(scene->grids + i, 3, 3);
+    if (diff) {
+        Headless_writeImage(settings->diff_file, diff, width, height);
+        free(diff);
     }
+    free(golden);
 
-    scene->last_io_ticks = 0;
-    scene->last_io_is_save = false;
+    return mismatches;
 }
 
+char* Headless_getProgramName(char *path) {
+    char *name = path;
+    for (char *c = path; *c; c++)
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
 
-void _initApp(Defaults *defaults, u32* window_content) {
-    app->window_content = window_content;
-
-    app->is_running = true;
-    app->user_data = null;
-    app->memory.address = null;
-
-    app->on.sceneReady = null;
-    app->on.viewportReady = null;
-    app->on.windowRedraw = null;
-    app->on.keyChanged = null;
-    app->on.mouseButtonUp = null;
-    app->on.mouseButtonDown = null;
-    app->on.mouseButtonDoubleClicked = null;
-    app->on.mouseWheelScrolled = null;
-    app->on.mousePositionSet = null;
-    app->on.mouseMovementSet = null;
-    app->on.mouseRawMovementSet = null;
-
-    defaults->title = (char*)"";
-    defaults->width = 480;
-    defaults->height = 360;
-    defaults->additional_memory_size = 0;
-
-    SceneSettings *scene_settings = &defaults->settings.scene;
-    ViewportSettings *viewport_settings = &defaults->settings.viewport;
-    NavigationSettings *navigation_settings = &defaults->settings.navigation;
+    return name;
+}
 
-    setDefaultSceneSettings(scene_settings);
-    setDefaultViewportSettings(viewport_settings);
-    setDefaultNavigationSettings(navigation_settings);
+int Headless_run(int argc, char **argv) {
+    HeadlessSettings settings;
+    Headless_setDefaultSettings(&settings);
+    if (!Headless_parseArguments(&settings, argc, argv)) {
+        printf("Usage: %s [--frames N] [--warmup N] [--fps N] [--resolution WIDTHxHEIGHT]... [--show-hud] [--antialias]\n"
+               "       [--large-pages] [--threads N] [--resolution-scale S] [--replay INPUT_RECORDING]\n"
+               "       [--reload-scene SCENE_FILE] [--reload-scene-changes SCENE_FILE] [--reload-torn-scene SCENE_FILE]\n"
+               "       [--output IMAGE.ppm] [--golden IMAGE.ppm [--tolerance N] [--diff IMAGE.ppm]]\n", argv[0]);
+        return -1;
+    }
 
-    initTime(&app->time, app->platform.getTicks, app->platform.ticks_per_second);
-    initMouse(&app->controls.mouse);
-    initApp(defaults);
+    app = (App*)calloc(1, sizeof(App));
+    if (!app) return -1;
+
+    u32 *window_content = (u32*)calloc(MAX_WIDTH * MAX_HEIGHT, sizeof(u32));
+    if (!window_content) return -1;
+
+    app->controls.key_map.space = ' ';
+    app->controls.key_map.shift = 16;
+    app->controls.key_map.ctrl  = 17;
+    app->controls.key_map.alt   = 18;
+    app->controls.key_map.tab   = 9;
+
+    app->platform.ticks_per_second    = HEADLESS__TICKS_PER_SECOND;
+    app->platform.getTicks            = Headless_getTicks;
+    app->platform.getMemory           = Headless_getMemory;
+    app->platform.reserveMemory       = Headless_reserveMemory;
+    app->platform.commitMemory        = Headless_commitMemory;
+    app->platform.getLargePageMemory  = settings.large_pages ? Headless_getLargePageMemory : null;
+    app->platform.setWindowTitle      = Headless_setWindowTitle;
+    app->platform.setWindowCapture    = Headless_setWindowCapture;
+    app->platform.setCursorVisibility = Headless_setCursorVisibility;
+    app->platform.closeFile           = Headless_closeFile;
+    app->platform.openFileForReading  = Headless_openFileForReading;
+    app->platform.openFileForWriting  = Headless_openFileForWriting;
+    app->platform.openFileForAppending = Headless_openFileForAppending;
+    app->platform.readFromFile        = Headless_readFromFile;
+    app->platform.writeToFile         = Headless_writeToFile;
+    app->platform.mapFileForReading   = Headless_mapFileForReading;
+    app->platform.unmapFile           = Headless_unmapFile;
+    setPlatformThreads(&app->platform); // The job system's threads, which leave one for loading meshes (see MeshLoader)
+    app->platform.thread_count        = settings.threads ? settings.threads : Headless_getProcessorCount();
+    if (app->platform.thread_count > PARALLEL__MAX_THREADS) app->platform.thread_count = PARALLEL__MAX_THREADS;
 
-    u64 memory_size = sizeof(Selection) + defaults->additional_memory_size;
-    memory_size += scene_settings->primitives * sizeof(Primitive);
-    memory_size += scene_settings->meshes     * sizeof(Mesh);
-    memory_size += scene_settings->curves     * sizeof(Curve);
-    memory_size += scene_settings->boxes      * sizeof(Box);
-    memory_size += scene_settings->grids      * sizeof(Grid);
-    memory_size += scene_settings->cameras    * sizeof(Camera);
-    memory_size += viewport_settings->hud_line_count * sizeof(HUDLine);
+    Defaults defaults;
+    _initApp(&defaults, window_content);
+    if (!app->is_running) return -1;
+    finishLoadingMeshes(&app->scene.mesh_loader);
+    if (settings.show_hud)  app->viewport.settings.show_hud  = true;
+    if (settings.antialias) app->viewport.settings.antialias = true;
+    if (settings.resolution_scale != 1) setViewportResolutionScale(&app->viewport, settings.resolution_scale);
+    if (settings.scene_file && !Headless_reloadScene(settings.scene_file, settings.scene_changes, settings.torn_scene)) {
+        printf("Could not reload the scene from: %s\n", settings.scene_file);
+        return -1;
+    }
 
-    u32 max_triangle_count = CUBE__TRIANGLE_COUNT;
-    u32 max_vertex_count = CUBE__VERTEX_COUNT;
-    u32 max_normal_count = CUBE__NORMAL_COUNT;
-    if (scene_settings->meshes && scene_settings->mesh_files) {
-        Mesh mesh;
-        for (u32 i = 0; i < scene_settings->meshes; i++) {
-            memory_size += getMeshMemorySize(&mesh, scene_settings->mesh_files[i].char_ptr, &app->platform);
-            if (mesh.triangle_count > max_triangle_count) max_triangle_count = mesh.triangle_count;
-            if (mesh.vertex_count > max_vertex_count) max_vertex_count = mesh.vertex_count;
-            if (mesh.normals_count > max_normal_count) max_normal_count = mesh.normals_count;
+    if (settings.replay_file) {
+        settings.frames = getInputRecordingFrameCount(settings.replay_file, &app->platform);
+        settings.warmup_frames = 0;
+        if (!settings.frames || !startInputReplay(&app->input_recording, settings.replay_file, &app->platform)) {
+            printf("Could not read the input recording: %s\n", settings.replay_file);
+            return -1;
         }
     }
+    u64 *frame_times = (u64*)malloc(sizeof(u64) * settings.frames);
+    if (!frame_times) return -1;
+
+    Camera initial_camera = *app->viewport.camera;
+    u64 ticks_per_frame = HEADLESS__TICKS_PER_SECOND / settings.fps;
+    f32 delta_time = (f32)ticks_per_frame / (f32)HEADLESS__TICKS_PER_SECOND;
+    char *name = Headless_getProgramName(argv[0]);
+
+    for (u32 r = 0; r < settings.resolution_count; r++) {
+        Dimensions *resolution = &settings.resolutions[r];
+        *app->viewport.camera = initial_camera;
+        _windowResize(resolution->width, resolution->height);
+
+        for (u32 frame = 0; frame < settings.warmup_frames + settings.frames; frame++) {
+            bool is_measured = frame >= settings.warmup_frames;
+            Headless_ticks += ticks_per_frame;
+            if (settings.replay_file)
+                _replayInputEvents();
+            else if (is_measured)
+                Headless_stepCameraScript(&app->viewport, frame - settings.warmup_frames, settings.frames, delta_time);
+
+            u64 before = Headless_getRealNanoseconds();
+            _windowRedraw();
+            u64 after = Headless_getRealNanoseconds();
+            if (is_measured) frame_times[frame - settings.warmup_frames] = after - before;
+        }
 
-    memory_size += FRAME_BUFFER_MEMORY_SIZE;
+        u64 total = 0;
+        for (u32 i = 0; i < settings.frames; i++) total += frame_times[i];
+        qsort(frame_times, settings.frames, sizeof(u64), Headless_compareFrameTimes);
+
+        printf("%s %ux%u frames=%u min=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus max=%.1fus mean=%.1fus checksum=%016llx\n",
+               name, (unsigned int)resolution->width, (unsigned int)resolution->height, (unsigned int)settings.frames,
+               (f64)frame_times[0] / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 50) / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 90) / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 99) / 1000.0,
+               (f64)frame_times[settings.frames - 1] / 1000.0,
+               (f64)total / (f64)settings.frames / 1000.0,
+               (unsigned long long)Headless_getWindowContentChecksum(window_content, (u32)resolution->width * (u32)resolution->height));
+    }
 
-    initAppMemory(memory_size);
+    // The window's dimensions (the viewport may only cover a region of the window, see viewport/compositor.h):
+    u16 width  = settings.resolutions[settings.resolution_count - 1].width;
+    u16 height = settings.resolutions[settings.resolution_count - 1].height;
+    if (settings.output_file && !Headless_writeImage(settings.output_file, window_content, width, height)) {
+        printf("Could not write the output image: %s\n", settings.output_file);
+        return -1;
+    }
+    if (settings.golden_file && Headless_compareWithGolden(&settings, window_content, width, height))
+        return 1;
 
-    PixelQuad *pixels = (PixelQuad*)allocateAppMemory(FRAME_BUFFER_MEMORY_SIZE);
-    initScene(&app->scene, scene_settings, &app->memory, &app->platform);
-    if (app->on.sceneReady) app->on.sceneReady(&app->scene);
+    return 0;
+}
 
-    if (viewport_settings->hud_line_count)
-        viewport_settings->hud_lines = (HUDLine*)allocateAppMemory(viewport_settings->hud_line_count * sizeof(HUDLine));
+int main(int argc, char **argv) {
+    int result = Headless_run(argc, argv);
+    if (app) shutDownJobSystem(&app->platform);
 
-    initViewport(&app->viewport, viewport_settings, navigation_settings, app->scene.cameras, pixels);
-    if (app->on.viewportReady) app->on.viewportReady(&app->viewport);
+    return result;
 }
 
-#ifdef __linux__
+
+#elif __linux__
 //linux code goes here
 #elif _WIN32
-
-
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 
@@ -4940,6 +9757,45 @@ u64 Win32_getTicks() {
 void* Win32_getMemory(u64 size) {
     return VirtualAlloc((LPVOID)MEMORY_BASE, (SIZE_T)size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
 }
+void* Win32_reserveMemory(u64 size) {
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+}
+bool Win32_commitMemory(void *address, u64 size) {
+    return VirtualAlloc((LPVOID)address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != null;
+}
+// Large pages have to be committed up-front, and require the 'Lock pages in memory' privilege to be granted to the user.
+void* Win32_getLargePageMemory(u64 size) {
+    HANDLE token;
+    TOKEN_PRIVILEGES privileges;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return null;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = (
+        LookupPrivilegeValue(null, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, null, null) &&
+        GetLastError() == ERROR_SUCCESS
+    );
+    CloseHandle(token);
+    if (!enabled) return null;
+
+    SIZE_T large_page_size = GetLargePageMinimum();
+    if (!large_page_size) return null;
+
+    size = (size + large_page_size - 1) / large_page_size * large_page_size;
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
+// Returns the rest of the command line after the given option, or null if the command line does not contain it.
+char* Win32_getCommandLineOption(char *command_line, char *option) {
+    for (; *command_line; command_line++) {
+        char *o = option;
+        char *c = command_line;
+        while (*o && *o == *c) { o++; c++; }
+        if (!*o) return c;
+    }
+
+    return null;
+}
 
 inline UINT getRawInput(LPVOID data) {
     return GetRawInputData(raw_input_handle, RID_INPUT, data, raw_input_size_ptr, raw_input_header_size);
@@ -4950,9 +9806,9 @@ inline bool hasRawInput() {
 inline bool hasRawMouseInput(LPARAM lParam) {
     raw_input_handle = (HRAWINPUT)(lParam);
     return (
-            hasRawInput() &&
-            getRawInput((LPVOID)&raw_inputs) == raw_input_size &&
-            raw_inputs.header.dwType == RIM_TYPEMOUSE
+        hasRawInput() &&
+        getRawInput((LPVOID)&raw_inputs) == raw_input_size &&
+        raw_inputs.header.dwType == RIM_TYPEMOUSE
     );
 }
 
@@ -4979,7 +9835,7 @@ void* Win32_openFileForWriting(const char* path) {
                                GENERIC_WRITE,          // open for writing
                                0,                      // do not share
                                null,                   // default security
-                               OPEN_ALWAYS,            // create new or open existing
+                               CREATE_ALWAYS,          // create new or truncate existing
                                FILE_ATTRIBUTE_NORMAL,  // normal file
                                null);
 #ifndef NDEBUG
@@ -4991,6 +9847,16 @@ void* Win32_openFileForWriting(const char* path) {
 #endif
     return handle;
 }
+void* Win32_openFileForAppending(const char* path) {
+    HANDLE handle = CreateFile(path,           // file to open
+                               FILE_APPEND_DATA,       // open for writing at its end
+                               0,                      // do not share
+                               null,                   // default security
+                               OPEN_EXISTING,          // existing file only
+                               FILE_ATTRIBUTE_NORMAL,  // normal file
+                               null);
+    return handle == INVALID_HANDLE_VALUE ? null : handle;
+}
 bool Win32_readFromFile(LPVOID out, DWORD size, HANDLE handle) {
     DWORD bytes_read = 0;
     BOOL result = ReadFile(handle, out, size, &bytes_read, null);
@@ -5017,6 +9883,108 @@ bool Win32_writeToFile(LPVOID out, DWORD size, HANDLE handle) {
     return result != FALSE;
 }
 
+void* Win32_mapFileForReading(const char* path, u64 *size) {
+    HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+    if (file == INVALID_HANDLE_VALUE) return null;
+
+    LARGE_INTEGER file_size;
+    HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart ?
+                     CreateFileMapping(file, null, PAGE_WRITECOPY, 0, 0, null) : null;
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : null;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (data) *size = (u64)file_size.QuadPart;
+
+    return data;
+}
+void Win32_unmapFile(void *data, u64 size) { if (data) UnmapViewOfFile(data); }
+
+// When the app updates at a fixed time step (see core/simulation.h) the main thread handles the messages and updates,
+// while snapshots are rendered (and presented) on a thread of their own, that is woken up whenever one is published.
+// The thread presents the viewport of each snapshot at its own size (the window may have been resized since).
+CRITICAL_SECTION Win32_snapshot_lock;
+HANDLE Win32_snapshot_published;
+bool Win32_is_rendering_separately = false;
+
+DWORD WINAPI Win32_renderSceneSnapshots(LPVOID parameter) {
+    BITMAPINFO render_info = info;
+    u64 last_frame_ticks = 0;
+    while (app->is_running) {
+        WaitForSingleObject(Win32_snapshot_published, INFINITE);
+        if (!app->is_running) break;
+
+        if (app->max_frames_per_second) {
+            u64 ticks_per_frame = Win32_ticksPerSecond / app->max_frames_per_second;
+            u64 ticks_since_last_frame = Win32_getTicks() - last_frame_ticks;
+            if (ticks_since_last_frame < ticks_per_frame)
+                Sleep((DWORD)((ticks_per_frame - ticks_since_last_frame) * 1000 / Win32_ticksPerSecond));
+        }
+        last_frame_ticks = Win32_getTicks();
+
+        EnterCriticalSection(&Win32_snapshot_lock);
+        SceneSnapshot *snapshot = acquireSceneSnapshot(&app->simulation);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+        if (!snapshot) continue;
+
+        _renderSceneSnapshot(snapshot);
+        render_info.bmiHeader.biWidth  =  (LONG)getViewportWindowWidth( &snapshot->viewport);
+        render_info.bmiHeader.biHeight = -(LONG)getViewportWindowHeight(&snapshot->viewport);
+        SetDIBitsToDevice(win_dc,
+                          0, 0, (DWORD)render_info.bmiHeader.biWidth, (DWORD)-render_info.bmiHeader.biHeight,
+                          0, 0, 0, (UINT)-render_info.bmiHeader.biHeight,
+                          app->window_content, &render_info, DIB_RGB_COLORS);
+
+        EnterCriticalSection(&Win32_snapshot_lock);
+        releaseSceneSnapshot(&app->simulation, snapshot);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+    }
+
+    return 0;
+}
+
+// Updates for as long as the app is running, waiting for messages in between steps.
+// Without a thread to render on, this returns right away (and the app updates and renders in turn, on every redraw):
+void Win32_simulate() {
+    Win32_snapshot_published = CreateEventA(null, FALSE, FALSE, null);
+    if (!Win32_snapshot_published) return;
+
+    InitializeCriticalSection(&Win32_snapshot_lock);
+    HANDLE render_thread = CreateThread(null, 0, Win32_renderSceneSnapshots, null, 0, null);
+    if (!render_thread) {
+        DeleteCriticalSection(&Win32_snapshot_lock);
+        CloseHandle(Win32_snapshot_published);
+        return;
+    }
+    Win32_is_rendering_separately = true;
+    profiler_ignores_this_thread = true;
+
+    MSG message;
+    Simulation *simulation = &app->simulation;
+    while (app->is_running) {
+        while (PeekMessageA(&message, null, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&message);
+            DispatchMessageA(&message);
+        }
+        if (!app->is_running) break;
+
+        bool has_stepped = _simulate() != 0;
+        EnterCriticalSection(&Win32_snapshot_lock);
+        bool published = _publishSceneSnapshot(has_stepped);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+        if (published) SetEvent(Win32_snapshot_published);
+
+        u64 ticks_until_next_step = simulation->ticks_per_step - simulation->accumulated_ticks;
+        DWORD milliseconds = (DWORD)(ticks_until_next_step * 1000 / Win32_ticksPerSecond);
+        if (milliseconds) MsgWaitForMultipleObjects(0, null, FALSE, milliseconds, QS_ALLINPUT);
+    }
+
+    SetEvent(Win32_snapshot_published);
+    WaitForSingleObject(render_thread, INFINITE);
+    CloseHandle(render_thread);
+    CloseHandle(Win32_snapshot_published);
+    DeleteCriticalSection(&Win32_snapshot_lock);
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
         case WM_DESTROY:
@@ -5035,9 +10003,17 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             break;
 
         case WM_PAINT:
+            // When rendering on a separate thread, only that thread presents (see Win32_renderSceneSnapshots):
+            if (Win32_is_rendering_separately) {
+                app->needs_redraw = true;
+                ValidateRgn(window, null);
+                break;
+            }
+
+            // The window's size (the viewport may cover only a region of it, or render at a lower resolution):
             SetDIBitsToDevice(win_dc,
-                              0, 0, app->viewport.dimensions.width, app->viewport.dimensions.height,
-                              0, 0, 0, app->viewport.dimensions.height,
+                              0, 0, (DWORD)info.bmiHeader.biWidth, (DWORD)-info.bmiHeader.biHeight,
+                              0, 0, 0, (UINT)-info.bmiHeader.biHeight,
                               app->window_content, &info, DIB_RGB_COLORS);
 
             ValidateRgn(window, null);
@@ -5068,8 +10044,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
         case WM_INPUT:
             if ((hasRawMouseInput(lParam)) && (
-                    raw_inputs.data.mouse.lLastX != 0 ||
-                    raw_inputs.data.mouse.lLastY != 0))
+                raw_inputs.data.mouse.lLastX != 0 ||
+                raw_inputs.data.mouse.lLastY != 0))
                 _mouseRawMovementSet(
                         raw_inputs.data.mouse.lLastX,
                         raw_inputs.data.mouse.lLastY
@@ -5110,18 +10086,37 @@ int APIENTRY WinMain(HINSTANCE hInstance,
     app->platform.ticks_per_second    = Win32_ticksPerSecond;
     app->platform.getTicks            = Win32_getTicks;
     app->platform.getMemory           = Win32_getMemory;
+    app->platform.reserveMemory       = Win32_reserveMemory;
+    app->platform.commitMemory        = Win32_commitMemory;
+    app->platform.getLargePageMemory  = Win32_getCommandLineOption(lpCmdLine, (char*)"--large-pages") ? Win32_getLargePageMemory : null;
     app->platform.setWindowTitle      = Win32_setWindowTitle;
     app->platform.setWindowCapture    = Win32_setWindowCapture;
     app->platform.setCursorVisibility = Win32_setCursorVisibility;
     app->platform.closeFile           = Win32_closeFile;
     app->platform.openFileForReading  = Win32_openFileForReading;
     app->platform.openFileForWriting  = Win32_openFileForWriting;
+    app->platform.openFileForAppending = Win32_openFileForAppending;
     app->platform.readFromFile        = Win32_readFromFile;
     app->platform.writeToFile         = Win32_writeToFile;
+    app->platform.mapFileForReading   = Win32_mapFileForReading;
+    app->platform.unmapFile           = Win32_unmapFile;
+    setPlatformThreads(&app->platform); // The job system's threads, which leave one for loading meshes (see MeshLoader)
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    app->platform.thread_count = (u32)system_info.dwNumberOfProcessors;
+    if (app->platform.thread_count > PARALLEL__MAX_THREADS) app->platform.thread_count = PARALLEL__MAX_THREADS;
 
     Defaults defaults;
     _initApp(&defaults, (u32*)window_content_memory);
 
+    // Input can be recorded for a later replay (see platforms/headless.h) using: <example>.exe --record <file path>
+    // The app's memory can be backed by large pages using: <example>.exe --large-pages (before any --record option)
+    // It then has a fixed capacity that can not grow (see initAppMemory).
+    char *record_file_path = Win32_getCommandLineOption(lpCmdLine, (char*)"--record ");
+    if (record_file_path && *record_file_path)
+        startInputRecording(&app->input_recording, record_file_path, &app->platform);
+
     info.bmiHeader.biSize        = sizeof(info.bmiHeader);
     info.bmiHeader.biCompression = BI_RGB;
     info.bmiHeader.biBitCount    = 32;
@@ -5169,21 +10164,46 @@ int APIENTRY WinMain(HINSTANCE hInstance,
     SetICMMode(win_dc, ICM_OFF);
 
 
-
     ShowWindow(window, nCmdShow);
 
+    if (isSimulating(&app->on)) Win32_simulate();
+
+    // With render on demand the loop sleeps until a message arrives whenever there is nothing new to draw,
+    // and with a frame cap it sleeps between frames (still waking up for messages, so input is handled on time).
+    // While meshes are loading it only sleeps briefly, to draw each mesh soon after it is loaded:
     MSG message;
+    u64 last_frame_ticks = 0;
     while (app->is_running) {
         while (PeekMessageA(&message, null, 0, 0, PM_REMOVE)) {
             TranslateMessage(&message);
             DispatchMessageA(&message);
         }
+        if (!app->is_running) break;
+        bool is_loading_meshes = isLoadingMeshes(&app->scene.mesh_loader);
+        if (!_isRedrawNeeded()) {
+            if (is_loading_meshes)
+                MsgWaitForMultipleObjects(0, null, FALSE, 10, QS_ALLINPUT);
+            else
+                WaitMessage();
+            continue;
+        }
+        if (app->max_frames_per_second) {
+            u64 ticks_per_frame = Win32_ticksPerSecond / app->max_frames_per_second;
+            u64 ticks_since_last_frame = Win32_getTicks() - last_frame_ticks;
+            if (ticks_since_last_frame < ticks_per_frame) {
+                DWORD milliseconds = (DWORD)((ticks_per_frame - ticks_since_last_frame) * 1000 / Win32_ticksPerSecond);
+                if (milliseconds) MsgWaitForMultipleObjects(0, null, FALSE, milliseconds, QS_ALLINPUT);
+                continue;
+            }
+        }
+        last_frame_ticks = Win32_getTicks();
         _windowRedraw();
         InvalidateRgn(window, null, false);
     }
+    stopInputRecording(&app->input_recording, &app->platform);
+    shutDownJobSystem(&app->platform);
 
     return 0;
 }
 
-
-#endif
\ No newline at end of file
+#endif
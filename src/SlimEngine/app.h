@@ -2,25 +2,135 @@
 
 #include "./core/init.h"
 #include "./scene/io.h"
+#include "./scene/parallel.h"
+#include "./scene/objects.h"
+#include "./core/recording.h"
+#include "./core/text.h"
+#include "./core/time.h"
+#include "./core/simulation.h"
+#include "./core/jobs.h"
+#include "./platforms/threads.h"
 
 App *app;
 
 void initApp(Defaults *defaults);
 
+// When rendering on demand, the platform only redraws the window when something may have changed since the last frame:
+// Input arrived (or the window was resized), a mesh finished loading (see MeshLoader), or needs_redraw was set
+// for anything that changes by itself: The camera of any viewport that is still navigating (it glides to a stop after
+// the keys are released, see navigateViewport) or an animation of the app.
+// The app can set needs_redraw at any time, including while drawing a frame (to have the next one drawn as well).
+bool _isRedrawNeeded() {
+    if (!app->render_on_demand || app->needs_redraw) return true;
+
+    MeshLoader *mesh_loader = &app->scene.mesh_loader;
+    u32 loaded_count = ATOMIC_LOAD(&mesh_loader->loaded_count);
+    if (loaded_count != mesh_loader->drawn_count) {
+        mesh_loader->drawn_count = loaded_count;
+        return true;
+    }
+
+    return false;
+}
+
+// Runs as many fixed steps of the app's update as the time that passed since the last call covers (returning how many).
+// Input is handled per step: The mouse changes are reset after each one and a recording advances a frame per step.
+// Having fallen behind by more than SIMULATION__MAX_STEPS_PER_UPDATE steps, the rest of the time is dropped.
+u32 _simulate() {
+    Simulation *simulation = &app->simulation;
+    u64 ticks = app->time.getTicks();
+    if (!simulation->ticks_per_step) {
+        simulation->ticks_per_step = app->time.ticks.per_second / simulation->steps_per_second;
+        simulation->last_ticks = ticks - simulation->ticks_per_step; // The first call runs a step right away
+    }
+    simulation->accumulated_ticks += ticks - simulation->last_ticks;
+    simulation->last_ticks = ticks;
+
+    u64 step_count = simulation->accumulated_ticks / simulation->ticks_per_step;
+    if (step_count > SIMULATION__MAX_STEPS_PER_UPDATE) {
+        step_count = SIMULATION__MAX_STEPS_PER_UPDATE;
+        simulation->accumulated_ticks = 0;
+    } else
+        simulation->accumulated_ticks -= step_count * simulation->ticks_per_step;
+    if (!step_count) return 0;
+
+    Navigation *navigation = &app->viewport.navigation;
+    navigation->moved = navigation->turned = navigation->zoomed = false;
+
+    f32 time_step = 1.0f / (f32)simulation->steps_per_second;
+    Timer *timer = &app->time.timers.update;
+    for (u64 step = 0; step < step_count; step++) {
+        beginFrameTimer(timer);
+        app->on.update(time_step);
+        resetMouseChanges(&app->controls.mouse);
+        endFrameTimer(timer);
+        simulation->step++;
+        if (app->input_recording.is_recording ||
+            app->input_recording.is_replaying)
+            app->input_recording.frame++;
+    }
+
+    return (u32)step_count;
+}
+
+// Publishes the current state for rendering when there is anything new to render (see _isRedrawNeeded)
+bool _publishSceneSnapshot(bool has_stepped) {
+    if (!(has_stepped || app->needs_redraw) || !_isRedrawNeeded()) return false;
+
+    bool published = publishSceneSnapshot(&app->simulation, &app->scene, &app->viewport, &app->controls);
+    app->needs_redraw = !published;
+    return published;
+}
+
+void _renderSceneSnapshot(SceneSnapshot *snapshot) {
+    Timer *timer = &app->time.timers.render;
+    resetMemory(&app->frame_memory);
+    beginFrame(timer);
+    app->on.render(snapshot);
+    endFrameTimer(timer);
+#ifdef SLIM_ENGINE_PROFILER
+    PROFILE_END();
+    endProfileFrame();
+#endif
+}
+
 void _windowRedraw() {
     if (!app->is_running) return;
+
+    // Updating and rendering in turn (a platform may instead render on a separate thread, see core/simulation.h):
+    if (isSimulating(&app->on)) {
+        _publishSceneSnapshot(_simulate() != 0);
+        SceneSnapshot *snapshot = acquireSceneSnapshot(&app->simulation);
+        if (snapshot) {
+            _renderSceneSnapshot(snapshot);
+            releaseSceneSnapshot(&app->simulation, snapshot);
+        }
+        return;
+    }
+
+    app->needs_redraw = false;
+    app->viewport.navigation.moved = app->viewport.navigation.turned = app->viewport.navigation.zoomed = false;
+    resetMemory(&app->frame_memory);
     if (app->on.windowRedraw) app->on.windowRedraw();
+    if (app->input_recording.is_recording ||
+        app->input_recording.is_replaying)
+        app->input_recording.frame++;
 }
 
 void _windowResize(u16 width, u16 height) {
     if (!app->is_running) return;
-    updateDimensions(&app->viewport.dimensions, width, height, width);
+    recordInputEvent(&app->input_recording, InputEvent_WindowResize, 0, width, height, &app->platform);
+    app->needs_redraw = true;
+    resizeViewport(&app->viewport, width, height, width);
 
     if (app->on.windowResize) app->on.windowResize(width, height);
     if (app->on.windowRedraw) app->on.windowRedraw();
 }
 
 void _keyChanged(u8 key, bool pressed) {
+    recordInputEvent(&app->input_recording, pressed ? InputEvent_KeyDown : InputEvent_KeyUp, key, 0, 0, &app->platform);
+    app->needs_redraw = true;
+
          if (key == app->controls.key_map.ctrl)  app->controls.is_pressed.ctrl  = pressed;
     else if (key == app->controls.key_map.alt)   app->controls.is_pressed.alt   = pressed;
     else if (key == app->controls.key_map.shift) app->controls.is_pressed.shift = pressed;
@@ -31,6 +141,9 @@ void _keyChanged(u8 key, bool pressed) {
 }
 
 void _mouseButtonDown(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonDown, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
+
     mouse_button->is_pressed = true;
     mouse_button->is_handled = false;
 
@@ -41,6 +154,9 @@ void _mouseButtonDown(MouseButton *mouse_button, i32 x, i32 y) {
 }
 
 void _mouseButtonUp(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonUp, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
+
     mouse_button->is_pressed = false;
     mouse_button->is_handled = false;
 
@@ -51,6 +167,9 @@ void _mouseButtonUp(MouseButton *mouse_button, i32 x, i32 y) {
 }
 
 void _mouseButtonDoubleClicked(MouseButton *mouse_button, i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseButtonDoubleClicked, getMouseButtonCode(&app->controls.mouse, mouse_button), x, y, &app->platform);
+    app->needs_redraw = true;
+
     app->controls.mouse.double_clicked = true;
     mouse_button->double_click_pos.x = x;
     mouse_button->double_click_pos.y = y;
@@ -58,6 +177,9 @@ void _mouseButtonDoubleClicked(MouseButton *mouse_button, i32 x, i32 y) {
 }
 
 void _mouseWheelScrolled(f32 amount) {
+    recordMouseWheelScrolled(&app->input_recording, amount, &app->platform);
+    app->needs_redraw = true;
+
     app->controls.mouse.wheel_scroll_amount += amount * 100;
     app->controls.mouse.wheel_scrolled = true;
 
@@ -65,6 +187,9 @@ void _mouseWheelScrolled(f32 amount) {
 }
 
 void _mousePositionSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MousePositionSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
+
     app->controls.mouse.pos.x = x;
     app->controls.mouse.pos.y = y;
 
@@ -72,6 +197,9 @@ void _mousePositionSet(i32 x, i32 y) {
 }
 
 void _mouseMovementSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseMovementSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
+
     app->controls.mouse.movement.x = x - app->controls.mouse.pos.x;
     app->controls.mouse.movement.y = y - app->controls.mouse.pos.y;
     app->controls.mouse.moved = true;
@@ -80,6 +208,9 @@ void _mouseMovementSet(i32 x, i32 y) {
 }
 
 void _mouseRawMovementSet(i32 x, i32 y) {
+    recordInputEvent(&app->input_recording, InputEvent_MouseRawMovementSet, 0, x, y, &app->platform);
+    app->needs_redraw = true;
+
     app->controls.mouse.pos_raw_diff.x += x;
     app->controls.mouse.pos_raw_diff.y += y;
     app->controls.mouse.moved = true;
@@ -87,16 +218,79 @@ void _mouseRawMovementSet(i32 x, i32 y) {
     if (app->on.mouseRawMovementSet) app->on.mouseRawMovementSet(x, y);
 }
 
+// Feeds back the recorded events of the current frame (to be called by the platform before each redraw while replaying)
+void _replayInputEvents() {
+    InputEvent event;
+    Mouse *mouse = &app->controls.mouse;
+    while (getNextInputEventOfFrame(&app->input_recording, &event, &app->platform)) {
+        switch (event.type) {
+            case InputEvent_KeyDown                 : _keyChanged(event.code, true);  break;
+            case InputEvent_KeyUp                   : _keyChanged(event.code, false); break;
+            case InputEvent_MouseButtonDown         : _mouseButtonDown(         getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseButtonUp           : _mouseButtonUp(           getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseButtonDoubleClicked: _mouseButtonDoubleClicked(getMouseButtonOfCode(mouse, event.code), event.x, event.y); break;
+            case InputEvent_MouseWheelScrolled      : _mouseWheelScrolled(event.amount); break;
+            case InputEvent_MousePositionSet        : _mousePositionSet(   event.x, event.y); break;
+            case InputEvent_MouseMovementSet        : _mouseMovementSet(   event.x, event.y); break;
+            case InputEvent_MouseRawMovementSet     : _mouseRawMovementSet(event.x, event.y); break;
+            case InputEvent_WindowResize:
+                if (event.x > 0 && event.x <= MAX_WIDTH &&
+                    event.y > 0 && event.y <= MAX_HEIGHT)
+                    _windowResize((u16)event.x, (u16)event.y);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+bool initGrowableAppMemory(Memory *memory, u64 reserved_size, u64 initial_size) {
+    void* memory_address = app->platform.reserveMemory(reserved_size);
+    if (!memory_address) return false;
+
+    initGrowableMemory(memory, (u8*)memory_address, reserved_size, app->platform.commitMemory);
+    return commitMemory(memory, initial_size);
+}
+
+// The app's memory is reserved up-front and committed as it grows (when the platform supports it)
+// with the given size committed initially. Otherwise, the given size is allocated as a fixed capacity.
+// When the platform was asked to use large pages (and can get them), the app's memory is allocated with them instead,
+// also as a fixed capacity. It holds the frame buffer and the meshes, which are then covered by far fewer TLB entries.
+// Large pages can not be committed on demand, so that memory never grows: The size given here is then all there is,
+// and allocating past it fails (allocateAppMemory then stops the app). The meshes of the scene's settings are counted
+// in it, but memory for meshes added at runtime has to be asked for up-front (as the defaults' additional_memory_size).
+// Large pages are also not placed per NUMA node: They are all committed here (on the node of the main thread, if any),
+// while the job system's threads are not pinned to nodes, so the rows that a thread draws may be on a remote node.
+// The frame memory is a separate arena for transient allocations of drawing (like the viewports of the bands that
+// drawSceneInParallel draws), that is reset at the start of each frame (before on.render, when updating separately).
 bool initAppMemory(u64 size) {
     if (app->memory.address) return false;
 
-    void* memory_address = app->platform.getMemory(size);
-    if (!memory_address) {
+    bool initialized;
+    void* large_page_memory_address = app->platform.getLargePageMemory ? app->platform.getLargePageMemory(size) : null;
+    if (large_page_memory_address)
+        initMemory(&app->memory, (u8*)large_page_memory_address, size);
+
+    if (app->platform.reserveMemory && app->platform.commitMemory) {
+        initialized = (
+            (large_page_memory_address ||
+             initGrowableAppMemory(&app->memory, size > MEMORY__RESERVE_SIZE ? size : MEMORY__RESERVE_SIZE, size)) &&
+            initGrowableAppMemory(&app->frame_memory, FRAME_MEMORY__RESERVE_SIZE, 0)
+        );
+    } else {
+        u64 memory_size = large_page_memory_address ? 0 : size;
+        u8* memory_address = (u8*)app->platform.getMemory(memory_size + FRAME_MEMORY__RESERVE_SIZE);
+        initialized = memory_address != null;
+        if (initialized) {
+            if (!large_page_memory_address) initMemory(&app->memory, memory_address, size);
+            initMemory(&app->frame_memory, memory_address + memory_size, FRAME_MEMORY__RESERVE_SIZE);
+        }
+    }
+    if (!initialized) {
         app->is_running = false;
         return false;
     }
 
-    initMemory(&app->memory, (u8*)memory_address, size);
     return true;
 }
 
@@ -109,6 +303,7 @@ void* allocateAppMemory(u64 size) {
 }
 
 void initScene(Scene *scene, SceneSettings *settings, Memory *memory, Platform *platform) {
+    setScenePoolCapacities(settings);
     scene->settings   = *settings;
     scene->primitives = null;
     scene->cameras    = null;
@@ -119,12 +314,29 @@ void initScene(Scene *scene, SceneSettings *settings, Memory *memory, Platform *
 
     scene->selection = (Selection*)allocateMemory(memory, sizeof(Selection));
     scene->selection->object_type = scene->selection->object_id = 0;
+    scene->selection->primitive = null;
     scene->selection->changed = false;
 
-    if (settings->meshes && settings->mesh_files) {
-        scene->meshes = (Mesh*)allocateMemory(memory, sizeof(Mesh) * settings->meshes);
-        for (u32 i = 0; i < settings->meshes; i++)
-            loadMeshFromFile(&scene->meshes[i], settings->mesh_files[i].char_ptr, platform, memory);
+    if (!settings->mesh_files) scene->settings.meshes = 0;
+    initObjectPool(&scene->primitive_pool, settings->max_primitives, settings->primitives, memory);
+    initObjectPool(&scene->mesh_pool,      settings->max_meshes,     scene->settings.meshes, memory);
+    initObjectPool(&scene->curve_pool,     settings->max_curves,     settings->curves,     memory);
+    initObjectPool(&scene->box_pool,       settings->max_boxes,      settings->boxes,      memory);
+    initObjectPool(&scene->grid_pool,      settings->max_grids,      settings->grids,      memory);
+
+    // The meshes' files are loaded on a background thread, each mesh being drawn by its bounds until it is loaded:
+    initMeshLoader(&scene->mesh_loader, scene->settings.meshes, platform, memory);
+    if (settings->max_meshes) {
+        scene->meshes = (Mesh*)allocateMemory(memory, sizeof(Mesh) * settings->max_meshes);
+        if (scene->meshes) {
+            for (u32 i = 0; i < settings->max_meshes; i++) {
+                if (i < scene->settings.meshes) {
+                    queueMeshLoading(&scene->mesh_loader, &scene->meshes[i], settings->mesh_files[i].char_ptr, memory);
+                } else {
+                    initMesh(&scene->meshes[i]);
+                }
+            }
+        }
     }
 
     if (settings->cameras) {
@@ -134,47 +346,81 @@ void initScene(Scene *scene, SceneSettings *settings, Memory *memory, Platform *
                 initCamera(scene->cameras + i);
     }
 
-    if (settings->primitives) {
-        scene->primitives = (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->primitives);
+    if (settings->max_primitives) {
+        scene->primitives = (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->max_primitives);
         if (scene->primitives)
-            for (u32 i = 0; i < settings->primitives; i++) {
+            for (u32 i = 0; i < settings->max_primitives; i++) {
                 initPrimitive(scene->primitives + i);
-                scene->primitives[i].id = i;
+                if (i < settings->primitives) scene->primitives[i].id = i;
             }
     }
 
-    if (settings->curves) {
-        scene->curves = (Curve*)allocateMemory(memory, sizeof(Curve) * settings->curves);
+    if (settings->max_curves) {
+        scene->curves = (Curve*)allocateMemory(memory, sizeof(Curve) * settings->max_curves);
+        vec3 *curve_points = (vec3*)allocateMemory(memory, sizeof(vec3) * CURVE_STEPS * settings->max_curves);
         if (scene->curves)
-            for (u32 i = 0; i < settings->curves; i++)
+            for (u32 i = 0; i < settings->max_curves; i++) {
                 initCurve(scene->curves + i);
+                scene->curves[i].points = curve_points ? curve_points + CURVE_STEPS * i : null;
+                scene->curves[i].points_capacity = curve_points ? CURVE_STEPS : 0;
+            }
     }
 
-    if (settings->boxes) {
-        scene->boxes = (Box*)allocateMemory(memory, sizeof(Box) * settings->boxes);
+    if (settings->max_boxes) {
+        scene->boxes = (Box*)allocateMemory(memory, sizeof(Box) * settings->max_boxes);
         if (scene->boxes)
-            for (u32 i = 0; i < settings->boxes; i++)
+            for (u32 i = 0; i < settings->max_boxes; i++)
                 initBox(scene->boxes + i);
     }
 
-    if (settings->grids) {
-        scene->grids = (Grid*)allocateMemory(memory, sizeof(Grid) * settings->grids);
+    if (settings->max_grids) {
+        scene->grids = (Grid*)allocateMemory(memory, sizeof(Grid) * settings->max_grids);
         if (scene->grids)
-            for (u32 i = 0; i < settings->grids; i++)
+            for (u32 i = 0; i < settings->max_grids; i++)
                 initGrid(scene->grids + i, 3, 3);
     }
 
+    initSceneJournal(&scene->journal, settings, memory);
     scene->last_io_ticks = 0;
     scene->last_io_is_save = false;
+
+    startLoadingMeshes(&scene->mesh_loader);
 }
 
+u64 getSceneMemorySize(SceneSettings *settings) {
+    setScenePoolCapacities(settings);
+    u64 pool_slot_count = settings->max_primitives + settings->max_meshes + settings->max_curves + settings->max_boxes + settings->max_grids;
+
+    u64 memory_size = sizeof(Selection) + pool_slot_count * sizeof(u32) * 2;
+    memory_size += settings->max_primitives * sizeof(Primitive);
+    memory_size += settings->max_meshes     * (sizeof(Mesh) + sizeof(MeshLoad));
+    memory_size += settings->max_curves     * (sizeof(Curve) + sizeof(vec3) * CURVE_STEPS);
+    memory_size += settings->max_boxes      * sizeof(Box);
+    memory_size += settings->max_grids      * sizeof(Grid);
+    memory_size += settings->cameras        * sizeof(Camera);
+    memory_size += getSceneJournalMemorySize(settings);
+
+    return memory_size;
+}
 
 void _initApp(Defaults *defaults, u32* window_content) {
     app->window_content = window_content;
 
+    initJobSystem(&app->platform);
+
     app->is_running = true;
     app->user_data = null;
     app->memory.address = null;
+    app->frame_memory.address = null;
+    app->input_recording.file = null;
+    app->input_recording.frame = 0;
+    app->input_recording.is_recording = false;
+    app->input_recording.is_replaying = false;
+    app->render_on_demand = false;
+    app->needs_redraw = true;
+    app->max_frames_per_second = 0;
+    app->simulation.steps_per_second = SIMULATION__DEFAULT_STEPS_PER_SECOND;
+    initGlyphAtlas();
 
     app->on.sceneReady = null;
     app->on.viewportReady = null;
@@ -187,6 +433,8 @@ void _initApp(Defaults *defaults, u32* window_content) {
     app->on.mousePositionSet = null;
     app->on.mouseMovementSet = null;
     app->on.mouseRawMovementSet = null;
+    app->on.update = null;
+    app->on.render = null;
 
     defaults->title = (char*)"";
     defaults->width = 480;
@@ -205,14 +453,8 @@ void _initApp(Defaults *defaults, u32* window_content) {
     initMouse(&app->controls.mouse);
     initApp(defaults);
 
-    u64 memory_size = sizeof(Selection) + defaults->additional_memory_size;
-    memory_size += scene_settings->primitives * sizeof(Primitive);
-    memory_size += scene_settings->meshes     * sizeof(Mesh);
-    memory_size += scene_settings->curves     * sizeof(Curve);
-    memory_size += scene_settings->boxes      * sizeof(Box);
-    memory_size += scene_settings->grids      * sizeof(Grid);
-    memory_size += scene_settings->cameras    * sizeof(Camera);
-    memory_size += viewport_settings->hud_line_count * sizeof(HUDLine);
+    u64 memory_size = getSceneMemorySize(scene_settings) + defaults->additional_memory_size;
+    memory_size += viewport_settings->hud_line_count * (sizeof(HUDLine) + sizeof(HUDRun) * HUD__MAX_LINE_RUNS);
 
     u32 max_triangle_count = CUBE__TRIANGLE_COUNT;
     u32 max_vertex_count = CUBE__VERTEX_COUNT;
@@ -228,21 +470,27 @@ void _initApp(Defaults *defaults, u32* window_content) {
     }
 
     memory_size += FRAME_BUFFER_MEMORY_SIZE;
+    if (isSimulating(&app->on)) memory_size += getSimulationMemorySize(scene_settings);
 
     initAppMemory(memory_size);
 
     PixelQuad *pixels = (PixelQuad*)allocateAppMemory(FRAME_BUFFER_MEMORY_SIZE);
     initScene(&app->scene, scene_settings, &app->memory, &app->platform);
     if (app->on.sceneReady) app->on.sceneReady(&app->scene);
+    if (isSimulating(&app->on)) initSimulation(&app->simulation, &app->scene.settings, &app->memory);
 
-    if (viewport_settings->hud_line_count)
+    if (viewport_settings->hud_line_count) {
         viewport_settings->hud_lines = (HUDLine*)allocateAppMemory(viewport_settings->hud_line_count * sizeof(HUDLine));
+        viewport_settings->hud_runs  = (HUDRun* )allocateAppMemory(viewport_settings->hud_line_count * sizeof(HUDRun) * HUD__MAX_LINE_RUNS);
+    }
 
     initViewport(&app->viewport, viewport_settings, navigation_settings, app->scene.cameras, pixels);
     if (app->on.viewportReady) app->on.viewportReady(&app->viewport);
 }
 
-#ifdef __linux__
+#ifdef SLIM_ENGINE_HEADLESS
+#include "./platforms/headless.h"
+#elif __linux__
 //linux code goes here
 #elif _WIN32
 #include "./platforms/win32.h"
@@ -26,6 +26,30 @@
     #define INLINE inline
 #endif
 
+#if defined(COMPILER_MSVC)
+#define THREAD_LOCAL __declspec(thread)
+#elif defined(__cplusplus)
+#define THREAD_LOCAL thread_local
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Atomic operations on 32-bit values shared between threads (acquiring on loads and releasing on stores):
+#ifdef COMPILER_MSVC
+#include <intrin.h>
+#define ATOMIC_ADD(value, amount) (_InterlockedExchangeAdd((volatile long*)(value), (long)(amount)) + (long)(amount))
+#define ATOMIC_LOAD(value) _InterlockedOr((volatile long*)(value), 0)
+#define ATOMIC_STORE(value, new_value) _InterlockedExchange((volatile long*)(value), (long)(new_value))
+#define ATOMIC_TRY_LOCK(lock) (_InterlockedExchange((volatile long*)(lock), 1) == 0)
+#define ATOMIC_UNLOCK(lock) _InterlockedExchange((volatile long*)(lock), 0)
+#else
+#define ATOMIC_ADD(value, amount) __atomic_add_fetch((value), (amount), __ATOMIC_ACQ_REL)
+#define ATOMIC_LOAD(value) __atomic_load_n((value), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(value, new_value) __atomic_store_n((value), (new_value), __ATOMIC_RELEASE)
+#define ATOMIC_TRY_LOCK(lock) (__atomic_exchange_n((lock), 1, __ATOMIC_ACQUIRE) == 0)
+#define ATOMIC_UNLOCK(lock) __atomic_store_n((lock), 0, __ATOMIC_RELEASE)
+#endif
+
 #ifdef COMPILER_CLANG
 #define ENABLE_FP_CONTRACT \
         _Pragma("clang diagnostic push") \
@@ -55,10 +79,10 @@ ENABLE_FP_CONTRACT
 
 typedef unsigned char      u8;
 typedef unsigned short     u16;
-typedef unsigned long int  u32;
+typedef unsigned int       u32;
 typedef unsigned long long u64;
 typedef signed   short     i16;
-typedef signed   long int  i32;
+typedef signed   int       i32;
 
 typedef float  f32;
 typedef double f64;
@@ -72,11 +96,13 @@ typedef double f64;
 #endif
 
 typedef void* (*CallbackWithInt)(u64 size);
+typedef bool (*CallbackForMemoryCommit)(void *address, u64 size);
 typedef void (*CallbackWithBool)(bool on);
 typedef void (*CallbackWithCharPtr)(char* str);
 
 #define TAU 6.28f
 #define SQRT2_OVER_2 0.70710678118f
+#define SQRT2 1.41421356237f
 #define SQRT3 1.73205080757f
 #define COLOR_COMPONENT_TO_FLOAT 0.00392156862f
 #define FLOAT_TO_COLOR_COMPONENT 255.0f
@@ -92,13 +118,22 @@ typedef void (*CallbackWithCharPtr)(char* str);
 #define BOX__VERTEX_COUNT 8
 #define BOX__EDGE_COUNT 12
 #define GRID__MAX_SEGMENTS 101
+#define GRID__FADE_BANDS 8
+#define GRID__MAX_CLIPPED_VERTICES 10
+#define GRID__MAX_LINE_POSITION 16777216.0f
+#define CURVE_STEPS 3600
+#define CURVE__MIN_STEPS 16
+#define CURVE__STEPS_GRANULARITY 16
 
 #define IS_VISIBLE ((u8)1)
 #define IS_TRANSLATED ((u8)2)
 #define IS_ROTATED ((u8)4)
 #define IS_SCALED ((u8)8)
 #define IS_SCALED_NON_UNIFORMLY ((u8)16)
-#define ALL_FLAGS (IS_VISIBLE | IS_TRANSLATED | IS_ROTATED | IS_SCALED | IS_SCALED_NON_UNIFORMLY)
+#define IS_DIRTY ((u8)32)
+#define ALL_FLAGS (IS_VISIBLE | IS_TRANSLATED | IS_ROTATED | IS_SCALED | IS_SCALED_NON_UNIFORMLY | IS_DIRTY)
+
+#define XFORM3__DIRTY_ROTATION ((u8)1)
 
 #define CAMERA_DEFAULT__FOCAL_LENGTH 2.0f
 #define CAMERA_DEFAULT__TARGET_DISTANCE 10
@@ -114,6 +149,58 @@ typedef void (*CallbackWithCharPtr)(char* str);
 
 #define VIEWPORT_DEFAULT__NEAR_CLIPPING_PLANE_DISTANCE 0.001f
 #define VIEWPORT_DEFAULT__FAR_CLIPPING_PLANE_DISTANCE 1000.0f
+#define VIEWPORT_DEFAULT__CURVE_TOLERANCE 0.5f
+#define VIEWPORT_DEFAULT__MIN_RESOLUTION_SCALE 0.25f
+
+#define VIEWPORT_SCALING__STEP 0.0625f
+#define VIEWPORT_SCALING__SMOOTHING 0.25f
+#define VIEWPORT_SCALING__SETTLE_FRAMES 8
+#define VIEWPORT_SCALING__TOLERANCE 0.1f
+#define VIEWPORT_SCALING__ANTIALIAS_HEADROOM 2.5f
+
+#define PROFILER__MAX_SCOPES 32
+#define PROFILER__MAX_DEPTH 16
+#define PROFILER__MAX_EVENTS 4096
+#define PROFILER__FRAME_HISTORY 64
+#define PROFILER__TEXT_LENGTH 64
+#define PROFILER__TRACE_EVENT_ROOM 128
+#define PROFILER__NO_SCOPE 0xFFFFFFFF
+
+#define HUD__MAX_LINE_RUNS 1024
+
+#define TIMER__MAX_DELTA_TIME 0.1f
+
+#define PARALLEL__MAX_THREADS 32
+#define PARALLEL__MIN_BAND_HEIGHT 32
+
+#define JOBS__DEQUE_CAPACITY 256
+
+#define COMPOSITOR__MAX_VIEWPORTS 8
+
+#define SIMULATION__DEFAULT_STEPS_PER_SECOND 60
+#define SIMULATION__MAX_STEPS_PER_UPDATE 8
+
+#define INPUT_RECORDING__MAGIC 0x52494C53 // "SLIR"
+#define INPUT_RECORDING__VERSION 1
+
+#define SCENE_FILE__MAGIC 0x43534C53 // "SLSC"
+#define SCENE_FILE__VERSION 2
+#define SCENE_FILE__ALIGNMENT 16
+#define SCENE_FILE__MAX_SECTIONS 16
+#define SCENE_FILE__SECTION_TYPES 7 // See SceneFileSectionType
+#define SCENE_FILE__JOURNAL_MAGIC 0x4A4C534C // "SLJL"
+#define SCENE_FILE__MAX_JOURNAL_ENTRIES 32
+
+#define POOL__INVALID_INDEX 0xFFFFFFFF
+
+// Rasterizer statistics are compiled in only when SLIM_ENGINE_RASTERIZER_STATS is defined (before including SlimEngine).
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+#define COUNT_RASTERIZER_STAT(viewport, stat) ((viewport)->stats.stat++)
+#define ADD_RASTERIZER_STAT(viewport, stat, amount) ((viewport)->stats.stat += (amount))
+#else
+#define COUNT_RASTERIZER_STAT(viewport, stat)
+#define ADD_RASTERIZER_STAT(viewport, stat, amount)
+#endif
 
 typedef struct u8_3 { u8 x, y, z; } u8_3;
 typedef struct vec2i { i32 x, y; } vec2i;
@@ -124,11 +211,13 @@ typedef union vec4 { struct {f32 x, y, z, w;  }; struct {f32 r, g, b, a; }; stru
 typedef union mat2 { struct {vec2 X, Y;       }; vec2 axis[2]; } mat2;
 typedef union mat3 { struct {vec3 X, Y, Z;    }; vec3 axis[3]; } mat3;
 typedef union mat4 { struct {vec4 X, Y, Z, W; }; vec4 axis[4]; } mat4;
+typedef union mat3x4 { struct {vec3 X, Y, Z, W; }; vec3 axis[4]; } mat3x4;
 typedef struct AABB { vec3 min, max;   } AABB;
 typedef struct quat { vec3 axis; f32 amount; } quat;
 typedef struct Edge { vec3 from, to;  } Edge;
 typedef struct Rect { vec2i min, max; } Rect;
 typedef struct RGBA { u8 B, G, R, A; } RGBA;
+typedef union RGBA2u32 { RGBA rgba; u32 value; } RGBA2u32;
 typedef struct Pixel { vec3 color; f32 opacity; f64 depth; } Pixel;
 typedef union PixelQuad { Pixel quad[2][2]; struct { Pixel TL, TR, BL, BR; }; } PixelQuad;
 
@@ -195,28 +284,78 @@ f32 smoothstep(f32 from, f32 to, f32 t) {
 
 #define MEMORY_SIZE Gigabytes(1)
 #define MEMORY_BASE Terabytes(2)
-
+#define MEMORY__RESERVE_SIZE Gigabytes(16)
+#define MEMORY__COMMIT_GRANULARITY Megabytes(1)
+#define MEMORY__PAGE_SIZE Kilobytes(4)
+#define MEMORY__LARGE_PAGE_SIZE Megabytes(2)
+#define FRAME_MEMORY__RESERVE_SIZE Megabytes(256)
+
+// A memory arena: Allocations bump the address forward, and are freed in bulk by popping back to a marker.
+// When initialized with a commit callback, the capacity is only reserved (as virtual address space) up front,
+// and gets committed on demand in MEMORY__COMMIT_GRANULARITY increments as allocations grow past the committed size.
 typedef struct Memory {
     u8* address;
-    u64 occupied, capacity;
+    u64 occupied, committed, capacity;
+    CallbackForMemoryCommit commit;
 } Memory;
 
+typedef u64 MemoryMarker;
+
 void initMemory(Memory *memory, u8* address, u64 capacity) {
     memory->address = (u8*)address;
     memory->capacity = capacity;
+    memory->committed = capacity;
     memory->occupied = 0;
+    memory->commit = null;
+}
+
+void initGrowableMemory(Memory *memory, u8* reserved_address, u64 reserved_capacity, CallbackForMemoryCommit commit) {
+    initMemory(memory, reserved_address, reserved_capacity);
+    memory->committed = 0;
+    memory->commit = commit;
+}
+
+bool commitMemory(Memory *memory, u64 size) {
+    if (size <= memory->committed) return true;
+    if (!memory->commit) return false;
+
+    size += MEMORY__COMMIT_GRANULARITY - 1;
+    size -= size % MEMORY__COMMIT_GRANULARITY;
+    if (size > memory->capacity) size = memory->capacity;
+
+    u8 *base_address = memory->address - memory->occupied;
+    if (!memory->commit(base_address + memory->committed, size - memory->committed)) return false;
+
+    memory->committed = size;
+    return true;
 }
 
 void* allocateMemory(Memory *memory, u64 size) {
     if (!memory->address) return null;
-    memory->occupied += size;
-    if (memory->occupied > memory->capacity) return null;
+    if (size > memory->capacity - memory->occupied) return null;
+    if (!commitMemory(memory, memory->occupied + size)) return null;
 
+    memory->occupied += size;
     void* address = memory->address;
     memory->address += size;
     return address;
 }
 
+INLINE MemoryMarker pushMemoryMarker(Memory *memory) {
+    return memory->occupied;
+}
+
+INLINE void popMemoryMarker(Memory *memory, MemoryMarker marker) {
+    if (!memory->address || marker > memory->occupied) return;
+
+    memory->address -= memory->occupied - marker;
+    memory->occupied = marker;
+}
+
+INLINE void resetMemory(Memory *memory) {
+    popMemoryMarker(memory, 0);
+}
+
 typedef struct MouseButton {
     vec2i down_pos, up_pos, double_click_pos;
     bool is_pressed, is_handled;
@@ -507,11 +646,22 @@ typedef struct NumberString {
     String string;
 } NumberString;
 
+// A horizontal run of opaque pixels of the HUD, already resolved to the window content's format:
+typedef struct HUDRun {
+    u16 x, y, length;
+    u32 value;
+} HUDRun;
+
 typedef struct HUDLine {
     String title, alternate_value;
     NumberString value;
     enum ColorID title_color, value_color, alternate_value_color;
     bool invert_alternate_use, *use_alternate;
+
+    // The line as it was last rendered into the HUD's retained overlay (see viewport/hud.h):
+    HUDRun *runs;
+    u32 run_count;
+    u64 rendered_key;
 } HUDLine;
 
 typedef struct HUD {
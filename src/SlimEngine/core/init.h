@@ -1,6 +1,7 @@
 #pragma once
 
 #include "./types.h"
+#include "./profiler.h"
 #include "../scene/cube.h"
 
 void initNumberString(NumberString *number_string) {
@@ -87,6 +88,8 @@ void initTime(Time *time, GetTicks getTicks, u64 ticks_per_second) {
     initTimer(&time->timers.aux,    getTicks, &time->ticks);
 
     time->timers.update.ticks_before = time->timers.update.ticks_of_last_report = getTicks();
+
+    initProfiler(getTicks, &time->ticks);
 }
 
 void initXform3(xform3 *xform) {
@@ -94,7 +97,7 @@ void initXform3(xform3 *xform) {
     I.X.x = 1; I.Y.x = 0; I.Z.x = 0;
     I.X.y = 0; I.Y.y = 1; I.Z.y = 0;
     I.X.z = 0; I.Y.z = 0; I.Z.z = 1;
-    xform->matrix = xform->yaw_matrix = xform->pitch_matrix = xform->roll_matrix = xform->rotation_matrix = xform->rotation_matrix_inverted = I;
+    xform->yaw_matrix = xform->pitch_matrix = xform->roll_matrix = xform->rotation_matrix = I;
     xform->right_direction   = &xform->rotation_matrix.X;
     xform->up_direction      = &xform->rotation_matrix.Y;
     xform->forward_direction = &xform->rotation_matrix.Z;
@@ -109,6 +112,7 @@ void initXform3(xform3 *xform) {
     xform->rotation.axis.z = 0;
     xform->rotation.amount = 1;
     xform->rotation_inverted = xform->rotation;
+    xform->dirty = 0;
 }
 
 void initCamera(Camera* camera) {
@@ -157,7 +161,7 @@ void initBox(Box *box) {
     setBoxEdgesFromVertices(&box->edges, &box->vertices);
 }
 
-void initHUD(HUD *hud, HUDLine *lines, u32 line_count, f32 line_height, enum ColorID default_color, i32 position_x, i32 position_y) {
+void initHUD(HUD *hud, HUDLine *lines, HUDRun *runs, u32 line_count, f32 line_height, enum ColorID default_color, i32 position_x, i32 position_y) {
     hud->lines = lines;
     hud->line_count = line_count;
     hud->line_height = line_height;
@@ -173,6 +177,9 @@ void initHUD(HUD *hud, HUDLine *lines, u32 line_count, f32 line_height, enum Col
             initNumberString(&line->value);
             line->title.char_ptr = line->alternate_value.char_ptr = (char*)("");
             line->title.length = line->alternate_value.length = 0;
+            line->runs = runs ? runs + i * HUD__MAX_LINE_RUNS : null;
+            line->run_count = 0;
+            line->rendered_key = 0;
         }
     }
 }
@@ -208,13 +215,18 @@ void initNavigation(Navigation *navigation, NavigationSettings *navigation_setti
 void setDefaultViewportSettings(ViewportSettings *settings) {
     settings->near_clipping_plane_distance = VIEWPORT_DEFAULT__NEAR_CLIPPING_PLANE_DISTANCE;
     settings->far_clipping_plane_distance  = VIEWPORT_DEFAULT__FAR_CLIPPING_PLANE_DISTANCE;
+    settings->curve_tolerance = VIEWPORT_DEFAULT__CURVE_TOLERANCE;
     settings->hud_default_color = White;
     settings->hud_line_count = 0;
     settings->hud_lines = null;
+    settings->hud_runs = null;
     settings->show_hud = false;
     settings->use_cube_NDC = false;
     settings->flip_z = false;
     settings->antialias = false;
+    settings->dynamic_antialias = false;
+    settings->target_microseconds_per_frame = 0;
+    settings->min_resolution_scale = VIEWPORT_DEFAULT__MIN_RESOLUTION_SCALE;
     settings->background.color = Color(Black);
     settings->background.opacity = 0;
     settings->background.depth = INFINITY;
@@ -245,13 +257,48 @@ void initViewport(Viewport *viewport, ViewportSettings *viewport_settings, Navig
     viewport->settings = *viewport_settings;
     viewport->position.x = 0;
     viewport->position.y = 0;
+    viewport->band_top = 0;
+    viewport->band_bottom = 0;
+    viewport->has_prepared_curves = false;
+    viewport->scaling.width  = MAX_WIDTH;
+    viewport->scaling.height = MAX_HEIGHT;
+    viewport->scaling.scale = 1;
+    viewport->scaling.frame_time = 0;
+    viewport->scaling.settle_frames = 0;
+    viewport->scaling.dropped_antialias = false;
     initBox(&viewport->default_box);
-    initHUD(&viewport->hud, viewport_settings->hud_lines, viewport_settings->hud_line_count, 1, viewport_settings->hud_default_color, 0, 0);
+    initHUD(&viewport->hud, viewport_settings->hud_lines, viewport_settings->hud_runs, viewport_settings->hud_line_count, 1, viewport_settings->hud_default_color, 0, 0);
     initNavigation(&viewport->navigation, navigation_settings);
     setProjectionMatrix(viewport);
     updateDimensions(&viewport->dimensions, MAX_WIDTH, MAX_HEIGHT, MAX_WIDTH);
 }
 
+// Sets the internal resolution of the viewport, relative to its size in the window:
+void setViewportResolutionScale(Viewport *viewport, f32 scale) {
+    if (scale > 1) scale = 1;
+    if (scale < VIEWPORT_SCALING__STEP) scale = VIEWPORT_SCALING__STEP;
+    viewport->scaling.scale = scale;
+
+    u16 width  = viewport->scaling.width;
+    u16 height = viewport->scaling.height;
+    if (scale != 1) {
+        width  = (u16)((f32)width  * scale + 0.5f);
+        height = (u16)((f32)height * scale + 0.5f);
+        if (!width)  width  = 1;
+        if (!height) height = 1;
+    }
+    updateDimensions(&viewport->dimensions, width, height, viewport->dimensions.stride);
+    setProjectionMatrix(viewport);
+}
+
+// Sets the size of the viewport in the window (with the stride of the frame buffer), keeping its resolution scale:
+void resizeViewport(Viewport *viewport, u16 width, u16 height, u16 stride) {
+    viewport->scaling.width  = width;
+    viewport->scaling.height = height;
+    viewport->dimensions.stride = stride;
+    setViewportResolutionScale(viewport, viewport->scaling.scale);
+}
+
 void setDefaultSceneSettings(SceneSettings *settings) {
     settings->cameras = 1;
     settings->primitives = 0;
@@ -259,13 +306,41 @@ void setDefaultSceneSettings(SceneSettings *settings) {
     settings->boxes = 0;
     settings->grids = 0;
     settings->meshes = 0;
+    settings->max_primitives = 0;
+    settings->max_meshes = 0;
+    settings->max_curves = 0;
+    settings->max_boxes = 0;
+    settings->max_grids = 0;
     settings->mesh_files = null;
     settings->file.char_ptr = null;
     settings->file.length = 0;
 }
+
+// Scene object pools can hold at least as many objects as the scene starts with:
+void setScenePoolCapacities(SceneSettings *settings) {
+    if (settings->max_primitives < settings->primitives) settings->max_primitives = settings->primitives;
+    if (settings->max_meshes     < settings->meshes)     settings->max_meshes     = settings->meshes;
+    if (settings->max_curves     < settings->curves)     settings->max_curves     = settings->curves;
+    if (settings->max_boxes      < settings->boxes)      settings->max_boxes      = settings->boxes;
+    if (settings->max_grids      < settings->grids)      settings->max_grids      = settings->grids;
+}
+
+void initMesh(Mesh *mesh) {
+    mesh->aabb.min.x = mesh->aabb.min.y = mesh->aabb.min.z = 0;
+    mesh->aabb.max.x = mesh->aabb.max.y = mesh->aabb.max.z = 0;
+    mesh->vertex_positions = mesh->vertex_normals = null;
+    mesh->vertex_uvs = null;
+    mesh->vertex_position_indices = mesh->vertex_normal_indices = mesh->vertex_uvs_indices = null;
+    mesh->edge_vertex_indices = null;
+    mesh->triangle_count = mesh->vertex_count = mesh->edge_count = mesh->normals_count = mesh->uvs_count = 0;
+    mesh->triangle_capacity = mesh->vertex_capacity = mesh->edge_capacity = mesh->normals_capacity = mesh->uvs_capacity = 0;
+    mesh->is_loading = false;
+}
 void initCurve(Curve *curve) {
     curve->thickness = 0.1f;
     curve->revolution_count = 1;
+    curve->point_count = 0;
+    curve->points_viewport = null;
 }
 
 void initPrimitive(Primitive *primitive) {
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "./types.h"
+
+// A pool of threads that run jobs, shared by all of the work that the app splits across threads (see Platform):
+//
+// Each thread has a deque of jobs. Jobs are added to the deque of the adding thread, from which that thread takes
+// the most recently added job first, while idle threads steal the oldest jobs of other threads' deques.
+// A thread that waits for jobs runs jobs itself until they are done (so jobs can add jobs and wait for them in turn).
+// Threads that are not in the pool (like the main thread) share the first deque.
+//
+// A job calls a function for a range of indices (see CallbackForParallelWork), and counts itself as finished on a
+// counter that was given when adding it. Waiting on a counter waits for all of the jobs that were added against it,
+// so dependencies are expressed by waiting on the counter of the jobs that other jobs depend on before adding them.
+//
+// The threads are started by the platform (see Platform.startThread) and sleep on a semaphore while there are no jobs,
+// until the job system is shut down (see shutDownJobSystem).
+// Without them (or when asked for a single thread) all jobs run on the thread that waits for them.
+JobSystem job_system;
+THREAD_LOCAL u32 job_thread_index = 0;
+
+INLINE void lockJobDeque(JobDeque *deque) {
+    while (!ATOMIC_TRY_LOCK(&deque->lock))
+        while (ATOMIC_LOAD(&deque->lock));
+}
+
+bool pushJob(JobDeque *deque, Job *job) {
+    lockJobDeque(deque);
+    u32 bottom = deque->bottom;
+    bool pushed = bottom - deque->top < JOBS__DEQUE_CAPACITY;
+    if (pushed) {
+        deque->jobs[bottom % JOBS__DEQUE_CAPACITY] = *job;
+        ATOMIC_STORE(&deque->bottom, bottom + 1);
+    }
+    ATOMIC_UNLOCK(&deque->lock);
+
+    return pushed;
+}
+
+// Takes the newest job of the deque (as its own thread does) or its oldest one (when stealing):
+bool popJob(JobDeque *deque, Job *job, bool steal) {
+    if (ATOMIC_LOAD(&deque->top) == ATOMIC_LOAD(&deque->bottom)) return false;
+
+    lockJobDeque(deque);
+    u32 top = deque->top;
+    u32 bottom = deque->bottom;
+    bool popped = top != bottom;
+    if (popped) {
+        if (steal) {
+            *job = deque->jobs[top % JOBS__DEQUE_CAPACITY];
+            ATOMIC_STORE(&deque->top, top + 1);
+        } else {
+            *job = deque->jobs[--bottom % JOBS__DEQUE_CAPACITY];
+            ATOMIC_STORE(&deque->bottom, bottom);
+        }
+    }
+    ATOMIC_UNLOCK(&deque->lock);
+
+    return popped;
+}
+
+INLINE void runJob(Job *job) {
+    for (u32 index = job->first; index < job->end; index++) job->work(job->data, index);
+    ATOMIC_ADD(&job->counter->pending, -1);
+}
+
+// Runs a job from the calling thread's own deque, or one that is stolen from another thread (returning false if none):
+bool runNextJob() {
+    Job job;
+    u32 thread_count = ATOMIC_LOAD(&job_system.thread_count);
+    bool found = popJob(job_system.deques + job_thread_index, &job, false);
+    for (u32 i = 1; !found && i < thread_count; i++)
+        found = popJob(job_system.deques + (job_thread_index + i) % thread_count, &job, true);
+    if (found) runJob(&job);
+
+    return found;
+}
+
+void _runJobThread(void *data) {
+    job_thread_index = (u32)((JobDeque*)data - job_system.deques);
+    while (!ATOMIC_LOAD(&job_system.is_stopping))
+        if (!runNextJob())
+            job_system.waitForSemaphore(job_system.semaphore);
+}
+
+// Adds jobs calling work(data, index) for every index in [0, count), each for a range of the given number of indices:
+void addJobs(CallbackForParallelWork work, void *data, u32 count, u32 indices_per_job, JobCounter *counter) {
+    if (!count) return;
+    if (!indices_per_job) indices_per_job = 1;
+
+    u32 job_count = (count + indices_per_job - 1) / indices_per_job;
+    ATOMIC_ADD(&counter->pending, (i32)job_count);
+
+    Job job;
+    job.work = work;
+    job.data = data;
+    job.counter = counter;
+    JobDeque *deque = job_system.deques + job_thread_index;
+    for (u32 first = 0; first < count; first += indices_per_job) {
+        job.first = first;
+        job.end = count - first > indices_per_job ? first + indices_per_job : count;
+        if (!pushJob(deque, &job)) runJob(&job); // A job that does not fit in the deque is run right away instead
+    }
+
+    if (job_system.thread_count > 1)
+        job_system.signalSemaphore(job_system.semaphore, job_count < job_system.thread_count - 1 ? job_count : job_system.thread_count - 1);
+}
+
+void waitForJobs(JobCounter *counter) {
+    while (ATOMIC_LOAD(&counter->pending) > 0)
+        if (!runNextJob() && job_system.yieldThread)
+            job_system.yieldThread();
+}
+
+void parallelFor(CallbackForParallelWork work, void *data, u32 count, u32 indices_per_job) {
+    JobCounter counter;
+    counter.pending = 0;
+    addJobs(work, data, count, indices_per_job, &counter);
+    waitForJobs(&counter);
+}
+
+void runJobsInParallel(CallbackForParallelWork work, void *data, u32 count) {
+    parallelFor(work, data, count, 1);
+}
+
+// Starts the platform's threads (up to its thread count, including the calling thread), and has the platform's
+// runInParallel run its work as jobs on them. The thread count is then that of the threads that were started.
+void initJobSystem(Platform *platform) {
+    for (u32 i = 0; i < PARALLEL__MAX_THREADS; i++) {
+        JobDeque *deque = job_system.deques + i;
+        deque->top = deque->bottom = 0;
+        deque->lock = 0;
+    }
+    job_system.thread_count = 1;
+    job_system.is_stopping = false;
+    job_system.signalSemaphore  = platform->signalSemaphore;
+    job_system.waitForSemaphore = platform->waitForSemaphore;
+    job_system.yieldThread      = platform->yieldThread;
+    job_system.semaphore = (
+        platform->startThread &&
+        platform->createSemaphore &&
+        platform->signalSemaphore &&
+        platform->waitForSemaphore
+    ) ? platform->createSemaphore() : null;
+
+    if (job_system.semaphore)
+        for (u32 i = 1; i < platform->thread_count && i < PARALLEL__MAX_THREADS; i++) {
+            ATOMIC_STORE(&job_system.thread_count, i + 1);
+            if (!platform->startThread(_runJobThread, job_system.deques + i)) {
+                ATOMIC_STORE(&job_system.thread_count, i);
+                break;
+            }
+        }
+
+    platform->runInParallel = runJobsInParallel;
+    platform->thread_count = job_system.thread_count;
+}
+
+// Stops the threads (each once it is done with its current job), and waits for them and any other threads of the
+// platform (like the one loading meshes) to return. Jobs that are added afterwards run on the thread that waits for them.
+void shutDownJobSystem(Platform *platform) {
+    u32 thread_count = ATOMIC_LOAD(&job_system.thread_count);
+    if (thread_count > 1) {
+        ATOMIC_STORE(&job_system.is_stopping, true);
+        job_system.signalSemaphore(job_system.semaphore, thread_count - 1);
+    }
+    if (platform->joinThreads) platform->joinThreads();
+
+    ATOMIC_STORE(&job_system.thread_count, 1);
+    platform->thread_count = 1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "./types.h"
+
+// Fixed-capacity pools of slots with a free list, for objects that are added and removed at runtime.
+// The pool only tracks which slots are in use - the objects themselves live in a separate array of the same
+// capacity that is allocated once up front, so adding and removing objects never reallocates or fragments memory.
+// Freed slots are reused (most recently freed first) before any slot that was never used.
+
+void initObjectPool(ObjectPool *pool, u32 capacity, u32 initial_count, Memory *memory) {
+    pool->capacity = pool->count = 0;
+    pool->first_free = POOL__INVALID_INDEX;
+    pool->generations = pool->next_free = null;
+    if (!capacity) return;
+
+    pool->generations = (u32*)allocateMemory(memory, sizeof(u32) * capacity);
+    pool->next_free   = (u32*)allocateMemory(memory, sizeof(u32) * capacity);
+    if (!pool->generations || !pool->next_free) return;
+
+    if (initial_count > capacity) initial_count = capacity;
+    pool->capacity = capacity;
+    pool->count = initial_count;
+    pool->first_free = initial_count == capacity ? POOL__INVALID_INDEX : initial_count;
+    for (u32 i = 0; i < capacity; i++) {
+        pool->generations[i] = i < initial_count ? 1 : 0;
+        pool->next_free[i] = i + 1 < capacity ? i + 1 : POOL__INVALID_INDEX;
+    }
+}
+
+INLINE bool isPoolSlotActive(ObjectPool *pool, u32 index) {
+    return index < pool->capacity && pool->generations[index] & 1;
+}
+
+INLINE bool isValidObjectHandle(ObjectPool *pool, ObjectHandle handle) {
+    return isPoolSlotActive(pool, handle.index) && pool->generations[handle.index] == handle.generation;
+}
+
+INLINE ObjectHandle getObjectHandle(ObjectPool *pool, u32 index) {
+    ObjectHandle handle;
+    handle.index = isPoolSlotActive(pool, index) ? index : POOL__INVALID_INDEX;
+    handle.generation = handle.index == POOL__INVALID_INDEX ? 0 : pool->generations[index];
+    return handle;
+}
+
+// Returns a handle with an index of POOL__INVALID_INDEX when the pool is full.
+ObjectHandle allocatePoolSlot(ObjectPool *pool) {
+    ObjectHandle handle;
+    handle.index = pool->first_free;
+    handle.generation = 0;
+    if (handle.index == POOL__INVALID_INDEX) return handle;
+
+    pool->first_free = pool->next_free[handle.index];
+    pool->next_free[handle.index] = POOL__INVALID_INDEX;
+    handle.generation = ++pool->generations[handle.index];
+    pool->count++;
+
+    return handle;
+}
+
+bool freePoolSlot(ObjectPool *pool, ObjectHandle handle) {
+    if (!isValidObjectHandle(pool, handle)) return false;
+
+    pool->generations[handle.index]++;
+    pool->next_free[handle.index] = pool->first_free;
+    pool->first_free = handle.index;
+    pool->count--;
+
+    return true;
+}
+
+// Resets the pool to having its first slots in use (as when the objects in them were replaced, by loading a scene).
+// Every slot's generation is bumped, so handles from before the reset go stale even for slots that are still in use.
+void resetObjectPool(ObjectPool *pool, u32 count) {
+    if (!pool->capacity) return;
+    if (count > pool->capacity) count = pool->capacity;
+
+    pool->count = count;
+    pool->first_free = count == pool->capacity ? POOL__INVALID_INDEX : count;
+    for (u32 i = 0; i < pool->capacity; i++) {
+        pool->generations[i] = i < count ? (pool->generations[i] + 2) | 1 : (pool->generations[i] + 1) & ~1u;
+        pool->next_free[i] = i < count || i + 1 == pool->capacity ? POOL__INVALID_INDEX : i + 1;
+    }
+}
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "./types.h"
+
+// Scoped instrumentation is compiled in only when SLIM_ENGINE_PROFILER is defined (before including SlimEngine).
+// Scopes nest, so a scope opened while another one is open is recorded as it's child:
+//
+//    PROFILE_BEGIN("drawScene");
+//        ...
+//    PROFILE_END();
+//
+// Or for a block:
+//
+//    PROFILE_SCOPE("drawScene") {
+//        ...
+//    }
+//
+// Note: Returning out of an open scope (in either form) leaves it unbalanced.
+//
+// The profiler is not thread-safe: Scopes are ignored while it is paused, as it is while work runs on multiple threads.
+// Scopes are also ignored on a thread that sets profiler_ignores_this_thread, like the update thread of an app that
+// renders on another thread (see core/simulation.h), so that only the rendering thread is profiled.
+#ifdef SLIM_ENGINE_PROFILER
+#define PROFILE_BEGIN(name) beginProfileScope((char*)(name))
+#define PROFILE_END() endProfileScope()
+#define PROFILE_SCOPE(name) for (bool _profile_scope_open_ = beginProfileScope((char*)(name)); _profile_scope_open_; _profile_scope_open_ = endProfileScope())
+#else
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#define PROFILE_SCOPE(name)
+#endif
+
+Profiler profiler;
+THREAD_LOCAL bool profiler_ignores_this_thread = false;
+
+void initProfiler(GetTicks getTicks, Ticks *ticks) {
+    profiler.getTicks = getTicks;
+    profiler.ticks = ticks;
+    profiler.frame_count = 0;
+    profiler.event_count = 0;
+    profiler.scope_count = 0;
+    profiler.depth = 0;
+    profiler.paused = false;
+}
+
+INLINE bool isSameProfileScopeName(char *a, char *b) {
+    if (a == b) return true;
+    while (*a && *a == *b) { a++; b++; }
+    return *a == *b;
+}
+
+u32 getProfileScope(char *name, u32 parent) {
+    ProfileScope *scope = profiler.scopes;
+    for (u32 i = 0; i < profiler.scope_count; i++, scope++)
+        if (scope->parent == parent && isSameProfileScopeName(scope->name, name))
+            return i;
+
+    if (profiler.scope_count == PROFILER__MAX_SCOPES)
+        return PROFILER__NO_SCOPE;
+
+    scope->name = name;
+    scope->parent = parent;
+    scope->depth = parent == PROFILER__NO_SCOPE ? 0 : profiler.scopes[parent].depth + 1;
+    scope->text[0] = 0;
+    scope->ticks = 0;
+    scope->calls = 0;
+    scope->history_count = 0;
+    scope->history_index = 0;
+    scope->min_microseconds = 0;
+    scope->max_microseconds = 0;
+    scope->average_microseconds = 0;
+
+    return profiler.scope_count++;
+}
+
+bool beginProfileScope(char *name) {
+    if (profiler.paused || profiler_ignores_this_thread) return true;
+
+    if (profiler.getTicks && profiler.depth < PROFILER__MAX_DEPTH) {
+        ProfileEvent *open_scope = profiler.stack + profiler.depth;
+        open_scope->scope = getProfileScope(name, profiler.depth ? profiler.stack[profiler.depth - 1].scope : PROFILER__NO_SCOPE);
+        open_scope->ticks_before = profiler.getTicks();
+    }
+    profiler.depth++;
+
+    return true;
+}
+
+bool endProfileScope() {
+    if (profiler.paused || profiler_ignores_this_thread || !profiler.depth) return false;
+    profiler.depth--;
+    if (!profiler.getTicks || profiler.depth >= PROFILER__MAX_DEPTH) return false;
+
+    ProfileEvent *event = profiler.events + (profiler.event_count++ % PROFILER__MAX_EVENTS);
+    *event = profiler.stack[profiler.depth];
+    event->ticks_after = profiler.getTicks();
+    if (event->scope != PROFILER__NO_SCOPE) {
+        ProfileScope *scope = profiler.scopes + event->scope;
+        scope->ticks += event->ticks_after - event->ticks_before;
+        scope->calls++;
+    }
+
+    return false;
+}
+
+void endProfileFrame() {
+    if (!profiler.ticks) return;
+
+    f64 microseconds_per_tick = profiler.ticks->per_tick.microseconds;
+    ProfileScope *scope = profiler.scopes;
+    for (u32 i = 0; i < profiler.scope_count; i++, scope++) {
+        if (!scope->calls) continue;
+
+        scope->history[scope->history_index++] = scope->ticks;
+        if (scope->history_index == PROFILER__FRAME_HISTORY) scope->history_index = 0;
+        if (scope->history_count < PROFILER__FRAME_HISTORY) scope->history_count++;
+        scope->ticks = 0;
+        scope->calls = 0;
+
+        u64 min_ticks = scope->history[0];
+        u64 max_ticks = scope->history[0];
+        u64 total_ticks = 0;
+        for (u32 h = 0; h < scope->history_count; h++) {
+            if (scope->history[h] < min_ticks) min_ticks = scope->history[h];
+            if (scope->history[h] > max_ticks) max_ticks = scope->history[h];
+            total_ticks += scope->history[h];
+        }
+        scope->min_microseconds     = (f32)(microseconds_per_tick * (f64)min_ticks);
+        scope->max_microseconds     = (f32)(microseconds_per_tick * (f64)max_ticks);
+        scope->average_microseconds = (f32)(microseconds_per_tick * (f64)total_ticks / (f64)scope->history_count);
+    }
+
+    profiler.frame_count++;
+}
+
+u32 writeTextToBuffer(char *text, char *buffer) {
+    u32 length = 0;
+    while (text[length]) {
+        buffer[length] = text[length];
+        length++;
+    }
+    return length;
+}
+
+u32 writeNumberToBuffer(u64 number, char *buffer) {
+    char digits[20];
+    u32 digit_count = 0;
+    do {
+        digits[digit_count++] = (char)('0' + number % 10);
+        number /= 10;
+    } while (number);
+
+    for (u32 i = 0; i < digit_count; i++)
+        buffer[i] = digits[digit_count - 1 - i];
+
+    return digit_count;
+}
+
+void setProfileScopeText(ProfileScope *scope) {
+    char *text = scope->text;
+    u32 name_length = 0;
+    while (scope->name[name_length]) name_length++;
+
+    // The indentation and name share what the timings leave of the text (deep scopes are indented no further):
+    u32 max_length = PROFILER__TEXT_LENGTH - 36;
+    u32 indentation = scope->depth * 2;
+    if (indentation > max_length) indentation = max_length;
+    if (name_length + indentation > max_length)
+        name_length = max_length - indentation;
+
+    for (u32 i = 0; i < indentation; i++) *text++ = ' ';
+    for (u32 i = 0; i < name_length; i++) *text++ = scope->name[i];
+    *text++ = ':';
+    *text++ = ' ';
+    text += writeNumberToBuffer((u64)scope->min_microseconds, text);
+    *text++ = '/';
+    text += writeNumberToBuffer((u64)scope->average_microseconds, text);
+    *text++ = '/';
+    text += writeNumberToBuffer((u64)scope->max_microseconds, text);
+    text += writeTextToBuffer((char*)"us", text);
+    *text = 0;
+}
+
+void setProfilerInHUD(HUD *hud, u32 first_line) {
+    HUDLine *line = hud->lines + first_line;
+    for (u32 i = first_line; i < hud->line_count; i++, line++) {
+        line->value.string.char_ptr = (char*)"";
+        line->value.string.length = 0;
+        if (i - first_line < profiler.scope_count) {
+            ProfileScope *scope = profiler.scopes + (i - first_line);
+            setProfileScopeText(scope);
+            line->title.char_ptr = scope->text;
+            line->title.length = 0;
+            while (scope->text[line->title.length]) line->title.length++;
+        } else {
+            line->title.char_ptr = (char*)"";
+            line->title.length = 0;
+        }
+    }
+}
+
+void writeProfileTicksAsMicroseconds(u64 ticks, char *buffer, u32 *length) {
+    u64 nanoseconds = (u64)((f64)ticks * profiler.ticks->per_tick.nanoseconds);
+    u64 fraction = nanoseconds % 1000;
+    *length += writeNumberToBuffer(nanoseconds / 1000, buffer + *length);
+    buffer[(*length)++] = '.';
+    buffer[(*length)++] = (char)('0' + fraction / 100);
+    buffer[(*length)++] = (char)('0' + (fraction / 10) % 10);
+    buffer[(*length)++] = (char)('0' + fraction % 10);
+}
+
+// Makes room for the given number of characters in the trace's buffer, by writing the buffer to the file if it has to:
+bool _makeRoomInProfilerTrace(char *buffer, u32 *length, u32 capacity, u32 room, void *file, Platform *platform) {
+    if (*length + room <= capacity) return true;
+
+    bool written = platform->writeToFile(buffer, *length, file);
+    *length = 0;
+    return written;
+}
+
+// Writes the recorded events (up to the last PROFILER__MAX_EVENTS of them) in the Chrome trace-event format.
+// The file can be opened in chrome://tracing or https://ui.perfetto.dev for offline analysis.
+bool saveProfilerTraceToFile(char *file_path, Platform *platform) {
+    if (!profiler.ticks) return false;
+
+    void *file = platform->openFileForWriting(file_path);
+    if (!file) return false;
+
+    char buffer[1024];
+    u32 length = writeTextToBuffer((char*)"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", buffer);
+    bool written = true;
+
+    u64 event_count = profiler.event_count < PROFILER__MAX_EVENTS ? profiler.event_count : PROFILER__MAX_EVENTS;
+    u64 first_event = profiler.event_count - event_count;
+    u64 first_ticks = event_count ? profiler.events[first_event % PROFILER__MAX_EVENTS].ticks_before : 0;
+    for (u64 i = first_event; i < profiler.event_count; i++) {
+        ProfileEvent *event = profiler.events + (i % PROFILER__MAX_EVENTS);
+        if (event->scope != PROFILER__NO_SCOPE) {
+            if (event->ticks_before < first_ticks) first_ticks = event->ticks_before;
+        }
+    }
+
+    bool has_events = false;
+    for (u64 i = first_event; i < profiler.event_count && written; i++) {
+        ProfileEvent *event = profiler.events + (i % PROFILER__MAX_EVENTS);
+        if (event->scope == PROFILER__NO_SCOPE) continue;
+
+        // Separate events from the ones before them (skipped events leave no separators behind):
+        written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), PROFILER__TRACE_EVENT_ROOM, file, platform);
+        if (!written) break;
+        if (has_events) buffer[length++] = ',';
+        has_events = true;
+        length += writeTextToBuffer((char*)"{\"name\":\"", buffer + length);
+
+        // The name is escaped as a JSON string, making room for each of its characters (so it can be of any length):
+        for (char *character = profiler.scopes[event->scope].name; *character && written; character++) {
+            written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), 6, file, platform);
+            u8 code = (u8)*character;
+            if (code < 0x20) {
+                length += writeTextToBuffer((char*)"\\u00", buffer + length);
+                buffer[length++] = "0123456789abcdef"[code >> 4];
+                buffer[length++] = "0123456789abcdef"[code & 15];
+            } else {
+                if (code == '"' || code == '\\') buffer[length++] = '\\';
+                buffer[length++] = *character;
+            }
+        }
+        if (written) written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), PROFILER__TRACE_EVENT_ROOM, file, platform);
+        if (!written) break;
+
+        length += writeTextToBuffer((char*)"\",\"cat\":\"SlimEngine\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":", buffer + length);
+        writeProfileTicksAsMicroseconds(event->ticks_before - first_ticks, buffer, &length);
+        length += writeTextToBuffer((char*)",\"dur\":", buffer + length);
+        writeProfileTicksAsMicroseconds(event->ticks_after - event->ticks_before, buffer, &length);
+        buffer[length++] = '}';
+    }
+    if (written) written = _makeRoomInProfilerTrace(buffer, &length, sizeof(buffer), 4, file, platform);
+    length += writeTextToBuffer((char*)"]}\n", buffer + length);
+    if (written) written = platform->writeToFile(buffer, length, file);
+
+    platform->closeFile(file);
+    return written;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "./types.h"
+
+// Input recordings are a small header (magic and version) followed by a stream of events, each stored as:
+// ticks (8 bytes), frame (4), x or amount (4), y (4), type (1) and code (1) - where the code is either the key
+// or the mouse button (0: left, 1: middle, 2: right). Events are tagged with the frame they occurred before,
+// so that a replay can feed them back at the same frame boundaries regardless of the original frame timings.
+
+bool writeInputEvent(InputEvent *event, void *file, Platform *platform) {
+    return (
+        platform->writeToFile(&event->ticks, sizeof(u64), file) &&
+        platform->writeToFile(&event->frame, sizeof(u32), file) &&
+        platform->writeToFile(&event->x,     sizeof(i32), file) &&
+        platform->writeToFile(&event->y,     sizeof(i32), file) &&
+        platform->writeToFile(&event->type,  sizeof(u8),  file) &&
+        platform->writeToFile(&event->code,  sizeof(u8),  file)
+    );
+}
+
+bool readInputEvent(InputEvent *event, void *file, Platform *platform) {
+    return (
+        platform->readFromFile(&event->ticks, sizeof(u64), file) &&
+        platform->readFromFile(&event->frame, sizeof(u32), file) &&
+        platform->readFromFile(&event->x,     sizeof(i32), file) &&
+        platform->readFromFile(&event->y,     sizeof(i32), file) &&
+        platform->readFromFile(&event->type,  sizeof(u8),  file) &&
+        platform->readFromFile(&event->code,  sizeof(u8),  file)
+    );
+}
+
+bool startInputRecording(InputRecording *recording, char *file_path, Platform *platform) {
+    if (recording->is_recording || recording->is_replaying) return false;
+
+    recording->file = platform->openFileForWriting(file_path);
+    if (!recording->file) return false;
+
+    u32 magic = INPUT_RECORDING__MAGIC;
+    u32 version = INPUT_RECORDING__VERSION;
+    if (!(platform->writeToFile(&magic,   sizeof(u32), recording->file) &&
+          platform->writeToFile(&version, sizeof(u32), recording->file))) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        return false;
+    }
+
+    recording->frame = 0;
+    recording->is_recording = true;
+
+    return true;
+}
+
+void recordInputEvent(InputRecording *recording, enum InputEventType type, u8 code, i32 x, i32 y, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    InputEvent event;
+    event.ticks = platform->getTicks();
+    event.frame = recording->frame;
+    event.type = (u8)type;
+    event.code = code;
+    event.x = x;
+    event.y = y;
+    if (!writeInputEvent(&event, recording->file, platform)) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        recording->is_recording = false;
+    }
+}
+
+void recordMouseWheelScrolled(InputRecording *recording, f32 amount, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    InputEvent event;
+    event.amount = amount;
+    event._ = 0;
+    recordInputEvent(recording, InputEvent_MouseWheelScrolled, 0, event.x, event.y, platform);
+}
+
+void stopInputRecording(InputRecording *recording, Platform *platform) {
+    if (!recording->is_recording) return;
+
+    recordInputEvent(recording, InputEvent_EndOfRecording, 0, 0, 0, platform);
+    if (recording->file) platform->closeFile(recording->file);
+    recording->file = null;
+    recording->is_recording = false;
+}
+
+bool startInputReplay(InputRecording *recording, char *file_path, Platform *platform) {
+    if (recording->is_recording || recording->is_replaying) return false;
+
+    recording->file = platform->openFileForReading(file_path);
+    if (!recording->file) return false;
+
+    u32 magic, version;
+    if (!(platform->readFromFile(&magic,   sizeof(u32), recording->file) &&
+          platform->readFromFile(&version, sizeof(u32), recording->file) &&
+          magic   == INPUT_RECORDING__MAGIC &&
+          version == INPUT_RECORDING__VERSION &&
+          readInputEvent(&recording->next_event, recording->file, platform))) {
+        platform->closeFile(recording->file);
+        recording->file = null;
+        return false;
+    }
+
+    recording->frame = 0;
+    recording->is_replaying = true;
+
+    return true;
+}
+
+void stopInputReplay(InputRecording *recording, Platform *platform) {
+    if (!recording->is_replaying) return;
+
+    platform->closeFile(recording->file);
+    recording->file = null;
+    recording->is_replaying = false;
+}
+
+// Returns the next event due at the current frame (if any) and advances the replay past it.
+bool getNextInputEventOfFrame(InputRecording *recording, InputEvent *event, Platform *platform) {
+    if (!recording->is_replaying ||
+        recording->next_event.frame != recording->frame ||
+        recording->next_event.type == InputEvent_EndOfRecording)
+        return false;
+
+    *event = recording->next_event;
+    if (!readInputEvent(&recording->next_event, recording->file, platform)) {
+        recording->next_event.type = InputEvent_EndOfRecording;
+        recording->next_event.frame = recording->frame + 1;
+    }
+
+    return true;
+}
+
+// Returns the number of frames that were drawn while recording.
+u32 getInputRecordingFrameCount(char *file_path, Platform *platform) {
+    InputRecording recording;
+    recording.is_recording = recording.is_replaying = false;
+    if (!startInputReplay(&recording, file_path, platform)) return 0;
+
+    InputEvent event = recording.next_event;
+    u32 frame_count = 0;
+    do {
+        if (event.type == InputEvent_EndOfRecording) frame_count = event.frame;
+        else if (event.frame >= frame_count) frame_count = event.frame + 1;
+    } while (readInputEvent(&event, recording.file, platform));
+    stopInputReplay(&recording, platform);
+
+    return frame_count;
+}
+
+INLINE u8 getMouseButtonCode(Mouse *mouse, MouseButton *mouse_button) {
+    return mouse_button == &mouse->left_button ? 0 : (mouse_button == &mouse->middle_button ? 1 : 2);
+}
+
+INLINE MouseButton* getMouseButtonOfCode(Mouse *mouse, u8 code) {
+    return code == 0 ? &mouse->left_button : (code == 1 ? &mouse->middle_button : &mouse->right_button);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "./types.h"
+
+// The app can update at a fixed time step, separately from rendering (by setting both app->on.update and on.render).
+//
+// After each round of update steps the state that updating changes is copied into a snapshot, that rendering then reads
+// instead of the live scene: The primitives, the cameras, the selection, the app's viewport and the controls.
+// There are 2 snapshots: Once one is published it becomes the latest, and the next one is copied into the other one.
+// Rendering always takes the latest snapshot, so a snapshot is only skipped (not published) when rendering is still
+// holding the other one, as it was the latest when rendering took it. The live state then goes into the next snapshot.
+// This way a slow frame never holds back the update (and the input that it handles), it only skips snapshots.
+//
+// Everything else in the scene (meshes, curves, boxes, grids and the object pools) is shared with rendering as is,
+// so must not be changed while updating. Curves are tessellated when they are drawn, so only by rendering.
+// Meshes that are still loading are filled in by the mesh loader's thread, and published to both (see MeshLoader).
+// The app's frame memory belongs to rendering (it is reset before each snapshot is rendered), so updating does not use it.
+// The viewport's HUD belongs to rendering: The snapshot's viewport is a shallow copy, so its HUD has the same lines
+// as the app's viewport, which rendering lays out into runs (see updateHUD) and reads the use_alternate flags of.
+// So on.update must not change the HUD's lines (or the flags they point at) - on.render sets them instead.
+// Taking and releasing snapshots is not synchronized here: A platform rendering on another thread has to lock around
+// publishSceneSnapshot, acquireSceneSnapshot and releaseSceneSnapshot (each only copies memory or flips flags).
+void initSimulation(Simulation *simulation, SceneSettings *settings, Memory *memory) {
+    simulation->step = 0;
+    simulation->published_count = 0;
+    simulation->rendered_count = 0;
+    simulation->ticks_per_step = 0;
+    simulation->accumulated_ticks = 0;
+    simulation->last_ticks = 0;
+    simulation->latest = 0;
+
+    for (u32 i = 0; i < 2; i++) {
+        SceneSnapshot *snapshot = simulation->snapshots + i;
+        snapshot->step = 0;
+        snapshot->number = 0;
+        snapshot->is_being_rendered = false;
+        snapshot->primitives = settings->max_primitives ? (Primitive*)allocateMemory(memory, sizeof(Primitive) * settings->max_primitives) : null;
+        snapshot->cameras    = settings->cameras        ? (Camera*   )allocateMemory(memory, sizeof(Camera)    * settings->cameras)        : null;
+    }
+}
+
+u64 getSimulationMemorySize(SceneSettings *settings) {
+    return 2 * (settings->max_primitives * sizeof(Primitive) + settings->cameras * sizeof(Camera));
+}
+
+INLINE bool isSimulating(AppCallbacks *callbacks) {
+    return callbacks->update && callbacks->render;
+}
+
+// Copies the given state into a snapshot that rendering is not holding, returning false when there is none:
+bool publishSceneSnapshot(Simulation *simulation, Scene *scene, Viewport *viewport, Controls *controls) {
+    u32 index = simulation->published_count ? simulation->latest ^ 1 : simulation->latest;
+    SceneSnapshot *snapshot = simulation->snapshots + index;
+    if (snapshot->is_being_rendered) return false;
+
+    snapshot->scene = *scene;
+    snapshot->scene.primitives = snapshot->primitives;
+    snapshot->scene.cameras    = snapshot->cameras;
+    snapshot->scene.selection  = &snapshot->selection;
+    if (snapshot->primitives)
+        for (u32 i = 0; i < scene->settings.primitives; i++)
+            snapshot->primitives[i] = scene->primitives[i];
+    if (snapshot->cameras)
+        for (u32 i = 0; i < scene->settings.cameras; i++)
+            snapshot->cameras[i] = scene->cameras[i];
+
+    snapshot->selection = *scene->selection;
+    if (snapshot->selection.primitive)
+        snapshot->selection.primitive = snapshot->primitives + (snapshot->selection.primitive - scene->primitives);
+    snapshot->selection.world_position = null;
+
+    snapshot->viewport = *viewport;
+    if (snapshot->cameras &&
+        viewport->camera >= scene->cameras &&
+        viewport->camera <  scene->cameras + scene->settings.cameras)
+        snapshot->viewport.camera = snapshot->cameras + (viewport->camera - scene->cameras);
+
+    snapshot->controls = *controls;
+    snapshot->step = simulation->step;
+    snapshot->number = ++simulation->published_count;
+    simulation->latest = index;
+
+    return true;
+}
+
+// Returns the latest snapshot if it was not rendered yet (or null), to be released once it was rendered:
+SceneSnapshot* acquireSceneSnapshot(Simulation *simulation) {
+    SceneSnapshot *snapshot = simulation->snapshots + simulation->latest;
+    if (!snapshot->number || snapshot->number == simulation->rendered_count) return null;
+
+    snapshot->is_being_rendered = true;
+    return snapshot;
+}
+
+void releaseSceneSnapshot(Simulation *simulation, SceneSnapshot *snapshot) {
+    snapshot->is_being_rendered = false;
+    simulation->rendered_count = snapshot->number;
+}
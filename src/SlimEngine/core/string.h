@@ -77,6 +77,33 @@ void printNumberIntoString(i32 number, NumberString *number_string) {
     }
 }
 
+// Counts (like those of the rasterizer's stats) are 64-bit, so they may not fit in the 12 characters of a number string:
+// Those that don't are scaled down by thousands, and printed with a suffix of K, M, G, T, P or E for the scale.
+void printCountIntoString(u64 count, NumberString *number_string) {
+    initNumberString(number_string);
+    char *buffer = number_string->_buffer;
+    buffer[12] = 0;
+    buffer += 12;
+
+    const char *suffixes = " KMGTPE";
+    u8 scale = 0;
+    while (count > (scale ? 99999999999ULL : 999999999999ULL)) {
+        count /= 1000;
+        scale++;
+    }
+    number_string->string.length = 0;
+    if (scale) {
+        *--buffer = suffixes[scale];
+        number_string->string.length++;
+    }
+    do {
+        *--buffer = (char)('0' + count % 10);
+        number_string->string.length++;
+        count /= 10;
+    } while (count);
+    number_string->string.char_ptr = buffer;
+}
+
 void printFloatIntoString(f32 number, NumberString *number_string, u8 float_digits_count) {
     f32 factor = 1;
     for (u8 i = 0; i < float_digits_count; i++) factor *= 10;
@@ -114,7 +141,7 @@ void printFloatIntoString(f32 number, NumberString *number_string, u8 float_digi
         }
     }
 
-    static char tmp[13];
+    char tmp[13];
     tmp[number_string->string.length + 1] = 0;
     for (u8 i = 0; i < (u8)number_string->string.length; i++) {
         u8 char_count_from_right_to_left = (u8)number_string->string.length - i - 1;
@@ -8,6 +8,8 @@
 #define LINE_HEIGHT 30
 #define FIRST_CHARACTER_CODE 32
 #define LAST_CHARACTER_CODE 126
+#define GLYPH_COUNT (LAST_CHARACTER_CODE - FIRST_CHARACTER_CODE + 1)
+#define GLYPH_ATLAS__MAX_SPANS 4096
 
 // Header File for SSD1306 characters
 // Generated with TTF2BMH
@@ -110,21 +112,113 @@ u8 bitmap_125[] = {0,0,0,0,0,0,255,255,128,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,252,255
 u8 bitmap_126[] = {0,0,0,128,128,128,128,0,0,0,0,0,128,128,0,0,0,0,0,0,15,15,1,1,3,7,14,12,12,14,15,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
 u8 *char_addr[] = {bitmap_32,bitmap_33,bitmap_34,bitmap_35,bitmap_36,bitmap_37,bitmap_38,bitmap_39,bitmap_40,bitmap_41,bitmap_42,bitmap_43,bitmap_44,bitmap_45,bitmap_46,bitmap_47,bitmap_48,bitmap_49,bitmap_50,bitmap_51,bitmap_52,bitmap_53,bitmap_54,bitmap_55,bitmap_56,bitmap_57,bitmap_58,bitmap_59,bitmap_60,bitmap_61,bitmap_62,bitmap_63,bitmap_64,bitmap_65,bitmap_66,bitmap_67,bitmap_68,bitmap_69,bitmap_70,bitmap_71,bitmap_72,bitmap_73,bitmap_74,bitmap_75,bitmap_76,bitmap_77,bitmap_78,bitmap_79,bitmap_80,bitmap_81,bitmap_82,bitmap_83,bitmap_84,bitmap_85,bitmap_86,bitmap_87,bitmap_88,bitmap_89,bitmap_90,bitmap_91,bitmap_92,bitmap_93,bitmap_94,bitmap_95,bitmap_96,bitmap_97,bitmap_98,bitmap_99,bitmap_100,bitmap_101,bitmap_102,bitmap_103,bitmap_104,bitmap_105,bitmap_106,bitmap_107,bitmap_108,bitmap_109,bitmap_110,bitmap_111,bitmap_112,bitmap_113,bitmap_114,bitmap_115,bitmap_116,bitmap_117,bitmap_118,bitmap_119,bitmap_120,bitmap_121,bitmap_122,bitmap_123,bitmap_124,bitmap_125,bitmap_126};
 
+// The glyphs are rasterized once (see initGlyphAtlas) from their column bitmaps into horizontal spans of lit pixels,
+// so that text is drawn a row at a time without testing any bits, or visiting any of the pixels in between spans.
+// With antialiasing a pixel of a glyph covers all 4 sub-pixels of a pixel quad, so the same spans serve both modes.
+typedef struct GlyphSpan {
+    u8 row, first, length;
+} GlyphSpan;
+
+typedef struct Glyph {
+    u16 first_span, span_count;
+} Glyph;
+
+typedef struct GlyphAtlas {
+    Glyph glyphs[GLYPH_COUNT];
+    GlyphSpan spans[GLYPH_ATLAS__MAX_SPANS];
+    u16 span_count;
+    bool is_initialized;
+} GlyphAtlas;
+
+GlyphAtlas glyph_atlas;
+
+void initGlyphAtlas() {
+    // Each bitmap is 3 bands of 8 rows, a byte per column (the top bit being the band's bottom row):
+    bool mask[FONT_HEIGHT + 1][FONT_WIDTH];
+    glyph_atlas.span_count = 0;
+    for (u8 g = 0; g < GLYPH_COUNT; g++) {
+        u8 *byte = char_addr[g];
+        for (u8 row = 0; row <= FONT_HEIGHT; row++)
+            for (u8 column = 0; column < FONT_WIDTH; column++)
+                mask[row][column] = false;
+
+        for (u8 band = 1; band < 4; band++)
+            for (u8 column = 0; column < FONT_WIDTH; column++, byte++)
+                for (u8 bit = 0; bit < FONT_HEIGHT / 3; bit++)
+                    if (*byte & (0x80 >> bit))
+                        mask[band * FONT_HEIGHT / 3 - bit][column] = true;
+
+        Glyph *glyph = glyph_atlas.glyphs + g;
+        glyph->first_span = glyph_atlas.span_count;
+        for (u8 row = 0; row <= FONT_HEIGHT; row++) {
+            for (u8 column = 0; column < FONT_WIDTH; column++) {
+                if (!mask[row][column] || glyph_atlas.span_count == GLYPH_ATLAS__MAX_SPANS) continue;
+
+                GlyphSpan *span = glyph_atlas.spans + glyph_atlas.span_count++;
+                span->row = row;
+                span->first = column;
+                while (column < FONT_WIDTH && mask[row][column]) column++;
+                span->length = column - span->first;
+            }
+        }
+        glyph->span_count = glyph_atlas.span_count - glyph->first_span;
+    }
+
+    glyph_atlas.is_initialized = true;
+}
+
+INLINE void drawGlyph(Glyph *glyph, u16 x, u16 y, vec3 color, f32 opacity, Viewport *viewport) {
+    bool AA = viewport->settings.antialias;
+    Pixel opaque_pixel;
+    opaque_pixel.color = color;
+    opaque_pixel.opacity = 1;
+    opaque_pixel.depth = 0;
+
+    GlyphSpan *span = glyph_atlas.spans + glyph->first_span;
+    for (u16 s = 0; s < glyph->span_count; s++, span++) {
+        u16 pixel_y = y + span->row;
+        if (pixel_y >= viewport->dimensions.height) break;
+
+        u16 pixel_x = x + span->first;
+        pixel_y += (u16)viewport->position.y;
+        pixel_x += (u16)viewport->position.x;
+        if (!isRowInViewportBand(AA ? pixel_y << 1 : pixel_y, viewport)) continue;
+        if (opacity == 1) {
+            // Opaque pixels at depth 0 replace whatever was there (as setPixel would, a sub-pixel at a time):
+            PixelQuad *pixel_quad = viewport->pixels + viewport->dimensions.stride * pixel_y + pixel_x;
+            for (u8 i = 0; i < span->length; i++, pixel_quad++)
+                pixel_quad->TL = pixel_quad->TR = pixel_quad->BL = pixel_quad->BR = opaque_pixel;
+
+            ADD_RASTERIZER_STAT(viewport, pixels,             AA ? span->length * 4 : span->length);
+            ADD_RASTERIZER_STAT(viewport, overwritten_pixels, AA ? span->length * 4 : span->length);
+        } else if (AA) {
+            u16 sub_pixel_y = pixel_y << 1;
+            u16 sub_pixel_x = pixel_x << 1;
+            for (u8 i = 0; i < span->length; i++, sub_pixel_x += 2) {
+                setPixel(sub_pixel_x + 0, sub_pixel_y + 0, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 1, sub_pixel_y + 0, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 0, sub_pixel_y + 1, 0, color, opacity, viewport);
+                setPixel(sub_pixel_x + 1, sub_pixel_y + 1, 0, color, opacity, viewport);
+            }
+        } else
+            for (u8 i = 0; i < span->length; i++)
+                setPixel(pixel_x + i, pixel_y, 0, color, opacity, viewport);
+    }
+}
+
 void drawText(char *str, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
     if (x < 0 || x > viewport->dimensions.width  - FONT_WIDTH ||
         y < 0 || y > viewport->dimensions.height - FONT_HEIGHT)
         return;
 
+    if (!glyph_atlas.is_initialized) initGlyphAtlas(); // Done up front by the app, before any drawing threads start
+
     color.r *= color.r;
     color.g *= color.g;
     color.b *= color.b;
-    bool AA = viewport->settings.antialias;
     u16 current_x = (u16)x;
     u16 current_y = (u16)y;
-    u16 pixel_x, sub_pixel_x;
-    u16 pixel_y, sub_pixel_y;
     u16 t_offset;
-    u8* byte;
     char character = *str;
     while (character) {
         if (character == '\n') {
@@ -138,32 +232,7 @@ void drawText(char *str, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewpo
             current_x += t_offset;
         } else if (character >= FIRST_CHARACTER_CODE &&
                    character <= LAST_CHARACTER_CODE) {
-            byte = char_addr[character - FIRST_CHARACTER_CODE];
-            for (int i = 1; i < 4; i++) {
-                pixel_x = current_x;
-                pixel_y = current_y + i * FONT_HEIGHT / 3;
-                for (int w = 0; w < FONT_WIDTH ; w++) {
-                    for (int h = 0; h < FONT_HEIGHT/3; h++) {
-                        /* skip background bits */
-                        if (*byte & (0x80  >> h)) {
-                            if (AA) {
-                                sub_pixel_x = pixel_x << 1;
-                                sub_pixel_y = pixel_y << 1;
-                                setPixel(sub_pixel_x + 0, sub_pixel_y + 0, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 1, sub_pixel_y + 0, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 0, sub_pixel_y + 1, 0, color, opacity, viewport);
-                                setPixel(sub_pixel_x + 1, sub_pixel_y + 1, 0, color, opacity, viewport);
-                            } else
-                                setPixel(pixel_x, pixel_y, 0, color, opacity, viewport);
-                        }
-
-                        pixel_y--;
-                    }
-                    byte++;
-                    pixel_y += FONT_HEIGHT / 3;
-                    pixel_x++;
-                }
-            }
+            drawGlyph(glyph_atlas.glyphs + (character - FIRST_CHARACTER_CODE), current_x, current_y, color, opacity, viewport);
             current_x += FONT_WIDTH;
             if (current_x + FONT_WIDTH > viewport->dimensions.width)
                 return;
@@ -173,7 +242,7 @@ void drawText(char *str, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewpo
 }
 
 void drawNumber(i32 number, i32 x, i32 y, vec3 color, f32 opacity, Viewport *viewport) {
-    static NumberString number_string;
+    NumberString number_string;
     printNumberIntoString(number, &number_string);
     drawText(number_string.string.char_ptr, x - number_string.string.length * FONT_WIDTH, y, color, opacity, viewport);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "./base.h"
+#include "./profiler.h"
 
 void accumulateTimer(Timer* timer) {
     timer->ticks_diff = timer->ticks_after - timer->ticks_before;
@@ -28,6 +29,10 @@ INLINE void beginFrameTimer(Timer *timer) {
     timer->ticks_before = timer->getTicks();
     timer->ticks_diff = timer->ticks_before - timer->ticks_after;
     timer->delta_time = (f32)((f64)timer->ticks_diff * timer->ticks->per_tick.seconds);
+
+    // After a pause (the window idling while rendering on demand, or being dragged) continue as if from a short frame,
+    // so that whatever moves by delta_time does not jump by the whole length of the pause:
+    if (timer->delta_time > TIMER__MAX_DELTA_TIME) timer->delta_time = TIMER__MAX_DELTA_TIME;
 }
 
 INLINE void endFrameTimer(Timer *timer) {
@@ -39,9 +44,14 @@ INLINE void endFrameTimer(Timer *timer) {
 
 void beginFrame(Timer *timer) {
     beginFrameTimer(timer);
+    PROFILE_BEGIN("frame");
 }
 
 void endFrame(Timer *timer, Mouse *mouse) {
     resetMouseChanges(mouse);
     endFrameTimer(timer);
+#ifdef SLIM_ENGINE_PROFILER
+    PROFILE_END();
+    endProfileFrame();
+#endif
 }
\ No newline at end of file
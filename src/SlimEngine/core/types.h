@@ -53,9 +53,42 @@ typedef struct Time {
     GetTicks getTicks;
 } Time;
 
+typedef struct ProfileScope {
+    char *name, text[PROFILER__TEXT_LENGTH];
+    u64 ticks, history[PROFILER__FRAME_HISTORY];
+    f32 min_microseconds,
+        max_microseconds,
+        average_microseconds;
+    u32 parent, depth, calls, history_count, history_index;
+} ProfileScope;
+
+typedef struct ProfileEvent {
+    u64 ticks_before, ticks_after;
+    u32 scope;
+} ProfileEvent;
+
+typedef struct Profiler {
+    ProfileScope scopes[PROFILER__MAX_SCOPES];
+    ProfileEvent events[PROFILER__MAX_EVENTS];
+    ProfileEvent stack[PROFILER__MAX_DEPTH];
+    GetTicks getTicks;
+    Ticks *ticks;
+    u64 frame_count, event_count;
+    u32 scope_count, depth;
+    bool paused;
+} Profiler;
+
 typedef struct Curve {
     f32 thickness;
     u32 revolution_count;
+
+    // The object-space polyline of the curve, cached by drawCurve for the parameters it was generated with,
+    // along with the viewport that it was last sized for (see drawCurve):
+    vec3 *points;
+    u32 point_count, points_capacity, points_revolution_count;
+    f32 points_thickness;
+    u8 points_primitive_type;
+    struct Viewport *points_viewport;
 } Curve;
 
 typedef enum BoxSide {
@@ -150,7 +183,10 @@ enum PrimitiveType {
     PrimitiveType_Tetrahedron
 };
 
+// The world matrix (and it's inverse) are cached, and are recomputed only when the primitive is flagged as IS_DIRTY
+// Whatever changes the position, rotation or scale of a primitive should flag it as such (see updatePrimitiveMatrices).
 typedef struct Primitive {
+    mat3x4 world_matrix, world_matrix_inverted;
     quat rotation;
     vec3 position, scale;
     u32 id;
@@ -159,19 +195,20 @@ typedef struct Primitive {
     u8 flags, material_id;
 } Primitive;
 
+// The rotation quaternions are derived from the rotation matrix lazily, only once they are asked for after a rotation
+// (see getXform3Rotation and getXform3InvertedRotation in scene/xform.h), as tracked by the dirty bits.
 typedef struct xform3 {
-    mat3 matrix,
-         yaw_matrix,
+    mat3 yaw_matrix,
          pitch_matrix,
          roll_matrix,
-         rotation_matrix,
-         rotation_matrix_inverted;
+         rotation_matrix;
     quat rotation,
          rotation_inverted;
     vec3 position, scale,
          *up_direction,
          *right_direction,
          *forward_direction;
+    u8 dirty;
 } xform3;
 
 typedef struct Camera {
@@ -211,13 +248,39 @@ typedef struct ProjectionPlane {
 typedef struct ViewportSettings {
     Pixel background;
     f32 near_clipping_plane_distance,
-        far_clipping_plane_distance;
+        far_clipping_plane_distance,
+        curve_tolerance;
     u32 hud_line_count;
     HUDLine *hud_lines;
+    HUDRun *hud_runs;
     enum ColorID hud_default_color;
-    bool show_hud, use_cube_NDC, flip_z, antialias;
+    u32 target_microseconds_per_frame; // When set, the internal resolution is scaled down to hold this frame time
+    f32 min_resolution_scale;
+    bool show_hud, use_cube_NDC, flip_z, antialias,
+         dynamic_antialias; // Whether antialiasing can be switched off (and back on) as part of the frame time budget
 } ViewportSettings;
 
+typedef struct RasterizerStats {
+    u64 edges,
+        culled_edges,
+        clipped_edges,
+        lines,
+        pixels,
+        blended_pixels,
+        overwritten_pixels,
+        curve_segments,
+        saved_curve_segments;
+} RasterizerStats;
+
+// The viewport can render at a lower internal resolution than its size in the window (see viewport/viewport.h),
+// with its dimensions being the internal ones and its size in the window kept here.
+typedef struct ViewportScaling {
+    u16 width, height;
+    f32 scale, frame_time;
+    u8 settle_frames;
+    bool dropped_antialias;
+} ViewportScaling;
+
 typedef struct Viewport {
     ViewportSettings settings;
     Dimensions dimensions;
@@ -229,6 +292,17 @@ typedef struct Viewport {
     mat4 projection_matrix;
     Camera *camera;
     PixelQuad *pixels;
+    RasterizerStats stats;
+
+    // Pixels are only drawn into the rows [band_top, band_bottom) of the viewport (all of them when both are 0).
+    // This lets horizontal bands of the same viewport be drawn from separate threads (see scene/parallel.h).
+    i32 band_top, band_bottom;
+
+    // Set while curves have already been tessellated for this frame (see prepareSceneForDrawing in scene/parallel.h),
+    // so that drawing from multiple threads does not regenerate the points of curves that are shared between them.
+    bool has_prepared_curves;
+
+    ViewportScaling scaling;
 } Viewport;
 
 typedef struct Ray {
@@ -255,8 +329,54 @@ typedef struct Mesh {
     TriangleVertexIndices *vertex_uvs_indices;
     EdgeVertexIndices     *edge_vertex_indices;
     u32 triangle_count, vertex_count, edge_count, normals_count, uvs_count;
+
+    // The counts that the mesh's arrays have room for (0 for arrays that are not the mesh's own to write into), which
+    // loading a scene file into the mesh is checked against (as its counts may shrink to those of a smaller record):
+    u32 triangle_capacity, vertex_capacity, edge_capacity, normals_capacity, uvs_capacity;
+
+    // Set while the mesh is being loaded in the background, when only its bounds are valid (see isMeshLoaded):
+    volatile u32 is_loading;
 } Mesh;
 
+// A mesh that is read from its file in the background, into arrays that were allocated for it up front
+// (or that is mapped from its file up front, having its mapped arrays paged in in the background):
+typedef struct MeshLoad {
+    Mesh *mesh;
+    Mesh loaded;
+    char *file_path;
+    bool is_mapped;
+} MeshLoad;
+
+// Loads meshes on a background thread, counting the meshes that were loaded (see scene/io.h):
+typedef struct MeshLoader {
+    MeshLoad *loads;
+    struct Platform *platform;
+    u32 count, drawn_count;
+    volatile u32 loaded_count;
+} MeshLoader;
+
+// The records of a scene's objects as they were last saved to (or loaded from) its file, along with their counts,
+// so that only the records that changed since are appended to the file's journal (see saveSceneChangesToFile).
+// The entry is where the next journal entry is composed.
+typedef struct SceneJournal {
+    char *file_path;
+    u8 *records, *entry;
+    u64 entry_capacity;
+    u32 counts[SCENE_FILE__SECTION_TYPES];
+    u32 entry_count;
+} SceneJournal;
+
+// Handles stay valid across removals of other objects, and go stale once their own object is removed
+// (its slot's generation is odd while it is in use, and is bumped whenever it is allocated or freed).
+typedef struct ObjectHandle {
+    u32 index, generation;
+} ObjectHandle;
+
+typedef struct ObjectPool {
+    u32 *generations, *next_free;
+    u32 capacity, count, first_free;
+} ObjectPool;
+
 typedef struct Selection {
     quat object_rotation;
     vec3 transformation_plane_origin,
@@ -269,6 +389,7 @@ typedef struct Selection {
     Ray ray, local_ray;
     RayHit hit, local_hit;
     Primitive *primitive;
+    ObjectHandle primitive_handle;
     enum BoxSide box_side;
     f32 object_distance;
     u32 object_type, object_id;
@@ -277,6 +398,7 @@ typedef struct Selection {
 
 typedef struct SceneSettings {
     u32 cameras, primitives, meshes, curves, boxes, grids;
+    u32 max_primitives, max_meshes, max_curves, max_boxes, max_grids;
     String file, *mesh_files;
 } SceneSettings;
 
@@ -289,10 +411,40 @@ typedef struct Scene {
     Curve *curves;
     Grid *grids;
     Box *boxes;
+    ObjectPool primitive_pool, mesh_pool, curve_pool, box_pool, grid_pool;
+    MeshLoader mesh_loader;
+    SceneJournal journal;
     u64 last_io_ticks;
     bool last_io_is_save;
 } Scene;
 
+// A copy of the state that the app's update changes (the primitives, the cameras, the selection, the viewport and the
+// controls) to be rendered while the next state is being updated. The rest of the scene is shared (see core/simulation.h),
+// as are the lines of the viewport's HUD.
+typedef struct SceneSnapshot {
+    Scene scene;
+    Viewport viewport;
+    Controls controls;
+    Selection selection;
+    Primitive *primitives;
+    Camera *cameras;
+    u64 step, number; // The update step that the snapshot is of, and the number of snapshots published (including it)
+    bool is_being_rendered;
+} SceneSnapshot;
+
+// Updating the app at a fixed time step, with rendering consuming double-buffered snapshots of the scene:
+typedef struct Simulation {
+    SceneSnapshot snapshots[2];
+    u64 step,
+        published_count,
+        rendered_count,
+        ticks_per_step,
+        accumulated_ticks,
+        last_ticks;
+    u32 latest;
+    u16 steps_per_second;
+} Simulation;
+
 typedef struct AppCallbacks {
     void (*sceneReady)(Scene *scene);
     void (*viewportReady)(Viewport *viewport);
@@ -306,26 +458,165 @@ typedef struct AppCallbacks {
     void (*mousePositionSet)(i32 x, i32 y);
     void (*mouseMovementSet)(i32 x, i32 y);
     void (*mouseRawMovementSet)(i32 x, i32 y);
+
+    // Setting both has the app update at a fixed time step and render separately (instead of on windowRedraw).
+    // They run on separate threads, sharing the parts of the scene and viewport that are not copied into snapshots:
+    // Notably, the HUD is only to be set from render (see core/simulation.h).
+    void (*update)(f32 delta_time);
+    void (*render)(SceneSnapshot *snapshot);
 } AppCallbacks;
 
 typedef void* (*CallbackForFileOpen)(const char* file_path);
 typedef bool  (*CallbackForFileRW)(void *out, unsigned long, void *handle);
 typedef void  (*CallbackForFileClose)(void *handle);
+typedef void* (*CallbackForFileMap)(const char* file_path, u64 *size);
+typedef void  (*CallbackForFileUnmap)(void *data, u64 size);
+typedef void  (*CallbackForParallelWork)(void *data, u32 index);
+typedef void  (*CallbackForParallelRun)(CallbackForParallelWork work, void *data, u32 count);
+typedef void  (*CallbackForSceneDrawing)(Scene *scene, Viewport *viewport);
+typedef void  (*CallbackForThread)(void *data);
+typedef bool  (*CallbackForThreadStart)(CallbackForThread thread, void *data);
+typedef void  (*CallbackForThreadsJoin)();
+typedef void* (*CallbackForSemaphoreCreate)();
+typedef void  (*CallbackForSemaphoreSignal)(void *semaphore, u32 count);
+typedef void  (*CallbackForSemaphoreWait)(void *semaphore);
+typedef void  (*CallbackForThreadYield)();
+
+// Counts the jobs that were added against it and are yet to finish (see core/jobs.h).
+typedef struct JobCounter {
+    volatile i32 pending;
+} JobCounter;
+
+// Calls work(data, index) for every index in [first, end), then counts itself as finished on its counter.
+typedef struct Job {
+    CallbackForParallelWork work;
+    void *data;
+    JobCounter *counter;
+    u32 first, end;
+} Job;
+
+// A worker's jobs: The worker pushes and pops at the bottom, while other threads steal from the top.
+typedef struct JobDeque {
+    Job jobs[JOBS__DEQUE_CAPACITY];
+    volatile u32 top, bottom;
+    volatile i32 lock;
+} JobDeque;
+
+typedef struct JobSystem {
+    JobDeque deques[PARALLEL__MAX_THREADS];
+    void *semaphore;
+    CallbackForSemaphoreSignal signalSemaphore;
+    CallbackForSemaphoreWait waitForSemaphore;
+    CallbackForThreadYield yieldThread;
+    u32 thread_count;
+    volatile u32 is_stopping;
+} JobSystem;
+
+// Viewports that each draw the scene through their own camera into their own region of the frame buffer,
+// drawn concurrently and then resolved together into the window's content (see viewport/compositor.h).
+typedef struct Compositor {
+    Viewport *viewports[COMPOSITOR__MAX_VIEWPORTS];
+    u32 viewport_count;
+    Scene *scene;
+    CallbackForSceneDrawing drawScene;
+} Compositor;
 
 typedef struct Platform {
-    GetTicks             getTicks;
-    CallbackWithInt      getMemory;
-    CallbackWithCharPtr  setWindowTitle;
-    CallbackWithBool     setWindowCapture;
-    CallbackWithBool     setCursorVisibility;
-    CallbackForFileClose closeFile;
-    CallbackForFileOpen  openFileForReading;
-    CallbackForFileOpen  openFileForWriting;
-    CallbackForFileRW    readFromFile;
-    CallbackForFileRW    writeToFile;
+    GetTicks                getTicks;
+    CallbackWithInt         getMemory;
+    CallbackWithInt         reserveMemory;
+    CallbackForMemoryCommit commitMemory;
+    CallbackWithInt         getLargePageMemory;
+    CallbackWithCharPtr     setWindowTitle;
+    CallbackWithBool        setWindowCapture;
+    CallbackWithBool        setCursorVisibility;
+    CallbackForFileClose    closeFile;
+    CallbackForFileOpen     openFileForReading;
+    CallbackForFileOpen     openFileForWriting;
+    CallbackForFileOpen     openFileForAppending;
+    CallbackForFileRW       readFromFile;
+    CallbackForFileRW       writeToFile;
+
+    // Maps a whole file into memory as a private (copy-on-write) view of it, returning null when it could not.
+    // The view stays valid until it is unmapped, even once the file is closed.
+    CallbackForFileMap      mapFileForReading;
+    CallbackForFileUnmap    unmapFile;
+
+    // Threads for the job system (see core/jobs.h), that run until it is shut down, and a counting semaphore
+    // that the threads sleep on while there are no jobs (signalling it wakes up to the given number of them).
+    // Joining waits for all of the threads that were started to return (see shutDownJobSystem).
+    CallbackForThreadStart     startThread;
+    CallbackForThreadsJoin     joinThreads;
+    CallbackForThreadYield     yieldThread;
+    CallbackForSemaphoreCreate createSemaphore;
+    CallbackForSemaphoreSignal signalSemaphore;
+    CallbackForSemaphoreWait   waitForSemaphore;
+
+    // Calls work(data, index) for every index in [0, count) in parallel, returning once all calls have returned.
+    // The calls are run as jobs on the app's threads (see core/jobs.h), including the calling thread.
+    // thread_count is the number of hardware threads worth splitting work for (set by the platform).
+    CallbackForParallelRun  runInParallel;
+    u32 thread_count;
     u64 ticks_per_second;
 } Platform;
 
+// Scene files (see scene/io.h):
+enum SceneFileSectionType {
+    SceneFileSection_None = 0,
+    SceneFileSection_Cameras,
+    SceneFileSection_Primitives,
+    SceneFileSection_Meshes,
+    SceneFileSection_Curves,
+    SceneFileSection_Boxes,
+    SceneFileSection_Grids
+};
+
+// Followed by the table of contents (a SceneFileSection for each section of the file):
+typedef struct SceneFileHeader {
+    u32 magic, version, section_count, reserved;
+} SceneFileHeader;
+
+// A section of records, at the given offset from the start of the file:
+typedef struct SceneFileSection {
+    u32 type, count, record_size, reserved;
+    u64 offset, size;
+} SceneFileSection;
+
+// An embedded mesh, followed by its arrays (each at the given offset from the start of the file, or 0 if absent).
+// The size covers the record along with its arrays, so the next mesh's record starts right after them.
+typedef struct SceneFileMesh {
+    AABB aabb;
+    u32 vertex_count, triangle_count, edge_count, uvs_count, normals_count, reserved;
+    u64 size,
+        vertex_positions,
+        vertex_position_indices,
+        edge_vertex_indices,
+        vertex_uvs,
+        vertex_uvs_indices,
+        vertex_normals,
+        vertex_normal_indices;
+} SceneFileMesh;
+
+// An entry of a scene file's journal (appended after its sections), followed by the records that changed as of the entry.
+// Each record is preceded by a SceneFileJournalRecord, and the counts of objects are by section type (as of the entry).
+typedef struct SceneFileJournalEntry {
+    u32 magic, record_count;
+    u64 size;
+    u32 counts[SCENE_FILE__SECTION_TYPES], reserved;
+} SceneFileJournalEntry;
+
+typedef struct SceneFileJournalRecord {
+    u32 type, index;
+} SceneFileJournalRecord;
+
+// A scene file that is either in memory (accessed at any offset) or read/written through the platform's file (only forward):
+typedef struct SceneFile {
+    Platform *platform;
+    void *file;
+    u8 *data;
+    u64 size, offset;
+} SceneFile;
+
 typedef struct Settings {
     SceneSettings scene;
     ViewportSettings viewport;
@@ -339,8 +630,39 @@ typedef struct Defaults {
     Settings settings;
 } Defaults;
 
+enum InputEventType {
+    InputEvent_KeyDown,
+    InputEvent_KeyUp,
+    InputEvent_MouseButtonDown,
+    InputEvent_MouseButtonUp,
+    InputEvent_MouseButtonDoubleClicked,
+    InputEvent_MouseWheelScrolled,
+    InputEvent_MousePositionSet,
+    InputEvent_MouseMovementSet,
+    InputEvent_MouseRawMovementSet,
+    InputEvent_WindowResize,
+    InputEvent_EndOfRecording
+};
+
+typedef struct InputEvent {
+    u64 ticks;
+    u32 frame;
+    union {
+        struct { i32 x, y; };
+        struct { f32 amount, _; };
+    };
+    u8 type, code;
+} InputEvent;
+
+typedef struct InputRecording {
+    InputEvent next_event;
+    void *file;
+    u32 frame;
+    bool is_recording, is_replaying;
+} InputRecording;
+
 typedef struct App {
-    Memory memory;
+    Memory memory, frame_memory;
     Platform platform;
     Controls controls;
     u32 *window_content;
@@ -348,6 +670,13 @@ typedef struct App {
     Time time;
     Scene scene;
     Viewport viewport;
+    InputRecording input_recording;
+    Simulation simulation;
+
+    // Redrawing only when needed (see _isRedrawNeeded), and at most at the given frame rate (0 for no cap):
+    u16 max_frames_per_second;
+    bool render_on_demand, needs_redraw;
+
     bool is_running;
     void *user_data;
 } App;
@@ -388,7 +717,31 @@ void setGridEdgesFromVertices(Edge *edges, u8 edge_count, vec3 *from, vec3 *to)
     }
 }
 
+INLINE bool isMeshLoaded(Mesh *mesh) {
+    return !ATOMIC_LOAD(&mesh->is_loading);
+}
+
+INLINE bool isViewportScaled(Viewport *viewport) {
+    return viewport->scaling.scale != 1;
+}
+
+// The size of the viewport in the window (its dimensions are those of its internal resolution when that is scaled):
+INLINE u16 getViewportWindowWidth( Viewport *viewport) { return isViewportScaled(viewport) ? viewport->scaling.width  : viewport->dimensions.width;  }
+INLINE u16 getViewportWindowHeight(Viewport *viewport) { return isViewportScaled(viewport) ? viewport->scaling.height : viewport->dimensions.height; }
+
+// Whether a row of the frame buffer (of sub-pixels when antialiasing) is in the viewport's band (see band_top):
+INLINE bool isRowInViewportBand(i32 y, Viewport *viewport) {
+    if (!viewport->band_bottom) return true;
+
+    i32 top    = viewport->position.y + viewport->band_top;
+    i32 bottom = viewport->position.y + viewport->band_bottom;
+    if (viewport->settings.antialias) { top <<= 1; bottom <<= 1; }
+    return y >= top && y < bottom;
+}
+
 INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport *viewport) {
+    if (!isRowInViewportBand(y, viewport)) return;
+
     Pixel *pixel;
     PixelQuad *pixel_quad;
     if (viewport->settings.antialias) {
@@ -399,6 +752,8 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
         pixel = &pixel_quad->TL;
     }
 
+    COUNT_RASTERIZER_STAT(viewport, pixels);
+
     Pixel new_pixel;
     new_pixel.opacity = opacity;
     new_pixel.color = color;
@@ -415,6 +770,7 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
             foreground = new_pixel;
         }
         if (foreground.opacity != 1) {
+            COUNT_RASTERIZER_STAT(viewport, blended_pixels);
             f32 one_minus_foreground_opacity = 1.0f - foreground.opacity;
             opacity = foreground.opacity + background.opacity * one_minus_foreground_opacity;
             f32 one_over_opacity = opacity ? 1.0f / opacity : 1;
@@ -426,8 +782,14 @@ INLINE void setPixel(i32 x, i32 y, f64 depth, vec3 color, f32 opacity, Viewport
             pixel->color.b = fast_mul_add(foreground.color.b, foreground_factor, background.color.b * background_factor);
             pixel->opacity = opacity;
             pixel->depth   = foreground.depth;
-        } else *pixel = foreground;
-    } else *pixel = new_pixel;
+        } else {
+            COUNT_RASTERIZER_STAT(viewport, overwritten_pixels);
+            *pixel = foreground;
+        }
+    } else {
+        COUNT_RASTERIZER_STAT(viewport, overwritten_pixels);
+        *pixel = new_pixel;
+    }
 
     if (!viewport->settings.antialias) pixel_quad->BR = pixel_quad->BL = pixel_quad->TR = pixel_quad->TL;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/base.h"
+#include "./simd.h"
 
 INLINE mat4 getMat4Identity() {
     mat4 out;
@@ -105,6 +106,16 @@ INLINE mat4 scaleMat4(mat4 m, f32 factor) {
 INLINE mat4 mulMat4(mat4 a, mat4 b) {
     mat4 out;
 
+#ifdef SLIM_ENGINE_SIMD
+    simd4 X = loadSIMD(b.X.components);
+    simd4 Y = loadSIMD(b.Y.components);
+    simd4 Z = loadSIMD(b.Z.components);
+    simd4 W = loadSIMD(b.W.components);
+    storeSIMD(out.X.components, mulSIMDByRows(a.X.x, a.X.y, a.X.z, a.X.w, X, Y, Z, W));
+    storeSIMD(out.Y.components, mulSIMDByRows(a.Y.x, a.Y.y, a.Y.z, a.Y.w, X, Y, Z, W));
+    storeSIMD(out.Z.components, mulSIMDByRows(a.Z.x, a.Z.y, a.Z.z, a.Z.w, X, Y, Z, W));
+    storeSIMD(out.W.components, mulSIMDByRows(a.W.x, a.W.y, a.W.z, a.W.w, X, Y, Z, W));
+#else
     out.X.x = a.X.x*b.X.x + a.X.y*b.Y.x + a.X.z*b.Z.x + a.X.w*b.W.x; // Row 1 | Column 1
     out.X.y = a.X.x*b.X.y + a.X.y*b.Y.y + a.X.z*b.Z.y + a.X.w*b.W.y; // Row 1 | Column 2
     out.X.z = a.X.x*b.X.z + a.X.y*b.Y.z + a.X.z*b.Z.z + a.X.w*b.W.z; // Row 1 | Column 3
@@ -124,6 +135,7 @@ INLINE mat4 mulMat4(mat4 a, mat4 b) {
     out.W.y = a.W.x*b.X.y + a.W.y*b.Y.y + a.W.z*b.Z.y + a.W.w*b.W.y; // Row 4 | Column 2
     out.W.z = a.W.x*b.X.z + a.W.y*b.Y.z + a.W.z*b.Z.z + a.W.w*b.W.z; // Row 4 | Column 3
     out.W.w = a.W.x*b.X.w + a.W.y*b.Y.w + a.W.z*b.Z.w + a.W.w*b.W.w; // Row 4 | Column 4
+#endif
 
     return out;
 }
@@ -131,6 +143,75 @@ INLINE mat4 mulMat4(mat4 a, mat4 b) {
 INLINE mat4 invMat4(mat4 m) {
     mat4 out;
 
+#ifdef SLIM_ENGINE_SIMD
+    // Cramer's rule over the transposed matrix, with the cofactors accumulated from products of pairs of its rows
+    // (as in Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix" application note):
+    simd4 row0 = loadSIMD(m.X.components);
+    simd4 row1 = loadSIMD(m.Y.components);
+    simd4 row2 = loadSIMD(m.Z.components);
+    simd4 row3 = loadSIMD(m.W.components);
+    transposeSIMD(&row0, &row1, &row2, &row3);
+    row1 = swapHalvesSIMD(row1);
+    row3 = swapHalvesSIMD(row3);
+
+    simd4 minor0, minor1, minor2, minor3;
+    simd4 tmp = swapPairsSIMD(mulSIMD(row2, row3));
+    minor0 = mulSIMD(row1, tmp);
+    minor1 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(mulSIMD(row1, tmp), minor0);
+    minor1 = subSIMD(mulSIMD(row0, tmp), minor1);
+    minor1 = swapHalvesSIMD(minor1);
+
+    tmp = swapPairsSIMD(mulSIMD(row1, row2));
+    minor0 = addSIMD(mulSIMD(row3, tmp), minor0);
+    minor3 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(minor0, mulSIMD(row3, tmp));
+    minor3 = subSIMD(mulSIMD(row0, tmp), minor3);
+    minor3 = swapHalvesSIMD(minor3);
+
+    tmp = swapPairsSIMD(mulSIMD(swapHalvesSIMD(row1), row3));
+    row2 = swapHalvesSIMD(row2);
+    minor0 = addSIMD(mulSIMD(row2, tmp), minor0);
+    minor2 = mulSIMD(row0, tmp);
+    tmp = swapHalvesSIMD(tmp);
+    minor0 = subSIMD(minor0, mulSIMD(row2, tmp));
+    minor2 = subSIMD(mulSIMD(row0, tmp), minor2);
+    minor2 = swapHalvesSIMD(minor2);
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row1));
+    minor2 = addSIMD(mulSIMD(row3, tmp), minor2);
+    minor3 = subSIMD(mulSIMD(row2, tmp), minor3);
+    tmp = swapHalvesSIMD(tmp);
+    minor2 = subSIMD(mulSIMD(row3, tmp), minor2);
+    minor3 = subSIMD(minor3, mulSIMD(row2, tmp));
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row3));
+    minor1 = subSIMD(minor1, mulSIMD(row2, tmp));
+    minor2 = addSIMD(mulSIMD(row1, tmp), minor2);
+    tmp = swapHalvesSIMD(tmp);
+    minor1 = addSIMD(mulSIMD(row2, tmp), minor1);
+    minor2 = subSIMD(minor2, mulSIMD(row1, tmp));
+
+    tmp = swapPairsSIMD(mulSIMD(row0, row2));
+    minor1 = addSIMD(mulSIMD(row3, tmp), minor1);
+    minor3 = subSIMD(minor3, mulSIMD(row1, tmp));
+    tmp = swapHalvesSIMD(tmp);
+    minor1 = subSIMD(minor1, mulSIMD(row3, tmp));
+    minor3 = addSIMD(mulSIMD(row1, tmp), minor3);
+
+    f32 det = sumOfSIMD(mulSIMD(row0, minor0));
+    if (!det) return m;
+
+    simd4 factor = splatSIMD(1.0f / det);
+    storeSIMD(out.X.components, mulSIMD(minor0, factor));
+    storeSIMD(out.Y.components, mulSIMD(minor1, factor));
+    storeSIMD(out.Z.components, mulSIMD(minor2, factor));
+    storeSIMD(out.W.components, mulSIMD(minor3, factor));
+
+    return out;
+#else
     f32 m11 = m.X.x,  m12 = m.X.y,  m13 = m.X.z, m14 = m.X.w,
         m21 = m.Y.x,  m22 = m.Y.y,  m23 = m.Y.z, m24 = m.Y.w,
         m31 = m.Z.x,  m32 = m.Z.y,  m33 = m.Z.z, m34 = m.Z.w,
@@ -162,6 +243,7 @@ INLINE mat4 invMat4(mat4 m) {
     out = scaleMat4(out, 1.0f / det);
 
     return out;
+#endif
 }
 
 INLINE void yawMat4(f32 amount, mat4 *out) {
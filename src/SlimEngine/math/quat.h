@@ -2,6 +2,7 @@
 
 #include "../core/base.h"
 #include "./vec3.h"
+#include "./simd.h"
 
 INLINE quat getIdentityQuaternion() {
     quat out;
@@ -15,9 +16,14 @@ INLINE quat getIdentityQuaternion() {
 INLINE quat normQuat(quat q) {
     quat out;
 
+#ifdef SLIM_ENGINE_SIMD
+    simd4 v = loadSIMD(&q.axis.x);
+    storeSIMD(&out.axis.x, mulSIMD(v, splatSIMD(1.0f / sqrtf(sumOfSIMD(mulSIMD(v, v))))));
+#else
     f32 factor = 1.0f / sqrtf(q.axis.x * q.axis.x + q.axis.y * q.axis.y + q.axis.z * q.axis.z + q.amount * q.amount);
     out.axis = scaleVec3(q.axis, factor);
     out.amount = q.amount * factor;
+#endif
 
     return out;
 }
@@ -30,6 +36,43 @@ INLINE vec3 mulVec3Quat(const vec3 v, quat q) {
     return out;
 }
 
+// Rotates an array of vectors (in place when in == out).
+// With SIMD, 4 vectors are rotated at a time with their x, y and z coordinates transposed into separate registers.
+INLINE void mulVec3ArrayQuat(const vec3 *in, u32 count, quat q, vec3 *out) {
+    u32 i = 0;
+#ifdef SLIM_ENGINE_SIMD
+    simd4 qx = splatSIMD(q.axis.x);
+    simd4 qy = splatSIMD(q.axis.y);
+    simd4 qz = splatSIMD(q.axis.z);
+    simd4 qw = splatSIMD(q.amount);
+    simd4 two = splatSIMD(2);
+    simd4 x, y, z, tx, ty, tz, ux, uy, uz;
+    f32 X[4], Y[4], Z[4];
+    for (; i + 4 <= count; i += 4, in += 4, out += 4) {
+        x = setSIMD(in[0].x, in[1].x, in[2].x, in[3].x);
+        y = setSIMD(in[0].y, in[1].y, in[2].y, in[3].y);
+        z = setSIMD(in[0].z, in[1].z, in[2].z, in[3].z);
+
+        // t = cross(q.axis, v), u = cross(q.axis, t), out = (t * q.amount + u) * 2 + v
+        tx = subSIMD(mulSIMD(qy, z), mulSIMD(qz, y));
+        ty = subSIMD(mulSIMD(qz, x), mulSIMD(qx, z));
+        tz = subSIMD(mulSIMD(qx, y), mulSIMD(qy, x));
+        ux = subSIMD(mulSIMD(qy, tz), mulSIMD(qz, ty));
+        uy = subSIMD(mulSIMD(qz, tx), mulSIMD(qx, tz));
+        uz = subSIMD(mulSIMD(qx, ty), mulSIMD(qy, tx));
+        storeSIMD(X, addSIMD(mulSIMD(addSIMD(mulSIMD(tx, qw), ux), two), x));
+        storeSIMD(Y, addSIMD(mulSIMD(addSIMD(mulSIMD(ty, qw), uy), two), y));
+        storeSIMD(Z, addSIMD(mulSIMD(addSIMD(mulSIMD(tz, qw), uz), two), z));
+        for (u8 j = 0; j < 4; j++) {
+            out[j].x = X[j];
+            out[j].y = Y[j];
+            out[j].z = Z[j];
+        }
+    }
+#endif
+    for (; i < count; i++, in++, out++) *out = mulVec3Quat(*in, q);
+}
+
 INLINE quat mulQuat(quat a, quat b) {
     quat out;
 
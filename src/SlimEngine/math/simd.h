@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../core/base.h"
+
+// The SIMD backend of the math library is chosen at compile time from the target's instruction set:
+// SSE on x86/x64 (SSE2 is the baseline, so builds targeting SSE4.1 or AVX2 use it as well) and NEON on ARM.
+// It can be disabled by defining SLIM_ENGINE_NO_SIMD (before including SlimEngine), which leaves the scalar code.
+//
+// The math API itself is unchanged: Functions still take and return their vectors and matrices by value,
+// and only their bodies load them into packed registers (using the thin wrappers below, shared by both backends).
+// The packed vec4/mat4/quat functions and the batch functions that transform arrays of points use them.
+#ifndef SLIM_ENGINE_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLIM_ENGINE_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SLIM_ENGINE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(SLIM_ENGINE_SIMD_SSE) || defined(SLIM_ENGINE_SIMD_NEON)
+#define SLIM_ENGINE_SIMD
+
+#ifdef SLIM_ENGINE_SIMD_SSE
+typedef __m128 simd4;
+
+INLINE simd4 loadSIMD(const f32 *from) { return _mm_loadu_ps(from); }
+INLINE void storeSIMD(f32 *to, simd4 v) { _mm_storeu_ps(to, v); }
+INLINE simd4 setSIMD(f32 x, f32 y, f32 z, f32 w) { return _mm_set_ps(w, z, y, x); }
+INLINE simd4 splatSIMD(f32 value) { return _mm_set1_ps(value); }
+INLINE simd4 addSIMD(simd4 a, simd4 b) { return _mm_add_ps(a, b); }
+INLINE simd4 subSIMD(simd4 a, simd4 b) { return _mm_sub_ps(a, b); }
+INLINE simd4 mulSIMD(simd4 a, simd4 b) { return _mm_mul_ps(a, b); }
+INLINE simd4 swapPairsSIMD(simd4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); } // (y, x, w, z)
+INLINE simd4 swapHalvesSIMD(simd4 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)); } // (z, w, x, y)
+INLINE f32 sumOfSIMD(simd4 v) {
+    v = _mm_add_ps(v, swapHalvesSIMD(v));
+    return _mm_cvtss_f32(_mm_add_ss(v, swapPairsSIMD(v)));
+}
+INLINE void transposeSIMD(simd4 *X, simd4 *Y, simd4 *Z, simd4 *W) { _MM_TRANSPOSE4_PS(*X, *Y, *Z, *W); }
+#else
+typedef float32x4_t simd4;
+
+INLINE simd4 loadSIMD(const f32 *from) { return vld1q_f32(from); }
+INLINE void storeSIMD(f32 *to, simd4 v) { vst1q_f32(to, v); }
+INLINE simd4 setSIMD(f32 x, f32 y, f32 z, f32 w) {
+    f32 values[4] = {x, y, z, w};
+    return vld1q_f32(values);
+}
+INLINE simd4 splatSIMD(f32 value) { return vdupq_n_f32(value); }
+INLINE simd4 addSIMD(simd4 a, simd4 b) { return vaddq_f32(a, b); }
+INLINE simd4 subSIMD(simd4 a, simd4 b) { return vsubq_f32(a, b); }
+INLINE simd4 mulSIMD(simd4 a, simd4 b) { return vmulq_f32(a, b); }
+INLINE simd4 swapPairsSIMD(simd4 v) { return vrev64q_f32(v); } // (y, x, w, z)
+INLINE simd4 swapHalvesSIMD(simd4 v) { return vextq_f32(v, v, 2); } // (z, w, x, y)
+INLINE f32 sumOfSIMD(simd4 v) {
+    float32x2_t sum = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+INLINE void transposeSIMD(simd4 *X, simd4 *Y, simd4 *Z, simd4 *W) {
+    float32x4x2_t XY = vtrnq_f32(*X, *Y);
+    float32x4x2_t ZW = vtrnq_f32(*Z, *W);
+    *X = vcombine_f32(vget_low_f32( XY.val[0]), vget_low_f32( ZW.val[0]));
+    *Y = vcombine_f32(vget_low_f32( XY.val[1]), vget_low_f32( ZW.val[1]));
+    *Z = vcombine_f32(vget_high_f32(XY.val[0]), vget_high_f32(ZW.val[0]));
+    *W = vcombine_f32(vget_high_f32(XY.val[1]), vget_high_f32(ZW.val[1]));
+}
+#endif
+
+// out = in.x * X + in.y * Y + in.z * Z + in.w * W (the rows of the matrix, already loaded)
+INLINE simd4 mulSIMDByRows(f32 x, f32 y, f32 z, f32 w, simd4 X, simd4 Y, simd4 Z, simd4 W) {
+    return addSIMD(addSIMD(addSIMD(
+            mulSIMD(splatSIMD(x), X),
+            mulSIMD(splatSIMD(y), Y)),
+            mulSIMD(splatSIMD(z), Z)),
+            mulSIMD(splatSIMD(w), W));
+}
+#endif
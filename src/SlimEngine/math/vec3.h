@@ -206,6 +206,17 @@ INLINE vec3 mulVec3Mat3(vec3 in, mat3 m) {
     return out;
 }
 
+// Transforms a position by an affine matrix (with the translation in W):
+INLINE vec3 mulVec3Mat3x4(vec3 in, mat3x4 m) {
+    vec3 out;
+
+    out.x = in.x * m.X.x + in.y * m.Y.x + in.z * m.Z.x + m.W.x;
+    out.y = in.x * m.X.y + in.y * m.Y.y + in.z * m.Z.y + m.W.y;
+    out.z = in.x * m.X.z + in.y * m.Y.z + in.z * m.Z.z + m.W.z;
+
+    return out;
+}
+
 INLINE f32 dotVec3(vec3 a, vec3 b) {
     return (
             (a.x * b.x) +
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/base.h"
+#include "./simd.h"
 
 INLINE vec4 getVec4Of(f32 value) {
     vec4 out;
@@ -96,14 +97,36 @@ INLINE vec4 scaleAddVec4(vec4 v, f32 factor, vec4 to_be_added) {
 INLINE vec4 mulVec4Mat4(vec4 in, mat4 m) {
     vec4 out;
 
+#ifdef SLIM_ENGINE_SIMD
+    storeSIMD(out.components, mulSIMDByRows(in.x, in.y, in.z, in.w,
+                                            loadSIMD(m.X.components),
+                                            loadSIMD(m.Y.components),
+                                            loadSIMD(m.Z.components),
+                                            loadSIMD(m.W.components)));
+#else
     out.x = in.x * m.X.x + in.y * m.Y.x + in.z * m.Z.x + in.w * m.W.x;
     out.y = in.x * m.X.y + in.y * m.Y.y + in.z * m.Z.y + in.w * m.W.y;
     out.z = in.x * m.X.z + in.y * m.Y.z + in.z * m.Z.z + in.w * m.W.z;
     out.w = in.x * m.X.w + in.y * m.Y.w + in.z * m.Z.w + in.w * m.W.w;
+#endif
 
     return out;
 }
 
+// Transforms an array of vectors (in place when in == out), loading the matrix only once.
+INLINE void mulVec4ArrayMat4(const vec4 *in, u32 count, mat4 m, vec4 *out) {
+#ifdef SLIM_ENGINE_SIMD
+    simd4 X = loadSIMD(m.X.components);
+    simd4 Y = loadSIMD(m.Y.components);
+    simd4 Z = loadSIMD(m.Z.components);
+    simd4 W = loadSIMD(m.W.components);
+    for (u32 i = 0; i < count; i++, in++, out++)
+        storeSIMD(out->components, mulSIMDByRows(in->x, in->y, in->z, in->w, X, Y, Z, W));
+#else
+    for (u32 i = 0; i < count; i++, in++, out++) *out = mulVec4Mat4(*in, m);
+#endif
+}
+
 INLINE f32 dotVec4(vec4 a, vec4 b) {
     return (
             (a.x * b.x) +
@@ -0,0 +1,614 @@
+#pragma once
+
+// A window-less platform layer for benchmarking.
+// The app is initialized exactly as it is for a window, and then a scripted camera path is replayed
+// for a fixed number of frames at each requested resolution, printing per-frame timing percentiles
+// along with a checksum of the final window content (to catch correctness regressions).
+//
+// Time as seen by the app is virtual and advances by a fixed step every frame, so that everything that
+// depends on delta_time (navigation, animation) is deterministic and the checksums are reproducible.
+// Frame timings are measured separately using the real (monotonic) clock.
+//
+// It also serves golden-image regression testing: The final frame can be written out as a (binary) PPM image,
+// and/or compared against a stored golden image with a per-channel tolerance - writing a diff image showing
+// the offending pixels in red. The process exits with a non-zero code if any pixel is out of tolerance.
+//
+// Instead of the scripted camera path, an input recording (see core/recording.h) can be replayed.
+// Recorded events are fed back at the frames they were recorded at, while time still advances by the fixed step.
+// The frame count is then that of the recording, and there are no warmup frames.
+//
+// The app's memory (holding the frame buffer and meshes) can be backed by 2MB huge pages using --large-pages.
+// Explicit huge pages (MAP_HUGETLB) are used when the system has them reserved, falling back to transparent huge pages.
+// Either way the app's memory then has a fixed capacity that can not grow (see initAppMemory).
+//
+// Work that the app splits across threads (see core/jobs.h) runs on as many threads as there are processors,
+// or as given by --threads (--threads 1 runs everything on the main thread).
+// An app that updates at a fixed time step (see core/simulation.h) updates and renders in turn, on the main thread,
+// running as many update steps per frame as the virtual time covers (one per frame at the default --fps of 60).
+//
+// Meshes load in the background (see MeshLoader), so they are waited for before the first frame (to draw all of them).
+//
+// The scene can be saved to a scene file (see scene/io.h) and loaded back into reset objects with --reload-scene,
+// before the first frame (so the frames only match those drawn without it when loading restores all of the scene).
+// With --reload-scene-changes the scene is saved with its primitives mirrored through the origin, followed by their
+// actual positions as changes (see saveSceneChangesToFile), so the frames only match when the journal is replayed.
+// With --reload-torn-scene the entry of the changes is then cut short (as by an interrupted save) and the file is loaded,
+// after which saving the actual positions again has to rewrite the file (instead of appending after the partial entry).
+//
+// As the app sees no time passing during a frame, dynamic resolution (see updateDynamicResolution) never kicks in.
+// The viewport can instead be given a fixed internal resolution with --resolution-scale (a fraction of the window's).
+//
+// Usage: <example> [--frames N] [--warmup N] [--fps N] [--resolution WIDTHxHEIGHT]... [--show-hud] [--antialias]
+//                  [--large-pages] [--threads N] [--resolution-scale S] [--replay INPUT_RECORDING]
+//                  [--reload-scene SCENE_FILE] [--reload-scene-changes SCENE_FILE] [--reload-torn-scene SCENE_FILE]
+//                  [--output IMAGE.ppm] [--golden IMAGE.ppm [--tolerance N] [--diff IMAGE.ppm]]
+//
+// (Replaying, image output and comparison use a single resolution: 640x480 unless one is given)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+#include "../viewport/navigation.h"
+#include "./threads.h"
+
+#define HEADLESS__TICKS_PER_SECOND 1000000
+#define HEADLESS__MAX_RESOLUTIONS 8
+#define HEADLESS_DEFAULT__FRAMES 300
+#define HEADLESS_DEFAULT__WARMUP_FRAMES 10
+#define HEADLESS_DEFAULT__FPS 60
+#define HEADLESS_DEFAULT__TOLERANCE 2
+
+typedef struct HeadlessSettings {
+    Dimensions resolutions[HEADLESS__MAX_RESOLUTIONS];
+    char *output_file, *golden_file, *diff_file, *replay_file, *scene_file;
+    u32 resolution_count, frames, warmup_frames, fps, tolerance, threads;
+    f32 resolution_scale;
+    bool show_hud, antialias, large_pages, scene_changes, torn_scene;
+} HeadlessSettings;
+
+u64 Headless_ticks;
+
+void Headless_setWindowTitle(char* str) {}
+void Headless_setCursorVisibility(bool on) {}
+void Headless_setWindowCapture(bool on) {}
+u64 Headless_getTicks() { return Headless_ticks; }
+void* Headless_getMemory(u64 size) { return calloc(1, (size_t)size); }
+void* Headless_reserveMemory(u64 size) {
+#ifdef _WIN32
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *address = mmap(null, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? null : address;
+#endif
+}
+bool Headless_commitMemory(void *address, u64 size) {
+#ifdef _WIN32
+    return VirtualAlloc((LPVOID)address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != null;
+#else
+    return mprotect(address, (size_t)size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+void* Headless_getLargePageMemory(u64 size) {
+#ifdef _WIN32
+    return null;
+#else
+    size = (size + MEMORY__LARGE_PAGE_SIZE - 1) / MEMORY__LARGE_PAGE_SIZE * MEMORY__LARGE_PAGE_SIZE;
+    void *address = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    address = mmap(null, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (address != MAP_FAILED) return address;
+
+    // Without reserved huge pages, ask for transparent huge pages over a 2MB-aligned range instead:
+    u8 *unaligned = (u8*)mmap(null, (size_t)(size + MEMORY__LARGE_PAGE_SIZE), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ((void*)unaligned == MAP_FAILED) return null;
+
+    u8 *aligned = (u8*)(((u64)unaligned + MEMORY__LARGE_PAGE_SIZE - 1) / MEMORY__LARGE_PAGE_SIZE * MEMORY__LARGE_PAGE_SIZE);
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, (size_t)size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+#endif
+}
+
+u32 Headless_getProcessorCount() {
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return (u32)system_info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+#endif
+}
+
+u64 Headless_getRealNanoseconds() {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (u64)((f64)counter.QuadPart * (1000000000.0 / (f64)frequency.QuadPart));
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ULL + (u64)now.tv_nsec;
+#endif
+}
+
+void Headless_closeFile(void *handle) { if (handle) fclose((FILE*)handle); }
+void* Headless_openFileForReading(const char* path) { return fopen(path, "rb"); }
+void* Headless_openFileForWriting(const char* path) { return fopen(path, "wb"); }
+void* Headless_openFileForAppending(const char* path) {
+    FILE *file = fopen(path, "r+b"); // Only an existing file
+    if (file && fseek(file, 0, SEEK_END)) {
+        fclose(file);
+        file = null;
+    }
+    return file;
+}
+bool Headless_readFromFile(void *out, unsigned long size, void *handle) {
+    return handle && fread(out, 1, (size_t)size, (FILE*)handle) == (size_t)size;
+}
+bool Headless_writeToFile(void *out, unsigned long size, void *handle) {
+    return handle && fwrite(out, 1, (size_t)size, (FILE*)handle) == (size_t)size;
+}
+#ifdef _WIN32
+void* Headless_mapFileForReading(const char* path, u64 *size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+    if (file == INVALID_HANDLE_VALUE) return null;
+
+    LARGE_INTEGER file_size;
+    HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart ?
+                     CreateFileMappingA(file, null, PAGE_WRITECOPY, 0, 0, null) : null;
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : null;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (data) *size = (u64)file_size.QuadPart;
+
+    return data;
+}
+void Headless_unmapFile(void *data, u64 size) { if (data) UnmapViewOfFile(data); }
+#else
+void* Headless_mapFileForReading(const char* path, u64 *size) {
+    int file = open(path, O_RDONLY);
+    if (file == -1) return null;
+
+    struct stat file_stat;
+    void *data = fstat(file, &file_stat) || !file_stat.st_size ? MAP_FAILED :
+                 mmap(null, (size_t)file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) return null;
+
+    *size = (u64)file_stat.st_size;
+    return data;
+}
+void Headless_unmapFile(void *data, u64 size) { if (data) munmap(data, (size_t)size); }
+#endif
+
+void Headless_mirrorPrimitives(Scene *scene) {
+    for (u32 i = 0; i < scene->settings.primitives; i++) {
+        scene->primitives[i].position = invertedVec3(scene->primitives[i].position);
+        scene->primitives[i].flags |= IS_DIRTY;
+    }
+}
+
+// Cuts the given number of bytes off the end of the file:
+bool Headless_truncateFile(char *file_path, long byte_count) {
+    FILE *file = fopen(file_path, "rb");
+    if (!file) return false;
+
+    long size = fseek(file, 0, SEEK_END) ? 0 : ftell(file) - byte_count;
+    void *content = size > 0 ? malloc((size_t)size) : null;
+    bool read = content && !fseek(file, 0, SEEK_SET) && fread(content, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+
+    file = read ? fopen(file_path, "wb") : null;
+    bool written = file && fwrite(content, 1, (size_t)size, file) == (size_t)size;
+    if (file) fclose(file);
+    free(content);
+
+    return written;
+}
+
+bool Headless_reloadScene(char *file_path, bool scene_changes, bool torn_scene) {
+    Scene *scene = &app->scene;
+    if (scene_changes) {
+        Headless_mirrorPrimitives(scene);
+        if (!saveSceneToFile(scene, file_path, &app->platform)) return false;
+
+        Headless_mirrorPrimitives(scene);
+        if (!saveSceneChangesToFile(scene, file_path, &app->platform) || scene->journal.entry_count != 1) return false;
+
+        if (torn_scene) {
+            if (!(Headless_truncateFile(file_path, 4) && loadSceneFromFile(scene, file_path, &app->platform)))
+                return false;
+
+            Headless_mirrorPrimitives(scene); // Loaded mirrored, as the entry of the actual positions was dropped
+            if (!saveSceneChangesToFile(scene, file_path, &app->platform) || scene->journal.entry_count != 0) return false;
+        }
+    } else if (!saveSceneToFile(scene, file_path, &app->platform))
+        return false;
+
+    for (u32 i = 0; i < scene->settings.cameras;    i++) initCamera(   scene->cameras    + i);
+    for (u32 i = 0; i < scene->settings.primitives; i++) initPrimitive(scene->primitives + i);
+    for (u32 i = 0; i < scene->settings.curves;     i++) initCurve(    scene->curves     + i);
+    for (u32 i = 0; i < scene->settings.boxes;      i++) initBox(      scene->boxes      + i);
+    for (u32 i = 0; i < scene->settings.grids;      i++) initGrid(     scene->grids      + i, 3, 3);
+    for (u32 i = 0; i < scene->settings.meshes;     i++) {
+        Mesh *mesh = scene->meshes + i;
+        for (u32 v = 0; v < mesh->vertex_count; v++) mesh->vertex_positions[v] = getVec3Of(0);
+    }
+
+    // Loading rebuilds the scene's pools from the loaded counts, so handles from before loading go stale:
+    ObjectHandle handle = getObjectHandle(&scene->primitive_pool, 0);
+    return loadSceneFromFile(scene, file_path, &app->platform) &&
+           !isValidObjectHandle(&scene->primitive_pool, handle) &&
+           scene->primitive_pool.count == scene->settings.primitives;
+}
+
+int Headless_compareFrameTimes(const void *a, const void *b) {
+    u64 A = *(const u64*)a;
+    u64 B = *(const u64*)b;
+    return A < B ? -1 : (A > B);
+}
+
+u64 Headless_getPercentile(u64 *sorted_frame_times, u32 frame_count, u32 percentile) {
+    u32 index = (u32)(((u64)(frame_count - 1) * percentile + 50) / 100);
+    return sorted_frame_times[index];
+}
+
+u64 Headless_getWindowContentChecksum(u32 *window_content, u32 pixel_count) {
+    // FNV-1a (64-bit) over the bytes of the final frame:
+    u64 checksum = 14695981039346656037ULL;
+    u8 *byte = (u8*)window_content;
+    for (u64 i = 0; i < (u64)pixel_count * 4; i++, byte++) {
+        checksum ^= *byte;
+        checksum *= 1099511628211ULL;
+    }
+    return checksum;
+}
+
+// The scripted camera path is split into 4 equal phases:
+// moving forward, turning right while strafing, orbiting around the target and then backing up while rising.
+void Headless_stepCameraScript(Viewport *viewport, u32 frame, u32 frame_count, f32 delta_time) {
+    NavigationMove *move = &viewport->navigation.move;
+    NavigationTurn *turn = &viewport->navigation.turn;
+    u32 phase = frame * 4 / frame_count;
+    move->forward  = phase == 0;
+    move->right    = phase == 1;
+    turn->right    = phase == 1;
+    move->backward = phase == 3;
+    move->up       = phase == 3;
+    if (phase == 2) orbitCamera(viewport->camera, delta_time * 0.5f, delta_time * 0.05f);
+    navigateViewport(viewport, delta_time);
+}
+
+void Headless_setDefaultSettings(HeadlessSettings *settings) {
+    settings->frames = HEADLESS_DEFAULT__FRAMES;
+    settings->warmup_frames = HEADLESS_DEFAULT__WARMUP_FRAMES;
+    settings->fps = HEADLESS_DEFAULT__FPS;
+    settings->tolerance = HEADLESS_DEFAULT__TOLERANCE;
+    settings->resolution_count = 0;
+    settings->threads = 0;
+    settings->resolution_scale = 1;
+    settings->output_file = settings->golden_file = settings->diff_file = settings->replay_file = settings->scene_file = null;
+    settings->show_hud = settings->antialias = settings->large_pages = settings->scene_changes = settings->torn_scene = false;
+}
+
+bool Headless_parseArguments(HeadlessSettings *settings, int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        char *argument = argv[i];
+        if (     !strcmp(argument, "--show-hud"))  { settings->show_hud  = true; continue; }
+        else if (!strcmp(argument, "--antialias")) { settings->antialias = true; continue; }
+        else if (!strcmp(argument, "--large-pages")) { settings->large_pages = true; continue; }
+
+        char *value = i + 1 < argc ? argv[i + 1] : null;
+        if (!value) return false;
+        i++;
+
+        if (     !strcmp(argument, "--output")) settings->output_file = value;
+        else if (!strcmp(argument, "--golden")) settings->golden_file = value;
+        else if (!strcmp(argument, "--diff"))   settings->diff_file   = value;
+        else if (!strcmp(argument, "--replay")) settings->replay_file = value;
+        else if (!strcmp(argument, "--reload-scene")) settings->scene_file = value;
+        else if (!strcmp(argument, "--reload-scene-changes")) {
+            settings->scene_file = value;
+            settings->scene_changes = true;
+        }
+        else if (!strcmp(argument, "--reload-torn-scene")) {
+            settings->scene_file = value;
+            settings->scene_changes = settings->torn_scene = true;
+        }
+        else if (!strcmp(argument, "--tolerance")) settings->tolerance = (u32)atoi(value);
+        else if (!strcmp(argument, "--threads")) {
+            settings->threads = (u32)atoi(value);
+            if (!settings->threads) return false;
+        }
+        else if (!strcmp(argument, "--resolution-scale")) {
+            settings->resolution_scale = (f32)atof(value);
+            if (settings->resolution_scale <= 0 || settings->resolution_scale > 1) return false;
+        }
+        else if (!strcmp(argument, "--frames")) {
+            settings->frames = (u32)atoi(value);
+            if (!settings->frames) return false;
+        } else if (!strcmp(argument, "--warmup")) settings->warmup_frames = (u32)atoi(value);
+        else if (!strcmp(argument, "--fps")) {
+            settings->fps = (u32)atoi(value);
+            if (!settings->fps) return false;
+        } else if (!strcmp(argument, "--resolution")) {
+            int width, height;
+            if (settings->resolution_count == HEADLESS__MAX_RESOLUTIONS ||
+                sscanf(value, "%dx%d", &width, &height) != 2 ||
+                width  <= 0 || width  > MAX_WIDTH ||
+                height <= 0 || height > MAX_HEIGHT)
+                return false;
+
+            Dimensions *resolution = &settings->resolutions[settings->resolution_count++];
+            resolution->width  = (u16)width;
+            resolution->height = (u16)height;
+        } else
+            return false;
+    }
+
+    if (settings->output_file || settings->golden_file || settings->replay_file) {
+        if (settings->resolution_count > 1) return false;
+        if (settings->resolution_count == 0) {
+            settings->resolutions[0].width = 640;
+            settings->resolutions[0].height = 480;
+            settings->resolution_count = 1;
+        }
+    } else if (!settings->resolution_count) {
+        settings->resolutions[0].width = 640;  settings->resolutions[0].height = 480;
+        settings->resolutions[1].width = 1280; settings->resolutions[1].height = 720;
+        settings->resolutions[2].width = 1920; settings->resolutions[2].height = 1080;
+        settings->resolution_count = 3;
+    }
+
+    return true;
+}
+
+bool Headless_writeImage(char *file_path, u32 *window_content, u16 width, u16 height) {
+    FILE *file = fopen(file_path, "wb");
+    if (!file) return false;
+
+    fprintf(file, "P6\n%u %u\n255\n", (unsigned int)width, (unsigned int)height);
+    RGBA2u32 pixel;
+    u8 rgb[3];
+    bool written = true;
+    for (u32 i = 0; i < (u32)width * (u32)height && written; i++) {
+        pixel.value = window_content[i];
+        rgb[0] = pixel.rgba.R;
+        rgb[1] = pixel.rgba.G;
+        rgb[2] = pixel.rgba.B;
+        written = fwrite(rgb, 1, 3, file) == 3;
+    }
+    fclose(file);
+
+    return written;
+}
+
+u8* Headless_readImage(char *file_path, u16 *width, u16 *height) {
+    FILE *file = fopen(file_path, "rb");
+    if (!file) return null;
+
+    unsigned int w, h, max_value;
+    u8 *rgb = null;
+    if (fscanf(file, "P6 %u %u %u", &w, &h, &max_value) == 3 && max_value == 255 && fgetc(file) != EOF &&
+        w && w <= MAX_WIDTH &&
+        h && h <= MAX_HEIGHT) {
+        rgb = (u8*)malloc(w * h * 3);
+        if (rgb && fread(rgb, 1, w * h * 3, file) != w * h * 3) {
+            free(rgb);
+            rgb = null;
+        }
+        *width  = (u16)w;
+        *height = (u16)h;
+    }
+    fclose(file);
+
+    return rgb;
+}
+
+INLINE u8 Headless_getChannelDifference(u8 a, u8 b) {
+    return a > b ? a - b : b - a;
+}
+
+// Returns the number of pixels that have any channel differing from the golden image by more than the tolerance.
+// The diff image shows these pixels in red over a dimmed version of the golden image.
+u32 Headless_compareWithGolden(HeadlessSettings *settings, u32 *window_content, u16 width, u16 height) {
+    u16 golden_width, golden_height;
+    u8 *golden = Headless_readImage(settings->golden_file, &golden_width, &golden_height);
+    if (!golden) {
+        printf("Could not read the golden image: %s\n", settings->golden_file);
+        return (u32)width * (u32)height;
+    }
+    if (golden_width != width || golden_height != height) {
+        printf("Golden image is %ux%u but the frame is %ux%u\n",
+               (unsigned int)golden_width, (unsigned int)golden_height, (unsigned int)width, (unsigned int)height);
+        free(golden);
+        return (u32)width * (u32)height;
+    }
+
+    u32 *diff = settings->diff_file ? (u32*)malloc(sizeof(u32) * width * height) : null;
+    u32 mismatches = 0;
+    u8 max_difference = 0;
+    RGBA2u32 pixel, diff_pixel;
+    u8 *golden_pixel = golden;
+    for (u32 i = 0; i < (u32)width * (u32)height; i++, golden_pixel += 3) {
+        pixel.value = window_content[i];
+        u8 difference = Headless_getChannelDifference(pixel.rgba.R, golden_pixel[0]);
+        u8 G_difference = Headless_getChannelDifference(pixel.rgba.G, golden_pixel[1]);
+        u8 B_difference = Headless_getChannelDifference(pixel.rgba.B, golden_pixel[2]);
+        if (G_difference > difference) difference = G_difference;
+        if (B_difference > difference) difference = B_difference;
+        if (difference > max_difference) max_difference = difference;
+
+        bool is_mismatch = difference > settings->tolerance;
+        if (is_mismatch) mismatches++;
+        if (diff) {
+            diff_pixel.rgba.R = is_mismatch ? MAX_COLOR_VALUE : golden_pixel[0] / 4;
+            diff_pixel.rgba.G = is_mismatch ? 0 : golden_pixel[1] / 4;
+            diff_pixel.rgba.B = is_mismatch ? 0 : golden_pixel[2] / 4;
+            diff_pixel.rgba.A = MAX_COLOR_VALUE;
+            diff[i] = diff_pixel.value;
+        }
+    }
+    printf("Compared against %s: %u pixels out of tolerance (%u), max channel difference %u\n",
+           settings->golden_file, (unsigned int)mismatches, (unsigned int)settings->tolerance, (unsigned int)max_difference);
+
+    if (diff) {
+        Headless_writeImage(settings->diff_file, diff, width, height);
+        free(diff);
+    }
+    free(golden);
+
+    return mismatches;
+}
+
+char* Headless_getProgramName(char *path) {
+    char *name = path;
+    for (char *c = path; *c; c++)
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
+
+    return name;
+}
+
+int Headless_run(int argc, char **argv) {
+    HeadlessSettings settings;
+    Headless_setDefaultSettings(&settings);
+    if (!Headless_parseArguments(&settings, argc, argv)) {
+        printf("Usage: %s [--frames N] [--warmup N] [--fps N] [--resolution WIDTHxHEIGHT]... [--show-hud] [--antialias]\n"
+               "       [--large-pages] [--threads N] [--resolution-scale S] [--replay INPUT_RECORDING]\n"
+               "       [--reload-scene SCENE_FILE] [--reload-scene-changes SCENE_FILE] [--reload-torn-scene SCENE_FILE]\n"
+               "       [--output IMAGE.ppm] [--golden IMAGE.ppm [--tolerance N] [--diff IMAGE.ppm]]\n", argv[0]);
+        return -1;
+    }
+
+    app = (App*)calloc(1, sizeof(App));
+    if (!app) return -1;
+
+    u32 *window_content = (u32*)calloc(MAX_WIDTH * MAX_HEIGHT, sizeof(u32));
+    if (!window_content) return -1;
+
+    app->controls.key_map.space = ' ';
+    app->controls.key_map.shift = 16;
+    app->controls.key_map.ctrl  = 17;
+    app->controls.key_map.alt   = 18;
+    app->controls.key_map.tab   = 9;
+
+    app->platform.ticks_per_second    = HEADLESS__TICKS_PER_SECOND;
+    app->platform.getTicks            = Headless_getTicks;
+    app->platform.getMemory           = Headless_getMemory;
+    app->platform.reserveMemory       = Headless_reserveMemory;
+    app->platform.commitMemory        = Headless_commitMemory;
+    app->platform.getLargePageMemory  = settings.large_pages ? Headless_getLargePageMemory : null;
+    app->platform.setWindowTitle      = Headless_setWindowTitle;
+    app->platform.setWindowCapture    = Headless_setWindowCapture;
+    app->platform.setCursorVisibility = Headless_setCursorVisibility;
+    app->platform.closeFile           = Headless_closeFile;
+    app->platform.openFileForReading  = Headless_openFileForReading;
+    app->platform.openFileForWriting  = Headless_openFileForWriting;
+    app->platform.openFileForAppending = Headless_openFileForAppending;
+    app->platform.readFromFile        = Headless_readFromFile;
+    app->platform.writeToFile         = Headless_writeToFile;
+    app->platform.mapFileForReading   = Headless_mapFileForReading;
+    app->platform.unmapFile           = Headless_unmapFile;
+    setPlatformThreads(&app->platform); // The job system's threads, which leave one for loading meshes (see MeshLoader)
+    app->platform.thread_count        = settings.threads ? settings.threads : Headless_getProcessorCount();
+    if (app->platform.thread_count > PARALLEL__MAX_THREADS) app->platform.thread_count = PARALLEL__MAX_THREADS;
+
+    Defaults defaults;
+    _initApp(&defaults, window_content);
+    if (!app->is_running) return -1;
+    finishLoadingMeshes(&app->scene.mesh_loader);
+    if (settings.show_hud)  app->viewport.settings.show_hud  = true;
+    if (settings.antialias) app->viewport.settings.antialias = true;
+    if (settings.resolution_scale != 1) setViewportResolutionScale(&app->viewport, settings.resolution_scale);
+    if (settings.scene_file && !Headless_reloadScene(settings.scene_file, settings.scene_changes, settings.torn_scene)) {
+        printf("Could not reload the scene from: %s\n", settings.scene_file);
+        return -1;
+    }
+
+    if (settings.replay_file) {
+        settings.frames = getInputRecordingFrameCount(settings.replay_file, &app->platform);
+        settings.warmup_frames = 0;
+        if (!settings.frames || !startInputReplay(&app->input_recording, settings.replay_file, &app->platform)) {
+            printf("Could not read the input recording: %s\n", settings.replay_file);
+            return -1;
+        }
+    }
+    u64 *frame_times = (u64*)malloc(sizeof(u64) * settings.frames);
+    if (!frame_times) return -1;
+
+    Camera initial_camera = *app->viewport.camera;
+    u64 ticks_per_frame = HEADLESS__TICKS_PER_SECOND / settings.fps;
+    f32 delta_time = (f32)ticks_per_frame / (f32)HEADLESS__TICKS_PER_SECOND;
+    char *name = Headless_getProgramName(argv[0]);
+
+    for (u32 r = 0; r < settings.resolution_count; r++) {
+        Dimensions *resolution = &settings.resolutions[r];
+        *app->viewport.camera = initial_camera;
+        _windowResize(resolution->width, resolution->height);
+
+        for (u32 frame = 0; frame < settings.warmup_frames + settings.frames; frame++) {
+            bool is_measured = frame >= settings.warmup_frames;
+            Headless_ticks += ticks_per_frame;
+            if (settings.replay_file)
+                _replayInputEvents();
+            else if (is_measured)
+                Headless_stepCameraScript(&app->viewport, frame - settings.warmup_frames, settings.frames, delta_time);
+
+            u64 before = Headless_getRealNanoseconds();
+            _windowRedraw();
+            u64 after = Headless_getRealNanoseconds();
+            if (is_measured) frame_times[frame - settings.warmup_frames] = after - before;
+        }
+
+        u64 total = 0;
+        for (u32 i = 0; i < settings.frames; i++) total += frame_times[i];
+        qsort(frame_times, settings.frames, sizeof(u64), Headless_compareFrameTimes);
+
+        printf("%s %ux%u frames=%u min=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus max=%.1fus mean=%.1fus checksum=%016llx\n",
+               name, (unsigned int)resolution->width, (unsigned int)resolution->height, (unsigned int)settings.frames,
+               (f64)frame_times[0] / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 50) / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 90) / 1000.0,
+               (f64)Headless_getPercentile(frame_times, settings.frames, 99) / 1000.0,
+               (f64)frame_times[settings.frames - 1] / 1000.0,
+               (f64)total / (f64)settings.frames / 1000.0,
+               (unsigned long long)Headless_getWindowContentChecksum(window_content, (u32)resolution->width * (u32)resolution->height));
+    }
+
+    // The window's dimensions (the viewport may only cover a region of the window, see viewport/compositor.h):
+    u16 width  = settings.resolutions[settings.resolution_count - 1].width;
+    u16 height = settings.resolutions[settings.resolution_count - 1].height;
+    if (settings.output_file && !Headless_writeImage(settings.output_file, window_content, width, height)) {
+        printf("Could not write the output image: %s\n", settings.output_file);
+        return -1;
+    }
+    if (settings.golden_file && Headless_compareWithGolden(&settings, window_content, width, height))
+        return 1;
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int result = Headless_run(argc, argv);
+    if (app) shutDownJobSystem(&app->platform);
+
+    return result;
+}
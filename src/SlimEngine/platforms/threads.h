@@ -0,0 +1,106 @@
+#pragma once
+
+// The threads and semaphore of the job system (see core/jobs.h), on Windows or POSIX, shared by the platforms:
+// Threads are started into a fixed table, so that they can all be joined when the job system is shut down,
+// and the job system's threads sleep on a single counting semaphore while there are no jobs.
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <errno.h>
+#endif
+
+#include "../core/types.h"
+
+typedef struct Threads_Thread {
+    CallbackForThread thread;
+    void *data;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+} Threads_Thread;
+Threads_Thread Threads_threads[PARALLEL__MAX_THREADS];
+u32 Threads_thread_count;
+
+#ifdef _WIN32
+DWORD WINAPI Threads_runThread(LPVOID parameter) {
+    Threads_Thread *thread = (Threads_Thread*)parameter;
+    thread->thread(thread->data);
+    return 0;
+}
+bool Threads_startThread(CallbackForThread thread, void *data) {
+    if (Threads_thread_count == PARALLEL__MAX_THREADS) return false;
+
+    Threads_Thread *new_thread = Threads_threads + Threads_thread_count;
+    new_thread->thread = thread;
+    new_thread->data = data;
+    new_thread->handle = CreateThread(null, 0, Threads_runThread, new_thread, 0, null);
+    if (!new_thread->handle) return false;
+
+    Threads_thread_count++;
+    return true;
+}
+void Threads_joinThreads() {
+    for (u32 i = 0; i < Threads_thread_count; i++) {
+        WaitForSingleObject(Threads_threads[i].handle, INFINITE);
+        CloseHandle(Threads_threads[i].handle);
+    }
+    Threads_thread_count = 0;
+}
+void  Threads_yieldThread() { SwitchToThread(); }
+void* Threads_createSemaphore() { return CreateSemaphoreA(null, 0, 0x7FFFFFFF, null); }
+void  Threads_signalSemaphore(void *semaphore, u32 count) { ReleaseSemaphore((HANDLE)semaphore, (LONG)count, null); }
+void  Threads_waitForSemaphore(void *semaphore) { WaitForSingleObject((HANDLE)semaphore, INFINITE); }
+#else
+void* Threads_runThread(void *parameter) {
+    Threads_Thread *thread = (Threads_Thread*)parameter;
+    thread->thread(thread->data);
+    return null;
+}
+bool Threads_startThread(CallbackForThread thread, void *data) {
+    if (Threads_thread_count == PARALLEL__MAX_THREADS) return false;
+
+    Threads_Thread *new_thread = Threads_threads + Threads_thread_count;
+    new_thread->thread = thread;
+    new_thread->data = data;
+    if (pthread_create(&new_thread->handle, null, Threads_runThread, new_thread)) return false;
+
+    Threads_thread_count++;
+    return true;
+}
+void Threads_joinThreads() {
+    for (u32 i = 0; i < Threads_thread_count; i++) pthread_join(Threads_threads[i].handle, null);
+    Threads_thread_count = 0;
+}
+sem_t Threads_semaphore;
+void  Threads_yieldThread() { sched_yield(); }
+void* Threads_createSemaphore() {
+    // Unnamed semaphores are not supported everywhere (sem_init fails on macOS), and the job system then has no threads:
+    if (!sem_init(&Threads_semaphore, 0, 0)) return &Threads_semaphore;
+
+    printf("Could not create a semaphore (%s), so jobs will only run on the main thread\n", strerror(errno));
+    return null;
+}
+void  Threads_signalSemaphore(void *semaphore, u32 count) { while (count--) sem_post((sem_t*)semaphore); }
+void  Threads_waitForSemaphore(void *semaphore) { while (sem_wait((sem_t*)semaphore) && errno == EINTR); }
+#endif
+
+void setPlatformThreads(Platform *platform) {
+    platform->startThread      = Threads_startThread;
+    platform->joinThreads      = Threads_joinThreads;
+    platform->yieldThread      = Threads_yieldThread;
+    platform->createSemaphore  = Threads_createSemaphore;
+    platform->signalSemaphore  = Threads_signalSemaphore;
+    platform->waitForSemaphore = Threads_waitForSemaphore;
+}
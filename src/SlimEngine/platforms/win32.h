@@ -1,5 +1,6 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include "./threads.h"
 
 #ifndef NDEBUG
 #include <tchar.h>
@@ -60,6 +61,45 @@ u64 Win32_getTicks() {
 void* Win32_getMemory(u64 size) {
     return VirtualAlloc((LPVOID)MEMORY_BASE, (SIZE_T)size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
 }
+void* Win32_reserveMemory(u64 size) {
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS);
+}
+bool Win32_commitMemory(void *address, u64 size) {
+    return VirtualAlloc((LPVOID)address, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != null;
+}
+// Large pages have to be committed up-front, and require the 'Lock pages in memory' privilege to be granted to the user.
+void* Win32_getLargePageMemory(u64 size) {
+    HANDLE token;
+    TOKEN_PRIVILEGES privileges;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) return null;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = (
+        LookupPrivilegeValue(null, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, null, null) &&
+        GetLastError() == ERROR_SUCCESS
+    );
+    CloseHandle(token);
+    if (!enabled) return null;
+
+    SIZE_T large_page_size = GetLargePageMinimum();
+    if (!large_page_size) return null;
+
+    size = (size + large_page_size - 1) / large_page_size * large_page_size;
+    return VirtualAlloc(null, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
+// Returns the rest of the command line after the given option, or null if the command line does not contain it.
+char* Win32_getCommandLineOption(char *command_line, char *option) {
+    for (; *command_line; command_line++) {
+        char *o = option;
+        char *c = command_line;
+        while (*o && *o == *c) { o++; c++; }
+        if (!*o) return c;
+    }
+
+    return null;
+}
 
 inline UINT getRawInput(LPVOID data) {
     return GetRawInputData(raw_input_handle, RID_INPUT, data, raw_input_size_ptr, raw_input_header_size);
@@ -99,7 +139,7 @@ void* Win32_openFileForWriting(const char* path) {
                                GENERIC_WRITE,          // open for writing
                                0,                      // do not share
                                null,                   // default security
-                               OPEN_ALWAYS,            // create new or open existing
+                               CREATE_ALWAYS,          // create new or truncate existing
                                FILE_ATTRIBUTE_NORMAL,  // normal file
                                null);
 #ifndef NDEBUG
@@ -111,6 +151,16 @@ void* Win32_openFileForWriting(const char* path) {
 #endif
     return handle;
 }
+void* Win32_openFileForAppending(const char* path) {
+    HANDLE handle = CreateFile(path,           // file to open
+                               FILE_APPEND_DATA,       // open for writing at its end
+                               0,                      // do not share
+                               null,                   // default security
+                               OPEN_EXISTING,          // existing file only
+                               FILE_ATTRIBUTE_NORMAL,  // normal file
+                               null);
+    return handle == INVALID_HANDLE_VALUE ? null : handle;
+}
 bool Win32_readFromFile(LPVOID out, DWORD size, HANDLE handle) {
     DWORD bytes_read = 0;
     BOOL result = ReadFile(handle, out, size, &bytes_read, null);
@@ -137,6 +187,108 @@ bool Win32_writeToFile(LPVOID out, DWORD size, HANDLE handle) {
     return result != FALSE;
 }
 
+void* Win32_mapFileForReading(const char* path, u64 *size) {
+    HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+    if (file == INVALID_HANDLE_VALUE) return null;
+
+    LARGE_INTEGER file_size;
+    HANDLE mapping = GetFileSizeEx(file, &file_size) && file_size.QuadPart ?
+                     CreateFileMapping(file, null, PAGE_WRITECOPY, 0, 0, null) : null;
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : null;
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    if (data) *size = (u64)file_size.QuadPart;
+
+    return data;
+}
+void Win32_unmapFile(void *data, u64 size) { if (data) UnmapViewOfFile(data); }
+
+// When the app updates at a fixed time step (see core/simulation.h) the main thread handles the messages and updates,
+// while snapshots are rendered (and presented) on a thread of their own, that is woken up whenever one is published.
+// The thread presents the viewport of each snapshot at its own size (the window may have been resized since).
+CRITICAL_SECTION Win32_snapshot_lock;
+HANDLE Win32_snapshot_published;
+bool Win32_is_rendering_separately = false;
+
+DWORD WINAPI Win32_renderSceneSnapshots(LPVOID parameter) {
+    BITMAPINFO render_info = info;
+    u64 last_frame_ticks = 0;
+    while (app->is_running) {
+        WaitForSingleObject(Win32_snapshot_published, INFINITE);
+        if (!app->is_running) break;
+
+        if (app->max_frames_per_second) {
+            u64 ticks_per_frame = Win32_ticksPerSecond / app->max_frames_per_second;
+            u64 ticks_since_last_frame = Win32_getTicks() - last_frame_ticks;
+            if (ticks_since_last_frame < ticks_per_frame)
+                Sleep((DWORD)((ticks_per_frame - ticks_since_last_frame) * 1000 / Win32_ticksPerSecond));
+        }
+        last_frame_ticks = Win32_getTicks();
+
+        EnterCriticalSection(&Win32_snapshot_lock);
+        SceneSnapshot *snapshot = acquireSceneSnapshot(&app->simulation);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+        if (!snapshot) continue;
+
+        _renderSceneSnapshot(snapshot);
+        render_info.bmiHeader.biWidth  =  (LONG)getViewportWindowWidth( &snapshot->viewport);
+        render_info.bmiHeader.biHeight = -(LONG)getViewportWindowHeight(&snapshot->viewport);
+        SetDIBitsToDevice(win_dc,
+                          0, 0, (DWORD)render_info.bmiHeader.biWidth, (DWORD)-render_info.bmiHeader.biHeight,
+                          0, 0, 0, (UINT)-render_info.bmiHeader.biHeight,
+                          app->window_content, &render_info, DIB_RGB_COLORS);
+
+        EnterCriticalSection(&Win32_snapshot_lock);
+        releaseSceneSnapshot(&app->simulation, snapshot);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+    }
+
+    return 0;
+}
+
+// Updates for as long as the app is running, waiting for messages in between steps.
+// Without a thread to render on, this returns right away (and the app updates and renders in turn, on every redraw):
+void Win32_simulate() {
+    Win32_snapshot_published = CreateEventA(null, FALSE, FALSE, null);
+    if (!Win32_snapshot_published) return;
+
+    InitializeCriticalSection(&Win32_snapshot_lock);
+    HANDLE render_thread = CreateThread(null, 0, Win32_renderSceneSnapshots, null, 0, null);
+    if (!render_thread) {
+        DeleteCriticalSection(&Win32_snapshot_lock);
+        CloseHandle(Win32_snapshot_published);
+        return;
+    }
+    Win32_is_rendering_separately = true;
+    profiler_ignores_this_thread = true;
+
+    MSG message;
+    Simulation *simulation = &app->simulation;
+    while (app->is_running) {
+        while (PeekMessageA(&message, null, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&message);
+            DispatchMessageA(&message);
+        }
+        if (!app->is_running) break;
+
+        bool has_stepped = _simulate() != 0;
+        EnterCriticalSection(&Win32_snapshot_lock);
+        bool published = _publishSceneSnapshot(has_stepped);
+        LeaveCriticalSection(&Win32_snapshot_lock);
+        if (published) SetEvent(Win32_snapshot_published);
+
+        u64 ticks_until_next_step = simulation->ticks_per_step - simulation->accumulated_ticks;
+        DWORD milliseconds = (DWORD)(ticks_until_next_step * 1000 / Win32_ticksPerSecond);
+        if (milliseconds) MsgWaitForMultipleObjects(0, null, FALSE, milliseconds, QS_ALLINPUT);
+    }
+
+    SetEvent(Win32_snapshot_published);
+    WaitForSingleObject(render_thread, INFINITE);
+    CloseHandle(render_thread);
+    CloseHandle(Win32_snapshot_published);
+    DeleteCriticalSection(&Win32_snapshot_lock);
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     switch (message) {
         case WM_DESTROY:
@@ -155,9 +307,17 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             break;
 
         case WM_PAINT:
+            // When rendering on a separate thread, only that thread presents (see Win32_renderSceneSnapshots):
+            if (Win32_is_rendering_separately) {
+                app->needs_redraw = true;
+                ValidateRgn(window, null);
+                break;
+            }
+
+            // The window's size (the viewport may cover only a region of it, or render at a lower resolution):
             SetDIBitsToDevice(win_dc,
-                              0, 0, app->viewport.dimensions.width, app->viewport.dimensions.height,
-                              0, 0, 0, app->viewport.dimensions.height,
+                              0, 0, (DWORD)info.bmiHeader.biWidth, (DWORD)-info.bmiHeader.biHeight,
+                              0, 0, 0, (UINT)-info.bmiHeader.biHeight,
                               app->window_content, &info, DIB_RGB_COLORS);
 
             ValidateRgn(window, null);
@@ -230,18 +390,37 @@ int APIENTRY WinMain(HINSTANCE hInstance,
     app->platform.ticks_per_second    = Win32_ticksPerSecond;
     app->platform.getTicks            = Win32_getTicks;
     app->platform.getMemory           = Win32_getMemory;
+    app->platform.reserveMemory       = Win32_reserveMemory;
+    app->platform.commitMemory        = Win32_commitMemory;
+    app->platform.getLargePageMemory  = Win32_getCommandLineOption(lpCmdLine, (char*)"--large-pages") ? Win32_getLargePageMemory : null;
     app->platform.setWindowTitle      = Win32_setWindowTitle;
     app->platform.setWindowCapture    = Win32_setWindowCapture;
     app->platform.setCursorVisibility = Win32_setCursorVisibility;
     app->platform.closeFile           = Win32_closeFile;
     app->platform.openFileForReading  = Win32_openFileForReading;
     app->platform.openFileForWriting  = Win32_openFileForWriting;
+    app->platform.openFileForAppending = Win32_openFileForAppending;
     app->platform.readFromFile        = Win32_readFromFile;
     app->platform.writeToFile         = Win32_writeToFile;
+    app->platform.mapFileForReading   = Win32_mapFileForReading;
+    app->platform.unmapFile           = Win32_unmapFile;
+    setPlatformThreads(&app->platform); // The job system's threads, which leave one for loading meshes (see MeshLoader)
+
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    app->platform.thread_count = (u32)system_info.dwNumberOfProcessors;
+    if (app->platform.thread_count > PARALLEL__MAX_THREADS) app->platform.thread_count = PARALLEL__MAX_THREADS;
 
     Defaults defaults;
     _initApp(&defaults, (u32*)window_content_memory);
 
+    // Input can be recorded for a later replay (see platforms/headless.h) using: <example>.exe --record <file path>
+    // The app's memory can be backed by large pages using: <example>.exe --large-pages (before any --record option)
+    // It then has a fixed capacity that can not grow (see initAppMemory).
+    char *record_file_path = Win32_getCommandLineOption(lpCmdLine, (char*)"--record ");
+    if (record_file_path && *record_file_path)
+        startInputRecording(&app->input_recording, record_file_path, &app->platform);
+
     info.bmiHeader.biSize        = sizeof(info.bmiHeader);
     info.bmiHeader.biCompression = BI_RGB;
     info.bmiHeader.biBitCount    = 32;
@@ -292,15 +471,42 @@ int APIENTRY WinMain(HINSTANCE hInstance,
 
     ShowWindow(window, nCmdShow);
 
+    if (isSimulating(&app->on)) Win32_simulate();
+
+    // With render on demand the loop sleeps until a message arrives whenever there is nothing new to draw,
+    // and with a frame cap it sleeps between frames (still waking up for messages, so input is handled on time).
+    // While meshes are loading it only sleeps briefly, to draw each mesh soon after it is loaded:
     MSG message;
+    u64 last_frame_ticks = 0;
     while (app->is_running) {
         while (PeekMessageA(&message, null, 0, 0, PM_REMOVE)) {
             TranslateMessage(&message);
             DispatchMessageA(&message);
         }
+        if (!app->is_running) break;
+        bool is_loading_meshes = isLoadingMeshes(&app->scene.mesh_loader);
+        if (!_isRedrawNeeded()) {
+            if (is_loading_meshes)
+                MsgWaitForMultipleObjects(0, null, FALSE, 10, QS_ALLINPUT);
+            else
+                WaitMessage();
+            continue;
+        }
+        if (app->max_frames_per_second) {
+            u64 ticks_per_frame = Win32_ticksPerSecond / app->max_frames_per_second;
+            u64 ticks_since_last_frame = Win32_getTicks() - last_frame_ticks;
+            if (ticks_since_last_frame < ticks_per_frame) {
+                DWORD milliseconds = (DWORD)((ticks_per_frame - ticks_since_last_frame) * 1000 / Win32_ticksPerSecond);
+                if (milliseconds) MsgWaitForMultipleObjects(0, null, FALSE, milliseconds, QS_ALLINPUT);
+                continue;
+            }
+        }
+        last_frame_ticks = Win32_getTicks();
         _windowRedraw();
         InvalidateRgn(window, null, false);
     }
+    stopInputRecording(&app->input_recording, &app->platform);
+    shutDownJobSystem(&app->platform);
 
     return 0;
 }
\ No newline at end of file
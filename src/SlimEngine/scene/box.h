@@ -5,25 +5,24 @@
 #include "../math/vec3.h"
 #include "../shapes/edge.h"
 #include "./primitive.h"
+#include "../core/profiler.h"
+#include "./xform.h"
 
 void transformBoxVerticesFromObjectToViewSpace(BoxVertices *vertices, BoxVertices *transformed_vertices, Primitive *primitive, Viewport *viewport) {
-    vec3 position;
-    for (u8 i = 0; i < BOX__VERTEX_COUNT; i++) {
-        position = vertices->buffer[i];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(    position, viewport->camera->transform.position);
-        position = mulVec3Quat(position, viewport->camera->transform.rotation_inverted);
-        transformed_vertices->buffer[i] = position;
-    }
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    for (u8 i = 0; i < BOX__VERTEX_COUNT; i++)
+        transformed_vertices->buffer[i] = mulVec3Mat3x4(vertices->buffer[i], object_to_view);
 }
 
 void drawBox(Box *box, u8 sides, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawBox");
+
     // Transform vertices positions from local-space to world-space and then to view-space:
-    static BoxVertices vertices;
+    BoxVertices vertices;
     transformBoxVerticesFromObjectToViewSpace(&box->vertices, &vertices, primitive, viewport);
 
     // Distribute transformed vertices positions to edges:
-    static BoxEdges edges;
+    BoxEdges edges;
     setBoxEdgesFromVertices(&edges, &vertices);
 
     if (sides == BOX__ALL_SIDES) {
@@ -43,14 +42,18 @@ void drawBox(Box *box, u8 sides, Primitive *primitive, vec3 color, f32 opacity,
         if (sides & Right | sides & Top   ) drawEdge(&edges.sides.right_top,    color, opacity, line_width, viewport);
         if (sides & Right | sides & Bottom) drawEdge(&edges.sides.right_bottom, color, opacity, line_width, viewport);
     }
+
+    PROFILE_END();
 }
 
 void drawCamera(Camera *camera, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    static Box box;
-    static Primitive primitive;
+    PROFILE_BEGIN("drawCamera");
+
+    Box box;
+    Primitive primitive;
     initBox(&box);
     primitive.flags = ALL_FLAGS;
-    primitive.rotation = camera->transform.rotation;
+    primitive.rotation = getXform3Rotation(&camera->transform);
     primitive.position = camera->transform.position;
     primitive.scale.x  = primitive.scale.y = primitive.scale.z = 1;
     drawBox(&box, BOX__ALL_SIDES, &primitive, color, opacity, line_width, viewport);
@@ -65,4 +68,6 @@ void drawCamera(Camera *camera, vec3 color, f32 opacity, u8 line_width, Viewport
     for (u8 i = 0; i < BOX__VERTEX_COUNT; i++)
         box.vertices.buffer[i].z += 1.5f;
     drawBox(&box, BOX__ALL_SIDES, &primitive, color, opacity, line_width, viewport);
+
+    PROFILE_END();
 }
\ No newline at end of file
@@ -84,6 +84,9 @@ void setMeshToCube(Mesh *mesh) {
     mesh->normals_count  = CUBE__NORMAL_COUNT;
     mesh->uvs_count      = CUBE__UV_COUNT;
 
+    // The cube's arrays are constant, so nothing is to be loaded into them:
+    mesh->triangle_capacity = mesh->vertex_capacity = mesh->edge_capacity = mesh->normals_capacity = mesh->uvs_capacity = 0;
+
     mesh->vertex_uvs       = (vec2*)CUBE__VERTEX_UVS;
     mesh->vertex_normals   = (vec3*)CUBE__VERTEX_NORMALS;
     mesh->vertex_positions = (vec3*)CUBE__VERTEX_POSITIONS;
@@ -91,4 +94,5 @@ void setMeshToCube(Mesh *mesh) {
     mesh->vertex_uvs_indices      = (TriangleVertexIndices*)CUBE__VERTEX_UV_INDICES;
     mesh->vertex_normal_indices   = (TriangleVertexIndices*)CUBE__VERTEX_NORMAL_INDICES;
     mesh->vertex_position_indices = (TriangleVertexIndices*)CUBE__VERTEX_POSITION_INDICES;
+    mesh->is_loading = false;
 }
\ No newline at end of file
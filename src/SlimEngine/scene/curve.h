@@ -6,15 +6,32 @@
 #include "../math/quat.h"
 #include "../shapes/edge.h"
 #include "./primitive.h"
+#include "../core/profiler.h"
+#include "./xform.h"
 
-#define CURVE_STEPS 3600
+INLINE bool areCurvePointsCurrent(Curve *curve, enum PrimitiveType type) {
+    return curve->points_primitive_type == (u8)type &&
+           curve->points_thickness == curve->thickness &&
+           curve->points_revolution_count == curve->revolution_count;
+}
+
+// Generates the object-space polyline of a helix or a coil into the curve's cache (accumulating rotations step by step).
+// Step counts above the capacity of the cache (CURVE_STEPS) are clamped to it.
+void updateCurvePoints(Curve *curve, u32 step_count, enum PrimitiveType type) {
+    if (step_count > curve->points_capacity) step_count = curve->points_capacity;
+    if (curve->point_count == step_count && areCurvePointsCurrent(curve, type))
+        return;
+
+    curve->point_count = step_count;
+    curve->points_primitive_type = (u8)type;
+    curve->points_thickness = curve->thickness;
+    curve->points_revolution_count = curve->revolution_count;
 
-void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
     f32 one_over_step_count = 1.0f / (f32)step_count;
     f32 rotation_step = one_over_step_count * TAU;
     f32 rotation_step_times_rev_count = rotation_step * (f32)curve->revolution_count;
 
-    if (primitive->type == PrimitiveType_Helix)
+    if (type == PrimitiveType_Helix)
         rotation_step = rotation_step_times_rev_count;
 
     vec3 center_to_orbit;
@@ -33,7 +50,7 @@ void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f
     rotation.Y.y = 1;
 
     mat3 orbit_to_curve_rotation;
-    if (primitive->type == PrimitiveType_Coil) {
+    if (type == PrimitiveType_Coil) {
         orbit_to_curve_rotation.X.x = orbit_to_curve_rotation.Y.y = cosf(rotation_step_times_rev_count);
         orbit_to_curve_rotation.X.y = sinf(rotation_step_times_rev_count);
         orbit_to_curve_rotation.Y.x = -orbit_to_curve_rotation.X.y;
@@ -41,49 +58,118 @@ void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f
         orbit_to_curve_rotation.Z.z = 1;
     }
 
-    // Transform vertices positions of edges from view-space to screen-space (w/ culling and clipping):
     mat3 accumulated_orbit_rotation = rotation;
-    vec3 current_position, previous_position;
-    Edge edge;
+    vec3 *current_position = curve->points;
 
-    for (u32 i = 0; i < step_count; i++) {
+    for (u32 i = 0; i < step_count; i++, current_position++) {
         center_to_orbit = mulVec3Mat3(center_to_orbit, rotation);
 
-        switch (primitive->type) {
+        switch (type) {
             case PrimitiveType_Helix:
-                current_position = center_to_orbit;
-                current_position.y -= 1;
+                *current_position = center_to_orbit;
+                current_position->y -= 1;
+                center_to_orbit.y += 2 * one_over_step_count;
                 break;
             case PrimitiveType_Coil:
                 orbit_to_curve  = mulVec3Mat3(orbit_to_curve, orbit_to_curve_rotation);
-                current_position = mulVec3Mat3(orbit_to_curve, accumulated_orbit_rotation);
-                current_position = addVec3(center_to_orbit, current_position);
+                *current_position = mulVec3Mat3(orbit_to_curve, accumulated_orbit_rotation);
+                *current_position = addVec3(center_to_orbit, *current_position);
+                accumulated_orbit_rotation = mulMat3(accumulated_orbit_rotation, rotation);
                 break;
             default:
+                *current_position = getVec3Of(0);
                 break;
         }
+    }
+}
 
-        current_position = convertPositionToWorldSpace(current_position, primitive);
-        current_position = subVec3(    current_position, viewport->camera->transform.position);
-        current_position = mulVec3Quat(current_position, viewport->camera->transform.rotation_inverted);
+// Returns the number of steps needed for a circle of the given on-screen radius (in pixels) to be drawn with
+// segments that deviate from it by no more than the given tolerance (in pixels) - for the given number of revolutions.
+INLINE f32 getCircleStepCount(f32 radius, f32 tolerance, f32 revolution_count) {
+    if (radius <= tolerance) return 4 * revolution_count;
+
+    return revolution_count * TAU / (2 * acosf(1 - tolerance / radius));
+}
+
+// Chooses how many steps to draw a curve with, from its projected size on screen and its curvature:
+// Helices wind around a single circle, while coils also wind around their (smaller and tighter) orbit.
+// The projected size is conservatively estimated from the nearest point of the curve's bounding sphere.
+// A curve tolerance of 0 (in the viewport's settings) disables this, using the given maximum step count always.
+u32 getCurveStepCount(Curve *curve, u32 max_step_count, Primitive *primitive, mat3x4 *object_to_view, Viewport *viewport) {
+    f32 tolerance = viewport->settings.curve_tolerance;
+    if (tolerance <= 0) return max_step_count;
+
+    f32 squared_scale = squaredLengthVec3(object_to_view->X);
+    f32 squared_axis_scale = squaredLengthVec3(object_to_view->Y);
+    if (squared_axis_scale > squared_scale) squared_scale = squared_axis_scale;
+    squared_axis_scale = squaredLengthVec3(object_to_view->Z);
+    if (squared_axis_scale > squared_scale) squared_scale = squared_axis_scale;
+    f32 scale = sqrtf(squared_scale);
+
+    f32 thickness = primitive->type == PrimitiveType_Coil ? curve->thickness : 0;
+    f32 bounding_radius = scale * (primitive->type == PrimitiveType_Coil ? 1 + thickness : SQRT2);
+    f32 nearest_depth = object_to_view->W.z - bounding_radius;
+    if (nearest_depth <= viewport->settings.near_clipping_plane_distance) return max_step_count;
+
+    f32 pixels_per_unit = viewport->camera->focal_length * viewport->dimensions.h_height / nearest_depth;
+    f32 revolution_count = (f32)curve->revolution_count;
+    f32 step_count;
+    if (primitive->type == PrimitiveType_Coil) {
+        step_count = getCircleStepCount(scale * pixels_per_unit, tolerance, 1);
+        f32 orbit_step_count = getCircleStepCount(scale * thickness * pixels_per_unit, tolerance, revolution_count);
+        if (orbit_step_count > step_count) step_count = orbit_step_count;
+    } else
+        step_count = getCircleStepCount(scale * pixels_per_unit, tolerance, revolution_count);
+
+    // Round up to a granularity, so that the cached polyline isn't regenerated on every small change of the view:
+    u32 steps = (u32)step_count + CURVE__STEPS_GRANULARITY;
+    steps -= steps % CURVE__STEPS_GRANULARITY;
+    if (steps < CURVE__MIN_STEPS) steps = CURVE__MIN_STEPS;
+
+    return steps < max_step_count ? steps : max_step_count;
+}
+
+// The polyline is only regenerated when the curve's parameters change, so each frame just transforms its points.
+// The given step count is the maximum, with fewer steps used for curves that are small on screen (see above).
+// When a curve is drawn into several viewports in turn, it keeps the steps of the one that needs the most of them:
+// A viewport that needs fewer steps draws the cached polyline as is, and only the viewport it was last sized for can
+// shrink it (otherwise each viewport would regenerate the polyline for itself on every frame).
+void drawCurve(Curve *curve, u32 step_count, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawCurve");
 
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    if (!viewport->has_prepared_curves) {
+        u32 needed_step_count = getCurveStepCount(curve, step_count, primitive, &object_to_view, viewport);
+        if (needed_step_count > curve->point_count ||
+            curve->points_viewport == viewport ||
+            !areCurvePointsCurrent(curve, primitive->type)) {
+            updateCurvePoints(curve, needed_step_count, primitive->type);
+            curve->points_viewport = viewport;
+        }
+    }
+
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    // Counted in segments: A polyline of N points has N - 1 of them.
+    u32 max_point_count = step_count < curve->points_capacity ? step_count : curve->points_capacity;
+    u32 segment_count = curve->point_count ? curve->point_count - 1 : 0;
+    u32 max_segment_count = max_point_count ? max_point_count - 1 : 0;
+    ADD_RASTERIZER_STAT(viewport, curve_segments, segment_count);
+    ADD_RASTERIZER_STAT(viewport, saved_curve_segments, max_segment_count > segment_count ? max_segment_count - segment_count : 0);
+#endif
+
+    // Transform vertices positions of edges from view-space to screen-space (w/ culling and clipping):
+    vec3 *position = curve->points;
+    vec3 current_position, previous_position;
+    Edge edge;
+    for (u32 i = 0; i < curve->point_count; i++, position++) {
+        current_position = mulVec3Mat3x4(*position, object_to_view);
         if (i) {
             edge.from = previous_position;
             edge.to   = current_position;
             drawEdge(&edge, color, opacity, line_width, viewport);
         }
-
-        switch (primitive->type) {
-            case PrimitiveType_Helix:
-                center_to_orbit.y += 2 * one_over_step_count;
-                break;
-            case PrimitiveType_Coil:
-                accumulated_orbit_rotation = mulMat3(accumulated_orbit_rotation, rotation);
-                break;
-            default:
-                break;
-        }
-
         previous_position = current_position;
     }
-}
\ No newline at end of file
+
+    PROFILE_END();
+}
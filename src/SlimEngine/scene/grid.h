@@ -4,34 +4,180 @@
 #include "../math/vec3.h"
 #include "../shapes/edge.h"
 #include "./primitive.h"
+#include "../core/profiler.h"
+#include "./xform.h"
 
 void transformGridVerticesFromObjectToViewSpace(Grid *grid, GridVertices *transformed_vertices, Primitive *primitive, Viewport *viewport) {
-    vec3 position;
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
     for (u8 side = 0; side < 2; side++) {
         for (u8 axis = 0; axis < 2; axis++) {
             u8 segment_count = axis ? grid->v_segments : grid->u_segments;
             for (u8 segment = 0; segment < segment_count; segment++) {
-                position = grid->vertices.buffer[axis][side][segment];
-                position = convertPositionToWorldSpace(position, primitive);
-                position = subVec3(    position, viewport->camera->transform.position);
-                position = mulVec3Quat(position, viewport->camera->transform.rotation_inverted);
-                transformed_vertices->buffer[axis][side][segment] = position;
+                transformed_vertices->buffer[axis][side][segment] = mulVec3Mat3x4(
+                        grid->vertices.buffer[axis][side][segment], object_to_view);
             }
         }
     }
 }
 
 void drawGrid(Grid *grid, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
-    // Transform vertices positions from local-space to world-space and then to view-space:
-    static GridVertices vertices;
+    PROFILE_BEGIN("drawGrid");
 
-    transformGridVerticesFromObjectToViewSpace(grid, &vertices, primitive, viewport);
+    // Transform the end points of each line from local-space to world-space and then to view-space, one line at a
+    // time (no scratch buffers are kept, so that grids can be drawn from multiple threads at once):
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    Edge edge;
+    for (u8 u = 0; u < grid->u_segments; u++) {
+        edge.from = mulVec3Mat3x4(grid->vertices.uv.u.from[u], object_to_view);
+        edge.to   = mulVec3Mat3x4(grid->vertices.uv.u.to[u],   object_to_view);
+        drawEdge(&edge, color, opacity, line_width, viewport);
+    }
+    for (u8 v = 0; v < grid->v_segments; v++) {
+        edge.from = mulVec3Mat3x4(grid->vertices.uv.v.from[v], object_to_view);
+        edge.to   = mulVec3Mat3x4(grid->vertices.uv.v.to[v],   object_to_view);
+        drawEdge(&edge, color, opacity, line_width, viewport);
+    }
+
+    PROFILE_END();
+}
+
+// Clips a convex polygon on the XZ plane by the half-plane a*x + c*z + d >= 0 (into the given output polygon):
+u8 clipGridPolygon(vec2 *in, u8 in_count, f32 a, f32 c, f32 d, vec2 *out) {
+    u8 out_count = 0;
+    vec2 *previous = in + in_count - 1;
+    f32 previous_distance = a * previous->x + c * previous->y + d;
+    for (u8 i = 0; i < in_count; i++) {
+        vec2 *current = in + i;
+        f32 current_distance = a * current->x + c * current->y + d;
+        if ((current_distance >= 0) != (previous_distance >= 0)) {
+            f32 t = previous_distance / (previous_distance - current_distance);
+            out[out_count++] = Vec2(previous->x + t * (current->x - previous->x),
+                                    previous->y + t * (current->y - previous->y));
+        }
+        if (current_distance >= 0) out[out_count++] = *current;
+        previous = current;
+        previous_distance = current_distance;
+    }
+
+    return out_count;
+}
+
+// Clips the view-space plane n.v + d >= 0 by the grid's plane, in the grid's object space (where y = 0):
+INLINE u8 clipGridPolygonByViewPlane(vec2 *in, u8 in_count, vec3 n, f32 d, mat3x4 *object_to_view, vec2 *out) {
+    return clipGridPolygon(in, in_count,
+                           dotVec3(n, object_to_view->X),
+                           dotVec3(n, object_to_view->Z),
+                           dotVec3(n, object_to_view->W) + d, out);
+}
+
+void drawInfiniteGridSegment(u8 axis, f32 line_position, f32 from, f32 to, f32 min, f32 max,
+                             mat3x4 *object_to_view, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    if (from < min) from = min;
+    if (to   > max) to   = max;
+    if (from >= to) return;
+
+    Edge edge;
+    if (axis) {
+        edge.from = Vec3(from, 0, line_position);
+        edge.to   = Vec3(to,   0, line_position);
+    } else {
+        edge.from = Vec3(line_position, 0, from);
+        edge.to   = Vec3(line_position, 0, to);
+    }
+    edge.from = mulVec3Mat3x4(edge.from, *object_to_view);
+    edge.to   = mulVec3Mat3x4(edge.to,   *object_to_view);
+    drawEdge(&edge, color, opacity, line_width, viewport);
+}
+
+// Draws a line of the grid (along Z for axis 0, or along X for axis 1) within the given range along it.
+// It is split into bands of distance from the camera, with the opacity of each band falling off quadratically:
+void drawInfiniteGridLine(u8 axis, f32 line_position, f32 min, f32 max, vec3 camera_position, f32 fade_distance,
+                          mat3x4 *object_to_view, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    f32 center = axis ? camera_position.x : camera_position.z;
+    f32 offset = line_position - (axis ? camera_position.z : camera_position.x);
+    f32 squared_distance_to_line = offset * offset + camera_position.y * camera_position.y;
+    f32 band_width = fade_distance / GRID__FADE_BANDS;
+    f32 inner_radius, outer_radius, inner = 0, outer, factor;
+
+    for (u8 band = 0; band < GRID__FADE_BANDS; band++) {
+        outer_radius = band_width * (f32)(band + 1);
+        outer_radius *= outer_radius;
+        if (outer_radius <= squared_distance_to_line) continue;
+        outer = sqrtf(outer_radius - squared_distance_to_line);
+
+        inner_radius = band_width * (f32)band;
+        inner_radius *= inner_radius;
+        inner = inner_radius > squared_distance_to_line ? sqrtf(inner_radius - squared_distance_to_line) : 0;
+
+        factor = ((f32)band + 0.5f) / GRID__FADE_BANDS;
+        factor = opacity * (1 - factor * factor);
+        if (inner == 0)
+            drawInfiniteGridSegment(axis, line_position, center - outer, center + outer, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+        else {
+            drawInfiniteGridSegment(axis, line_position, center - outer, center - inner, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+            drawInfiniteGridSegment(axis, line_position, center + inner, center + outer, min, max,
+                                    object_to_view, color, factor, line_width, viewport);
+        }
+    }
+}
+
+// Draws an unbounded grid on the XZ plane of the primitive's object space, with lines a unit apart (so the primitive's
+// scale sets their spacing) that fade out with distance from the camera until they vanish at the fade distance.
+// The fade distance is in the same object space units (of line spacing), so it is also scaled by the primitive's scale:
+// A fade distance of 30 on a primitive with a scale of 2 has the lines vanish 60 world units away from the camera.
+// Only lines that can be visible are touched: The square around the camera that the fade distance spans on the plane
+// is clipped by the view frustum, and lines are only drawn across the bounds of what remains of it.
+// So the cost depends only on the fade distance relative to the spacing, never on the (logical) size of the grid.
+void drawInfiniteGrid(f32 fade_distance, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawInfiniteGrid");
+
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
+    vec3 camera_position = mulVec3Mat3x4(viewport->camera->transform.position, primitive->world_matrix_inverted);
+    f32 squared_radius = fade_distance * fade_distance - camera_position.y * camera_position.y;
+    f32 radius = squared_radius > 0 ? sqrtf(squared_radius) : 0;
+
+    vec2 polygon[GRID__MAX_CLIPPED_VERTICES];
+    vec2 clipped[GRID__MAX_CLIPPED_VERTICES];
+    polygon[0] = Vec2(camera_position.x - radius, camera_position.z - radius);
+    polygon[1] = Vec2(camera_position.x + radius, camera_position.z - radius);
+    polygon[2] = Vec2(camera_position.x + radius, camera_position.z + radius);
+    polygon[3] = Vec2(camera_position.x - radius, camera_position.z + radius);
 
-    // Distribute transformed vertices positions to edges:
-    static GridEdges edges;
-    setGridEdgesFromVertices(edges.uv.u, grid->u_segments, vertices.uv.u.from, vertices.uv.u.to);
-    setGridEdgesFromVertices(edges.uv.v, grid->v_segments, vertices.uv.v.from, vertices.uv.v.to);
+    // Clip by the near, far, left, right, bottom and top planes of the frustum (as in cullAndClipEdge):
+    f32 fl = viewport->camera->focal_length;
+    f32 ar = viewport->dimensions.width_over_height;
+    u8 count = radius ? 4 : 0;
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(0, 0, +1), -viewport->settings.near_clipping_plane_distance, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(0, 0, -1), +viewport->settings.far_clipping_plane_distance, &object_to_view, polygon);
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(+fl, 0, ar), 0, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(-fl, 0, ar), 0, &object_to_view, polygon);
+    count = clipGridPolygonByViewPlane(polygon, count, Vec3(0, +fl, 1), 0, &object_to_view, clipped);
+    count = clipGridPolygonByViewPlane(clipped, count, Vec3(0, -fl, 1), 0, &object_to_view, polygon);
+    if (count) {
+        vec2 min = polygon[0];
+        vec2 max = polygon[0];
+        for (u8 i = 1; i < count; i++) {
+            if (polygon[i].x < min.x) min.x = polygon[i].x;
+            if (polygon[i].y < min.y) min.y = polygon[i].y;
+            if (polygon[i].x > max.x) max.x = polygon[i].x;
+            if (polygon[i].y > max.y) max.y = polygon[i].y;
+        }
+
+        // Keep the bounds to where consecutive lines are still apart in f32, which also keeps the line positions of
+        // a far away camera within the range of i32 (lines past the limit are then too far away to be drawn anyway):
+        min.x = clampValueToBetween(min.x, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        min.y = clampValueToBetween(min.y, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        max.x = clampValueToBetween(max.x, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        max.y = clampValueToBetween(max.y, -GRID__MAX_LINE_POSITION, GRID__MAX_LINE_POSITION);
+        for (i32 x = (i32)ceilf(min.x); x <= (i32)floorf(max.x); x++)
+            drawInfiniteGridLine(0, (f32)x, min.y, max.y, camera_position, fade_distance,
+                                 &object_to_view, color, opacity, line_width, viewport);
+        for (i32 z = (i32)ceilf(min.y); z <= (i32)floorf(max.y); z++)
+            drawInfiniteGridLine(1, (f32)z, min.x, max.x, camera_position, fade_distance,
+                                 &object_to_view, color, opacity, line_width, viewport);
+    }
 
-    for (u8 u = 0; u < grid->u_segments; u++) drawEdge(edges.uv.u + u, color, opacity, line_width, viewport);
-    for (u8 v = 0; v < grid->v_segments; v++) drawEdge(edges.uv.v + v, color, opacity, line_width, viewport);
+    PROFILE_END();
 }
\ No newline at end of file
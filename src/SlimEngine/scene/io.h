@@ -2,9 +2,17 @@
 
 #include "../core/base.h"
 #include "../core/types.h"
+#include "../core/init.h"
+#include "../core/pool.h"
+#include "../math/vec3.h"
+#include "./xform.h"
 
 u32 getMeshMemorySize(Mesh *mesh, char *file_path, Platform *platform) {
     void *file = platform->openFileForReading(file_path);
+    if (!file) {
+        mesh->vertex_count = mesh->triangle_count = mesh->edge_count = mesh->uvs_count = mesh->normals_count = 0;
+        return 0;
+    }
 
     platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
     platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
@@ -29,42 +37,87 @@ u32 getMeshMemorySize(Mesh *mesh, char *file_path, Platform *platform) {
     return memory_size;
 }
 
-void loadMeshFromFile(Mesh *mesh, char *file_path, Platform *platform, Memory *memory) {
-    void *file = platform->openFileForReading(file_path);
+// The size of a mesh's arrays in its file (where they follow each other in the order that they are read in):
+u64 getMeshArraysSize(Mesh *mesh) {
+    u64 size = sizeof(vec3) * (u64)mesh->vertex_count;
+    size += sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    size += sizeof(EdgeVertexIndices) * (u64)mesh->edge_count;
+    if (mesh->uvs_count)     size += sizeof(vec2) * (u64)mesh->uvs_count     + sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    if (mesh->normals_count) size += sizeof(vec3) * (u64)mesh->normals_count + sizeof(TriangleVertexIndices) * (u64)mesh->triangle_count;
+    return size;
+}
 
-    mesh->vertex_normals          = null;
-    mesh->vertex_normal_indices   = null;
-    mesh->vertex_uvs              = null;
-    mesh->vertex_uvs_indices      = null;
-    mesh->edge_vertex_indices     = null;
+bool _readMeshHeaderFromFile(Mesh *mesh, void *file, Platform *platform) {
+    return (
+        platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file) &&
+        platform->readFromFile(&mesh->aabb.min,       sizeof(vec3), file) &&
+        platform->readFromFile(&mesh->aabb.max,       sizeof(vec3), file)
+    );
+}
 
-    platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
-    platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
-    platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
-    platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
-    platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
-    platform->readFromFile(&mesh->aabb.min,       sizeof(vec3), file);
-    platform->readFromFile(&mesh->aabb.max,       sizeof(vec3), file);
+INLINE void _setMeshCapacities(Mesh *mesh) {
+    mesh->triangle_capacity = mesh->triangle_count;
+    mesh->vertex_capacity   = mesh->vertex_count;
+    mesh->edge_capacity     = mesh->edge_count;
+    mesh->normals_capacity  = mesh->normals_count;
+    mesh->uvs_capacity      = mesh->uvs_count;
+}
 
+void _allocateMeshArrays(Mesh *mesh, Memory *memory) {
+    _setMeshCapacities(mesh);
     mesh->vertex_positions        = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->vertex_count);
     mesh->vertex_position_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
     mesh->edge_vertex_indices     = (EdgeVertexIndices*    )allocateMemory(memory, sizeof(EdgeVertexIndices)     * mesh->edge_count);
+    if (mesh->uvs_count) {
+        mesh->vertex_uvs         = (vec2*                 )allocateMemory(memory, sizeof(vec2)                  * mesh->uvs_count);
+        mesh->vertex_uvs_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
+    }
+    if (mesh->normals_count) {
+        mesh->vertex_normals        = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->normals_count);
+        mesh->vertex_normal_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
+    }
+}
 
+void _readMeshArraysFromFile(Mesh *mesh, void *file, Platform *platform) {
     platform->readFromFile(mesh->vertex_positions,             sizeof(vec3)                  * mesh->vertex_count,   file);
     platform->readFromFile(mesh->vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
     platform->readFromFile(mesh->edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
     if (mesh->uvs_count) {
-        mesh->vertex_uvs         = (vec2*                 )allocateMemory(memory, sizeof(vec2)                  * mesh->uvs_count);
-        mesh->vertex_uvs_indices = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
         platform->readFromFile(mesh->vertex_uvs,               sizeof(vec2)                  * mesh->uvs_count,      file);
         platform->readFromFile(mesh->vertex_uvs_indices,       sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
     }
     if (mesh->normals_count) {
-        mesh->vertex_normals          = (vec3*                 )allocateMemory(memory, sizeof(vec3)                  * mesh->normals_count);
-        mesh->vertex_normal_indices   = (TriangleVertexIndices*)allocateMemory(memory, sizeof(TriangleVertexIndices) * mesh->triangle_count);
         platform->readFromFile(mesh->vertex_normals,                sizeof(vec3)                  * mesh->normals_count,  file);
         platform->readFromFile(mesh->vertex_normal_indices,         sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
     }
+}
+
+void loadMeshFromFile(Mesh *mesh, char *file_path, Platform *platform, Memory *memory) {
+    void *file = platform->openFileForReading(file_path);
+
+    mesh->vertex_normals          = null;
+    mesh->vertex_normal_indices   = null;
+    mesh->vertex_uvs              = null;
+    mesh->vertex_uvs_indices      = null;
+    mesh->edge_vertex_indices     = null;
+    mesh->is_loading = false;
+
+    if (!file) { // Missing mesh files are loaded as empty meshes:
+        mesh->vertex_positions = null;
+        mesh->vertex_position_indices = null;
+        mesh->vertex_count = mesh->triangle_count = mesh->edge_count = mesh->uvs_count = mesh->normals_count = 0;
+        mesh->aabb.min = mesh->aabb.max = getVec3Of(0);
+        _setMeshCapacities(mesh);
+        return;
+    }
+
+    _readMeshHeaderFromFile(mesh, file, platform);
+    _allocateMeshArrays(mesh, memory);
+    _readMeshArraysFromFile(mesh, file, platform);
 
     platform->closeFile(file);
 }
@@ -94,15 +147,164 @@ void saveMeshToFile(Mesh *mesh, char* file_path, Platform *platform) {
     platform->closeFile(file);
 }
 
-void writeSceneSettingsToFile(SceneSettings *settings, void *file, Platform *platform) {
-    platform->writeToFile(&settings->boxes, sizeof(u32), file);
-    platform->writeToFile(&settings->cameras, sizeof(u32), file);
-    platform->writeToFile(&settings->curves, sizeof(u32), file);
-    platform->writeToFile(&settings->grids, sizeof(u32), file);
-    platform->writeToFile(&settings->meshes, sizeof(u32), file);
-    platform->writeToFile(&settings->primitives, sizeof(u32), file);
+// Mesh files keep their arrays as they are in memory, so they can be mapped and used in place (instead of being read).
+// The mesh's arrays then point into a private view of the file, which is left mapped for as long as the app runs.
+bool mapMeshFromFile(Mesh *mesh, char *file_path, Platform *platform) {
+    u64 size;
+    u8 *data = platform->mapFileForReading ? (u8*)platform->mapFileForReading(file_path, &size) : null;
+    if (!data) return false;
+
+    u64 header_size = 5 * sizeof(u32) + 2 * sizeof(vec3);
+    u32 *counts = (u32*)data;
+    u64 array_size = 0;
+    if (size >= header_size) {
+        array_size += sizeof(vec3)                  * (u64)counts[0];
+        array_size += sizeof(TriangleVertexIndices) * (u64)counts[1];
+        array_size += sizeof(EdgeVertexIndices)     * (u64)counts[2];
+        if (counts[3]) array_size += sizeof(vec2) * (u64)counts[3] + sizeof(TriangleVertexIndices) * (u64)counts[1];
+        if (counts[4]) array_size += sizeof(vec3) * (u64)counts[4] + sizeof(TriangleVertexIndices) * (u64)counts[1];
+    }
+    if (size < header_size || size - header_size < array_size) {
+        platform->unmapFile(data, size);
+        return false;
+    }
+
+    mesh->is_loading = false;
+    mesh->vertex_count   = counts[0];
+    mesh->triangle_count = counts[1];
+    mesh->edge_count     = counts[2];
+    mesh->uvs_count      = counts[3];
+    mesh->normals_count  = counts[4];
+    mesh->aabb.min = ((vec3*)(counts + 5))[0];
+    mesh->aabb.max = ((vec3*)(counts + 5))[1];
+    _setMeshCapacities(mesh);
+
+    u8 *array = data + header_size;
+    mesh->vertex_positions        = (vec3*                 )array; array += sizeof(vec3)                  * mesh->vertex_count;
+    mesh->vertex_position_indices = (TriangleVertexIndices*)array; array += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )array; array += sizeof(EdgeVertexIndices)     * mesh->edge_count;
+    mesh->vertex_uvs = null;
+    mesh->vertex_uvs_indices = null;
+    mesh->vertex_normals = null;
+    mesh->vertex_normal_indices = null;
+    if (mesh->uvs_count) {
+        mesh->vertex_uvs         = (vec2*                 )array; array += sizeof(vec2)                  * mesh->uvs_count;
+        mesh->vertex_uvs_indices = (TriangleVertexIndices*)array; array += sizeof(TriangleVertexIndices) * mesh->triangle_count;
+    }
+    if (mesh->normals_count) {
+        mesh->vertex_normals        = (vec3*                 )array; array += sizeof(vec3)                  * mesh->normals_count;
+        mesh->vertex_normal_indices = (TriangleVertexIndices*)array;
+    }
+
+    return true;
+}
+
+// Meshes can be loaded on a background thread, so that the app can start drawing before they are read:
+// Each mesh is mapped from its file up front when the platform can (see mapMeshFromFile), leaving only the paging in of
+// its arrays to the background. Otherwise its counts and bounds are read up front, along with allocating its arrays
+// (so that memory is only ever allocated on the calling thread, and only for meshes that are read into it).
+// Either way the mesh is left empty and marked as loading (see isMeshLoaded) until its arrays are ready, when they are
+// handed over to the mesh, which is published by clearing its flag last (atomically) - so a thread that draws the mesh
+// sees either only its bounds or all of it.
+// All of the meshes are queued before the loading starts, and are then loaded in order on a single thread.
+void initMeshLoader(MeshLoader *loader, u32 capacity, Platform *platform, Memory *memory) {
+    loader->count = loader->drawn_count = loader->loaded_count = 0;
+    loader->platform = platform;
+    loader->loads = capacity ? (MeshLoad*)allocateMemory(memory, sizeof(MeshLoad) * capacity) : null;
 }
 
+// Returns false when the mesh's file is missing (in which case the mesh is left empty, as when loading it directly):
+bool queueMeshLoading(MeshLoader *loader, Mesh *mesh, char *file_path, Memory *memory) {
+    initMesh(mesh);
+    Platform *platform = loader->platform;
+    void *file = platform->openFileForReading(file_path);
+    if (!file) return false;
+
+    MeshLoad *load = loader->loads + loader->count++;
+    load->mesh = mesh;
+    load->file_path = file_path;
+    load->loaded = *mesh;
+    load->is_mapped = mapMeshFromFile(&load->loaded, file_path, platform);
+    if (!load->is_mapped) {
+        _readMeshHeaderFromFile(&load->loaded, file, platform);
+        _allocateMeshArrays(&load->loaded, memory);
+    }
+    platform->closeFile(file);
+
+    mesh->aabb = load->loaded.aabb;
+    mesh->is_loading = true;
+
+    return true;
+}
+
+void _loadQueuedMeshes(void *data) {
+    MeshLoader *loader = (MeshLoader*)data;
+    Platform *platform = loader->platform;
+    MeshLoad *load = loader->loads;
+    for (u32 i = 0; i < loader->count; i++, load++) {
+        Mesh *loaded = &load->loaded;
+        if (load->is_mapped) {
+            // Touch a byte of each page of the mapped arrays, so they are paged in here rather than when first drawn:
+            volatile u8 touched = 0;
+            u8 *arrays = (u8*)loaded->vertex_positions;
+            u64 size = getMeshArraysSize(loaded);
+            for (u64 offset = 0; offset < size; offset += MEMORY__PAGE_SIZE) touched = (u8)(touched + arrays[offset]);
+        } else {
+            void *file = platform->openFileForReading(load->file_path);
+            if (file) {
+                Mesh header;
+                _readMeshHeaderFromFile(&header, file, platform);
+                _readMeshArraysFromFile(loaded, file, platform);
+                platform->closeFile(file);
+            }
+        }
+
+        Mesh *mesh = load->mesh;
+        mesh->vertex_positions        = loaded->vertex_positions;
+        mesh->vertex_normals          = loaded->vertex_normals;
+        mesh->vertex_uvs              = loaded->vertex_uvs;
+        mesh->vertex_position_indices = loaded->vertex_position_indices;
+        mesh->vertex_normal_indices   = loaded->vertex_normal_indices;
+        mesh->vertex_uvs_indices      = loaded->vertex_uvs_indices;
+        mesh->edge_vertex_indices     = loaded->edge_vertex_indices;
+        mesh->triangle_count = loaded->triangle_count;
+        mesh->vertex_count   = loaded->vertex_count;
+        mesh->edge_count     = loaded->edge_count;
+        mesh->normals_count  = loaded->normals_count;
+        mesh->uvs_count      = loaded->uvs_count;
+        _setMeshCapacities(mesh);
+        ATOMIC_STORE(&mesh->is_loading, false);
+        ATOMIC_ADD(&loader->loaded_count, 1);
+    }
+}
+
+// Starts loading the queued meshes on a thread of their own (or loads them right away if no thread could be started):
+void startLoadingMeshes(MeshLoader *loader) {
+    if (!loader->count) return;
+
+    Platform *platform = loader->platform;
+    if (!(platform->startThread && platform->startThread(_loadQueuedMeshes, loader)))
+        _loadQueuedMeshes(loader);
+}
+
+INLINE bool isLoadingMeshes(MeshLoader *loader) {
+    return ATOMIC_LOAD(&loader->loaded_count) < loader->count;
+}
+
+void finishLoadingMeshes(MeshLoader *loader) {
+    while (isLoadingMeshes(loader))
+        if (loader->platform->yieldThread)
+            loader->platform->yieldThread();
+}
+
+// The original scene files (still read when they have no header, see loadSceneFromFile):
+// Counts of objects, followed by the objects stored as they were in memory.
+// Primitives are stored without their cached matrices (which precede the rest of their fields):
+#define PRIMITIVE__FILE_SIZE (sizeof(Primitive) - 2 * sizeof(mat3x4))
+
+// Curves are stored without their cached polyline (which follows their thickness and revolution count):
+#define CURVE__FILE_SIZE (sizeof(f32) + sizeof(u32))
+
 void readSceneSettingsFromFile(SceneSettings *settings, void *file, Platform *platform) {
     platform->readFromFile(&settings->boxes, sizeof(u32), file);
     platform->readFromFile(&settings->cameras, sizeof(u32), file);
@@ -112,31 +314,19 @@ void readSceneSettingsFromFile(SceneSettings *settings, void *file, Platform *pl
     platform->readFromFile(&settings->primitives, sizeof(u32), file);
 }
 
-void writeTransformToFile(xform3 *xform, void *file, Platform *platform) {
-    platform->writeToFile(&xform->matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->yaw_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->pitch_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->roll_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->rotation_matrix, sizeof(mat3), file);
-    platform->writeToFile(&xform->rotation_matrix_inverted, sizeof(mat3), file);
-
-    platform->writeToFile(&xform->rotation, sizeof(quat), file);
-    platform->writeToFile(&xform->rotation_inverted, sizeof(quat), file);
-
-    platform->writeToFile(&xform->position, sizeof(vec3), file);
-    platform->writeToFile(&xform->scale, sizeof(vec3), file);
-}
-
 void readTransformFromFile(xform3 *xform, void *file, Platform *platform) {
-    platform->readFromFile(&xform->matrix, sizeof(mat3), file);
+    mat3 skipped_matrix;
+    quat skipped_quaternion;
+    platform->readFromFile(&skipped_matrix, sizeof(mat3), file);
     platform->readFromFile(&xform->yaw_matrix, sizeof(mat3), file);
     platform->readFromFile(&xform->pitch_matrix, sizeof(mat3), file);
     platform->readFromFile(&xform->roll_matrix, sizeof(mat3), file);
     platform->readFromFile(&xform->rotation_matrix, sizeof(mat3), file);
-    platform->readFromFile(&xform->rotation_matrix_inverted, sizeof(mat3), file);
+    platform->readFromFile(&skipped_matrix, sizeof(mat3), file);
 
-    platform->readFromFile(&xform->rotation, sizeof(quat), file);
-    platform->readFromFile(&xform->rotation_inverted, sizeof(quat), file);
+    platform->readFromFile(&skipped_quaternion, sizeof(quat), file);
+    platform->readFromFile(&skipped_quaternion, sizeof(quat), file);
+    xform->dirty = XFORM3__DIRTY_ROTATION;
 
     platform->readFromFile(&xform->position, sizeof(vec3), file);
     platform->readFromFile(&xform->scale, sizeof(vec3), file);
@@ -146,8 +336,19 @@ void readTransformFromFile(xform3 *xform, void *file, Platform *platform) {
     xform->forward_direction = &xform->rotation_matrix.Z;
 }
 
-void loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
+void _skipMeshArraysInFile(Mesh *header, void *file, Platform *platform) {
+    u64 size = getMeshArraysSize(header);
+    u8 skipped[256];
+    while (size) {
+        u64 skipped_size = size < sizeof(skipped) ? size : sizeof(skipped);
+        if (!platform->readFromFile(skipped, skipped_size, file)) return;
+        size -= skipped_size;
+    }
+}
+
+void _loadSceneFromFileV1(Scene *scene, char* file_path, Platform *platform) {
     void *file = platform->openFileForReading(file_path);
+    if (!file) return;
 
     readSceneSettingsFromFile(&scene->settings, file, platform);
 
@@ -164,8 +365,10 @@ void loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
     }
 
     if (scene->primitives)
-        for (u32 i = 0; i < scene->settings.primitives; i++)
-            platform->readFromFile(scene->primitives + i, sizeof(Primitive), file);
+        for (u32 i = 0; i < scene->settings.primitives; i++) {
+            platform->readFromFile(&scene->primitives[i].rotation, PRIMITIVE__FILE_SIZE, file);
+            scene->primitives[i].flags |= IS_DIRTY;
+        }
 
     if (scene->grids)
         for (u32 i = 0; i < scene->settings.grids; i++)
@@ -176,94 +379,824 @@ void loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
             platform->readFromFile(scene->boxes + i, sizeof(Box), file);
 
     if (scene->curves)
-        for (u32 i = 0; i < scene->settings.curves; i++)
-            platform->readFromFile(scene->curves + i, sizeof(Curve), file);
+        for (u32 i = 0; i < scene->settings.curves; i++) {
+            platform->readFromFile(scene->curves + i, CURVE__FILE_SIZE, file);
+            scene->curves[i].point_count = 0;
+        }
 
+    // Meshes are only read into arrays that they fit in, others are left as they are (with their arrays skipped over,
+    // as the arrays of a mesh that is cut down to fit would have indices past the end of its vertices):
     if (scene->meshes) {
         Mesh *mesh = scene->meshes;
         for (u32 i = 0; i < scene->settings.meshes; i++, mesh++) {
-            platform->readFromFile(&mesh->vertex_count,   sizeof(u32),  file);
-            platform->readFromFile(&mesh->triangle_count, sizeof(u32),  file);
-            platform->readFromFile(&mesh->edge_count,     sizeof(u32),  file);
-            platform->readFromFile(&mesh->uvs_count,      sizeof(u32),  file);
-            platform->readFromFile(&mesh->normals_count,  sizeof(u32),  file);
-            platform->readFromFile(&mesh->aabb.min,       sizeof(vec3), file);
-            platform->readFromFile(&mesh->aabb.max,       sizeof(vec3), file);
-
-            platform->readFromFile(mesh->vertex_positions,             sizeof(vec3)                  * mesh->vertex_count,   file);
-            platform->readFromFile(mesh->vertex_position_indices,      sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            platform->readFromFile(mesh->edge_vertex_indices,          sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-            if (mesh->uvs_count) {
-                platform->readFromFile(mesh->vertex_uvs,               sizeof(vec2)                  * mesh->uvs_count,      file);
-                platform->readFromFile(mesh->vertex_uvs_indices,       sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-            if (mesh->normals_count) {
-                platform->readFromFile(mesh->vertex_normals,                sizeof(vec3)                  * mesh->normals_count,  file);
-                platform->readFromFile(mesh->vertex_normal_indices,         sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            }
-        };
+            Mesh header;
+            if (!_readMeshHeaderFromFile(&header, file, platform)) break;
+
+            if (header.vertex_count   <= mesh->vertex_capacity   && (!header.vertex_count   || mesh->vertex_positions) &&
+                header.triangle_count <= mesh->triangle_capacity && (!header.triangle_count || mesh->vertex_position_indices) &&
+                header.edge_count     <= mesh->edge_capacity     && (!header.edge_count     || mesh->edge_vertex_indices) &&
+                (!header.uvs_count     || (header.uvs_count     <= mesh->uvs_capacity     && mesh->vertex_uvs     && mesh->vertex_uvs_indices)) &&
+                (!header.normals_count || (header.normals_count <= mesh->normals_capacity && mesh->vertex_normals && mesh->vertex_normal_indices))) {
+                mesh->aabb = header.aabb;
+                mesh->vertex_count   = header.vertex_count;
+                mesh->triangle_count = header.triangle_count;
+                mesh->edge_count     = header.edge_count;
+                mesh->uvs_count      = header.uvs_count;
+                mesh->normals_count  = header.normals_count;
+                _readMeshArraysFromFile(mesh, file, platform);
+            } else
+                _skipMeshArraysInFile(&header, file, platform);
+        }
     }
 
     platform->closeFile(file);
 }
 
-void saveSceneToFile(Scene *scene, char* file_path, Platform *platform) {
-    void *file = platform->openFileForWriting(file_path);
+// Scene files start with a header and a table of contents, followed by a section for each type of object.
+// A section holds a record for each object, with only the parameters that it was made from: Whatever is derived from
+// them is rebuilt on load (the vertices and edges of grids, the edges of boxes and the matrices of the transforms).
+//
+// Sections are found through the table of contents, so their order is free and sections of unknown types are skipped.
+// Records are read up to the fields that are known, so a later version can append fields to them (and stay readable).
+// Records are stored field by field, in the byte order of the machine that wrote the file.
+//
+// Embedded meshes keep their arrays as they are in memory, aligned at offsets from the start of the file,
+// so a mapped scene file can have its meshes used in place (see getMeshFromSceneFile), as can mesh files.
+#define SCENE_FILE__CAMERA_RECORD_SIZE    (4 * sizeof(f32) + sizeof(vec3) + 3 * sizeof(mat3) + 2 * sizeof(vec3))
+#define SCENE_FILE__PRIMITIVE_RECORD_SIZE (sizeof(quat) + 2 * sizeof(vec3) + sizeof(u32) + 4 * sizeof(u8))
+#define SCENE_FILE__CURVE_RECORD_SIZE     (sizeof(f32) + sizeof(u32))
+#define SCENE_FILE__BOX_RECORD_SIZE       (BOX__VERTEX_COUNT * sizeof(vec3))
+#define SCENE_FILE__GRID_RECORD_SIZE      (2 * sizeof(u8))
 
-    writeSceneSettingsToFile(&scene->settings, file, platform);
+INLINE u64 alignSceneFileOffset(u64 offset) {
+    return (offset + (SCENE_FILE__ALIGNMENT - 1)) & ~(u64)(SCENE_FILE__ALIGNMENT - 1);
+}
 
-    if (scene->cameras) {
-        Camera *camera = scene->cameras;
-        for (u32 i = 0; i < scene->settings.cameras; i++, camera++) {
-            platform->writeToFile(&camera->focal_length, sizeof(f32), file);
-            platform->writeToFile(&camera->zoom, sizeof(f32), file);
-            platform->writeToFile(&camera->dolly, sizeof(f32), file);
-            platform->writeToFile(&camera->target_distance, sizeof(f32), file);
-            platform->writeToFile(&camera->current_velocity, sizeof(vec3), file);
-            writeTransformToFile(&camera->transform, file, platform);
-        }
+bool writeToSceneFile(SceneFile *file, void *data, u64 size) {
+    if (file->data) {
+        if (file->offset > file->size || size > file->size - file->offset) return false;
+
+        u8 *from = (u8*)data;
+        u8 *to = file->data + file->offset;
+        for (u64 i = 0; i < size; i++) to[i] = from[i];
+    } else if (!file->platform->writeToFile(data, (unsigned long)size, file->file))
+        return false;
+
+    file->offset += size;
+    return true;
+}
+
+bool readFromSceneFile(SceneFile *file, void *out, u64 size) {
+    if (file->data) {
+        if (file->offset > file->size || size > file->size - file->offset) return false;
+
+        u8 *from = file->data + file->offset;
+        u8 *to = (u8*)out;
+        for (u64 i = 0; i < size; i++) to[i] = from[i];
+    } else if (!file->platform->readFromFile(out, (unsigned long)size, file->file))
+        return false;
+
+    file->offset += size;
+    return true;
+}
+
+// Moves to the given offset, by writing zeros up to it or reading up to it (a file that is not mapped is only read forward):
+bool seekInSceneFile(SceneFile *file, u64 offset, bool is_writing) {
+    if (file->data) {
+        file->offset = offset;
+        return offset <= file->size;
+    }
+    if (offset < file->offset) return false;
+
+    u8 bytes[SCENE_FILE__ALIGNMENT];
+    for (u32 i = 0; i < SCENE_FILE__ALIGNMENT; i++) bytes[i] = 0;
+    while (file->offset < offset) {
+        u64 size = offset - file->offset;
+        if (size > SCENE_FILE__ALIGNMENT) size = SCENE_FILE__ALIGNMENT;
+        if (!(is_writing ? writeToSceneFile(file, bytes, size) : readFromSceneFile(file, bytes, size))) return false;
     }
 
+    return true;
+}
+
+// Lays out a mesh's record and arrays from the given (aligned) offset, returning the offset that follows them:
+// The mesh has to be loaded (see finishLoadingMeshes).
+u64 getSceneFileMesh(Mesh *mesh, u64 offset, SceneFileMesh *record) {
+    record->aabb = mesh->aabb;
+    record->vertex_count   = mesh->vertex_positions        ? mesh->vertex_count   : 0;
+    record->triangle_count = mesh->vertex_position_indices ? mesh->triangle_count : 0;
+    record->edge_count     = mesh->edge_vertex_indices     ? mesh->edge_count     : 0;
+    record->uvs_count      = mesh->vertex_uvs     && mesh->vertex_uvs_indices    ? mesh->uvs_count     : 0;
+    record->normals_count  = mesh->vertex_normals && mesh->vertex_normal_indices ? mesh->normals_count : 0;
+    record->reserved = 0;
+
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    u64 next = alignSceneFileOffset(offset + sizeof(SceneFileMesh));
+    record->vertex_positions        = next; next = alignSceneFileOffset(next + sizeof(vec3) * (u64)record->vertex_count);
+    record->vertex_position_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    record->edge_vertex_indices     = next; next = alignSceneFileOffset(next + sizeof(EdgeVertexIndices) * (u64)record->edge_count);
+    record->vertex_uvs = record->vertex_uvs_indices = record->vertex_normals = record->vertex_normal_indices = 0;
+    if (record->uvs_count) {
+        record->vertex_uvs         = next; next = alignSceneFileOffset(next + sizeof(vec2) * (u64)record->uvs_count);
+        record->vertex_uvs_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    }
+    if (record->normals_count) {
+        record->vertex_normals        = next; next = alignSceneFileOffset(next + sizeof(vec3) * (u64)record->normals_count);
+        record->vertex_normal_indices = next; next = alignSceneFileOffset(next + triangles_size);
+    }
+    record->size = next - offset;
+
+    return next;
+}
+
+bool writeMeshToSceneFile(SceneFile *file, Mesh *mesh) {
+    SceneFileMesh record;
+    getSceneFileMesh(mesh, file->offset, &record);
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record.triangle_count;
+    bool written = (
+        writeToSceneFile(file, &record, sizeof(SceneFileMesh)) &&
+        seekInSceneFile(file, record.vertex_positions, true) &&
+        writeToSceneFile(file, mesh->vertex_positions, sizeof(vec3) * (u64)record.vertex_count) &&
+        seekInSceneFile(file, record.vertex_position_indices, true) &&
+        writeToSceneFile(file, mesh->vertex_position_indices, triangles_size) &&
+        seekInSceneFile(file, record.edge_vertex_indices, true) &&
+        writeToSceneFile(file, mesh->edge_vertex_indices, sizeof(EdgeVertexIndices) * (u64)record.edge_count)
+    );
+    if (written && record.uvs_count)
+        written = (
+            seekInSceneFile(file, record.vertex_uvs, true) &&
+            writeToSceneFile(file, mesh->vertex_uvs, sizeof(vec2) * (u64)record.uvs_count) &&
+            seekInSceneFile(file, record.vertex_uvs_indices, true) &&
+            writeToSceneFile(file, mesh->vertex_uvs_indices, triangles_size)
+        );
+    if (written && record.normals_count)
+        written = (
+            seekInSceneFile(file, record.vertex_normals, true) &&
+            writeToSceneFile(file, mesh->vertex_normals, sizeof(vec3) * (u64)record.normals_count) &&
+            seekInSceneFile(file, record.vertex_normal_indices, true) &&
+            writeToSceneFile(file, mesh->vertex_normal_indices, triangles_size)
+        );
+
+    return written && seekInSceneFile(file, alignSceneFileOffset(file->offset), true);
+}
+
+bool writeCameraToSceneFile(SceneFile *file, Camera *camera) {
+    xform3 *xform = &camera->transform;
+    return (
+        writeToSceneFile(file, &camera->focal_length,     sizeof(f32)) &&
+        writeToSceneFile(file, &camera->zoom,             sizeof(f32)) &&
+        writeToSceneFile(file, &camera->dolly,            sizeof(f32)) &&
+        writeToSceneFile(file, &camera->target_distance,  sizeof(f32)) &&
+        writeToSceneFile(file, &camera->current_velocity, sizeof(vec3)) &&
+        writeToSceneFile(file, &xform->yaw_matrix,        sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->pitch_matrix,      sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->roll_matrix,       sizeof(mat3)) &&
+        writeToSceneFile(file, &xform->position,          sizeof(vec3)) &&
+        writeToSceneFile(file, &xform->scale,             sizeof(vec3))
+    );
+}
+
+bool readCameraFromSceneFile(SceneFile *file, Camera *camera) {
+    xform3 *xform = &camera->transform;
+    bool read = (
+        readFromSceneFile(file, &camera->focal_length,     sizeof(f32)) &&
+        readFromSceneFile(file, &camera->zoom,             sizeof(f32)) &&
+        readFromSceneFile(file, &camera->dolly,            sizeof(f32)) &&
+        readFromSceneFile(file, &camera->target_distance,  sizeof(f32)) &&
+        readFromSceneFile(file, &camera->current_velocity, sizeof(vec3)) &&
+        readFromSceneFile(file, &xform->yaw_matrix,        sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->pitch_matrix,      sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->roll_matrix,       sizeof(mat3)) &&
+        readFromSceneFile(file, &xform->position,          sizeof(vec3)) &&
+        readFromSceneFile(file, &xform->scale,             sizeof(vec3))
+    );
+    xform->rotation_matrix = mulMat3(mulMat3(xform->pitch_matrix, xform->yaw_matrix), xform->roll_matrix);
+    xform->dirty |= XFORM3__DIRTY_ROTATION;
+
+    return read;
+}
+
+// The primitive's dirty flag is left out (it is set on loading anyway), so that drawing it does not change its record:
+bool writePrimitiveToSceneFile(SceneFile *file, Primitive *primitive) {
+    u8 type  = (u8)primitive->type;
+    u8 color = (u8)primitive->color;
+    u8 flags = primitive->flags & (u8)~IS_DIRTY;
+    return (
+        writeToSceneFile(file, &primitive->rotation,    sizeof(quat)) &&
+        writeToSceneFile(file, &primitive->position,    sizeof(vec3)) &&
+        writeToSceneFile(file, &primitive->scale,       sizeof(vec3)) &&
+        writeToSceneFile(file, &primitive->id,          sizeof(u32)) &&
+        writeToSceneFile(file, &type,                   sizeof(u8)) &&
+        writeToSceneFile(file, &color,                  sizeof(u8)) &&
+        writeToSceneFile(file, &flags,                  sizeof(u8)) &&
+        writeToSceneFile(file, &primitive->material_id, sizeof(u8))
+    );
+}
+
+bool readPrimitiveFromSceneFile(SceneFile *file, Primitive *primitive) {
+    u8 type, color;
+    bool read = (
+        readFromSceneFile(file, &primitive->rotation,    sizeof(quat)) &&
+        readFromSceneFile(file, &primitive->position,    sizeof(vec3)) &&
+        readFromSceneFile(file, &primitive->scale,       sizeof(vec3)) &&
+        readFromSceneFile(file, &primitive->id,          sizeof(u32)) &&
+        readFromSceneFile(file, &type,                   sizeof(u8)) &&
+        readFromSceneFile(file, &color,                  sizeof(u8)) &&
+        readFromSceneFile(file, &primitive->flags,       sizeof(u8)) &&
+        readFromSceneFile(file, &primitive->material_id, sizeof(u8))
+    );
+    if (read) {
+        primitive->type  = (enum PrimitiveType)type;
+        primitive->color = (enum ColorID)color;
+    }
+    primitive->flags |= IS_DIRTY;
+
+    return read;
+}
+
+// Reads the arrays of a mesh's record into the mesh's own arrays, as long as they fit in them (leaving it as is if not).
+// Records are checked against the capacities of the arrays rather than the mesh's counts (which follow the last record).
+// A mesh that is still loading is left as is as well.
+bool readMeshFromSceneFile(SceneFile *file, SceneFileMesh *record, Mesh *mesh) {
+    if (!isMeshLoaded(mesh) ||
+        record->vertex_count   > mesh->vertex_capacity   || (record->vertex_count   && !mesh->vertex_positions) ||
+        record->triangle_count > mesh->triangle_capacity || (record->triangle_count && !mesh->vertex_position_indices) ||
+        record->edge_count     > mesh->edge_capacity     || (record->edge_count     && !mesh->edge_vertex_indices) ||
+        (record->uvs_count     && (record->uvs_count     > mesh->uvs_capacity     || !mesh->vertex_uvs     || !mesh->vertex_uvs_indices)) ||
+        (record->normals_count && (record->normals_count > mesh->normals_capacity || !mesh->vertex_normals || !mesh->vertex_normal_indices)))
+        return false;
+
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    bool read = (
+        seekInSceneFile(file, record->vertex_positions, false) &&
+        readFromSceneFile(file, mesh->vertex_positions, sizeof(vec3) * (u64)record->vertex_count) &&
+        seekInSceneFile(file, record->vertex_position_indices, false) &&
+        readFromSceneFile(file, mesh->vertex_position_indices, triangles_size) &&
+        seekInSceneFile(file, record->edge_vertex_indices, false) &&
+        readFromSceneFile(file, mesh->edge_vertex_indices, sizeof(EdgeVertexIndices) * (u64)record->edge_count)
+    );
+    if (read && record->uvs_count)
+        read = (
+            seekInSceneFile(file, record->vertex_uvs, false) &&
+            readFromSceneFile(file, mesh->vertex_uvs, sizeof(vec2) * (u64)record->uvs_count) &&
+            seekInSceneFile(file, record->vertex_uvs_indices, false) &&
+            readFromSceneFile(file, mesh->vertex_uvs_indices, triangles_size)
+        );
+    if (read && record->normals_count)
+        read = (
+            seekInSceneFile(file, record->vertex_normals, false) &&
+            readFromSceneFile(file, mesh->vertex_normals, sizeof(vec3) * (u64)record->normals_count) &&
+            seekInSceneFile(file, record->vertex_normal_indices, false) &&
+            readFromSceneFile(file, mesh->vertex_normal_indices, triangles_size)
+        );
+    if (!read) return false;
+
+    mesh->aabb = record->aabb;
+    mesh->vertex_count   = record->vertex_count;
+    mesh->triangle_count = record->triangle_count;
+    mesh->edge_count     = record->edge_count;
+    mesh->uvs_count      = record->uvs_count;
+    mesh->normals_count  = record->normals_count;
+
+    return true;
+}
+
+INLINE bool _isSceneFileArrayInRange(u64 offset, u64 size, u64 file_size) {
+    return !(offset & 3) && offset <= file_size && size <= file_size - offset;
+}
+
+// Points a mesh at the arrays of the embedded mesh of the given index, in a mapped scene file (returning false if none).
+// The mesh is then valid for as long as the file stays mapped.
+bool getMeshFromSceneFile(u8 *data, u64 size, u32 index, Mesh *mesh) {
+    SceneFileHeader *header = (SceneFileHeader*)data;
+    if (size < sizeof(SceneFileHeader) || header->magic != SCENE_FILE__MAGIC) return false;
+
+    SceneFileSection *section = (SceneFileSection*)(header + 1);
+    u32 section_count = header->section_count;
+    if (section_count > (size - sizeof(SceneFileHeader)) / sizeof(SceneFileSection)) return false;
+    for (; section_count && section->type != SceneFileSection_Meshes; section_count--) section++;
+    if (!section_count || index >= section->count || section->record_size < sizeof(SceneFileMesh)) return false;
+
+    u64 offset = section->offset;
+    SceneFileMesh *record = null;
+    for (u32 i = 0; i <= index; i++) {
+        if ((offset & 7) || !_isSceneFileArrayInRange(offset, sizeof(SceneFileMesh), size)) return false;
+        record = (SceneFileMesh*)(data + offset);
+        offset += record->size;
+    }
+
+    u64 triangles_size = sizeof(TriangleVertexIndices) * (u64)record->triangle_count;
+    if (!(_isSceneFileArrayInRange(record->vertex_positions,        sizeof(vec3) * (u64)record->vertex_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_position_indices, triangles_size, size) &&
+          _isSceneFileArrayInRange(record->edge_vertex_indices,     sizeof(EdgeVertexIndices) * (u64)record->edge_count, size) &&
+          (!record->uvs_count || (
+          _isSceneFileArrayInRange(record->vertex_uvs,              sizeof(vec2) * (u64)record->uvs_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_uvs_indices,      triangles_size, size))) &&
+          (!record->normals_count || (
+          _isSceneFileArrayInRange(record->vertex_normals,          sizeof(vec3) * (u64)record->normals_count, size) &&
+          _isSceneFileArrayInRange(record->vertex_normal_indices,   triangles_size, size)))))
+        return false;
+
+    mesh->is_loading = false;
+    mesh->aabb = record->aabb;
+    mesh->vertex_count   = record->vertex_count;
+    mesh->triangle_count = record->triangle_count;
+    mesh->edge_count     = record->edge_count;
+    mesh->uvs_count      = record->uvs_count;
+    mesh->normals_count  = record->normals_count;
+    mesh->vertex_positions        = (vec3*                 )(data + record->vertex_positions);
+    mesh->vertex_position_indices = (TriangleVertexIndices*)(data + record->vertex_position_indices);
+    mesh->edge_vertex_indices     = (EdgeVertexIndices*    )(data + record->edge_vertex_indices);
+    mesh->vertex_uvs              = record->uvs_count     ? (vec2*                 )(data + record->vertex_uvs)            : null;
+    mesh->vertex_uvs_indices      = record->uvs_count     ? (TriangleVertexIndices*)(data + record->vertex_uvs_indices)    : null;
+    mesh->vertex_normals          = record->normals_count ? (vec3*                 )(data + record->vertex_normals)        : null;
+    mesh->vertex_normal_indices   = record->normals_count ? (TriangleVertexIndices*)(data + record->vertex_normal_indices) : null;
+    _setMeshCapacities(mesh);
+
+    return true;
+}
+
+bool _writeSceneFileRecord(SceneFile *file, Scene *scene, u32 type, u32 index) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return writeCameraToSceneFile(   file, scene->cameras    + index);
+        case SceneFileSection_Primitives: return writePrimitiveToSceneFile(file, scene->primitives + index);
+        case SceneFileSection_Meshes:     return writeMeshToSceneFile(     file, scene->meshes     + index);
+        case SceneFileSection_Curves:
+            return (
+                writeToSceneFile(file, &scene->curves[index].thickness,        sizeof(f32)) &&
+                writeToSceneFile(file, &scene->curves[index].revolution_count, sizeof(u32))
+            );
+        case SceneFileSection_Boxes:
+            return writeToSceneFile(file, scene->boxes[index].vertices.buffer, SCENE_FILE__BOX_RECORD_SIZE);
+        case SceneFileSection_Grids:
+            return (
+                writeToSceneFile(file, &scene->grids[index].u_segments, sizeof(u8)) &&
+                writeToSceneFile(file, &scene->grids[index].v_segments, sizeof(u8))
+            );
+        default:
+            return true;
+    }
+}
+
+// Reads a record of any type other than a mesh (see readMeshFromSceneFile):
+bool _readSceneFileRecord(SceneFile *file, Scene *scene, u32 type, u32 index) {
+    bool read = true;
+    switch (type) {
+        case SceneFileSection_Cameras:    read = readCameraFromSceneFile(   file, scene->cameras    + index); break;
+        case SceneFileSection_Primitives: read = readPrimitiveFromSceneFile(file, scene->primitives + index); break;
+        case SceneFileSection_Curves: {
+            Curve *curve = scene->curves + index;
+            read = (
+                readFromSceneFile(file, &curve->thickness,        sizeof(f32)) &&
+                readFromSceneFile(file, &curve->revolution_count, sizeof(u32))
+            );
+            curve->point_count = 0;
+        } break;
+        case SceneFileSection_Boxes: {
+            Box *box = scene->boxes + index;
+            read = readFromSceneFile(file, box->vertices.buffer, SCENE_FILE__BOX_RECORD_SIZE);
+            setBoxEdgesFromVertices(&box->edges, &box->vertices);
+        } break;
+        case SceneFileSection_Grids: {
+            u8 u_segments, v_segments;
+            read = (
+                readFromSceneFile(file, &u_segments, sizeof(u8)) &&
+                readFromSceneFile(file, &v_segments, sizeof(u8))
+            );
+            if (read) initGrid(scene->grids + index, u_segments, v_segments);
+        } break;
+        default:
+            break;
+    }
+
+    return read;
+}
+
+void _setSceneObjectCount(SceneSettings *settings, u32 type, u32 count) {
+    switch (type) {
+        case SceneFileSection_Primitives: settings->primitives = count; break;
+        case SceneFileSection_Meshes:     settings->meshes     = count; break;
+        case SceneFileSection_Curves:     settings->curves     = count; break;
+        case SceneFileSection_Boxes:      settings->boxes      = count; break;
+        case SceneFileSection_Grids:      settings->grids      = count; break;
+        default: break;
+    }
+}
+
+// Loading a scene replaces its objects, so the pools are rebuilt from the loaded counts (see resetObjectPool).
+// Primitives that were removed before the scene was saved have no type, and their slots are free again.
+void _resetSceneObjectPools(Scene *scene) {
+    SceneSettings *settings = &scene->settings;
+    resetObjectPool(&scene->primitive_pool, settings->primitives);
+    resetObjectPool(&scene->mesh_pool,      settings->meshes);
+    resetObjectPool(&scene->curve_pool,     settings->curves);
+    resetObjectPool(&scene->box_pool,       settings->boxes);
+    resetObjectPool(&scene->grid_pool,      settings->grids);
+
+    ObjectPool *pool = &scene->primitive_pool;
     if (scene->primitives)
-        for (u32 i = 0; i < scene->settings.primitives; i++)
-            platform->writeToFile(scene->primitives + i, sizeof(Primitive), file);
+        for (u32 i = settings->primitives; i > 0; i--)
+            if (scene->primitives[i - 1].type == PrimitiveType_None)
+                freePoolSlot(pool, getObjectHandle(pool, i - 1));
+}
 
-    if (scene->grids)
-        for (u32 i = 0; i < scene->settings.grids; i++)
-            platform->writeToFile(scene->grids + i, sizeof(Grid), file);
+// Scenes can also be saved incrementally (see saveSceneChangesToFile): Instead of rewriting the whole file (meshes and all),
+// only the records that changed since the file was last saved or loaded are appended to it, as an entry of its journal.
+// The journal follows the file's sections, and loading the file replays its entries in order over the loaded objects.
+// Entries hold the counts of objects as well, so objects that were added or removed since are covered too.
+// Meshes are not journaled, so a change in the count of meshes has the file rewritten, as does a full journal
+// (once it has SCENE_FILE__MAX_JOURNAL_ENTRIES entries, compacting it into the sections).
+INLINE u64 _getSceneJournalRecordSize(u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return SCENE_FILE__CAMERA_RECORD_SIZE;
+        case SceneFileSection_Primitives: return SCENE_FILE__PRIMITIVE_RECORD_SIZE;
+        case SceneFileSection_Curves:     return SCENE_FILE__CURVE_RECORD_SIZE;
+        case SceneFileSection_Boxes:      return SCENE_FILE__BOX_RECORD_SIZE;
+        case SceneFileSection_Grids:      return SCENE_FILE__GRID_RECORD_SIZE;
+        default: return 0;
+    }
+}
 
-    if (scene->boxes)
-        for (u32 i = 0; i < scene->settings.boxes; i++)
-            platform->writeToFile(scene->boxes + i, sizeof(Box), file);
+INLINE u32 _getSceneJournalCapacity(SceneSettings *settings, u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return settings->cameras;
+        case SceneFileSection_Primitives: return settings->max_primitives;
+        case SceneFileSection_Curves:     return settings->max_curves;
+        case SceneFileSection_Boxes:      return settings->max_boxes;
+        case SceneFileSection_Grids:      return settings->max_grids;
+        default: return 0;
+    }
+}
 
-    if (scene->curves)
-        for (u32 i = 0; i < scene->settings.curves; i++)
-            platform->writeToFile(scene->curves + i, sizeof(Curve), file);
+INLINE u32 _getSceneObjectCount(SceneSettings *settings, u32 type) {
+    switch (type) {
+        case SceneFileSection_Cameras:    return settings->cameras;
+        case SceneFileSection_Primitives: return settings->primitives;
+        case SceneFileSection_Meshes:     return settings->meshes;
+        case SceneFileSection_Curves:     return settings->curves;
+        case SceneFileSection_Boxes:      return settings->boxes;
+        case SceneFileSection_Grids:      return settings->grids;
+        default: return 0;
+    }
+}
 
-    if (scene->meshes) {
-        Mesh *mesh = scene->meshes;
-        for (u32 i = 0; i < scene->settings.meshes; i++, mesh++) {
-            platform->writeToFile(&mesh->vertex_count,   sizeof(u32),  file);
-            platform->writeToFile(&mesh->triangle_count, sizeof(u32),  file);
-            platform->writeToFile(&mesh->edge_count,     sizeof(u32),  file);
-            platform->writeToFile(&mesh->uvs_count,      sizeof(u32),  file);
-            platform->writeToFile(&mesh->normals_count,  sizeof(u32),  file);
-            platform->writeToFile(&mesh->aabb.min,       sizeof(vec3), file);
-            platform->writeToFile(&mesh->aabb.max,       sizeof(vec3), file);
-
-            platform->writeToFile(mesh->vertex_positions,        sizeof(vec3)                  * mesh->vertex_count,   file);
-            platform->writeToFile(mesh->vertex_position_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
-            platform->writeToFile(mesh->edge_vertex_indices,     sizeof(EdgeVertexIndices)     * mesh->edge_count,     file);
-            if (mesh->uvs_count) {
-                platform->writeToFile(mesh->vertex_uvs,          sizeof(vec2)                  * mesh->uvs_count,      file);
-                platform->writeToFile(mesh->vertex_uvs_indices,  sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+// The journal's copy of a record, with the records of each type following those of the previous type (up to capacity):
+u8* _getSceneJournalRecord(Scene *scene, u32 type, u32 index) {
+    u8 *record = scene->journal.records;
+    for (u32 t = SceneFileSection_Cameras; t < type; t++)
+        record += _getSceneJournalRecordSize(t) * _getSceneJournalCapacity(&scene->settings, t);
+
+    return record + _getSceneJournalRecordSize(type) * index;
+}
+
+u64 getSceneJournalMemorySize(SceneSettings *settings) {
+    u64 memory_size = sizeof(SceneFileJournalEntry);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++)
+        memory_size += _getSceneJournalCapacity(settings, type) * (
+            2 * _getSceneJournalRecordSize(type) + sizeof(SceneFileJournalRecord)
+        );
+
+    return memory_size;
+}
+
+void initSceneJournal(SceneJournal *journal, SceneSettings *settings, Memory *memory) {
+    u64 records_size = 0;
+    u64 entry_capacity = sizeof(SceneFileJournalEntry);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++) {
+        u32 capacity = _getSceneJournalCapacity(settings, type);
+        records_size   += capacity * _getSceneJournalRecordSize(type);
+        entry_capacity += capacity * (_getSceneJournalRecordSize(type) + sizeof(SceneFileJournalRecord));
+    }
+    journal->records = records_size ? (u8*)allocateMemory(memory, records_size) : null;
+    journal->entry = (u8*)allocateMemory(memory, entry_capacity);
+    journal->entry_capacity = journal->entry ? entry_capacity : 0;
+    journal->file_path = null;
+    journal->entry_count = 0;
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) journal->counts[type] = 0;
+}
+
+// Has the journal hold the scene's records as they are in the given file (or none, so that the next save rewrites it):
+void _resetSceneJournal(Scene *scene, char *file_path, u32 entry_count) {
+    SceneJournal *journal = &scene->journal;
+    journal->file_path = journal->entry ? file_path : null;
+    journal->entry_count = entry_count;
+    if (!journal->file_path) return;
+
+    SceneFile records;
+    records.platform = null;
+    records.file = null;
+    records.data = journal->records;
+    records.size = (u64)(_getSceneJournalRecord(scene, SCENE_FILE__SECTION_TYPES, 0) - journal->records);
+    for (u32 type = SceneFileSection_Cameras; type < SCENE_FILE__SECTION_TYPES; type++) {
+        journal->counts[type] = _getSceneObjectCount(&scene->settings, type);
+        if (!_getSceneJournalRecordSize(type)) continue;
+
+        records.offset = (u64)(_getSceneJournalRecord(scene, type, 0) - journal->records);
+        for (u32 i = 0; i < journal->counts[type]; i++)
+            _writeSceneFileRecord(&records, scene, type, i);
+    }
+}
+
+INLINE bool _isSameFilePath(char *path, char *other_path) {
+    while (*path && *path == *other_path) { path++; other_path++; }
+    return *path == *other_path;
+}
+
+void _addSceneFileSection(SceneFileSection *sections, u32 *section_count, enum SceneFileSectionType type, u32 count, u64 record_size) {
+    SceneFileSection *section = sections + (*section_count)++;
+    section->type = (u32)type;
+    section->count = count;
+    section->record_size = (u32)record_size;
+    section->reserved = 0;
+    section->offset = 0;
+    section->size = record_size * count;
+}
+
+// Meshes that are still loading are waited for, so that the file holds all of their arrays.
+bool saveSceneToFile(Scene *scene, char* file_path, Platform *platform) {
+    finishLoadingMeshes(&scene->mesh_loader);
+
+    SceneSettings *settings = &scene->settings;
+    SceneFileSection sections[6];
+    u32 section_count = 0;
+    if (scene->cameras)    _addSceneFileSection(sections, &section_count, SceneFileSection_Cameras,    settings->cameras,    SCENE_FILE__CAMERA_RECORD_SIZE);
+    if (scene->primitives) _addSceneFileSection(sections, &section_count, SceneFileSection_Primitives, settings->primitives, SCENE_FILE__PRIMITIVE_RECORD_SIZE);
+    if (scene->meshes)     _addSceneFileSection(sections, &section_count, SceneFileSection_Meshes,     settings->meshes,     sizeof(SceneFileMesh));
+    if (scene->curves)     _addSceneFileSection(sections, &section_count, SceneFileSection_Curves,     settings->curves,     SCENE_FILE__CURVE_RECORD_SIZE);
+    if (scene->boxes)      _addSceneFileSection(sections, &section_count, SceneFileSection_Boxes,      settings->boxes,      SCENE_FILE__BOX_RECORD_SIZE);
+    if (scene->grids)      _addSceneFileSection(sections, &section_count, SceneFileSection_Grids,      settings->grids,      SCENE_FILE__GRID_RECORD_SIZE);
+
+    u64 offset = sizeof(SceneFileHeader) + sizeof(SceneFileSection) * section_count;
+    for (u32 i = 0; i < section_count; i++) {
+        SceneFileSection *section = sections + i;
+        section->offset = offset = alignSceneFileOffset(offset);
+        if (section->type == SceneFileSection_Meshes) {
+            SceneFileMesh record;
+            for (u32 m = 0; m < section->count; m++) offset = getSceneFileMesh(scene->meshes + m, offset, &record);
+            section->size = offset - section->offset;
+        } else
+            offset += section->size;
+    }
+
+    SceneFile file;
+    file.platform = platform;
+    file.data = null;
+    file.size = file.offset = 0;
+    file.file = platform->openFileForWriting(file_path);
+    if (!file.file) return false;
+
+    SceneFileHeader header;
+    header.magic = SCENE_FILE__MAGIC;
+    header.version = SCENE_FILE__VERSION;
+    header.section_count = section_count;
+    header.reserved = 0;
+    bool written = writeToSceneFile(&file, &header, sizeof(SceneFileHeader));
+    for (u32 i = 0; written && i < section_count; i++)
+        written = writeToSceneFile(&file, sections + i, sizeof(SceneFileSection));
+
+    for (u32 i = 0; written && i < section_count; i++) {
+        SceneFileSection *section = sections + i;
+        written = seekInSceneFile(&file, section->offset, true);
+        for (u32 r = 0; written && r < section->count; r++)
+            written = _writeSceneFileRecord(&file, scene, section->type, r);
+    }
+
+    platform->closeFile(file.file);
+    _resetSceneJournal(scene, written ? file_path : null, 0);
+    return written;
+}
+
+// Appends the records that changed since the scene was last saved to (or loaded from) the given file, to its journal.
+// The whole file is saved instead when the journal does not hold the file's records (or is full, or meshes were added).
+// Nothing is written when nothing changed.
+bool saveSceneChangesToFile(Scene *scene, char* file_path, Platform *platform) {
+    SceneJournal *journal = &scene->journal;
+    SceneSettings *settings = &scene->settings;
+    if (!(journal->file_path && _isSameFilePath(journal->file_path, file_path) &&
+          journal->entry_count < SCENE_FILE__MAX_JOURNAL_ENTRIES &&
+          journal->counts[SceneFileSection_Meshes] == settings->meshes &&
+          platform->openFileForAppending))
+        return saveSceneToFile(scene, file_path, platform);
+
+    // Each record is composed into the entry right after its type and index, and is dropped if it did not change:
+    SceneFile entry;
+    entry.platform = platform;
+    entry.file = null;
+    entry.data = journal->entry;
+    entry.size = journal->entry_capacity;
+    entry.offset = sizeof(SceneFileJournalEntry);
+
+    SceneFileJournalEntry header;
+    header.magic = SCENE_FILE__JOURNAL_MAGIC;
+    header.record_count = 0;
+    header.reserved = 0;
+    bool changed = false;
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) {
+        header.counts[type] = _getSceneObjectCount(settings, type);
+        if (header.counts[type] != journal->counts[type]) changed = true;
+
+        u64 record_size = _getSceneJournalRecordSize(type);
+        if (!record_size) continue;
+
+        SceneFileJournalRecord record;
+        record.type = type;
+        for (record.index = 0; record.index < header.counts[type]; record.index++) {
+            u64 offset = entry.offset;
+            if (!(writeToSceneFile(&entry, &record, sizeof(SceneFileJournalRecord)) &&
+                  _writeSceneFileRecord(&entry, scene, type, record.index)))
+                return false;
+
+            u8 *saved = _getSceneJournalRecord(scene, type, record.index);
+            u8 *written = journal->entry + offset + sizeof(SceneFileJournalRecord);
+            bool is_same = record.index < journal->counts[type];
+            for (u64 i = 0; is_same && i < record_size; i++) is_same = saved[i] == written[i];
+            if (is_same)
+                entry.offset = offset;
+            else
+                header.record_count++;
+        }
+    }
+    if (!(changed || header.record_count)) return true;
+
+    header.size = entry.offset;
+    entry.offset = 0;
+    writeToSceneFile(&entry, &header, sizeof(SceneFileJournalEntry));
+
+    void *file = platform->openFileForAppending(file_path);
+    bool written = file && platform->writeToFile(journal->entry, (unsigned long)header.size, file);
+    if (file) platform->closeFile(file);
+    if (!written) { // The file may now end with a partial entry, so it is to be rewritten on the next save
+        journal->file_path = null;
+        return false;
+    }
+
+    // The journal now holds the records as they are in the file:
+    u8 *record = journal->entry + sizeof(SceneFileJournalEntry);
+    for (u32 r = 0; r < header.record_count; r++) {
+        SceneFileJournalRecord *written_record = (SceneFileJournalRecord*)record;
+        u64 record_size = _getSceneJournalRecordSize(written_record->type);
+        u8 *saved = _getSceneJournalRecord(scene, written_record->type, written_record->index);
+        record += sizeof(SceneFileJournalRecord);
+        for (u64 i = 0; i < record_size; i++) saved[i] = record[i];
+        record += record_size;
+    }
+    for (u32 type = 0; type < SCENE_FILE__SECTION_TYPES; type++) journal->counts[type] = header.counts[type];
+    journal->entry_count++;
+
+    return true;
+}
+
+INLINE u32 _getSceneFileSectionCount(SceneFileSection *section, u32 capacity) {
+    return section->count < capacity ? section->count : capacity;
+}
+
+// Loads the objects of each section into the scene's own (already allocated) objects, up to their capacities.
+// Objects of types that the file has no section for are left as they are.
+// Embedded meshes are only loaded into meshes that their arrays fit in, other meshes are left as they are.
+bool _loadSceneSection(Scene *scene, SceneFile *file, SceneFileSection *section) {
+    SceneSettings *settings = &scene->settings;
+    u32 count = 0;
+    u64 record_size = 0;
+    switch (section->type) {
+        case SceneFileSection_Cameras:    if (scene->cameras)    { count = _getSceneFileSectionCount(section, settings->cameras);        record_size = SCENE_FILE__CAMERA_RECORD_SIZE;    } break;
+        case SceneFileSection_Primitives: if (scene->primitives) { count = _getSceneFileSectionCount(section, settings->max_primitives); record_size = SCENE_FILE__PRIMITIVE_RECORD_SIZE; } break;
+        case SceneFileSection_Meshes:     if (scene->meshes)     { count = _getSceneFileSectionCount(section, settings->max_meshes);     record_size = sizeof(SceneFileMesh);             } break;
+        case SceneFileSection_Curves:     if (scene->curves)     { count = _getSceneFileSectionCount(section, settings->max_curves);     record_size = SCENE_FILE__CURVE_RECORD_SIZE;     } break;
+        case SceneFileSection_Boxes:      if (scene->boxes)      { count = _getSceneFileSectionCount(section, settings->max_boxes);      record_size = SCENE_FILE__BOX_RECORD_SIZE;       } break;
+        case SceneFileSection_Grids:      if (scene->grids)      { count = _getSceneFileSectionCount(section, settings->max_grids);      record_size = SCENE_FILE__GRID_RECORD_SIZE;      } break;
+        default: break;
+    }
+    if (!record_size || section->record_size < record_size) return true; // Skipped
+
+    bool read = true;
+    u64 offset = section->offset;
+    for (u32 i = 0; read && i < count; i++) {
+        read = seekInSceneFile(file, offset, false);
+        offset += section->record_size;
+        if (!read) break;
+
+        if (section->type == SceneFileSection_Meshes) {
+            SceneFileMesh record;
+            read = readFromSceneFile(file, &record, sizeof(SceneFileMesh));
+            if (read) {
+                offset += record.size - section->record_size;
+                readMeshFromSceneFile(file, &record, scene->meshes + i);
             }
-            if (mesh->normals_count) {
-                platform->writeToFile(mesh->vertex_normals,        sizeof(vec3)                  * mesh->normals_count,  file);
-                platform->writeToFile(mesh->vertex_normal_indices, sizeof(TriangleVertexIndices) * mesh->triangle_count, file);
+        } else
+            read = _readSceneFileRecord(file, scene, section->type, i);
+    }
+    _setSceneObjectCount(settings, section->type, count);
+
+    return read;
+}
+
+// Replays the journal's entries from the given offset (the end of the file's sections), returning how many there were.
+// Each entry is read whole (into the journal's entry) before any of it is replayed, and replaying stops at the first
+// entry that is not whole. is_whole is set when the journal runs up to the end of the file (an entry's first byte is
+// read on its own, so that the end of a file that is not mapped can be told apart from a partial entry).
+u32 _replaySceneFileJournal(Scene *scene, SceneFile *file, u64 offset, bool *is_whole) {
+    SceneJournal *journal = &scene->journal;
+    SceneSettings *settings = &scene->settings;
+    SceneFileJournalEntry entry;
+    u8 *entry_bytes = (u8*)&entry;
+    u32 entry_count = 0;
+    *is_whole = false;
+    while (journal->entry && seekInSceneFile(file, offset, false)) {
+        if (!readFromSceneFile(file, entry_bytes, 1)) {
+            *is_whole = true;
+            break;
+        }
+        if (!(readFromSceneFile(file, entry_bytes + 1, sizeof(SceneFileJournalEntry) - 1) &&
+              entry.magic == SCENE_FILE__JOURNAL_MAGIC &&
+              entry.size >= sizeof(SceneFileJournalEntry) && entry.size <= journal->entry_capacity &&
+              readFromSceneFile(file, journal->entry + sizeof(SceneFileJournalEntry), entry.size - sizeof(SceneFileJournalEntry))))
+            break;
+
+        // The records are all checked before any of them is read into the scene:
+        SceneFile records;
+        records.platform = file->platform;
+        records.file = null;
+        records.data = journal->entry;
+        records.size = entry.size;
+        SceneFileJournalRecord record;
+        bool read = true;
+        for (u32 pass = 0; read && pass < 2; pass++) {
+            records.offset = sizeof(SceneFileJournalEntry);
+            for (u32 r = 0; read && r < entry.record_count; r++) {
+                read = readFromSceneFile(&records, &record, sizeof(SceneFileJournalRecord));
+                u64 record_size = read ? _getSceneJournalRecordSize(record.type) : 0;
+                read = (
+                    record_size && record.index < _getSceneJournalCapacity(settings, record.type) &&
+                    records.offset + record_size <= records.size
+                );
+                if (!read) break;
+
+                if (pass)
+                    read = _readSceneFileRecord(&records, scene, record.type, record.index);
+                else
+                    records.offset += record_size;
             }
         }
+        if (!read) break;
+
+        for (u32 type = SceneFileSection_Primitives; type < SCENE_FILE__SECTION_TYPES; type++)
+            if (type != SceneFileSection_Meshes) {
+                u32 capacity = _getSceneJournalCapacity(settings, type);
+                _setSceneObjectCount(settings, type, entry.counts[type] < capacity ? entry.counts[type] : capacity);
+            }
+
+        offset += entry.size;
+        entry_count++;
     }
 
-    platform->closeFile(file);
-}
\ No newline at end of file
+    return entry_count;
+}
+
+// Loads a scene file in-place (mapping it when the platform can, so its sections can be read in any order).
+// Files without a header are read as the original (unversioned) scene files.
+// Meshes that are still loading are waited for, so that the file's meshes are read into their arrays (not raced for them).
+bool loadSceneFromFile(Scene *scene, char* file_path, Platform *platform) {
+    finishLoadingMeshes(&scene->mesh_loader);
+
+    SceneFile file;
+    file.platform = platform;
+    file.offset = file.size = 0;
+    file.data = platform->mapFileForReading ? (u8*)platform->mapFileForReading(file_path, &file.size) : null;
+    file.file = file.data ? null : platform->openFileForReading(file_path);
+    if (!file.data && !file.file) return false;
+
+    SceneFileHeader header;
+    bool read = readFromSceneFile(&file, &header, sizeof(SceneFileHeader));
+    bool is_versioned = read && header.magic == SCENE_FILE__MAGIC && header.version >= SCENE_FILE__VERSION;
+    if (is_versioned) {
+        SceneFileSection sections[SCENE_FILE__MAX_SECTIONS];
+        u32 section_count = header.section_count < SCENE_FILE__MAX_SECTIONS ? header.section_count : SCENE_FILE__MAX_SECTIONS;
+        for (u32 i = 0; read && i < section_count; i++)
+            read = readFromSceneFile(&file, sections + i, sizeof(SceneFileSection));
+
+        u64 sections_end = file.offset;
+        for (u32 i = 0; read && i < section_count; i++) {
+            read = _loadSceneSection(scene, &file, sections + i);
+            if (sections[i].offset + sections[i].size > sections_end)
+                sections_end = sections[i].offset + sections[i].size;
+        }
+
+        // A file whose journal ends with a partial entry (from an interrupted save) is to be rewritten on the next save,
+        // rather than have entries appended after the partial one:
+        bool is_whole = false;
+        u32 entry_count = read ? _replaySceneFileJournal(scene, &file, sections_end, &is_whole) : 0;
+        _resetSceneJournal(scene, read && is_whole ? file_path : null, entry_count);
+        _resetSceneObjectPools(scene);
+    }
+
+    if (file.data) platform->unmapFile(file.data, file.size);
+    if (file.file) platform->closeFile(file.file);
+    if (is_versioned) return read;
+
+    scene->journal.file_path = null; // Saving changes rewrites the file in the versioned format first
+    if (!read || header.magic == SCENE_FILE__MAGIC) return false;
+
+    _loadSceneFromFileV1(scene, file_path, platform);
+    _resetSceneObjectPools(scene);
+    return true;
+}
@@ -4,26 +4,37 @@
 #include "../core/types.h"
 #include "../shapes/edge.h"
 #include "./primitive.h"
+#include "../core/profiler.h"
+#include "./xform.h"
+#include "./box.h"
 
 void drawMesh(Mesh *mesh, bool draw_normals, Primitive *primitive, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    PROFILE_BEGIN("drawMesh");
+
+    // A mesh that is still loading is drawn as its bounding box (faded out) in the meantime:
+    if (!isMeshLoaded(mesh)) {
+        Box box;
+        initBox(&box);
+        vec3 *corner = box.vertices.buffer;
+        for (u8 i = 0; i < BOX__VERTEX_COUNT; i++, corner++) {
+            corner->x = corner->x < 0 ? mesh->aabb.min.x : mesh->aabb.max.x;
+            corner->y = corner->y < 0 ? mesh->aabb.min.y : mesh->aabb.max.y;
+            corner->z = corner->z < 0 ? mesh->aabb.min.z : mesh->aabb.max.z;
+        }
+        drawBox(&box, BOX__ALL_SIDES, primitive, color, opacity * 0.5f, line_width, viewport);
+
+        PROFILE_END();
+        return;
+    }
+
     EdgeVertexIndices *edge_vertex_indices = mesh->edge_vertex_indices;
-    quat cam_rot = viewport->camera->transform.rotation_inverted;
-    vec3 cam_pos = viewport->camera->transform.position;
+    mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewport->camera->transform);
     vec3 *positions = mesh->vertex_positions;
     vec3 position;
     Edge edge;
     for (u32 i = 0; i < mesh->edge_count; i++, edge_vertex_indices++) {
-        position = positions[edge_vertex_indices->from];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(position,     cam_pos);
-        position = mulVec3Quat(position, cam_rot);
-        edge.from = position;
-
-        position = positions[edge_vertex_indices->to];
-        position = convertPositionToWorldSpace(position, primitive);
-        position = subVec3(position,     cam_pos);
-        position = mulVec3Quat(position, cam_rot);
-        edge.to  = position;
+        edge.from = mulVec3Mat3x4(positions[edge_vertex_indices->from], object_to_view);
+        edge.to   = mulVec3Mat3x4(positions[edge_vertex_indices->to],   object_to_view);
 
         drawEdge(&edge, color, opacity, line_width, viewport);
     }
@@ -35,17 +46,13 @@ void drawMesh(Mesh *mesh, bool draw_normals, Primitive *primitive, vec3 color, f
         for (u32 t = 0; t < mesh->triangle_count; t++, vertex_normal_indices++, vertex_position_indices++) {
             for (u8 i = 0; i < 3; i++) {
                 position = positions[vertex_position_indices->ids[i]];
-                edge.from = convertPositionToWorldSpace(position, primitive);
-                edge.from = subVec3(edge.from,     cam_pos);
-                edge.from = mulVec3Quat(edge.from, cam_rot);
-
-                edge.to = addVec3(position, scaleVec3(normals[vertex_normal_indices->ids[i]], 0.1f));
-                edge.to = convertPositionToWorldSpace(edge.to, primitive);
-                edge.to = subVec3(edge.to,     cam_pos);
-                edge.to = mulVec3Quat(edge.to, cam_rot);
+                edge.from = mulVec3Mat3x4(position, object_to_view);
+                edge.to   = mulVec3Mat3x4(addVec3(position, scaleVec3(normals[vertex_normal_indices->ids[i]], 0.1f)), object_to_view);
 
                 drawEdge(&edge, Color(Red), opacity * 0.5f, line_width, viewport);
             }
         }
     }
+
+    PROFILE_END();
 }
\ No newline at end of file
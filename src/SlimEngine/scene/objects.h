@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../core/types.h"
+#include "../core/init.h"
+#include "../core/pool.h"
+#include "./io.h"
+
+// Objects are added into the pooled slots that were allocated up front (see SceneSettings.max_*), which are reused
+// once their objects are removed. The scene's settings keep counting the slots that were ever used, so existing
+// loops over them keep working - removed primitives are left with a type of PrimitiveType_None (so are skipped).
+// A null is returned when the pool is full, and the handle (if given) can later be checked for staleness.
+u32 _addSceneObject(ObjectPool *pool, u32 *used_slot_count, ObjectHandle *handle) {
+    ObjectHandle new_handle = allocatePoolSlot(pool);
+    if (handle) *handle = new_handle;
+    if (new_handle.index != POOL__INVALID_INDEX &&
+        new_handle.index >= *used_slot_count)
+        *used_slot_count = new_handle.index + 1;
+
+    return new_handle.index;
+}
+
+Primitive* addPrimitive(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->primitive_pool, &scene->settings.primitives, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initPrimitive(scene->primitives + index);
+    return scene->primitives + index;
+}
+
+Curve* addCurve(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->curve_pool, &scene->settings.curves, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initCurve(scene->curves + index);
+    return scene->curves + index;
+}
+
+Box* addBox(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->box_pool, &scene->settings.boxes, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initBox(scene->boxes + index);
+    return scene->boxes + index;
+}
+
+Grid* addGrid(Scene *scene, ObjectHandle *handle) {
+    u32 index = _addSceneObject(&scene->grid_pool, &scene->settings.grids, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    initGrid(scene->grids + index, 3, 3);
+    return scene->grids + index;
+}
+
+// Note: The mesh's data is loaded into the given memory, which is not reclaimed when the mesh is removed.
+Mesh* addMesh(Scene *scene, char *file_path, ObjectHandle *handle, Platform *platform, Memory *memory) {
+    u32 index = _addSceneObject(&scene->mesh_pool, &scene->settings.meshes, handle);
+    if (index == POOL__INVALID_INDEX) return null;
+
+    loadMeshFromFile(scene->meshes + index, file_path, platform, memory);
+    return scene->meshes + index;
+}
+
+bool removePrimitive(Scene *scene, ObjectHandle handle) {
+    if (!freePoolSlot(&scene->primitive_pool, handle)) return false;
+
+    scene->primitives[handle.index].type = PrimitiveType_None;
+    return true;
+}
+
+// Whether any primitive draws the object of the given id (curves are drawn by both helix and coil primitives):
+bool isSceneObjectReferenced(Scene *scene, enum PrimitiveType type, u32 id) {
+    Primitive *primitive = scene->primitives;
+    for (u32 i = 0; i < scene->settings.primitives; i++, primitive++)
+        if (primitive->id == id && (primitive->type == type || (type == PrimitiveType_Helix &&
+                                                                primitive->type == PrimitiveType_Coil)))
+            return true;
+
+    return false;
+}
+
+// Objects that are still drawn by any primitive are not removed (false is returned), as their slots would otherwise
+// be drawn by those primitives while free (or once reused, as another object) - their primitives are removed first.
+bool _removeSceneObject(Scene *scene, ObjectPool *pool, enum PrimitiveType type, ObjectHandle handle) {
+    return isValidObjectHandle(pool, handle) && !isSceneObjectReferenced(scene, type, handle.index) &&
+           freePoolSlot(pool, handle);
+}
+
+INLINE bool removeCurve(Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->curve_pool, PrimitiveType_Helix, handle); }
+INLINE bool removeBox(  Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->box_pool,   PrimitiveType_Box,   handle); }
+INLINE bool removeGrid( Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->grid_pool,  PrimitiveType_Grid,  handle); }
+INLINE bool removeMesh( Scene *scene, ObjectHandle handle) { return _removeSceneObject(scene, &scene->mesh_pool,  PrimitiveType_Mesh,  handle); }
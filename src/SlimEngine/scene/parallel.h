@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../core/types.h"
+#include "../core/profiler.h"
+#include "./primitive.h"
+#include "./curve.h"
+#include "./xform.h"
+
+// Draws a scene from multiple threads, each drawing a horizontal band of the viewport (see Viewport.band_top).
+//
+// Splitting the primitives across threads instead would have them race on the pixels that their primitives share,
+// as blending is order-dependent and the depth of a pixel is read, compared and then written. With bands, every pixel
+// is written by a single thread, in the same order as when drawing serially, so the result is identical.
+// Each thread still transforms and clips all of the edges (only to skip the lines that are outside of its band),
+// which is the price paid for splitting the rasterization (most of the work) without any locking.
+//
+// The draw functions keep no scratch memory of their own, but some of them lazily update cached state that is shared:
+// The matrices of primitives, the inverted rotation of the camera and the polylines of curves.
+// These are brought up to date serially before the threads start (with curves prepared for drawing with CURVE_STEPS).
+// When drawing for multiple viewports at once, each curve is tessellated for the viewport that needs the most steps.
+typedef struct SceneDrawingBands {
+    Viewport *viewports;
+    Scene *scene;
+    CallbackForSceneDrawing drawScene;
+} SceneDrawingBands;
+
+void prepareSceneForDrawing(Scene *scene, Viewport **viewports, u32 viewport_count) {
+    for (u32 v = 0; v < viewport_count; v++)
+        updateXform3Rotation(&viewports[v]->camera->transform);
+
+    Primitive *primitive = scene->primitives;
+    for (u32 i = 0; i < scene->settings.primitives; i++, primitive++) {
+        updatePrimitiveMatrices(primitive);
+        if (primitive->type == PrimitiveType_Coil ||
+            primitive->type == PrimitiveType_Helix) {
+            Curve *curve = scene->curves + primitive->id;
+            u32 step_count = 0;
+            for (u32 v = 0; v < viewport_count; v++) {
+                mat3x4 object_to_view = getPrimitiveViewMatrix(primitive, &viewports[v]->camera->transform);
+                u32 viewport_step_count = getCurveStepCount(curve, CURVE_STEPS, primitive, &object_to_view, viewports[v]);
+                if (step_count < viewport_step_count) step_count = viewport_step_count;
+            }
+            updateCurvePoints(curve, step_count, primitive->type);
+            curve->points_viewport = viewport_count == 1 ? viewports[0] : null;
+        }
+    }
+}
+
+void drawSceneBand(void *data, u32 index) {
+    SceneDrawingBands *bands = (SceneDrawingBands*)data;
+    bands->drawScene(bands->scene, bands->viewports + index);
+}
+
+// The viewports of the bands only last for the call, so they are allocated from the given memory (meant to be
+// the app's frame memory) and popped off of it before returning. Without room for them the scene is drawn as a whole.
+void drawSceneInParallel(Scene *scene, Viewport *viewport, CallbackForSceneDrawing drawScene, Memory *memory, Platform *platform) {
+    u32 band_count = platform->runInParallel ? platform->thread_count : 1;
+    u32 max_band_count = viewport->dimensions.height / PARALLEL__MIN_BAND_HEIGHT;
+    if (band_count > max_band_count) band_count = max_band_count;
+    if (band_count > PARALLEL__MAX_THREADS) band_count = PARALLEL__MAX_THREADS;
+    MemoryMarker marker = pushMemoryMarker(memory);
+    SceneDrawingBands bands;
+    bands.viewports = band_count > 1 && !viewport->band_bottom ?
+                      (Viewport*)allocateMemory(memory, sizeof(Viewport) * band_count) : null;
+    if (!bands.viewports) {
+        drawScene(scene, viewport);
+        return;
+    }
+
+    PROFILE_BEGIN("drawSceneInParallel");
+
+    prepareSceneForDrawing(scene, &viewport, 1);
+
+    bands.scene = scene;
+    bands.drawScene = drawScene;
+    i32 height = viewport->dimensions.height;
+    RasterizerStats empty_stats = {0};
+    for (u32 i = 0; i < band_count; i++) {
+        Viewport *band = bands.viewports + i;
+        *band = *viewport;
+        band->band_top    = (i32)((u32)height * i       / band_count);
+        band->band_bottom = (i32)((u32)height * (i + 1) / band_count);
+        band->stats = empty_stats;
+        band->has_prepared_curves = true;
+    }
+
+    profiler.paused = true;
+    platform->runInParallel(drawSceneBand, &bands, band_count);
+    profiler.paused = false;
+
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    // Every band goes through all of the geometry, while the pixels are split between them:
+    RasterizerStats *stats = &viewport->stats;
+    RasterizerStats *geometry_stats = &bands.viewports[0].stats;
+    stats->edges                += geometry_stats->edges;
+    stats->culled_edges         += geometry_stats->culled_edges;
+    stats->clipped_edges        += geometry_stats->clipped_edges;
+    stats->lines                += geometry_stats->lines;
+    stats->curve_segments       += geometry_stats->curve_segments;
+    stats->saved_curve_segments += geometry_stats->saved_curve_segments;
+    for (u32 i = 0; i < band_count; i++) {
+        RasterizerStats *band_stats = &bands.viewports[i].stats;
+        stats->pixels             += band_stats->pixels;
+        stats->blended_pixels     += band_stats->blended_pixels;
+        stats->overwritten_pixels += band_stats->overwritten_pixels;
+    }
+#endif
+    popMemoryMarker(memory, marker);
+
+    PROFILE_END();
+}
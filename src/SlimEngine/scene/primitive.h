@@ -5,6 +5,7 @@
 #include "../math/mat3.h"
 #include "../math/mat4.h"
 #include "../math/quat.h"
+#include "./xform.h"
 
 INLINE void convertPositionAndDirectionToObjectSpace(
     vec3 position, 
@@ -32,6 +33,54 @@ INLINE void convertPositionAndDirectionToObjectSpace(
     }
 }
 
+void updatePrimitiveMatrices(Primitive *primitive) {
+    if (!(primitive->flags & IS_DIRTY)) return;
+
+    vec3 scale = primitive->flags & IS_SCALED ? primitive->scale : getVec3Of(1);
+    mat3 rotation;
+    rotation.X = Vec3(1, 0, 0);
+    rotation.Y = Vec3(0, 1, 0);
+    rotation.Z = Vec3(0, 0, 1);
+    if (primitive->flags & IS_ROTATED) {
+        rotation.X = mulVec3Quat(rotation.X, primitive->rotation);
+        rotation.Y = mulVec3Quat(rotation.Y, primitive->rotation);
+        rotation.Z = mulVec3Quat(rotation.Z, primitive->rotation);
+    }
+
+    mat3x4 *M = &primitive->world_matrix;
+    M->X = scaleVec3(rotation.X, scale.x);
+    M->Y = scaleVec3(rotation.Y, scale.y);
+    M->Z = scaleVec3(rotation.Z, scale.z);
+    M->W = primitive->flags & IS_TRANSLATED ? primitive->position : getVec3Of(0);
+
+    // The inverse un-translates, un-rotates (by the transposed rotation) and then un-scales:
+    vec3 inv_scale = oneOverVec3(scale);
+    mat3 inverse;
+    inverse.X = mulVec3(Vec3(rotation.X.x, rotation.Y.x, rotation.Z.x), inv_scale);
+    inverse.Y = mulVec3(Vec3(rotation.X.y, rotation.Y.y, rotation.Z.y), inv_scale);
+    inverse.Z = mulVec3(Vec3(rotation.X.z, rotation.Y.z, rotation.Z.z), inv_scale);
+
+    mat3x4 *I = &primitive->world_matrix_inverted;
+    I->X = inverse.X;
+    I->Y = inverse.Y;
+    I->Z = inverse.Z;
+    I->W = invertedVec3(mulVec3Mat3(M->W, inverse));
+
+    primitive->flags &= (u8)~IS_DIRTY;
+}
+
+// Returns a matrix that transforms positions from the primitive's object space directly into the view space of the
+// given camera transform. It is computed once per draw call, so that each vertex is transformed with a single multiply.
+INLINE mat3x4 getPrimitiveViewMatrix(Primitive *primitive, xform3 *camera_transform) {
+    updatePrimitiveMatrices(primitive);
+
+    mat3x4 view_matrix = primitive->world_matrix;
+    view_matrix.W = subVec3(view_matrix.W, camera_transform->position);
+    mulVec3ArrayQuat(view_matrix.axis, 4, getXform3InvertedRotation(camera_transform), view_matrix.axis);
+
+    return view_matrix;
+}
+
 INLINE vec3 convertPositionToWorldSpace(vec3 position, Primitive *primitive) {
     if (primitive->flags & IS_SCALED)     position = mulVec3(    position, primitive->scale);
     if (primitive->flags & IS_ROTATED)    position = mulVec3Quat(position, primitive->rotation);
@@ -85,4 +134,5 @@ void rotatePrimitive(Primitive *primitive, f32 yaw, f32 pitch, f32 roll) {
 
     primitive->rotation = mulQuat(primitive->rotation, rotation);
     primitive->rotation = normQuat(primitive->rotation);
+    primitive->flags |= IS_DIRTY;
 }
\ No newline at end of file
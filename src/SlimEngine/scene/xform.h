@@ -6,15 +6,34 @@
 #include "../math/quat.h"
 
 INLINE void rotateXform3(xform3 *xform, f32 yaw, f32 pitch, f32 roll) {
+    if (!(yaw || pitch || roll)) return;
+
     if (yaw)   yawMat3(  yaw,   &xform->yaw_matrix);
     if (pitch) pitchMat3(pitch, &xform->pitch_matrix);
     if (roll)  rollMat3( roll,  &xform->roll_matrix);
 
     xform->rotation_matrix = mulMat3(mulMat3(xform->pitch_matrix, xform->yaw_matrix), xform->roll_matrix);
-    xform->rotation_matrix_inverted = transposedMat3(xform->rotation_matrix);
+    xform->dirty |= XFORM3__DIRTY_ROTATION;
+}
+
+INLINE void updateXform3Rotation(xform3 *xform) {
+    if (!(xform->dirty & XFORM3__DIRTY_ROTATION)) return;
 
     xform->rotation          = convertRotationMatrixToQuaternion(xform->rotation_matrix);
-    xform->rotation_inverted = convertRotationMatrixToQuaternion(xform->rotation_matrix_inverted);
+    xform->rotation_inverted = conjugate(xform->rotation);
+    xform->dirty &= (u8)~XFORM3__DIRTY_ROTATION;
+}
+
+INLINE quat getXform3Rotation(xform3 *xform) {
+    updateXform3Rotation(xform);
+    return xform->rotation;
+}
+
+INLINE quat getXform3InvertedRotation(xform3 *xform) {
+    updateXform3Rotation(xform);
+    return xform->rotation_inverted;
+}
 
-    xform->matrix = mulMat3(xform->matrix, xform->rotation_matrix);
-}
\ No newline at end of file
+INLINE mat3 getXform3InvertedRotationMatrix(xform3 *xform) {
+    return transposedMat3(xform->rotation_matrix);
+}
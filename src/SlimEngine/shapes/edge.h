@@ -12,7 +12,10 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
 
     u8 out = (A.z < distance) | ((B.z < distance) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, (distance - A.z) / (B.z - A.z));
         else         B = lerpVec3(B, A, (distance - B.z) / (A.z - B.z));
     }
@@ -20,7 +23,10 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
     distance = viewport->settings.far_clipping_plane_distance;
     out = (A.z > distance) | ((B.z > distance) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, (A.z - distance) / (A.z - B.z));
         else         B = lerpVec3(B, A, (B.z - distance) / (B.z - A.z));
     }
@@ -32,7 +38,10 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
 
     out = (NdotA < 0) | ((NdotB < 0) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
         else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
     }
@@ -44,7 +53,10 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
 
     out = (NdotA < 0) | ((NdotB < 0) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
         else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
     }
@@ -56,7 +68,10 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
 
     out = (NdotA < 0) | ((NdotB < 0) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
         else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
     }
@@ -68,11 +83,19 @@ bool cullAndClipEdge(Edge *edge, Viewport *viewport) {
 
     out = (NdotA < 0) | ((NdotB < 0) << 1);
     if (out) {
-        if (out == 3) return false;
+        if (out == 3) {
+            COUNT_RASTERIZER_STAT(viewport, culled_edges);
+            return false;
+        }
         if (out & 1) A = lerpVec3(A, B, NdotA / (NdotA - NdotB));
         else         B = lerpVec3(B, A, NdotB / (NdotB - NdotA));
     }
 
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    if (!(isEqualVec3(A, edge->from) && isEqualVec3(B, edge->to)))
+        COUNT_RASTERIZER_STAT(viewport, clipped_edges);
+#endif
+
     edge->from = A;
     edge->to   = B;
 
@@ -104,6 +127,8 @@ INLINE bool projectEdge(Edge *edge, Viewport *viewport) {
 }
 
 INLINE void drawEdge(Edge *edge, vec3 color, f32 opacity, u8 line_width, Viewport *viewport) {
+    COUNT_RASTERIZER_STAT(viewport, edges);
+
     if (projectEdge(edge, viewport))
         drawLine(edge->from.x, edge->from.y, edge->from.z,
                  edge->to.x,   edge->to.y,   edge->to.z,
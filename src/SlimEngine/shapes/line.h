@@ -8,6 +8,7 @@ void drawHLine(i32 x_start, i32 x_end, i32 y, vec3 color, f32 opacity, Viewport
     y       += viewport->position.y;
 
     if (!inRange(y, viewport->dimensions.height + viewport->position.y, viewport->position.y)) return;
+    if (!isRowInViewportBand(viewport->settings.antialias ? y << 1 : y, viewport)) return;
 
     i32 first, last, step = 1;
     subRange(x_start, x_end, viewport->dimensions.width + viewport->position.x, viewport->position.x, &first, &last);
@@ -72,6 +73,8 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         y2 < 0)
         return;
 
+    COUNT_RASTERIZER_STAT(viewport, lines);
+
     i32 x_left = viewport->position.x;
     i32 y_top  = viewport->position.y;
     x1 += (f32)x_left;
@@ -91,14 +94,31 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         y2 += y2;
         w <<= 1;
         h <<= 1;
+        x_left <<= 1;
+        y_top  <<= 1;
         line_width <<= 1;
         line_width++;
     }
+
+    // Only the rows of the viewport's band are drawn into (when drawing it from one of multiple threads):
+    i32 y_first = y_top;
+    if (viewport->band_bottom) {
+        y_first = viewport->position.y + viewport->band_top;
+        h       = viewport->position.y + viewport->band_bottom;
+        if (viewport->settings.antialias) {
+            y_first <<= 1;
+            h       <<= 1;
+        }
+        if ((y1 < y2 ? y2 : y1) + (f32)line_width + 2 < (f32)y_first ||
+            (y1 < y2 ? y1 : y2) - 1 >= (f32)h)
+            return;
+    }
+
     f64 tmp, z_range, range_remap;
     f32 dx = x2 - x1;
     f32 dy = y2 - y1;
     f32 gap, grad, first_offset, last_offset;
-    f64 z, z_curr, z_step;
+    f64 z, z_curr = 0, z_step = 0;
     vec3 first, last;
     vec2i start, end;
     bool has_depth = z1 || z2;
@@ -129,15 +149,15 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         gap = oneMinusFractionOf(x1 + 0.5f);
 
         if (inRange(x, w, x_left)) {
-            if (inRange(y, h, y_top)) setPixel(x, y, z1, color, oneMinusFractionOf(first.y) * gap * opacity, viewport);
+            if (inRange(y, h, y_first)) setPixel(x, y, z1, color, oneMinusFractionOf(first.y) * gap * opacity, viewport);
 
             for (u8 i = 0; i < line_width; i++) {
                 y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z1, color, opacity, viewport);
+                if (inRange(y, h, y_first)) setPixel(x, y, z1, color, opacity, viewport);
             }
 
             y++;
-            if (inRange(y, h, y_top)) setPixel(x, y, z1, color, fractionOf(first.y) * gap * opacity, viewport);
+            if (inRange(y, h, y_first)) setPixel(x, y, z1, color, fractionOf(first.y) * gap * opacity, viewport);
         }
 
         x = end.x;
@@ -145,15 +165,15 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         gap = fractionOf(x2 + 0.5f);
 
         if (inRange(x, w, x_left)) {
-            if (inRange(y, h, y_top)) setPixel(x, y, z2, color, oneMinusFractionOf(last.y) * gap * opacity, viewport);
+            if (inRange(y, h, y_first)) setPixel(x, y, z2, color, oneMinusFractionOf(last.y) * gap * opacity, viewport);
 
             for (u8 i = 0; i < line_width; i++) {
                 y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z2, color, opacity, viewport);
+                if (inRange(y, h, y_first)) setPixel(x, y, z2, color, opacity, viewport);
             }
 
             y++;
-            if (inRange(y, h, y_top)) setPixel(x, y, z2, color, fractionOf(last.y) * gap * opacity, viewport);
+            if (inRange(y, h, y_first)) setPixel(x, y, z2, color, fractionOf(last.y) * gap * opacity, viewport);
         }
 
         if (has_depth) { // Compute one-over-z start and step
@@ -173,15 +193,15 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
             if (inRange(x, w, x_left)) {
                 if (has_depth) z = 1.0 / z_curr;
                 y = (i32) gap;
-                if (inRange(y, h, y_top)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
+                if (inRange(y, h, y_first)) setPixel(x, y, z, color, oneMinusFractionOf(gap) * opacity, viewport);
 
                 for (u8 i = 0; i < line_width; i++) {
                     y++;
-                    if (inRange(y, h, y_top)) setPixel(x, y, z, color, opacity, viewport);
+                    if (inRange(y, h, y_first)) setPixel(x, y, z, color, opacity, viewport);
                 }
 
                 y++;
-                if (inRange(y, h, y_top)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
+                if (inRange(y, h, y_first)) setPixel(x, y, z, color, fractionOf(gap) * opacity, viewport);
             }
 
             gap += grad;
@@ -215,7 +235,7 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         y = start.y;
         gap = oneMinusFractionOf(y1 + 0.5f);
 
-        if (inRange(y, h, y_top)) {
+        if (inRange(y, h, y_first)) {
             if (inRange(x, w, x_left)) setPixel(x, y, z1, color, oneMinusFractionOf(first.x) * gap * opacity, viewport);
 
             for (u8 i = 0; i < line_width; i++) {
@@ -231,7 +251,7 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
         y = end.y;
         gap = fractionOf(y2 + 0.5f);
 
-        if (inRange(y, h, y_top)) {
+        if (inRange(y, h, y_first)) {
             if (inRange(x, w, x_left)) setPixel(x, y, z2, color, oneMinusFractionOf(last.x) * gap * opacity, viewport);
 
             for (u8 i = 0; i < line_width; i++) {
@@ -257,7 +277,7 @@ INLINE void drawLine(f32 x1, f32 y1, f64 z1,
 
         gap = first.x + grad;
         for (y = start.y + 1; y < end.y; y++) {
-            if (inRange(y, h, y_top)) {
+            if (inRange(y, h, y_first)) {
                 if (has_depth) z = 1.0 / z_curr;
                 x = (i32)gap;
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../core/types.h"
+#include "../core/profiler.h"
+#include "../scene/parallel.h"
+#include "./viewport.h"
+#include "./hud.h"
+
+// Draws the scene for multiple viewports at once, each through its own camera, one viewport per thread.
+//
+// The viewports share the app's frame buffer, each owning a rectangular region of it (see setViewportRegion):
+// Their pixels are addressed by their position with a stride of the window's width, so the regions must not overlap.
+// A viewport therefore never writes pixels that another one reads or writes, and needs no copy of the frame buffer.
+// Once all of the viewports are drawn, composeViewports resolves them into the window's content in a single pass over
+// its rows, followed by the retained HUD of each viewport (so a viewport's HUD is not drawn into its pixels at all).
+void initCompositor(Compositor *compositor, Scene *scene, CallbackForSceneDrawing drawScene) {
+    compositor->viewport_count = 0;
+    compositor->scene = scene;
+    compositor->drawScene = drawScene;
+}
+
+bool addViewportToCompositor(Compositor *compositor, Viewport *viewport) {
+    if (compositor->viewport_count == COMPOSITOR__MAX_VIEWPORTS) return false;
+
+    compositor->viewports[compositor->viewport_count++] = viewport;
+    return true;
+}
+
+// Places the viewport at the given region of a window of the given width (shrunk to fit the window's frame buffer).
+// A viewport with a lower resolution scale draws into the top-left part of its region, and is scaled up to all of it:
+void setViewportRegion(Viewport *viewport, u16 x, u16 y, u16 width, u16 height, u16 window_width) {
+    if (x > window_width) x = window_width;
+    if (width > window_width - x) width = window_width - x;
+    if (width < 1) width = 1;
+    if (height < 1) height = 1;
+    viewport->position.x = x;
+    viewport->position.y = y;
+    resizeViewport(viewport, width, height, window_width);
+}
+
+void drawComposedViewport(void *data, u32 index) {
+    Compositor *compositor = (Compositor*)data;
+    Viewport *viewport = compositor->viewports[index];
+
+    beginDrawing(viewport);
+    compositor->drawScene(compositor->scene, viewport);
+    if (viewport->settings.show_hud) {
+        if (isHUDRetained(&viewport->hud))
+            updateHUD(viewport, &viewport->hud);
+        else
+            drawHUD(viewport, &viewport->hud);
+    }
+}
+
+void composeViewports(Compositor *compositor, u32 *window_content, u16 width, u16 height, Platform *platform) {
+    PROFILE_BEGIN("composeViewports");
+
+    u32 viewport_count = compositor->viewport_count;
+    Viewport **viewports = compositor->viewports;
+    prepareSceneForDrawing(compositor->scene, viewports, viewport_count);
+    for (u32 i = 0; i < viewport_count; i++) viewports[i]->has_prepared_curves = true;
+
+    if (viewport_count > 1 && platform->runInParallel && platform->thread_count > 1) {
+        profiler.paused = true;
+        platform->runInParallel(drawComposedViewport, compositor, viewport_count);
+        profiler.paused = false;
+    } else
+        for (u32 i = 0; i < viewport_count; i++)
+            drawComposedViewport(compositor, i);
+
+    for (u32 i = 0; i < viewport_count; i++) viewports[i]->has_prepared_curves = false;
+
+    u32 backgrounds[COMPOSITOR__MAX_VIEWPORTS];
+    for (u32 i = 0; i < viewport_count; i++) backgrounds[i] = getViewportBackgroundValue(viewports[i]);
+
+    // Each row is cleared and then resolved from every viewport that covers it, left to right:
+    u32 *trg_value = window_content;
+    for (u16 y = 0; y < height; y++, trg_value += width) {
+        for (u16 x = 0; x < width; x++) trg_value[x] = 0;
+        for (u32 i = 0; i < viewport_count; i++) {
+            Viewport *viewport = viewports[i];
+            i32 row = (i32)y - viewport->position.y;
+            if (row < 0 || row >= getViewportWindowHeight(viewport)) continue;
+
+            resolveViewportWindowRow(viewport, (u16)row, backgrounds[i], trg_value + viewport->position.x);
+        }
+    }
+
+    for (u32 i = 0; i < viewport_count; i++)
+        if (viewports[i]->settings.show_hud && isHUDRetained(&viewports[i]->hud))
+            drawHUDToWindowContent(viewports[i], window_content, width);
+
+    PROFILE_END();
+}
@@ -2,8 +2,11 @@
 
 #include "../core/base.h"
 #include "../core/text.h"
+#include "../core/profiler.h"
 
 void drawHUD(Viewport *viewport, HUD *hud) {
+    PROFILE_BEGIN("drawHUD");
+
     u16 x = (u16)hud->position.x;
     u16 y = (u16)hud->position.y;
 
@@ -23,4 +26,154 @@ void drawHUD(Viewport *viewport, HUD *hud) {
                  Color(alt ? line->alternate_value_color : line->value_color), 1, viewport);
         y += (u16)(hud->line_height * (f32)FONT_HEIGHT);
     }
+
+    PROFILE_END();
+}
+
+// The HUD is retained: Each line is rendered into runs of resolved pixels only when what it shows has changed
+// (its text, colors or position, or the viewport's dimensions), and the runs of all lines are then composited
+// over the window content as it is being resolved (see drawViewportToWindowContent).
+// Unchanged lines cost nothing to re-render, and compositing only touches the pixels of the text itself.
+// When the HUD's lines were not given storage for runs (see ViewportSettings.hud_runs) it is drawn with drawHUD.
+INLINE u64 hashIntoHUDKey(u64 key, u64 value) {
+    return (key ^ value) * 1099511628211ULL; // FNV-1a
+}
+
+INLINE u64 hashTextIntoHUDKey(u64 key, char *text) {
+    while (*text) key = hashIntoHUDKey(key, (u64)(u8)*text++);
+    return hashIntoHUDKey(key, 0);
+}
+
+// Appends the runs of pixels of the given text, laid out and clipped exactly as drawText does:
+u32 addTextRuns(char *str, i32 x, i32 y, vec3 color, Dimensions *dimensions, HUDRun *runs, u32 run_count) {
+    if (x < 0 || x > dimensions->width  - FONT_WIDTH ||
+        y < 0 || y > dimensions->height - FONT_HEIGHT)
+        return run_count;
+
+    if (!glyph_atlas.is_initialized) initGlyphAtlas();
+
+    // Resolve the color as drawViewportToWindowContent does for an opaque pixel:
+    color = mulVec3(color, color);
+    RGBA2u32 pixel;
+    pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+    pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+    pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+    pixel.rgba.A = (u8)FLOAT_TO_COLOR_COMPONENT;
+
+    u16 current_x = (u16)x;
+    u16 current_y = (u16)y;
+    char character = *str;
+    while (character) {
+        if (character == '\n') {
+            if (current_y + FONT_HEIGHT > dimensions->height)
+                break;
+
+            current_x = (u16)x;
+            current_y += LINE_HEIGHT;
+        } else if (character == '\t') {
+            current_x += FONT_WIDTH * (4 - ((current_x / FONT_WIDTH) & 3));
+        } else if (character >= FIRST_CHARACTER_CODE &&
+                   character <= LAST_CHARACTER_CODE) {
+            Glyph *glyph = glyph_atlas.glyphs + (character - FIRST_CHARACTER_CODE);
+            GlyphSpan *span = glyph_atlas.spans + glyph->first_span;
+            for (u16 s = 0; s < glyph->span_count && run_count < HUD__MAX_LINE_RUNS; s++, span++) {
+                if (current_y + span->row >= dimensions->height) break;
+
+                HUDRun *run = runs + run_count++;
+                run->x = current_x + span->first;
+                run->y = current_y + span->row;
+                run->length = span->length;
+                run->value = pixel.value;
+            }
+            current_x += FONT_WIDTH;
+            if (current_x + FONT_WIDTH > dimensions->width)
+                break;
+        }
+        character = *++str;
+    }
+
+    return run_count;
+}
+
+void updateHUD(Viewport *viewport, HUD *hud) {
+    PROFILE_BEGIN("updateHUD");
+
+    u16 x = (u16)hud->position.x;
+    u16 y = (u16)hud->position.y;
+
+    // The runs are composited at the window's resolution, so they are laid out for the viewport's size in the window:
+    Dimensions dimensions = viewport->dimensions;
+    if (isViewportScaled(viewport)) {
+        dimensions.width  = viewport->scaling.width;
+        dimensions.height = viewport->scaling.height;
+    }
+
+    HUDLine *line = hud->lines;
+    bool alt;
+    for (u32 i = 0; i < hud->line_count; i++, line++) {
+        if (line->use_alternate) {
+            alt = *line->use_alternate;
+            if (line->invert_alternate_use)
+                alt = !alt;
+        } else
+            alt = false;
+
+        char *value = alt ? line->alternate_value.char_ptr : line->value.string.char_ptr;
+        enum ColorID value_color = alt ? line->alternate_value_color : line->value_color;
+        u16 value_x = x + (u16)line->title.length * FONT_WIDTH;
+
+        u64 key = 14695981039346656037ULL;
+        key = hashTextIntoHUDKey(key, line->title.char_ptr);
+        key = hashTextIntoHUDKey(key, value);
+        key = hashIntoHUDKey(key, (u64)line->title_color | ((u64)value_color << 16) | ((u64)value_x << 32));
+        key = hashIntoHUDKey(key, (u64)x | ((u64)y << 16) | ((u64)dimensions.width << 32) | ((u64)dimensions.height << 48));
+        if (key != line->rendered_key) {
+            line->run_count = addTextRuns(line->title.char_ptr, x, y, Color(line->title_color), &dimensions, line->runs, 0);
+            line->run_count = addTextRuns(value, value_x, y, Color(value_color), &dimensions, line->runs, line->run_count);
+            line->rendered_key = key;
+        }
+
+        y += (u16)(hud->line_height * (f32)FONT_HEIGHT);
+    }
+
+    PROFILE_END();
+}
+
+void drawHUDToWindowContent(Viewport *viewport, u32 *window_content, u16 window_width) {
+    HUD *hud = &viewport->hud;
+    window_content += (u32)window_width * (u32)viewport->position.y + (u32)viewport->position.x;
+    HUDLine *line = hud->lines;
+    for (u32 i = 0; i < hud->line_count; i++, line++) {
+        HUDRun *run = line->runs;
+        for (u32 r = 0; r < line->run_count; r++, run++) {
+            u32 *pixel = window_content + (u32)window_width * run->y + run->x;
+            for (u16 p = 0; p < run->length; p++) pixel[p] = run->value;
+        }
+    }
+}
+
+INLINE bool isHUDRetained(HUD *hud) {
+    return hud->line_count && hud->lines->runs;
+}
+
+void setRasterizerStatsInHUD(HUD *hud, u32 first_line, RasterizerStats *stats) {
+    HUDLine *line = hud->lines + first_line;
+    setString(&line[0].title, (char*)"Edges  : ");
+    setString(&line[1].title, (char*)"Culled : ");
+    setString(&line[2].title, (char*)"Clipped: ");
+    setString(&line[3].title, (char*)"Lines  : ");
+    setString(&line[4].title, (char*)"Pixels : ");
+    setString(&line[5].title, (char*)"Blended: ");
+    setString(&line[6].title, (char*)"Overwrt: ");
+    setString(&line[7].title, (char*)"Curves : ");
+    setString(&line[8].title, (char*)"Saved  : ");
+    printCountIntoString(stats->edges,              &line[0].value);
+    printCountIntoString(stats->culled_edges,       &line[1].value);
+    printCountIntoString(stats->clipped_edges,      &line[2].value);
+    printCountIntoString(stats->lines,              &line[3].value);
+    printCountIntoString(stats->pixels,             &line[4].value);
+    printCountIntoString(stats->blended_pixels,     &line[5].value);
+    printCountIntoString(stats->overwritten_pixels, &line[6].value);
+    printCountIntoString(stats->curve_segments,       &line[7].value);
+    printCountIntoString(stats->saved_curve_segments, &line[8].value);
 }
\ No newline at end of file
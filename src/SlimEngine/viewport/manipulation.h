@@ -5,6 +5,8 @@
 #include "../math/quat.h"
 #include "../scene/primitive.h"
 #include "../scene/box.h"
+#include "../core/profiler.h"
+#include "../core/pool.h"
 
 void setViewportProjectionPlane(Viewport *viewport) {
     Camera *camera = viewport->camera;
@@ -108,31 +110,43 @@ INLINE BoxSide hitCube(RayHit *hit, vec3 *Ro, vec3 *Rd) {
 
 INLINE bool rayHitScene(Ray *ray, RayHit *local_hit, RayHit *hit, Scene *scene) {
     bool current_found, found = false;
-    vec3 Ro, Rd;
-    Primitive hit_primitive, primitive;
+    vec3 Ro, Rd, mesh_scale = getVec3Of(1);
+    Primitive *primitive;
     for (u32 i = 0; i < scene->settings.primitives; i++) {
-        primitive = scene->primitives[i];
-        if (primitive.type == PrimitiveType_Mesh)
-            primitive.scale = mulVec3(primitive.scale, scene->meshes[primitive.id].aabb.max);
-
-        convertPositionAndDirectionToObjectSpace(ray->origin, ray->direction, &primitive, &Ro, &Rd);
+        if (!isPoolSlotActive(&scene->primitive_pool, i)) continue;
+
+        // Bring the ray into the primitive's object space using it's cached inverted world matrix:
+        primitive = scene->primitives + i;
+        updatePrimitiveMatrices(primitive);
+        Ro = mulVec3Mat3x4(ray->origin, primitive->world_matrix_inverted);
+        Rd = subVec3(mulVec3Mat3x4(addVec3(ray->origin, ray->direction), primitive->world_matrix_inverted), Ro);
+        if (primitive->type == PrimitiveType_Mesh) {
+            mesh_scale = scene->meshes[primitive->id].aabb.max;
+            Ro = mulVec3(Ro, oneOverVec3(mesh_scale));
+            Rd = mulVec3(Rd, oneOverVec3(mesh_scale));
+        }
+        Rd = normVec3(Rd);
 
         current_found = hitCube(local_hit, &Ro, &Rd);
         if (current_found) {
-            local_hit->position       = convertPositionToWorldSpace(local_hit->position, &primitive);
+            if (primitive->type == PrimitiveType_Mesh)
+                local_hit->position = mulVec3(local_hit->position, mesh_scale);
+            local_hit->position       = mulVec3Mat3x4(local_hit->position, primitive->world_matrix);
             local_hit->distance_squared = squaredLengthVec3(subVec3(local_hit->position, ray->origin));
             if (local_hit->distance_squared < hit->distance_squared) {
                 *hit = *local_hit;
-                hit->object_type = primitive.type;
+                hit->object_type = primitive->type;
                 hit->object_id = i;
-
-                hit_primitive = primitive;
                 found = true;
             }
         }
     }
 
     if (found) {
+        // The normal is brought to world space by the hit primitive (scaled by the bounds of its mesh, as was the ray):
+        Primitive hit_primitive = scene->primitives[hit->object_id];
+        if (hit_primitive.type == PrimitiveType_Mesh)
+            hit_primitive.scale = mulVec3(hit_primitive.scale, scene->meshes[hit_primitive.id].aabb.max);
         hit->distance = sqrtf(hit->distance_squared);
         hit->normal = normVec3(convertDirectionToWorldSpace(hit->normal, &hit_primitive));
     }
@@ -141,6 +155,8 @@ INLINE bool rayHitScene(Ray *ray, RayHit *local_hit, RayHit *hit, Scene *scene)
 }
 
 void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
+    PROFILE_BEGIN("manipulateSelection");
+
     Mouse *mouse = &controls->mouse;
     Camera *camera = viewport->camera;
     Dimensions *dimensions = &viewport->dimensions;
@@ -152,12 +168,23 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
     vec3 position;
     vec3 *cam_pos = &camera->transform.position;
     mat3 *rot     = &camera->transform.rotation_matrix;
-    mat3 *inv_rot = &camera->transform.rotation_matrix_inverted;
+    mat3 inv_rot  = getXform3InvertedRotationMatrix(&camera->transform);
     RayHit *hit = &selection->hit;
     Ray ray, *local_ray = &selection->local_ray;
     Primitive primitive;
     vec2i mouse_pos = Vec2i(mouse->pos.x - viewport->position.x,
                             mouse->pos.y - viewport->position.y);
+    if (isViewportScaled(viewport)) {
+        mouse_pos.x = mouse_pos.x * viewport->dimensions.width  / viewport->scaling.width;
+        mouse_pos.y = mouse_pos.y * viewport->dimensions.height / viewport->scaling.height;
+    }
+
+    // Drop the selection if the selected primitive was removed (even if it's slot was since reused by another one):
+    if (selection->primitive && !isValidObjectHandle(&scene->primitive_pool, selection->primitive_handle)) {
+        selection->primitive = null;
+        selection->object_type = 0;
+        selection->changed = true;
+    }
 
     if (mouse->left_button.is_pressed) {
         if (!mouse->left_button.is_handled) { // This is the first frame after the left mouse button went down:
@@ -181,13 +208,14 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
 
                 // Capture a pointer to the selected object's position for later use in transformations:
                 selection->primitive = scene->primitives + selection->object_id;
+                selection->primitive_handle = getObjectHandle(&scene->primitive_pool, selection->object_id);
                 selection->world_position = &selection->primitive->position;
                 selection->transformation_plane_origin = hit->position;
 
                 selection->world_offset = subVec3(hit->position, *selection->world_position);
 
                 // Track how far away the hit position is from the camera along the z axis:
-                position = mulVec3Mat3(subVec3(hit->position, ray.origin), *inv_rot);
+                position = mulVec3Mat3(subVec3(hit->position, ray.origin), inv_rot);
                 selection->object_distance = position.z;
             } else {
                 if (selection->object_type)
@@ -241,7 +269,7 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                                 position = subVec3(hit->position, selection->world_offset);
                                 *selection->world_position = position;
                                 if (selection->primitive)
-                                    selection->primitive->flags |= IS_TRANSLATED;
+                                    selection->primitive->flags |= IS_TRANSLATED | IS_DIRTY;
                             } else if (mouse->middle_button.is_pressed) {
                                 position      = selection->transformation_plane_origin;
                                 position      = convertPositionToObjectSpace(     position, &primitive);
@@ -249,7 +277,7 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
 
                                 selection->primitive->scale = mulVec3(selection->object_scale,
                                                                              mulVec3(hit->position, oneOverVec3(position)));
-                                selection->primitive->flags |= IS_SCALED | IS_SCALED_NON_UNIFORMLY;
+                                selection->primitive->flags |= IS_SCALED | IS_SCALED_NON_UNIFORMLY | IS_DIRTY;
                             } else if (mouse->right_button.is_pressed) {
                                 vec3 v1 = subVec3(hit->position,
                                                   selection->transformation_plane_center);
@@ -261,7 +289,7 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                                 q = normQuat(q);
                                 selection->primitive->rotation = mulQuat(q, selection->object_rotation);
                                 selection->primitive->rotation = normQuat(selection->primitive->rotation);
-                                selection->primitive->flags |= IS_ROTATED;
+                                selection->primitive->flags |= IS_ROTATED | IS_DIRTY;
                             }
                         }
                     }
@@ -289,13 +317,17 @@ void manipulateSelection(Scene *scene, Viewport *viewport, Controls *controls) {
                 position = subVec3(position, selection->world_offset);
                 *selection->world_position = position;
                 if (selection->primitive)
-                    selection->primitive->flags |= IS_TRANSLATED;
+                    selection->primitive->flags |= IS_TRANSLATED | IS_DIRTY;
             }
         }
     }
+
+    PROFILE_END();
 }
 
 void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
+    PROFILE_BEGIN("drawSelection");
+
     Mouse *mouse = &controls->mouse;
     Selection *selection = scene->selection;
     Box *box = &selection->box;
@@ -303,10 +335,13 @@ void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
     if (controls->is_pressed.alt &&
         !mouse->is_captured &&
         selection->object_type &&
-        selection->primitive) {
+        selection->primitive &&
+        isValidObjectHandle(&scene->primitive_pool, selection->primitive_handle)) {
         Primitive primitive = *selection->primitive;
-        if (primitive.type == PrimitiveType_Mesh)
+        if (primitive.type == PrimitiveType_Mesh) {
             primitive.scale = mulVec3(primitive.scale, scene->meshes[primitive.id].aabb.max);
+            primitive.flags |= IS_DIRTY;
+        }
 
         initBox(box);
         drawBox(box, BOX__ALL_SIDES, &primitive, Color(Yellow), 0.5f, 0, viewport);
@@ -321,4 +356,6 @@ void drawSelection(Scene *scene, Viewport *viewport, Controls *controls) {
             drawBox(box, selection->box_side, &primitive, color, 0.5f, 1, viewport);
         }
     }
+
+    PROFILE_END();
 }
\ No newline at end of file
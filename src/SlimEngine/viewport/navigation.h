@@ -119,4 +119,8 @@ void navigateViewport(Viewport *viewport, f32 delta_time) {
         movement = mulVec3Mat3(movement, camera->transform.rotation_matrix);
         camera->transform.position = addVec3(camera->transform.position, movement);
     }
+
+    // Gliding to a stop (or turning while a key is held) goes on without any input arriving, so when rendering on
+    // demand the next frame is requested here (for whichever viewport is navigated):
+    if (navigation->moved || navigation->turned) app->needs_redraw = true;
 }
\ No newline at end of file
@@ -2,55 +2,157 @@
 
 #include "../math/vec3.h"
 #include "./hud.h"
+#include "../core/profiler.h"
 
-typedef union RGBA2u32 {
-    RGBA rgba;
-    u32 value;
-} RGBA2u32;
-
-void drawViewportToWindowContent(Viewport *viewport) {
-    PixelQuad *src_pixel = viewport->pixels;
-    u32 *trg_value = app->window_content;
-    vec3 color;
-    RGBA2u32 background, trg_pixel;
+INLINE u32 getViewportBackgroundValue(Viewport *viewport) {
+    RGBA2u32 background;
     background.rgba.R = (u8)(viewport->settings.background.color.r * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.G = (u8)(viewport->settings.background.color.g * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.B = (u8)(viewport->settings.background.color.b * FLOAT_TO_COLOR_COMPONENT);
     background.rgba.A = (u8)(viewport->settings.background.opacity * FLOAT_TO_COLOR_COMPONENT);
+    return background.value;
+}
+
+// Resolves a row of the viewport's pixels (from the given column, of the given width) into the given window pixels:
+INLINE void resolveViewportRow(Viewport *viewport, u16 y, u16 x, u16 width, u32 background, u32 *trg_value) {
+    PixelQuad *src_pixel = viewport->pixels +
+            (u32)viewport->dimensions.stride * (u32)(viewport->position.y + y) + (u32)(viewport->position.x + x);
+    vec3 color;
+    RGBA2u32 trg_pixel;
     if (viewport->settings.antialias) {
-        for (u16 y = 0; y < viewport->dimensions.height; y++) {
-            for (u16 x = 0; x < viewport->dimensions.width; x++, src_pixel++, trg_value++) {
-                if (src_pixel->TL.opacity || src_pixel->TR.opacity || src_pixel->BL.opacity || src_pixel->BR.opacity) {
-                    color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity * 0.25f);
-                    color = scaleAddVec3(src_pixel->TR.color, src_pixel->TR.opacity * 0.25f, color);
-                    color = scaleAddVec3(src_pixel->BL.color, src_pixel->BL.opacity * 0.25f, color);
-                    color = scaleAddVec3(src_pixel->BR.color, src_pixel->BR.opacity * 0.25f, color);
-                    trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
-                    trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
-                    trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
-                    trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
-                } else trg_pixel = background;
-                *trg_value = trg_pixel.value;
-            }
+        for (u16 i = 0; i < width; i++, src_pixel++, trg_value++) {
+            if (src_pixel->TL.opacity || src_pixel->TR.opacity || src_pixel->BL.opacity || src_pixel->BR.opacity) {
+                color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity * 0.25f);
+                color = scaleAddVec3(src_pixel->TR.color, src_pixel->TR.opacity * 0.25f, color);
+                color = scaleAddVec3(src_pixel->BL.color, src_pixel->BL.opacity * 0.25f, color);
+                color = scaleAddVec3(src_pixel->BR.color, src_pixel->BR.opacity * 0.25f, color);
+                trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+                trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+                trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+                trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
+            } else trg_pixel.value = background;
+            *trg_value = trg_pixel.value;
         }
     } else {
-        for (u16 y = 0; y < viewport->dimensions.height; y++) {
-            for (u16 x = 0; x < viewport->dimensions.width; x++, src_pixel++, trg_value++) {
-                if (src_pixel->TL.depth == INFINITY)
-                    trg_pixel = background;
-                else {
-                    color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity);
-                    trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
-                    trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
-                    trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
-                    trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
-                }
-                *trg_value = trg_pixel.value;
+        for (u16 i = 0; i < width; i++, src_pixel++, trg_value++) {
+            if (src_pixel->TL.depth == INFINITY)
+                trg_pixel.value = background;
+            else {
+                color = scaleVec3(src_pixel->TL.color, src_pixel->TL.opacity);
+                trg_pixel.rgba.R = (u8)(color.r > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.r));
+                trg_pixel.rgba.G = (u8)(color.g > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.g));
+                trg_pixel.rgba.B = (u8)(color.b > (MAX_COLOR_VALUE * MAX_COLOR_VALUE) ? MAX_COLOR_VALUE : sqrt(color.b));
+                trg_pixel.rgba.A = (u8)(clampValue(src_pixel->TL.opacity) * FLOAT_TO_COLOR_COMPONENT);
             }
+            *trg_value = trg_pixel.value;
         }
     }
 }
 
+// The row of the viewport's pixels that a row of the viewport in the window is scaled up from (sampling pixel centers):
+INLINE u16 getViewportSourceRow(Viewport *viewport, u16 y) {
+    return (u16)(((u32)y * 2 + 1) * viewport->dimensions.height / ((u32)viewport->scaling.height * 2));
+}
+
+// Resolves a row of the viewport in the window, scaling it up from the internal resolution (nearest pixel) if lower:
+void resolveViewportWindowRow(Viewport *viewport, u16 y, u32 background, u32 *trg_value) {
+    if (!isViewportScaled(viewport)) {
+        resolveViewportRow(viewport, y, 0, viewport->dimensions.width, background, trg_value);
+        return;
+    }
+
+    u32 row[MAX_WIDTH];
+    resolveViewportRow(viewport, getViewportSourceRow(viewport, y), 0, viewport->dimensions.width, background, row);
+
+    // Step through the source row in 16.16 fixed point:
+    u32 step = ((u32)viewport->dimensions.width << 16) / viewport->scaling.width;
+    u32 src_x = step >> 1;
+    for (u16 x = 0; x < viewport->scaling.width; x++, src_x += step)
+        trg_value[x] = row[src_x >> 16];
+}
+
+void drawViewportToWindowContent(Viewport *viewport) {
+    PROFILE_BEGIN("drawViewportToWindowContent");
+
+    u16 width  = getViewportWindowWidth(viewport);
+    u16 height = getViewportWindowHeight(viewport);
+    bool is_scaled = isViewportScaled(viewport);
+    u32 *trg_value = app->window_content;
+    u32 background = getViewportBackgroundValue(viewport);
+    for (u16 y = 0; y < height; y++, trg_value += width) {
+        // When scaled up, consecutive rows that come from the same source row are copied rather than resolved again:
+        if (is_scaled && y && getViewportSourceRow(viewport, y) == getViewportSourceRow(viewport, y - 1))
+            for (u16 x = 0; x < width; x++) trg_value[x] = trg_value[x - width];
+        else
+            resolveViewportWindowRow(viewport, y, background, trg_value);
+    }
+
+    if (viewport->settings.show_hud && isHUDRetained(&viewport->hud))
+        drawHUDToWindowContent(viewport, app->window_content, width);
+
+    PROFILE_END();
+}
+
+// Dynamic resolution: A feedback loop that scales the internal resolution so that frames take the target time.
+//
+// The frame time is that of the work done for the last frame (from beginFrame to endFrame) smoothed over frames.
+// The cost of drawing mostly scales with the pixel count, so the scale of each side is changed by the square root of
+// the ratio between the target and the frame time (half way there each time, in steps of VIEWPORT_SCALING__STEP).
+// Frame times within VIEWPORT_SCALING__TOLERANCE of the target are left alone, and after every change the new frame
+// time is given some frames to settle - so that the resolution does not oscillate around the target.
+//
+// With dynamic_antialias, antialiasing (4 sub-pixels to each pixel) is switched off before the resolution is lowered,
+// and is only switched back on once at full resolution with frames taking well under the target time.
+void updateDynamicResolution(Viewport *viewport, Timer *timer) {
+    u32 target = viewport->settings.target_microseconds_per_frame;
+    ViewportScaling *scaling = &viewport->scaling;
+    if (!target) {
+        if (isViewportScaled(viewport)) setViewportResolutionScale(viewport, 1);
+        return;
+    }
+
+    f32 frame_time = (f32)timer->microseconds;
+    if (!frame_time) return;
+    scaling->frame_time = scaling->frame_time ?
+            scaling->frame_time + (frame_time - scaling->frame_time) * VIEWPORT_SCALING__SMOOTHING : frame_time;
+    if (scaling->settle_frames) {
+        scaling->settle_frames--;
+        return;
+    }
+
+    f32 ratio = (f32)target / scaling->frame_time;
+    ViewportSettings *settings = &viewport->settings;
+    if (ratio < 1 - VIEWPORT_SCALING__TOLERANCE) {
+        if (settings->dynamic_antialias && settings->antialias) {
+            settings->antialias = false;
+            scaling->dropped_antialias = true;
+            scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
+            return;
+        }
+    } else if (ratio > 1 + VIEWPORT_SCALING__TOLERANCE) {
+        if (scaling->scale == 1) {
+            if (scaling->dropped_antialias && ratio > VIEWPORT_SCALING__ANTIALIAS_HEADROOM) {
+                settings->antialias = true;
+                scaling->dropped_antialias = false;
+                scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
+            }
+            return;
+        }
+    } else
+        return;
+
+    f32 scale = scaling->scale * (1 + (sqrtf(ratio) - 1) * 0.5f);
+    scale = (f32)(i32)(scale / VIEWPORT_SCALING__STEP + 0.5f) * VIEWPORT_SCALING__STEP;
+    if (scale < settings->min_resolution_scale) scale = settings->min_resolution_scale;
+    if (scale == scaling->scale) scale += ratio > 1 ? VIEWPORT_SCALING__STEP : -VIEWPORT_SCALING__STEP;
+    if (scale < settings->min_resolution_scale) scale = settings->min_resolution_scale;
+    if (scale > 1) scale = 1;
+    if (scale == scaling->scale) return;
+
+    setViewportResolutionScale(viewport, scale);
+    scaling->settle_frames = VIEWPORT_SCALING__SETTLE_FRAMES;
+}
+
 void fillViewport(Viewport *viewport, vec3 color, f32 opacity, f64 depth) {
     PixelQuad fill_pixel;
     Pixel fill_sub_pixel;
@@ -58,7 +160,13 @@ void fillViewport(Viewport *viewport, vec3 color, f32 opacity, f64 depth) {
     fill_sub_pixel.opacity = opacity;
     fill_sub_pixel.depth = depth;
     fill_pixel.TL = fill_pixel.TR = fill_pixel.BL = fill_pixel.BR = fill_sub_pixel;
-    for (i32 y = viewport->position.y; y < (viewport->position.y + viewport->dimensions.height); y++)
+    i32 first_y = viewport->position.y;
+    i32 end_y   = viewport->position.y + viewport->dimensions.height;
+    if (viewport->band_bottom) {
+        end_y    = first_y + viewport->band_bottom;
+        first_y += viewport->band_top;
+    }
+    for (i32 y = first_y; y < end_y; y++)
         for (i32 x = viewport->position.x; x < (viewport->position.x + viewport->dimensions.width); x++)
             viewport->pixels[viewport->dimensions.stride * y + x] = fill_pixel;
 }
@@ -71,12 +179,28 @@ void clearViewportToBackground(Viewport *viewport) {
 }
 
 void beginDrawing(Viewport *viewport) {
+    PROFILE_BEGIN("beginDrawing");
+
     clearViewportToBackground(viewport);
     setProjectionMatrix(viewport);
+#ifdef SLIM_ENGINE_RASTERIZER_STATS
+    RasterizerStats new_stats = {0};
+    viewport->stats = new_stats;
+#endif
+
+    PROFILE_END();
 }
 
 void endDrawing(Viewport *viewport) {
-    if (viewport->settings.show_hud)
-        drawHUD(viewport, &viewport->hud);
+    PROFILE_BEGIN("endDrawing");
+
+    if (viewport->settings.show_hud) {
+        if (isHUDRetained(&viewport->hud))
+            updateHUD(viewport, &viewport->hud);
+        else
+            drawHUD(viewport, &viewport->hud);
+    }
     drawViewportToWindowContent(viewport);
+
+    PROFILE_END();
 }
\ No newline at end of file
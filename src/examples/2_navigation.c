@@ -8,6 +8,8 @@
 
 #include "./_common.h"
 
+#define GROUND_FADE_DISTANCE 30
+
 void onButtonDown(MouseButton *mouse_button) {
     app->controls.mouse.pos_raw_diff = Vec2i(0, 0);
 }
@@ -42,6 +44,7 @@ void updateAndRender() {
     beginFrame(timer);
         updateViewport(viewport, mouse);
         beginDrawing(viewport);
+            drawInfiniteGrid(GROUND_FADE_DISTANCE, prim + 1, Color(prim[1].color), 0.5f, 0, viewport);
             drawGrid(grid, prim, Color(prim->color),
                      0.5f, 0, viewport);
             drawMouseAndKeyboard(mouse, viewport);
@@ -58,6 +61,12 @@ void setupScene(Scene *scene) {
     grid_prim->position.z = 5;
     rotatePrimitive(grid_prim, 0.5f, 0, 0);
 
+    // An endless ground, with its lines 2 units apart and fading out at a distance of 60 units:
+    Primitive *ground_prim = scene->primitives + 1;
+    ground_prim->color = BrightGrey;
+    ground_prim->scale = getVec3Of(2);
+    ground_prim->position.y = -2;
+
     xform3 *camera_xform = &scene->cameras[0].transform;
     camera_xform->position = Vec3(0, 7, -11);
     rotateXform3(camera_xform, 0, -0.2f, 0);
@@ -81,5 +90,5 @@ void initApp(Defaults *defaults) {
     app->on.mouseButtonDown          = onButtonDown;
     app->on.mouseButtonDoubleClicked = onDoubleClick;
     defaults->settings.scene.grids      = 1;
-    defaults->settings.scene.primitives = 1;
+    defaults->settings.scene.primitives = 2;
 }
\ No newline at end of file
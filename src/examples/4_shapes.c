@@ -1,3 +1,5 @@
+#define SLIM_ENGINE_RASTERIZER_STATS
+
 #include "../SlimEngine/app.h"
 #include "../SlimEngine/core/time.h"
 #include "../SlimEngine/viewport/viewport.h"
@@ -62,6 +64,7 @@ void updateAndRender() {
         updateScene(scene, timer->delta_time);
         beginDrawing(viewport);
             drawScene(scene, viewport);
+            setRasterizerStatsInHUD(&viewport->hud, 0, &viewport->stats);
         endDrawing(viewport);
     endFrame(timer, &app->controls.mouse);
 }
@@ -93,11 +96,24 @@ void setupScene(Scene *scene) {
     scene->curves[0].revolution_count = 10;
     scene->curves[1].revolution_count = 30;
 }
+void setupViewport(Viewport *viewport) {
+    viewport->hud.line_height = 1.2f;
+    viewport->hud.position = Vec2i(10, 10);
+}
+void onKeyChanged(u8 key, bool is_pressed) {
+    ViewportSettings *settings = &app->viewport.settings;
+    if (!is_pressed && key == app->controls.key_map.tab)
+        settings->show_hud = !settings->show_hud;
+}
 void initApp(Defaults *defaults) {
     defaults->settings.scene.boxes      = 1;
     defaults->settings.scene.grids      = 1;
     defaults->settings.scene.curves     = 2;
     defaults->settings.scene.primitives = 4;
+    defaults->settings.viewport.hud_line_count = 9;
+    defaults->settings.viewport.hud_default_color = Green;
+    app->on.keyChanged    = onKeyChanged;
+    app->on.viewportReady = setupViewport;
     app->on.sceneReady    = setupScene;
     app->on.windowRedraw  = updateAndRender;
 }
\ No newline at end of file
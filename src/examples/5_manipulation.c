@@ -43,9 +43,9 @@ void onDoubleClick(MouseButton *mouse_button) {
         onButtonDown(mouse_button);
     }
 }
-void updateViewport(Viewport *viewport, Mouse *mouse) {
+void updateViewport(Viewport *viewport, Mouse *mouse, f32 delta_time) {
     if (mouse->is_captured) {
-        navigateViewport(viewport, app->time.timers.update.delta_time);
+        navigateViewport(viewport, delta_time);
         if (mouse->moved)         orientViewport(viewport, mouse);
         if (mouse->wheel_scrolled)  zoomViewport(viewport, mouse);
     } else {
@@ -56,24 +56,24 @@ void updateViewport(Viewport *viewport, Mouse *mouse) {
         }
     }
 }
-void updateAndRender() {
-    Timer *timer = &app->time.timers.update;
+// Updating runs at a fixed time step, while rendering draws the latest snapshot of the scene (on a thread of its own):
+void update(f32 delta_time) {
     Controls *controls = &app->controls;
     Viewport *viewport = &app->viewport;
     Mouse *mouse = &controls->mouse;
-    Scene *scene = &app->scene;
 
-    beginFrame(timer);
-        if (!mouse->is_captured)
-            manipulateSelection(scene, viewport, controls);
-        if (!controls->is_pressed.alt)
-            updateViewport(viewport, mouse);
-        beginDrawing(viewport);
-            drawScene(scene, viewport);
-            drawSelection(scene, viewport, controls);
-            drawMouseAndKeyboard(mouse, viewport);
-        endDrawing(viewport);
-    endFrame(timer, mouse);
+    if (!mouse->is_captured)
+        manipulateSelection(&app->scene, viewport, controls);
+    if (!controls->is_pressed.alt)
+        updateViewport(viewport, mouse, delta_time);
+}
+void render(SceneSnapshot *snapshot) {
+    Viewport *viewport = &snapshot->viewport;
+    beginDrawing(viewport);
+        drawScene(&snapshot->scene, viewport);
+        drawSelection(&snapshot->scene, viewport, &snapshot->controls);
+        drawMouseAndKeyboard(&snapshot->controls.mouse, viewport);
+    endDrawing(viewport);
 }
 void onKeyChanged(u8 key, bool is_pressed) {
     NavigationMove *move = &app->viewport.navigation.move;
@@ -121,8 +121,8 @@ void initApp(Defaults *defaults) {
     defaults->settings.scene.curves     = 2;
     defaults->settings.scene.primitives = 4;
     app->on.sceneReady    = setupScene;
-    app->on.windowRedraw  = updateAndRender;;
-    app->on.sceneReady = setupScene;
+    app->on.update = update;
+    app->on.render = render;
     app->on.keyChanged = onKeyChanged;
     app->on.mouseButtonDown          = onButtonDown;
     app->on.mouseButtonDoubleClicked = onDoubleClick;
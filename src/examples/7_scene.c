@@ -1,3 +1,5 @@
+#define SLIM_ENGINE_PROFILER
+
 #include "../SlimEngine/app.h"
 #include "../SlimEngine/core/time.h"
 #include "../SlimEngine/viewport/viewport.h"
@@ -25,7 +27,11 @@ void onDoubleClick(MouseButton *mouse_button) {
     }
 }
 
+char trace_file_path[100];
+
 void drawScene(Scene *scene, Viewport *viewport) {
+    PROFILE_BEGIN("drawScene");
+
     Primitive *prim = scene->primitives;
     for (u32 i = 0; i < scene->settings.primitives; i++, prim++)
         switch (prim->type) {
@@ -49,6 +55,8 @@ void drawScene(Scene *scene, Viewport *viewport) {
             default:
                 break;
         }
+
+    PROFILE_END();
 }
 void setupViewport(Viewport *viewport) {
     HUD *hud = &viewport->hud;
@@ -79,12 +87,14 @@ void updateAndRender() {
     Scene *scene = &app->scene;
 
     beginFrame(timer);
+        updateDynamicResolution(viewport, timer);
         if (!mouse->is_captured) manipulateSelection(scene, viewport, controls);
         if (!controls->is_pressed.alt) updateViewport(viewport, mouse);
         beginDrawing(viewport);
-            drawScene(scene, viewport);
+            drawSceneInParallel(scene, viewport, drawScene, &app->frame_memory, &app->platform);
             drawSelection(scene, viewport, controls);
             setCountersInHUD(&viewport->hud, timer);
+            setProfilerInHUD(&viewport->hud, 2);
             f64 now = (f64)app->time.getTicks();
             f64 tps = (f64)app->time.ticks.per_second;
             if ((now - (f64)scene->last_io_ticks) / tps <= 2.0) {
@@ -100,6 +110,7 @@ void updateAndRender() {
                 i32 x = viewport->dimensions.width / 2 - 150;
                 i32 y = 20;
                 drawText(text, x, y, color, 1, viewport);
+                app->needs_redraw = true; // Until the message is gone
             }
         endDrawing(viewport);
     endFrame(timer, mouse);
@@ -173,11 +184,13 @@ void onKeyChanged(u8 key, bool is_pressed) {
         scene->last_io_is_save = key == 'S';
         char *file = scene->settings.file.char_ptr;
         if (scene->last_io_is_save)
-            saveSceneToFile(  scene, file, platform);
+            saveSceneChangesToFile(scene, file, platform);
         else
-            loadSceneFromFile(scene, file, platform);
+            loadSceneFromFile(     scene, file, platform);
         scene->last_io_ticks = app->time.getTicks();
     }
+    if (!is_pressed && key == 'P')
+        saveProfilerTraceToFile(trace_file_path, platform);
 }
 void initApp(Defaults *defaults) {
     static String files[2];
@@ -192,14 +205,21 @@ void initApp(Defaults *defaults) {
     mergeString(scene, (char*)__FILE__, (char*)"this.scene",   offset);
     mergeString(mesh1, (char*)__FILE__, (char*)"suzanne.mesh", offset);
     mergeString(mesh2, (char*)__FILE__, (char*)"dragon.mesh",  offset);
+    String trace_file;
+    trace_file.char_ptr = trace_file_path;
+    mergeString(&trace_file, (char*)__FILE__, (char*)"this.trace.json", offset);
     defaults->settings.scene.mesh_files = files;
     defaults->settings.scene.meshes     = 2;
     defaults->settings.scene.boxes      = 1;
     defaults->settings.scene.grids      = 1;
     defaults->settings.scene.curves     = 2;
     defaults->settings.scene.primitives = 7;
-    defaults->settings.viewport.hud_line_count = 2;
+    defaults->settings.viewport.hud_line_count = 2 + 12;
     defaults->settings.viewport.hud_default_color = Green;
+    defaults->settings.viewport.target_microseconds_per_frame = 1000000 / 60;
+    defaults->settings.viewport.dynamic_antialias = true;
+    app->render_on_demand = true;
+    app->max_frames_per_second = 120;
     app->on.keyChanged               = onKeyChanged;
     app->on.mouseButtonDown          = onButtonDown;
     app->on.mouseButtonDoubleClicked = onDoubleClick;
@@ -0,0 +1,221 @@
+#define SLIM_ENGINE_PROFILER
+
+#include "../SlimEngine/app.h"
+#include "../SlimEngine/core/time.h"
+#include "../SlimEngine/viewport/viewport.h"
+#include "../SlimEngine/viewport/compositor.h"
+#include "../SlimEngine/scene/box.h"
+#include "../SlimEngine/scene/grid.h"
+#include "../SlimEngine/scene/mesh.h"
+#include "../SlimEngine/scene/curve.h"
+#include "../SlimEngine/viewport/navigation.h"
+// Or using the single-header file:
+// #include "../SlimEngine.h"
+
+// The app's viewport is the top-left one (showing the HUD), the other 3 are drawn alongside it (each on its own thread).
+Viewport other_viewports[3];
+Viewport *navigated_viewport;
+Compositor compositor;
+u16 window_width, window_height;
+
+void setCountersInHUD(HUD *hud, Timer *timer) {
+    printNumberIntoString(timer->average_frames_per_second,      &hud->lines[0].value);
+    printNumberIntoString(timer->average_microseconds_per_frame, &hud->lines[1].value);
+}
+Viewport* getViewportAt(i32 x, i32 y) {
+    for (u32 i = 0; i < compositor.viewport_count; i++) {
+        Viewport *viewport = compositor.viewports[i];
+        if (x >= viewport->position.x && x < viewport->position.x + viewport->dimensions.width &&
+            y >= viewport->position.y && y < viewport->position.y + viewport->dimensions.height)
+            return viewport;
+    }
+    return navigated_viewport;
+}
+void onButtonDown(MouseButton *mouse_button) {
+    Mouse *mouse = &app->controls.mouse;
+    mouse->pos_raw_diff = Vec2i(0, 0);
+    if (!mouse->is_captured) navigated_viewport = getViewportAt(mouse->pos.x, mouse->pos.y);
+}
+void onDoubleClick(MouseButton *mouse_button) {
+    if (mouse_button == &app->controls.mouse.left_button) {
+        app->controls.mouse.is_captured = !app->controls.mouse.is_captured;
+        app->platform.setCursorVisibility(!app->controls.mouse.is_captured);
+        app->platform.setWindowCapture(    app->controls.mouse.is_captured);
+        onButtonDown(mouse_button);
+    }
+}
+void drawScene(Scene *scene, Viewport *viewport) {
+    Primitive *prim = scene->primitives;
+    for (u32 i = 0; i < scene->settings.primitives; i++, prim++)
+        switch (prim->type) {
+            case PrimitiveType_Mesh:
+                drawMesh(scene->meshes + prim->id, false, prim,
+                         Color(prim->color),0.5f, 0, viewport);
+                break;
+            case PrimitiveType_Coil:
+            case PrimitiveType_Helix:
+                drawCurve(scene->curves + prim->id, CURVE_STEPS, prim,
+                          Color(prim->color), 0.5f, 0, viewport);
+                break;
+            case PrimitiveType_Box:
+                drawBox(scene->boxes + prim->id, BOX__ALL_SIDES, prim,
+                        Color(prim->color),0.5f, 0, viewport);
+                break;
+            case PrimitiveType_Grid:
+                drawGrid(scene->grids + prim->id, prim,
+                         Color(prim->color), 0.5f, 0, viewport);
+                break;
+            default:
+                break;
+        }
+
+    // Draw the cameras of the other viewports:
+    for (u32 i = 0; i < compositor.viewport_count; i++)
+        if (compositor.viewports[i] != viewport)
+            drawCamera(compositor.viewports[i]->camera,
+                       Color(compositor.viewports[i] == navigated_viewport ? Yellow : White),
+                       0.5f, 0, viewport);
+}
+void updateViewport(Viewport *viewport, Mouse *mouse) {
+    if (mouse->is_captured) {
+        navigateViewport(viewport, app->time.timers.update.delta_time);
+        if (mouse->moved)         orientViewport(viewport, mouse);
+        if (mouse->wheel_scrolled)  zoomViewport(viewport, mouse);
+    } else {
+        if (mouse->wheel_scrolled) dollyViewport(viewport, mouse);
+        if (mouse->moved) {
+            if (mouse->middle_button.is_pressed)  panViewport(viewport, mouse);
+            if (mouse->right_button.is_pressed) orbitViewport(viewport, mouse);
+        }
+    }
+}
+void updateAndRender() {
+    Timer *timer = &app->time.timers.update;
+    Mouse *mouse = &app->controls.mouse;
+    Viewport *viewport = &app->viewport;
+
+    beginFrame(timer);
+        updateViewport(navigated_viewport, mouse);
+        for (u32 i = 0; i < 3; i++)
+            other_viewports[i].settings.antialias = viewport->settings.antialias;
+        setCountersInHUD(&viewport->hud, timer);
+        setProfilerInHUD(&viewport->hud, 2);
+        composeViewports(&compositor, app->window_content, window_width, window_height, &app->platform);
+    endFrame(timer, mouse);
+}
+void onResize(u16 width, u16 height) {
+    window_width = width;
+    window_height = height;
+    u16 left_width = width / 2;
+    u16 top_height = height / 2;
+    setViewportRegion(&app->viewport,     0,          0,          left_width,         top_height,          width);
+    setViewportRegion(&other_viewports[0], left_width, 0,          width - left_width, top_height,          width);
+    setViewportRegion(&other_viewports[1], 0,          top_height, left_width,         height - top_height, width);
+    setViewportRegion(&other_viewports[2], left_width, top_height, width - left_width, height - top_height, width);
+}
+void setupViewport(Viewport *viewport) {
+    HUD *hud = &viewport->hud;
+    hud->line_height = 1.2f;
+    hud->position = Vec2i(10, 10);
+    setCountersInHUD(hud, &app->time.timers.update);
+    setString(&hud->lines[0].title, (char*)"Fps    : ");
+    setString(&hud->lines[1].title, (char*)"mic-s/f: ");
+
+    // The other viewports draw into the same frame buffer through their own cameras (and without a HUD):
+    ViewportSettings settings = viewport->settings;
+    settings.hud_line_count = 0;
+    settings.hud_lines = null;
+    settings.hud_runs = null;
+    settings.show_hud = false;
+    for (u32 i = 0; i < 3; i++)
+        initViewport(&other_viewports[i], &settings, &viewport->navigation.settings,
+                     app->scene.cameras + 1 + i, viewport->pixels);
+
+    navigated_viewport = viewport;
+    initCompositor(&compositor, &app->scene, drawScene);
+    addViewportToCompositor(&compositor, viewport);
+    for (u32 i = 0; i < 3; i++) addViewportToCompositor(&compositor, &other_viewports[i]);
+}
+void setupScene(Scene *scene) {
+    Primitive *grid  = &scene->primitives[0];
+    Primitive *mesh  = &scene->primitives[1];
+    Primitive *helix = &scene->primitives[2];
+    Primitive *coil  = &scene->primitives[3];
+    Primitive *box   = &scene->primitives[4];
+
+    grid->type  = PrimitiveType_Grid;
+    mesh->type  = PrimitiveType_Mesh;
+    helix->type = PrimitiveType_Helix;
+    coil->type  = PrimitiveType_Coil;
+    box->type   = PrimitiveType_Box;
+    grid->color  = Green;
+    mesh->color  = Blue;
+    helix->color = Cyan;
+    coil->color  = Magenta;
+    box->color   = Yellow;
+    grid->id = mesh->id = helix->id = box->id = 0;
+    coil->id = 1;
+    grid->scale     = Vec3(5, 1, 5);
+    mesh->position  = Vec3(0, 5, 5);
+    helix->position = Vec3(-3, 4, 2);
+    coil->position  = Vec3(4, 4, 2);
+    box->position   = Vec3(0, 1, -3);
+    scene->curves[0].revolution_count = 10;
+    scene->curves[1].revolution_count = 30;
+    initGrid(scene->grids,11, 11);
+    rotatePrimitive(grid, 0.5f, 0, 0);
+
+    // A perspective camera, followed by cameras looking from the front, the side and from above:
+    xform3 *xf = &scene->cameras[0].transform;
+    xf->position = Vec3(0, 7, -11);
+    rotateXform3(xf, 0, -0.2f, 0);
+
+    xf = &scene->cameras[1].transform;
+    xf->position = Vec3(0, 4, -25);
+
+    xf = &scene->cameras[2].transform;
+    xf->position = Vec3(-25, 4, 2);
+    rotateXform3(xf, -TAU / 4, 0, 0);
+
+    xf = &scene->cameras[3].transform;
+    xf->position = Vec3(0, 30, 2);
+    rotateXform3(xf, 0, -TAU / 4, 0);
+}
+void onKeyChanged(u8 key, bool is_pressed) {
+    NavigationMove *move = &navigated_viewport->navigation.move;
+    NavigationTurn *turn = &navigated_viewport->navigation.turn;
+    if (key == 'Q') turn->left     = is_pressed;
+    if (key == 'E') turn->right    = is_pressed;
+    if (key == 'R') move->up       = is_pressed;
+    if (key == 'F') move->down     = is_pressed;
+    if (key == 'W') move->forward  = is_pressed;
+    if (key == 'S') move->backward = is_pressed;
+    if (key == 'A') move->left     = is_pressed;
+    if (key == 'D') move->right    = is_pressed;
+
+    ViewportSettings *settings = &app->viewport.settings;
+    if (!is_pressed && key == app->controls.key_map.tab)
+        settings->show_hud = !settings->show_hud;
+}
+void initApp(Defaults *defaults) {
+    static String mesh_file;
+    static char string_buffer[100];
+    mesh_file.char_ptr = string_buffer;
+    mergeString(&mesh_file, (char*)__FILE__, (char*)"suzanne.mesh", getDirectoryLength((char*)__FILE__));
+    defaults->settings.scene.mesh_files = &mesh_file;
+    defaults->settings.scene.meshes     = 1;
+    defaults->settings.scene.cameras    = 4;
+    defaults->settings.scene.boxes      = 1;
+    defaults->settings.scene.grids      = 1;
+    defaults->settings.scene.curves     = 2;
+    defaults->settings.scene.primitives = 5;
+    defaults->settings.viewport.hud_line_count = 2 + 12;
+    defaults->settings.viewport.hud_default_color = Green;
+    app->on.keyChanged               = onKeyChanged;
+    app->on.mouseButtonDown          = onButtonDown;
+    app->on.mouseButtonDoubleClicked = onDoubleClick;
+    app->on.windowRedraw  = updateAndRender;
+    app->on.windowResize  = onResize;
+    app->on.sceneReady    = setupScene;
+    app->on.viewportReady = setupViewport;
+}
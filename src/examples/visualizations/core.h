@@ -152,10 +152,11 @@ void addLabel(vec3 color, char* text, i32 x, i32 y) {
 }
 
 void transformEdge(Edge *in_edge, Edge *out_edge, xform3 *xform) {
+    quat rotation_inverted = getXform3InvertedRotation(xform);
     out_edge->from = subVec3(in_edge->from, xform->position);
-    out_edge->from = mulVec3Quat(out_edge->from, xform->rotation_inverted);
+    out_edge->from = mulVec3Quat(out_edge->from, rotation_inverted);
     out_edge->to = subVec3(in_edge->to, xform->position);
-    out_edge->to = mulVec3Quat(out_edge->to, xform->rotation_inverted);
+    out_edge->to = mulVec3Quat(out_edge->to, rotation_inverted);
 }
 
 INLINE vec3 vec3wUp(vec4 v) {
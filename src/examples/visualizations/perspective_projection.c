@@ -287,8 +287,10 @@ void updateAndRender() {
                 app->scene.primitives[1].position,
                 app->scene.primitives[2].position};
         manipulateSelection(&app->scene, active_viewport, &app->controls);
-        if (transitions.view_frustom_slice.active && app->scene.selection->primitive == 0)
+        if (transitions.view_frustom_slice.active && app->scene.selection->primitive == 0) {
             app->scene.primitives[0].position = original_positions[0];
+            app->scene.primitives[0].flags |= IS_DIRTY;
+        }
 
         app->scene.settings.primitives = primitive_count;
         if (app->controls.is_pressed.shift) {
@@ -309,6 +311,7 @@ void updateAndRender() {
                 app->scene.primitives[i].position.y = original_positions[i].y;
             }
         }
+        for (u8 i = 0; i < 3; i++) app->scene.primitives[i].flags |= IS_DIRTY;
     }
 
     setProjectionMatrix(viewport);
@@ -322,9 +325,11 @@ void updateAndRender() {
     }
 
     secondary_camera_prim->position = secondary_viewport.camera->transform.position;
-    secondary_camera_prim->rotation = secondary_viewport.camera->transform.rotation;
+    secondary_camera_prim->rotation = getXform3Rotation(&secondary_viewport.camera->transform);
     main_camera_prim->position = viewport->camera->transform.position;
-    main_camera_prim->rotation = viewport->camera->transform.rotation;
+    main_camera_prim->rotation = getXform3Rotation(&viewport->camera->transform);
+    secondary_camera_prim->flags |= IS_DIRTY;
+    main_camera_prim->flags |= IS_DIRTY;
     updateProjectionBoxes(&secondary_viewport);
 
     sides_color = Color(Cyan);
@@ -560,13 +565,13 @@ void setupViewportCore(Viewport *viewport) {
                                                        secondary_viewport.settings.near_clipping_plane_distance,
                                                        camera_xform->position);
         initGrid(projection_plane_grid, 2, 2);
-        projection_plane_prim->rotation = rotateAroundAxisBySinCos(camera_xform->rotation, x_axis, sin_cos);
+        projection_plane_prim->rotation = rotateAroundAxisBySinCos(getXform3Rotation(camera_xform), x_axis, sin_cos);
 
         projective_ref_plane_prim->id = 2;
         //    projective_ref_plane_prim->scale = Vec3(10, 1, 10);
         projective_ref_plane_prim->position = scaleAddVec3(*camera_xform->forward_direction, 1, camera_xform->position);
         initGrid(projective_ref_plane_grid, 11, 11);
-        projective_ref_plane_prim->rotation = rotateAroundAxisBySinCos(camera_xform->rotation, x_axis, sin_cos);
+        projective_ref_plane_prim->rotation = rotateAroundAxisBySinCos(getXform3Rotation(camera_xform), x_axis, sin_cos);
 
         main_box_prim->position = Vec3(0, 3, 5);
         main_box_prim->scale = getVec3Of(2);
@@ -578,15 +583,17 @@ void setupViewportCore(Viewport *viewport) {
     updateArrow(&arrow1);
 
     scene->selection->primitive = scene->primitives + 1;
+    scene->selection->primitive_handle = getObjectHandle(&scene->primitive_pool, 1);
 
     initBox(&NDC_box);
     if (!secondary_viewport.settings.use_cube_NDC) for (u8 i = 4; i < 8; i++) NDC_box.vertices.buffer[i].z = 0;
     setBoxEdgesFromVertices(&NDC_box.edges, &NDC_box.vertices);
 
     secondary_camera_prim->position = secondary_viewport.camera->transform.position;
-    secondary_camera_prim->rotation = secondary_viewport.camera->transform.rotation;
+    secondary_camera_prim->rotation = getXform3Rotation(&secondary_viewport.camera->transform);
     main_camera_prim->position = viewport->camera->transform.position;
-    main_camera_prim->rotation = viewport->camera->transform.rotation;
+    main_camera_prim->rotation = getXform3Rotation(&viewport->camera->transform);
+    for (u32 i = 0; i < scene->settings.primitives; i++) scene->primitives[i].flags |= IS_DIRTY;
 
     updateProjectionBoxes(&secondary_viewport);
     updateCameraArrows(&secondary_viewport.camera->transform);
@@ -146,7 +146,7 @@ void renderViewSpaceFrustumSlice(Viewport *viewport, f32 delta_time) {
             edge.to   = convertPositionToObjectSpace(edge.to, main_camera_prim);
             edge.from = convertPositionToObjectSpace(edge.from, main_camera_prim);
             projectEdge(&edge, viewport);
-            char *str;
+            char *str = (char*)"";
             switch (i) {
                 case 0: str = (char*)"(-1, 1, 1)"; break;
                 case 1: str = (char*)"(1, 1, 1)"; break;
@@ -162,7 +162,7 @@ void renderViewSpaceFrustumSlice(Viewport *viewport, f32 delta_time) {
     }
     if (transitions.show_transformation.active) incTransition(&transitions.show_transformation, delta_time, true);
 
-    f32 opacity;
+    f32 opacity = 1;
     vec3 up_color = Y_color;
     if (transitions.view_frustom_slice.active) {
         if (incTransition(&transitions.view_frustom_slice, delta_time, false))
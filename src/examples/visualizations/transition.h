@@ -61,6 +61,9 @@ void updateTransitions(u8 key) {
             arrowX.body.to = app->scene.primitives[0].position = Vec3(1, 0, 0);
             arrowY.body.to = app->scene.primitives[1].position = Vec3(0, 1, 0);
             arrowZ.body.to = app->scene.primitives[2].position = Vec3(0, 0, 1);
+            app->scene.primitives[0].flags |= IS_DIRTY;
+            app->scene.primitives[1].flags |= IS_DIRTY;
+            app->scene.primitives[2].flags |= IS_DIRTY;
             updateArrow(&arrowX);
             updateArrow(&arrowY);
             updateArrow(&arrowZ);
@@ -129,6 +132,9 @@ void updateTransitions(u8 key) {
             arrowX.body.to = arrowX_box_prim->position = Vec3(1, 0, 0);
             arrowY.body.to = arrowY_box_prim->position = Vec3(0, 1, 0);
             arrowZ.body.to = arrowZ_box_prim->position = Vec3(0, 0, 1);
+            arrowX_box_prim->flags |= IS_DIRTY;
+            arrowY_box_prim->flags |= IS_DIRTY;
+            arrowZ_box_prim->flags |= IS_DIRTY;
         } else {
             transitions.focal_length_and_plane.active = !transitions.focal_length_and_plane.active;
             transitions.focal_length_and_plane.t = 0;
@@ -191,6 +197,9 @@ bool incTransition(Transition *transition, f32 inc, bool reset_when_done) {
     } else
         transition->eased_t = smoothstep(0, 1, transition->t);
 
+    // While it is still in progress the next frame is needed as well (when rendering on demand):
+    if (transition->active && transition->t < 1) app->needs_redraw = true;
+
     return transition->active;
 }
 
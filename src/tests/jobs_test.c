@@ -0,0 +1,132 @@
+// Tests of the job system (see src/SlimEngine/core/jobs.h), on the threads of the platforms (see platforms/threads.h):
+// Every index being run exactly once by addJobs/waitForJobs and parallelFor, jobs that add jobs and wait for them,
+// jobs that do not fit in the adding thread's deque being run right away, idle threads stealing jobs, and shutting down.
+// Usage: ./SlimEngine_jobs_test
+
+#include <stdio.h>
+
+#include "../SlimEngine/core/jobs.h"
+#include "../SlimEngine/platforms/threads.h"
+
+#define JOBS_TEST__THREADS 4
+#define JOBS_TEST__COUNT 1000
+#define JOBS_TEST__NESTED_COUNT 10
+#define JOBS_TEST__OVERFLOW 10
+#define JOBS_TEST__MAX_SPINS 10000000
+
+Platform platform;
+volatile i32 runs[JOBS_TEST__COUNT];
+volatile u32 was_stolen;
+u32 failures = 0;
+
+void check(const char *name, bool passed) {
+    if (passed) return;
+    if (failures++ < 10) printf("FAILED: %s\n", name);
+}
+
+void initTestPlatform(u32 thread_count) {
+    setPlatformThreads(&platform);
+    platform.thread_count = thread_count;
+}
+
+void countRun(void *data, u32 index) {
+    ATOMIC_ADD((volatile i32*)data + index, 1);
+}
+
+u32 getRunCount() {
+    u32 run_count = 0;
+    for (u32 i = 0; i < JOBS_TEST__COUNT; i++) run_count += (u32)runs[i];
+    return run_count;
+}
+
+// Checks that every index was run exactly once, and resets them for the next test:
+void checkRunsOnce(const char *name) {
+    bool passed = true;
+    for (u32 i = 0; i < JOBS_TEST__COUNT; i++) {
+        if (runs[i] != 1) passed = false;
+        runs[i] = 0;
+    }
+    check(name, passed);
+}
+
+void runNestedJobs(void *data, u32 index) {
+    u32 count = JOBS_TEST__COUNT / JOBS_TEST__NESTED_COUNT;
+    parallelFor(countRun, (void*)((volatile i32*)data + index * count), count, 3);
+}
+
+// Jobs of the adding (main) thread wait until any job was run by another thread, which has to have stolen it:
+void waitForStealing(void *data, u32 index) {
+    (void)data;
+    (void)index;
+    if (job_thread_index) {
+        ATOMIC_STORE(&was_stolen, 1);
+        return;
+    }
+    for (u32 spin = 0; spin < JOBS_TEST__MAX_SPINS && !ATOMIC_LOAD(&was_stolen); spin++) Threads_yieldThread();
+}
+
+void testOverflow() {
+    // Without other threads, jobs that do not fit in the deque are all that is run before waiting:
+    initTestPlatform(1);
+    initJobSystem(&platform);
+    JobCounter counter;
+    counter.pending = 0;
+    addJobs(countRun, (void*)runs, JOBS__DEQUE_CAPACITY + JOBS_TEST__OVERFLOW, 1, &counter);
+    check("Jobs that do not fit in the deque are run right away", getRunCount() == JOBS_TEST__OVERFLOW);
+    check("Jobs that do fit in the deque are pending", counter.pending == JOBS__DEQUE_CAPACITY);
+    waitForJobs(&counter);
+    check("Waiting runs the pending jobs", getRunCount() == JOBS__DEQUE_CAPACITY + JOBS_TEST__OVERFLOW);
+    for (u32 i = 0; i < JOBS_TEST__COUNT; i++) runs[i] = 0;
+}
+
+void testJobs() {
+    initTestPlatform(JOBS_TEST__THREADS);
+    initJobSystem(&platform);
+    check("The platform's threads are started", job_system.thread_count == JOBS_TEST__THREADS &&
+                                                platform.thread_count == JOBS_TEST__THREADS);
+
+    JobCounter counter;
+    counter.pending = 0;
+    addJobs(countRun, (void*)runs, JOBS_TEST__COUNT / 2, 7, &counter);
+    addJobs(countRun, (void*)(runs + JOBS_TEST__COUNT / 2), JOBS_TEST__COUNT / 2, 5, &counter);
+    waitForJobs(&counter);
+    check("Waiting for the jobs of a counter finishes all of them", counter.pending == 0);
+    checkRunsOnce("addJobs and waitForJobs run every index once");
+
+    parallelFor(countRun, (void*)runs, JOBS_TEST__COUNT, 0);
+    checkRunsOnce("parallelFor runs every index once");
+
+    parallelFor(runNestedJobs, (void*)runs, JOBS_TEST__NESTED_COUNT, 1);
+    checkRunsOnce("Jobs that add jobs and wait for them run every index once");
+
+    addJobs(countRun, (void*)runs, JOBS__DEQUE_CAPACITY + JOBS_TEST__OVERFLOW, 1, &counter);
+    waitForJobs(&counter);
+    check("Jobs that do not fit in the deque run once as well", getRunCount() == JOBS__DEQUE_CAPACITY + JOBS_TEST__OVERFLOW);
+    for (u32 i = 0; i < JOBS_TEST__COUNT; i++) runs[i] = 0;
+
+    was_stolen = 0;
+    parallelFor(waitForStealing, null, JOBS_TEST__THREADS * 2, 1);
+    check("Idle threads steal the jobs of other threads", was_stolen);
+}
+
+void testShutDown() {
+    shutDownJobSystem(&platform);
+    check("Shutting down joins the threads", Threads_thread_count == 0);
+    check("Shutting down leaves a single thread", job_system.thread_count == 1 && platform.thread_count == 1);
+
+    parallelFor(countRun, (void*)runs, JOBS_TEST__COUNT, 16);
+    checkRunsOnce("Jobs run on the waiting thread after shutting down");
+}
+
+int main() {
+    testOverflow();
+    testJobs();
+    testShutDown();
+
+    if (failures) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
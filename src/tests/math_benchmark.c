@@ -0,0 +1,209 @@
+// Microbenchmarks of the math functions that have SIMD paths (see src/SlimEngine/math/simd.h).
+// Every function is first validated against the plain scalar formulas (or against an invariant, like M * inv(M) = I),
+// then timed over an array of inputs, each result being fed back as the next input so that no work can be skipped.
+// The SlimEngine_math_benchmark_scalar target builds the same file with SLIM_ENGINE_NO_SIMD, for comparison.
+// Usage: ./SlimEngine_math_benchmark [ITERATIONS]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../SlimEngine/math/vec4.h"
+#include "../SlimEngine/math/mat4.h"
+#include "../SlimEngine/math/quat.h"
+
+#define MATH_BENCHMARK__COUNT 256
+#define MATH_BENCHMARK__TOLERANCE 0.0005f
+
+vec4 vectors4[MATH_BENCHMARK__COUNT];
+vec3 vectors3[MATH_BENCHMARK__COUNT];
+mat4 matrices[MATH_BENCHMARK__COUNT];
+quat quaternions[MATH_BENCHMARK__COUNT];
+u32 random_state = 1;
+u32 failures = 0;
+
+f32 getRandomValue() {
+    random_state = random_state * 1664525 + 1013904223;
+    return (f32)(random_state >> 8) / (f32)(1 << 24) * 2.0f - 1.0f;
+}
+
+vec3 getRandomVec3() {
+    return Vec3(getRandomValue(), getRandomValue(), getRandomValue());
+}
+
+quat getRandomRotation() {
+    quat q;
+    q.axis = getRandomVec3();
+    q.amount = getRandomValue() + 2.0f;
+    return normQuat(q);
+}
+
+mat4 getRandomMatrix() {
+    mat4 m;
+    for (u8 row = 0; row < 4; row++)
+        for (u8 col = 0; col < 4; col++)
+            m.axis[row].components[col] = getRandomValue() + (row == col ? 4.0f : 0.0f);
+
+    return m;
+}
+
+mat4 getRotationMatrix(quat q) {
+    mat4 m = getMat4Identity();
+    m.X.v3 = mulVec3Quat(Vec3(1, 0, 0), q);
+    m.Y.v3 = mulVec3Quat(Vec3(0, 1, 0), q);
+    m.Z.v3 = mulVec3Quat(Vec3(0, 0, 1), q);
+    return m;
+}
+
+void check(const char *name, f32 expected, f32 actual) {
+    if (fabsf(expected - actual) <= MATH_BENCHMARK__TOLERANCE * (1.0f + fabsf(expected))) return;
+    if (failures++ < 10) printf("MISMATCH in %s: expected %f, got %f\n", name, expected, actual);
+}
+
+void checkVec3(const char *name, vec3 expected, vec3 actual) {
+    check(name, expected.x, actual.x);
+    check(name, expected.y, actual.y);
+    check(name, expected.z, actual.z);
+}
+
+void validate() {
+    vec4 v4_out[MATH_BENCHMARK__COUNT];
+    vec3 v3_out[MATH_BENCHMARK__COUNT];
+    quat rotation = getRandomRotation();
+
+    for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++) {
+        vec4 v = vectors4[i];
+        mat4 m = matrices[i];
+        vec4 r = mulVec4Mat4(v, m);
+        for (u8 col = 0; col < 4; col++)
+            check("mulVec4Mat4", v.x * m.X.components[col] +
+                                 v.y * m.Y.components[col] +
+                                 v.z * m.Z.components[col] +
+                                 v.w * m.W.components[col], r.components[col]);
+
+        mat4 product = mulMat4(m, matrices[(i + 1) % MATH_BENCHMARK__COUNT]);
+        for (u8 row = 0; row < 4; row++) {
+            r = mulVec4Mat4(m.axis[row], matrices[(i + 1) % MATH_BENCHMARK__COUNT]);
+            for (u8 col = 0; col < 4; col++) check("mulMat4", r.components[col], product.axis[row].components[col]);
+        }
+
+        mat4 identity = mulMat4(m, invMat4(m));
+        for (u8 row = 0; row < 4; row++)
+            for (u8 col = 0; col < 4; col++)
+                check("invMat4", row == col ? 1.0f : 0.0f, identity.axis[row].components[col]);
+
+        quat q = quaternions[i];
+        q.axis = scaleVec3(q.axis, 3.0f);
+        q.amount *= 3.0f;
+        q = normQuat(q);
+        check("normQuat", 1, q.axis.x * q.axis.x + q.axis.y * q.axis.y + q.axis.z * q.axis.z + q.amount * q.amount);
+        check("normQuat", quaternions[i].amount, q.amount);
+
+        vec3 rotated = mulVec3Quat(vectors3[i], quaternions[i]);
+        checkVec3("mulVec3Quat", Vec3fromVec4(mulVec4Mat4(Vec4fromVec3(vectors3[i], 0), getRotationMatrix(quaternions[i]))), rotated);
+        check("mulVec3Quat", squaredLengthVec3(vectors3[i]), squaredLengthVec3(rotated));
+    }
+
+    mulVec4ArrayMat4(vectors4, MATH_BENCHMARK__COUNT, matrices[0], v4_out);
+    for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++) {
+        vec4 r = mulVec4Mat4(vectors4[i], matrices[0]);
+        for (u8 col = 0; col < 4; col++) check("mulVec4ArrayMat4", r.components[col], v4_out[i].components[col]);
+    }
+
+    // An odd count exercises the scalar remainder of the batch function:
+    mulVec3ArrayQuat(vectors3, MATH_BENCHMARK__COUNT - 3, rotation, v3_out);
+    for (u32 i = 0; i < MATH_BENCHMARK__COUNT - 3; i++)
+        checkVec3("mulVec3ArrayQuat", mulVec3Quat(vectors3[i], rotation), v3_out[i]);
+}
+
+f64 start_time;
+
+void startTimer() {
+    start_time = (f64)clock() / CLOCKS_PER_SEC;
+}
+
+void printTime(const char *name, u32 iterations, f32 checksum) {
+    f64 seconds = (f64)clock() / CLOCKS_PER_SEC - start_time;
+    f64 nanoseconds = seconds * 1000000000.0 / ((f64)iterations * MATH_BENCHMARK__COUNT);
+    printf("%-20s %8.3f ns   (checksum %g)\n", name, nanoseconds, checksum);
+}
+
+int main(int argc, char **argv) {
+    u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 20000;
+    if (!iterations) iterations = 1;
+
+    for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++) {
+        vectors3[i] = getRandomVec3();
+        vectors4[i] = Vec4fromVec3(getRandomVec3(), 1);
+        matrices[i] = getRandomMatrix();
+        quaternions[i] = getRandomRotation();
+    }
+
+    validate();
+    if (failures) {
+        printf("%u mismatches\n", failures);
+        return 1;
+    }
+
+#if defined(SLIM_ENGINE_SIMD_SSE)
+    printf("SIMD backend: SSE\n");
+#elif defined(SLIM_ENGINE_SIMD_NEON)
+    printf("SIMD backend: NEON\n");
+#else
+    printf("SIMD backend: none (scalar)\n");
+#endif
+    printf("%u iterations over %u inputs, time per operation:\n", iterations, MATH_BENCHMARK__COUNT);
+
+    quat rotation = getRandomRotation();
+    mat4 rotation_matrix = getRotationMatrix(rotation);
+    f32 checksum;
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++)
+            vectors4[i] = mulVec4Mat4(vectors4[i], rotation_matrix);
+    checksum = vectors4[0].x;
+    printTime("mulVec4Mat4", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        mulVec4ArrayMat4(vectors4, MATH_BENCHMARK__COUNT, rotation_matrix, vectors4);
+    checksum = vectors4[0].x;
+    printTime("mulVec4ArrayMat4", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++)
+            matrices[i] = mulMat4(matrices[i], rotation_matrix);
+    checksum = matrices[0].X.x;
+    printTime("mulMat4", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++)
+            matrices[i] = invMat4(matrices[i]);
+    checksum = matrices[0].X.x;
+    printTime("invMat4", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++)
+            quaternions[i] = normQuat(quaternions[i]);
+    checksum = quaternions[0].amount;
+    printTime("normQuat", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        for (u32 i = 0; i < MATH_BENCHMARK__COUNT; i++)
+            vectors3[i] = mulVec3Quat(vectors3[i], rotation);
+    checksum = vectors3[0].x;
+    printTime("mulVec3Quat", iterations, checksum);
+
+    startTimer();
+    for (u32 iteration = 0; iteration < iterations; iteration++)
+        mulVec3ArrayQuat(vectors3, MATH_BENCHMARK__COUNT, rotation, vectors3);
+    checksum = vectors3[0].x;
+    printTime("mulVec3ArrayQuat", iterations, checksum);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Tests of the pooled scene objects (see src/SlimEngine/core/pool.h and src/SlimEngine/scene/objects.h):
+// Adding and removing objects at runtime, the reuse of freed slots, handles going stale once their objects are removed
+// (or the pools are reset, as when loading a scene), and objects not being removed while primitives still draw them.
+// Usage: ./SlimEngine_scene_objects_test
+
+#include <stdio.h>
+
+#include "../SlimEngine/scene/objects.h"
+
+#define SCENE_OBJECTS_TEST__CAPACITY 4
+#define SCENE_OBJECTS_TEST__MEMORY_SIZE Kilobytes(4)
+
+u8 memory_bytes[SCENE_OBJECTS_TEST__MEMORY_SIZE];
+Primitive primitives[SCENE_OBJECTS_TEST__CAPACITY];
+Curve curves[SCENE_OBJECTS_TEST__CAPACITY];
+Box boxes[SCENE_OBJECTS_TEST__CAPACITY];
+Grid grids[SCENE_OBJECTS_TEST__CAPACITY];
+Scene scene;
+u32 failures = 0;
+
+void check(const char *name, bool passed) {
+    if (passed) return;
+    if (failures++ < 10) printf("FAILED: %s\n", name);
+}
+
+// A scene with 2 primitives drawing a box each, and room for 2 more objects of each type:
+void initTestScene() {
+    Memory memory;
+    initMemory(&memory, memory_bytes, SCENE_OBJECTS_TEST__MEMORY_SIZE);
+
+    scene.primitives = primitives;
+    scene.curves = curves;
+    scene.boxes = boxes;
+    scene.grids = grids;
+    scene.meshes = null;
+    scene.settings.primitives = scene.settings.boxes = 2;
+    scene.settings.curves = scene.settings.grids = scene.settings.meshes = 0;
+    initObjectPool(&scene.primitive_pool, SCENE_OBJECTS_TEST__CAPACITY, 2, &memory);
+    initObjectPool(&scene.box_pool,       SCENE_OBJECTS_TEST__CAPACITY, 2, &memory);
+    initObjectPool(&scene.curve_pool,     SCENE_OBJECTS_TEST__CAPACITY, 0, &memory);
+    initObjectPool(&scene.grid_pool,      SCENE_OBJECTS_TEST__CAPACITY, 0, &memory);
+    initObjectPool(&scene.mesh_pool,      0,                            0, &memory);
+    for (u32 i = 0; i < 2; i++) {
+        initPrimitive(primitives + i);
+        initBox(boxes + i);
+        primitives[i].type = PrimitiveType_Box;
+        primitives[i].id = i;
+    }
+}
+
+void testAddingAndRemoving() {
+    ObjectHandle first, second, third, reused;
+    Primitive *primitive = addPrimitive(&scene, &first);
+    check("Adding goes into the first slot that was never used", primitive == primitives + 2 && first.index == 2);
+    check("Adding counts the used slots", scene.settings.primitives == 3 && scene.primitive_pool.count == 3);
+    check("Added handles are valid", isValidObjectHandle(&scene.primitive_pool, first));
+
+    addPrimitive(&scene, &second);
+    check("Adding to a full pool fails", !addPrimitive(&scene, &third) && third.index == POOL__INVALID_INDEX);
+
+    check("Removing a primitive", removePrimitive(&scene, first));
+    check("Removed primitives have no type", primitives[2].type == PrimitiveType_None);
+    check("Removed handles are stale", !isValidObjectHandle(&scene.primitive_pool, first));
+    check("Removing a stale handle fails", !removePrimitive(&scene, first));
+    check("Removing keeps counting the used slots", scene.settings.primitives == 4 && scene.primitive_pool.count == 3);
+    check("Other handles stay valid", isValidObjectHandle(&scene.primitive_pool, second));
+
+    addPrimitive(&scene, &reused);
+    check("Freed slots are reused", reused.index == first.index);
+    check("Reused slots have new generations", reused.generation != first.generation &&
+                                               !isValidObjectHandle(&scene.primitive_pool, first));
+}
+
+void testRemovingReferencedObjects() {
+    ObjectHandle box = getObjectHandle(&scene.box_pool, 1);
+    check("Objects that primitives draw are not removed", !removeBox(&scene, box));
+    check("Objects that are not removed stay valid", isValidObjectHandle(&scene.box_pool, box));
+
+    check("Removing the primitive drawing the box", removePrimitive(&scene, getObjectHandle(&scene.primitive_pool, 1)));
+    check("Objects that no primitive draws are removed", removeBox(&scene, box));
+    check("Removed objects are stale", !isValidObjectHandle(&scene.box_pool, box));
+
+    ObjectHandle curve;
+    Primitive *coil = addPrimitive(&scene, null);
+    addCurve(&scene, &curve);
+    coil->type = PrimitiveType_Coil;
+    coil->id = curve.index;
+    check("Curves that coils draw are not removed", !removeCurve(&scene, curve));
+}
+
+void testResettingPools() {
+    ObjectHandle primitive = getObjectHandle(&scene.primitive_pool, 0);
+    resetObjectPool(&scene.primitive_pool, 2);
+    check("Resetting keeps the given count", scene.primitive_pool.count == 2 &&
+                                             isPoolSlotActive(&scene.primitive_pool, 1) &&
+                                             !isPoolSlotActive(&scene.primitive_pool, 2));
+    check("Handles from before a reset are stale", !isValidObjectHandle(&scene.primitive_pool, primitive));
+    check("Slots that are in use after a reset have new handles",
+          isValidObjectHandle(&scene.primitive_pool, getObjectHandle(&scene.primitive_pool, 0)));
+
+    ObjectHandle added;
+    addPrimitive(&scene, &added);
+    check("Adding after a reset goes into the first free slot", added.index == 2);
+}
+
+int main() {
+    initTestScene();
+    testAddingAndRemoving();
+    testRemovingReferencedObjects();
+    testResettingPools();
+
+    if (failures) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}